@@ -40,6 +40,7 @@
 #define MCL_ONFAULT	32768		/* lock all pages that are faulted in */
 
 #define MLOCK_ONFAULT	0x01		/* Lock pages in range after they are faulted in, do not prefault */
+#define MLOCK_ASYNC	0x02		/* Lock pages in range, prefault them from a worker after return */
 
 #define MADV_NORMAL	0		/* no further special treatment */
 #define MADV_RANDOM	1		/* expect random page references */
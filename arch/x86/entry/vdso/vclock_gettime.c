@@ -26,6 +26,7 @@
 extern int __vdso_clock_gettime(clockid_t clock, struct timespec *ts);
 extern int __vdso_gettimeofday(struct timeval *tv, struct timezone *tz);
 extern time_t __vdso_time(time_t *t);
+extern u64 __vdso_monotonic_coarse_ns(void);
 
 #ifdef CONFIG_PARAVIRT_CLOCK
 extern u8 pvclock_page
@@ -302,3 +303,26 @@ notrace time_t __vdso_time(time_t *t)
 }
 int time(time_t *t)
 	__attribute__((weak, alias("__vdso_time")));
+
+/*
+ * CLOCK_MONOTONIC_COARSE as a flat nanosecond count, without the
+ * timespec conversion and without ever taking the syscall fallback.
+ * The resolution is that of the timekeeping update (one tick); callers
+ * wanting full clocksource resolution use clock_gettime(CLOCK_MONOTONIC).
+ * Together with __vdso_getcpu() this gives user level schedulers time
+ * and placement data from a few loads of shared cachelines.
+ */
+notrace u64 __vdso_monotonic_coarse_ns(void)
+{
+	unsigned long seq;
+	u64 ns;
+
+	do {
+		seq = gtod_read_begin(gtod);
+		ns = gtod->monotonic_time_coarse_ns;
+	} while (unlikely(gtod_read_retry(gtod, seq)));
+
+	return ns;
+}
+u64 monotonic_coarse_ns(void)
+	__attribute__((weak, alias("__vdso_monotonic_coarse_ns")));
@@ -73,5 +73,9 @@ void update_vsyscall(struct timekeeper *tk)
 		vdata->monotonic_time_coarse_sec++;
 	}
 
+	vdata->monotonic_time_coarse_ns =
+		(u64)vdata->monotonic_time_coarse_sec * NSEC_PER_SEC +
+		vdata->monotonic_time_coarse_nsec;
+
 	gtod_write_end(vdata);
 }
@@ -47,6 +47,13 @@
 #define KVM_COALESCED_MMIO_PAGE_OFFSET 2
 #define KVM_HALT_POLL_NS_DEFAULT 400000
 
+/*
+ * x86 uses a reader/writer mmu_lock so that TDP page faults which only
+ * install missing last-level sptes can run in parallel; everything that
+ * changes the paging structures takes it for write.
+ */
+#define KVM_HAVE_MMU_RWLOCK
+
 #define KVM_IRQCHIP_NUM_PINS  KVM_IOAPIC_NUM_PINS
 
 /* x86-specific vcpu->requests bit members */
@@ -51,5 +51,26 @@ asmlinkage long sys_arch_prctl(int, unsigned long);
 asmlinkage long sys_mmap(unsigned long, unsigned long, unsigned long,
 			 unsigned long, unsigned long, unsigned long);
 
+/* entry/syscall_batch.c */
+
+/*
+ * One entry of a syscall_batch(2) submission.
+ *
+ * transitional: the struct and its flags belong in a uapi header
+ * once the ABI settles.
+ */
+struct syscall_batch_desc {
+	__u64	nr;		/* syscall number */
+	__u64	args[6];	/* syscall arguments */
+	__s64	ret;		/* out: return value */
+	__u32	flags;		/* SYSCALL_BATCH_* */
+	__u32	resv;		/* must be zero */
+};
+
+#define SYSCALL_BATCH_ABORT_ON_ERROR	(1U << 0)
+
+asmlinkage long sys_syscall_batch(struct syscall_batch_desc __user *,
+				  unsigned int, unsigned int);
+
 #endif /* CONFIG_X86_32 */
 #endif /* _ASM_X86_SYSCALLS_H */
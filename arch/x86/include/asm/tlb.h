@@ -7,9 +7,14 @@
 
 #define tlb_flush(tlb)							\
 {									\
-	if (!tlb->fullmm && !tlb->need_flush_all) 			\
-		flush_tlb_mm_range(tlb->mm, tlb->start, tlb->end, 0UL);	\
-	else								\
+	if (!tlb->fullmm && !tlb->need_flush_all) {			\
+		if (!tlb_addrs_overflowed(tlb))				\
+			flush_tlb_mm_addrs(tlb->mm, tlb->addrs,		\
+					   tlb->nr_addrs);		\
+		else							\
+			flush_tlb_mm_range(tlb->mm, tlb->start,		\
+					   tlb->end, 0UL);		\
+	} else								\
 		flush_tlb_mm_range(tlb->mm, 0UL, TLB_FLUSH_ALL, 0UL);	\
 }
 
@@ -274,6 +274,13 @@ static inline void flush_tlb_mm_range(struct mm_struct *mm,
 		__flush_tlb_up();
 }
 
+static inline void flush_tlb_mm_addrs(struct mm_struct *mm,
+	   const unsigned long *addrs, unsigned int nr)
+{
+	if (mm == current->active_mm)
+		__flush_tlb_up();
+}
+
 static inline void native_flush_tlb_others(const struct cpumask *cpumask,
 					   struct mm_struct *mm,
 					   unsigned long start,
@@ -307,6 +314,8 @@ extern void flush_tlb_current_task(void);
 extern void flush_tlb_page(struct vm_area_struct *, unsigned long);
 extern void flush_tlb_mm_range(struct mm_struct *mm, unsigned long start,
 				unsigned long end, unsigned long vmflag);
+extern void flush_tlb_mm_addrs(struct mm_struct *mm,
+				const unsigned long *addrs, unsigned int nr);
 extern void flush_tlb_kernel_range(unsigned long start, unsigned long end);
 
 #define flush_tlb()	flush_tlb_current_task()
@@ -31,6 +31,8 @@ struct vsyscall_gtod_data {
 	gtod_long_t	wall_time_coarse_nsec;
 	gtod_long_t	monotonic_time_coarse_sec;
 	gtod_long_t	monotonic_time_coarse_nsec;
+	/* CLOCK_MONOTONIC_COARSE as flat nanoseconds, for __vdso_monotonic_coarse_ns */
+	u64		monotonic_time_coarse_ns;
 
 	int		tz_minuteswest;
 	int		tz_dsttime;
@@ -24,6 +24,7 @@
 #define KVM_FEATURE_STEAL_TIME		5
 #define KVM_FEATURE_PV_EOI		6
 #define KVM_FEATURE_PV_UNHALT		7
+#define KVM_FEATURE_PV_TLB_FLUSH	9
 
 /* The last 8 bits are used to indicate how to interpret the flags field
  * in pvclock structure. If no bits are set, all flags are ignored.
@@ -50,6 +51,15 @@ struct kvm_steal_time {
 	__u32 pad[11];
 };
 
+/*
+ * preempted is a flag byte: the host sets KVM_VCPU_PREEMPTED while the
+ * vcpu is scheduled out; other vcpus may then cmpxchg in
+ * KVM_VCPU_FLUSH_TLB instead of sending a flush IPI, and the host
+ * performs the flush on the next vcpu entry.
+ */
+#define KVM_VCPU_PREEMPTED	(1 << 0)
+#define KVM_VCPU_FLUSH_TLB	(1 << 1)
+
 #define KVM_STEAL_ALIGNMENT_BITS 5
 #define KVM_STEAL_VALID_BITS ((-1ULL << (KVM_STEAL_ALIGNMENT_BITS + 1)))
 #define KVM_STEAL_RESERVED_MASK (((1 << KVM_STEAL_ALIGNMENT_BITS) - 1 ) << 1)
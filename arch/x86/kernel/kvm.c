@@ -413,6 +413,56 @@ void kvm_disable_steal_time(void)
 }
 
 #ifdef CONFIG_SMP
+static DEFINE_PER_CPU(cpumask_var_t, __pv_tlb_mask);
+
+static void kvm_flush_tlb_others(const struct cpumask *cpumask,
+				 struct mm_struct *mm, unsigned long start,
+				 unsigned long end)
+{
+	struct cpumask *flushmask = this_cpu_cpumask_var_ptr(__pv_tlb_mask);
+	struct kvm_steal_time *src;
+	u8 state;
+	int cpu;
+
+	cpumask_copy(flushmask, cpumask);
+	/*
+	 * Queue the flush for preempted vcpus instead of waking them up
+	 * with an IPI just to ack it; the host performs the flush on
+	 * their next entry.  See record_steal_time() on the host side.
+	 */
+	for_each_cpu(cpu, flushmask) {
+		src = &per_cpu(steal_time, cpu);
+		state = READ_ONCE(src->preempted);
+		if ((state & KVM_VCPU_PREEMPTED) &&
+		    cmpxchg(&src->preempted, state,
+			    state | KVM_VCPU_FLUSH_TLB) == state)
+			cpumask_clear_cpu(cpu, flushmask);
+	}
+
+	native_flush_tlb_others(flushmask, mm, start, end);
+}
+
+static __init int kvm_setup_pv_tlb_flush(void)
+{
+	int cpu;
+
+	if (!kvm_para_available())
+		return 0;
+
+	if (kvm_para_has_feature(KVM_FEATURE_PV_TLB_FLUSH) &&
+	    kvm_para_has_feature(KVM_FEATURE_STEAL_TIME)) {
+		for_each_possible_cpu(cpu) {
+			zalloc_cpumask_var_node(per_cpu_ptr(&__pv_tlb_mask, cpu),
+				GFP_KERNEL, cpu_to_node(cpu));
+		}
+		pv_mmu_ops.flush_tlb_others = kvm_flush_tlb_others;
+		pr_info("KVM setup pv remote TLB flush\n");
+	}
+
+	return 0;
+}
+arch_initcall(kvm_setup_pv_tlb_flush);
+
 static void __init kvm_smp_prepare_boot_cpu(void)
 {
 	kvm_guest_cpu_init();
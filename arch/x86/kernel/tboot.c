@@ -101,6 +101,10 @@ void __init tboot_probe(void)
 static pgd_t *tboot_pg_dir;
 static struct mm_struct tboot_mm = {
 	.mm_rb          = RB_ROOT,
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	.mm_seq         = SEQCNT_ZERO(tboot_mm.mm_seq),
+	.mm_rb_lock     = __RW_LOCK_UNLOCKED(tboot_mm.mm_rb_lock),
+#endif
 	.pgd            = swapper_pg_dir,
 	.mm_users       = ATOMIC_INIT(2),
 	.mm_count       = ATOMIC_INIT(1),
@@ -97,6 +97,7 @@ static u64 __read_mostly efer_reserved_bits = ~((u64)EFER_SCE);
 static void update_cr8_intercept(struct kvm_vcpu *vcpu);
 static void process_nmi(struct kvm_vcpu *vcpu);
 static void enter_smm(struct kvm_vcpu *vcpu);
+static void kvm_vcpu_flush_tlb(struct kvm_vcpu *vcpu);
 static void __kvm_set_rflags(struct kvm_vcpu *vcpu, unsigned long rflags);
 
 struct kvm_x86_ops *kvm_x86_ops __read_mostly;
@@ -2065,8 +2066,52 @@ static void kvmclock_reset(struct kvm_vcpu *vcpu)
 	vcpu->arch.pv_time_enabled = false;
 }
 
+/*
+ * Atomically fetch and clear the preempted byte of this vcpu's steal
+ * time area.  Remote vcpus cmpxchg KVM_VCPU_FLUSH_TLB into the byte
+ * instead of sending a flush IPI, so a plain read-modify-write could
+ * lose a flush requested between the read and the write back.  The
+ * byte sits at a 4-byte aligned offset followed only by padding, so
+ * the containing word can be cmpxchg'd against the guest as a whole.
+ */
+static int kvm_steal_time_fetch_and_clear_preempted(struct kvm_vcpu *vcpu,
+						    u8 *preempted)
+{
+	struct gfn_to_hva_cache *ghc = &vcpu->arch.st.stime;
+	int offset = offsetof(struct kvm_steal_time, preempted);
+	u32 __user *uaddr;
+	u32 old, cur;
+
+	BUILD_BUG_ON(offsetof(struct kvm_steal_time, preempted) & 3);
+
+	if (kvm_memslots(vcpu->kvm)->generation != ghc->generation)
+		kvm_gfn_to_hva_cache_init(vcpu->kvm, ghc, ghc->gpa, ghc->len);
+
+	if (unlikely(!ghc->memslot) || kvm_is_error_hva(ghc->hva))
+		return -EFAULT;
+
+	uaddr = (u32 __user *)(ghc->hva + offset);
+	if (__get_user(old, uaddr))
+		return -EFAULT;
+
+	while ((old & 0xff) != 0) {
+		if (user_atomic_cmpxchg_inatomic(&cur, uaddr, old,
+						 old & ~0xffu))
+			return -EFAULT;
+		if (cur == old)
+			break;
+		old = cur;
+	}
+	mark_page_dirty(vcpu->kvm, (ghc->gpa + offset) >> PAGE_SHIFT);
+
+	*preempted = (u8)old;
+	return 0;
+}
+
 static void record_steal_time(struct kvm_vcpu *vcpu)
 {
+	u8 preempted;
+
 	if (!(vcpu->arch.st.msr_val & KVM_MSR_ENABLED))
 		return;
 
@@ -2074,6 +2119,16 @@ static void record_steal_time(struct kvm_vcpu *vcpu)
 		&vcpu->arch.st.steal, sizeof(struct kvm_steal_time))))
 		return;
 
+	if (kvm_steal_time_fetch_and_clear_preempted(vcpu, &preempted))
+		preempted = vcpu->arch.st.steal.preempted;
+
+	/*
+	 * Do any TLB flush requested by other vcpus here, on the
+	 * guest's behalf, instead of making them IPI this vcpu.
+	 */
+	if (preempted & KVM_VCPU_FLUSH_TLB)
+		kvm_vcpu_flush_tlb(vcpu);
+
 	vcpu->arch.st.steal.preempted = 0;
 
 	if (vcpu->arch.st.steal.version & 1)
@@ -2834,7 +2889,7 @@ static void kvm_steal_time_set_preempted(struct kvm_vcpu *vcpu)
 	if (!(vcpu->arch.st.msr_val & KVM_MSR_ENABLED))
 		return;
 
-	vcpu->arch.st.steal.preempted = 1;
+	vcpu->arch.st.steal.preempted = KVM_VCPU_PREEMPTED;
 
 	kvm_write_guest_offset_cached(vcpu->kvm, &vcpu->arch.st.stime,
 			&vcpu->arch.st.steal.preempted,
@@ -5352,9 +5407,9 @@ static bool reexecute_instruction(struct kvm_vcpu *vcpu, gva_t cr2,
 	if (vcpu->arch.mmu.direct_map) {
 		unsigned int indirect_shadow_pages;
 
-		spin_lock(&vcpu->kvm->mmu_lock);
+		write_lock(&vcpu->kvm->mmu_lock);
 		indirect_shadow_pages = vcpu->kvm->arch.indirect_shadow_pages;
-		spin_unlock(&vcpu->kvm->mmu_lock);
+		write_unlock(&vcpu->kvm->mmu_lock);
 
 		if (indirect_shadow_pages)
 			kvm_mmu_unprotect_page(vcpu->kvm, gpa_to_gfn(gpa));
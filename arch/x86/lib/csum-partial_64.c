@@ -8,6 +8,7 @@
 #include <linux/compiler.h>
 #include <linux/export.h>
 #include <asm/checksum.h>
+#include <asm/cpufeature.h>
 
 static inline unsigned short from32to16(unsigned a) 
 {
@@ -29,7 +30,10 @@ static inline unsigned short from32to16(unsigned a)
  * Things tried and found to not make it faster:
  * Manual Prefetching
  * Unrolling to an 128 bytes inner loop.
- * Using interleaving with more registers to break the carry chains.
+ * Using interleaving with more registers to break the carry chains
+ * (without ADX there is only one carry flag, so the interleaved adcs
+ * still serialize; with ADCX/ADOX two chains really do run in
+ * parallel, see the ADX loop below).
  */
 static unsigned do_csum(const unsigned char *buff, unsigned len)
 {
@@ -67,7 +71,53 @@ static unsigned do_csum(const unsigned char *buff, unsigned len)
 			/* main loop using 64byte blocks */
 			zero = 0;
 			count64 = count >> 3;
-			while (count64) { 
+
+			/*
+			 * With ADX two carry chains can run in parallel:
+			 * ADCX only reads/writes CF while ADOX only
+			 * reads/writes OF, so the adds of a 128 byte
+			 * block are no longer serialized on one flag.
+			 */
+			if (static_cpu_has(X86_FEATURE_ADX) &&
+			    count64 >= 2) {
+				unsigned long result2 = 0, tmp;
+
+				do {
+					asm("xorl %k[t],%k[t]\n\t"
+					    "adcxq 0*8(%[src]),%[res]\n\t"
+					    "adoxq 1*8(%[src]),%[res2]\n\t"
+					    "adcxq 2*8(%[src]),%[res]\n\t"
+					    "adoxq 3*8(%[src]),%[res2]\n\t"
+					    "adcxq 4*8(%[src]),%[res]\n\t"
+					    "adoxq 5*8(%[src]),%[res2]\n\t"
+					    "adcxq 6*8(%[src]),%[res]\n\t"
+					    "adoxq 7*8(%[src]),%[res2]\n\t"
+					    "adcxq 8*8(%[src]),%[res]\n\t"
+					    "adoxq 9*8(%[src]),%[res2]\n\t"
+					    "adcxq 10*8(%[src]),%[res]\n\t"
+					    "adoxq 11*8(%[src]),%[res2]\n\t"
+					    "adcxq 12*8(%[src]),%[res]\n\t"
+					    "adoxq 13*8(%[src]),%[res2]\n\t"
+					    "adcxq 14*8(%[src]),%[res]\n\t"
+					    "adoxq 15*8(%[src]),%[res2]\n\t"
+					    "adcxq %[t],%[res]\n\t"
+					    "adoxq %[t],%[res2]"
+					    : [res] "+r" (result),
+					      [res2] "+r" (result2),
+					      [t] "=&r" (tmp)
+					    : [src] "r" (buff));
+					buff += 128;
+					count64 -= 2;
+				} while (count64 >= 2);
+
+				asm("addq %[res2],%[res]\n\t"
+				    "adcq %[zero],%[res]"
+				    : [res] "+r" (result)
+				    : [res2] "r" (result2),
+				      [zero] "r" (zero));
+			}
+
+			while (count64) {
 				asm("addq 0*8(%[src]),%[res]\n\t"
 				    "adcq 1*8(%[src]),%[res]\n\t"
 				    "adcq 2*8(%[src]),%[res]\n\t"
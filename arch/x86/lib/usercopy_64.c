@@ -6,7 +6,11 @@
  * Copyright 2002 Andi Kleen <ak@suse.de>
  */
 #include <linux/export.h>
+#include <linux/init.h>
+#include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <asm/cpufeature.h>
+#include <asm/msr.h>
 
 /*
  * Zero Userspace
@@ -86,3 +90,78 @@ copy_user_handle_tail(char *to, char *from, unsigned len)
 		memset(to, 0, len);
 	return len;
 }
+
+/*
+ * Crossover size at which REP MOVSB starts beating the unrolled copy
+ * loops.  Referenced from copy_user_enhanced_fast_string() and
+ * memcpy_erms(); copies below it are routed to the unrolled variants.
+ * The default matches Intel's guidance; on ERMS machines it is
+ * re-measured at boot below.
+ */
+unsigned long rep_movsb_threshold __read_mostly = 64;
+
+#define REP_MOVSB_BENCH_MAX	4096U
+#define REP_MOVSB_BENCH_LOOPS	32
+
+static u64 __init bench_copy(unsigned long (*fn)(void *, const void *,
+						 unsigned),
+			     void *dst, const void *src, unsigned int len)
+{
+	u64 best = ~0ULL;
+	int i;
+
+	for (i = 0; i < REP_MOVSB_BENCH_LOOPS; i++) {
+		u64 t0, t1;
+
+		t0 = rdtsc_ordered();
+		fn(dst, src, len);
+		t1 = rdtsc_ordered();
+		if (t1 - t0 < best)
+			best = t1 - t0;
+	}
+	return best;
+}
+
+/*
+ * Measure the unrolled copy against REP MOVSB over power-of-two size
+ * classes and install the smallest size where the string copy wins.
+ * The copy_user functions are plain memory copies with fault tables,
+ * so running them on two kernel buffers is fine for timing purposes.
+ */
+static int __init rep_movsb_bench(void)
+{
+	unsigned int size;
+	unsigned long flags;
+	void *src, *dst;
+
+	if (!boot_cpu_has(X86_FEATURE_ERMS))
+		return 0;
+
+	src = kmalloc(REP_MOVSB_BENCH_MAX, GFP_KERNEL);
+	dst = kmalloc(REP_MOVSB_BENCH_MAX, GFP_KERNEL);
+	if (!src || !dst)
+		goto out;
+
+	for (size = 64; size <= REP_MOVSB_BENCH_MAX; size <<= 1) {
+		u64 unrolled, erms;
+
+		local_irq_save(flags);
+		unrolled = bench_copy(copy_user_generic_unrolled,
+				      dst, src, size);
+		erms = bench_copy(copy_user_enhanced_fast_string,
+				  dst, src, size);
+		local_irq_restore(flags);
+
+		if (erms <= unrolled)
+			break;
+	}
+
+	rep_movsb_threshold = min(size, REP_MOVSB_BENCH_MAX);
+	pr_info("x86/copy: rep movsb threshold set to %lu bytes\n",
+		rep_movsb_threshold);
+out:
+	kfree(src);
+	kfree(dst);
+	return 0;
+}
+core_initcall(rep_movsb_bench);
@@ -1316,6 +1316,25 @@ __do_page_fault(struct pt_regs *regs, unsigned long error_code,
 	if (error_code & PF_INSTR)
 		flags |= FAULT_FLAG_INSTRUCTION;
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	/*
+	 * Try to service anonymous write faults without taking mmap_sem.
+	 * handle_speculative_fault() either completes the fault and
+	 * returns 0, or returns VM_FAULT_RETRY and we fall back to the
+	 * regular, lock-taking path below.
+	 */
+	if ((flags & FAULT_FLAG_USER) && (flags & FAULT_FLAG_WRITE)) {
+		fault = handle_speculative_fault(mm, address, flags);
+		if (fault == 0) {
+			tsk->min_flt++;
+			perf_sw_event(PERF_COUNT_SW_PAGE_FAULTS_MIN, 1,
+				      regs, address);
+			check_v8086_mode(regs, address, tsk);
+			return;
+		}
+	}
+#endif
+
 	/*
 	 * When running in the kernel we expect faults to occur only to
 	 * addresses in user space.  All other faults represent errors in
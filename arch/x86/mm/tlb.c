@@ -34,6 +34,9 @@ struct flush_tlb_info {
 	struct mm_struct *flush_mm;
 	unsigned long flush_start;
 	unsigned long flush_end;
+	/* exact addresses to flush; used instead of the range if set */
+	const unsigned long *flush_addrs;
+	unsigned int flush_nr;
 };
 
 /*
@@ -241,6 +244,12 @@ static void flush_tlb_func(void *info)
 		if (f->flush_end == TLB_FLUSH_ALL) {
 			local_flush_tlb();
 			trace_tlb_flush(TLB_REMOTE_SHOOTDOWN, TLB_FLUSH_ALL);
+		} else if (f->flush_addrs) {
+			unsigned int i;
+
+			for (i = 0; i < f->flush_nr; i++)
+				__flush_tlb_single(f->flush_addrs[i]);
+			trace_tlb_flush(TLB_REMOTE_SHOOTDOWN, f->flush_nr);
 		} else {
 			unsigned long addr;
 			unsigned long nr_pages =
@@ -268,6 +277,8 @@ void native_flush_tlb_others(const struct cpumask *cpumask,
 	info.flush_mm = mm;
 	info.flush_start = start;
 	info.flush_end = end;
+	info.flush_addrs = NULL;
+	info.flush_nr = 0;
 
 	count_vm_tlb_event(NR_TLB_REMOTE_FLUSH);
 	if (end == TLB_FLUSH_ALL)
@@ -289,6 +300,28 @@ void native_flush_tlb_others(const struct cpumask *cpumask,
 	smp_call_function_many(cpumask, flush_tlb_func, &info, 1);
 }
 
+/*
+ * Flush an exact set of pages on the other cpus. The number of IPIs is
+ * the same as for a ranged flush, but the receiving cpus only walk the
+ * pages that were actually unmapped instead of the whole span (or the
+ * whole TLB).
+ */
+static void flush_tlb_others_addrs(const struct cpumask *cpumask,
+				   struct mm_struct *mm,
+				   const unsigned long *addrs,
+				   unsigned int nr)
+{
+	struct flush_tlb_info info = {
+		.flush_mm	= mm,
+		.flush_addrs	= addrs,
+		.flush_nr	= nr,
+	};
+
+	count_vm_tlb_event(NR_TLB_REMOTE_FLUSH);
+	trace_tlb_flush(TLB_REMOTE_SEND_IPI, nr);
+	smp_call_function_many(cpumask, flush_tlb_func, &info, 1);
+}
+
 void flush_tlb_current_task(void)
 {
 	struct mm_struct *mm = current->mm;
@@ -371,6 +404,50 @@ out:
 	preempt_enable();
 }
 
+/*
+ * Flush an exact set of pages gathered by the unmap path. This avoids
+ * a full flush when a sparse zap spans a wide range but only touched a
+ * handful of ptes, which is the common case for madvise(MADV_DONTNEED)
+ * heavy workloads. Callers with more than MMU_GATHER_ADDRS pages use
+ * flush_tlb_mm_range() instead.
+ */
+void flush_tlb_mm_addrs(struct mm_struct *mm, const unsigned long *addrs,
+			unsigned int nr)
+{
+	unsigned int i;
+
+	if (!nr)
+		return;
+
+	preempt_disable();
+	if (current->active_mm != mm) {
+		/* Synchronize with switch_mm. */
+		smp_mb();
+
+		goto out;
+	}
+
+	if (!current->mm) {
+		leave_mm(smp_processor_id());
+
+		/* Synchronize with switch_mm. */
+		smp_mb();
+
+		goto out;
+	}
+
+	/* INVLPG is an implicit full barrier that synchronizes with switch_mm. */
+	for (i = 0; i < nr; i++) {
+		count_vm_tlb_event(NR_TLB_LOCAL_FLUSH_ONE);
+		__flush_tlb_single(addrs[i]);
+	}
+	trace_tlb_flush(TLB_LOCAL_MM_SHOOTDOWN, nr);
+out:
+	if (cpumask_any_but(mm_cpumask(mm), smp_processor_id()) < nr_cpu_ids)
+		flush_tlb_others_addrs(mm_cpumask(mm), mm, addrs, nr);
+	preempt_enable();
+}
+
 void flush_tlb_page(struct vm_area_struct *vma, unsigned long start)
 {
 	struct mm_struct *mm = vma->vm_mm;
@@ -80,6 +80,7 @@
  * Flags for mlock
  */
 #define MLOCK_ONFAULT	0x01		/* Lock pages in range after they are faulted in, do not prefault */
+#define MLOCK_ASYNC	0x02		/* Lock pages in range, prefault them from a worker after return */
 
 #define MADV_NORMAL	0		/* no further special treatment */
 #define MADV_RANDOM	1		/* expect random page references */
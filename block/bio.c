@@ -247,6 +247,62 @@ static void __bio_free(struct bio *bio)
 		bio_integrity_free(bio);
 }
 
+#define BIO_ALLOC_CACHE_MAX	64
+
+/*
+ * Try to grab a recently freed bio from the local cpu's cache.  Returns
+ * the slab object (bio minus front pad), like mempool_alloc() would.
+ * Bios may be freed from irq context, so the cache is irq protected.
+ */
+static void *bio_alloc_cache_get(struct bio_set *bs)
+{
+	struct bio_alloc_cache *cache;
+	unsigned long flags;
+	struct bio *bio;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(bs->cache);
+	bio = bio_list_pop(&cache->free_list);
+	if (bio)
+		cache->nr--;
+	local_irq_restore(flags);
+
+	return bio ? (void *)bio - bs->front_pad : NULL;
+}
+
+static bool bio_alloc_cache_put(struct bio_set *bs, struct bio *bio)
+{
+	struct bio_alloc_cache *cache;
+	unsigned long flags;
+	bool cached = false;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(bs->cache);
+	if (cache->nr < BIO_ALLOC_CACHE_MAX) {
+		bio_list_add_head(&cache->free_list, bio);
+		cache->nr++;
+		cached = true;
+	}
+	local_irq_restore(flags);
+
+	return cached;
+}
+
+static void bio_alloc_cache_drain(struct bio_set *bs)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct bio_alloc_cache *cache = per_cpu_ptr(bs->cache, cpu);
+		struct bio *bio;
+
+		while ((bio = bio_list_pop(&cache->free_list)) != NULL)
+			mempool_free((void *)bio - bs->front_pad,
+				     bs->bio_pool);
+		cache->nr = 0;
+	}
+}
+
 static void bio_free(struct bio *bio)
 {
 	struct bio_set *bs = bio->bi_pool;
@@ -255,6 +311,13 @@ static void bio_free(struct bio *bio)
 	__bio_free(bio);
 
 	if (bs) {
+		/*
+		 * Bios on the inline vecs are a single slab object; keep
+		 * them on the local cpu for the next allocation.
+		 */
+		if (!BVEC_POOL_IDX(bio) && bio_alloc_cache_put(bs, bio))
+			return;
+
 		bvec_free(bs->bvec_pool, bio->bi_io_vec, BVEC_POOL_IDX(bio));
 
 		/*
@@ -475,7 +538,11 @@ struct bio *bio_alloc_bioset(gfp_t gfp_mask, int nr_iovecs, struct bio_set *bs)
 		     !bio_list_empty(&current->bio_list[1])))
 			gfp_mask &= ~__GFP_DIRECT_RECLAIM;
 
-		p = mempool_alloc(bs->bio_pool, gfp_mask);
+		p = NULL;
+		if (nr_iovecs <= BIO_INLINE_VECS)
+			p = bio_alloc_cache_get(bs);
+		if (!p)
+			p = mempool_alloc(bs->bio_pool, gfp_mask);
 		if (!p && gfp_mask != saved_gfp) {
 			punt_bios_to_rescuer(bs);
 			gfp_mask = saved_gfp;
@@ -1740,7 +1807,7 @@ void generic_start_io_acct(int rw, unsigned long sectors,
 	part_round_stats(cpu, part);
 	part_stat_inc(cpu, part, ios[rw]);
 	part_stat_add(cpu, part, sectors[rw], sectors);
-	part_inc_in_flight(part, rw);
+	part_inc_in_flight(cpu, part, rw);
 
 	part_stat_unlock();
 }
@@ -1754,7 +1821,7 @@ void generic_end_io_acct(int rw, struct hd_struct *part,
 
 	part_stat_add(cpu, part, ticks[rw], duration);
 	part_round_stats(cpu, part);
-	part_dec_in_flight(part, rw);
+	part_dec_in_flight(cpu, part, rw);
 
 	part_stat_unlock();
 }
@@ -1901,6 +1968,11 @@ void bioset_free(struct bio_set *bs)
 	if (bs->rescue_workqueue)
 		destroy_workqueue(bs->rescue_workqueue);
 
+	if (bs->cache) {
+		bio_alloc_cache_drain(bs);
+		free_percpu(bs->cache);
+	}
+
 	if (bs->bio_pool)
 		mempool_destroy(bs->bio_pool);
 
@@ -1937,6 +2009,10 @@ static struct bio_set *__bioset_create(unsigned int pool_size,
 		return NULL;
 	}
 
+	bs->cache = alloc_percpu(struct bio_alloc_cache);
+	if (!bs->cache)
+		goto bad;
+
 	bs->bio_pool = mempool_create_slab_pool(pool_size, bs->bio_slab);
 	if (!bs->bio_pool)
 		goto bad;
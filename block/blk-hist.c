@@ -0,0 +1,273 @@
+/*
+ * Block IO completion latency histograms
+ *
+ * Cheap enough to stay on: completions bump a per-CPU bucket counter,
+ * and the counters are only folded together when somebody reads them.
+ * Two consumers share the accounting hook:
+ *
+ *  - per-cgroup histograms, published through the blkcg files
+ *    "lat.histogram" on both hierarchies.  Bios that carry a cgroup
+ *    association (bi_css) are charged to that cgroup; legacy requests
+ *    are charged through their request_list's blkg; everything else is
+ *    charged to the root cgroup.
+ *
+ *  - per-queue percentile tracking, flipped on through the queue
+ *    "lat_hist" sysfs attribute during incidents.  This side is guarded
+ *    by a static key so the completion path costs nothing while no
+ *    queue has it enabled.
+ *
+ * Samples piggyback on the blk-stat issue timestamps, so a queue only
+ * feeds the histograms while QUEUE_FLAG_STATS is set (wbt and polling
+ * enable it; so does turning on per-queue tracking here).
+ */
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/blk-cgroup.h>
+#include <linux/percpu.h>
+
+#include "blk.h"
+#include "blk-hist.h"
+
+static DEFINE_STATIC_KEY_FALSE(blk_hist_queue_enabled);
+
+#ifdef CONFIG_BLK_CGROUP
+
+static struct blkcg_policy blkcg_policy_hist;
+
+struct blk_hist_cgd {
+	struct blkcg_policy_data cpd;
+	struct blk_hist __percpu *cpu_hist;
+};
+
+static struct blk_hist_cgd *blkcg_to_hist_cgd(struct blkcg *blkcg)
+{
+	struct blkcg_policy_data *cpd = blkcg_to_cpd(blkcg, &blkcg_policy_hist);
+
+	return cpd ? container_of(cpd, struct blk_hist_cgd, cpd) : NULL;
+}
+
+/*
+ * Map a completing request back to the blkcg that issued it.  Called
+ * under rcu_read_lock(); on the mq path rq->bio is still attached and
+ * pins its bi_css, on the legacy path the request_list pins its blkg.
+ */
+static struct blkcg *blk_hist_rq_blkcg(struct request *rq)
+{
+	if (rq->bio && rq->bio->bi_css)
+		return css_to_blkcg(rq->bio->bi_css);
+	if (rq->rl && rq->rl->blkg)
+		return rq->rl->blkg->blkcg;
+	return &blkcg_root;
+}
+
+static void blk_hist_cg_add(struct request *rq, int bucket)
+{
+	struct blk_hist_cgd *cgd;
+
+	cgd = blkcg_to_hist_cgd(blk_hist_rq_blkcg(rq));
+	if (cgd)
+		this_cpu_inc(cgd->cpu_hist->count[bucket]);
+}
+
+#else /* CONFIG_BLK_CGROUP */
+
+static inline void blk_hist_cg_add(struct request *rq, int bucket)
+{
+}
+
+#endif /* CONFIG_BLK_CGROUP */
+
+void blk_hist_rq_done(struct request *rq, s64 now)
+{
+	u64 value;
+	int bucket;
+
+	if (!now)
+		now = ktime_to_ns(ktime_get());
+	now = __blk_stat_time(now);
+	if (now < blk_stat_time(&rq->issue_stat))
+		return;
+
+	value = now - blk_stat_time(&rq->issue_stat);
+	bucket = blk_hist_bucket(value);
+
+	rcu_read_lock();
+
+	if (static_branch_unlikely(&blk_hist_queue_enabled)) {
+		struct blk_hist __percpu *h = READ_ONCE(rq->q->lat_hist);
+
+		if (h)
+			this_cpu_inc(h->count[bucket]);
+	}
+
+	blk_hist_cg_add(rq, bucket);
+
+	rcu_read_unlock();
+}
+
+static void blk_hist_fold(struct blk_hist __percpu *cpu_hist,
+			  struct blk_hist *dst)
+{
+	int cpu, b;
+
+	memset(dst, 0, sizeof(*dst));
+	for_each_possible_cpu(cpu) {
+		struct blk_hist *h = per_cpu_ptr(cpu_hist, cpu);
+
+		for (b = 0; b < BLK_HIST_BUCKETS; b++)
+			dst->count[b] += READ_ONCE(h->count[b]);
+	}
+}
+
+/*
+ * Per-queue percentile tracking, toggled from blk-sysfs.c.
+ */
+int blk_hist_queue_enable(struct request_queue *q)
+{
+	struct blk_hist __percpu *h;
+
+	if (q->lat_hist)
+		return 0;
+
+	h = alloc_percpu(struct blk_hist);
+	if (!h)
+		return -ENOMEM;
+
+	WRITE_ONCE(q->lat_hist, h);
+	static_branch_inc(&blk_hist_queue_enabled);
+	blk_stat_enable(q);
+	return 0;
+}
+
+void blk_hist_queue_disable(struct request_queue *q)
+{
+	struct blk_hist __percpu *h = q->lat_hist;
+
+	if (!h)
+		return;
+
+	WRITE_ONCE(q->lat_hist, NULL);
+	static_branch_dec(&blk_hist_queue_enabled);
+	/* completions read lat_hist under rcu_read_lock() */
+	synchronize_rcu();
+	free_percpu(h);
+}
+
+void blk_hist_queue_exit(struct request_queue *q)
+{
+	blk_hist_queue_disable(q);
+}
+
+static u64 blk_hist_percentile(struct blk_hist *hist, u64 total, int pctl)
+{
+	u64 thresh = div64_u64(total * pctl + 99, 100);
+	u64 seen = 0;
+	int b;
+
+	for (b = 0; b < BLK_HIST_BUCKETS; b++) {
+		seen += hist->count[b];
+		if (seen >= thresh)
+			break;
+	}
+	return blk_hist_bucket_nsecs(min(b, BLK_HIST_BUCKETS - 1));
+}
+
+ssize_t blk_hist_queue_show(struct request_queue *q, char *page)
+{
+	struct blk_hist hist;
+	u64 total = 0;
+	int b;
+
+	if (!q->lat_hist)
+		return sprintf(page, "disabled\n");
+
+	blk_hist_fold(q->lat_hist, &hist);
+	for (b = 0; b < BLK_HIST_BUCKETS; b++)
+		total += hist.count[b];
+
+	if (!total)
+		return sprintf(page, "samples=0\n");
+
+	return sprintf(page, "samples=%llu p50=%llu p90=%llu p99=%llu\n",
+		       (unsigned long long)total,
+		       div64_u64(blk_hist_percentile(&hist, total, 50), 1000),
+		       div64_u64(blk_hist_percentile(&hist, total, 90), 1000),
+		       div64_u64(blk_hist_percentile(&hist, total, 99), 1000));
+}
+
+#ifdef CONFIG_BLK_CGROUP
+
+static struct blkcg_policy_data *hist_cpd_alloc(gfp_t gfp)
+{
+	struct blk_hist_cgd *cgd;
+
+	cgd = kzalloc(sizeof(*cgd), gfp);
+	if (!cgd)
+		return NULL;
+	cgd->cpu_hist = alloc_percpu_gfp(struct blk_hist, gfp);
+	if (!cgd->cpu_hist) {
+		kfree(cgd);
+		return NULL;
+	}
+	return &cgd->cpd;
+}
+
+static void hist_cpd_free(struct blkcg_policy_data *cpd)
+{
+	struct blk_hist_cgd *cgd = container_of(cpd, struct blk_hist_cgd, cpd);
+
+	free_percpu(cgd->cpu_hist);
+	kfree(cgd);
+}
+
+static int hist_cg_print(struct seq_file *sf, void *v)
+{
+	struct blk_hist_cgd *cgd;
+	struct blk_hist hist;
+	int b;
+
+	cgd = blkcg_to_hist_cgd(css_to_blkcg(seq_css(sf)));
+	if (!cgd)
+		return 0;
+
+	blk_hist_fold(cgd->cpu_hist, &hist);
+	for (b = 0; b < BLK_HIST_BUCKETS - 1; b++)
+		seq_printf(sf, "%llu %llu\n",
+			   div64_u64(blk_hist_bucket_nsecs(b), 1000),
+			   (unsigned long long)hist.count[b]);
+	seq_printf(sf, "inf %llu\n",
+		   (unsigned long long)hist.count[BLK_HIST_BUCKETS - 1]);
+	return 0;
+}
+
+static struct cftype hist_blkcg_legacy_files[] = {
+	{
+		.name = "lat.histogram",
+		.seq_show = hist_cg_print,
+	},
+	{ }	/* terminate */
+};
+
+static struct cftype hist_blkcg_files[] = {
+	{
+		.name = "lat.histogram",
+		.seq_show = hist_cg_print,
+	},
+	{ }	/* terminate */
+};
+
+static struct blkcg_policy blkcg_policy_hist = {
+	.dfl_cftypes		= hist_blkcg_files,
+	.legacy_cftypes		= hist_blkcg_legacy_files,
+
+	.cpd_alloc_fn		= hist_cpd_alloc,
+	.cpd_free_fn		= hist_cpd_free,
+};
+
+static int __init blk_hist_init(void)
+{
+	return blkcg_policy_register(&blkcg_policy_hist);
+}
+module_init(blk_hist_init);
+
+#endif /* CONFIG_BLK_CGROUP */
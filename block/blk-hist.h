@@ -0,0 +1,38 @@
+#ifndef BLK_HIST_H
+#define BLK_HIST_H
+
+#include <linux/blkdev.h>
+
+#include "blk-stat.h"
+
+/*
+ * Power-of-two latency buckets.  Bucket 0 holds completions under 256ns,
+ * each following bucket doubles the upper bound, and the last bucket is
+ * open-ended at ~4.3 seconds.
+ */
+#define BLK_HIST_BUCKETS	26
+#define BLK_HIST_BUCKET_SHIFT	8
+
+struct blk_hist {
+	u64 count[BLK_HIST_BUCKETS];
+};
+
+static inline int blk_hist_bucket(u64 nsecs)
+{
+	return min_t(int, fls64(nsecs >> BLK_HIST_BUCKET_SHIFT),
+		     BLK_HIST_BUCKETS - 1);
+}
+
+/* upper bound of @bucket, in nsecs; the last bucket is open-ended */
+static inline u64 blk_hist_bucket_nsecs(int bucket)
+{
+	return 1ULL << (bucket + BLK_HIST_BUCKET_SHIFT);
+}
+
+void blk_hist_rq_done(struct request *rq, s64 now);
+int blk_hist_queue_enable(struct request_queue *q);
+void blk_hist_queue_disable(struct request_queue *q);
+void blk_hist_queue_exit(struct request_queue *q);
+ssize_t blk_hist_queue_show(struct request_queue *q, char *page);
+
+#endif
@@ -5,9 +5,12 @@
 #include <linux/module.h>
 #include <linux/bio.h>
 #include <linux/blkdev.h>
+#include <linux/rbtree.h>
 #include <linux/scatterlist.h>
 
 #include "blk.h"
+#include "blk-stat.h"
+#include "blk-wbt.h"
 
 static struct bio *next_bio(struct bio *bio, unsigned int nr_pages,
 		gfp_t gfp)
@@ -136,6 +139,227 @@ int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 }
 EXPORT_SYMBOL(blkdev_issue_discard);
 
+/*
+ * Async discard manager.  Ranges queued by blkdev_issue_discard_async()
+ * land in a per-queue rbtree where adjacent and overlapping ranges are
+ * coalesced, and a worker drains them one range at a time.  The worker
+ * backs off while foreground reads are running above the queue's
+ * writeback throttling latency target, so a burst of deallocations
+ * doesn't stack device GC on top of latency-sensitive I/O.
+ */
+struct blk_discard_range {
+	struct rb_node		node;
+	struct block_device	*bdev;
+	sector_t		sector;
+	sector_t		nr_sects;
+};
+
+static DEFINE_MUTEX(blk_discard_ctx_mutex);
+
+static bool blk_discard_throttled(struct request_queue *q)
+{
+	struct blk_rq_stat stat[2];
+
+	if (!q->rq_wb || !q->rq_wb->min_lat_nsec)
+		return false;
+
+	blk_queue_stat_get(q, stat);
+	return stat[BLK_STAT_READ].nr_samples &&
+	       stat[BLK_STAT_READ].mean > q->rq_wb->min_lat_nsec;
+}
+
+static void blk_discard_work(struct work_struct *work)
+{
+	struct blk_discard_ctx *ctx =
+		container_of(work, struct blk_discard_ctx, work.work);
+	struct blk_discard_range *r;
+	struct rb_node *n;
+
+	for (;;) {
+		if (blk_discard_throttled(ctx->q)) {
+			queue_delayed_work(system_unbound_wq, &ctx->work,
+					   msecs_to_jiffies(10));
+			return;
+		}
+
+		spin_lock_irq(&ctx->lock);
+		n = rb_first(&ctx->root);
+		if (!n) {
+			spin_unlock_irq(&ctx->lock);
+			return;
+		}
+		r = rb_entry(n, struct blk_discard_range, node);
+		rb_erase(n, &ctx->root);
+		ctx->backlog_sects -= r->nr_sects;
+		ctx->backlog_ranges--;
+		spin_unlock_irq(&ctx->lock);
+
+		blkdev_issue_discard(r->bdev, r->sector, r->nr_sects,
+				     GFP_NOIO, 0);
+		bdput(r->bdev);
+		kfree(r);
+		cond_resched();
+	}
+}
+
+static struct blk_discard_ctx *blk_discard_ctx_get(struct request_queue *q)
+{
+	struct blk_discard_ctx *ctx = READ_ONCE(q->discard_ctx);
+
+	if (ctx)
+		return ctx;
+
+	mutex_lock(&blk_discard_ctx_mutex);
+	ctx = q->discard_ctx;
+	if (!ctx) {
+		ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+		if (ctx) {
+			ctx->q = q;
+			spin_lock_init(&ctx->lock);
+			ctx->root = RB_ROOT;
+			INIT_DELAYED_WORK(&ctx->work, blk_discard_work);
+			smp_store_release(&q->discard_ctx, ctx);
+		}
+	}
+	mutex_unlock(&blk_discard_ctx_mutex);
+
+	return ctx;
+}
+
+/*
+ * Fold @r into its neighbors where they touch or overlap.  Caller holds
+ * ctx->lock.  Ranges for different block devices never merge; they only
+ * share the tree, ordered by (bdev, sector).
+ */
+static void blk_discard_coalesce(struct blk_discard_ctx *ctx,
+				 struct blk_discard_range *r)
+{
+	struct blk_discard_range *n;
+	struct rb_node *node;
+	sector_t end;
+
+	node = rb_prev(&r->node);
+	if (node) {
+		n = rb_entry(node, struct blk_discard_range, node);
+		if (n->bdev == r->bdev &&
+		    n->sector + n->nr_sects >= r->sector) {
+			end = max(n->sector + n->nr_sects,
+				  r->sector + r->nr_sects);
+			ctx->backlog_sects -= n->nr_sects + r->nr_sects;
+			n->nr_sects = end - n->sector;
+			ctx->backlog_sects += n->nr_sects;
+			ctx->backlog_ranges--;
+			rb_erase(&r->node, &ctx->root);
+			bdput(r->bdev);
+			kfree(r);
+			r = n;
+		}
+	}
+
+	while ((node = rb_next(&r->node)) != NULL) {
+		n = rb_entry(node, struct blk_discard_range, node);
+		if (n->bdev != r->bdev ||
+		    r->sector + r->nr_sects < n->sector)
+			break;
+		end = max(n->sector + n->nr_sects, r->sector + r->nr_sects);
+		ctx->backlog_sects -= n->nr_sects + r->nr_sects;
+		r->nr_sects = end - r->sector;
+		ctx->backlog_sects += r->nr_sects;
+		ctx->backlog_ranges--;
+		rb_erase(&n->node, &ctx->root);
+		bdput(n->bdev);
+		kfree(n);
+	}
+}
+
+/**
+ * blkdev_issue_discard_async - queue a discard for background issue
+ * @bdev:	blockdev to issue discard for
+ * @sector:	start sector
+ * @nr_sects:	number of sectors to discard
+ * @gfp_mask:	memory allocation flags (for the range descriptor)
+ *
+ * Description:
+ *    Queue a discard of the sectors in question and return immediately.
+ *    The range is merged with any pending adjacent ranges and issued by
+ *    a worker that yields to latency-sensitive foreground I/O.  Falls
+ *    back to synchronous issue if the descriptor can't be allocated.
+ */
+int blkdev_issue_discard_async(struct block_device *bdev, sector_t sector,
+			       sector_t nr_sects, gfp_t gfp_mask)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	struct blk_discard_ctx *ctx;
+	struct blk_discard_range *r;
+	struct rb_node **p, *parent = NULL;
+
+	if (!q)
+		return -ENXIO;
+	if (!blk_queue_discard(q))
+		return -EOPNOTSUPP;
+	if (!nr_sects)
+		return 0;
+
+	ctx = blk_discard_ctx_get(q);
+	if (ctx)
+		r = kmalloc(sizeof(*r), gfp_mask);
+	else
+		r = NULL;
+	if (!r)
+		return blkdev_issue_discard(bdev, sector, nr_sects,
+					    gfp_mask, 0);
+
+	r->bdev = bdgrab(bdev);
+	r->sector = sector;
+	r->nr_sects = nr_sects;
+
+	spin_lock_irq(&ctx->lock);
+	p = &ctx->root.rb_node;
+	while (*p) {
+		struct blk_discard_range *cur;
+
+		parent = *p;
+		cur = rb_entry(parent, struct blk_discard_range, node);
+		if (bdev < cur->bdev ||
+		    (bdev == cur->bdev && sector < cur->sector))
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&r->node, parent, p);
+	rb_insert_color(&r->node, &ctx->root);
+	ctx->backlog_sects += nr_sects;
+	ctx->backlog_ranges++;
+	blk_discard_coalesce(ctx, r);
+	spin_unlock_irq(&ctx->lock);
+
+	queue_delayed_work(system_unbound_wq, &ctx->work, 0);
+	return 0;
+}
+EXPORT_SYMBOL(blkdev_issue_discard_async);
+
+void blk_discard_exit(struct request_queue *q)
+{
+	struct blk_discard_ctx *ctx = q->discard_ctx;
+	struct blk_discard_range *r;
+	struct rb_node *n;
+
+	if (!ctx)
+		return;
+
+	cancel_delayed_work_sync(&ctx->work);
+
+	/* discards are advisory; abandon whatever is still queued */
+	while ((n = rb_first(&ctx->root)) != NULL) {
+		r = rb_entry(n, struct blk_discard_range, node);
+		rb_erase(n, &ctx->root);
+		bdput(r->bdev);
+		kfree(r);
+	}
+	q->discard_ctx = NULL;
+	kfree(ctx);
+}
+
 /**
  * __blkdev_issue_write_same - generate number of bios with same page
  * @bdev:	target blockdev
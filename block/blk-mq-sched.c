@@ -0,0 +1,452 @@
+/*
+ * Scheduling framework for multiqueue devices, with a deadline-style
+ * default scheduler supporting per-cgroup weights.
+ *
+ * Without this, blk-mq dispatches strictly FIFO per software queue,
+ * so on fast devices one tenant's streaming scan can starve another
+ * tenant's point reads.  The default scheduler here keeps per-cgroup
+ * FIFOs per direction, serves the cgroups in a weighted round robin,
+ * and falls back to FIFO expiration so no request waits longer than
+ * its deadline regardless of weights - the same backstop the legacy
+ * deadline scheduler provides.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include <linux/hashtable.h>
+#include <linux/blk-cgroup.h>
+#include <linux/slab.h>
+
+#include "blk.h"
+#include "blk-mq.h"
+#include "blk-mq-sched.h"
+
+/* fifo expiry and write starvation limits, as in deadline-iosched */
+static const int mqd_read_expire = HZ / 2;
+static const int mqd_write_expire = 5 * HZ;
+static const int mqd_writes_starved = 2;
+static const int mqd_dispatch_batch = 16;
+
+/* cgroup weights, same range as the legacy io controller */
+#define MQD_WEIGHT_MIN		1
+#define MQD_WEIGHT_DFL		100
+#define MQD_WEIGHT_MAX		1000
+
+/*
+ * Per-cgroup queue on one hardware queue.  Lives on mqd->active in
+ * round robin order while it has requests queued.
+ */
+struct mqd_cgq {
+	struct hlist_node hnode;	/* mqd->cgqs */
+	struct list_head node;		/* mqd->active while it has work */
+	struct list_head fifo[2];	/* request FIFOs, deadline order */
+	unsigned int credit;		/* dispatches left this round */
+	struct blkcg *blkcg;		/* NULL for the root queue */
+};
+
+struct mqd_data {
+	spinlock_t lock;
+	struct list_head active;	/* cgqs with queued work */
+	struct list_head urgent;	/* flush and non-fs requests */
+	DECLARE_HASHTABLE(cgqs, 4);
+	struct mqd_cgq root;
+	unsigned int starved;		/* reads since last write */
+	unsigned int nr_queued[2];
+};
+
+#ifdef CONFIG_BLK_CGROUP
+
+struct mqd_cgd {
+	struct blkcg_policy_data cpd;
+	unsigned int weight;
+};
+
+static struct blkcg_policy blkcg_policy_mqd;
+
+static struct mqd_cgd *blkcg_to_mqd_cgd(struct blkcg *blkcg)
+{
+	struct blkcg_policy_data *cpd = blkcg_to_cpd(blkcg, &blkcg_policy_mqd);
+
+	return cpd ? container_of(cpd, struct mqd_cgd, cpd) : NULL;
+}
+
+static unsigned int mqd_cgq_weight(struct mqd_cgq *cgq)
+{
+	struct mqd_cgd *cgd;
+
+	if (!cgq->blkcg)
+		return MQD_WEIGHT_DFL;
+	cgd = blkcg_to_mqd_cgd(cgq->blkcg);
+	return cgd ? cgd->weight : MQD_WEIGHT_DFL;
+}
+
+#else /* CONFIG_BLK_CGROUP */
+
+static unsigned int mqd_cgq_weight(struct mqd_cgq *cgq)
+{
+	return MQD_WEIGHT_DFL;
+}
+
+#endif /* CONFIG_BLK_CGROUP */
+
+/*
+ * Dispatches a cgroup may make before yielding to the next one in
+ * round robin order.  Default weight gives a batch of four.
+ */
+static unsigned int mqd_cgq_credit(struct mqd_cgq *cgq)
+{
+	return max_t(unsigned int, mqd_cgq_weight(cgq) / 25, 1);
+}
+
+static void mqd_cgq_init(struct mqd_cgq *cgq)
+{
+	INIT_HLIST_NODE(&cgq->hnode);
+	INIT_LIST_HEAD(&cgq->node);
+	INIT_LIST_HEAD(&cgq->fifo[READ]);
+	INIT_LIST_HEAD(&cgq->fifo[WRITE]);
+}
+
+static bool mqd_cgq_empty(struct mqd_cgq *cgq)
+{
+	return list_empty(&cgq->fifo[READ]) && list_empty(&cgq->fifo[WRITE]);
+}
+
+static struct mqd_cgq *mqd_cgq_lookup(struct mqd_data *mqd,
+				      struct request *rq)
+{
+#ifdef CONFIG_BLK_CGROUP
+	struct blkcg *blkcg = rq->bio ? bio_blkcg(rq->bio) : NULL;
+	struct mqd_cgq *cgq;
+
+	if (!blkcg || blkcg == &blkcg_root)
+		return &mqd->root;
+
+	hash_for_each_possible(mqd->cgqs, cgq, hnode, (unsigned long)blkcg)
+		if (cgq->blkcg == blkcg)
+			return cgq;
+
+	cgq = kzalloc(sizeof(*cgq), GFP_ATOMIC);
+	if (!cgq)
+		return &mqd->root;
+
+	mqd_cgq_init(cgq);
+	css_get(&blkcg->css);
+	cgq->blkcg = blkcg;
+	hash_add(mqd->cgqs, &cgq->hnode, (unsigned long)blkcg);
+	return cgq;
+#else
+	return &mqd->root;
+#endif
+}
+
+static void mqd_insert(struct blk_mq_hw_ctx *hctx, struct request *rq)
+{
+	struct mqd_data *mqd = hctx->sched_data;
+	const int data_dir = rq_data_dir(rq);
+	struct mqd_cgq *cgq;
+
+	spin_lock(&mqd->lock);
+
+	/*
+	 * Flush machinery and non-fs requests have ordering and latency
+	 * requirements of their own; pass them straight through.
+	 */
+	if (rq->cmd_type != REQ_TYPE_FS || req_op(rq) == REQ_OP_FLUSH ||
+	    (rq->cmd_flags & (REQ_PREFLUSH | REQ_FUA))) {
+		list_add_tail(&rq->queuelist, &mqd->urgent);
+		goto unlock;
+	}
+
+	cgq = mqd_cgq_lookup(mqd, rq);
+
+	rq->fifo_time = jiffies + (data_dir == READ ? mqd_read_expire :
+						      mqd_write_expire);
+	list_add_tail(&rq->queuelist, &cgq->fifo[data_dir]);
+	mqd->nr_queued[data_dir]++;
+
+	if (list_empty(&cgq->node)) {
+		cgq->credit = mqd_cgq_credit(cgq);
+		list_add_tail(&cgq->node, &mqd->active);
+	}
+unlock:
+	spin_unlock(&mqd->lock);
+}
+
+static struct request *mqd_pop(struct mqd_data *mqd, struct mqd_cgq *cgq,
+			       int data_dir)
+{
+	struct request *rq;
+
+	rq = list_first_entry(&cgq->fifo[data_dir], struct request,
+			      queuelist);
+	list_del_init(&rq->queuelist);
+	mqd->nr_queued[data_dir]--;
+
+	if (data_dir == WRITE)
+		mqd->starved = 0;
+	else if (mqd->nr_queued[WRITE])
+		mqd->starved++;
+
+	/* round over: go to the back of the line with fresh credit */
+	if (!--cgq->credit || mqd_cgq_empty(cgq)) {
+		list_del_init(&cgq->node);
+		if (!mqd_cgq_empty(cgq)) {
+			cgq->credit = mqd_cgq_credit(cgq);
+			list_add_tail(&cgq->node, &mqd->active);
+		}
+	}
+
+	return rq;
+}
+
+static struct request *mqd_next_rq(struct mqd_data *mqd)
+{
+	struct mqd_cgq *cgq, *expired_cgq = NULL;
+	struct request *rq;
+	int data_dir, expired_dir = READ;
+	unsigned long oldest = 0;
+
+	if (!list_empty(&mqd->urgent)) {
+		rq = list_first_entry(&mqd->urgent, struct request,
+				      queuelist);
+		list_del_init(&rq->queuelist);
+		return rq;
+	}
+
+	if (list_empty(&mqd->active))
+		return NULL;
+
+	/*
+	 * Expired requests trump the weighted round robin; serve the
+	 * oldest one first.  Only FIFO heads can be the oldest.
+	 */
+	list_for_each_entry(cgq, &mqd->active, node) {
+		for (data_dir = READ; data_dir <= WRITE; data_dir++) {
+			if (list_empty(&cgq->fifo[data_dir]))
+				continue;
+			rq = list_first_entry(&cgq->fifo[data_dir],
+					      struct request, queuelist);
+			if (!time_after_eq(jiffies,
+					   (unsigned long)rq->fifo_time))
+				continue;
+			if (!expired_cgq ||
+			    time_before((unsigned long)rq->fifo_time,
+					oldest)) {
+				expired_cgq = cgq;
+				expired_dir = data_dir;
+				oldest = rq->fifo_time;
+			}
+		}
+	}
+	if (expired_cgq)
+		return mqd_pop(mqd, expired_cgq, expired_dir);
+
+	/* batch to writes once reads have starved them long enough */
+	if (mqd->nr_queued[WRITE] && mqd->starved >= mqd_writes_starved) {
+		list_for_each_entry(cgq, &mqd->active, node)
+			if (!list_empty(&cgq->fifo[WRITE]))
+				return mqd_pop(mqd, cgq, WRITE);
+	}
+
+	cgq = list_first_entry(&mqd->active, struct mqd_cgq, node);
+	data_dir = list_empty(&cgq->fifo[READ]) ? WRITE : READ;
+	return mqd_pop(mqd, cgq, data_dir);
+}
+
+static void mqd_dispatch(struct blk_mq_hw_ctx *hctx, struct list_head *list)
+{
+	struct mqd_data *mqd = hctx->sched_data;
+	int count;
+
+	spin_lock(&mqd->lock);
+	for (count = 0; count < mqd_dispatch_batch; count++) {
+		struct request *rq = mqd_next_rq(mqd);
+
+		if (!rq)
+			break;
+		list_add_tail(&rq->queuelist, list);
+	}
+	spin_unlock(&mqd->lock);
+}
+
+static bool mqd_has_work(struct blk_mq_hw_ctx *hctx)
+{
+	struct mqd_data *mqd = hctx->sched_data;
+
+	return !list_empty_careful(&mqd->active) ||
+	       !list_empty_careful(&mqd->urgent);
+}
+
+static int mqd_init_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	struct mqd_data *mqd;
+
+	mqd = kzalloc_node(sizeof(*mqd), GFP_KERNEL, hctx->numa_node);
+	if (!mqd)
+		return -ENOMEM;
+
+	spin_lock_init(&mqd->lock);
+	INIT_LIST_HEAD(&mqd->active);
+	INIT_LIST_HEAD(&mqd->urgent);
+	hash_init(mqd->cgqs);
+	mqd_cgq_init(&mqd->root);
+
+	hctx->sched_data = mqd;
+	return 0;
+}
+
+static void mqd_exit_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	struct mqd_data *mqd = hctx->sched_data;
+#ifdef CONFIG_BLK_CGROUP
+	struct mqd_cgq *cgq;
+	struct hlist_node *tmp;
+	int i;
+#endif
+
+	WARN_ON(!list_empty(&mqd->active));
+	WARN_ON(!list_empty(&mqd->urgent));
+
+#ifdef CONFIG_BLK_CGROUP
+	hash_for_each_safe(mqd->cgqs, i, tmp, cgq, hnode) {
+		hash_del(&cgq->hnode);
+		css_put(&cgq->blkcg->css);
+		kfree(cgq);
+	}
+#endif
+	hctx->sched_data = NULL;
+	kfree(mqd);
+}
+
+static const struct blk_mq_sched_ops mq_deadline_sched_ops = {
+	.name		= "mq-deadline",
+	.init_hctx	= mqd_init_hctx,
+	.exit_hctx	= mqd_exit_hctx,
+	.insert		= mqd_insert,
+	.dispatch	= mqd_dispatch,
+	.has_work	= mqd_has_work,
+};
+
+int blk_mq_sched_init_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	int ret;
+
+	hctx->sched_ops = &mq_deadline_sched_ops;
+	ret = hctx->sched_ops->init_hctx(hctx);
+	if (ret)
+		hctx->sched_ops = NULL;
+	return ret;
+}
+
+void blk_mq_sched_exit_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	if (hctx->sched_ops) {
+		hctx->sched_ops->exit_hctx(hctx);
+		hctx->sched_ops = NULL;
+	}
+}
+
+void blk_mq_sched_insert_list(struct blk_mq_hw_ctx *hctx,
+			      struct list_head *list)
+{
+	while (!list_empty(list)) {
+		struct request *rq;
+
+		rq = list_first_entry(list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		hctx->sched_ops->insert(hctx, rq);
+	}
+}
+
+void blk_mq_sched_dispatch(struct blk_mq_hw_ctx *hctx,
+			   struct list_head *list)
+{
+	hctx->sched_ops->dispatch(hctx, list);
+}
+
+bool blk_mq_sched_has_work(struct blk_mq_hw_ctx *hctx)
+{
+	return hctx->sched_ops && hctx->sched_ops->has_work(hctx);
+}
+
+#ifdef CONFIG_BLK_CGROUP
+
+static struct blkcg_policy_data *mqd_cpd_alloc(gfp_t gfp)
+{
+	struct mqd_cgd *cgd;
+
+	cgd = kzalloc(sizeof(*cgd), gfp);
+	if (!cgd)
+		return NULL;
+	return &cgd->cpd;
+}
+
+static void mqd_cpd_init(struct blkcg_policy_data *cpd)
+{
+	container_of(cpd, struct mqd_cgd, cpd)->weight = MQD_WEIGHT_DFL;
+}
+
+static void mqd_cpd_free(struct blkcg_policy_data *cpd)
+{
+	kfree(container_of(cpd, struct mqd_cgd, cpd));
+}
+
+static int mqd_print_weight(struct seq_file *sf, void *v)
+{
+	struct mqd_cgd *cgd = blkcg_to_mqd_cgd(css_to_blkcg(seq_css(sf)));
+
+	seq_printf(sf, "%u\n", cgd ? cgd->weight : 0);
+	return 0;
+}
+
+static int mqd_set_weight(struct cgroup_subsys_state *css,
+			  struct cftype *cft, u64 val)
+{
+	struct mqd_cgd *cgd = blkcg_to_mqd_cgd(css_to_blkcg(css));
+
+	if (val < MQD_WEIGHT_MIN || val > MQD_WEIGHT_MAX)
+		return -ERANGE;
+	if (!cgd)
+		return -EINVAL;
+
+	cgd->weight = val;
+	return 0;
+}
+
+static struct cftype mqd_blkcg_legacy_files[] = {
+	{
+		.name = "mq_sched.weight",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = mqd_print_weight,
+		.write_u64 = mqd_set_weight,
+	},
+	{ }	/* terminate */
+};
+
+static struct cftype mqd_blkcg_files[] = {
+	{
+		.name = "mq_sched.weight",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = mqd_print_weight,
+		.write_u64 = mqd_set_weight,
+	},
+	{ }	/* terminate */
+};
+
+static struct blkcg_policy blkcg_policy_mqd = {
+	.dfl_cftypes		= mqd_blkcg_files,
+	.legacy_cftypes		= mqd_blkcg_legacy_files,
+
+	.cpd_alloc_fn		= mqd_cpd_alloc,
+	.cpd_init_fn		= mqd_cpd_init,
+	.cpd_free_fn		= mqd_cpd_free,
+};
+
+static int __init mqd_init(void)
+{
+	return blkcg_policy_register(&blkcg_policy_mqd);
+}
+module_init(mqd_init);
+
+#endif /* CONFIG_BLK_CGROUP */
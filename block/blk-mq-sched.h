@@ -0,0 +1,57 @@
+#ifndef BLK_MQ_SCHED_H
+#define BLK_MQ_SCHED_H
+
+#include <linux/blk-mq.h>
+
+/*
+ * A blk-mq scheduler sits between the software queues and the driver.
+ * Requests flushed from the busy ctxs on a queue run are handed to
+ * ->insert(), and ->dispatch() is then asked to refill the dispatch
+ * list in whatever order the scheduler sees fit.  Merging still
+ * happens in the software queues, so a scheduler only ever sees fully
+ * formed requests.
+ */
+struct blk_mq_sched_ops {
+	const char *name;
+	int (*init_hctx)(struct blk_mq_hw_ctx *hctx);
+	void (*exit_hctx)(struct blk_mq_hw_ctx *hctx);
+	void (*insert)(struct blk_mq_hw_ctx *hctx, struct request *rq);
+	void (*dispatch)(struct blk_mq_hw_ctx *hctx, struct list_head *list);
+	bool (*has_work)(struct blk_mq_hw_ctx *hctx);
+};
+
+#ifdef CONFIG_MQ_IOSCHED_DEADLINE
+
+int blk_mq_sched_init_hctx(struct blk_mq_hw_ctx *hctx);
+void blk_mq_sched_exit_hctx(struct blk_mq_hw_ctx *hctx);
+void blk_mq_sched_insert_list(struct blk_mq_hw_ctx *hctx,
+			      struct list_head *list);
+void blk_mq_sched_dispatch(struct blk_mq_hw_ctx *hctx,
+			   struct list_head *list);
+bool blk_mq_sched_has_work(struct blk_mq_hw_ctx *hctx);
+
+#else /* CONFIG_MQ_IOSCHED_DEADLINE */
+
+static inline int blk_mq_sched_init_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	return 0;
+}
+static inline void blk_mq_sched_exit_hctx(struct blk_mq_hw_ctx *hctx)
+{
+}
+static inline void blk_mq_sched_insert_list(struct blk_mq_hw_ctx *hctx,
+					    struct list_head *list)
+{
+}
+static inline void blk_mq_sched_dispatch(struct blk_mq_hw_ctx *hctx,
+					 struct list_head *list)
+{
+}
+static inline bool blk_mq_sched_has_work(struct blk_mq_hw_ctx *hctx)
+{
+	return false;
+}
+
+#endif /* CONFIG_MQ_IOSCHED_DEADLINE */
+
+#endif
@@ -29,8 +29,10 @@
 #include <linux/blk-mq.h>
 #include "blk.h"
 #include "blk-mq.h"
+#include "blk-mq-sched.h"
 #include "blk-mq-tag.h"
 #include "blk-stat.h"
+#include "blk-hist.h"
 #include "blk-wbt.h"
 
 static DEFINE_MUTEX(all_q_mutex);
@@ -41,7 +43,8 @@ static LIST_HEAD(all_q_list);
  */
 static bool blk_mq_hctx_has_pending(struct blk_mq_hw_ctx *hctx)
 {
-	return sbitmap_any_bit_set(&hctx->ctx_map);
+	return sbitmap_any_bit_set(&hctx->ctx_map) ||
+	       blk_mq_sched_has_work(hctx);
 }
 
 /*
@@ -394,9 +397,20 @@ static void blk_mq_ipi_complete_request(struct request *rq)
 		return;
 	}
 
+	/*
+	 * rq_affinity=2: steer the completion to the submitting CPU via
+	 * the block softirq rather than a per-request IPI.  The softirq
+	 * list only kicks the remote CPU for its first entry, so back to
+	 * back completions of a reaped batch share one wakeup.
+	 */
+	if (test_bit(QUEUE_FLAG_SAME_FORCE, &rq->q->queue_flags)) {
+		rq->cpu = ctx->cpu;
+		__blk_complete_request(rq);
+		return;
+	}
+
 	cpu = get_cpu();
-	if (!test_bit(QUEUE_FLAG_SAME_FORCE, &rq->q->queue_flags))
-		shared = cpus_share_cache(cpu, ctx->cpu);
+	shared = cpus_share_cache(cpu, ctx->cpu);
 
 	if (cpu != ctx->cpu && !shared && cpu_online(ctx->cpu)) {
 		rq->csd.func = __blk_mq_complete_request_remote;
@@ -409,7 +423,7 @@ static void blk_mq_ipi_complete_request(struct request *rq)
 	put_cpu();
 }
 
-static void blk_mq_stat_add(struct request *rq)
+static void blk_mq_stat_add(struct request *rq, s64 now)
 {
 	if (rq->rq_flags & RQF_STATS) {
 		/*
@@ -419,16 +433,25 @@ static void blk_mq_stat_add(struct request *rq)
 		 */
 		struct blk_mq_ctx *ctx;
 
+		if (!now)
+			now = ktime_to_ns(ktime_get());
+
 		ctx = __blk_mq_get_ctx(rq->q, raw_smp_processor_id());
-		blk_stat_add(&ctx->stat[rq_data_dir(rq)], rq);
+		blk_stat_add(&ctx->stat[rq_data_dir(rq)], rq, now);
+
+		if (test_bit(QUEUE_FLAG_POLL, &rq->q->queue_flags))
+			blk_stat_add(&ctx->poll_stat[blk_stat_poll_bkt(rq)],
+				     rq, now);
+
+		blk_hist_rq_done(rq, now);
 	}
 }
 
-static void __blk_mq_complete_request(struct request *rq)
+static void __blk_mq_complete_request(struct request *rq, s64 now)
 {
 	struct request_queue *q = rq->q;
 
-	blk_mq_stat_add(rq);
+	blk_mq_stat_add(rq, now);
 
 	if (!q->softirq_done_fn)
 		blk_mq_end_request(rq, rq->errors);
@@ -452,11 +475,41 @@ void blk_mq_complete_request(struct request *rq, int error)
 		return;
 	if (!blk_mark_rq_complete(rq)) {
 		rq->errors = error;
-		__blk_mq_complete_request(rq);
+		__blk_mq_complete_request(rq, 0);
 	}
 }
 EXPORT_SYMBOL(blk_mq_complete_request);
 
+/**
+ * blk_mq_complete_request_batch - end I/O on a batch of requests
+ * @rqs:	requests the driver reaped in one pass
+ * @errors:	per-request error codes, parallel to @rqs
+ * @nr:		number of requests in the batch
+ *
+ * Description:
+ *	Like blk_mq_complete_request(), but amortizes the fixed per
+ *	completion costs over a batch the driver harvested in one go:
+ *	the stats timestamp is read once for the whole batch.
+ **/
+void blk_mq_complete_request_batch(struct request **rqs, int *errors,
+				   unsigned int nr)
+{
+	s64 now = ktime_to_ns(ktime_get());
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		struct request *rq = rqs[i];
+
+		if (unlikely(blk_should_fake_timeout(rq->q)))
+			continue;
+		if (!blk_mark_rq_complete(rq)) {
+			rq->errors = errors[i];
+			__blk_mq_complete_request(rq, now);
+		}
+	}
+}
+EXPORT_SYMBOL_GPL(blk_mq_complete_request_batch);
+
 int blk_mq_request_started(struct request *rq)
 {
 	return test_bit(REQ_ATOM_STARTED, &rq->atomic_flags);
@@ -659,7 +712,7 @@ void blk_mq_rq_timed_out(struct request *req, bool reserved)
 
 	switch (ret) {
 	case BLK_EH_HANDLED:
-		__blk_mq_complete_request(req);
+		__blk_mq_complete_request(req, 0);
 		break;
 	case BLK_EH_RESET_TIMER:
 		blk_add_timer(req);
@@ -914,6 +967,15 @@ static void blk_mq_process_rq_list(struct blk_mq_hw_ctx *hctx)
 	 */
 	flush_busy_ctxs(hctx, &rq_list);
 
+	/*
+	 * If a scheduler is attached, feed it whatever the software
+	 * queues had pending and let it pick the dispatch order.
+	 */
+	if (hctx->sched_ops) {
+		blk_mq_sched_insert_list(hctx, &rq_list);
+		blk_mq_sched_dispatch(hctx, &rq_list);
+	}
+
 	/*
 	 * If we have previous entries on our dispatch list, grab them
 	 * and stuff them at the front for more fair dispatch.
@@ -925,7 +987,9 @@ static void blk_mq_process_rq_list(struct blk_mq_hw_ctx *hctx)
 		spin_unlock(&hctx->lock);
 	}
 
-	blk_mq_dispatch_rq_list(hctx, &rq_list);
+	if (blk_mq_dispatch_rq_list(hctx, &rq_list) &&
+	    blk_mq_sched_has_work(hctx))
+		blk_mq_run_hw_queue(hctx, true);
 }
 
 static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
@@ -1389,7 +1453,8 @@ static blk_qc_t blk_mq_make_request(struct request_queue *q, struct bio *bio)
 	 * queue it up like normal since we can potentially save some
 	 * CPU this way.
 	 */
-	if (((plug && !blk_queue_nomerges(q)) || is_sync) &&
+	if (((plug && !blk_queue_nomerges(q)) ||
+	     (is_sync && !data.hctx->sched_ops)) &&
 	    !(data.hctx->flags & BLK_MQ_F_DEFER_ISSUE)) {
 		struct request *old_rq = NULL;
 
@@ -1723,6 +1788,8 @@ static void blk_mq_exit_hctx(struct request_queue *q,
 	if (set->ops->exit_hctx)
 		set->ops->exit_hctx(hctx, hctx_idx);
 
+	blk_mq_sched_exit_hctx(hctx);
+
 	if (hctx->flags & BLK_MQ_F_BLOCKING)
 		cleanup_srcu_struct(&hctx->queue_rq_srcu);
 
@@ -1792,9 +1859,12 @@ static int blk_mq_init_hctx(struct request_queue *q,
 
 	hctx->nr_ctx = 0;
 
+	if (blk_mq_sched_init_hctx(hctx))
+		goto free_bitmap;
+
 	if (set->ops->init_hctx &&
 	    set->ops->init_hctx(hctx, set->driver_data, hctx_idx))
-		goto free_bitmap;
+		goto exit_sched;
 
 	hctx->fq = blk_alloc_flush_queue(q, hctx->numa_node, set->cmd_size);
 	if (!hctx->fq)
@@ -1816,6 +1886,8 @@ static int blk_mq_init_hctx(struct request_queue *q,
  exit_hctx:
 	if (set->ops->exit_hctx)
 		set->ops->exit_hctx(hctx, hctx_idx);
+ exit_sched:
+	blk_mq_sched_exit_hctx(hctx);
  free_bitmap:
 	sbitmap_free(&hctx->ctx_map);
  free_ctxs:
@@ -2491,7 +2563,8 @@ static unsigned long blk_mq_poll_nsecs(struct request_queue *q,
 				       struct blk_mq_hw_ctx *hctx,
 				       struct request *rq)
 {
-	struct blk_rq_stat stat[2];
+	struct blk_rq_stat stat[BLK_STAT_POLL_BKTS];
+	int bucket = blk_stat_poll_bkt(rq);
 	unsigned long ret = 0;
 
 	/*
@@ -2506,20 +2579,20 @@ static unsigned long blk_mq_poll_nsecs(struct request_queue *q,
 	 * to just use the current window of stats until it changes
 	 */
 	memset(&stat, 0, sizeof(stat));
-	blk_hctx_stat_get(hctx, stat);
+	blk_hctx_poll_stat_get(hctx, stat);
 
 	/*
 	 * As an optimistic guess, use half of the mean service time
-	 * for this type of request. We can (and should) make this smarter.
-	 * For instance, if the completion latencies are tight, we can
-	 * get closer than just half the mean. This is especially
-	 * important on devices where the completion latencies are longer
-	 * than ~10 usec.
+	 * for the direction and size class of this request, so that a
+	 * tiny read doesn't inherit the sleep time of large writes on
+	 * the same queue. We can (and should) make this smarter. For
+	 * instance, if the completion latencies are tight, we can get
+	 * closer than just half the mean. This is especially important
+	 * on devices where the completion latencies are longer than
+	 * ~10 usec.
 	 */
-	if (req_op(rq) == REQ_OP_READ && stat[BLK_STAT_READ].nr_samples)
-		ret = (stat[BLK_STAT_READ].mean + 1) / 2;
-	else if (req_op(rq) == REQ_OP_WRITE && stat[BLK_STAT_WRITE].nr_samples)
-		ret = (stat[BLK_STAT_WRITE].mean + 1) / 2;
+	if (stat[bucket].nr_samples)
+		ret = (stat[bucket].mean + 1) / 2;
 
 	return ret;
 }
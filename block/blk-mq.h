@@ -21,6 +21,7 @@ struct blk_mq_ctx {
 	/* incremented at completion time */
 	unsigned long		____cacheline_aligned_in_smp rq_completed[2];
 	struct blk_rq_stat	stat[2];
+	struct blk_rq_stat	poll_stat[BLK_STAT_POLL_BKTS];
 
 	struct request_queue	*queue;
 	struct kobject		kobj;
@@ -169,6 +169,48 @@ void blk_hctx_stat_get(struct blk_mq_hw_ctx *hctx, struct blk_rq_stat *dst)
 	} while (!nr);
 }
 
+void blk_hctx_poll_stat_get(struct blk_mq_hw_ctx *hctx,
+			    struct blk_rq_stat *dst)
+{
+	struct blk_mq_ctx *ctx;
+	unsigned int i, b, nr;
+
+	nr = 0;
+	do {
+		uint64_t newest = 0;
+
+		hctx_for_each_ctx(hctx, ctx, i) {
+			for (b = 0; b < BLK_STAT_POLL_BKTS; b++) {
+				blk_stat_flush_batch(&ctx->poll_stat[b]);
+
+				if (!ctx->poll_stat[b].nr_samples)
+					continue;
+				if (ctx->poll_stat[b].time > newest)
+					newest = ctx->poll_stat[b].time;
+			}
+		}
+
+		if (!newest)
+			break;
+
+		hctx_for_each_ctx(hctx, ctx, i) {
+			for (b = 0; b < BLK_STAT_POLL_BKTS; b++) {
+				if (ctx->poll_stat[b].nr_samples &&
+				    ctx->poll_stat[b].time == newest) {
+					blk_stat_sum(&dst[b],
+						     &ctx->poll_stat[b]);
+					nr++;
+				}
+			}
+		}
+		/*
+		 * If we race on finding an entry, just loop back again.
+		 * Should be very rare, as the window is only updated
+		 * occasionally
+		 */
+	} while (!nr);
+}
+
 static void __blk_stat_init(struct blk_rq_stat *stat, s64 time_now)
 {
 	stat->min = -1ULL;
@@ -192,11 +234,14 @@ bool blk_stat_is_current(struct blk_rq_stat *stat)
 	return __blk_stat_is_current(stat, ktime_to_ns(ktime_get()));
 }
 
-void blk_stat_add(struct blk_rq_stat *stat, struct request *rq)
+void blk_stat_add(struct blk_rq_stat *stat, struct request *rq, s64 now)
 {
-	s64 now, value;
+	s64 value;
 
-	now = __blk_stat_time(ktime_to_ns(ktime_get()));
+	/* callers completing a batch pass one timestamp for all of it */
+	if (!now)
+		now = ktime_to_ns(ktime_get());
+	now = __blk_stat_time(now);
 	if (now < blk_stat_time(&rq->issue_stat))
 		return;
 
@@ -226,8 +271,12 @@ void blk_stat_clear(struct request_queue *q)
 
 		queue_for_each_hw_ctx(q, hctx, i) {
 			hctx_for_each_ctx(hctx, ctx, j) {
+				int b;
+
 				blk_stat_init(&ctx->stat[BLK_STAT_READ]);
 				blk_stat_init(&ctx->stat[BLK_STAT_WRITE]);
+				for (b = 0; b < BLK_STAT_POLL_BKTS; b++)
+					blk_stat_init(&ctx->poll_stat[b]);
 			}
 		}
 	} else {
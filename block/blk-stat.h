@@ -20,8 +20,17 @@ enum {
 	BLK_STAT_WRITE,
 };
 
-void blk_stat_add(struct blk_rq_stat *, struct request *);
+/*
+ * Poll stat buckets: both directions, with size classes of 512B up to
+ * 64KB-and-bigger.  Used to pick a hybrid poll sleep time that matches
+ * the IO being polled for, rather than the per-direction average.
+ */
+#define BLK_STAT_POLL_SIZE_BKTS	8
+#define BLK_STAT_POLL_BKTS	(2 * BLK_STAT_POLL_SIZE_BKTS)
+
+void blk_stat_add(struct blk_rq_stat *, struct request *, s64 now);
 void blk_hctx_stat_get(struct blk_mq_hw_ctx *, struct blk_rq_stat *);
+void blk_hctx_poll_stat_get(struct blk_mq_hw_ctx *, struct blk_rq_stat *);
 void blk_queue_stat_get(struct request_queue *, struct blk_rq_stat *);
 void blk_stat_clear(struct request_queue *);
 void blk_stat_init(struct blk_rq_stat *);
@@ -39,4 +48,17 @@ static inline u64 blk_stat_time(struct blk_issue_stat *stat)
 	return __blk_stat_time(stat->time);
 }
 
+static inline int blk_stat_poll_bkt(struct request *rq)
+{
+	unsigned int bytes = blk_rq_bytes(rq);
+	int bucket = 0;
+
+	if (bytes)
+		bucket = clamp(ilog2(bytes) - 9, 0,
+			       BLK_STAT_POLL_SIZE_BKTS - 1);
+	if (rq_data_dir(rq) == WRITE)
+		bucket += BLK_STAT_POLL_SIZE_BKTS;
+	return bucket;
+}
+
 #endif
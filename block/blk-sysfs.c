@@ -13,6 +13,7 @@
 
 #include "blk.h"
 #include "blk-mq.h"
+#include "blk-hist.h"
 #include "blk-wbt.h"
 
 struct queue_sysfs_entry {
@@ -200,6 +201,36 @@ static ssize_t queue_discard_max_store(struct request_queue *q,
 	return ret;
 }
 
+static ssize_t queue_discard_backlog_bytes_show(struct request_queue *q,
+						char *page)
+{
+	struct blk_discard_ctx *ctx = q->discard_ctx;
+	u64 sects = 0;
+
+	if (ctx) {
+		spin_lock_irq(&ctx->lock);
+		sects = ctx->backlog_sects;
+		spin_unlock_irq(&ctx->lock);
+	}
+
+	return sprintf(page, "%llu\n", (unsigned long long)sects << 9);
+}
+
+static ssize_t queue_discard_backlog_ranges_show(struct request_queue *q,
+						 char *page)
+{
+	struct blk_discard_ctx *ctx = q->discard_ctx;
+	unsigned int ranges = 0;
+
+	if (ctx) {
+		spin_lock_irq(&ctx->lock);
+		ranges = ctx->backlog_ranges;
+		spin_unlock_irq(&ctx->lock);
+	}
+
+	return queue_var_show(ranges, page);
+}
+
 static ssize_t queue_discard_zeroes_data_show(struct request_queue *q, char *page)
 {
 	return queue_var_show(queue_discard_zeroes_data(q), page);
@@ -460,6 +491,32 @@ static ssize_t queue_wb_lat_store(struct request_queue *q, const char *page,
 	return count;
 }
 
+static ssize_t queue_lat_hist_show(struct request_queue *q, char *page)
+{
+	return blk_hist_queue_show(q, page);
+}
+
+static ssize_t queue_lat_hist_store(struct request_queue *q, const char *page,
+				    size_t count)
+{
+	unsigned long enable;
+	ssize_t ret;
+
+	ret = queue_var_store(&enable, page, count);
+	if (ret < 0)
+		return ret;
+
+	if (enable) {
+		ret = blk_hist_queue_enable(q);
+		if (ret)
+			return ret;
+	} else {
+		blk_hist_queue_disable(q);
+	}
+
+	return count;
+}
+
 static ssize_t queue_wc_show(struct request_queue *q, char *page)
 {
 	if (test_bit(QUEUE_FLAG_WC, &q->queue_flags))
@@ -607,6 +664,16 @@ static struct queue_sysfs_entry queue_discard_max_entry = {
 	.store = queue_discard_max_store,
 };
 
+static struct queue_sysfs_entry queue_discard_backlog_bytes_entry = {
+	.attr = {.name = "discard_backlog_bytes", .mode = S_IRUGO },
+	.show = queue_discard_backlog_bytes_show,
+};
+
+static struct queue_sysfs_entry queue_discard_backlog_ranges_entry = {
+	.attr = {.name = "discard_backlog_ranges", .mode = S_IRUGO },
+	.show = queue_discard_backlog_ranges_show,
+};
+
 static struct queue_sysfs_entry queue_discard_zeroes_data_entry = {
 	.attr = {.name = "discard_zeroes_data", .mode = S_IRUGO },
 	.show = queue_discard_zeroes_data_show,
@@ -691,6 +758,12 @@ static struct queue_sysfs_entry queue_wb_lat_entry = {
 	.store = queue_wb_lat_store,
 };
 
+static struct queue_sysfs_entry queue_lat_hist_entry = {
+	.attr = {.name = "lat_hist", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_lat_hist_show,
+	.store = queue_lat_hist_store,
+};
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -708,6 +781,8 @@ static struct attribute *default_attrs[] = {
 	&queue_io_opt_entry.attr,
 	&queue_discard_granularity_entry.attr,
 	&queue_discard_max_entry.attr,
+	&queue_discard_backlog_bytes_entry.attr,
+	&queue_discard_backlog_ranges_entry.attr,
 	&queue_discard_max_hw_entry.attr,
 	&queue_discard_zeroes_data_entry.attr,
 	&queue_write_same_max_entry.attr,
@@ -723,6 +798,7 @@ static struct attribute *default_attrs[] = {
 	&queue_dax_entry.attr,
 	&queue_stats_entry.attr,
 	&queue_wb_lat_entry.attr,
+	&queue_lat_hist_entry.attr,
 	&queue_poll_delay_entry.attr,
 	NULL,
 };
@@ -799,6 +875,7 @@ static void blk_release_queue(struct kobject *kobj)
 		container_of(kobj, struct request_queue, kobj);
 
 	wbt_exit(q);
+	blk_hist_queue_exit(q);
 	bdi_exit(&q->backing_dev_info);
 	blkcg_exit_queue(q);
 
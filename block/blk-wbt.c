@@ -23,6 +23,7 @@
 #include <linux/slab.h>
 #include <linux/backing-dev.h>
 #include <linux/swap.h>
+#include <linux/blk-cgroup.h>
 
 #include "blk-wbt.h"
 
@@ -515,8 +516,107 @@ static inline unsigned int get_limit(struct rq_wb *rwb, unsigned long rw)
 	return limit;
 }
 
+#ifdef CONFIG_BLK_CGROUP
+
+/*
+ * Per-cgroup writeback throttling state: an optional latency target,
+ * which translates into a share of whatever depth the queue-wide scaling
+ * has currently settled on, plus throttle statistics.
+ */
+struct wbt_cgd {
+	struct blkcg_policy_data cpd;
+	u64 lat_target_usec;		/* 0 = use the queue's target */
+	atomic64_t throttled;		/* writes that had to wait */
+};
+
+static struct blkcg_policy blkcg_policy_wbt;
+
+static struct wbt_cgd *blkcg_to_wbt_cgd(struct blkcg *blkcg)
+{
+	struct blkcg_policy_data *cpd = blkcg_to_cpd(blkcg, &blkcg_policy_wbt);
+
+	return cpd ? container_of(cpd, struct wbt_cgd, cpd) : NULL;
+}
+
+static struct wbt_cgd *wbt_get_cgd(struct bio *bio)
+{
+	struct blkcg *blkcg;
+	struct wbt_cgd *cgd;
+
+	rcu_read_lock();
+	blkcg = bio_blkcg(bio);
+	cgd = blkcg_to_wbt_cgd(blkcg);
+	if (cgd)
+		css_get(&blkcg->css);
+	rcu_read_unlock();
+
+	return cgd;
+}
+
+static void wbt_put_cgd(struct wbt_cgd *cgd)
+{
+	if (cgd)
+		css_put(&cgd->cpd.blkcg->css);
+}
+
+/*
+ * Infer the cgroup's depth share from the ratio of the queue's latency
+ * target to the cgroup's: a tenant content with twice the latency gets
+ * half the writeback depth, keeping its dirty flushes from inflating
+ * the latency seen by tenants with tighter targets.  Targets tighter
+ * than the queue's cannot be honored by a per-queue window and map to
+ * the full share.
+ */
+static unsigned int wbt_cg_limit(struct rq_wb *rwb, struct wbt_cgd *cgd,
+				 unsigned int limit)
+{
+	u64 target;
+
+	if (!cgd || !cgd->lat_target_usec || !rwb->min_lat_nsec)
+		return limit;
+
+	target = cgd->lat_target_usec * NSEC_PER_USEC;
+	if (target <= rwb->min_lat_nsec)
+		return limit;
+
+	limit = div64_u64((u64)limit * rwb->min_lat_nsec, target);
+	return max_t(unsigned int, limit, 1);
+}
+
+static void wbt_cg_account_throttle(struct wbt_cgd *cgd)
+{
+	if (cgd)
+		atomic64_inc(&cgd->throttled);
+}
+
+#else /* CONFIG_BLK_CGROUP */
+
+struct wbt_cgd;
+
+static struct wbt_cgd *wbt_get_cgd(struct bio *bio)
+{
+	return NULL;
+}
+
+static void wbt_put_cgd(struct wbt_cgd *cgd)
+{
+}
+
+static unsigned int wbt_cg_limit(struct rq_wb *rwb, struct wbt_cgd *cgd,
+				 unsigned int limit)
+{
+	return limit;
+}
+
+static void wbt_cg_account_throttle(struct wbt_cgd *cgd)
+{
+}
+
+#endif /* CONFIG_BLK_CGROUP */
+
 static inline bool may_queue(struct rq_wb *rwb, struct rq_wait *rqw,
-			     wait_queue_t *wait, unsigned long rw)
+			     wait_queue_t *wait, unsigned long rw,
+			     struct wbt_cgd *cgd)
 {
 	/*
 	 * inc it here even if disabled, since we'll dec it at completion.
@@ -536,28 +636,32 @@ static inline bool may_queue(struct rq_wb *rwb, struct rq_wait *rqw,
 	    rqw->wait.task_list.next != &wait->task_list)
 		return false;
 
-	return atomic_inc_below(&rqw->inflight, get_limit(rwb, rw));
+	return atomic_inc_below(&rqw->inflight,
+				wbt_cg_limit(rwb, cgd, get_limit(rwb, rw)));
 }
 
 /*
  * Block if we will exceed our limit, or if we are currently waiting for
  * the timer to kick off queuing again.
  */
-static void __wbt_wait(struct rq_wb *rwb, unsigned long rw, spinlock_t *lock)
+static void __wbt_wait(struct rq_wb *rwb, unsigned long rw,
+		       struct wbt_cgd *cgd, spinlock_t *lock)
 	__releases(lock)
 	__acquires(lock)
 {
 	struct rq_wait *rqw = get_rq_wait(rwb, current_is_kswapd());
 	DEFINE_WAIT(wait);
 
-	if (may_queue(rwb, rqw, &wait, rw))
+	if (may_queue(rwb, rqw, &wait, rw, cgd))
 		return;
 
+	wbt_cg_account_throttle(cgd);
+
 	do {
 		prepare_to_wait_exclusive(&rqw->wait, &wait,
 						TASK_UNINTERRUPTIBLE);
 
-		if (may_queue(rwb, rqw, &wait, rw))
+		if (may_queue(rwb, rqw, &wait, rw, cgd))
 			break;
 
 		if (lock) {
@@ -598,6 +702,7 @@ static inline bool wbt_should_throttle(struct rq_wb *rwb, struct bio *bio)
  */
 enum wbt_flags wbt_wait(struct rq_wb *rwb, struct bio *bio, spinlock_t *lock)
 {
+	struct wbt_cgd *cgd;
 	unsigned int ret = 0;
 
 	if (!rwb_enabled(rwb))
@@ -612,7 +717,9 @@ enum wbt_flags wbt_wait(struct rq_wb *rwb, struct bio *bio, spinlock_t *lock)
 		return ret;
 	}
 
-	__wbt_wait(rwb, bio->bi_opf, lock);
+	cgd = wbt_get_cgd(bio);
+	__wbt_wait(rwb, bio->bi_opf, cgd, lock);
+	wbt_put_cgd(cgd);
 
 	if (!timer_pending(&rwb->window_timer))
 		rwb_arm_timer(rwb);
@@ -749,3 +856,95 @@ void wbt_exit(struct request_queue *q)
 		kfree(rwb);
 	}
 }
+
+#ifdef CONFIG_BLK_CGROUP
+
+static struct blkcg_policy_data *wbt_cpd_alloc(gfp_t gfp)
+{
+	struct wbt_cgd *cgd;
+
+	cgd = kzalloc(sizeof(*cgd), gfp);
+	if (!cgd)
+		return NULL;
+	return &cgd->cpd;
+}
+
+static void wbt_cpd_free(struct blkcg_policy_data *cpd)
+{
+	kfree(container_of(cpd, struct wbt_cgd, cpd));
+}
+
+static int wbt_cg_print_lat(struct seq_file *sf, void *v)
+{
+	struct wbt_cgd *cgd = blkcg_to_wbt_cgd(css_to_blkcg(seq_css(sf)));
+
+	seq_printf(sf, "%llu\n", cgd ? cgd->lat_target_usec : 0);
+	return 0;
+}
+
+static int wbt_cg_set_lat(struct cgroup_subsys_state *css,
+			  struct cftype *cft, u64 val)
+{
+	struct wbt_cgd *cgd = blkcg_to_wbt_cgd(css_to_blkcg(css));
+
+	if (!cgd)
+		return -EINVAL;
+
+	cgd->lat_target_usec = val;
+	return 0;
+}
+
+static int wbt_cg_print_stat(struct seq_file *sf, void *v)
+{
+	struct wbt_cgd *cgd = blkcg_to_wbt_cgd(css_to_blkcg(seq_css(sf)));
+
+	seq_printf(sf, "throttled %llu\n",
+		   cgd ? (unsigned long long)atomic64_read(&cgd->throttled) : 0);
+	return 0;
+}
+
+static struct cftype wbt_blkcg_legacy_files[] = {
+	{
+		.name = "wbt.lat_target_usec",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = wbt_cg_print_lat,
+		.write_u64 = wbt_cg_set_lat,
+	},
+	{
+		.name = "wbt.stat",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = wbt_cg_print_stat,
+	},
+	{ }	/* terminate */
+};
+
+static struct cftype wbt_blkcg_files[] = {
+	{
+		.name = "wbt.lat_target_usec",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = wbt_cg_print_lat,
+		.write_u64 = wbt_cg_set_lat,
+	},
+	{
+		.name = "wbt.stat",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = wbt_cg_print_stat,
+	},
+	{ }	/* terminate */
+};
+
+static struct blkcg_policy blkcg_policy_wbt = {
+	.dfl_cftypes		= wbt_blkcg_files,
+	.legacy_cftypes		= wbt_blkcg_legacy_files,
+
+	.cpd_alloc_fn		= wbt_cpd_alloc,
+	.cpd_free_fn		= wbt_cpd_free,
+};
+
+static int __init wbt_blkcg_init(void)
+{
+	return blkcg_policy_register(&blkcg_policy_wbt);
+}
+module_init(wbt_blkcg_init);
+
+#endif /* CONFIG_BLK_CGROUP */
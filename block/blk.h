@@ -283,6 +283,22 @@ static inline struct io_context *create_io_context(gfp_t gfp_mask, int node)
 	return current->io_context;
 }
 
+/*
+ * Async discard manager (blk-lib.c).  Queued ranges are coalesced in an
+ * rbtree and drained by a worker that paces itself against foreground
+ * latency.
+ */
+struct blk_discard_ctx {
+	struct request_queue	*q;
+	spinlock_t		lock;
+	struct rb_root		root;
+	u64			backlog_sects;
+	unsigned int		backlog_ranges;
+	struct delayed_work	work;
+};
+
+void blk_discard_exit(struct request_queue *q);
+
 /*
  * Internal throttling interface
  */
@@ -140,9 +140,14 @@ ssize_t part_inflight_show(struct device *dev,
 			struct device_attribute *attr, char *buf)
 {
 	struct hd_struct *p = dev_to_part(dev);
+	long inflight[2];
 
-	return sprintf(buf, "%8u %8u\n", atomic_read(&p->in_flight[0]),
-		atomic_read(&p->in_flight[1]));
+	inflight[0] = part_stat_read(p, in_flight[0]);
+	inflight[1] = part_stat_read(p, in_flight[1]);
+
+	return sprintf(buf, "%8u %8u\n",
+		       (unsigned int)(inflight[0] < 0 ? 0 : inflight[0]),
+		       (unsigned int)(inflight[1] < 0 ? 0 : inflight[1]));
 }
 
 #ifdef CONFIG_FAIL_MAKE_REQUEST
@@ -418,6 +418,7 @@ static LIST_HEAD(random_ready_list);
 struct crng_state {
 	__u32		state[16];
 	unsigned long	init_time;
+	unsigned int	generation;
 	spinlock_t	lock;
 };
 
@@ -759,7 +760,13 @@ static int credit_entropy_bits_safe(struct entropy_store *r, int nbits)
  *
  *********************************************************************/
 
-#define CRNG_RESEED_INTERVAL (300*HZ)
+/*
+ * How long a CRNG instance may hand out output before it is reseeded,
+ * settable via /proc/sys/kernel/random/crng_reseed_secs.
+ */
+static int crng_reseed_secs = 300;
+
+#define CRNG_RESEED_INTERVAL (crng_reseed_secs * HZ)
 
 static DECLARE_WAIT_QUEUE_HEAD(crng_init_wait);
 
@@ -773,6 +780,17 @@ static DECLARE_WAIT_QUEUE_HEAD(crng_init_wait);
 static struct crng_state **crng_node_pool __read_mostly;
 #endif
 
+/*
+ * Per-cpu CRNG instances, each reseeded from the primary CRNG.  A heavy
+ * getrandom(2) load then only ever takes the local cpu's lock, which is
+ * effectively uncontended, instead of serializing every cpu on a single
+ * shared instance.
+ */
+static DEFINE_PER_CPU(struct crng_state, crng_cpu_pool) = {
+	.lock = __SPIN_LOCK_UNLOCKED(crng_cpu_pool.lock),
+};
+static bool crng_cpu_pool_ready __read_mostly;
+
 static void crng_initialize(struct crng_state *crng)
 {
 	int		i;
@@ -791,6 +809,7 @@ static void crng_initialize(struct crng_state *crng)
 		crng->state[i] ^= rv;
 	}
 	crng->init_time = jiffies - CRNG_RESEED_INTERVAL - 1;
+	crng->generation = 0;
 }
 
 static int crng_fast_load(const char *cp, size_t len)
@@ -846,6 +865,7 @@ static void crng_reseed(struct crng_state *crng, struct entropy_store *r)
 	}
 	memzero_explicit(&buf, sizeof(buf));
 	crng->init_time = jiffies;
+	crng->generation++;
 	if (crng == &primary_crng && crng_init < 2) {
 		crng_init = 2;
 		process_random_ready_list();
@@ -888,11 +908,13 @@ static void extract_crng(__u8 out[CHACHA20_BLOCK_SIZE])
 {
 	struct crng_state *crng = NULL;
 
+	if (crng_cpu_pool_ready)
+		crng = raw_cpu_ptr(&crng_cpu_pool);
 #ifdef CONFIG_NUMA
-	if (crng_node_pool)
+	if (crng == NULL && crng_node_pool)
 		crng = crng_node_pool[numa_node_id()];
-	if (crng == NULL)
 #endif
+	if (crng == NULL)
 		crng = &primary_crng;
 	_extract_crng(crng, out);
 }
@@ -925,11 +947,13 @@ static void crng_backtrack_protect(__u8 tmp[CHACHA20_BLOCK_SIZE], int used)
 {
 	struct crng_state *crng = NULL;
 
+	if (crng_cpu_pool_ready)
+		crng = raw_cpu_ptr(&crng_cpu_pool);
 #ifdef CONFIG_NUMA
-	if (crng_node_pool)
+	if (crng == NULL && crng_node_pool)
 		crng = crng_node_pool[numa_node_id()];
-	if (crng == NULL)
 #endif
+	if (crng == NULL)
 		crng = &primary_crng;
 	_crng_backtrack_protect(crng, tmp, used);
 }
@@ -1655,9 +1679,9 @@ static void init_std_data(struct entropy_store *r)
  */
 static int rand_initialize(void)
 {
-#ifdef CONFIG_NUMA
 	int i;
 	struct crng_state *crng;
+#ifdef CONFIG_NUMA
 	struct crng_state **pool;
 #endif
 
@@ -1677,6 +1701,13 @@ static int rand_initialize(void)
 	mb();
 	crng_node_pool = pool;
 #endif
+	for_each_possible_cpu(i) {
+		crng = per_cpu_ptr(&crng_cpu_pool, i);
+		spin_lock_init(&crng->lock);
+		crng_initialize(crng);
+	}
+	mb();
+	crng_cpu_pool_ready = true;
 	return 0;
 }
 early_initcall(rand_initialize);
@@ -1967,6 +1998,35 @@ static int proc_do_entropy(struct ctl_table *table, int write,
 	return proc_dointvec(&fake_table, write, buffer, lenp, ppos);
 }
 
+/*
+ * Return the reseed generation of each cpu's CRNG instance as a vector
+ * of integers, so reseed progress can be audited from userspace.
+ */
+static int proc_do_crng_generation(struct ctl_table *table, int write,
+			void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	struct ctl_table fake_table;
+	int *gens;
+	int cpu, ret;
+
+	gens = kcalloc(nr_cpu_ids, sizeof(int), GFP_KERNEL);
+	if (!gens)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		gens[cpu] = per_cpu(crng_cpu_pool, cpu).generation;
+
+	fake_table.data = gens;
+	fake_table.maxlen = nr_cpu_ids * sizeof(int);
+
+	ret = proc_dointvec(&fake_table, write, buffer, lenp, ppos);
+	kfree(gens);
+	return ret;
+}
+
+static int min_crng_reseed_secs = 1;
+static int max_crng_reseed_secs = 3600;
+
 static int sysctl_poolsize = INPUT_POOL_WORDS * 32;
 extern struct ctl_table random_table[];
 struct ctl_table random_table[] = {
@@ -2009,6 +2069,21 @@ struct ctl_table random_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "crng_reseed_secs",
+		.data		= &crng_reseed_secs,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &min_crng_reseed_secs,
+		.extra2		= &max_crng_reseed_secs,
+	},
+	{
+		.procname	= "crng_cpu_generation",
+		.maxlen		= 0,
+		.mode		= 0444,
+		.proc_handler	= proc_do_crng_generation,
+	},
 	{
 		.procname	= "boot_id",
 		.data		= &sysctl_bootid,
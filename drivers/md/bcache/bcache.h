@@ -239,6 +239,9 @@ struct keybuf {
 
 	struct rb_root		keys;
 
+	/* Woken whenever keys are deleted from the rb tree */
+	wait_queue_head_t	wait;
+
 #define KEYBUF_NR		500
 	DECLARE_ARRAY_ALLOCATOR(struct keybuf_key, freelist, KEYBUF_NR);
 };
@@ -322,18 +325,35 @@ struct cached_dev {
 	atomic_t		has_dirty;
 
 	struct bch_ratelimit	writeback_rate;
+	spinlock_t		writeback_rate_lock;
 	struct delayed_work	writeback_rate_update;
 
-	/*
-	 * Internal to the writeback code, so read_dirty() can keep track of
-	 * where it's at.
-	 */
-	sector_t		last_read;
-
 	/* Limit number of writeback bios in flight */
 	struct semaphore	in_flight;
+
+	/* Scans the btree for dirty keys and refills writeback_keys */
 	struct task_struct	*writeback_thread;
 
+	/*
+	 * Workers draining writeback_keys, each preferring its own
+	 * region of the backing device so writes stay sequential.
+	 */
+#define BCH_WB_NR_WORKERS	8
+	struct bch_writeback_worker {
+		struct cached_dev	*dc;
+		struct task_struct	*thread;
+		unsigned		id;
+
+		/*
+		 * Internal to the writeback code, so read_dirty() can keep
+		 * track of where it's at.
+		 */
+		sector_t		last_read;
+	} writeback_workers[BCH_WB_NR_WORKERS];
+
+	/* Number of workers actually in use, 1..BCH_WB_NR_WORKERS */
+	unsigned		writeback_parallel;
+
 	struct keybuf		writeback_keys;
 
 	/* For tracking sequential IO */
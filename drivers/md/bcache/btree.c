@@ -2322,9 +2322,111 @@ static int bch_btree_map_keys_recurse(struct btree *b, struct btree_op *op,
 	return ret;
 }
 
+/*
+ * Read only lookups don't need the parent held while we walk a child: once
+ * the child is read locked it can't be split or freed out from under us, and
+ * the parent's iterator can be reconstructed by descending again from the key
+ * we stopped at.  So descend with lock coupling, dropping each node's lock as
+ * soon as the next level is locked - the root lock is then only held long
+ * enough to find and lock the next level, instead of across the whole leaf
+ * walk, which is what makes it a contention point with many concurrent
+ * lookups.
+ */
+static int bch_btree_map_keys_readonly(struct btree_op *op,
+				       struct cache_set *c, struct bkey *from,
+				       btree_map_keys_fn *fn, int flags)
+{
+	int ret = MAP_CONTINUE;
+	struct bkey restart;
+	bool done = false;
+
+	while (!done) {
+		struct btree *b, *child;
+		struct bkey *k;
+		struct btree_iter iter;
+
+		b = c->root;
+		rw_lock(false, b, b->level);
+		if (b != c->root) {
+			rw_unlock(false, b);
+			continue;
+		}
+
+		while (b->level) {
+			bch_btree_iter_init(&b->keys, &iter, from);
+			k = bch_btree_iter_next_filter(&iter, &b->keys,
+						       bch_ptr_bad);
+			if (!k)
+				break;	/* past the last key in the tree */
+
+			child = bch_btree_node_get(c, op, k, b->level - 1,
+						   false, b);
+			rw_unlock(false, b);
+
+			if (IS_ERR(child)) {
+				ret = PTR_ERR(child);
+				b = NULL;
+				break;
+			}
+
+			b = child;
+		}
+
+		if (!b) {
+			/* bch_btree_node_get() failed; no locks held */
+		} else if (b->level) {
+			/* ran out of keys at an interior node - all done */
+			done = true;
+			rw_unlock(false, b);
+		} else {
+			bch_btree_iter_init(&b->keys, &iter, from);
+
+			while ((k = bch_btree_iter_next_filter(&iter, &b->keys,
+							       bch_ptr_bad))) {
+				ret = fn(op, b, k);
+				if (ret != MAP_CONTINUE)
+					break;
+			}
+
+			if (ret == MAP_CONTINUE) {
+				restart = KEY(KEY_INODE(&b->key),
+					      KEY_OFFSET(&b->key), 0);
+
+				if (flags & MAP_END_KEY)
+					ret = fn(op, b, &restart);
+
+				if (bkey_cmp(&b->key, &MAX_KEY) >= 0)
+					done = true;
+				else
+					from = &restart;
+			}
+
+			if (ret != MAP_CONTINUE)
+				done = true;
+
+			rw_unlock(false, b);
+		}
+
+		bch_cannibalize_unlock(c);
+
+		if (ret == -EINTR) {
+			ret = MAP_CONTINUE;
+			done = false;
+			schedule();
+		} else if (ret < 0)
+			done = true;
+	}
+
+	finish_wait(&c->btree_cache_wait, &op->wait);
+	return ret;
+}
+
 int bch_btree_map_keys(struct btree_op *op, struct cache_set *c,
 		       struct bkey *from, btree_map_keys_fn *fn, int flags)
 {
+	if (op->lock < 0)
+		return bch_btree_map_keys_readonly(op, c, from, fn, flags);
+
 	return btree_root(map_keys_recurse, c, op, from, fn, flags);
 }
 
@@ -2448,6 +2550,8 @@ void bch_keybuf_del(struct keybuf *buf, struct keybuf_key *w)
 	spin_lock(&buf->lock);
 	__bch_keybuf_del(buf, w);
 	spin_unlock(&buf->lock);
+
+	wake_up(&buf->wait);
 }
 
 bool bch_keybuf_check_overlapping(struct keybuf *buf, struct bkey *start,
@@ -2475,6 +2579,8 @@ bool bch_keybuf_check_overlapping(struct keybuf *buf, struct bkey *start,
 	}
 
 	spin_unlock(&buf->lock);
+
+	wake_up(&buf->wait);
 	return ret;
 }
 
@@ -2495,6 +2601,32 @@ struct keybuf_key *bch_keybuf_next(struct keybuf *buf)
 	return w;
 }
 
+/*
+ * Like bch_keybuf_next(), but only returns keys starting in
+ * [@start, @end) - the keys are sorted, so we can stop walking once
+ * we're past @end.
+ */
+struct keybuf_key *bch_keybuf_next_region(struct keybuf *buf,
+					  uint64_t start, uint64_t end)
+{
+	struct keybuf_key *w;
+	spin_lock(&buf->lock);
+
+	w = RB_FIRST(&buf->keys, struct keybuf_key, node);
+
+	while (w && (w->private || KEY_START(&w->key) < start))
+		w = RB_NEXT(w, node);
+
+	if (w && KEY_START(&w->key) >= end)
+		w = NULL;
+
+	if (w)
+		w->private = ERR_PTR(-EINTR);
+
+	spin_unlock(&buf->lock);
+	return w;
+}
+
 struct keybuf_key *bch_keybuf_next_rescan(struct cache_set *c,
 					  struct keybuf *buf,
 					  struct bkey *end,
@@ -2524,5 +2656,6 @@ void bch_keybuf_init(struct keybuf *buf)
 	buf->keys		= RB_ROOT;
 
 	spin_lock_init(&buf->lock);
+	init_waitqueue_head(&buf->wait);
 	array_allocator_init(&buf->freelist);
 }
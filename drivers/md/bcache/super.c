@@ -1059,8 +1059,7 @@ static void cached_dev_free(struct closure *cl)
 	struct cached_dev *dc = container_of(cl, struct cached_dev, disk.cl);
 
 	cancel_delayed_work_sync(&dc->writeback_rate_update);
-	if (!IS_ERR_OR_NULL(dc->writeback_thread))
-		kthread_stop(dc->writeback_thread);
+	bch_cached_dev_writeback_stop(dc);
 
 	mutex_lock(&bch_register_lock);
 
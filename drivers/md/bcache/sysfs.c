@@ -77,6 +77,7 @@ rw_attribute(writeback_metadata);
 rw_attribute(writeback_running);
 rw_attribute(writeback_percent);
 rw_attribute(writeback_delay);
+rw_attribute(writeback_parallel);
 rw_attribute(writeback_rate);
 
 rw_attribute(writeback_rate_update_seconds);
@@ -125,6 +126,7 @@ SHOW(__bch_cached_dev)
 	var_printf(writeback_metadata,	"%i");
 	var_printf(writeback_running,	"%i");
 	var_print(writeback_delay);
+	var_print(writeback_parallel);
 	var_print(writeback_percent);
 	sysfs_hprint(writeback_rate,	dc->writeback_rate.rate << 9);
 
@@ -206,6 +208,9 @@ STORE(__cached_dev)
 	d_strtoul(writeback_running);
 	d_strtoul(writeback_delay);
 
+	sysfs_strtoul_clamp(writeback_parallel, dc->writeback_parallel,
+			    1, BCH_WB_NR_WORKERS);
+
 	sysfs_strtoul_clamp(writeback_percent, dc->writeback_percent, 0, 40);
 
 	sysfs_strtoul_clamp(writeback_rate,
@@ -293,7 +298,8 @@ STORE(bch_cached_dev)
 	mutex_lock(&bch_register_lock);
 	size = __cached_dev_store(kobj, attr, buf, size);
 
-	if (attr == &sysfs_writeback_running)
+	if (attr == &sysfs_writeback_running ||
+	    attr == &sysfs_writeback_parallel)
 		bch_writeback_queue(dc);
 
 	if (attr == &sysfs_writeback_percent)
@@ -315,6 +321,7 @@ static struct attribute *bch_cached_dev_files[] = {
 	&sysfs_writeback_metadata,
 	&sysfs_writeback_running,
 	&sysfs_writeback_delay,
+	&sysfs_writeback_parallel,
 	&sysfs_writeback_percent,
 	&sysfs_writeback_rate,
 	&sysfs_writeback_rate_update_seconds,
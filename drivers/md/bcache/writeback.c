@@ -88,11 +88,18 @@ static void update_writeback_rate(struct work_struct *work)
 
 static unsigned writeback_delay(struct cached_dev *dc, unsigned sectors)
 {
+	unsigned delay;
+
 	if (test_bit(BCACHE_DEV_DETACHING, &dc->disk.flags) ||
 	    !dc->writeback_percent)
 		return 0;
 
-	return bch_next_delay(&dc->writeback_rate, sectors);
+	/* The rate is shared by all the workers draining this device */
+	spin_lock(&dc->writeback_rate_lock);
+	delay = bch_next_delay(&dc->writeback_rate, sectors);
+	spin_unlock(&dc->writeback_rate_lock);
+
+	return delay;
 }
 
 struct dirty_io {
@@ -208,7 +215,34 @@ static void read_dirty_submit(struct closure *cl)
 	continue_at(cl, write_dirty, system_wq);
 }
 
-static void read_dirty(struct cached_dev *dc)
+/*
+ * Each worker prefers keys whose start offset falls in its own slice of the
+ * backing device, so concurrent workers stay sequential within their own
+ * region instead of interleaving seeks all over the disk.  If a worker's
+ * region is empty it steals unclaimed keys from the others rather than
+ * letting them back up.
+ */
+static struct keybuf_key *next_dirty_key(struct cached_dev *dc,
+					 struct bch_writeback_worker *wk)
+{
+	unsigned nr = clamp_t(unsigned, READ_ONCE(dc->writeback_parallel),
+			      1, BCH_WB_NR_WORKERS);
+	uint64_t per_worker = div64_u64(bdev_sectors(dc->bdev), nr) + 1;
+	struct keybuf_key *w;
+
+	if (wk->id >= nr)
+		return NULL;
+
+	w = bch_keybuf_next_region(&dc->writeback_keys,
+				   wk->id * per_worker,
+				   (wk->id + 1) * per_worker);
+	if (!w)
+		w = bch_keybuf_next(&dc->writeback_keys);
+
+	return w;
+}
+
+static void read_dirty(struct cached_dev *dc, struct bch_writeback_worker *wk)
 {
 	unsigned delay = 0;
 	struct keybuf_key *w;
@@ -224,18 +258,18 @@ static void read_dirty(struct cached_dev *dc)
 
 	while (!kthread_should_stop()) {
 
-		w = bch_keybuf_next(&dc->writeback_keys);
+		w = next_dirty_key(dc, wk);
 		if (!w)
 			break;
 
 		BUG_ON(ptr_stale(dc->disk.c, &w->key, 0));
 
-		if (KEY_START(&w->key) != dc->last_read ||
+		if (KEY_START(&w->key) != wk->last_read ||
 		    jiffies_to_msecs(delay) > 50)
 			while (!kthread_should_stop() && delay)
 				delay = schedule_timeout_interruptible(delay);
 
-		dc->last_read	= KEY_OFFSET(&w->key);
+		wk->last_read	= KEY_OFFSET(&w->key);
 
 		io = kzalloc(sizeof(struct dirty_io) + sizeof(struct bio_vec)
 			     * DIV_ROUND_UP(KEY_SIZE(&w->key), PAGE_SECTORS),
@@ -278,6 +312,65 @@ err:
 	closure_sync(&cl);
 }
 
+static bool dirty_keys_pending(struct keybuf *buf)
+{
+	struct keybuf_key *w;
+	bool ret = false;
+
+	spin_lock(&buf->lock);
+
+	for (w = RB_FIRST(&buf->keys, struct keybuf_key, node);
+	     w;
+	     w = RB_NEXT(w, node))
+		if (!w->private) {
+			ret = true;
+			break;
+		}
+
+	spin_unlock(&buf->lock);
+	return ret;
+}
+
+static int bch_writeback_worker(void *arg)
+{
+	struct bch_writeback_worker *wk = arg;
+	struct cached_dev *dc = wk->dc;
+
+	while (!kthread_should_stop()) {
+		read_dirty(dc, wk);
+
+		set_current_state(TASK_INTERRUPTIBLE);
+
+		if (kthread_should_stop()) {
+			__set_current_state(TASK_RUNNING);
+			break;
+		}
+
+		/*
+		 * New keys only show up via refill_dirty(), which wakes us
+		 * after every scan - so it's safe to sleep here as long as
+		 * there's nothing unclaimed left in the buffer (or we're
+		 * beyond the configured number of workers).
+		 */
+		if (wk->id >= READ_ONCE(dc->writeback_parallel) ||
+		    !dirty_keys_pending(&dc->writeback_keys))
+			schedule();
+		else
+			__set_current_state(TASK_RUNNING);
+	}
+
+	return 0;
+}
+
+static void bch_writeback_wake_workers(struct cached_dev *dc)
+{
+	unsigned i;
+
+	for (i = 0; i < BCH_WB_NR_WORKERS; i++)
+		if (!IS_ERR_OR_NULL(dc->writeback_workers[i].thread))
+			wake_up_process(dc->writeback_workers[i].thread);
+}
+
 /* Scan for dirty data */
 
 void bcache_dev_sectors_dirty_add(struct cache_set *c, unsigned inode,
@@ -444,7 +537,16 @@ static int bch_writeback_thread(void *arg)
 		up_write(&dc->writeback_lock);
 
 		bch_ratelimit_reset(&dc->writeback_rate);
-		read_dirty(dc);
+
+		/*
+		 * Let the region workers drain what we just found, and wait
+		 * for the buffer to empty before scanning for more.
+		 */
+		bch_writeback_wake_workers(dc);
+
+		wait_event_interruptible(dc->writeback_keys.wait,
+			 kthread_should_stop() ||
+			 RB_EMPTY_ROOT(&dc->writeback_keys.keys));
 
 		if (searched_full_index) {
 			unsigned delay = dc->writeback_delay * HZ;
@@ -496,12 +598,22 @@ void bch_sectors_dirty_init(struct cached_dev *dc)
 
 void bch_cached_dev_writeback_init(struct cached_dev *dc)
 {
+	unsigned i;
+
 	sema_init(&dc->in_flight, 64);
 	init_rwsem(&dc->writeback_lock);
+	spin_lock_init(&dc->writeback_rate_lock);
 	bch_keybuf_init(&dc->writeback_keys);
 
+	for (i = 0; i < BCH_WB_NR_WORKERS; i++) {
+		dc->writeback_workers[i].dc	= dc;
+		dc->writeback_workers[i].id	= i;
+		dc->writeback_workers[i].thread	= NULL;
+	}
+
 	dc->writeback_metadata		= true;
 	dc->writeback_running		= true;
+	dc->writeback_parallel		= 4;
 	dc->writeback_percent		= 10;
 	dc->writeback_delay		= 30;
 	dc->writeback_rate.rate		= 1024;
@@ -513,13 +625,43 @@ void bch_cached_dev_writeback_init(struct cached_dev *dc)
 	INIT_DELAYED_WORK(&dc->writeback_rate_update, update_writeback_rate);
 }
 
+void bch_cached_dev_writeback_stop(struct cached_dev *dc)
+{
+	unsigned i;
+
+	for (i = 0; i < BCH_WB_NR_WORKERS; i++)
+		if (!IS_ERR_OR_NULL(dc->writeback_workers[i].thread)) {
+			kthread_stop(dc->writeback_workers[i].thread);
+			dc->writeback_workers[i].thread = NULL;
+		}
+
+	if (!IS_ERR_OR_NULL(dc->writeback_thread))
+		kthread_stop(dc->writeback_thread);
+}
+
 int bch_cached_dev_writeback_start(struct cached_dev *dc)
 {
+	unsigned i;
+
 	dc->writeback_thread = kthread_create(bch_writeback_thread, dc,
 					      "bcache_writeback");
 	if (IS_ERR(dc->writeback_thread))
 		return PTR_ERR(dc->writeback_thread);
 
+	for (i = 0; i < BCH_WB_NR_WORKERS; i++) {
+		struct bch_writeback_worker *wk = &dc->writeback_workers[i];
+
+		wk->thread = kthread_create(bch_writeback_worker, wk,
+					    "bcache_wb_%u", i);
+		if (IS_ERR(wk->thread)) {
+			int ret = PTR_ERR(wk->thread);
+
+			wk->thread = NULL;
+			bch_cached_dev_writeback_stop(dc);
+			return ret;
+		}
+	}
+
 	schedule_delayed_work(&dc->writeback_rate_update,
 			      dc->writeback_rate_update_seconds * HZ);
 
@@ -87,5 +87,6 @@ void bcache_dev_sectors_dirty_add(struct cache_set *, unsigned, uint64_t, int);
 void bch_sectors_dirty_init(struct cached_dev *dc);
 void bch_cached_dev_writeback_init(struct cached_dev *);
 int bch_cached_dev_writeback_start(struct cached_dev *);
+void bch_cached_dev_writeback_stop(struct cached_dev *);
 
 #endif
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2017 Red Hat, Inc. All rights reserved.
+ *
+ * This file is released under the GPL.
+ *
+ * Latency oriented path selector.
+ *
+ * Tracks an exponentially weighted moving average of the measured
+ * service time of each path, kept separately per IO-size class so a
+ * stream of large sequential IO doesn't poison the estimate used for
+ * small random IO.  New IO is steered to the path with the lowest
+ * predicted completion time, scaled by the number of requests already
+ * in flight there, so traffic shifts away from a degrading path as
+ * soon as its completions start coming back slow rather than when a
+ * health checker notices.
+ */
+
+#include "dm.h"
+#include "dm-path-selector.h"
+
+#include <linux/slab.h>
+#include <linux/module.h>
+#include <linux/ktime.h>
+
+#define DM_MSG_PREFIX	"multipath latency-time"
+#define LT_MIN_IO	1
+#define LT_VERSION	"1.0.0"
+
+/*
+ * IO-size classes: <=4k, <=64k, <=512k, larger.
+ */
+#define LT_NR_SIZE_CLASSES	4
+
+/* EWMA weight for a new sample: 1/8 */
+#define LT_EWMA_SHIFT		3
+
+struct selector {
+	struct list_head valid_paths;
+	struct list_head failed_paths;
+	spinlock_t lock;
+};
+
+struct path_info {
+	struct list_head list;
+	struct dm_path *path;
+	unsigned repeat_count;
+	atomic_t in_flight;		/* Number of in-flight I/Os */
+	u64 ewma_nsecs[LT_NR_SIZE_CLASSES];
+};
+
+static int lt_size_class(size_t nr_bytes)
+{
+	if (nr_bytes <= 4096)
+		return 0;
+	if (nr_bytes <= 65536)
+		return 1;
+	if (nr_bytes <= 524288)
+		return 2;
+	return 3;
+}
+
+static struct selector *alloc_selector(void)
+{
+	struct selector *s = kmalloc(sizeof(*s), GFP_KERNEL);
+
+	if (s) {
+		INIT_LIST_HEAD(&s->valid_paths);
+		INIT_LIST_HEAD(&s->failed_paths);
+		spin_lock_init(&s->lock);
+	}
+
+	return s;
+}
+
+static int lt_create(struct path_selector *ps, unsigned argc, char **argv)
+{
+	struct selector *s = alloc_selector();
+
+	if (!s)
+		return -ENOMEM;
+
+	ps->context = s;
+	return 0;
+}
+
+static void free_paths(struct list_head *paths)
+{
+	struct path_info *pi, *next;
+
+	list_for_each_entry_safe(pi, next, paths, list) {
+		list_del(&pi->list);
+		kfree(pi);
+	}
+}
+
+static void lt_destroy(struct path_selector *ps)
+{
+	struct selector *s = ps->context;
+
+	free_paths(&s->valid_paths);
+	free_paths(&s->failed_paths);
+	kfree(s);
+	ps->context = NULL;
+}
+
+static int lt_status(struct path_selector *ps, struct dm_path *path,
+		     status_type_t type, char *result, unsigned maxlen)
+{
+	unsigned sz = 0;
+	struct path_info *pi;
+	int c;
+
+	if (!path)
+		DMEMIT("0 ");
+	else {
+		pi = path->pscontext;
+
+		switch (type) {
+		case STATUSTYPE_INFO:
+			DMEMIT("%d ", atomic_read(&pi->in_flight));
+			for (c = 0; c < LT_NR_SIZE_CLASSES; c++)
+				DMEMIT("%llu ",
+				       div64_u64(READ_ONCE(pi->ewma_nsecs[c]),
+						 NSEC_PER_USEC));
+			break;
+		case STATUSTYPE_TABLE:
+			DMEMIT("%u ", pi->repeat_count);
+			break;
+		}
+	}
+
+	return sz;
+}
+
+static int lt_add_path(struct path_selector *ps, struct dm_path *path,
+		       int argc, char **argv, char **error)
+{
+	struct selector *s = ps->context;
+	struct path_info *pi;
+	unsigned repeat_count = LT_MIN_IO;
+	char dummy;
+	unsigned long flags;
+
+	/*
+	 * Arguments: [<repeat_count>]
+	 * 	<repeat_count>: The number of I/Os before switching path.
+	 * 			If not given, default (LT_MIN_IO) is used.
+	 */
+	if (argc > 1) {
+		*error = "latency-time ps: incorrect number of arguments";
+		return -EINVAL;
+	}
+
+	if ((argc == 1) && (sscanf(argv[0], "%u%c", &repeat_count, &dummy) != 1)) {
+		*error = "latency-time ps: invalid repeat count";
+		return -EINVAL;
+	}
+
+	if (repeat_count > 1) {
+		DMWARN_LIMIT("repeat_count > 1 is deprecated, using 1 instead");
+		repeat_count = 1;
+	}
+
+	/* allocate the path */
+	pi = kzalloc(sizeof(*pi), GFP_KERNEL);
+	if (!pi) {
+		*error = "latency-time ps: Error allocating path context";
+		return -ENOMEM;
+	}
+
+	pi->path = path;
+	pi->repeat_count = repeat_count;
+	atomic_set(&pi->in_flight, 0);
+
+	path->pscontext = pi;
+
+	spin_lock_irqsave(&s->lock, flags);
+	list_add_tail(&pi->list, &s->valid_paths);
+	spin_unlock_irqrestore(&s->lock, flags);
+
+	return 0;
+}
+
+static void lt_fail_path(struct path_selector *ps, struct dm_path *path)
+{
+	struct selector *s = ps->context;
+	struct path_info *pi = path->pscontext;
+	unsigned long flags;
+
+	spin_lock_irqsave(&s->lock, flags);
+	list_move(&pi->list, &s->failed_paths);
+	spin_unlock_irqrestore(&s->lock, flags);
+}
+
+static int lt_reinstate_path(struct path_selector *ps, struct dm_path *path)
+{
+	struct selector *s = ps->context;
+	struct path_info *pi = path->pscontext;
+	unsigned long flags;
+	int c;
+
+	/* the old estimates are stale after a repair; start over */
+	for (c = 0; c < LT_NR_SIZE_CLASSES; c++)
+		WRITE_ONCE(pi->ewma_nsecs[c], 0);
+
+	spin_lock_irqsave(&s->lock, flags);
+	list_move_tail(&pi->list, &s->valid_paths);
+	spin_unlock_irqrestore(&s->lock, flags);
+
+	return 0;
+}
+
+/*
+ * Predicted time to complete the incoming IO on @pi: the averaged
+ * service time of its size class, scaled by the queue already built up
+ * on the path.  A path with no samples yet predicts zero so it gets
+ * probed, which is both how a fresh table warms up and how a
+ * reinstated path re-earns traffic.
+ */
+static u64 lt_predict(struct path_info *pi, int class)
+{
+	return READ_ONCE(pi->ewma_nsecs[class]) *
+		(atomic_read(&pi->in_flight) + 1);
+}
+
+static struct dm_path *lt_select_path(struct path_selector *ps,
+				      size_t nr_bytes)
+{
+	struct selector *s = ps->context;
+	struct path_info *pi = NULL, *best = NULL;
+	struct dm_path *ret = NULL;
+	int class = lt_size_class(nr_bytes);
+	u64 cost, best_cost = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&s->lock, flags);
+	if (list_empty(&s->valid_paths))
+		goto out;
+
+	/* Change preferred (first in list) path to evenly balance. */
+	list_move_tail(s->valid_paths.next, &s->valid_paths);
+
+	list_for_each_entry(pi, &s->valid_paths, list) {
+		cost = lt_predict(pi, class);
+		if (!best || cost < best_cost) {
+			best = pi;
+			best_cost = cost;
+		}
+	}
+
+	if (!best)
+		goto out;
+
+	ret = best->path;
+out:
+	spin_unlock_irqrestore(&s->lock, flags);
+	return ret;
+}
+
+static int lt_start_io(struct path_selector *ps, struct dm_path *path,
+		       size_t nr_bytes)
+{
+	struct path_info *pi = path->pscontext;
+
+	atomic_inc(&pi->in_flight);
+
+	return 0;
+}
+
+static int lt_end_io(struct path_selector *ps, struct dm_path *path,
+		     size_t nr_bytes, u64 start_time)
+{
+	struct path_info *pi = path->pscontext;
+	int class = lt_size_class(nr_bytes);
+	u64 now, value, ewma;
+
+	atomic_dec(&pi->in_flight);
+
+	if (!start_time)
+		return 0;
+
+	now = ktime_get_ns();
+	if (now < start_time)
+		return 0;
+	value = now - start_time;
+
+	/*
+	 * Lockless EWMA update; a lost race just drops one sample.
+	 */
+	ewma = READ_ONCE(pi->ewma_nsecs[class]);
+	if (ewma)
+		ewma += (value >> LT_EWMA_SHIFT) - (ewma >> LT_EWMA_SHIFT);
+	else
+		ewma = value;
+	WRITE_ONCE(pi->ewma_nsecs[class], ewma);
+
+	return 0;
+}
+
+static struct path_selector_type lt_ps = {
+	.name		= "latency-time",
+	.module		= THIS_MODULE,
+	.table_args	= 1,
+	.info_args	= 5,
+	.create		= lt_create,
+	.destroy	= lt_destroy,
+	.status		= lt_status,
+	.add_path	= lt_add_path,
+	.fail_path	= lt_fail_path,
+	.reinstate_path	= lt_reinstate_path,
+	.select_path	= lt_select_path,
+	.start_io	= lt_start_io,
+	.end_io		= lt_end_io,
+};
+
+static int __init dm_lt_init(void)
+{
+	int r = dm_register_path_selector(&lt_ps);
+
+	if (r < 0)
+		DMERR("register failed %d", r);
+
+	DMINFO("version " LT_VERSION " loaded");
+
+	return r;
+}
+
+static void __exit dm_lt_exit(void)
+{
+	int r = dm_unregister_path_selector(&lt_ps);
+
+	if (r < 0)
+		DMERR("unregister failed %d", r);
+}
+
+module_init(dm_lt_init);
+module_exit(dm_lt_exit);
+
+MODULE_DESCRIPTION(DM_NAME " latency oriented path selector");
+MODULE_LICENSE("GPL");
@@ -1018,6 +1018,16 @@ struct dm_target *dm_table_get_wildcard_target(struct dm_table *t)
 	return NULL;
 }
 
+struct dm_target *dm_table_get_passthrough_target(struct dm_table *t)
+{
+	/* Remapping in place is only safe if no other target is involved */
+	if (t->num_targets > 1 ||
+	    !dm_target_is_passthrough(t->targets[0].type))
+		return NULL;
+
+	return t->targets;
+}
+
 bool dm_table_bio_based(struct dm_table *t)
 {
 	return __table_type_bio_based(dm_table_get_type(t));
@@ -67,6 +67,9 @@ struct dm_io {
 	unsigned long start_time;
 	spinlock_t endio_lock;
 	struct dm_stats_aux stats_aux;
+	/* Original completion of a bio remapped in place, see __passthrough_bio */
+	bio_end_io_t *saved_bi_end_io;
+	void *saved_bi_private;
 };
 
 #define MINOR_ALLOCED ((void *)-1)
@@ -513,9 +516,9 @@ static void start_io_acct(struct dm_io *io)
 
 	cpu = part_stat_lock();
 	part_round_stats(cpu, &dm_disk(md)->part0);
+	part_inc_in_flight(cpu, &dm_disk(md)->part0, rw);
 	part_stat_unlock();
-	atomic_set(&dm_disk(md)->part0.in_flight[rw],
-		atomic_inc_return(&md->pending[rw]));
+	atomic_inc(&md->pending[rw]);
 
 	if (unlikely(dm_stats_used(&md->stats)))
 		dm_stats_account_io(&md->stats, bio_data_dir(bio),
@@ -543,7 +546,6 @@ static void end_io_acct(struct dm_io *io)
 	 * a flush.
 	 */
 	pending = atomic_dec_return(&md->pending[rw]);
-	atomic_set(&dm_disk(md)->part0.in_flight[rw], pending);
 	pending += atomic_read(&md->pending[rw^0x1]);
 
 	/* nudge anyone waiting on suspend queue */
@@ -1329,6 +1331,76 @@ static void __split_and_process_bio(struct mapped_device *md,
  * CRUD END
  *---------------------------------------------------------------*/
 
+static void passthrough_endio(struct bio *bio)
+{
+	struct dm_io *io = bio->bi_private;
+
+	bio->bi_end_io = io->saved_bi_end_io;
+	bio->bi_private = io->saved_bi_private;
+
+	dec_pending(io, bio->bi_error);
+}
+
+/*
+ * Fast path for tables consisting of a single passthrough target (the
+ * common whole-device dm-linear stack): let the target remap the
+ * original bio in place and resubmit it, skipping the clone allocation
+ * and splitting machinery.  A dm_io is still allocated so that suspend
+ * sees the bio as in flight and accounting keeps working.
+ *
+ * Returns false if the bio must take the normal splitting path instead.
+ */
+static bool __passthrough_bio(struct mapped_device *md, struct dm_table *map,
+			      struct bio *bio)
+{
+	struct dm_target *ti = dm_table_get_passthrough_target(map);
+	struct dm_io *io;
+	sector_t sector;
+	int r;
+
+	if (!ti)
+		return false;
+	/* Empty flushes are duplicated across devices by the slow path */
+	if (bio->bi_opf & REQ_PREFLUSH)
+		return false;
+	/*
+	 * dm-stats wants the submitted sector/length at completion time,
+	 * but an in-place remapped bio has an exhausted iterator by then.
+	 */
+	if (unlikely(dm_stats_used(&md->stats)))
+		return false;
+
+	io = alloc_io(md);
+	io->error = 0;
+	atomic_set(&io->io_count, 1);
+	io->bio = bio;
+	io->md = md;
+	spin_lock_init(&io->endio_lock);
+	io->saved_bi_end_io = bio->bi_end_io;
+	io->saved_bi_private = bio->bi_private;
+	bio->bi_end_io = passthrough_endio;
+	bio->bi_private = io;
+	sector = bio->bi_iter.bi_sector;
+
+	start_io_acct(io);
+
+	r = ti->type->map(ti, bio);
+	if (r == DM_MAPIO_REMAPPED) {
+		trace_block_bio_remap(bdev_get_queue(bio->bi_bdev), bio,
+				      disk_devt(dm_disk(md)), sector);
+		generic_make_request(bio);
+	} else if (r < 0 || r == DM_MAPIO_REQUEUE) {
+		bio->bi_end_io = io->saved_bi_end_io;
+		bio->bi_private = io->saved_bi_private;
+		dec_pending(io, r);
+	} else {
+		DMWARN("unimplemented passthrough map return value: %d", r);
+		BUG();
+	}
+
+	return true;
+}
+
 /*
  * The request function that just remaps the bio built up by
  * dm_merge_bvec.
@@ -1355,6 +1427,11 @@ static blk_qc_t dm_make_request(struct request_queue *q, struct bio *bio)
 		return BLK_QC_T_NONE;
 	}
 
+	if (likely(map) && __passthrough_bio(md, map, bio)) {
+		dm_put_live_table(md, srcu_idx);
+		return BLK_QC_T_NONE;
+	}
+
 	__split_and_process_bio(md, map, bio);
 	dm_put_live_table(md, srcu_idx);
 	return BLK_QC_T_NONE;
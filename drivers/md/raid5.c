@@ -5047,12 +5047,27 @@ static int raid5_read_one_chunk(struct mddev *mddev, struct bio *raid_bio)
 		/* No reshape active, so we can trust rdev->data_offset */
 		align_bi->bi_iter.bi_sector += rdev->data_offset;
 
-		spin_lock_irq(&conf->device_lock);
-		wait_event_lock_irq(conf->wait_for_quiescent,
-				    conf->quiesce == 0,
-				    conf->device_lock);
+		/*
+		 * Quiesce is rare, so don't serialize every aligned read on
+		 * device_lock just to check for it.  Take the reference
+		 * first; if a quiesce raced in, back out and fall into the
+		 * locked slow path.  The barrier pairs with the one in
+		 * raid5_quiesce() between setting ->quiesce and sampling
+		 * ->active_aligned_reads.
+		 */
 		atomic_inc(&conf->active_aligned_reads);
-		spin_unlock_irq(&conf->device_lock);
+		smp_mb__after_atomic();
+		if (unlikely(READ_ONCE(conf->quiesce))) {
+			if (atomic_dec_and_test(&conf->active_aligned_reads))
+				wake_up(&conf->wait_for_quiescent);
+
+			spin_lock_irq(&conf->device_lock);
+			wait_event_lock_irq(conf->wait_for_quiescent,
+					    conf->quiesce == 0,
+					    conf->device_lock);
+			atomic_inc(&conf->active_aligned_reads);
+			spin_unlock_irq(&conf->device_lock);
+		}
 
 		if (mddev->gendisk)
 			trace_block_bio_remap(bdev_get_queue(align_bi->bi_bdev),
@@ -7825,6 +7840,12 @@ static void raid5_quiesce(struct mddev *mddev, int state)
 		 */
 		r5c_flush_cache(conf, INT_MAX);
 		conf->quiesce = 2;
+		/*
+		 * Order setting ->quiesce before sampling
+		 * ->active_aligned_reads below; pairs with the lockless
+		 * fast path in raid5_read_one_chunk().
+		 */
+		smp_mb();
 		wait_event_cmd(conf->wait_for_quiescent,
 				    atomic_read(&conf->active_stripes) == 0 &&
 				    atomic_read(&conf->active_aligned_reads) == 0,
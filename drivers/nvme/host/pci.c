@@ -667,14 +667,26 @@ static inline bool nvme_cqe_valid(struct nvme_queue *nvmeq, u16 head,
 	return (le16_to_cpu(nvmeq->cqes[head].status) & 1) == phase;
 }
 
+/* CQEs harvested per pass before running one blk-mq completion sweep */
+#define NVME_CQ_REAP_BATCH	16
+
 static void __nvme_process_cq(struct nvme_queue *nvmeq, unsigned int *tag)
 {
+	struct request *reqs[NVME_CQ_REAP_BATCH];
+	int errors[NVME_CQ_REAP_BATCH];
+	unsigned int nr;
 	u16 head, phase;
 
 	head = nvmeq->cq_head;
 	phase = nvmeq->cq_phase;
 
-	while (nvme_cqe_valid(nvmeq, head, phase)) {
+	/*
+	 * Harvest a batch of CQEs first, then complete them in one pass
+	 * so the fixed per-completion costs are amortized.
+	 */
+again:
+	nr = 0;
+	while (nr < NVME_CQ_REAP_BATCH && nvme_cqe_valid(nvmeq, head, phase)) {
 		struct nvme_completion cqe = nvmeq->cqes[head];
 		struct request *req;
 
@@ -708,9 +720,16 @@ static void __nvme_process_cq(struct nvme_queue *nvmeq, unsigned int *tag)
 
 		req = blk_mq_tag_to_rq(*nvmeq->tags, cqe.command_id);
 		nvme_req(req)->result = cqe.result;
-		blk_mq_complete_request(req, le16_to_cpu(cqe.status) >> 1);
+		reqs[nr] = req;
+		errors[nr] = le16_to_cpu(cqe.status) >> 1;
+		nr++;
 	}
 
+	if (nr)
+		blk_mq_complete_request_batch(reqs, errors, nr);
+	if (nvme_cqe_valid(nvmeq, head, phase))
+		goto again;
+
 	if (head == nvmeq->cq_head && phase == nvmeq->cq_phase)
 		return;
 
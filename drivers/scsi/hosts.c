@@ -23,6 +23,7 @@
 
 #include <linux/module.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/kthread.h>
@@ -604,6 +605,36 @@ struct Scsi_Host *scsi_host_get(struct Scsi_Host *shost)
 }
 EXPORT_SYMBOL(scsi_host_get);
 
+static void scsi_host_check_in_flight(struct request *rq, void *data,
+				      bool reserved)
+{
+	int *count = data;
+
+	if (blk_mq_request_started(rq))
+		(*count)++;
+}
+
+/**
+ * scsi_host_busy - Return the host busy counter
+ * @shost:	Pointer to Scsi_Host to inc.
+ *
+ * For blk-mq hosts the host wide counter is not maintained in the hot
+ * path; the in flight commands are counted from the tag map instead.
+ **/
+unsigned int scsi_host_busy(struct Scsi_Host *shost)
+{
+	int cnt = 0;
+
+	if (shost->use_blk_mq)
+		blk_mq_tagset_busy_iter(&shost->tag_set,
+					scsi_host_check_in_flight, &cnt);
+	else
+		cnt = atomic_read(&shost->host_busy);
+
+	return cnt;
+}
+EXPORT_SYMBOL(scsi_host_busy);
+
 /**
  * scsi_host_put - dec a Scsi_Host ref count
  * @shost:	Pointer to Scsi_Host to dec.
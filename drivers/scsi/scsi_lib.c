@@ -15,6 +15,7 @@
 #include <linux/kernel.h>
 #include <linux/export.h>
 #include <linux/init.h>
+#include <linux/moduleparam.h>
 #include <linux/pci.h>
 #include <linux/delay.h>
 #include <linux/hardirq.h>
@@ -47,6 +48,18 @@ struct kmem_cache *scsi_sdb_cache;
  */
 #define SCSI_QUEUE_DELAY	3
 
+/*
+ * If set, blk-mq queues complete requests on the CPU that submitted
+ * them (rq_affinity=2) instead of any CPU in the same cache domain.
+ * Useful on dense JBOD setups where the per-command cache line
+ * bouncing of cross-CPU completions is measurable.
+ */
+static bool scsi_mq_same_cpu_comp;
+module_param_named(mq_same_cpu_comp, scsi_mq_same_cpu_comp, bool,
+		   S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mq_same_cpu_comp,
+	"Complete blk-mq requests on the submitting CPU (default: off)");
+
 static void
 scsi_set_blocked(struct scsi_cmnd *cmd, int reason)
 {
@@ -287,7 +300,8 @@ void scsi_device_unbusy(struct scsi_device *sdev)
 	struct scsi_target *starget = scsi_target(sdev);
 	unsigned long flags;
 
-	atomic_dec(&shost->host_busy);
+	if (!shost->use_blk_mq)
+		atomic_dec(&shost->host_busy);
 	if (starget->can_queue > 0)
 		atomic_dec(&starget->target_busy);
 
@@ -1429,7 +1443,15 @@ static inline int scsi_host_queue_ready(struct request_queue *q,
 	if (scsi_host_in_recovery(shost))
 		return 0;
 
-	busy = atomic_inc_return(&shost->host_busy) - 1;
+	/*
+	 * blk-mq hosts are bounded by the shared tag map, which already
+	 * caps the number of in flight commands at shost->can_queue;
+	 * don't duplicate that accounting in a host wide atomic.
+	 */
+	if (!shost->use_blk_mq)
+		busy = atomic_inc_return(&shost->host_busy) - 1;
+	else
+		busy = 0;
 	if (atomic_read(&shost->host_blocked) > 0) {
 		if (busy)
 			goto starved;
@@ -1466,7 +1488,8 @@ starved:
 		list_add_tail(&sdev->starved_entry, &shost->starved_list);
 	spin_unlock_irq(shost->host_lock);
 out_dec:
-	atomic_dec(&shost->host_busy);
+	if (!shost->use_blk_mq)
+		atomic_dec(&shost->host_busy);
 	return 0;
 }
 
@@ -1940,7 +1963,7 @@ static int scsi_queue_rq(struct blk_mq_hw_ctx *hctx,
 	return BLK_MQ_RQ_QUEUE_OK;
 
 out_dec_host_busy:
-	atomic_dec(&shost->host_busy);
+	/* host_busy is not maintained for blk-mq hosts */
 out_dec_target_busy:
 	if (scsi_target(sdev)->can_queue > 0)
 		atomic_dec(&scsi_target(sdev)->target_busy);
@@ -2111,6 +2134,9 @@ struct request_queue *scsi_mq_alloc_queue(struct scsi_device *sdev)
 
 	sdev->request_queue->queuedata = sdev;
 	__scsi_init_queue(sdev->host, sdev->request_queue);
+	if (scsi_mq_same_cpu_comp)
+		queue_flag_set_unlocked(QUEUE_FLAG_SAME_FORCE,
+					sdev->request_queue);
 	return sdev->request_queue;
 }
 
@@ -376,12 +376,17 @@ static int vaddr_get_pfn(struct mm_struct *mm, unsigned long vaddr,
  * the iommu can only map chunks of consecutive pfns anyway, so get the
  * first page and all consecutive pages with the same locking.
  */
+/* One page of page pointers per get_user_pages_fast() call */
+#define VFIO_PIN_BATCH (PAGE_SIZE / sizeof(struct page *))
+
 static long vfio_pin_pages_remote(struct vfio_dma *dma, unsigned long vaddr,
 				  long npage, unsigned long *pfn_base)
 {
 	unsigned long pfn = 0, limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
 	bool lock_cap = capable(CAP_IPC_LOCK);
 	long ret, pinned = 0, lock_acct = 0;
+	long batch_cap, got, n, i;
+	struct page **batch, *fallback[1];
 	bool rsvd;
 	dma_addr_t iova = vaddr - dma->vaddr + dma->iova;
 
@@ -413,32 +418,88 @@ static long vfio_pin_pages_remote(struct vfio_dma *dma, unsigned long vaddr,
 	if (unlikely(disable_hugepages))
 		goto out;
 
-	/* Lock all the consecutive pages from pfn_base */
-	for (vaddr += PAGE_SIZE, iova += PAGE_SIZE; pinned < npage;
-	     pinned++, vaddr += PAGE_SIZE, iova += PAGE_SIZE) {
-		ret = vaddr_get_pfn(current->mm, vaddr, dma->prot, &pfn);
-		if (ret)
-			break;
+	vaddr += PAGE_SIZE;
+	iova += PAGE_SIZE;
 
-		if (pfn != *pfn_base + pinned ||
-		    rsvd != is_invalid_reserved_pfn(pfn)) {
-			put_pfn(pfn, dma->prot);
-			break;
-		}
+	if (rsvd) {
+		/*
+		 * PFNMAP runs are not gup-able; walk them page by page
+		 * as before.
+		 */
+		for (; pinned < npage;
+		     pinned++, vaddr += PAGE_SIZE, iova += PAGE_SIZE) {
+			ret = vaddr_get_pfn(current->mm, vaddr, dma->prot,
+					    &pfn);
+			if (ret)
+				break;
 
-		if (!rsvd && !vfio_find_vpfn(dma, iova)) {
-			if (!lock_cap &&
-			    current->mm->locked_vm + lock_acct + 1 > limit) {
+			if (pfn != *pfn_base + pinned ||
+			    !is_invalid_reserved_pfn(pfn)) {
 				put_pfn(pfn, dma->prot);
-				pr_warn("%s: RLIMIT_MEMLOCK (%ld) exceeded\n",
-					__func__, limit << PAGE_SHIFT);
-				ret = -ENOMEM;
-				goto unpin_out;
+				break;
 			}
-			lock_acct++;
 		}
+		goto out;
 	}
 
+	/*
+	 * Pin the remainder of the consecutive run in batches rather
+	 * than one gup call per 4K page; page table walk and refcount
+	 * overhead dominates large mappings otherwise.
+	 */
+	batch = (struct page **) __get_free_page(GFP_KERNEL);
+	batch_cap = batch ? VFIO_PIN_BATCH : 1;
+	if (!batch)
+		batch = fallback;
+
+	while (pinned < npage) {
+		n = min_t(long, npage - pinned, batch_cap);
+
+		got = get_user_pages_fast(vaddr, n,
+					  !!(dma->prot & IOMMU_WRITE), batch);
+		if (got <= 0)
+			break;
+
+		for (i = 0; i < got; i++) {
+			pfn = page_to_pfn(batch[i]);
+
+			if (pfn != *pfn_base + pinned ||
+			    is_invalid_reserved_pfn(pfn)) {
+				for (; i < got; i++)
+					put_pfn(page_to_pfn(batch[i]),
+						dma->prot);
+				goto out_free;
+			}
+
+			if (!vfio_find_vpfn(dma, iova)) {
+				if (!lock_cap &&
+				    current->mm->locked_vm + lock_acct + 1 >
+				    limit) {
+					for (; i < got; i++)
+						put_pfn(page_to_pfn(batch[i]),
+							dma->prot);
+					pr_warn("%s: RLIMIT_MEMLOCK (%ld) exceeded\n",
+						__func__, limit << PAGE_SHIFT);
+					ret = -ENOMEM;
+					if (batch != fallback)
+						free_page((unsigned long)batch);
+					goto unpin_out;
+				}
+				lock_acct++;
+			}
+
+			pinned++;
+			vaddr += PAGE_SIZE;
+			iova += PAGE_SIZE;
+		}
+
+		if (got < n)
+			break;
+	}
+
+out_free:
+	if (batch != fallback)
+		free_page((unsigned long)batch);
 out:
 	ret = vfio_lock_acct(current, lock_acct, &lock_cap);
 
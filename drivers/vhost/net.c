@@ -43,6 +43,11 @@ MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 #define VHOST_MAX_PEND 128
 #define VHOST_GOODCOPY_LEN 256
 
+/* Used buffers accumulated before the used ring is updated and the
+ * guest is notified.  Bounds the notification amplification under load.
+ */
+#define VHOST_NET_BATCH 64
+
 /*
  * For transmit, used buffer len is unused; we override it to track buffer
  * status internally; used for zerocopy tx only.
@@ -253,13 +258,16 @@ static void vhost_zerocopy_signal_used(struct vhost_net *net,
 		} else
 			break;
 	}
+	if (!j)
+		return;
 	while (j) {
 		add = min(UIO_MAXIOV - nvq->done_idx, j);
-		vhost_add_used_and_signal_n(vq->dev, vq,
-					    &vq->heads[nvq->done_idx], add);
+		vhost_add_used_n(vq, &vq->heads[nvq->done_idx], add);
 		nvq->done_idx = (nvq->done_idx + add) % UIO_MAXIOV;
 		j -= add;
 	}
+	/* Signal the guest once per batch of completions, not per chunk */
+	vhost_signal(vq->dev, vq);
 }
 
 static void vhost_zerocopy_callback(struct ubuf_info *ubuf, bool success)
@@ -288,6 +296,22 @@ static void vhost_zerocopy_callback(struct ubuf_info *ubuf, bool success)
 	rcu_read_unlock_bh();
 }
 
+/* Flush used buffers batched in vq->heads[0..done_idx) and notify the
+ * guest once.  Only used on queues that do not do zerocopy, where
+ * done_idx is free to act as a batch counter.
+ */
+static void vhost_net_signal_used(struct vhost_net_virtqueue *nvq)
+{
+	struct vhost_virtqueue *vq = &nvq->vq;
+	struct vhost_dev *dev = vq->dev;
+
+	if (!nvq->done_idx)
+		return;
+
+	vhost_add_used_and_signal_n(dev, vq, vq->heads, nvq->done_idx);
+	nvq->done_idx = 0;
+}
+
 static inline unsigned long busy_clock(void)
 {
 	return local_clock() >> 10;
@@ -406,6 +430,8 @@ static void handle_tx(struct vhost_net *net)
 			break;
 		/* Nothing new?  Wait for eventfd to tell us they refilled. */
 		if (head == vq->num) {
+			if (!zcopy)
+				vhost_net_signal_used(nvq);
 			if (unlikely(vhost_enable_notify(&net->dev, vq))) {
 				vhost_disable_notify(&net->dev, vq);
 				continue;
@@ -468,10 +494,23 @@ static void handle_tx(struct vhost_net *net)
 		if (err != len)
 			pr_debug("Truncated TX packet: "
 				 " len %d != %zd\n", err, len);
-		if (!zcopy_used)
-			vhost_add_used_and_signal(&net->dev, vq, head, 0);
-		else
+		if (!zcopy_used) {
+			if (zcopy) {
+				/* done_idx belongs to the zerocopy
+				 * machinery, signal right away.
+				 */
+				vhost_add_used_and_signal(&net->dev, vq,
+							  head, 0);
+			} else {
+				vq->heads[nvq->done_idx].id =
+					cpu_to_vhost32(vq, head);
+				vq->heads[nvq->done_idx].len = 0;
+				if (++nvq->done_idx >= VHOST_NET_BATCH)
+					vhost_net_signal_used(nvq);
+			}
+		} else {
 			vhost_zerocopy_signal_used(net, vq);
+		}
 		total_len += len;
 		vhost_net_tx_packet(net);
 		if (unlikely(total_len >= VHOST_NET_WEIGHT)) {
@@ -479,6 +518,8 @@ static void handle_tx(struct vhost_net *net)
 			break;
 		}
 	}
+	if (!zcopy)
+		vhost_net_signal_used(nvq);
 out:
 	mutex_unlock(&vq->mutex);
 }
@@ -517,12 +558,17 @@ static int sk_has_rx_data(struct sock *sk)
 
 static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk)
 {
+	struct vhost_net_virtqueue *rvq = &net->vqs[VHOST_NET_VQ_RX];
 	struct vhost_net_virtqueue *nvq = &net->vqs[VHOST_NET_VQ_TX];
 	struct vhost_virtqueue *vq = &nvq->vq;
 	unsigned long uninitialized_var(endtime);
 	int len = peek_head_len(sk);
 
 	if (!len && vq->busyloop_timeout) {
+		/* Flush batched heads first so the guest can refill
+		 * while we busy poll.
+		 */
+		vhost_net_signal_used(rvq);
 		/* Both tx vq and rx socket were polled here */
 		mutex_lock(&vq->mutex);
 		vhost_disable_notify(&net->dev, vq);
@@ -673,9 +719,10 @@ static void handle_rx(struct vhost_net *net)
 	while ((sock_len = vhost_net_rx_peek_head_len(net, sock->sk))) {
 		sock_len += sock_hlen;
 		vhost_len = sock_len + vhost_hlen;
-		headcount = get_rx_bufs(vq, vq->heads, vhost_len,
-					&in, vq_log, &log,
-					likely(mergeable) ? UIO_MAXIOV : 1);
+		headcount = get_rx_bufs(vq, vq->heads + nvq->done_idx,
+					vhost_len, &in, vq_log, &log,
+					likely(mergeable) ?
+					UIO_MAXIOV - nvq->done_idx : 1);
 		/* On error, stop handling until the next kick. */
 		if (unlikely(headcount < 0))
 			goto out;
@@ -689,6 +736,7 @@ static void handle_rx(struct vhost_net *net)
 		}
 		/* OK, now we need to know about added descriptors. */
 		if (!headcount) {
+			vhost_net_signal_used(nvq);
 			if (unlikely(vhost_enable_notify(&net->dev, vq))) {
 				/* They have slipped one in as we were
 				 * doing that: check again. */
@@ -743,8 +791,9 @@ static void handle_rx(struct vhost_net *net)
 			vhost_discard_vq_desc(vq, headcount);
 			goto out;
 		}
-		vhost_add_used_and_signal_n(&net->dev, vq, vq->heads,
-					    headcount);
+		nvq->done_idx += headcount;
+		if (nvq->done_idx > VHOST_NET_BATCH)
+			vhost_net_signal_used(nvq);
 		if (unlikely(vq_log))
 			vhost_log_write(vq, vq_log, log, vhost_len);
 		total_len += vhost_len;
@@ -755,6 +804,7 @@ static void handle_rx(struct vhost_net *net)
 	}
 	vhost_net_enable_vq(net, vq);
 out:
+	vhost_net_signal_used(nvq);
 	mutex_unlock(&vq->mutex);
 }
 
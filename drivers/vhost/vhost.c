@@ -292,6 +292,8 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 	vq->last_avail_idx = 0;
 	vq->last_used_event = 0;
 	vq->avail_idx = 0;
+	vq->avail_cache_idx = 0;
+	vq->avail_cache_cnt = 0;
 	vq->last_used_idx = 0;
 	vq->signalled_used = 0;
 	vq->signalled_used_valid = false;
@@ -1328,6 +1330,7 @@ long vhost_vring_ioctl(struct vhost_dev *d, int ioctl, void __user *argp)
 		vq->last_avail_idx = vq->last_used_event = s.num;
 		/* Forget the cached index value. */
 		vq->avail_idx = vq->last_avail_idx;
+		vq->avail_cache_cnt = 0;
 		break;
 	case VHOST_GET_VRING_BASE:
 		s.index = idx;
@@ -1390,6 +1393,8 @@ long vhost_vring_ioctl(struct vhost_dev *d, int ioctl, void __user *argp)
 		vq->avail = (void __user *)(unsigned long)a.avail_user_addr;
 		vq->log_addr = a.log_guest_addr;
 		vq->used = (void __user *)(unsigned long)a.used_user_addr;
+		/* The cached avail ring chunk refers to the old ring */
+		vq->avail_cache_cnt = 0;
 		break;
 	case VHOST_SET_VRING_KICK:
 		if (copy_from_user(&f, argp, sizeof f)) {
@@ -1951,14 +1956,35 @@ int vhost_get_vq_desc(struct vhost_virtqueue *vq,
 	smp_rmb();
 
 	/* Grab the next descriptor number they're advertising, and increment
-	 * the index we've seen. */
-	if (unlikely(vhost_get_user(vq, ring_head,
-		     &vq->avail->ring[last_avail_idx & (vq->num - 1)]))) {
-		vq_err(vq, "Failed to read head: idx %d address %p\n",
-		       last_avail_idx,
-		       &vq->avail->ring[last_avail_idx % vq->num]);
-		return -EFAULT;
+	 * the index we've seen.  Heads are fetched from the avail ring a
+	 * chunk at a time, turning one user copy per descriptor into one
+	 * per chunk when the ring is kept busy.  Entries between
+	 * last_avail_idx and avail_idx belong to us and may not be
+	 * changed by the guest until we use them, so the cache stays
+	 * valid across calls and across vhost_discard_vq_desc().
+	 */
+	if (unlikely((u16)(last_avail_idx - vq->avail_cache_idx) >=
+		     vq->avail_cache_cnt)) {
+		u16 chunk = min3((u16)(vq->avail_idx - last_avail_idx),
+				 (u16)VHOST_AVAIL_CACHE,
+				 (u16)(vq->num -
+				       (last_avail_idx & (vq->num - 1))));
+
+		vq->avail_cache_cnt = 0;
+		if (unlikely(vhost_copy_from_user(vq, vq->avail_cache,
+				&vq->avail->ring[last_avail_idx &
+						 (vq->num - 1)],
+				chunk * sizeof(__virtio16)))) {
+			vq_err(vq, "Failed to read head: idx %d address %p\n",
+			       last_avail_idx,
+			       &vq->avail->ring[last_avail_idx % vq->num]);
+			return -EFAULT;
+		}
+		vq->avail_cache_idx = last_avail_idx;
+		vq->avail_cache_cnt = chunk;
 	}
+	ring_head = vq->avail_cache[(u16)(last_avail_idx -
+					  vq->avail_cache_idx)];
 
 	head = vhost16_to_cpu(vq, ring_head);
 
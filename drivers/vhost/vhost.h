@@ -104,6 +104,14 @@ struct vhost_virtqueue {
 	/* Caches available index value from user. */
 	u16 avail_idx;
 
+	/* Chunk of the avail ring fetched in one user copy.
+	 * avail_cache_idx is the guest index of avail_cache[0].
+	 */
+#define VHOST_AVAIL_CACHE 64
+	__virtio16 avail_cache[VHOST_AVAIL_CACHE];
+	u16 avail_cache_idx;
+	u16 avail_cache_cnt;
+
 	/* Last index we used. */
 	u16 last_used_idx;
 
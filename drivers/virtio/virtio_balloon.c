@@ -31,6 +31,7 @@
 #include <linux/wait.h>
 #include <linux/mm.h>
 #include <linux/mount.h>
+#include <linux/page_reporting.h>
 
 /*
  * Balloon device works in 4K page units.  So each page is pointed to by
@@ -50,9 +51,20 @@ MODULE_PARM_DESC(oom_pages, "pages to free on OOM");
 static struct vfsmount *balloon_mnt;
 #endif
 
+/*
+ * The feature bit belongs in the uapi virtio_balloon.h; keep a local
+ * definition so the driver builds against older headers too.
+ */
+#ifndef VIRTIO_BALLOON_F_REPORTING
+#define VIRTIO_BALLOON_F_REPORTING	5 /* Page reporting virtqueue */
+#endif
+
 struct virtio_balloon {
 	struct virtio_device *vdev;
-	struct virtqueue *inflate_vq, *deflate_vq, *stats_vq;
+	struct virtqueue *inflate_vq, *deflate_vq, *stats_vq, *reporting_vq;
+
+	/* Free page reporting device */
+	struct page_reporting_dev_info pr_dev_info;
 
 	/* The balloon servicing is delegated to a freezable workqueue. */
 	struct work_struct update_balloon_stats_work;
@@ -401,27 +413,63 @@ static void update_balloon_size_func(struct work_struct *work)
 		queue_work(system_freezable_wq, work);
 }
 
+static int virtballoon_free_page_report(struct page_reporting_dev_info *prdev,
+					struct scatterlist *sg,
+					unsigned int nents)
+{
+	struct virtio_balloon *vb = container_of(prdev, struct virtio_balloon,
+						 pr_dev_info);
+	struct virtqueue *vq = vb->reporting_vq;
+	unsigned int unused;
+	int err;
+
+	/* We should always be able to add these buffers to an empty queue. */
+	err = virtqueue_add_outbuf(vq, sg, nents, vb,
+				   GFP_NOWAIT | __GFP_NOWARN);
+	if (err)
+		return err;
+	virtqueue_kick(vq);
+
+	/* When host has read buffer, this completes via balloon_ack */
+	wait_event(vb->acked, virtqueue_get_buf(vq, &unused));
+
+	return 0;
+}
+
 static int init_vqs(struct virtio_balloon *vb)
 {
-	struct virtqueue *vqs[3];
-	vq_callback_t *callbacks[] = { balloon_ack, balloon_ack, stats_request };
-	static const char * const names[] = { "inflate", "deflate", "stats" };
-	int err, nvqs;
+	struct virtqueue *vqs[4];
+	vq_callback_t *callbacks[4] = { balloon_ack, balloon_ack };
+	const char *names[4] = { "inflate", "deflate" };
+	int err, nvqs = 2;
+	int stats_idx = -1, reporting_idx = -1;
 
 	/*
 	 * We expect two virtqueues: inflate and deflate, and
-	 * optionally stat.
+	 * optionally stat and free page reporting.
 	 */
-	nvqs = virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_STATS_VQ) ? 3 : 2;
+	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_STATS_VQ)) {
+		stats_idx = nvqs;
+		callbacks[nvqs] = stats_request;
+		names[nvqs++] = "stats";
+	}
+	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_REPORTING)) {
+		reporting_idx = nvqs;
+		callbacks[nvqs] = balloon_ack;
+		names[nvqs++] = "reporting_vq";
+	}
+
 	err = vb->vdev->config->find_vqs(vb->vdev, nvqs, vqs, callbacks, names);
 	if (err)
 		return err;
 
 	vb->inflate_vq = vqs[0];
 	vb->deflate_vq = vqs[1];
+	if (reporting_idx >= 0)
+		vb->reporting_vq = vqs[reporting_idx];
 	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_STATS_VQ)) {
 		struct scatterlist sg;
-		vb->stats_vq = vqs[2];
+		vb->stats_vq = vqs[stats_idx];
 
 		/*
 		 * Prime this virtqueue with one buffer so the hypervisor can
@@ -577,12 +625,26 @@ static int virtballoon_probe(struct virtio_device *vdev)
 	vb->vb_dev_info.inode->i_mapping->a_ops = &balloon_aops;
 #endif
 
+	if (virtio_has_feature(vdev, VIRTIO_BALLOON_F_REPORTING)) {
+		vb->pr_dev_info.report = virtballoon_free_page_report;
+		err = page_reporting_register(&vb->pr_dev_info);
+		if (err)
+			goto out_unregister_oom;
+	}
+
 	virtio_device_ready(vdev);
 
 	if (towards_target(vb))
 		virtballoon_changed(vdev);
 	return 0;
 
+out_unregister_oom:
+	unregister_oom_notifier(&vb->nb);
+#ifdef CONFIG_BALLOON_COMPACTION
+	if (vb->vb_dev_info.inode)
+		iput(vb->vb_dev_info.inode);
+	kern_unmount(balloon_mnt);
+#endif
 out_del_vqs:
 	vdev->config->del_vqs(vdev);
 out_free_vb:
@@ -608,6 +670,8 @@ static void virtballoon_remove(struct virtio_device *vdev)
 {
 	struct virtio_balloon *vb = vdev->priv;
 
+	if (virtio_has_feature(vdev, VIRTIO_BALLOON_F_REPORTING))
+		page_reporting_unregister(&vb->pr_dev_info);
 	unregister_oom_notifier(&vb->nb);
 
 	spin_lock_irq(&vb->stop_update_lock);
@@ -635,6 +699,8 @@ static int virtballoon_freeze(struct virtio_device *vdev)
 	 * The workqueue is already frozen by the PM core before this
 	 * function is called.
 	 */
+	if (virtio_has_feature(vdev, VIRTIO_BALLOON_F_REPORTING))
+		page_reporting_unregister(&vb->pr_dev_info);
 	remove_common(vb);
 	return 0;
 }
@@ -648,6 +714,12 @@ static int virtballoon_restore(struct virtio_device *vdev)
 	if (ret)
 		return ret;
 
+	if (virtio_has_feature(vdev, VIRTIO_BALLOON_F_REPORTING)) {
+		ret = page_reporting_register(&vb->pr_dev_info);
+		if (ret)
+			return ret;
+	}
+
 	virtio_device_ready(vdev);
 
 	if (towards_target(vb))
@@ -661,6 +733,7 @@ static unsigned int features[] = {
 	VIRTIO_BALLOON_F_MUST_TELL_HOST,
 	VIRTIO_BALLOON_F_STATS_VQ,
 	VIRTIO_BALLOON_F_DEFLATE_ON_OOM,
+	VIRTIO_BALLOON_F_REPORTING,
 };
 
 static struct virtio_driver virtio_balloon_driver = {
@@ -37,6 +37,7 @@
 #include <linux/blkdev.h>
 #include <linux/compat.h>
 #include <linux/migrate.h>
+#include <linux/pagemap.h>
 #include <linux/ramfs.h>
 #include <linux/percpu-refcount.h>
 #include <linux/mount.h>
@@ -65,6 +66,25 @@ struct aio_ring {
 	struct io_event		io_events[0];
 }; /* 128 bytes + ring size */
 
+/* io_setup2() flags */
+#define AIO_SETUP_SQRING	(1 << 0)
+
+/*
+ * Optional submission ring, created by io_setup2() with AIO_SETUP_SQRING
+ * and mapped right behind the completion ring pages in the same ring
+ * mapping.  Userspace fills iocbs[] and advances tail; the kernel
+ * consumes entries and advances head when io_submit() is called with
+ * nr == 0 and a NULL iocbpp (the doorbell), so a whole batch costs one
+ * syscall and no copy_from_user() of the iocbs.
+ */
+struct aio_sq_ring {
+	unsigned	nr;	/* number of iocbs[] entries */
+	unsigned	head;	/* consumed by the kernel */
+	unsigned	tail;	/* produced by userspace */
+	unsigned	pad[13];
+	struct iocb	iocbs[0];
+}; /* 64 byte header; iocbs never straddle a page boundary */
+
 #define AIO_RING_PAGES	8
 
 struct kioctx_table {
@@ -115,6 +135,11 @@ struct kioctx {
 	struct page		**ring_pages;
 	long			nr_pages;
 
+	/* submission ring, if created with AIO_SETUP_SQRING */
+	unsigned		sq_entries;
+	int			sq_page_off;	/* first sq page in ring_pages */
+	struct mutex		sq_lock;	/* serializes sq consumers */
+
 	struct work_struct	free_work;
 
 	/*
@@ -186,6 +211,21 @@ struct aio_kiocb {
 	 * this is the underlying eventfd context to deliver events to.
 	 */
 	struct eventfd_ctx	*ki_eventfd;
+
+	/*
+	 * State for retry based buffered reads: when the read would block
+	 * on a locked page, ki_pgwait is queued on the page's wait queue
+	 * and the read is reissued from ki_retry_work once the page is
+	 * unlocked.  The iterator lives here so it survives across the
+	 * retries; ki_rd_total remembers the initial length so the final
+	 * completion can report the bytes copied over all passes.
+	 */
+	struct wait_page_queue	ki_pgwait;
+	struct work_struct	ki_retry_work;
+	struct iov_iter		ki_iter;
+	struct iovec		*ki_iovec;
+	struct iovec		ki_inline_vecs[UIO_FASTIOV];
+	size_t			ki_rd_total;
 };
 
 /*------ sysctl variables----*/
@@ -447,7 +487,7 @@ static int aio_setup_ring(struct kioctx *ctx)
 	unsigned nr_events = ctx->max_reqs;
 	struct mm_struct *mm = current->mm;
 	unsigned long size, unused;
-	int nr_pages;
+	int nr_pages, nr_cq_pages;
 	int i;
 	struct file *file;
 
@@ -457,10 +497,18 @@ static int aio_setup_ring(struct kioctx *ctx)
 	size = sizeof(struct aio_ring);
 	size += sizeof(struct io_event) * nr_events;
 
-	nr_pages = PFN_UP(size);
-	if (nr_pages < 0)
+	nr_cq_pages = PFN_UP(size);
+	if (nr_cq_pages < 0)
 		return -EINVAL;
 
+	nr_pages = nr_cq_pages;
+	if (ctx->sq_entries) {
+		/* the submission ring starts on its own page */
+		ctx->sq_page_off = nr_pages;
+		nr_pages += PFN_UP(sizeof(struct aio_sq_ring) +
+				   sizeof(struct iocb) * ctx->sq_entries);
+	}
+
 	file = aio_private_file(ctx, nr_pages);
 	if (IS_ERR(file)) {
 		ctx->aio_ring_file = NULL;
@@ -468,7 +516,7 @@ static int aio_setup_ring(struct kioctx *ctx)
 	}
 
 	ctx->aio_ring_file = file;
-	nr_events = (PAGE_SIZE * nr_pages - sizeof(struct aio_ring))
+	nr_events = (PAGE_SIZE * nr_cq_pages - sizeof(struct aio_ring))
 			/ sizeof(struct io_event);
 
 	ctx->ring_pages = ctx->internal_pages;
@@ -536,6 +584,16 @@ static int aio_setup_ring(struct kioctx *ctx)
 	kunmap_atomic(ring);
 	flush_dcache_page(ctx->ring_pages[0]);
 
+	if (ctx->sq_entries) {
+		struct aio_sq_ring *sq;
+
+		sq = kmap_atomic(ctx->ring_pages[ctx->sq_page_off]);
+		sq->nr = ctx->sq_entries;
+		sq->head = sq->tail = 0;
+		kunmap_atomic(sq);
+		flush_dcache_page(ctx->ring_pages[ctx->sq_page_off]);
+	}
+
 	return 0;
 }
 
@@ -700,7 +758,7 @@ static void aio_nr_sub(unsigned nr)
 /* ioctx_alloc
  *	Allocates and initializes an ioctx.  Returns an ERR_PTR if it failed.
  */
-static struct kioctx *ioctx_alloc(unsigned nr_events)
+static struct kioctx *ioctx_alloc(unsigned nr_events, unsigned sq_entries)
 {
 	struct mm_struct *mm = current->mm;
 	struct kioctx *ctx;
@@ -719,7 +777,8 @@ static struct kioctx *ioctx_alloc(unsigned nr_events)
 	nr_events *= 2;
 
 	/* Prevent overflows */
-	if (nr_events > (0x10000000U / sizeof(struct io_event))) {
+	if (nr_events > (0x10000000U / sizeof(struct io_event)) ||
+	    sq_entries > (0x10000000U / sizeof(struct iocb))) {
 		pr_debug("ENOMEM: nr_events too high\n");
 		return ERR_PTR(-EINVAL);
 	}
@@ -732,10 +791,12 @@ static struct kioctx *ioctx_alloc(unsigned nr_events)
 		return ERR_PTR(-ENOMEM);
 
 	ctx->max_reqs = nr_events;
+	ctx->sq_entries = sq_entries;
 
 	spin_lock_init(&ctx->ctx_lock);
 	spin_lock_init(&ctx->completion_lock);
 	mutex_init(&ctx->ring_lock);
+	mutex_init(&ctx->sq_lock);
 	/* Protect against page migration throughout kiotx setup by keeping
 	 * the ring_lock mutex held until setup is complete. */
 	mutex_lock(&ctx->ring_lock);
@@ -1338,7 +1399,8 @@ static long read_events(struct kioctx *ctx, long min_nr, long nr,
  *	pointer is passed for ctxp.  Will fail with -ENOSYS if not
  *	implemented.
  */
-SYSCALL_DEFINE2(io_setup, unsigned, nr_events, aio_context_t __user *, ctxp)
+static long do_io_setup(unsigned nr_events, unsigned sq_entries,
+			aio_context_t __user *ctxp)
 {
 	struct kioctx *ioctx = NULL;
 	unsigned long ctx;
@@ -1355,7 +1417,7 @@ SYSCALL_DEFINE2(io_setup, unsigned, nr_events, aio_context_t __user *, ctxp)
 		goto out;
 	}
 
-	ioctx = ioctx_alloc(nr_events);
+	ioctx = ioctx_alloc(nr_events, sq_entries);
 	ret = PTR_ERR(ioctx);
 	if (!IS_ERR(ioctx)) {
 		ret = put_user(ioctx->user_id, ctxp);
@@ -1368,6 +1430,28 @@ out:
 	return ret;
 }
 
+SYSCALL_DEFINE2(io_setup, unsigned, nr_events, aio_context_t __user *, ctxp)
+{
+	return do_io_setup(nr_events, 0, ctxp);
+}
+
+/* sys_io_setup2:
+ *	Like sys_io_setup, but takes a flags argument.  AIO_SETUP_SQRING
+ *	appends a submission ring of nr_events iocbs to the ring mapping;
+ *	it is consumed by calling io_submit() with nr == 0 and a NULL
+ *	iocbpp, see aio_submit_sq_ring().  Will fail with -EINVAL if an
+ *	unknown flag is passed.
+ */
+SYSCALL_DEFINE3(io_setup2, unsigned, nr_events, unsigned, flags,
+		aio_context_t __user *, ctxp)
+{
+	if (unlikely(flags & ~AIO_SETUP_SQRING))
+		return -EINVAL;
+
+	return do_io_setup(nr_events,
+			   (flags & AIO_SETUP_SQRING) ? nr_events : 0, ctxp);
+}
+
 #ifdef CONFIG_COMPAT
 COMPAT_SYSCALL_DEFINE2(io_setup, unsigned, nr_events, u32 __user *, ctx32p)
 {
@@ -1386,7 +1470,7 @@ COMPAT_SYSCALL_DEFINE2(io_setup, unsigned, nr_events, u32 __user *, ctx32p)
 		goto out;
 	}
 
-	ioctx = ioctx_alloc(nr_events);
+	ioctx = ioctx_alloc(nr_events, 0);
 	ret = PTR_ERR(ioctx);
 	if (!IS_ERR(ioctx)) {
 		/* truncating is ok because it's a user address */
@@ -1477,12 +1561,69 @@ static inline ssize_t aio_ret(struct kiocb *req, ssize_t ret)
 	}
 }
 
+/*
+ * Buffered reads against readpage based files can be reissued when the
+ * page they blocked on is unlocked, instead of sleeping in io_submit().
+ */
+static bool aio_read_use_retry(struct kiocb *req)
+{
+	struct address_space *mapping = req->ki_filp->f_mapping;
+
+	if (req->ki_flags & IOCB_DIRECT)
+		return false;
+	return mapping && mapping->a_ops && mapping->a_ops->readpage;
+}
+
+static void aio_read_retry_work(struct work_struct *work)
+{
+	struct aio_kiocb *aio_req =
+		container_of(work, struct aio_kiocb, ki_retry_work);
+	struct kiocb *req = &aio_req->common;
+	ssize_t ret;
+
+	ret = req->ki_filp->f_op->read_iter(req, &aio_req->ki_iter);
+	if (ret == -EIOCBQUEUED)
+		return;		/* the wait entry is armed again */
+
+	/*
+	 * Earlier passes may already have copied data out; report the
+	 * total consumed by the iterator rather than this pass alone.
+	 */
+	if (aio_req->ki_rd_total != iov_iter_count(&aio_req->ki_iter))
+		ret = aio_req->ki_rd_total - iov_iter_count(&aio_req->ki_iter);
+	kfree(aio_req->ki_iovec);
+	aio_ret(req, ret);
+}
+
+/*
+ * Called when the page a retry based read blocked on is unlocked. Just
+ * punt the reissue to process context; read_iter may sleep on further
+ * pages and we may be running under the unlocker's interrupt context.
+ */
+static int aio_read_retry_wake(wait_queue_t *wait, unsigned mode, int sync,
+			       void *arg)
+{
+	struct wait_page_key *key = arg;
+	struct wait_page_queue *pgwait
+		= container_of(wait, struct wait_page_queue, wait);
+	struct aio_kiocb *aio_req
+		= container_of(pgwait, struct aio_kiocb, ki_pgwait);
+
+	if (!wake_page_match(pgwait, key))
+		return 0;
+
+	list_del_init(&wait->task_list);
+	schedule_work(&aio_req->ki_retry_work);
+	return 1;
+}
+
 static ssize_t aio_read(struct kiocb *req, struct iocb *iocb, bool vectored,
 		bool compat)
 {
+	struct aio_kiocb *aio_req = container_of(req, struct aio_kiocb, common);
 	struct file *file = req->ki_filp;
-	struct iovec inline_vecs[UIO_FASTIOV], *iovec = inline_vecs;
-	struct iov_iter iter;
+	struct iovec *iovec = aio_req->ki_inline_vecs;
+	struct iov_iter *iter = &aio_req->ki_iter;
 	ssize_t ret;
 
 	if (unlikely(!(file->f_mode & FMODE_READ)))
@@ -1490,12 +1631,36 @@ static ssize_t aio_read(struct kiocb *req, struct iocb *iocb, bool vectored,
 	if (unlikely(!file->f_op->read_iter))
 		return -EINVAL;
 
-	ret = aio_setup_rw(READ, iocb, &iovec, vectored, compat, &iter);
+	ret = aio_setup_rw(READ, iocb, &iovec, vectored, compat, iter);
 	if (ret)
 		return ret;
-	ret = rw_verify_area(READ, file, &req->ki_pos, iov_iter_count(&iter));
-	if (!ret)
-		ret = aio_ret(req, file->f_op->read_iter(req, &iter));
+	ret = rw_verify_area(READ, file, &req->ki_pos, iov_iter_count(iter));
+	if (ret) {
+		kfree(iovec);
+		return ret;
+	}
+
+	if (aio_read_use_retry(req)) {
+		aio_req->ki_iovec = iovec;
+		aio_req->ki_rd_total = iov_iter_count(iter);
+		init_waitqueue_func_entry(&aio_req->ki_pgwait.wait,
+					  aio_read_retry_wake);
+		INIT_WORK(&aio_req->ki_retry_work, aio_read_retry_work);
+		req->ki_flags |= IOCB_WAITQ;
+		req->ki_waitq = &aio_req->ki_pgwait;
+
+		ret = file->f_op->read_iter(req, iter);
+		/*
+		 * Once the read queued itself on a page wait queue the
+		 * request belongs to aio_read_retry_work(); it must not
+		 * be touched here any more.
+		 */
+		if (ret == -EIOCBQUEUED)
+			return ret;
+		ret = aio_ret(req, ret);
+	} else {
+		ret = aio_ret(req, file->f_op->read_iter(req, iter));
+	}
 	kfree(iovec);
 	return ret;
 }
@@ -1626,6 +1791,81 @@ out_put_req:
 	return ret;
 }
 
+/*
+ * Consume the submission ring.  The iocbs sit in kernel pages mapped to
+ * userspace, so they are read through the ring pages directly instead of
+ * copy_from_user().  The slot's user address is what io_cancel() matches
+ * on and where the aio_key is written, same as for pointer submission.
+ */
+static long aio_submit_sq_ring(struct kioctx *ctx, bool compat)
+{
+	unsigned head, tail, nr = ctx->sq_entries;
+	struct aio_sq_ring *sq;
+	struct blk_plug plug;
+	long ret = 0;
+	int i = 0;
+
+	mutex_lock(&ctx->sq_lock);
+
+	sq = kmap_atomic(ctx->ring_pages[ctx->sq_page_off]);
+	head = READ_ONCE(sq->head);
+	tail = READ_ONCE(sq->tail);
+	kunmap_atomic(sq);
+
+	/*
+	 * The ring page is mapped writable into userspace, so both
+	 * indices are untrusted; an out of range head would walk the
+	 * iocb reads past the ring pages.
+	 */
+	if (unlikely(head >= nr || tail >= nr)) {
+		mutex_unlock(&ctx->sq_lock);
+		return -EFAULT;
+	}
+
+	/* read the iocbs only after the tail index */
+	smp_rmb();
+
+	blk_start_plug(&plug);
+
+	while (head != tail) {
+		unsigned long off = sizeof(struct aio_sq_ring) +
+				    (unsigned long)head * sizeof(struct iocb);
+		struct page *page = ctx->ring_pages[ctx->sq_page_off +
+						    (off >> PAGE_SHIFT)];
+		struct iocb __user *user_iocb;
+		struct iocb tmp;
+		void *p;
+
+		p = kmap_atomic(page);
+		memcpy(&tmp, p + offset_in_page(off), sizeof(tmp));
+		kunmap_atomic(p);
+
+		user_iocb = (struct iocb __user *)(ctx->mmap_base +
+			((unsigned long)ctx->sq_page_off << PAGE_SHIFT) + off);
+
+		ret = io_submit_one(ctx, user_iocb, &tmp, compat);
+		if (ret)
+			break;
+
+		if (++head == nr)
+			head = 0;
+		i++;
+	}
+
+	blk_finish_plug(&plug);
+
+	/* publish the new head only after the slots are consumed */
+	smp_wmb();
+	sq = kmap_atomic(ctx->ring_pages[ctx->sq_page_off]);
+	sq->head = head;
+	kunmap_atomic(sq);
+	flush_dcache_page(ctx->ring_pages[ctx->sq_page_off]);
+
+	mutex_unlock(&ctx->sq_lock);
+
+	return i ? i : ret;
+}
+
 static long do_io_submit(aio_context_t ctx_id, long nr,
 			  struct iocb __user *__user *iocbpp, bool compat)
 {
@@ -1649,6 +1889,13 @@ static long do_io_submit(aio_context_t ctx_id, long nr,
 		return -EINVAL;
 	}
 
+	/* the doorbell: drain whatever userspace queued on the sq ring */
+	if (!nr && !iocbpp && ctx->sq_entries) {
+		ret = aio_submit_sq_ring(ctx, compat);
+		percpu_ref_put(&ctx->users);
+		return ret;
+	}
+
 	blk_start_plug(&plug);
 
 	/*
@@ -36,6 +36,8 @@
 #include <linux/coredump.h>
 #include <linux/sched.h>
 #include <linux/dax.h>
+#include <linux/huge_mm.h>
+#include <linux/workqueue.h>
 #include <linux/uaccess.h>
 #include <asm/param.h>
 #include <asm/page.h>
@@ -81,6 +83,9 @@ static int elf_core_dump(struct coredump_params *cprm);
 #define ELF_PAGEOFFSET(_v) ((_v) & (ELF_MIN_ALIGN-1))
 #define ELF_PAGEALIGN(_v) (((_v) + ELF_MIN_ALIGN - 1) & ~(ELF_MIN_ALIGN - 1))
 
+/* how much of the leading text to read ahead while the image is set up */
+#define ELF_EXEC_READAHEAD_PAGES 16
+
 static struct linux_binfmt elf_format = {
 	.module		= THIS_MODULE,
 	.load_binary	= load_elf_binary,
@@ -665,6 +670,79 @@ static unsigned long randomize_stack_top(unsigned long stack_top)
 #endif
 }
 
+/*
+ * Asynchronous whole-image readahead, requested with AT_EXEC_READAHEAD.
+ *
+ * Large statically linked executables spend a long time taking demand
+ * faults on their own text and data after execve() returns.  When asked
+ * to, submit readahead for every PT_LOAD segment from a work item so
+ * the IO runs while the image is still being set up and while early
+ * userspace code executes.  Segments are issued in file offset order
+ * from a single work item, which keeps the IO sequential for the
+ * backing device (and for compressed filesystems, which decompress
+ * in file order).
+ */
+struct elf_preload_work {
+	struct work_struct work;
+	struct file *file;
+	unsigned int nr_segs;
+	struct {
+		pgoff_t offset;
+		unsigned long nr;
+	} seg[0];
+};
+
+static void elf_preload_workfn(struct work_struct *work)
+{
+	struct elf_preload_work *plw =
+		container_of(work, struct elf_preload_work, work);
+	unsigned int i;
+
+	for (i = 0; i < plw->nr_segs; i++)
+		force_page_cache_readahead(plw->file->f_mapping, plw->file,
+					   plw->seg[i].offset, plw->seg[i].nr);
+	fput(plw->file);
+	kfree(plw);
+}
+
+static void elf_preload_image(struct file *file, struct elfhdr *elf_ex,
+			      struct elf_phdr *elf_phdata)
+{
+	struct elf_preload_work *plw;
+	struct elf_phdr *eppnt;
+	unsigned int nr_segs = 0;
+	int i;
+
+	eppnt = elf_phdata;
+	for (i = 0; i < elf_ex->e_phnum; i++, eppnt++)
+		if (eppnt->p_type == PT_LOAD && eppnt->p_filesz)
+			nr_segs++;
+	if (!nr_segs)
+		return;
+
+	plw = kmalloc(sizeof(*plw) + nr_segs * sizeof(plw->seg[0]),
+		      GFP_KERNEL);
+	if (!plw)
+		return;
+
+	INIT_WORK(&plw->work, elf_preload_workfn);
+	plw->file = get_file(file);
+	plw->nr_segs = 0;
+
+	/* program headers are in ascending p_offset order */
+	eppnt = elf_phdata;
+	for (i = 0; i < elf_ex->e_phnum; i++, eppnt++) {
+		if (eppnt->p_type != PT_LOAD || !eppnt->p_filesz)
+			continue;
+		plw->seg[plw->nr_segs].offset = eppnt->p_offset >> PAGE_SHIFT;
+		plw->seg[plw->nr_segs].nr =
+			(eppnt->p_filesz >> PAGE_SHIFT) + 1;
+		plw->nr_segs++;
+	}
+
+	queue_work(system_unbound_wq, &plw->work);
+}
+
 static int load_elf_binary(struct linux_binprm *bprm)
 {
 	struct file *interpreter = NULL; /* to shut gcc up */
@@ -864,6 +942,9 @@ static int load_elf_binary(struct linux_binprm *bprm)
 	
 	current->mm->start_stack = bprm->p;
 
+	if (bprm->preload_image)
+		elf_preload_image(bprm->file, &loc->elf_ex, elf_phdata);
+
 	/* Now we do a little grungy work by mmapping the ELF image into
 	   the correct location in memory. */
 	for(i = 0, elf_ppnt = elf_phdata;
@@ -922,6 +1003,15 @@ static int load_elf_binary(struct linux_binprm *bprm)
 			if (current->flags & PF_RANDOMIZE)
 				load_bias += arch_mmap_rnd();
 			load_bias = ELF_PAGESTART(load_bias);
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+			/*
+			 * Align the image so its text starts on a pmd
+			 * boundary; a huge-page-capable page cache can
+			 * then map it with huge pages.
+			 */
+			if (bprm->preload_image)
+				load_bias &= HPAGE_PMD_MASK;
+#endif
 			total_size = total_mapping_size(elf_phdata,
 							loc->elf_ex.e_phnum);
 			if (!total_size) {
@@ -938,6 +1028,20 @@ static int load_elf_binary(struct linux_binprm *bprm)
 			goto out_free_dentry;
 		}
 
+		/*
+		 * The first instruction fetches hit the leading text
+		 * pages the moment we return to user mode; start
+		 * reading them in while the rest of the image is being
+		 * set up instead of taking the demand faults cold.
+		 */
+		if (elf_prot & PROT_EXEC)
+			force_page_cache_readahead(bprm->file->f_mapping,
+				bprm->file,
+				elf_ppnt->p_offset >> PAGE_SHIFT,
+				min_t(unsigned long,
+				      (elf_ppnt->p_filesz >> PAGE_SHIFT) + 1,
+				      ELF_EXEC_READAHEAD_PAGES));
+
 		if (!load_addr_set) {
 			load_addr_set = 1;
 			load_addr = (elf_ppnt->p_vaddr - elf_ppnt->p_offset);
@@ -32,6 +32,7 @@
 #include <linux/writeback.h>
 #include <linux/bit_spinlock.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
 #include "ctree.h"
 #include "disk-io.h"
 #include "transaction.h"
@@ -760,9 +761,21 @@ static struct {
 	wait_queue_head_t ws_wait;
 } btrfs_comp_ws[BTRFS_COMPRESS_TYPES];
 
+/*
+ * One cached workspace per CPU and compression type, tried before the
+ * shared idle list so back-to-back compress or decompress work on one
+ * CPU reuses a cache-hot workspace without touching ws_lock.  NULL if
+ * the percpu allocation failed; everything falls back to the shared
+ * list then.
+ */
+static struct list_head * __percpu *btrfs_comp_ws_cache[BTRFS_COMPRESS_TYPES];
+
 static const struct btrfs_compress_op * const btrfs_compress_op[] = {
 	&btrfs_zlib_compress,
 	&btrfs_lzo_compress,
+#ifdef CONFIG_BTRFS_FS_ZSTD
+	&btrfs_zstd_compress,
+#endif
 };
 
 void __init btrfs_init_compress(void)
@@ -777,6 +790,10 @@ void __init btrfs_init_compress(void)
 		atomic_set(&btrfs_comp_ws[i].total_ws, 0);
 		init_waitqueue_head(&btrfs_comp_ws[i].ws_wait);
 
+		btrfs_comp_ws_cache[i] = alloc_percpu(struct list_head *);
+		if (!btrfs_comp_ws_cache[i])
+			pr_warn("BTRFS: cannot allocate per-cpu workspace cache\n");
+
 		/*
 		 * Preallocate one workspace for each compression type so
 		 * we can guarantee forward progress in the worst case
@@ -809,6 +826,12 @@ static struct list_head *find_workspace(int type)
 	atomic_t *total_ws		= &btrfs_comp_ws[idx].total_ws;
 	wait_queue_head_t *ws_wait	= &btrfs_comp_ws[idx].ws_wait;
 	int *free_ws			= &btrfs_comp_ws[idx].free_ws;
+
+	if (btrfs_comp_ws_cache[idx]) {
+		workspace = this_cpu_xchg(*btrfs_comp_ws_cache[idx], NULL);
+		if (workspace)
+			return workspace;
+	}
 again:
 	spin_lock(ws_lock);
 	if (!list_empty(idle_ws)) {
@@ -874,6 +897,22 @@ static void free_workspace(int type, struct list_head *workspace)
 	wait_queue_head_t *ws_wait	= &btrfs_comp_ws[idx].ws_wait;
 	int *free_ws			= &btrfs_comp_ws[idx].free_ws;
 
+	/*
+	 * Park the workspace in this CPU's cache slot if it is empty.
+	 * Waiters are only served from the shared idle list, so skip
+	 * the slot whenever somebody may be waiting: waiting implies
+	 * total_ws overshot the per-CPU limit, and the dec paths that
+	 * bring it back down always issue a wakeup.
+	 */
+	smp_mb();
+	if (btrfs_comp_ws_cache[idx] &&
+	    atomic_read(total_ws) <= num_online_cpus() &&
+	    !waitqueue_active(ws_wait)) {
+		if (this_cpu_cmpxchg(*btrfs_comp_ws_cache[idx], NULL,
+				     workspace) == NULL)
+			return;
+	}
+
 	spin_lock(ws_lock);
 	if (*free_ws < num_online_cpus()) {
 		list_add(workspace, idle_ws);
@@ -903,6 +942,21 @@ static void free_workspaces(void)
 	int i;
 
 	for (i = 0; i < BTRFS_COMPRESS_TYPES; i++) {
+		if (btrfs_comp_ws_cache[i]) {
+			int cpu;
+
+			for_each_possible_cpu(cpu) {
+				workspace = *per_cpu_ptr(
+						btrfs_comp_ws_cache[i], cpu);
+				if (workspace) {
+					btrfs_compress_op[i]->free_workspace(
+								workspace);
+					atomic_dec(&btrfs_comp_ws[i].total_ws);
+				}
+			}
+			free_percpu(btrfs_comp_ws_cache[i]);
+			btrfs_comp_ws_cache[i] = NULL;
+		}
 		while (!list_empty(&btrfs_comp_ws[i].idle_ws)) {
 			workspace = btrfs_comp_ws[i].idle_ws.next;
 			list_del(workspace);
@@ -48,8 +48,14 @@ enum btrfs_compression_type {
 	BTRFS_COMPRESS_NONE  = 0,
 	BTRFS_COMPRESS_ZLIB  = 1,
 	BTRFS_COMPRESS_LZO   = 2,
+	BTRFS_COMPRESS_ZSTD  = 3,
+#ifdef CONFIG_BTRFS_FS_ZSTD
+	BTRFS_COMPRESS_TYPES = 3,
+	BTRFS_COMPRESS_LAST  = 4,
+#else
 	BTRFS_COMPRESS_TYPES = 2,
 	BTRFS_COMPRESS_LAST  = 3,
+#endif
 };
 
 struct btrfs_compress_op {
@@ -82,5 +88,8 @@ struct btrfs_compress_op {
 
 extern const struct btrfs_compress_op btrfs_zlib_compress;
 extern const struct btrfs_compress_op btrfs_lzo_compress;
+#ifdef CONFIG_BTRFS_FS_ZSTD
+extern const struct btrfs_compress_op btrfs_zstd_compress;
+#endif
 
 #endif
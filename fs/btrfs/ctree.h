@@ -255,12 +255,32 @@ struct btrfs_super_block {
 #define BTRFS_FEATURE_COMPAT_RO_SAFE_SET	0ULL
 #define BTRFS_FEATURE_COMPAT_RO_SAFE_CLEAR	0ULL
 
+/*
+ * transitional: belongs in uapi/linux/btrfs.h with the other incompat
+ * feature flags.
+ */
+#ifndef BTRFS_FEATURE_INCOMPAT_COMPRESS_ZSTD
+#define BTRFS_FEATURE_INCOMPAT_COMPRESS_ZSTD	(1ULL << 4)
+#endif
+
+/*
+ * A mounted fs with zstd extents cannot be read without the support
+ * compiled in, so the feature is only advertised as supported then.
+ */
+#ifdef CONFIG_BTRFS_FS_ZSTD
+#define BTRFS_FEATURE_INCOMPAT_SUPP_ZSTD	\
+	BTRFS_FEATURE_INCOMPAT_COMPRESS_ZSTD
+#else
+#define BTRFS_FEATURE_INCOMPAT_SUPP_ZSTD	0ULL
+#endif
+
 #define BTRFS_FEATURE_INCOMPAT_SUPP			\
 	(BTRFS_FEATURE_INCOMPAT_MIXED_BACKREF |		\
 	 BTRFS_FEATURE_INCOMPAT_DEFAULT_SUBVOL |	\
 	 BTRFS_FEATURE_INCOMPAT_MIXED_GROUPS |		\
 	 BTRFS_FEATURE_INCOMPAT_BIG_METADATA |		\
 	 BTRFS_FEATURE_INCOMPAT_COMPRESS_LZO |		\
+	 BTRFS_FEATURE_INCOMPAT_SUPP_ZSTD |		\
 	 BTRFS_FEATURE_INCOMPAT_RAID56 |		\
 	 BTRFS_FEATURE_INCOMPAT_EXTENDED_IREF |		\
 	 BTRFS_FEATURE_INCOMPAT_SKINNY_METADATA |	\
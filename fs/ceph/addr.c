@@ -266,6 +266,7 @@ static void finish_read(struct ceph_osd_request *req)
 	int i;
 
 	dout("finish_read %p req %p rc %d bytes %d\n", inode, req, rc, bytes);
+	atomic_dec(&ceph_inode_to_client(inode)->read_inflight);
 
 	/* unlock all pages, zeroing any data we didn't read */
 	osd_data = osd_req_op_extent_osd_data(req, 0);
@@ -303,8 +304,8 @@ unlock:
  */
 static int start_read(struct inode *inode, struct list_head *page_list, int max)
 {
-	struct ceph_osd_client *osdc =
-		&ceph_inode_to_client(inode)->client->osdc;
+	struct ceph_fs_client *fsc = ceph_inode_to_client(inode);
+	struct ceph_osd_client *osdc = &fsc->client->osdc;
 	struct ceph_inode_info *ci = ceph_inode(inode);
 	struct page *page = list_entry(page_list->prev, struct page, lru);
 	struct ceph_vino vino;
@@ -315,6 +316,7 @@ static int start_read(struct inode *inode, struct list_head *page_list, int max)
 	struct page **pages;
 	pgoff_t next_index;
 	int nr_pages = 0;
+	int nr_inflight;
 	int got = 0;
 	int ret = 0;
 
@@ -402,10 +404,18 @@ static int start_read(struct inode *inode, struct list_head *page_list, int max)
 	req->r_callback = finish_read;
 	req->r_inode = inode;
 
+	/* account the rpc before it can complete */
+	nr_inflight = atomic_inc_return(&fsc->read_inflight);
+	if (nr_inflight > atomic_read(&fsc->read_inflight_max))
+		atomic_set(&fsc->read_inflight_max, nr_inflight);
+	atomic64_inc(&fsc->read_rpcs);
+
 	dout("start_read %p starting %p %lld~%lld\n", inode, req, off, len);
 	ret = ceph_osdc_start_request(osdc, req, false);
-	if (ret < 0)
+	if (ret < 0) {
+		atomic_dec(&fsc->read_inflight);
 		goto out_pages;
+	}
 	ceph_osdc_put_request(req);
 
 	/* After adding locked pages to page cache, the inode holds cache cap.
@@ -459,6 +469,17 @@ static int ceph_readpages(struct file *file, struct address_space *mapping,
 		file, nr_pages,
 	     max);
 	while (!list_empty(page_list)) {
+		/*
+		 * Bound the number of readahead rpcs in flight.  Pages we
+		 * leave behind are simply reclaimed by the caller.
+		 */
+		if (fsc->mount_options->rapipe &&
+		    atomic_read(&fsc->read_inflight) >=
+		    fsc->mount_options->rapipe) {
+			dout("readpages %p rapipe limit %d reached\n", inode,
+			     fsc->mount_options->rapipe);
+			break;
+		}
 		rc = start_read(inode, page_list, max);
 		if (rc < 0)
 			goto out;
@@ -192,11 +192,26 @@ static int mds_sessions_show(struct seq_file *s, void *ptr)
 	return 0;
 }
 
+static int read_pipeline_show(struct seq_file *s, void *ptr)
+{
+	struct ceph_fs_client *fsc = s->private;
+
+	seq_printf(s, "inflight:\t%d\n", atomic_read(&fsc->read_inflight));
+	seq_printf(s, "inflight_max:\t%d\n",
+		   atomic_read(&fsc->read_inflight_max));
+	seq_printf(s, "rpcs:\t\t%lld\n",
+		   (s64)atomic64_read(&fsc->read_rpcs));
+	seq_printf(s, "limit:\t\t%d\n", fsc->mount_options->rapipe);
+
+	return 0;
+}
+
 CEPH_DEFINE_SHOW_FUNC(mdsmap_show)
 CEPH_DEFINE_SHOW_FUNC(mdsc_show)
 CEPH_DEFINE_SHOW_FUNC(caps_show)
 CEPH_DEFINE_SHOW_FUNC(dentry_lru_show)
 CEPH_DEFINE_SHOW_FUNC(mds_sessions_show)
+CEPH_DEFINE_SHOW_FUNC(read_pipeline_show)
 
 
 /*
@@ -232,6 +247,7 @@ void ceph_fs_debugfs_cleanup(struct ceph_fs_client *fsc)
 	debugfs_remove(fsc->debugfs_caps);
 	debugfs_remove(fsc->debugfs_mdsc);
 	debugfs_remove(fsc->debugfs_dentry_lru);
+	debugfs_remove(fsc->debugfs_read_pipeline);
 }
 
 int ceph_fs_debugfs_init(struct ceph_fs_client *fsc)
@@ -299,6 +315,14 @@ int ceph_fs_debugfs_init(struct ceph_fs_client *fsc)
 	if (!fsc->debugfs_dentry_lru)
 		goto out;
 
+	fsc->debugfs_read_pipeline = debugfs_create_file("read_pipeline",
+					0400,
+					fsc->client->debugfs_dir,
+					fsc,
+					&read_pipeline_show_fops);
+	if (!fsc->debugfs_read_pipeline)
+		goto out;
+
 	return 0;
 
 out:
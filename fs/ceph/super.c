@@ -111,6 +111,7 @@ enum {
 	Opt_wsize,
 	Opt_rsize,
 	Opt_rasize,
+	Opt_rapipe,
 	Opt_caps_wanted_delay_min,
 	Opt_caps_wanted_delay_max,
 	Opt_cap_release_safety,
@@ -149,6 +150,7 @@ static match_table_t fsopt_tokens = {
 	{Opt_wsize, "wsize=%d"},
 	{Opt_rsize, "rsize=%d"},
 	{Opt_rasize, "rasize=%d"},
+	{Opt_rapipe, "rapipe=%d"},
 	{Opt_caps_wanted_delay_min, "caps_wanted_delay_min=%d"},
 	{Opt_caps_wanted_delay_max, "caps_wanted_delay_max=%d"},
 	{Opt_cap_release_safety, "cap_release_safety=%d"},
@@ -233,6 +235,9 @@ static int parse_fsopt_token(char *c, void *private)
 	case Opt_rasize:
 		fsopt->rasize = intval;
 		break;
+	case Opt_rapipe:
+		fsopt->rapipe = intval;
+		break;
 	case Opt_caps_wanted_delay_min:
 		fsopt->caps_wanted_delay_min = intval;
 		break;
@@ -381,6 +386,7 @@ static int parse_mount_options(struct ceph_mount_options **pfsopt,
 
 	fsopt->rsize = CEPH_RSIZE_DEFAULT;
 	fsopt->rasize = CEPH_RASIZE_DEFAULT;
+	fsopt->rapipe = CEPH_RAPIPE_DEFAULT;
 	fsopt->snapdir_name = kstrdup(CEPH_SNAPDIRNAME_DEFAULT, GFP_KERNEL);
 	if (!fsopt->snapdir_name) {
 		err = -ENOMEM;
@@ -495,6 +501,8 @@ static int ceph_show_options(struct seq_file *m, struct dentry *root)
 		seq_printf(m, ",rsize=%d", fsopt->rsize);
 	if (fsopt->rasize != CEPH_RASIZE_DEFAULT)
 		seq_printf(m, ",rasize=%d", fsopt->rasize);
+	if (fsopt->rapipe != CEPH_RAPIPE_DEFAULT)
+		seq_printf(m, ",rapipe=%d", fsopt->rapipe);
 	if (fsopt->congestion_kb != default_congestion_kb())
 		seq_printf(m, ",write_congestion_kb=%d", fsopt->congestion_kb);
 	if (fsopt->caps_wanted_delay_min != CEPH_CAPS_WANTED_DELAY_MIN_DEFAULT)
@@ -578,6 +586,9 @@ static struct ceph_fs_client *create_fs_client(struct ceph_mount_options *fsopt,
 	fsc->mount_state = CEPH_MOUNT_MOUNTING;
 
 	atomic_long_set(&fsc->writeback_count, 0);
+	atomic_set(&fsc->read_inflight, 0);
+	atomic_set(&fsc->read_inflight_max, 0);
+	atomic64_set(&fsc->read_rpcs, 0);
 
 	err = bdi_init(&fsc->backing_dev_info);
 	if (err < 0)
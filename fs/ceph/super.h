@@ -47,6 +47,7 @@
 
 #define CEPH_RSIZE_DEFAULT             0           /* max read size */
 #define CEPH_RASIZE_DEFAULT            (8192*1024) /* readahead */
+#define CEPH_RAPIPE_DEFAULT            0           /* readahead rpcs in flight (0 = unlimited) */
 #define CEPH_MAX_READDIR_DEFAULT        1024
 #define CEPH_MAX_READDIR_BYTES_DEFAULT  (512*1024)
 #define CEPH_SNAPDIRNAME_DEFAULT        ".snap"
@@ -58,6 +59,7 @@ struct ceph_mount_options {
 	int wsize;            /* max write size */
 	int rsize;            /* max read size */
 	int rasize;           /* max readahead */
+	int rapipe;           /* max readahead rpcs in flight */
 	int congestion_kb;    /* max writeback in flight */
 	int caps_wanted_delay_min, caps_wanted_delay_max;
 	int cap_release_safety;
@@ -92,6 +94,11 @@ struct ceph_fs_client {
 	struct workqueue_struct *trunc_wq;
 	atomic_long_t writeback_count;
 
+	/* readahead pipeline accounting */
+	atomic_t read_inflight;
+	atomic_t read_inflight_max;
+	atomic64_t read_rpcs;
+
 	struct backing_dev_info backing_dev_info;
 
 #ifdef CONFIG_DEBUG_FS
@@ -100,6 +107,7 @@ struct ceph_fs_client {
 	struct dentry *debugfs_bdi;
 	struct dentry *debugfs_mdsc, *debugfs_mdsmap;
 	struct dentry *debugfs_mds_sessions;
+	struct dentry *debugfs_read_pipeline;
 #endif
 
 #ifdef CONFIG_CEPH_FSCACHE
@@ -876,6 +876,64 @@ int dax_writeback_mapping_range(struct address_space *mapping,
 }
 EXPORT_SYMBOL_GPL(dax_writeback_mapping_range);
 
+/**
+ * dax_get_dirty_ranges - report pages dirtied through a DAX mapping
+ * @mapping: address space to scan
+ * @start: index to scan from, advanced past the last entry examined
+ * @end: last index to scan (inclusive)
+ * @ranges: array to fill
+ * @nr: capacity of @ranges
+ *
+ * Collect the page runs whose radix tree entries are tagged dirty, i.e.
+ * written through a mapping since the last writeback.  A PMD entry is
+ * reported as one run covering the whole huge page.  The tags are left
+ * untouched so a later fsync/msync still flushes everything; this only
+ * tells callers which flush caches by hand (CLWB over a mapped pmem
+ * file) where the dirty data is.
+ *
+ * Returns the number of ranges filled.
+ */
+unsigned int dax_get_dirty_ranges(struct address_space *mapping,
+		pgoff_t *start, pgoff_t end, struct dax_dirty_range *ranges,
+		unsigned int nr)
+{
+	pgoff_t indices[PAGEVEC_SIZE];
+	struct pagevec pvec;
+	unsigned int filled = 0;
+	int i;
+
+	if (!mapping->nrexceptional)
+		return 0;
+
+	pagevec_init(&pvec, 0);
+	while (filled < nr && *start <= end) {
+		pvec.nr = find_get_entries_tag(mapping, *start,
+				PAGECACHE_TAG_DIRTY,
+				min_t(unsigned int, nr - filled, PAGEVEC_SIZE),
+				pvec.pages, indices);
+		if (pvec.nr == 0)
+			break;
+
+		for (i = 0; i < pvec.nr; i++) {
+			void *entry = pvec.pages[i];
+
+			if (WARN_ON_ONCE(!radix_tree_exceptional_entry(entry))) {
+				put_page(pvec.pages[i]);
+				continue;
+			}
+			if (indices[i] > end)
+				return filled;
+
+			ranges[filled].index = indices[i];
+			ranges[filled].nr_pages = 1UL << dax_radix_order(entry);
+			*start = indices[i] + ranges[filled].nr_pages;
+			filled++;
+		}
+	}
+	return filled;
+}
+EXPORT_SYMBOL_GPL(dax_get_dirty_ranges);
+
 static int dax_insert_mapping(struct address_space *mapping,
 		struct block_device *bdev, sector_t sector, size_t size,
 		void **entryp, struct vm_area_struct *vma, struct vm_fault *vmf)
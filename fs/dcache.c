@@ -127,6 +127,24 @@ struct dentry_stat_t dentry_stat = {
 
 static DEFINE_PER_CPU(long, nr_dentry);
 static DEFINE_PER_CPU(long, nr_dentry_unused);
+static DEFINE_PER_CPU(long, nr_dentry_negative);
+
+/*
+ * When the negative dentry population grows past this count, it is
+ * pruned back under it from a workqueue, a batch per superblock at a
+ * time.  Zero means no limit.  Settable via fs.negative-dentry-limit.
+ */
+long sysctl_negative_dentry_limit __read_mostly;
+
+static long get_nr_dentry_negative(void)
+{
+	int i;
+	long sum = 0;
+
+	for_each_possible_cpu(i)
+		sum += per_cpu(nr_dentry_negative, i);
+	return sum < 0 ? 0 : sum;
+}
 
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 
@@ -165,6 +183,7 @@ int proc_nr_dentry(struct ctl_table *table, int write, void __user *buffer,
 {
 	dentry_stat.nr_dentry = get_nr_dentry();
 	dentry_stat.nr_unused = get_nr_dentry_unused();
+	dentry_stat.nr_negative = get_nr_dentry_negative();
 	return proc_doulongvec_minmax(table, write, buffer, lenp, ppos);
 }
 #endif
@@ -288,6 +307,8 @@ static inline void __d_set_inode_and_type(struct dentry *dentry,
 	flags &= ~(DCACHE_ENTRY_TYPE | DCACHE_FALLTHRU);
 	flags |= type_flags;
 	WRITE_ONCE(dentry->d_flags, flags);
+	/* callers only instantiate negative dentries */
+	this_cpu_dec(nr_dentry_negative);
 }
 
 static inline void __d_clear_type_and_inode(struct dentry *dentry)
@@ -297,6 +318,7 @@ static inline void __d_clear_type_and_inode(struct dentry *dentry)
 	flags &= ~(DCACHE_ENTRY_TYPE | DCACHE_FALLTHRU);
 	WRITE_ONCE(dentry->d_flags, flags);
 	dentry->d_inode = NULL;
+	this_cpu_inc(nr_dentry_negative);
 }
 
 static void dentry_free(struct dentry *dentry)
@@ -358,12 +380,16 @@ static void dentry_unlink_inode(struct dentry * dentry)
  * rules. d_lock must be held by the caller.
  */
 #define D_FLAG_VERIFY(dentry,x) WARN_ON_ONCE(((dentry)->d_flags & (DCACHE_LRU_LIST | DCACHE_SHRINK_LIST)) != (x))
+static void negative_dentry_check_limit(void);
+
 static void d_lru_add(struct dentry *dentry)
 {
 	D_FLAG_VERIFY(dentry, 0);
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
 	WARN_ON_ONCE(!list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
+	if (d_is_negative(dentry))
+		negative_dentry_check_limit();
 }
 
 static void d_lru_del(struct dentry *dentry)
@@ -539,6 +565,8 @@ static void __dentry_kill(struct dentry *dentry)
 	else
 		spin_unlock(&dentry->d_lock);
 	this_cpu_dec(nr_dentry);
+	if (d_is_miss(dentry))
+		this_cpu_dec(nr_dentry_negative);
 	if (dentry->d_op && dentry->d_op->d_release)
 		dentry->d_op->d_release(dentry);
 
@@ -1141,6 +1169,83 @@ void shrink_dcache_sb(struct super_block *sb)
 }
 EXPORT_SYMBOL(shrink_dcache_sb);
 
+static enum lru_status dentry_lru_isolate_negative(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
+{
+	struct list_head *freeable = arg;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	/*
+	 * we are inverting the lru lock/dentry->d_lock here,
+	 * so use a trylock. If we fail to get the lock, just skip
+	 * it
+	 */
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	/*
+	 * Leave everything other than idle negative dentries alone; we
+	 * are working off the configured limit, not memory pressure.
+	 */
+	if (!d_is_negative(dentry) || dentry->d_lockref.count ||
+	    (dentry->d_flags & DCACHE_REFERENCED)) {
+		spin_unlock(&dentry->d_lock);
+		return LRU_SKIP;
+	}
+
+	d_lru_shrink_move(lru, dentry, freeable);
+	spin_unlock(&dentry->d_lock);
+
+	return LRU_REMOVED;
+}
+
+#define NEGATIVE_DENTRY_BATCH	1024
+
+static void prune_negative_one_sb(struct super_block *sb, void *arg)
+{
+	long *freed = arg;
+	LIST_HEAD(dispose);
+
+	if (get_nr_dentry_negative() <= sysctl_negative_dentry_limit)
+		return;
+
+	*freed += list_lru_walk(&sb->s_dentry_lru,
+			dentry_lru_isolate_negative, &dispose,
+			NEGATIVE_DENTRY_BATCH);
+	shrink_dentry_list(&dispose);
+}
+
+static void prune_negative_workfn(struct work_struct *work)
+{
+	long freed = 0;
+
+	iterate_supers(prune_negative_one_sb, &freed);
+
+	/*
+	 * Keep going as long as we make progress and stay over the
+	 * limit; if a pass freed nothing more work will not help, so
+	 * wait until d_lru_add() kicks us again.
+	 */
+	if (freed && sysctl_negative_dentry_limit &&
+	    get_nr_dentry_negative() > sysctl_negative_dentry_limit)
+		schedule_work(work);
+}
+
+static DECLARE_WORK(prune_negative_work, prune_negative_workfn);
+
+static void negative_dentry_check_limit(void)
+{
+	static unsigned long next_check;
+
+	if (!sysctl_negative_dentry_limit)
+		return;
+	if (time_before(jiffies, READ_ONCE(next_check)))
+		return;
+	WRITE_ONCE(next_check, jiffies + HZ);
+	if (get_nr_dentry_negative() > sysctl_negative_dentry_limit)
+		schedule_work(&prune_negative_work);
+}
+
 /**
  * enum d_walk_ret - action to talke during tree walk
  * @D_WALK_CONTINUE:	contrinue walk
@@ -1463,6 +1568,8 @@ void shrink_dcache_for_umount(struct super_block *sb)
 
 	WARN(down_read_trylock(&sb->s_umount), "s_umount should've been locked");
 
+	prefix_cache_evict_sb(sb);
+
 	dentry = sb->s_root;
 	sb->s_root = NULL;
 	do_one_tree(dentry);
@@ -1526,6 +1633,8 @@ void d_invalidate(struct dentry *dentry)
 		return;
 	}
 
+	prefix_cache_invalidate(dentry);
+
 	for (;;) {
 		struct detach_data data;
 
@@ -1636,6 +1745,8 @@ struct dentry *__d_alloc(struct super_block *sb, const struct qstr *name)
 	}
 
 	this_cpu_inc(nr_dentry);
+	/* every dentry starts out negative */
+	this_cpu_inc(nr_dentry_negative);
 
 	return dentry;
 }
@@ -3620,6 +3731,7 @@ void __init vfs_caches_init(void)
 			SLAB_HWCACHE_ALIGN|SLAB_PANIC, NULL);
 
 	dcache_init();
+	dirent_locks_init();
 	inode_init();
 	files_init();
 	files_maxfiles_init();
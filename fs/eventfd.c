@@ -54,12 +54,21 @@ struct eventfd_ctx {
 __u64 eventfd_signal(struct eventfd_ctx *ctx, __u64 n)
 {
 	unsigned long flags;
+	__u64 ucnt;
 
 	spin_lock_irqsave(&ctx->wqh.lock, flags);
+	ucnt = ctx->count;
 	if (ULLONG_MAX - ctx->count < n)
 		n = ULLONG_MAX - ctx->count;
 	ctx->count += n;
-	if (waitqueue_active(&ctx->wqh))
+	/*
+	 * EFD_COALESCE: the doorbell already rang when the counter left
+	 * zero and nobody has read it back down yet, so every consumer
+	 * that can make progress is either awake or about to see the
+	 * non-zero counter; absorb the increment without a wakeup.
+	 */
+	if (waitqueue_active(&ctx->wqh) &&
+	    (!(ctx->flags & EFD_COALESCE) || !ucnt))
 		wake_up_locked_poll(&ctx->wqh, POLLIN);
 	spin_unlock_irqrestore(&ctx->wqh.lock, flags);
 
@@ -315,8 +324,12 @@ static ssize_t eventfd_write(struct file *file, const char __user *buf, size_t c
 		__set_current_state(TASK_RUNNING);
 	}
 	if (likely(res > 0)) {
+		bool was_zero = !ctx->count;
+
 		ctx->count += ucnt;
-		if (waitqueue_active(&ctx->wqh))
+		/* see the EFD_COALESCE comment in eventfd_signal() */
+		if (waitqueue_active(&ctx->wqh) &&
+		    (!(ctx->flags & EFD_COALESCE) || was_zero))
 			wake_up_locked_poll(&ctx->wqh, POLLIN);
 	}
 	spin_unlock_irq(&ctx->wqh.lock);
@@ -455,6 +468,86 @@ struct file *eventfd_file_create(unsigned int count, int flags)
 	return file;
 }
 
+/*
+ * One descriptor of an eventfd_readv() batch; @count returns the value
+ * that a read(2) of @fd would have returned, or 0 if the counter was
+ * empty.
+ *
+ * transitional: belongs in a uapi eventfd header.
+ */
+struct eventfd_val {
+	__s32 fd;
+	__u32 __reserved;
+	__u64 count;
+};
+
+#define EFD_READV_MAX 64
+
+/*
+ * Drain the counters of several eventfds in one call.  Never blocks:
+ * shard-per-core event loops call this after poll/epoll flagged their
+ * doorbells, collecting all counters for the price of one syscall.
+ * Returns the number of descriptors whose counter was non-zero.  On
+ * error, already drained counters have been written back, so the error
+ * is only returned if no descriptor was processed.
+ */
+SYSCALL_DEFINE2(eventfd_readv, struct eventfd_val __user *, vals,
+		unsigned int, nvals)
+{
+	unsigned int i, drained = 0;
+	int ret = 0;
+
+	if (nvals == 0 || nvals > EFD_READV_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < nvals; i++) {
+		struct eventfd_val val;
+		struct eventfd_ctx *ctx;
+		__u64 cnt = 0;
+		struct fd f;
+
+		if (copy_from_user(&val, &vals[i], sizeof(val))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (val.__reserved) {
+			ret = -EINVAL;
+			break;
+		}
+
+		f = fdget(val.fd);
+		if (!f.file) {
+			ret = -EBADF;
+			break;
+		}
+		if (f.file->f_op != &eventfd_fops) {
+			fdput(f);
+			ret = -EINVAL;
+			break;
+		}
+		ctx = f.file->private_data;
+
+		spin_lock_irq(&ctx->wqh.lock);
+		if (ctx->count) {
+			eventfd_ctx_do_read(ctx, &cnt);
+			if (waitqueue_active(&ctx->wqh))
+				wake_up_locked_poll(&ctx->wqh, POLLOUT);
+		}
+		spin_unlock_irq(&ctx->wqh.lock);
+		fdput(f);
+
+		val.count = cnt;
+		if (copy_to_user(&vals[i], &val, sizeof(val))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (cnt)
+			drained++;
+	}
+
+	return i ? drained : ret;
+}
+
 SYSCALL_DEFINE2(eventfd2, unsigned int, count, int, flags)
 {
 	int fd, error;
@@ -41,7 +41,10 @@
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
 #include <linux/compat.h>
+#include <net/busy_poll.h>
 #include <linux/rculist.h>
+#include <linux/llist.h>
+#include <linux/percpu.h>
 
 /*
  * LOCKING:
@@ -89,6 +92,12 @@
  * Events that require holding "epmutex" are very rare, while for
  * normal operations the epoll private "ep->mtx" will guarantee
  * a better scalability.
+ * The poll callback itself runs lockless with respect to the above:
+ * it stages ready items on per-CPU lists ("ep->staged_list") using
+ * atomic operations only, and the consumers fold those lists into
+ * "ep->rdllist" under "ep->lock" (see ep_merge_staged()). This keeps
+ * event delivery from serializing on "ep->lock" when many CPUs are
+ * reporting events against the same epoll file.
  */
 
 /* Epoll private bits inside the event mask */
@@ -149,6 +158,12 @@ struct epitem {
 	/* List header used to link this structure to the eventpoll ready list */
 	struct list_head rdllink;
 
+	/* Used to link this item to one of the per-CPU staged ready lists */
+	struct llist_node staged_link;
+
+	/* Set while the item sits on a per-CPU staged ready list */
+	atomic_t staged;
+
 	/*
 	 * Works together "struct eventpoll"->ovflist in keeping the
 	 * single linked chain of items.
@@ -203,6 +218,16 @@ struct eventpoll {
 	/* List of ready file descriptors */
 	struct list_head rdllist;
 
+	/*
+	 * Per-CPU lists where the poll callback stages ready items without
+	 * taking ->lock.  They are folded into ->rdllist, on the consumer
+	 * side, by ep_merge_staged().
+	 */
+	struct llist_head __percpu *staged_list;
+
+	/* Set while a wakeup of ->wq is in flight, to coalesce wakeups */
+	atomic_t wakeup_pending;
+
 	/* RB tree root used to store monitored fd structs */
 	struct rb_root rbr;
 
@@ -224,6 +249,15 @@ struct eventpoll {
 	/* used to optimize loop detection check */
 	int visited;
 	struct list_head visited_list_link;
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	/* used to track busy poll napi_id */
+	unsigned int napi_id;
+	/* busy poll timeout in usecs; zero means use the global sysctl */
+	u32 busy_poll_usecs;
+	/* busy poll packet budget; zero selects the default budget */
+	u16 busy_poll_budget;
+#endif
 };
 
 /* Wait structure used by the poll hooks */
@@ -381,9 +415,107 @@ static void ep_nested_calls_init(struct nested_calls *ncalls)
  */
 static inline int ep_events_available(struct eventpoll *ep)
 {
-	return !list_empty(&ep->rdllist) || ep->ovflist != EP_UNACTIVE_PTR;
+	int cpu;
+
+	if (!list_empty(&ep->rdllist) || ep->ovflist != EP_UNACTIVE_PTR)
+		return 1;
+
+	for_each_possible_cpu(cpu)
+		if (!llist_empty(per_cpu_ptr(ep->staged_list, cpu)))
+			return 1;
+
+	return 0;
+}
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+static bool ep_busy_loop_on(struct eventpoll *ep)
+{
+	return !!READ_ONCE(ep->busy_poll_usecs) || net_busy_loop_on();
 }
 
+static bool ep_busy_loop_end(void *p, unsigned long start_time)
+{
+	struct eventpoll *ep = p;
+	unsigned long bp_usec = READ_ONCE(ep->busy_poll_usecs);
+
+	if (!bp_usec)
+		bp_usec = READ_ONCE(sysctl_net_busy_poll);
+
+	return ep_events_available(ep) ||
+	       busy_loop_timeout(start_time + bp_usec);
+}
+
+/*
+ * Busy poll the last NAPI context moved onto the ready list, if busy
+ * polling is enabled for this epoll set. With all watched sockets on a
+ * single queue this services the hardware directly instead of waiting
+ * for the softirq wakeup path.
+ */
+static void ep_busy_loop(struct eventpoll *ep, int nonblock)
+{
+	unsigned int napi_id = READ_ONCE(ep->napi_id);
+
+	if (napi_id >= MIN_NAPI_ID && ep_busy_loop_on(ep))
+		napi_busy_loop(napi_id, nonblock ? NULL : ep_busy_loop_end,
+			       ep, READ_ONCE(ep->busy_poll_budget));
+}
+
+static inline void ep_reset_busy_poll_napi_id(struct eventpoll *ep)
+{
+	if (ep->napi_id)
+		ep->napi_id = 0;
+}
+
+/*
+ * Set epoll busy poll NAPI ID from the napi context last seen by @epi's
+ * socket. Sets are expected to watch sockets from a single queue; the
+ * most recent ID simply wins.
+ */
+static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
+{
+	struct eventpoll *ep = epi->ep;
+	unsigned int napi_id;
+	struct socket *sock;
+	struct sock *sk;
+	int err;
+
+	if (!ep_busy_loop_on(ep))
+		return;
+
+	sock = sock_from_file(epi->ffd.file, &err);
+	if (!sock)
+		return;
+
+	sk = sock->sk;
+	if (!sk)
+		return;
+
+	napi_id = READ_ONCE(sk->sk_napi_id);
+
+	/* Non-NAPI IDs can be rejected
+	 *	or
+	 * Nothing to do if we already have this ID
+	 */
+	if (napi_id < MIN_NAPI_ID || napi_id == ep->napi_id)
+		return;
+
+	/* record NAPI ID for use in next busy poll */
+	ep->napi_id = napi_id;
+}
+#else
+static inline void ep_busy_loop(struct eventpoll *ep, int nonblock)
+{
+}
+
+static inline void ep_reset_busy_poll_napi_id(struct eventpoll *ep)
+{
+}
+
+static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
+{
+}
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
 /**
  * ep_call_nested - Perform a bound (possibly) nested call, by checking
  *                  that the recursion limit is not exceeded, and that
@@ -581,6 +713,66 @@ static inline void ep_pm_stay_awake_rcu(struct epitem *epi)
 	rcu_read_unlock();
 }
 
+/*
+ * Fold the per-CPU staged lists into the main ready list. Must be called
+ * with "ep->lock" held. The poll callback stages ready items on CPU-local
+ * lists so that neither "ep->lock" nor the "ep->rdllist" cache lines
+ * bounce across all the CPUs delivering events; the items are brought
+ * back to the main ready list here, on the consumer side.
+ */
+static void ep_merge_staged(struct eventpoll *ep)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct llist_node *node;
+
+		node = llist_del_all(per_cpu_ptr(ep->staged_list, cpu));
+		while (node) {
+			struct epitem *epi;
+
+			epi = llist_entry(node, struct epitem, staged_link);
+			node = node->next;
+
+			/*
+			 * The poll callback may stage the item again right
+			 * after this is cleared; the new staging will simply
+			 * find the item already linked on the next merge.
+			 */
+			atomic_set(&epi->staged, 0);
+
+			if (unlikely(ep->ovflist != EP_UNACTIVE_PTR)) {
+				/*
+				 * Events are being transferred to userspace;
+				 * chain the item on ep->ovflist the same way
+				 * the poll callback used to.
+				 */
+				if (epi->next == EP_UNACTIVE_PTR) {
+					epi->next = ep->ovflist;
+					ep->ovflist = epi;
+					if (epi->ws)
+						__pm_stay_awake(ep->ws);
+				}
+			} else if (!ep_is_linked(&epi->rdllink)) {
+				list_add_tail(&epi->rdllink, &ep->rdllist);
+				ep_pm_stay_awake_rcu(epi);
+			}
+		}
+	}
+}
+
+/*
+ * Coalesce wakeups of the epoll waiters: one wakeup is enough to get a
+ * waiter running through the whole batch of staged events, so further
+ * wakeups are elided until a waiter prepares to sleep again and re-arms
+ * the flag in ep_poll().
+ */
+static void ep_wake_up_batched(struct eventpoll *ep)
+{
+	if (atomic_xchg(&ep->wakeup_pending, 1) == 0)
+		wake_up(&ep->wq);
+}
+
 /**
  * ep_scan_ready_list - Scans the ready list in a way that makes possible for
  *                      the scan code, to call f_op->poll(). Also allows for
@@ -621,6 +813,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	 * in a lockless way.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_merge_staged(ep);
 	list_splice_init(&ep->rdllist, &txlist);
 	ep->ovflist = NULL;
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -634,8 +827,10 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	/*
 	 * During the time we spent inside the "sproc" callback, some
 	 * other events might have been queued by the poll callback.
-	 * We re-insert them inside the main ready-list here.
+	 * Chain the freshly staged ones on ep->ovflist, then re-insert
+	 * the whole lot inside the main ready-list here.
 	 */
+	ep_merge_staged(ep);
 	for (nepi = ep->ovflist; (epi = nepi) != NULL;
 	     nepi = epi->next, epi->next = EP_UNACTIVE_PTR) {
 		/*
@@ -668,7 +863,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 		 * the ->poll() wait list (delayed after we release the lock).
 		 */
 		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
+			wake_up(&ep->wq);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -716,7 +911,13 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 
 	rb_erase(&epi->rbn, &ep->rbr);
 
+	/*
+	 * The callbacks are unregistered, but the item may still sit on a
+	 * per-CPU staged list; fold the lists so it can be unlinked before
+	 * the RCU free below.
+	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_merge_staged(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -785,6 +986,7 @@ static void ep_free(struct eventpoll *ep)
 	mutex_destroy(&ep->mtx);
 	free_uid(ep->user);
 	wakeup_source_unregister(ep->ws);
+	free_percpu(ep->staged_list);
 	kfree(ep);
 }
 
@@ -874,6 +1076,47 @@ static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
 	return pollflags != -1 ? pollflags : 0;
 }
 
+static long ep_eventpoll_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	struct eventpoll *ep = file->private_data;
+	void __user *uarg = (void __user *)arg;
+	struct epoll_params epoll_params;
+
+	switch (cmd) {
+	case EPIOCSPARAMS:
+		if (copy_from_user(&epoll_params, uarg, sizeof(epoll_params)))
+			return -EFAULT;
+
+		if (epoll_params.__pad)
+			return -EINVAL;
+
+		if (epoll_params.busy_poll_usecs > S32_MAX)
+			return -EINVAL;
+
+		if (epoll_params.busy_poll_budget > NAPI_POLL_WEIGHT &&
+		    !capable(CAP_NET_ADMIN))
+			return -EPERM;
+
+		WRITE_ONCE(ep->busy_poll_usecs, epoll_params.busy_poll_usecs);
+		WRITE_ONCE(ep->busy_poll_budget, epoll_params.busy_poll_budget);
+		return 0;
+	case EPIOCGPARAMS:
+		memset(&epoll_params, 0, sizeof(epoll_params));
+		epoll_params.busy_poll_usecs = READ_ONCE(ep->busy_poll_usecs);
+		epoll_params.busy_poll_budget = READ_ONCE(ep->busy_poll_budget);
+		if (copy_to_user(uarg, &epoll_params, sizeof(epoll_params)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOIOCTLCMD;
+	}
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 #ifdef CONFIG_PROC_FS
 static void ep_show_fdinfo(struct seq_file *m, struct file *f)
 {
@@ -901,6 +1144,8 @@ static const struct file_operations eventpoll_fops = {
 #endif
 	.release	= ep_eventpoll_release,
 	.poll		= ep_eventpoll_poll,
+	.unlocked_ioctl	= ep_eventpoll_ioctl,
+	.compat_ioctl	= ep_eventpoll_ioctl,
 	.llseek		= noop_llseek,
 };
 
@@ -949,6 +1194,10 @@ static int ep_alloc(struct eventpoll **pep)
 	if (unlikely(!ep))
 		goto free_uid;
 
+	ep->staged_list = alloc_percpu(struct llist_head);
+	if (unlikely(!ep->staged_list))
+		goto free_ep;
+
 	spin_lock_init(&ep->lock);
 	mutex_init(&ep->mtx);
 	init_waitqueue_head(&ep->wq);
@@ -962,6 +1211,8 @@ static int ep_alloc(struct eventpoll **pep)
 
 	return 0;
 
+free_ep:
+	kfree(ep);
 free_uid:
 	free_uid(user);
 	return error;
@@ -1004,7 +1255,6 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
 	int pwake = 0;
-	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
 	int ewake = 0;
@@ -1020,7 +1270,7 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 		list_del_init(&wait->task_list);
 	}
 
-	spin_lock_irqsave(&ep->lock, flags);
+	ep_set_busy_poll_napi_id(epi);
 
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
@@ -1029,7 +1279,7 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * until the next EPOLL_CTL_MOD will be issued.
 	 */
 	if (!(epi->event.events & ~EP_PRIVATE_BITS))
-		goto out_unlock;
+		goto out;
 
 	/*
 	 * Check the events coming with the callback. At this stage, not
@@ -1038,34 +1288,19 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * test for "key" != NULL before the event match test.
 	 */
 	if (key && !((unsigned long) key & epi->event.events))
-		goto out_unlock;
+		goto out;
 
 	/*
-	 * If we are transferring events to userspace, we can hold no locks
-	 * (because we're accessing user memory, and because of linux f_op->poll()
-	 * semantics). All the events that happen during that period of time are
-	 * chained in ep->ovflist and requeued later on.
+	 * Stage the item on the CPU-local ready list instead of taking
+	 * "ep->lock" and queueing on "ep->rdllist" directly: with a large
+	 * number of watched descriptors both would bounce across every CPU
+	 * delivering events. The consumers fold the staged items back into
+	 * the main ready list (or chain them on "ep->ovflist", if a transfer
+	 * to userspace is in progress) in ep_merge_staged().
 	 */
-	if (unlikely(ep->ovflist != EP_UNACTIVE_PTR)) {
-		if (epi->next == EP_UNACTIVE_PTR) {
-			epi->next = ep->ovflist;
-			ep->ovflist = epi;
-			if (epi->ws) {
-				/*
-				 * Activate ep->ws since epi->ws may get
-				 * deactivated at any time.
-				 */
-				__pm_stay_awake(ep->ws);
-			}
-
-		}
-		goto out_unlock;
-	}
-
-	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink)) {
-		list_add_tail(&epi->rdllink, &ep->rdllist);
+	if (atomic_xchg(&epi->staged, 1) == 0) {
 		ep_pm_stay_awake_rcu(epi);
+		llist_add(&epi->staged_link, this_cpu_ptr(ep->staged_list));
 	}
 
 	/*
@@ -1089,15 +1324,13 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 				break;
 			}
 		}
-		wake_up_locked(&ep->wq);
+		ep_wake_up_batched(ep);
 	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
-out_unlock:
-	spin_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
+out:
+	/* We have to call this outside the wait queue lock */
 	if (pwake)
 		ep_poll_safewake(&ep->poll_wait);
 
@@ -1314,6 +1547,7 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	epi->event = *event;
 	epi->nwait = 0;
 	epi->next = EP_UNACTIVE_PTR;
+	atomic_set(&epi->staged, 0);
 	if (epi->event.events & EPOLLWAKEUP) {
 		error = ep_create_wakeup_source(epi);
 		if (error)
@@ -1370,7 +1604,7 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 
 		/* Notify waiting tasks that events are available */
 		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
+			wake_up(&ep->wq);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -1402,6 +1636,7 @@ error_unregister:
 	 * And ep_insert() is called with "mtx" held.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_merge_staged(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -1446,9 +1681,8 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 * 1) Flush epi changes above to other CPUs.  This ensures
 	 *    we do not miss events from ep_poll_callback if an
 	 *    event occurs immediately after we call f_op->poll().
-	 *    We need this because we did not take ep->lock while
-	 *    changing epi above (but ep_poll_callback does take
-	 *    ep->lock).
+	 *    We need this because neither we nor ep_poll_callback
+	 *    take ep->lock while accessing the event mask.
 	 *
 	 * 2) We also need to ensure we do not miss _past_ events
 	 *    when calling f_op->poll().  This barrier also
@@ -1478,7 +1712,7 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 
 			/* Notify waiting tasks that events are available */
 			if (waitqueue_active(&ep->wq))
-				wake_up_locked(&ep->wq);
+				wake_up(&ep->wq);
 			if (waitqueue_active(&ep->poll_wait))
 				pwake++;
 		}
@@ -1637,16 +1871,26 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 	}
 
 fetch_events:
+	if (!ep_events_available(ep))
+		ep_busy_loop(ep, timed_out);
+
 	spin_lock_irqsave(&ep->lock, flags);
 
 	if (!ep_events_available(ep)) {
+		/*
+		 * Busy poll timed out.  Drop NAPI ID for now, we can add
+		 * it back in when we have moved a socket with a valid NAPI
+		 * ID onto the ready list.
+		 */
+		ep_reset_busy_poll_napi_id(ep);
+
 		/*
 		 * We don't have any available event to return to the caller.
 		 * We need to sleep here, and we will be wake up by
 		 * ep_poll_callback() when events will become available.
 		 */
 		init_waitqueue_entry(&wait, current);
-		__add_wait_queue_exclusive(&ep->wq, &wait);
+		add_wait_queue_exclusive(&ep->wq, &wait);
 
 		for (;;) {
 			/*
@@ -1655,6 +1899,15 @@ fetch_events:
 			 * to TASK_INTERRUPTIBLE before doing the checks.
 			 */
 			set_current_state(TASK_INTERRUPTIBLE);
+			/*
+			 * Re-arm the wakeup coalescing flag before checking
+			 * for events: a callback staging an event after this
+			 * point is then guaranteed to issue a wakeup, while
+			 * one staged before it is seen by the check below.
+			 * The xchg is a full barrier ordering the flag write
+			 * against the staged list reads.
+			 */
+			atomic_xchg(&ep->wakeup_pending, 0);
 			if (ep_events_available(ep) || timed_out)
 				break;
 			if (signal_pending(current)) {
@@ -1669,7 +1922,7 @@ fetch_events:
 			spin_lock_irqsave(&ep->lock, flags);
 		}
 
-		__remove_wait_queue(&ep->wq, &wait);
+		remove_wait_queue(&ep->wq, &wait);
 		__set_current_state(TASK_RUNNING);
 	}
 check_events:
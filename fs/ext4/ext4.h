@@ -635,6 +635,8 @@ enum {
 #define EXT4_IOC_RESIZE_FS		_IOW('f', 16, __u64)
 #define EXT4_IOC_SWAP_BOOT		_IO('f', 17)
 #define EXT4_IOC_PRECACHE_EXTENTS	_IO('f', 18)
+#define EXT4_IOC_GET_DAX_DIRTY		_IOWR('f', 19, struct ext4_get_dax_dirty)
+#define EXT4_IOC_DIO_OVERWRITE		_IOWR('f', 20, struct ext4_dio_overwrite)
 #define EXT4_IOC_SET_ENCRYPTION_POLICY	FS_IOC_SET_ENCRYPTION_POLICY
 #define EXT4_IOC_GET_ENCRYPTION_PWSALT	FS_IOC_GET_ENCRYPTION_PWSALT
 #define EXT4_IOC_GET_ENCRYPTION_POLICY	FS_IOC_GET_ENCRYPTION_POLICY
@@ -771,6 +773,33 @@ struct move_extent {
 	__u64 moved_len;	/* moved block length */
 };
 
+/*
+ * Used by EXT4_IOC_GET_DAX_DIRTY to report which pages of a DAX file
+ * were written through a mapping since the last writeback, without
+ * flushing or clearing anything.  @ranges points to an array of
+ * struct dax_dirty_range (see linux/dax.h).
+ */
+struct ext4_get_dax_dirty {
+	__u64 start;		/* in/out: first page index to scan */
+	__u64 end;		/* in: last page index (inclusive) */
+	__u64 ranges;		/* in: pointer to dax_dirty_range array */
+	__u64 nr;		/* in: array capacity, out: entries filled */
+};
+
+/*
+ * Used by EXT4_IOC_DIO_OVERWRITE to report whether an O_DIRECT write
+ * to the given byte range would take the lockless overwrite path, i.e.
+ * run without the exclusive inode lock and without starting a journal
+ * handle.  The answer is advisory: a concurrent truncate, hole punch
+ * or extending write can invalidate it.
+ */
+struct ext4_dio_overwrite {
+	__u64 offset;		/* in: byte offset of intended write */
+	__u64 len;		/* in: length of intended write in bytes */
+	__u32 overwrite;	/* out: 1 if the overwrite fastpath applies */
+	__u32 pad;		/* must be zero */
+};
+
 #define EXT4_EPOCH_BITS 2
 #define EXT4_EPOCH_MASK ((1 << EXT4_EPOCH_BITS) - 1)
 #define EXT4_NSEC_MASK  (~0UL << EXT4_EPOCH_BITS)
@@ -968,6 +997,16 @@ struct ext4_inode_info {
 
 	struct list_head i_orphan;	/* unlinked but open inodes */
 
+	/*
+	 * Pending byte-range write locks.  Buffered overwrites take
+	 * i_rwsem shared and serialize among themselves on byte ranges
+	 * here instead, so writes to disjoint regions of a file can run
+	 * in parallel; see ext4_lock_write_range().
+	 */
+	spinlock_t i_write_range_lock;
+	struct list_head i_write_ranges;
+	wait_queue_head_t i_write_range_wait;
+
 	/*
 	 * i_disksize keeps track of what the inode size is ON DISK, not
 	 * in memory.  During truncate, i_size is set to the new size by
@@ -1351,6 +1390,18 @@ struct ext4_super_block {
 /*
  * fourth extended-fs super-block data in memory
  */
+/* last allocated extent per CPU, goal for mballoc stream allocation */
+struct ext4_mb_stream_goal {
+	ext4_group_t group;
+	ext4_grpblk_t start;
+};
+
+/* last allocated file inode per CPU, continuation goal for creates */
+struct ext4_ino_goal {
+	ext4_group_t group;
+	unsigned long ino;
+};
+
 struct ext4_sb_info {
 	unsigned long s_desc_size;	/* Size of a group descriptor in bytes */
 	unsigned long s_inodes_per_block;/* Number of inodes per block */
@@ -1385,6 +1436,7 @@ struct ext4_sb_info {
 	int s_first_ino;
 	unsigned int s_inode_readahead_blks;
 	unsigned int s_inode_goal;
+	struct ext4_ino_goal __percpu *s_ino_goal;
 	spinlock_t s_next_gen_lock;
 	u32 s_next_generation;
 	u32 s_hash_seed[4];
@@ -1438,6 +1490,7 @@ struct ext4_sb_info {
 
 	/* tunables */
 	unsigned long s_stripe;
+	unsigned int s_orphan_workers;
 	unsigned int s_mb_stream_request;
 	unsigned int s_mb_max_to_scan;
 	unsigned int s_mb_min_to_scan;
@@ -1445,9 +1498,12 @@ struct ext4_sb_info {
 	unsigned int s_mb_order2_reqs;
 	unsigned int s_mb_group_prealloc;
 	unsigned int s_max_dir_size_kb;
-	/* where last allocation was done - for stream allocation */
-	unsigned long s_mb_last_group;
-	unsigned long s_mb_last_start;
+	/*
+	 * Where the last allocation was done - for stream allocation.
+	 * Kept per CPU so that concurrent streaming writers follow
+	 * their own goal instead of fighting over one global one.
+	 */
+	struct ext4_mb_stream_goal __percpu *s_mb_stream_goal;
 
 	/* stats for buddy allocator */
 	atomic_t s_bal_reqs;	/* number of reqs with len > 1 */
@@ -1880,6 +1936,12 @@ static inline bool ext4_has_incompat_features(struct super_block *sb)
 #define EXT4_DEF_MIN_BATCH_TIME	0
 #define EXT4_DEF_MAX_BATCH_TIME	15000 /* 15ms */
 
+/*
+ * Cap on the workers processing the orphan list at mount time; the
+ * actual default is the smaller of this and the online CPU count.
+ */
+#define EXT4_DEF_ORPHAN_WORKERS	8
+
 /*
  * Minimum number of groups in a flexgroup before we separate out
  * directories into the first block group of a flexgroup
@@ -2421,6 +2483,7 @@ extern void ext4_end_bitmap_read(struct buffer_head *bh, int uptodate);
 
 /* mballoc.c */
 extern const struct file_operations ext4_seq_mb_groups_fops;
+extern ssize_t ext4_mb_freefrag_show(struct ext4_sb_info *sbi, char *buf);
 extern long ext4_mb_stats;
 extern long ext4_mb_max_to_scan;
 extern int ext4_mb_init(struct super_block *);
@@ -2969,6 +3032,7 @@ extern const struct file_operations ext4_dir_operations;
 extern const struct inode_operations ext4_file_inode_operations;
 extern const struct file_operations ext4_file_operations;
 extern loff_t ext4_llseek(struct file *file, loff_t offset, int origin);
+extern bool ext4_dio_overwrite(struct inode *inode, loff_t pos, loff_t len);
 
 /* inline.c */
 extern int ext4_get_max_inline_size(struct inode *inode);
@@ -142,6 +142,9 @@
 
 static struct kmem_cache *ext4_es_cachep;
 
+/* Most extents one inode may lose in a single shrinker pass */
+#define ES_SHRINK_INODE_BATCH	128
+
 static int __es_insert_extent(struct inode *inode, struct extent_status *newes);
 static int __es_remove_extent(struct inode *inode, ext4_lblk_t lblk,
 			      ext4_lblk_t end);
@@ -978,6 +981,7 @@ static int __es_shrink(struct ext4_sb_info *sbi, int nr_to_scan,
 	u64 scan_time;
 	int nr_to_walk;
 	int nr_shrunk = 0;
+	int nr_this_inode, nr_left;
 	int retried = 0, nr_skipped = 0;
 
 	es_stats = &sbi->s_es_stats;
@@ -1016,7 +1020,17 @@ retry:
 		 */
 		spin_unlock(&sbi->s_es_lock);
 
-		nr_shrunk += es_reclaim_extents(ei, &nr_to_scan);
+		/*
+		 * Cap how much of the scan budget one inode may eat, so
+		 * that pressure rotates over ranges of all inodes on the
+		 * list instead of dumping the cache of whichever inode
+		 * happens to be at the head.  The per-inode cursor makes
+		 * the next visit continue where this one stopped.
+		 */
+		nr_this_inode = min(nr_to_scan, ES_SHRINK_INODE_BATCH);
+		nr_left = nr_this_inode;
+		nr_shrunk += es_reclaim_extents(ei, &nr_left);
+		nr_to_scan -= nr_this_inode - nr_left;
 		write_unlock(&ei->i_es_lock);
 
 		if (nr_to_scan <= 0)
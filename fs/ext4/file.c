@@ -147,6 +147,127 @@ static bool ext4_overwrite_io(struct inode *inode, loff_t pos, loff_t len)
 	return err == blklen && (map.m_flags & EXT4_MAP_MAPPED);
 }
 
+/*
+ * Can an O_DIRECT write to @pos/@len run without the exclusive inode
+ * lock and without a journal handle?  All blocks must be mapped and
+ * initialized so no metadata can change under the write, the inode
+ * must be extent mapped so get_block never modifies an indirect tree,
+ * and data journaling must be off since journalled data always needs
+ * a handle.  Note this is independent of the dioread_nolock mount
+ * option: ext4_overwrite_io() guarantees there are no unwritten
+ * extents to expose, which is all that option's ordering buys us.
+ */
+bool ext4_dio_overwrite(struct inode *inode, loff_t pos, loff_t len)
+{
+	if (!S_ISREG(inode->i_mode))
+		return false;
+	if (!ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS))
+		return false;
+	if (ext4_should_journal_data(inode))
+		return false;
+	return ext4_overwrite_io(inode, pos, len);
+}
+
+/*
+ * Byte-range write locking.
+ *
+ * A buffered overwrite that cannot change i_size or any security
+ * attribute only needs the inode lock to keep other writers from
+ * interleaving with it.  Such writers take i_rwsem shared and
+ * serialize among themselves on byte ranges instead, so writes to
+ * disjoint regions of one big file proceed in parallel while anything
+ * that modifies the inode (truncate, extending writes, setattr) still
+ * takes i_rwsem exclusive and excludes them all.  Ranges are granted
+ * in arrival order so overlapping writers cannot starve each other.
+ */
+struct ext4_write_range {
+	struct list_head	wr_list;
+	loff_t			wr_start;
+	loff_t			wr_end;		/* inclusive */
+	bool			wr_granted;
+};
+
+/* A range may go ahead if no earlier-queued range overlaps it. */
+static bool ext4_write_range_grantable(struct ext4_inode_info *ei,
+				       struct ext4_write_range *wr)
+{
+	struct ext4_write_range *pos;
+
+	list_for_each_entry(pos, &ei->i_write_ranges, wr_list) {
+		if (pos == wr)
+			return true;
+		if (pos->wr_start <= wr->wr_end && wr->wr_start <= pos->wr_end)
+			return false;
+	}
+	return true;
+}
+
+static void ext4_lock_write_range(struct inode *inode,
+				  struct ext4_write_range *wr,
+				  loff_t pos, size_t len)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+
+	wr->wr_start = pos;
+	wr->wr_end = pos + len - 1;
+
+	spin_lock(&ei->i_write_range_lock);
+	list_add_tail(&wr->wr_list, &ei->i_write_ranges);
+	wr->wr_granted = ext4_write_range_grantable(ei, wr);
+	spin_unlock(&ei->i_write_range_lock);
+
+	if (!wr->wr_granted)
+		wait_event(ei->i_write_range_wait, READ_ONCE(wr->wr_granted));
+}
+
+static void ext4_unlock_write_range(struct inode *inode,
+				    struct ext4_write_range *wr)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_write_range *pos;
+	bool wake = false;
+
+	spin_lock(&ei->i_write_range_lock);
+	list_del(&wr->wr_list);
+	list_for_each_entry(pos, &ei->i_write_ranges, wr_list) {
+		if (!pos->wr_granted && ext4_write_range_grantable(ei, pos)) {
+			WRITE_ONCE(pos->wr_granted, true);
+			wake = true;
+		}
+	}
+	spin_unlock(&ei->i_write_range_lock);
+
+	if (wake)
+		wake_up_all(&ei->i_write_range_wait);
+}
+
+/*
+ * Can this buffered write run under a shared i_rwsem?  It must not
+ * extend i_size or O_APPEND (generic_write_checks() would move
+ * ki_pos), must not need to strip setuid bits or security xattrs
+ * (file_remove_privs() stays a no-op while S_NOSEC is set, and
+ * clearing it requires i_rwsem exclusive), and inline-data inodes are
+ * excluded since their writes rewrite the inode body itself.  i_size
+ * and S_NOSEC are stable under the shared lock, so rechecking this
+ * after inode_lock_shared() makes the answer reliable.
+ */
+static bool ext4_buffered_overwrite_ok(struct kiocb *iocb,
+				       struct iov_iter *from)
+{
+	struct inode *inode = file_inode(iocb->ki_filp);
+	size_t count = iov_iter_count(from);
+
+	if (iocb->ki_flags & IOCB_APPEND)
+		return false;
+	if (!IS_NOSEC(inode))
+		return false;
+	if (ext4_test_inode_flag(inode, EXT4_INODE_INLINE_DATA))
+		return false;
+	if (!count)
+		return false;
+	return iocb->ki_pos + count <= i_size_read(inode);
+}
+
 static ssize_t ext4_write_checks(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct inode *inode = file_inode(iocb->ki_filp);
@@ -218,6 +339,32 @@ ext4_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 		return ext4_dax_write_iter(iocb, from);
 #endif
 
+	if (!o_direct && ext4_buffered_overwrite_ok(iocb, from)) {
+		struct ext4_write_range wr;
+
+		inode_lock_shared(inode);
+		if (!ext4_buffered_overwrite_ok(iocb, from)) {
+			/* Lost a race with truncate; take the slow path. */
+			inode_unlock_shared(inode);
+			goto exclusive;
+		}
+		ret = ext4_write_checks(iocb, from);
+		if (ret <= 0) {
+			inode_unlock_shared(inode);
+			return ret;
+		}
+		ext4_lock_write_range(inode, &wr, iocb->ki_pos,
+				      iov_iter_count(from));
+		ret = __generic_file_write_iter(iocb, from);
+		ext4_unlock_write_range(inode, &wr);
+		inode_unlock_shared(inode);
+
+		if (ret > 0)
+			ret = generic_write_sync(iocb, ret);
+		return ret;
+	}
+
+exclusive:
 	inode_lock(inode);
 	ret = ext4_write_checks(iocb, from);
 	if (ret <= 0)
@@ -237,8 +384,8 @@ ext4_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 
 	iocb->private = &overwrite;
 	/* Check whether we do a DIO overwrite or not */
-	if (o_direct && ext4_should_dioread_nolock(inode) && !unaligned_aio &&
-	    ext4_overwrite_io(inode, iocb->ki_pos, iov_iter_count(from)))
+	if (o_direct && !unaligned_aio &&
+	    ext4_dio_overwrite(inode, iocb->ki_pos, iov_iter_count(from)))
 		overwrite = 1;
 
 	ret = __generic_file_write_iter(iocb, from);
@@ -604,6 +604,7 @@ static int find_group_other(struct super_block *sb, struct inode *parent,
 	 * group for future allocations.
 	 */
 	if (flex_size > 1) {
+		ext4_group_t start;
 		int retry = 0;
 
 	try_again:
@@ -611,13 +612,24 @@ static int find_group_other(struct super_block *sb, struct inode *parent,
 		last = parent_group + flex_size;
 		if (last > ngroups)
 			last = ngroups;
-		for  (i = parent_group; i < last; i++) {
+		/*
+		 * Stride concurrent creators across the members of the
+		 * flex group so they do not all serialize on the first
+		 * member's inode bitmap; placement still stays within
+		 * the flex group chosen above.
+		 */
+		start = parent_group +
+			raw_smp_processor_id() % (last - parent_group);
+		i = start;
+		do {
 			desc = ext4_get_group_desc(sb, i, NULL);
 			if (desc && ext4_free_inodes_count(sb, desc)) {
 				*group = i;
 				return 0;
 			}
-		}
+			if (++i >= last)
+				i = parent_group;
+		} while (i != start);
 		if (!retry && EXT4_I(parent)->i_last_alloc_group != ~0) {
 			retry = 1;
 			parent_group = EXT4_I(parent)->i_last_alloc_group;
@@ -822,10 +834,42 @@ struct inode *__ext4_new_inode(handle_t *handle, struct inode *dir,
 		goto got_group;
 	}
 
-	if (S_ISDIR(mode))
+	if (S_ISDIR(mode)) {
 		ret2 = find_group_orlov(sb, dir, &group, mode, qstr);
-	else
+	} else {
 		ret2 = find_group_other(sb, dir, &group, mode);
+		/*
+		 * Continue from the last file inode this CPU allocated
+		 * when that stays within the flex group picked above.
+		 * Parallel create streams then keep working in distinct
+		 * member groups with a known-free search offset instead
+		 * of rescanning, and racing on, one shared bitmap.
+		 */
+		if (ret2 == 0) {
+			int flex_size = ext4_flex_bg_size(sbi);
+
+			if (flex_size > 1) {
+				ext4_group_t first, last;
+				struct ext4_ino_goal *ig;
+
+				first = group & ~((ext4_group_t)flex_size - 1);
+				last = first + flex_size;
+				if (last > ngroups)
+					last = ngroups;
+				ig = get_cpu_ptr(sbi->s_ino_goal);
+				if (ig->group >= first && ig->group < last) {
+					gdp = ext4_get_group_desc(sb,
+							ig->group, NULL);
+					if (gdp &&
+					    ext4_free_inodes_count(sb, gdp)) {
+						group = ig->group;
+						ino = ig->ino;
+					}
+				}
+				put_cpu_ptr(sbi->s_ino_goal);
+			}
+		}
+	}
 
 got_group:
 	EXT4_I(dir)->i_last_alloc_group = group;
@@ -910,8 +954,17 @@ repeat_in_this_group:
 		ret2 = ext4_test_and_set_bit(ino, inode_bitmap_bh->b_data);
 		ext4_unlock_group(sb, group);
 		ino++;		/* the inode bitmap is zero-based */
-		if (!ret2)
+		if (!ret2) {
+			if (!S_ISDIR(mode)) {
+				struct ext4_ino_goal *ig;
+
+				ig = get_cpu_ptr(sbi->s_ino_goal);
+				ig->group = group;
+				ig->ino = ino;
+				put_cpu_ptr(sbi->s_ino_goal);
+			}
 			goto got; /* we grabbed the inode! */
+		}
 next_inode:
 		if (ino < EXT4_INODES_PER_GROUP(sb))
 			goto repeat_in_this_group;
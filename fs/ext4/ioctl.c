@@ -16,6 +16,7 @@
 #include <linux/quotaops.h>
 #include <linux/uuid.h>
 #include <linux/uaccess.h>
+#include <linux/dax.h>
 #include "ext4_jbd2.h"
 #include "ext4.h"
 
@@ -442,6 +443,78 @@ static inline unsigned long ext4_xflags_to_iflags(__u32 xflags)
 	return iflags;
 }
 
+static int ext4_ioctl_get_dax_dirty(struct file *filp, void __user *uarg)
+{
+	struct inode *inode = file_inode(filp);
+	struct ext4_get_dax_dirty arg;
+	struct dax_dirty_range *ranges;
+	unsigned int batch, filled;
+	u64 done = 0;
+	pgoff_t index;
+	int err = 0;
+
+	if (!IS_DAX(inode))
+		return -EOPNOTSUPP;
+
+	if (copy_from_user(&arg, uarg, sizeof(arg)))
+		return -EFAULT;
+
+	if (arg.start > arg.end)
+		return -EINVAL;
+
+	ranges = (struct dax_dirty_range *)__get_free_page(GFP_KERNEL);
+	if (!ranges)
+		return -ENOMEM;
+
+	index = arg.start;
+	while (done < arg.nr) {
+		batch = min_t(u64, arg.nr - done, PAGE_SIZE / sizeof(*ranges));
+		filled = dax_get_dirty_ranges(inode->i_mapping, &index,
+					      arg.end, ranges, batch);
+		if (!filled)
+			break;
+		if (copy_to_user(u64_to_user_ptr(arg.ranges) +
+				 done * sizeof(*ranges),
+				 ranges, filled * sizeof(*ranges))) {
+			err = -EFAULT;
+			break;
+		}
+		done += filled;
+		if (filled < batch)
+			break;
+	}
+
+	free_page((unsigned long)ranges);
+
+	if (!err) {
+		arg.start = index;
+		arg.nr = done;
+		if (copy_to_user(uarg, &arg, sizeof(arg)))
+			err = -EFAULT;
+	}
+	return err;
+}
+
+static int ext4_ioctl_dio_overwrite(struct file *filp, void __user *uarg)
+{
+	struct inode *inode = file_inode(filp);
+	struct ext4_dio_overwrite arg;
+
+	if (copy_from_user(&arg, uarg, sizeof(arg)))
+		return -EFAULT;
+
+	if (arg.pad || !arg.len || arg.offset + arg.len < arg.offset)
+		return -EINVAL;
+
+	inode_lock_shared(inode);
+	arg.overwrite = ext4_dio_overwrite(inode, arg.offset, arg.len);
+	inode_unlock_shared(inode);
+
+	if (copy_to_user(uarg, &arg, sizeof(arg)))
+		return -EFAULT;
+	return 0;
+}
+
 long ext4_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct inode *inode = file_inode(filp);
@@ -788,6 +861,12 @@ resizefs_out:
 	case EXT4_IOC_PRECACHE_EXTENTS:
 		return ext4_ext_precache(inode);
 
+	case EXT4_IOC_GET_DAX_DIRTY:
+		return ext4_ioctl_get_dax_dirty(filp, (void __user *)arg);
+
+	case EXT4_IOC_DIO_OVERWRITE:
+		return ext4_ioctl_dio_overwrite(filp, (void __user *)arg);
+
 	case EXT4_IOC_SET_ENCRYPTION_POLICY:
 		if (!ext4_has_feature_encrypt(sb))
 			return -EOPNOTSUPP;
@@ -956,6 +1035,8 @@ long ext4_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case EXT4_IOC_MOVE_EXT:
 	case EXT4_IOC_RESIZE_FS:
 	case EXT4_IOC_PRECACHE_EXTENTS:
+	case EXT4_IOC_GET_DAX_DIRTY:
+	case EXT4_IOC_DIO_OVERWRITE:
 	case EXT4_IOC_SET_ENCRYPTION_POLICY:
 	case EXT4_IOC_GET_ENCRYPTION_PWSALT:
 	case EXT4_IOC_GET_ENCRYPTION_POLICY:
@@ -1672,10 +1672,12 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 	get_page(ac->ac_buddy_page);
 	/* store last allocated for subsequent stream allocation */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		spin_lock(&sbi->s_md_lock);
-		sbi->s_mb_last_group = ac->ac_f_ex.fe_group;
-		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
-		spin_unlock(&sbi->s_md_lock);
+		struct ext4_mb_stream_goal *goal;
+
+		goal = get_cpu_ptr(sbi->s_mb_stream_goal);
+		goal->group = ac->ac_f_ex.fe_group;
+		goal->start = ac->ac_f_ex.fe_start;
+		put_cpu_ptr(sbi->s_mb_stream_goal);
 	}
 }
 
@@ -2145,13 +2147,19 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 			ac->ac_2order = i - 1;
 	}
 
-	/* if stream allocation is enabled, use global goal */
+	/*
+	 * If stream allocation is enabled, continue from this CPU's
+	 * last allocation.  Each CPU streams into its own region, so
+	 * parallel appenders neither serialize on a lock here nor
+	 * interleave their extents in one group.
+	 */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		/* TBD: may be hot point */
-		spin_lock(&sbi->s_md_lock);
-		ac->ac_g_ex.fe_group = sbi->s_mb_last_group;
-		ac->ac_g_ex.fe_start = sbi->s_mb_last_start;
-		spin_unlock(&sbi->s_md_lock);
+		struct ext4_mb_stream_goal *goal;
+
+		goal = get_cpu_ptr(sbi->s_mb_stream_goal);
+		ac->ac_g_ex.fe_group = goal->group;
+		ac->ac_g_ex.fe_start = goal->start;
+		put_cpu_ptr(sbi->s_mb_stream_goal);
 	}
 
 	/* Let's just scan groups to find more-less suitable blocks */
@@ -2356,6 +2364,43 @@ const struct file_operations ext4_seq_mb_groups_fops = {
 	.release	= seq_release,
 };
 
+/*
+ * Free-space fragmentation summary for sysfs: the number of free
+ * buddy extents of each power-of-two order, summed over all
+ * initialized groups.  The counters are read without group locks -
+ * this is a statistic, momentary skew is fine.
+ */
+ssize_t ext4_mb_freefrag_show(struct ext4_sb_info *sbi, char *buf)
+{
+	struct super_block *sb = sbi->s_sb;
+	ext4_group_t ngroups = ext4_get_groups_count(sb);
+	int nr_orders = sb->s_blocksize_bits + 2;
+	unsigned long long counters[EXT4_MAX_BLOCK_LOG_SIZE + 2] = { 0 };
+	unsigned long long free = 0, fragments = 0;
+	ext4_group_t g;
+	ssize_t len = 0;
+	int order;
+
+	for (g = 0; g < ngroups; g++) {
+		struct ext4_group_info *grp = ext4_get_group_info(sb, g);
+
+		if (!grp || EXT4_MB_GRP_NEED_INIT(grp))
+			continue;
+		free += grp->bb_free;
+		fragments += grp->bb_fragments;
+		for (order = 0; order < nr_orders; order++)
+			counters[order] += grp->bb_counters[order];
+	}
+
+	len += snprintf(buf + len, PAGE_SIZE - len,
+			"free_clusters: %llu\nfragments: %llu\n",
+			free, fragments);
+	for (order = 0; order < nr_orders && len < PAGE_SIZE; order++)
+		len += snprintf(buf + len, PAGE_SIZE - len, "order_%d: %llu\n",
+				order, counters[order]);
+	return len;
+}
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -2660,10 +2705,16 @@ int ext4_mb_init(struct super_block *sb)
 			sbi->s_mb_group_prealloc, sbi->s_stripe);
 	}
 
+	sbi->s_mb_stream_goal = alloc_percpu(struct ext4_mb_stream_goal);
+	if (sbi->s_mb_stream_goal == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
 		ret = -ENOMEM;
-		goto out;
+		goto out_free_stream_goal;
 	}
 	for_each_possible_cpu(i) {
 		struct ext4_locality_group *lg;
@@ -2684,6 +2735,9 @@ int ext4_mb_init(struct super_block *sb)
 out_free_locality_groups:
 	free_percpu(sbi->s_locality_groups);
 	sbi->s_locality_groups = NULL;
+out_free_stream_goal:
+	free_percpu(sbi->s_mb_stream_goal);
+	sbi->s_mb_stream_goal = NULL;
 out:
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
@@ -2765,6 +2819,7 @@ int ext4_mb_release(struct super_block *sb)
 	}
 
 	free_percpu(sbi->s_locality_groups);
+	free_percpu(sbi->s_mb_stream_goal);
 
 	return 0;
 }
@@ -864,6 +864,7 @@ static void ext4_put_super(struct super_block *sb)
 	percpu_counter_destroy(&sbi->s_freeinodes_counter);
 	percpu_counter_destroy(&sbi->s_dirs_counter);
 	percpu_counter_destroy(&sbi->s_dirtyclusters_counter);
+	free_percpu(sbi->s_ino_goal);
 	percpu_free_rwsem(&sbi->s_journal_flag_rwsem);
 #ifdef CONFIG_QUOTA
 	for (i = 0; i < EXT4_MAXQUOTAS; i++)
@@ -927,6 +928,9 @@ static struct inode *ext4_alloc_inode(struct super_block *sb)
 	spin_lock_init(&ei->i_raw_lock);
 	INIT_LIST_HEAD(&ei->i_prealloc_list);
 	spin_lock_init(&ei->i_prealloc_lock);
+	spin_lock_init(&ei->i_write_range_lock);
+	INIT_LIST_HEAD(&ei->i_write_ranges);
+	init_waitqueue_head(&ei->i_write_range_wait);
 	ext4_es_init_tree(&ei->i_es_tree);
 	rwlock_init(&ei->i_es_lock);
 	INIT_LIST_HEAD(&ei->i_es_list);
@@ -1298,6 +1302,7 @@ enum {
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
 	Opt_max_dir_size_kb, Opt_nojournal_checksum,
+	Opt_orphan_workers,
 };
 
 static const match_table_t tokens = {
@@ -1357,6 +1362,7 @@ static const match_table_t tokens = {
 	{Opt_i_version, "i_version"},
 	{Opt_dax, "dax"},
 	{Opt_stripe, "stripe=%u"},
+	{Opt_orphan_workers, "orphan_workers=%u"},
 	{Opt_delalloc, "delalloc"},
 	{Opt_lazytime, "lazytime"},
 	{Opt_nolazytime, "nolazytime"},
@@ -1545,6 +1551,7 @@ static const struct mount_opts {
 	{Opt_init_itable, 0, MOPT_GTE0},
 	{Opt_dax, EXT4_MOUNT_DAX, MOPT_SET},
 	{Opt_stripe, 0, MOPT_GTE0},
+	{Opt_orphan_workers, 0, MOPT_GTE0},
 	{Opt_resuid, 0, MOPT_GTE0},
 	{Opt_resgid, 0, MOPT_GTE0},
 	{Opt_journal_dev, 0, MOPT_NO_EXT2 | MOPT_GTE0},
@@ -1699,6 +1706,8 @@ static int handle_mount_opt(struct super_block *sb, char *opt, int token,
 		sbi->s_max_dir_size_kb = arg;
 	} else if (token == Opt_stripe) {
 		sbi->s_stripe = arg;
+	} else if (token == Opt_orphan_workers) {
+		sbi->s_orphan_workers = arg;
 	} else if (token == Opt_resuid) {
 		uid = make_kuid(current_user_ns(), arg);
 		if (!uid_valid(uid)) {
@@ -2006,6 +2015,10 @@ static int _ext4_show_options(struct seq_file *seq, struct super_block *sb,
 		SEQ_OPTS_PUTS("i_version");
 	if (nodefs || sbi->s_stripe)
 		SEQ_OPTS_PRINT("stripe=%lu", sbi->s_stripe);
+	if (nodefs || sbi->s_orphan_workers !=
+		      min_t(unsigned int, num_online_cpus(),
+			    EXT4_DEF_ORPHAN_WORKERS))
+		SEQ_OPTS_PRINT("orphan_workers=%u", sbi->s_orphan_workers);
 	if (EXT4_MOUNT_DATA_FLAGS & (sbi->s_mount_opt ^ def_mount_opt)) {
 		if (test_opt(sb, DATA_FLAGS) == EXT4_MOUNT_JOURNAL_DATA)
 			SEQ_OPTS_PUTS("data=journal");
@@ -2339,12 +2352,111 @@ static int ext4_check_descriptors(struct super_block *sb,
  * ext4_free_inode().  The only reason we would point at a wrong inode is if
  * e2fsck was run on this filesystem, and it must have already done the orphan
  * inode cleanup for us, so we can safely abort without any further action.
+ *
+ * Processing an orphan (truncating it or letting iput() reap it) is
+ * independent work per inode and usually I/O bound, so it is fanned out to
+ * workers, bounded by the orphan_workers= mount option.  Only the chain walk
+ * itself is serial; ext4_orphan_del() already serializes the on-disk chain
+ * updates under s_orphan_lock, so completion order does not matter as long
+ * as the in-memory s_orphan list mirrors the on-disk chain order.
  */
+struct ext4_orphan_ctx {
+	atomic_t outstanding;
+	atomic_t in_flight;
+	struct completion done;
+	atomic_t nr_orphans;
+	atomic_t nr_truncates;
+};
+
+struct ext4_orphan_work {
+	struct work_struct work;
+	struct inode *inode;
+	struct ext4_orphan_ctx *ctx;
+};
+
+static void ext4_process_orphan(struct inode *inode,
+				struct ext4_orphan_ctx *ctx)
+{
+	struct super_block *sb = inode->i_sb;
+	int ret;
+
+	if (inode->i_nlink) {
+		if (test_opt(sb, DEBUG))
+			ext4_msg(sb, KERN_DEBUG,
+				"%s: truncating inode %lu to %lld bytes",
+				__func__, inode->i_ino, inode->i_size);
+		jbd_debug(2, "truncating inode %lu to %lld bytes\n",
+			  inode->i_ino, inode->i_size);
+		inode_lock(inode);
+		truncate_inode_pages(inode->i_mapping, inode->i_size);
+		ret = ext4_truncate(inode);
+		if (ret)
+			ext4_std_error(inode->i_sb, ret);
+		inode_unlock(inode);
+		atomic_inc(&ctx->nr_truncates);
+	} else {
+		if (test_opt(sb, DEBUG))
+			ext4_msg(sb, KERN_DEBUG,
+				"%s: deleting unreferenced inode %lu",
+				__func__, inode->i_ino);
+		jbd_debug(2, "deleting unreferenced inode %lu\n",
+			  inode->i_ino);
+		atomic_inc(&ctx->nr_orphans);
+	}
+	iput(inode);  /* The delete magic happens here! */
+}
+
+static void ext4_orphan_workfn(struct work_struct *work)
+{
+	struct ext4_orphan_work *ow = container_of(work,
+					struct ext4_orphan_work, work);
+	struct ext4_orphan_ctx *ctx = ow->ctx;
+
+	ext4_process_orphan(ow->inode, ctx);
+	kfree(ow);
+	atomic_dec(&ctx->in_flight);
+	if (atomic_dec_and_test(&ctx->outstanding))
+		complete(&ctx->done);
+}
+
+/*
+ * Hand one orphan to a worker; once the bounded pool is busy, or if the
+ * work item cannot be allocated, process it right here instead.
+ */
+static void ext4_orphan_dispatch(struct ext4_orphan_ctx *ctx,
+				 struct inode *inode,
+				 unsigned int max_workers)
+{
+	struct ext4_orphan_work *ow;
+
+	if (max_workers < 2 ||
+	    atomic_read(&ctx->in_flight) >= max_workers)
+		goto sync;
+	ow = kmalloc(sizeof(*ow), GFP_NOFS);
+	if (!ow)
+		goto sync;
+	INIT_WORK(&ow->work, ext4_orphan_workfn);
+	ow->inode = inode;
+	ow->ctx = ctx;
+	atomic_inc(&ctx->in_flight);
+	atomic_inc(&ctx->outstanding);
+	queue_work(system_unbound_wq, &ow->work);
+	return;
+sync:
+	ext4_process_orphan(inode, ctx);
+}
+
 static void ext4_orphan_cleanup(struct super_block *sb,
 				struct ext4_super_block *es)
 {
 	unsigned int s_flags = sb->s_flags;
-	int ret, nr_orphans = 0, nr_truncates = 0;
+	struct ext4_orphan_ctx ctx = {
+		.outstanding = ATOMIC_INIT(1),	/* one for ourselves */
+		.done = COMPLETION_INITIALIZER_ONSTACK(ctx.done),
+	};
+	unsigned int max_workers = EXT4_SB(sb)->s_orphan_workers;
+	int nr_orphans, nr_truncates;
+	__u32 next_ino;
 #ifdef CONFIG_QUOTA
 	int i;
 #endif
@@ -2396,7 +2508,8 @@ static void ext4_orphan_cleanup(struct super_block *sb,
 	}
 #endif
 
-	while (es->s_last_orphan) {
+	next_ino = le32_to_cpu(es->s_last_orphan);
+	while (next_ino) {
 		struct inode *inode;
 
 		/*
@@ -2409,40 +2522,48 @@ static void ext4_orphan_cleanup(struct super_block *sb,
 			break;
 		}
 
-		inode = ext4_orphan_get(sb, le32_to_cpu(es->s_last_orphan));
+		inode = ext4_orphan_get(sb, next_ino);
 		if (IS_ERR(inode)) {
 			es->s_last_orphan = 0;
 			break;
 		}
 
-		list_add(&EXT4_I(inode)->i_orphan, &EXT4_SB(sb)->s_orphan);
-		dquot_initialize(inode);
-		if (inode->i_nlink) {
-			if (test_opt(sb, DEBUG))
-				ext4_msg(sb, KERN_DEBUG,
-					"%s: truncating inode %lu to %lld bytes",
-					__func__, inode->i_ino, inode->i_size);
-			jbd_debug(2, "truncating inode %lu to %lld bytes\n",
-				  inode->i_ino, inode->i_size);
-			inode_lock(inode);
-			truncate_inode_pages(inode->i_mapping, inode->i_size);
-			ret = ext4_truncate(inode);
-			if (ret)
-				ext4_std_error(inode->i_sb, ret);
-			inode_unlock(inode);
-			nr_truncates++;
-		} else {
-			if (test_opt(sb, DEBUG))
-				ext4_msg(sb, KERN_DEBUG,
-					"%s: deleting unreferenced inode %lu",
-					__func__, inode->i_ino);
-			jbd_debug(2, "deleting unreferenced inode %lu\n",
-				  inode->i_ino);
-			nr_orphans++;
+		/* a cycle in the chain would revisit an inode */
+		if (!list_empty(&EXT4_I(inode)->i_orphan)) {
+			ext4_msg(sb, KERN_ERR,
+				 "corrupted orphan chain at inode %lu",
+				 inode->i_ino);
+			es->s_last_orphan = 0;
+			iput(inode);
+			break;
 		}
-		iput(inode);  /* The delete magic happens here! */
+
+		/*
+		 * While an inode sits on the on-disk chain, i_dtime
+		 * carries the next inode number; grab it before the
+		 * inode is handed off for processing.  The in-memory
+		 * list must stay in chain order so that out-of-order
+		 * removal by the workers updates the right predecessor,
+		 * hence list_add_tail().
+		 */
+		next_ino = EXT4_I(inode)->i_dtime;
+		/*
+		 * Workers already dispatched may concurrently unlink
+		 * their inodes via ext4_orphan_del(), so unlike the old
+		 * serial cleanup the append must take s_orphan_lock.
+		 */
+		mutex_lock(&EXT4_SB(sb)->s_orphan_lock);
+		list_add_tail(&EXT4_I(inode)->i_orphan, &EXT4_SB(sb)->s_orphan);
+		mutex_unlock(&EXT4_SB(sb)->s_orphan_lock);
+		dquot_initialize(inode);
+		ext4_orphan_dispatch(&ctx, inode, max_workers);
 	}
 
+	if (!atomic_dec_and_test(&ctx.outstanding))
+		wait_for_completion(&ctx.done);
+	nr_orphans = atomic_read(&ctx.nr_orphans);
+	nr_truncates = atomic_read(&ctx.nr_truncates);
+
 #define PLURAL(x) (x), ((x) == 1) ? "" : "s"
 
 	if (nr_orphans)
@@ -3476,6 +3597,8 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	sbi->s_commit_interval = JBD2_DEFAULT_MAX_COMMIT_AGE * HZ;
 	sbi->s_min_batch_time = EXT4_DEF_MIN_BATCH_TIME;
 	sbi->s_max_batch_time = EXT4_DEF_MAX_BATCH_TIME;
+	sbi->s_orphan_workers = min_t(unsigned int, num_online_cpus(),
+				      EXT4_DEF_ORPHAN_WORKERS);
 
 	if ((def_mount_opts & EXT4_DEFM_NOBARRIER) == 0)
 		set_opt(sb, BARRIER);
@@ -4147,6 +4270,18 @@ no_journal:
 	if (!err)
 		err = percpu_counter_init(&sbi->s_dirtyclusters_counter, 0,
 					  GFP_KERNEL);
+	if (!err) {
+		sbi->s_ino_goal = alloc_percpu(struct ext4_ino_goal);
+		if (sbi->s_ino_goal) {
+			int cpu;
+
+			/* no valid continuation goal until the first create */
+			for_each_possible_cpu(cpu)
+				per_cpu_ptr(sbi->s_ino_goal, cpu)->group = ~0;
+		} else {
+			err = -ENOMEM;
+		}
+	}
 	if (!err)
 		err = percpu_init_rwsem(&sbi->s_journal_flag_rwsem);
 
@@ -4247,6 +4382,7 @@ failed_mount6:
 	percpu_counter_destroy(&sbi->s_freeinodes_counter);
 	percpu_counter_destroy(&sbi->s_dirs_counter);
 	percpu_counter_destroy(&sbi->s_dirtyclusters_counter);
+	free_percpu(sbi->s_ino_goal);
 failed_mount5:
 	ext4_ext_release(sb);
 	ext4_release_system_zone(sb);
@@ -191,7 +191,16 @@ static int expand_fdtable(struct files_struct *files, unsigned int nr)
 	}
 	cur_fdt = files_fdtable(files);
 	BUG_ON(nr < cur_fdt->max_fds);
+	/*
+	 * Copy without holding file_lock.  Every path that mutates the
+	 * table under the lock waits on resize_in_progress first (see
+	 * wait_for_resize()), and __fd_install() does the same, so the
+	 * old table cannot change under us and sibling threads spend
+	 * the copy sleeping instead of spinning on the lock.
+	 */
+	spin_unlock(&files->file_lock);
 	copy_fdtable(new_fdt, cur_fdt);
+	spin_lock(&files->file_lock);
 	rcu_assign_pointer(files->fdt, new_fdt);
 	if (cur_fdt != &files->fdtab)
 		call_rcu(&cur_fdt->rcu, free_fdtable_rcu);
@@ -200,6 +209,24 @@ static int expand_fdtable(struct files_struct *files, unsigned int nr)
 	return 1;
 }
 
+/*
+ * Expansion copies the old table without holding file_lock.  Anybody
+ * who wants to mutate the fdtable under the lock must first wait for a
+ * resize in progress to finish, or the copy would lose the update.
+ * Pure readers of the table need not bother: the expansion never
+ * modifies the old table and publishes the new one with rcu_assign.
+ */
+static void wait_for_resize(struct files_struct *files)
+	__releases(files->file_lock)
+	__acquires(files->file_lock)
+{
+	while (unlikely(files->resize_in_progress)) {
+		spin_unlock(&files->file_lock);
+		wait_event(files->resize_wait, !files->resize_in_progress);
+		spin_lock(&files->file_lock);
+	}
+}
+
 /*
  * Expand files.
  * This function will expand the file structures, if the requested size exceeds
@@ -216,6 +243,20 @@ static int expand_files(struct files_struct *files, unsigned int nr)
 	int expanded = 0;
 
 repeat:
+	/*
+	 * A resize in progress copies the old table without file_lock.
+	 * Wait before every return path, including the "nothing to do"
+	 * one: returning 0 while the copy runs would let the caller
+	 * mutate the old table and lose the update in the new one.
+	 */
+	if (unlikely(files->resize_in_progress)) {
+		spin_unlock(&files->file_lock);
+		expanded = 1;
+		wait_event(files->resize_wait, !files->resize_in_progress);
+		spin_lock(&files->file_lock);
+		goto repeat;
+	}
+
 	fdt = files_fdtable(files);
 
 	/* Do we need to expand? */
@@ -226,14 +267,6 @@ repeat:
 	if (nr >= sysctl_nr_open)
 		return -EMFILE;
 
-	if (unlikely(files->resize_in_progress)) {
-		spin_unlock(&files->file_lock);
-		expanded = 1;
-		wait_event(files->resize_wait, !files->resize_in_progress);
-		spin_lock(&files->file_lock);
-		goto repeat;
-	}
-
 	/* All good, so we try */
 	files->resize_in_progress = true;
 	expanded = expand_fdtable(files, nr);
@@ -502,6 +535,7 @@ int __alloc_fd(struct files_struct *files,
 	struct fdtable *fdt;
 
 	spin_lock(&files->file_lock);
+	wait_for_resize(files);
 repeat:
 	fdt = files_fdtable(files);
 	fd = start;
@@ -575,6 +609,7 @@ void put_unused_fd(unsigned int fd)
 {
 	struct files_struct *files = current->files;
 	spin_lock(&files->file_lock);
+	wait_for_resize(files);
 	__put_unused_fd(files, fd);
 	spin_unlock(&files->file_lock);
 }
@@ -638,6 +673,7 @@ int __close_fd(struct files_struct *files, unsigned fd)
 	struct fdtable *fdt;
 
 	spin_lock(&files->file_lock);
+	wait_for_resize(files);
 	fdt = files_fdtable(files);
 	if (fd >= fdt->max_fds)
 		goto out_unlock;
@@ -800,6 +836,7 @@ void set_close_on_exec(unsigned int fd, int flag)
 	struct files_struct *files = current->files;
 	struct fdtable *fdt;
 	spin_lock(&files->file_lock);
+	wait_for_resize(files);
 	fdt = files_fdtable(files);
 	if (flag)
 		__set_close_on_exec(fd, fdt);
@@ -841,6 +878,7 @@ __releases(&files->file_lock)
 	 * scope of POSIX or SUS, since neither considers shared descriptor
 	 * tables and this condition does not arise without those.
 	 */
+	wait_for_resize(files);
 	fdt = files_fdtable(files);
 	tofree = fdt->fd[fd];
 	if (!tofree && fd_is_open(fd, fdt))
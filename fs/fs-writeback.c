@@ -309,22 +309,32 @@ static struct bdi_writeback *inode_to_wb_and_lock_list(struct inode *inode)
 	return locked_inode_to_wb_and_lock_list(inode);
 }
 
+/*
+ * Switches are batched: a context collects up to WB_MAX_INODES_PER_ISW
+ * inodes headed for the same wb for a short while before committing, so
+ * that one RCU grace period and one work item are paid per batch instead
+ * of per inode.  A dirty flood moving many inodes to the same cgroup wb
+ * (e.g. after a container restart) otherwise queues an RCU callback and a
+ * work item for every single inode.
+ */
+#define WB_MAX_INODES_PER_ISW	16
+#define WB_ISW_BATCH_JIFFIES	(HZ / 100 + 1)
+
 struct inode_switch_wbs_context {
-	struct inode		*inode;
 	struct bdi_writeback	*new_wb;
 
 	struct rcu_head		rcu_head;
 	struct work_struct	work;
+
+	int			nr_inodes;
+	struct inode		*inodes[WB_MAX_INODES_PER_ISW];
 };
 
-static void inode_switch_wbs_work_fn(struct work_struct *work)
+static void inode_do_switch_wbs(struct inode *inode,
+				struct bdi_writeback *new_wb)
 {
-	struct inode_switch_wbs_context *isw =
-		container_of(work, struct inode_switch_wbs_context, work);
-	struct inode *inode = isw->inode;
 	struct address_space *mapping = inode->i_mapping;
 	struct bdi_writeback *old_wb = inode->i_wb;
-	struct bdi_writeback *new_wb = isw->new_wb;
 	struct radix_tree_iter iter;
 	bool switched = false;
 	void **slot;
@@ -425,9 +435,20 @@ skip_switch:
 		wb_wakeup(new_wb);
 		wb_put(old_wb);
 	}
-	wb_put(new_wb);
+}
+
+static void inode_switch_wbs_work_fn(struct work_struct *work)
+{
+	struct inode_switch_wbs_context *isw =
+		container_of(work, struct inode_switch_wbs_context, work);
+	int i;
+
+	for (i = 0; i < isw->nr_inodes; i++) {
+		inode_do_switch_wbs(isw->inodes[i], isw->new_wb);
+		iput(isw->inodes[i]);
+	}
 
-	iput(inode);
+	wb_put(isw->new_wb);
 	kfree(isw);
 
 	atomic_dec(&isw_nr_in_flight);
@@ -443,6 +464,41 @@ static void inode_switch_wbs_rcu_fn(struct rcu_head *rcu_head)
 	queue_work(isw_wq, &isw->work);
 }
 
+static struct inode_switch_wbs_context *isw_pending;
+static DEFINE_SPINLOCK(isw_pending_lock);
+
+/*
+ * In addition to synchronizing among switchers, I_WB_SWITCH tells the RCU
+ * protected stat update paths to grab the mapping's tree_lock so that stat
+ * transfer can synchronize against them.  The switch may only proceed once
+ * I_WB_SWITCH is guaranteed to be visible for every inode in the batch,
+ * which the grace period provides.
+ */
+static void isw_commit(struct inode_switch_wbs_context *isw)
+{
+	call_rcu(&isw->rcu_head, inode_switch_wbs_rcu_fn);
+}
+
+static void isw_flush_pending(void)
+{
+	struct inode_switch_wbs_context *isw;
+
+	spin_lock_bh(&isw_pending_lock);
+	isw = isw_pending;
+	isw_pending = NULL;
+	spin_unlock_bh(&isw_pending_lock);
+
+	if (isw)
+		isw_commit(isw);
+}
+
+static void isw_pending_timer_fn(unsigned long data)
+{
+	isw_flush_pending();
+}
+
+static DEFINE_TIMER(isw_pending_timer, isw_pending_timer_fn, 0, 0);
+
 /**
  * inode_switch_wbs - change the wb association of an inode
  * @inode: target inode
@@ -455,7 +511,7 @@ static void inode_switch_wbs(struct inode *inode, int new_wb_id)
 {
 	struct backing_dev_info *bdi = inode_to_bdi(inode);
 	struct cgroup_subsys_state *memcg_css;
-	struct inode_switch_wbs_context *isw;
+	struct inode_switch_wbs_context *isw, *old_isw = NULL;
 
 	/* noop if seems to be already in progress */
 	if (inode->i_state & I_WB_SWITCH)
@@ -486,17 +542,28 @@ static void inode_switch_wbs(struct inode *inode, int new_wb_id)
 	__iget(inode);
 	spin_unlock(&inode->i_lock);
 
-	isw->inode = inode;
+	/* join a pending batch headed for the same wb if there is one */
+	spin_lock_bh(&isw_pending_lock);
+	if (isw_pending && isw_pending->new_wb == isw->new_wb &&
+	    isw_pending->nr_inodes < WB_MAX_INODES_PER_ISW) {
+		isw_pending->inodes[isw_pending->nr_inodes++] = inode;
+		spin_unlock_bh(&isw_pending_lock);
+		wb_put(isw->new_wb);
+		kfree(isw);
+		return;
+	}
 
+	isw->inodes[0] = inode;
+	isw->nr_inodes = 1;
 	atomic_inc(&isw_nr_in_flight);
-
-	/*
-	 * In addition to synchronizing among switchers, I_WB_SWITCH tells
-	 * the RCU protected stat update paths to grab the mapping's
-	 * tree_lock so that stat transfer can synchronize against them.
-	 * Let's continue after I_WB_SWITCH is guaranteed to be visible.
-	 */
-	call_rcu(&isw->rcu_head, inode_switch_wbs_rcu_fn);
+	old_isw = isw_pending;
+	isw_pending = isw;
+	mod_timer(&isw_pending_timer, jiffies + WB_ISW_BATCH_JIFFIES);
+	spin_unlock_bh(&isw_pending_lock);
+
+	/* only one batch may be pending; send the previous one on its way */
+	if (old_isw)
+		isw_commit(old_isw);
 	return;
 
 out_free:
@@ -862,6 +929,7 @@ restart:
  */
 void cgroup_writeback_umount(void)
 {
+	isw_flush_pending();
 	if (atomic_read(&isw_nr_in_flight)) {
 		synchronize_rcu();
 		flush_workqueue(isw_wq);
@@ -1455,7 +1523,9 @@ static long writeback_chunk_size(struct bdi_writeback *wb,
 	if (work->sync_mode == WB_SYNC_ALL || work->tagged_writepages)
 		pages = LONG_MAX;
 	else {
-		pages = min(wb->avg_write_bandwidth / 2,
+		/* the bandwidth floor guarantees a useful chunk even for
+		 * a wb that has been starved of measured bandwidth */
+		pages = min(max(wb->avg_write_bandwidth, wb->bdi->min_bw) / 2,
 			    global_wb_domain.dirty_limit / DIRTY_SCOPE);
 		pages = min(pages, work->nr_pages);
 		pages = round_down(pages + MIN_WRITEBACK_PAGES,
@@ -23,6 +23,11 @@
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
 
+static bool __read_mostly fuse_mq;
+module_param_named(mq, fuse_mq, bool, 0644);
+MODULE_PARM_DESC(mq,
+		 "Give each cloned device instance its own input queue");
+
 static struct kmem_cache *fuse_req_cachep;
 
 static struct fuse_dev *fuse_get_dev(struct file *file)
@@ -301,13 +306,74 @@ static unsigned len_args(unsigned numargs, struct fuse_arg *args)
 
 static u64 fuse_get_unique(struct fuse_iqueue *fiq)
 {
-	return ++fiq->reqctr;
+	/* Stepping by FUSE_MAX_IQS keeps ids unique across queues */
+	fiq->reqctr += FUSE_MAX_IQS;
+	return fiq->reqctr;
+}
+
+/*
+ * Pick the input queue for a new request and lock it.
+ *
+ * When cloned devices with their own queues are present, requests are
+ * spread over the queues by submitting CPU.  A queue whose device has
+ * gone away is skipped in favour of the main queue.  The rcu read lock
+ * only protects the window between picking a queue and locking it: once
+ * the queue is locked and found connected it cannot be retired.
+ */
+static struct fuse_iqueue *fuse_iqueue_lock(struct fuse_conn *fc)
+__acquires(fiq->waitq.lock)
+{
+	struct fuse_iqueue *fiq;
+	unsigned num;
+
+	rcu_read_lock();
+	num = READ_ONCE(fc->num_iqs);
+	if (num > 1) {
+		/* Pairs with the barrier in fuse_dev_attach_iqueue() */
+		smp_rmb();
+		fiq = READ_ONCE(fc->iqs[raw_smp_processor_id() % num]);
+		spin_lock(&fiq->waitq.lock);
+		if (likely(fiq->connected)) {
+			rcu_read_unlock();
+			return fiq;
+		}
+		spin_unlock(&fiq->waitq.lock);
+	}
+	rcu_read_unlock();
+
+	fiq = &fc->iq;
+	spin_lock(&fiq->waitq.lock);
+	return fiq;
+}
+
+/*
+ * Lock the input queue a request is on.  Requests of a retired queue
+ * are moved to the main queue, so req->fiq must be re-checked under the
+ * queue lock.
+ */
+static struct fuse_iqueue *fuse_req_iqueue_lock(struct fuse_req *req)
+__acquires(fiq->waitq.lock)
+{
+	struct fuse_iqueue *fiq;
+
+	for (;;) {
+		rcu_read_lock();
+		fiq = READ_ONCE(req->fiq);
+		spin_lock(&fiq->waitq.lock);
+		if (likely(fiq == READ_ONCE(req->fiq))) {
+			rcu_read_unlock();
+			return fiq;
+		}
+		spin_unlock(&fiq->waitq.lock);
+		rcu_read_unlock();
+	}
 }
 
 static void queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
+	req->fiq = fiq;
 	list_add_tail(&req->list, &fiq->pending);
 	wake_up_locked(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
@@ -316,6 +382,7 @@ static void queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
+	/* Forgets always go via the main queue to preserve their order */
 	struct fuse_iqueue *fiq = &fc->iq;
 
 	forget->forget_one.nodeid = nodeid;
@@ -338,12 +405,12 @@ static void flush_bg_queue(struct fuse_conn *fc)
 	while (fc->active_background < fc->max_background &&
 	       !list_empty(&fc->bg_queue)) {
 		struct fuse_req *req;
-		struct fuse_iqueue *fiq = &fc->iq;
+		struct fuse_iqueue *fiq;
 
 		req = list_entry(fc->bg_queue.next, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
-		spin_lock(&fiq->waitq.lock);
+		fiq = fuse_iqueue_lock(fc);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request(fiq, req);
 		spin_unlock(&fiq->waitq.lock);
@@ -360,14 +427,15 @@ static void flush_bg_queue(struct fuse_conn *fc)
  */
 static void request_end(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
-
 	if (test_and_set_bit(FR_FINISHED, &req->flags))
 		return;
 
-	spin_lock(&fiq->waitq.lock);
-	list_del_init(&req->intr_entry);
-	spin_unlock(&fiq->waitq.lock);
+	if (req->fiq) {
+		struct fuse_iqueue *fiq = fuse_req_iqueue_lock(req);
+
+		list_del_init(&req->intr_entry);
+		spin_unlock(&fiq->waitq.lock);
+	}
 	WARN_ON(test_bit(FR_PENDING, &req->flags));
 	WARN_ON(test_bit(FR_SENT, &req->flags));
 	if (test_bit(FR_BACKGROUND, &req->flags)) {
@@ -396,9 +464,10 @@ static void request_end(struct fuse_conn *fc, struct fuse_req *req)
 	fuse_put_request(fc, req);
 }
 
-static void queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
+static void queue_interrupt(struct fuse_req *req)
 {
-	spin_lock(&fiq->waitq.lock);
+	struct fuse_iqueue *fiq = fuse_req_iqueue_lock(req);
+
 	if (test_bit(FR_FINISHED, &req->flags)) {
 		spin_unlock(&fiq->waitq.lock);
 		return;
@@ -413,7 +482,7 @@ static void queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -427,7 +496,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		/* matches barrier in fuse_dev_do_read() */
 		smp_mb__after_atomic();
 		if (test_bit(FR_SENT, &req->flags))
-			queue_interrupt(fiq, req);
+			queue_interrupt(req);
 	}
 
 	if (!test_bit(FR_FORCE, &req->flags)) {
@@ -437,7 +506,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->waitq.lock);
+		fiq = fuse_req_iqueue_lock(req);
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
@@ -458,10 +527,10 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 
 static void __fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_iqueue_lock(fc);
 	if (!fiq->connected) {
 		spin_unlock(&fiq->waitq.lock);
 		req->out.h.error = -ENOTCONN;
@@ -601,11 +670,11 @@ static int fuse_request_send_notify_reply(struct fuse_conn *fc,
 					  struct fuse_req *req, u64 unique)
 {
 	int err = -ENODEV;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	__clear_bit(FR_ISREPLY, &req->flags);
 	req->in.h.unique = unique;
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_iqueue_lock(fc);
 	if (fiq->connected) {
 		queue_request(fiq, req);
 		err = 0;
@@ -1216,7 +1285,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq = fud->fiq;
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_in *in;
@@ -1297,7 +1366,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	/* matches barrier in request_wait_answer() */
 	smp_mb__after_atomic();
 	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(fiq, req);
+		queue_interrupt(req);
 
 	return reqsize;
 
@@ -1864,7 +1933,7 @@ static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
 		if (oh.error == -ENOSYS)
 			fc->no_interrupt = 1;
 		else if (oh.error == -EAGAIN)
-			queue_interrupt(&fc->iq, req);
+			queue_interrupt(req);
 
 		fuse_copy_finish(cs);
 		return nbytes;
@@ -1966,6 +2035,7 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 			ibuf->ops = NULL;
 			pipe->curbuf = (pipe->curbuf + 1) & (pipe->buffers - 1);
 			pipe->nrbufs--;
+			pipe->nrpages -= pipe_buf_pages(obuf);
 		} else {
 			pipe_buf_get(pipe, ibuf);
 			*obuf = *ibuf;
@@ -2006,7 +2076,7 @@ static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 	if (!fud)
 		return POLLERR;
 
-	fiq = &fud->fc->iq;
+	fiq = fud->fiq;
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->waitq.lock);
@@ -2079,6 +2149,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		struct fuse_req *req, *next;
 		LIST_HEAD(to_end1);
 		LIST_HEAD(to_end2);
+		unsigned i;
 
 		fc->connected = 0;
 		fc->blocked = 0;
@@ -2107,13 +2178,23 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		spin_lock(&fiq->waitq.lock);
 		fiq->connected = 0;
 		list_splice_init(&fiq->pending, &to_end2);
-		list_for_each_entry(req, &to_end2, list)
-			clear_bit(FR_PENDING, &req->flags);
 		while (forget_pending(fiq))
 			kfree(dequeue_forget(fiq, 1, NULL));
 		wake_up_all_locked(&fiq->waitq);
 		spin_unlock(&fiq->waitq.lock);
 		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+		for (i = 1; i < fc->num_iqs; i++) {
+			struct fuse_iqueue *clone_fiq = fc->iqs[i];
+
+			spin_lock(&clone_fiq->waitq.lock);
+			clone_fiq->connected = 0;
+			list_splice_init(&clone_fiq->pending, &to_end2);
+			wake_up_all_locked(&clone_fiq->waitq);
+			spin_unlock(&clone_fiq->waitq.lock);
+			kill_fasync(&clone_fiq->fasync, SIGIO, POLL_IN);
+		}
+		list_for_each_entry(req, &to_end2, list)
+			clear_bit(FR_PENDING, &req->flags);
 		end_polls(fc);
 		wake_up_all(&fc->blocked_waitq);
 		spin_unlock(&fc->lock);
@@ -2131,6 +2212,72 @@ void fuse_abort_conn(struct fuse_conn *fc)
 }
 EXPORT_SYMBOL_GPL(fuse_abort_conn);
 
+/*
+ * Retire the private input queue of a multiqueue device.  New requests
+ * are no longer routed to it and the ones already queued are moved to
+ * the main queue, where the remaining devices will find them.
+ */
+static void fuse_dev_retire_iqueue(struct fuse_dev *fud)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_iqueue *fiq = fud->fiq;
+	struct fuse_iqueue *main_fiq = &fc->iq;
+	struct fuse_req *req;
+	LIST_HEAD(pending);
+	LIST_HEAD(interrupts);
+	unsigned i;
+
+	spin_lock(&fiq->waitq.lock);
+	fiq->connected = 0;
+	/*
+	 * Redirect req->fiq under the queue lock, so that waiters
+	 * re-checking it in fuse_req_iqueue_lock() move on to the main
+	 * queue before touching the request lists again.
+	 */
+	list_for_each_entry(req, &fiq->pending, list)
+		req->fiq = main_fiq;
+	list_for_each_entry(req, &fiq->interrupts, intr_entry)
+		req->fiq = main_fiq;
+	list_splice_init(&fiq->pending, &pending);
+	list_splice_init(&fiq->interrupts, &interrupts);
+	spin_unlock(&fiq->waitq.lock);
+
+	/* Unhook from the routing array */
+	spin_lock(&fc->lock);
+	for (i = 1; i < fc->num_iqs; i++) {
+		if (fc->iqs[i] == fiq) {
+			fc->iqs[i] = fc->iqs[fc->num_iqs - 1];
+			fc->num_iqs--;
+			break;
+		}
+	}
+	spin_unlock(&fc->lock);
+
+	spin_lock(&main_fiq->waitq.lock);
+	if (main_fiq->connected) {
+		list_splice_tail_init(&pending, &main_fiq->pending);
+		list_splice_tail_init(&interrupts, &main_fiq->interrupts);
+		wake_up_all_locked(&main_fiq->waitq);
+		spin_unlock(&main_fiq->waitq.lock);
+		kill_fasync(&main_fiq->fasync, SIGIO, POLL_IN);
+	} else {
+		/* Raced with fuse_abort_conn(), finish the requests here */
+		spin_unlock(&main_fiq->waitq.lock);
+		list_for_each_entry(req, &pending, list)
+			clear_bit(FR_PENDING, &req->flags);
+		while (!list_empty(&interrupts)) {
+			req = list_first_entry(&interrupts, struct fuse_req,
+					       intr_entry);
+			list_del_init(&req->intr_entry);
+		}
+		end_requests(fc, &pending);
+	}
+
+	fud->fiq = main_fiq;
+	/* Lockless routing may still hold a reference for a moment */
+	kfree_rcu(fiq, rcu);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2141,6 +2288,8 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		WARN_ON(!list_empty(&fpq->io));
 		end_requests(fc, &fpq->processing);
+		if (fud->fiq != &fc->iq)
+			fuse_dev_retire_iqueue(fud);
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2160,7 +2309,50 @@ static int fuse_dev_fasync(int fd, struct file *file, int on)
 		return -EPERM;
 
 	/* No locking - fasync_helper does its own locking */
-	return fasync_helper(fd, file, on, &fud->fc->iq.fasync);
+	return fasync_helper(fd, file, on, &fud->fiq->fasync);
+}
+
+/*
+ * Give a cloned device its own input queue, so that readers of
+ * different clones no longer contend on one queue lock.  Failure is not
+ * fatal: the device then reads from the main queue like any other
+ * clone.
+ */
+static void fuse_dev_attach_iqueue(struct fuse_conn *fc, struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq;
+	struct fuse_iqueue **iqs = NULL;
+
+	fiq = kmalloc(sizeof(*fiq), GFP_KERNEL);
+	if (!fiq)
+		return;
+
+	if (!fc->iqs)
+		iqs = kcalloc(FUSE_MAX_IQS, sizeof(*iqs), GFP_KERNEL);
+
+	spin_lock(&fc->lock);
+	if (!fc->iqs) {
+		if (!iqs)
+			goto out_free;
+		iqs[0] = &fc->iq;
+		fc->iqs = iqs;
+		fc->num_iqs = 1;
+		iqs = NULL;
+	}
+	if (fc->num_iqs >= FUSE_MAX_IQS || !fc->connected)
+		goto out_free;
+
+	fuse_iqueue_init(fiq, fc->num_iqs);
+	fc->iqs[fc->num_iqs] = fiq;
+	/* Make the queue visible only after it is fully initialized */
+	smp_wmb();
+	fc->num_iqs++;
+	fud->fiq = fiq;
+	fiq = NULL;
+out_free:
+	spin_unlock(&fc->lock);
+	kfree(iqs);
+	kfree(fiq);
 }
 
 static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
@@ -2174,6 +2366,9 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	if (!fud)
 		return -ENOMEM;
 
+	if (fuse_mq)
+		fuse_dev_attach_iqueue(fc, fud);
+
 	new->private_data = fud;
 	atomic_inc(&fc->dev_count);
 
@@ -305,6 +305,9 @@ struct fuse_req {
 	/** Entry on the interrupts list  */
 	struct list_head intr_entry;
 
+	/** Input queue the request was queued on */
+	struct fuse_iqueue *fiq;
+
 	/** refcount */
 	atomic_t count;
 
@@ -381,6 +384,9 @@ struct fuse_req {
 	struct file *stolen_file;
 };
 
+/** Maximum number of input queues per connection */
+#define FUSE_MAX_IQS 256
+
 struct fuse_iqueue {
 	/** Connection established */
 	unsigned connected;
@@ -406,6 +412,9 @@ struct fuse_iqueue {
 
 	/** O_ASYNC requests */
 	struct fasync_struct *fasync;
+
+	/** Delayed freeing of a retired queue */
+	struct rcu_head rcu;
 };
 
 struct fuse_pqueue {
@@ -429,6 +438,9 @@ struct fuse_dev {
 	/** Fuse connection for this device */
 	struct fuse_conn *fc;
 
+	/** Input queue this device reads from (&fc->iq by default) */
+	struct fuse_iqueue *fiq;
+
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
@@ -470,6 +482,16 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/**
+	 * Input queues of cloned multiqueue devices; iqs[0] is &iq.
+	 * Array and count are modified under ->lock, request routing
+	 * reads them locklessly.
+	 */
+	struct fuse_iqueue **iqs;
+
+	/** Number of entries in ->iqs (zero while no clone opted in) */
+	unsigned num_iqs;
+
 	/** The next unique kernel file handle */
 	u64 khctr;
 
@@ -874,6 +896,11 @@ struct fuse_conn *fuse_conn_get(struct fuse_conn *fc);
  */
 void fuse_conn_init(struct fuse_conn *fc);
 
+/**
+ * Initialize an input queue
+ */
+void fuse_iqueue_init(struct fuse_iqueue *fiq, unsigned qid);
+
 /**
  * Release reference to fuse_conn
  */
@@ -584,13 +584,20 @@ static int fuse_show_options(struct seq_file *m, struct dentry *root)
 	return 0;
 }
 
-static void fuse_iqueue_init(struct fuse_iqueue *fiq)
+void fuse_iqueue_init(struct fuse_iqueue *fiq, unsigned qid)
 {
 	memset(fiq, 0, sizeof(struct fuse_iqueue));
 	init_waitqueue_head(&fiq->waitq);
 	INIT_LIST_HEAD(&fiq->pending);
 	INIT_LIST_HEAD(&fiq->interrupts);
 	fiq->forget_list_tail = &fiq->forget_list_head;
+	/*
+	 * Each queue hands out request ids from its own counter.  The
+	 * counters are offset by the queue id and advance in steps of
+	 * FUSE_MAX_IQS, so ids stay unique across the queues of a
+	 * connection.
+	 */
+	fiq->reqctr = qid;
 	fiq->connected = 1;
 }
 
@@ -612,7 +619,7 @@ void fuse_conn_init(struct fuse_conn *fc)
 	atomic_set(&fc->dev_count, 1);
 	init_waitqueue_head(&fc->blocked_waitq);
 	init_waitqueue_head(&fc->reserved_req_waitq);
-	fuse_iqueue_init(&fc->iq);
+	fuse_iqueue_init(&fc->iq, 0);
 	INIT_LIST_HEAD(&fc->bg_queue);
 	INIT_LIST_HEAD(&fc->entry);
 	INIT_LIST_HEAD(&fc->devices);
@@ -632,8 +639,14 @@ EXPORT_SYMBOL_GPL(fuse_conn_init);
 void fuse_conn_put(struct fuse_conn *fc)
 {
 	if (atomic_dec_and_test(&fc->count)) {
+		unsigned i;
+
 		if (fc->destroy_req)
 			fuse_request_free(fc->destroy_req);
+		/* Queues of devices closed before the connection died */
+		for (i = 1; i < fc->num_iqs; i++)
+			kfree(fc->iqs[i]);
+		kfree(fc->iqs);
 		fc->release(fc);
 	}
 }
@@ -1022,6 +1035,7 @@ struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc)
 	fud = kzalloc(sizeof(struct fuse_dev), GFP_KERNEL);
 	if (fud) {
 		fud->fc = fuse_conn_get(fc);
+		fud->fiq = &fc->iq;
 		fuse_pqueue_init(&fud->pq);
 
 		spin_lock(&fc->lock);
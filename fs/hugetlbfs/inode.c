@@ -36,6 +36,7 @@
 #include <linux/magic.h>
 #include <linux/migrate.h>
 #include <linux/uio.h>
+#include <linux/workqueue.h>
 
 #include <linux/uaccess.h>
 
@@ -542,8 +543,15 @@ static long hugetlbfs_punch_hole(struct inode *inode, loff_t offset, loff_t len)
 	return 0;
 }
 
-static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
-				loff_t len)
+/*
+ * Allocate and add to the page cache the pages backing [start, end) of
+ * the file.  Called with the inode lock held by hugetlbfs_fallocate(),
+ * either directly or from a preallocation worker.  @stop is NULL when
+ * running in the caller's context (where we honor signals), and points
+ * to a shared abort flag when several workers split the range.
+ */
+static int hugetlbfs_prealloc_range(struct file *file, pgoff_t start,
+				    pgoff_t end, atomic_t *stop)
 {
 	struct inode *inode = file_inode(file);
 	struct address_space *mapping = inode->i_mapping;
@@ -551,32 +559,10 @@ static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 	struct vm_area_struct pseudo_vma;
 	struct mm_struct *mm = current->mm;
 	loff_t hpage_size = huge_page_size(h);
-	unsigned long hpage_shift = huge_page_shift(h);
-	pgoff_t start, index, end;
-	int error;
+	pgoff_t index;
+	int error = 0;
 	u32 hash;
 
-	if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE))
-		return -EOPNOTSUPP;
-
-	if (mode & FALLOC_FL_PUNCH_HOLE)
-		return hugetlbfs_punch_hole(inode, offset, len);
-
-	/*
-	 * Default preallocate case.
-	 * For this range, start is rounded down and end is rounded up
-	 * as well as being converted to page offsets.
-	 */
-	start = offset >> hpage_shift;
-	end = (offset + len + hpage_size - 1) >> hpage_shift;
-
-	inode_lock(inode);
-
-	/* We need to check rlimit even when FALLOC_FL_KEEP_SIZE */
-	error = inode_newsize_ok(inode, offset + len);
-	if (error)
-		goto out;
-
 	/*
 	 * Initialize a pseudo vma as this is required by the huge page
 	 * allocation routines.  If NUMA is configured, use page index
@@ -597,11 +583,16 @@ static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 
 		cond_resched();
 
-		/*
-		 * fallocate(2) manpage permits EINTR; we may have been
-		 * interrupted because we are using up too much memory.
-		 */
-		if (signal_pending(current)) {
+		if (stop) {
+			/* another worker hit an error, no point going on */
+			if (atomic_read(stop))
+				break;
+		} else if (signal_pending(current)) {
+			/*
+			 * fallocate(2) manpage permits EINTR; we may have
+			 * been interrupted because we are using up too much
+			 * memory.
+			 */
 			error = -EINTR;
 			break;
 		}
@@ -632,7 +623,7 @@ static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 		if (IS_ERR(page)) {
 			mutex_unlock(&hugetlb_fault_mutex_table[hash]);
 			error = PTR_ERR(page);
-			goto out;
+			break;
 		}
 		clear_huge_page(page, addr, pages_per_huge_page(h));
 		__SetPageUptodate(page);
@@ -640,7 +631,7 @@ static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 		if (unlikely(error)) {
 			put_page(page);
 			mutex_unlock(&hugetlb_fault_mutex_table[hash]);
-			goto out;
+			break;
 		}
 
 		mutex_unlock(&hugetlb_fault_mutex_table[hash]);
@@ -653,9 +644,126 @@ static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 		unlock_page(page);
 	}
 
-	if (!(mode & FALLOC_FL_KEEP_SIZE) && offset + len > inode->i_size)
-		i_size_write(inode, offset + len);
-	inode->i_ctime = current_time(inode);
+	return error;
+}
+
+/*
+ * Cap on preallocation workers; clearing huge pages saturates memory
+ * bandwidth long before we run out of cpus.
+ */
+#define HUGETLBFS_FALLOC_MAX_WORKERS	16
+
+struct hugetlbfs_falloc_work {
+	struct work_struct work;
+	struct file *file;
+	pgoff_t start;
+	pgoff_t end;
+	atomic_t *stop;
+	int error;
+};
+
+static void hugetlbfs_falloc_workfn(struct work_struct *work)
+{
+	struct hugetlbfs_falloc_work *fw =
+		container_of(work, struct hugetlbfs_falloc_work, work);
+
+	fw->error = hugetlbfs_prealloc_range(fw->file, fw->start, fw->end,
+					     fw->stop);
+	if (fw->error)
+		atomic_set(fw->stop, 1);
+}
+
+/*
+ * Split the preallocation across workers on the unbound workqueue.  The
+ * NUMA policy of each page is derived from its index alone, so chunking
+ * the range does not change where pages are allocated.  Returns the
+ * first error encountered, zero on success.
+ */
+static int hugetlbfs_prealloc_parallel(struct file *file, pgoff_t start,
+				       pgoff_t end, int nr_workers)
+{
+	struct hugetlbfs_falloc_work *works;
+	atomic_t stop = ATOMIC_INIT(0);
+	pgoff_t chunk = DIV_ROUND_UP(end - start, nr_workers);
+	int i, nr = 0, error = 0;
+
+	works = kmalloc_array(nr_workers, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return hugetlbfs_prealloc_range(file, start, end, NULL);
+
+	for (i = 0; i < nr_workers && start + i * chunk < end; i++) {
+		struct hugetlbfs_falloc_work *fw = &works[i];
+
+		fw->file = file;
+		fw->start = start + i * chunk;
+		fw->end = min(fw->start + chunk, end);
+		fw->stop = &stop;
+		fw->error = 0;
+		INIT_WORK(&fw->work, hugetlbfs_falloc_workfn);
+		queue_work(system_unbound_wq, &fw->work);
+		nr++;
+	}
+
+	for (i = 0; i < nr; i++) {
+		flush_work(&works[i].work);
+		if (works[i].error && !error)
+			error = works[i].error;
+	}
+
+	kfree(works);
+	return error;
+}
+
+static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
+				loff_t len)
+{
+	struct inode *inode = file_inode(file);
+	struct hstate *h = hstate_inode(inode);
+	loff_t hpage_size = huge_page_size(h);
+	unsigned long hpage_shift = huge_page_shift(h);
+	pgoff_t start, end;
+	int nr_workers;
+	int error;
+
+	if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE))
+		return -EOPNOTSUPP;
+
+	if (mode & FALLOC_FL_PUNCH_HOLE)
+		return hugetlbfs_punch_hole(inode, offset, len);
+
+	/*
+	 * Default preallocate case.
+	 * For this range, start is rounded down and end is rounded up
+	 * as well as being converted to page offsets.
+	 */
+	start = offset >> hpage_shift;
+	end = (offset + len + hpage_size - 1) >> hpage_shift;
+
+	inode_lock(inode);
+
+	/* We need to check rlimit even when FALLOC_FL_KEEP_SIZE */
+	error = inode_newsize_ok(inode, offset + len);
+	if (error)
+		goto out;
+
+	nr_workers = min3((pgoff_t)num_online_cpus(), end - start,
+			  (pgoff_t)HUGETLBFS_FALLOC_MAX_WORKERS);
+	if (nr_workers > 1)
+		error = hugetlbfs_prealloc_parallel(file, start, end,
+						    nr_workers);
+	else
+		error = hugetlbfs_prealloc_range(file, start, end, NULL);
+
+	/*
+	 * An interrupted preallocation still extends the file over
+	 * whatever was populated before the signal arrived.
+	 */
+	if (!error || error == -EINTR) {
+		if (!(mode & FALLOC_FL_KEEP_SIZE) &&
+		    offset + len > inode->i_size)
+			i_size_write(inode, offset + len);
+		inode->i_ctime = current_time(inode);
+	}
 out:
 	inode_unlock(inode);
 	return error;
@@ -18,6 +18,8 @@
 #include <linux/buffer_head.h> /* for inode_has_buffers */
 #include <linux/ratelimit.h>
 #include <linux/list_lru.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
 #include <trace/events/writeback.h>
 #include "internal.h"
 
@@ -590,6 +592,60 @@ static void dispose_list(struct list_head *head)
 	}
 }
 
+/* How many collected inodes one async disposal work item handles */
+#define EVICT_DISPOSE_BATCH	1024
+
+struct evict_ctx {
+	atomic_t outstanding;
+	struct completion done;
+};
+
+struct evict_work {
+	struct work_struct work;
+	struct list_head list;
+	struct evict_ctx *ctx;
+};
+
+static void evict_workfn(struct work_struct *work)
+{
+	struct evict_work *ew = container_of(work, struct evict_work, work);
+	struct evict_ctx *ctx = ew->ctx;
+
+	dispose_list(&ew->list);
+	kfree(ew);
+	if (atomic_dec_and_test(&ctx->outstanding))
+		complete(&ctx->done);
+}
+
+/*
+ * Hand a batch of collected inodes to the unbound workqueue pool, so
+ * that eviction of a large superblock scales with CPUs. Falls back to
+ * disposing synchronously when the batch can't be queued or when
+ * enough work is already in flight.
+ */
+static void evict_dispose_async(struct evict_ctx *ctx,
+				struct list_head *dispose)
+{
+	struct evict_work *ew;
+
+	if (atomic_read(&ctx->outstanding) > 2 * num_online_cpus())
+		goto sync;
+
+	ew = kmalloc(sizeof(*ew), GFP_KERNEL | __GFP_NOWARN);
+	if (!ew)
+		goto sync;
+
+	INIT_WORK(&ew->work, evict_workfn);
+	list_replace_init(dispose, &ew->list);
+	ew->ctx = ctx;
+	atomic_inc(&ctx->outstanding);
+	queue_work(system_unbound_wq, &ew->work);
+	return;
+
+sync:
+	dispose_list(dispose);
+}
+
 /**
  * evict_inodes	- evict all evictable inodes for a superblock
  * @sb:		superblock to operate on
@@ -603,6 +659,11 @@ void evict_inodes(struct super_block *sb)
 {
 	struct inode *inode, *next;
 	LIST_HEAD(dispose);
+	struct evict_ctx ctx = {
+		.outstanding = ATOMIC_INIT(1),
+		.done = COMPLETION_INITIALIZER_ONSTACK(ctx.done),
+	};
+	long nr = 0;
 
 again:
 	spin_lock(&sb->s_inode_list_lock);
@@ -620,22 +681,27 @@ again:
 		inode_lru_list_del(inode);
 		spin_unlock(&inode->i_lock);
 		list_add(&inode->i_lru, &dispose);
+		nr++;
 
 		/*
 		 * We can have a ton of inodes to evict at unmount time given
-		 * enough memory, check to see if we need to go to sleep for a
-		 * bit so we don't livelock.
+		 * enough memory. Ship full batches off to the workqueue so
+		 * disposal runs on several CPUs, and check whether we need
+		 * to go to sleep for a bit so we don't livelock.
 		 */
-		if (need_resched()) {
+		if (nr >= EVICT_DISPOSE_BATCH || need_resched()) {
 			spin_unlock(&sb->s_inode_list_lock);
 			cond_resched();
-			dispose_list(&dispose);
+			evict_dispose_async(&ctx, &dispose);
+			nr = 0;
 			goto again;
 		}
 	}
 	spin_unlock(&sb->s_inode_list_lock);
 
 	dispose_list(&dispose);
+	if (!atomic_dec_and_test(&ctx.outstanding))
+		wait_for_completion(&ctx.done);
 }
 
 /**
@@ -52,6 +52,9 @@ extern void __init chrdev_init(void);
 /*
  * namei.c
  */
+extern void __init dirent_locks_init(void);
+extern void prefix_cache_invalidate(struct dentry *);
+extern void prefix_cache_evict_sb(struct super_block *);
 extern int user_path_mountpoint_at(int, const char __user *, unsigned int, struct path *);
 extern int vfs_path_lookup(struct dentry *, struct vfsmount *,
 			   const char *, unsigned int, struct path *);
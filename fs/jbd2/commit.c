@@ -515,6 +515,28 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	atomic_sub(atomic_read(&journal->j_reserved_credits),
 		   &commit_transaction->t_outstanding_credits);
 
+	/*
+	 * Reclaim unused credits from the per-CPU caches.  New handles
+	 * can no longer consume them (the transaction is locked and we
+	 * hold j_state_lock for writing), so anything left over just
+	 * inflates the credit count of this transaction.
+	 */
+	if (journal->j_credit_cache) {
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			struct jbd2_credit_cache *cc =
+				per_cpu_ptr(journal->j_credit_cache, cpu);
+
+			if (cc->tid == commit_transaction->t_tid &&
+			    cc->credits) {
+				atomic_sub(cc->credits,
+					&commit_transaction->t_outstanding_credits);
+				cc->credits = 0;
+			}
+		}
+	}
+
 	trace_jbd2_commit_flushing(journal, commit_transaction);
 	stats.run.rs_flushing = jiffies;
 	stats.run.rs_locked = jbd2_time_diff(stats.run.rs_locked,
@@ -890,6 +912,20 @@ start_journal_io:
 	if (update_tail)
 		jbd2_update_log_tail(journal, first_tid, first_block);
 
+	/*
+	 * The commit block is on stable storage, so fsync-style waiters
+	 * sleeping in jbd2_log_wait_durable() can be released now instead
+	 * of paying for the forget list and checkpoint bookkeeping below,
+	 * which can run long for a large transaction.  j_commit_sequence
+	 * is only updated once that work is done, so jbd2-internal
+	 * callers which rely on the transaction being fully retired keep
+	 * their current semantics.
+	 */
+	write_lock(&journal->j_state_lock);
+	journal->j_durable_sequence = commit_transaction->t_tid;
+	write_unlock(&journal->j_state_lock);
+	wake_up(&journal->j_wait_done_commit);
+
 	/* End of a transaction!  Finally, we can do checkpoint
            processing: any buffers committed as a result of this
            transaction can be removed from any checkpoint list it was on
@@ -1085,6 +1121,7 @@ restart_loop:
 	commit_transaction->t_state = T_COMMIT_CALLBACK;
 	J_ASSERT(commit_transaction == journal->j_committing_transaction);
 	journal->j_commit_sequence = commit_transaction->t_tid;
+	journal->j_durable_sequence = commit_transaction->t_tid;
 	journal->j_committing_transaction = NULL;
 	commit_time = ktime_to_ns(ktime_sub(ktime_get(), start_time));
 
@@ -86,6 +86,7 @@ EXPORT_SYMBOL(jbd2_journal_errno);
 EXPORT_SYMBOL(jbd2_journal_ack_err);
 EXPORT_SYMBOL(jbd2_journal_clear_err);
 EXPORT_SYMBOL(jbd2_log_wait_commit);
+EXPORT_SYMBOL(jbd2_log_wait_durable);
 EXPORT_SYMBOL(jbd2_log_start_commit);
 EXPORT_SYMBOL(jbd2_journal_start_commit);
 EXPORT_SYMBOL(jbd2_journal_force_commit_nested);
@@ -716,6 +717,43 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	return err;
 }
 
+/*
+ * Wait until the commit block of a specified transaction is on stable
+ * storage.  Unlike jbd2_log_wait_commit() this does not wait for the
+ * commit code to finish retiring the transaction, so it can return
+ * noticeably earlier for large transactions.  Sufficient for callers
+ * which only need durability, such as fsync.
+ * The caller may not hold the journal lock.
+ */
+int jbd2_log_wait_durable(journal_t *journal, tid_t tid)
+{
+	int err = 0;
+
+	jbd2_might_wait_for_commit(journal);
+	read_lock(&journal->j_state_lock);
+#ifdef CONFIG_JBD2_DEBUG
+	if (!tid_geq(journal->j_commit_request, tid)) {
+		printk(KERN_ERR
+		       "%s: error: j_commit_request=%d, tid=%d\n",
+		       __func__, journal->j_commit_request, tid);
+	}
+#endif
+	while (tid_gt(tid, journal->j_durable_sequence)) {
+		jbd_debug(1, "JBD2: want %d, j_durable_sequence=%d\n",
+				  tid, journal->j_durable_sequence);
+		read_unlock(&journal->j_state_lock);
+		wake_up(&journal->j_wait_commit);
+		wait_event(journal->j_wait_done_commit,
+				!tid_gt(tid, journal->j_durable_sequence));
+		read_lock(&journal->j_state_lock);
+	}
+	read_unlock(&journal->j_state_lock);
+
+	if (unlikely(is_journal_aborted(journal)))
+		err = -EIO;
+	return err;
+}
+
 /*
  * When this function returns the transaction corresponding to tid
  * will be completed.  If the transaction has currently running, start
@@ -743,7 +781,7 @@ int jbd2_complete_transaction(journal_t *journal, tid_t tid)
 	if (!need_to_wait)
 		return 0;
 wait_commit:
-	return jbd2_log_wait_commit(journal, tid);
+	return jbd2_log_wait_durable(journal, tid);
 }
 EXPORT_SYMBOL(jbd2_complete_transaction);
 
@@ -1146,6 +1184,10 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	if (!journal->j_wbuf)
 		goto err_cleanup;
 
+	journal->j_credit_cache = alloc_percpu(struct jbd2_credit_cache);
+	if (!journal->j_credit_cache)
+		goto err_cleanup;
+
 	bh = getblk_unmovable(journal->j_dev, start, journal->j_blocksize);
 	if (!bh) {
 		pr_err("%s: Cannot get buffer for journal superblock\n",
@@ -1158,6 +1200,7 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	return journal;
 
 err_cleanup:
+	free_percpu(journal->j_credit_cache);
 	kfree(journal->j_wbuf);
 	jbd2_journal_destroy_revoke(journal);
 	kfree(journal);
@@ -1286,10 +1329,23 @@ static int journal_reset(journal_t *journal)
 
 	journal->j_tail_sequence = journal->j_transaction_sequence;
 	journal->j_commit_sequence = journal->j_transaction_sequence - 1;
+	journal->j_durable_sequence = journal->j_commit_sequence;
 	journal->j_commit_request = journal->j_commit_sequence;
 
 	journal->j_max_transaction_buffers = journal->j_maxlen / 4;
 
+	/*
+	 * Size the per-CPU credit caches so that, all CPUs together,
+	 * they can strand at most 1/8th of a transaction's credits.
+	 * If that leaves too little per CPU to be worth batching,
+	 * disable the caches entirely.
+	 */
+	journal->j_credit_batch = min_t(int, JBD2_CREDIT_CACHE_BATCH,
+			journal->j_max_transaction_buffers /
+			(8 * (int)num_possible_cpus()));
+	if (journal->j_credit_batch < 16)
+		journal->j_credit_batch = 0;
+
 	/*
 	 * As a special case, if the on-disk copy is already marked as needing
 	 * no recovery (s_start == 0), then we can safely defer the superblock
@@ -1735,6 +1791,7 @@ int jbd2_journal_destroy(journal_t *journal)
 		jbd2_journal_destroy_revoke(journal);
 	if (journal->j_chksum_driver)
 		crypto_free_shash(journal->j_chksum_driver);
+	free_percpu(journal->j_credit_cache);
 	kfree(journal->j_wbuf);
 	kfree(journal);
 
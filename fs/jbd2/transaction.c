@@ -180,8 +180,10 @@ static int add_transaction_credits(journal_t *journal, int blocks,
 				   int rsv_blocks)
 {
 	transaction_t *t = journal->j_running_transaction;
+	struct jbd2_credit_cache *cc = NULL;
 	int needed;
 	int total = blocks + rsv_blocks;
+	int batch = 0;
 
 	/*
 	 * If the current transaction is locked down for commit, wait
@@ -192,12 +194,38 @@ static int add_transaction_credits(journal_t *journal, int blocks,
 		return 1;
 	}
 
+	/*
+	 * Small handles without a reservation are served from this
+	 * CPU's credit cache when possible, keeping them off the shared
+	 * atomics below.  The cached credits are already accounted in
+	 * t_outstanding_credits and were log-space checked when the
+	 * cache was refilled.  j_state_lock is held for reading, so
+	 * preemption is off and the transaction cannot be locked under
+	 * us; the commit code reclaims leftovers under the write side
+	 * before it retires the running transaction.
+	 */
+	if (!rsv_blocks && journal->j_credit_batch) {
+		cc = this_cpu_ptr(journal->j_credit_cache);
+		if (cc->tid == t->t_tid && cc->credits >= total) {
+			cc->credits -= total;
+			return 0;
+		}
+		if (total <= journal->j_credit_batch)
+			batch = journal->j_credit_batch;
+	}
+
 	/*
 	 * If there is not enough space left in the log to write all
 	 * potential buffers requested by this operation, we need to
 	 * stall pending a log checkpoint to free some more log space.
 	 */
-	needed = atomic_add_return(total, &t->t_outstanding_credits);
+	needed = atomic_add_return(total + batch, &t->t_outstanding_credits);
+	if (batch && needed > journal->j_max_transaction_buffers) {
+		/* Retry without the batch before forcing a commit. */
+		atomic_sub(batch, &t->t_outstanding_credits);
+		needed -= batch;
+		batch = 0;
+	}
 	if (needed > journal->j_max_transaction_buffers) {
 		/*
 		 * If the current transaction is already too large,
@@ -236,7 +264,7 @@ static int add_transaction_credits(journal_t *journal, int blocks,
 	 * in the new transaction.
 	 */
 	if (jbd2_log_space_left(journal) < jbd2_space_needed(journal)) {
-		atomic_sub(total, &t->t_outstanding_credits);
+		atomic_sub(total + batch, &t->t_outstanding_credits);
 		read_unlock(&journal->j_state_lock);
 		jbd2_might_wait_for_commit(journal);
 		write_lock(&journal->j_state_lock);
@@ -246,6 +274,23 @@ static int add_transaction_credits(journal_t *journal, int blocks,
 		return 1;
 	}
 
+	if (batch) {
+		/*
+		 * Stash the extra credits for later handles on this
+		 * CPU.  Credits left over from a match that was too
+		 * small are still accounted in this transaction, so
+		 * accumulate them; a stale cache for an earlier
+		 * transaction was already drained when that one was
+		 * locked for commit and can simply be replaced.
+		 */
+		if (cc->tid == t->t_tid) {
+			cc->credits += batch;
+		} else {
+			cc->tid = t->t_tid;
+			cc->credits = batch;
+		}
+	}
+
 	/* No reservation? We are done... */
 	if (!rsv_blocks)
 		return 0;
@@ -36,6 +36,7 @@
 #include <linux/posix_acl.h>
 #include <linux/hash.h>
 #include <linux/bitops.h>
+#include <linux/llist.h>
 #include <linux/init_task.h>
 #include <linux/uaccess.h>
 
@@ -1512,19 +1513,99 @@ static struct dentry *lookup_real(struct inode *dir, struct dentry *dentry,
 	return dentry;
 }
 
+/*
+ * Parallel directory operations.
+ *
+ * On filesystems that advertise SB_I_PARALLEL_DIROPS, creation and removal
+ * of names in a directory only take ->i_rwsem shared and serialize against
+ * each other on a mutex hashed from the directory and the name, so that
+ * operations on distinct names proceed in parallel.  Whole-directory
+ * operations (rename, rmdir of the directory, anything still taking the
+ * lock exclusive) are unchanged and exclude every per-name holder via the
+ * rwsem.  A filesystem must only set the flag once its directory
+ * modifications are safe under a shared ->i_rwsem.
+ */
+#define DIRENT_LOCK_BITS	10
+#define DIRENT_LOCK_SIZE	(1 << DIRENT_LOCK_BITS)
+
+static struct mutex dirent_locks[DIRENT_LOCK_SIZE];
+
+void __init dirent_locks_init(void)
+{
+	int i;
+
+	for (i = 0; i < DIRENT_LOCK_SIZE; i++)
+		mutex_init(&dirent_locks[i]);
+}
+
+static bool dir_ops_parallel(struct inode *dir)
+{
+	return dir->i_sb->s_iflags & SB_I_PARALLEL_DIROPS;
+}
+
+static struct mutex *dirent_lock_hash(struct inode *dir, unsigned int hash)
+{
+	return &dirent_locks[hash_long((unsigned long)dir ^ hash,
+				       DIRENT_LOCK_BITS)];
+}
+
+static void inode_lock_dirent(struct inode *dir, const struct qstr *name)
+{
+	if (!dir_ops_parallel(dir)) {
+		inode_lock_nested(dir, I_MUTEX_PARENT);
+		return;
+	}
+	inode_lock_shared_nested(dir, I_MUTEX_PARENT);
+	mutex_lock(dirent_lock_hash(dir, name->hash));
+}
+
+static void inode_unlock_dirent(struct inode *dir, const struct qstr *name)
+{
+	if (!dir_ops_parallel(dir)) {
+		inode_unlock(dir);
+		return;
+	}
+	mutex_unlock(dirent_lock_hash(dir, name->hash));
+	inode_unlock_shared(dir);
+}
+
 static struct dentry *__lookup_hash(const struct qstr *name,
 		struct dentry *base, unsigned int flags)
 {
 	struct dentry *dentry = lookup_dcache(name, base, flags);
+	struct inode *dir = base->d_inode;
 
 	if (dentry)
 		return dentry;
 
+	/*
+	 * With only a shared hold on ->i_rwsem a plain d_alloc() could race
+	 * with lookup_slow() of the same name; go through the in-lookup
+	 * hash like it does.
+	 */
+	if (dir_ops_parallel(dir)) {
+		struct dentry *old;
+		DECLARE_WAIT_QUEUE_HEAD_ONSTACK(wq);
+
+		if (unlikely(IS_DEADDIR(dir)))
+			return ERR_PTR(-ENOENT);
+		dentry = d_alloc_parallel(base, name, &wq);
+		if (IS_ERR(dentry) || !d_in_lookup(dentry))
+			return dentry;
+		old = dir->i_op->lookup(dir, dentry, flags);
+		d_lookup_done(dentry);
+		if (unlikely(old)) {
+			dput(dentry);
+			dentry = old;
+		}
+		return dentry;
+	}
+
 	dentry = d_alloc(base, name);
 	if (unlikely(!dentry))
 		return ERR_PTR(-ENOMEM);
 
-	return lookup_real(base->d_inode, dentry, flags);
+	return lookup_real(dir, dentry, flags);
 }
 
 static int lookup_fast(struct nameidata *nd,
@@ -2021,6 +2102,364 @@ static inline u64 hash_name(const void *salt, const char *name)
 
 #endif
 
+/*
+ * Prefix cache: remembers runs of ordinary path components and the dentry
+ * they lead to, so that repeated rcu-walks down hot directory chains (think
+ * container roots twelve components deep) resolve a whole run with one hash
+ * probe instead of a dependent __d_lookup_rcu() per component.
+ *
+ * An entry records the dentry the run starts at, the raw bytes of the run,
+ * a hash over them, and the chain of dentries the run traversed together
+ * with their d_seq values at the time the run was walked.  A hit replays
+ * the chain: every link must still have the remembered d_seq and parent,
+ * which rename, unlink and d_drop() all invalidate by bumping d_seq, and
+ * every directory is still subjected to the MAY_EXEC check the normal walk
+ * would have done.  Anything unusual - dots, symlinks, mountpoints,
+ * ->d_revalidate, ->d_hash - ends a run, so those paths always take the
+ * component-at-a-time walk.
+ *
+ * Entries hold references on their chain so the cached pointers stay
+ * valid for the seqcount comparison; the table is direct-mapped and
+ * bounded, replacement on collision drops the old entry's references once
+ * an RCU grace period has elapsed.  Runs are only inserted from ref-walk
+ * (typically the cold lookup that populated the dcache in the first
+ * place); rcu-walk only consumes them.
+ */
+#define PREFIX_CACHE_SHIFT	10
+#define PREFIX_CACHE_SIZE	(1 << PREFIX_CACHE_SHIFT)
+#define PREFIX_CACHE_MIN_DEPTH	3
+#define PREFIX_CACHE_MAX_DEPTH	8
+#define PREFIX_CACHE_NAME_MAX	96
+
+struct prefix_cache_entry {
+	struct dentry *start;
+	u64 hash;
+	unsigned int len;
+	unsigned char depth;
+	struct dentry *chain[PREFIX_CACHE_MAX_DEPTH];
+	unsigned int seqs[PREFIX_CACHE_MAX_DEPTH];
+	char name[PREFIX_CACHE_NAME_MAX];
+	struct rcu_head rcu;
+	struct llist_node free_node;
+};
+
+/* run being accumulated by link_path_walk(); holds no dentry references */
+struct prefix_run {
+	struct dentry *start;
+	struct vfsmount *mnt;
+	const char *name;
+	u64 hash;
+	unsigned int len;
+	unsigned char depth;
+	struct dentry *chain[PREFIX_CACHE_MAX_DEPTH];
+	unsigned int seqs[PREFIX_CACHE_MAX_DEPTH];
+};
+
+static struct prefix_cache_entry __rcu *prefix_cache[PREFIX_CACHE_SIZE];
+static DEFINE_SPINLOCK(prefix_cache_lock);
+static LLIST_HEAD(prefix_cache_free_list);
+
+static void prefix_cache_entry_free(struct prefix_cache_entry *pce)
+{
+	int i;
+
+	for (i = 0; i < pce->depth; i++)
+		dput(pce->chain[i]);
+	kfree(pce);
+}
+
+static void prefix_cache_free_workfn(struct work_struct *work)
+{
+	struct llist_node *list = llist_del_all(&prefix_cache_free_list);
+	struct prefix_cache_entry *pce, *next;
+
+	llist_for_each_entry_safe(pce, next, list, free_node)
+		prefix_cache_entry_free(pce);
+}
+
+static DECLARE_WORK(prefix_cache_free_work, prefix_cache_free_workfn);
+
+static void prefix_cache_entry_free_rcu(struct rcu_head *head)
+{
+	struct prefix_cache_entry *pce =
+		container_of(head, struct prefix_cache_entry, rcu);
+
+	/* dput() can sleep; push the final puts to process context */
+	llist_add(&pce->free_node, &prefix_cache_free_list);
+	schedule_work(&prefix_cache_free_work);
+}
+
+/*
+ * Both sides of the cache hash component names with the run's starting
+ * dentry as salt, so the per-parent salting of hash_name() (which a
+ * lookup could not reproduce without walking) never enters the key.
+ */
+static u64 prefix_cache_mix(u64 hash, unsigned int name_hash)
+{
+	return hash_64(hash ^ name_hash, 64);
+}
+
+static void prefix_run_start(struct prefix_run *run, struct nameidata *nd,
+			     const char *name)
+{
+	run->start = nd->path.dentry;
+	run->mnt = nd->path.mnt;
+	run->name = name;
+	run->hash = (unsigned long)nd->path.dentry;
+	run->len = 0;
+	run->depth = 0;
+}
+
+static void prefix_cache_insert(struct prefix_run *run)
+{
+	struct prefix_cache_entry *pce, *old;
+	struct dentry *d;
+	int i, got;
+
+	if (run->len > PREFIX_CACHE_NAME_MAX)
+		return;
+
+	pce = kmalloc(sizeof(*pce), GFP_KERNEL);
+	if (!pce)
+		return;
+	pce->start = run->start;
+	pce->hash = run->hash;
+	pce->len = run->len;
+	pce->depth = run->depth;
+	memcpy(pce->name, run->name, run->len);
+	memcpy(pce->chain, run->chain, run->depth * sizeof(*pce->chain));
+	memcpy(pce->seqs, run->seqs, run->depth * sizeof(*pce->seqs));
+
+	/*
+	 * The caller pins the terminal dentry, but the intermediates were
+	 * recorded by pointer only.  Walk the terminal's ancestry to prove
+	 * each recorded pointer is still live before taking a reference on
+	 * it; a rename since the run was walked makes the chain useless
+	 * anyway, as the remembered d_seq values no longer match.
+	 */
+	got = 0;
+	rcu_read_lock();
+	d = run->chain[run->depth - 1];
+	for (i = run->depth - 1; i > 0; i--) {
+		if (READ_ONCE(d->d_parent) != run->chain[i - 1])
+			goto fail;
+		d = run->chain[i - 1];
+	}
+	if (READ_ONCE(d->d_parent) != run->start)
+		goto fail;
+	for (; got < run->depth; got++) {
+		if (!lockref_get_not_dead(&pce->chain[got]->d_lockref))
+			goto fail;
+	}
+	rcu_read_unlock();
+
+	i = pce->hash & (PREFIX_CACHE_SIZE - 1);
+	spin_lock(&prefix_cache_lock);
+	old = rcu_dereference_protected(prefix_cache[i],
+			lockdep_is_held(&prefix_cache_lock));
+	rcu_assign_pointer(prefix_cache[i], pce);
+	spin_unlock(&prefix_cache_lock);
+	if (old)
+		call_rcu(&old->rcu, prefix_cache_entry_free_rcu);
+	return;
+
+fail:
+	rcu_read_unlock();
+	while (got--)
+		dput(pce->chain[got]);
+	kfree(pce);
+}
+
+static void prefix_run_flush(struct prefix_run *run, struct nameidata *nd)
+{
+	if (run->depth >= PREFIX_CACHE_MIN_DEPTH &&
+	    !(nd->flags & LOOKUP_RCU) &&
+	    nd->path.dentry == run->chain[run->depth - 1])
+		prefix_cache_insert(run);
+	/* dead until restarted at the top of the walk loop */
+	run->depth = 0;
+	run->name = NULL;
+}
+
+static void prefix_run_record(struct prefix_run *run, struct nameidata *nd)
+{
+	struct dentry *dentry = nd->path.dentry;
+	unsigned int len = hashlen_len(nd->last.hash_len);
+
+	if (!run->name)
+		return;
+	/* runs must not cross mounts; a hit leaves nd->path.mnt alone */
+	if (nd->path.mnt != run->mnt) {
+		run->depth = 0;
+		run->name = NULL;
+		return;
+	}
+	run->hash = prefix_cache_mix(run->hash,
+				     full_name_hash(run->start, nd->last.name, len));
+	run->len = nd->last.name + len - run->name;
+	run->chain[run->depth] = dentry;
+	run->seqs[run->depth] = raw_seqcount_begin(&dentry->d_seq);
+	run->depth++;
+	if (run->depth == PREFIX_CACHE_MAX_DEPTH)
+		prefix_run_flush(run, nd);
+}
+
+/*
+ * Try to resolve a run of components from the prefix cache.  Called in
+ * rcu-walk only, with may_lookup() already done for the current directory.
+ * On success nd and *namep are advanced past the run, which never includes
+ * the final component.  Failure of any check just falls back to the
+ * ordinary walk.
+ */
+static bool prefix_cache_lookup(struct nameidata *nd, const char **namep)
+{
+	const char *name = *namep;
+	const char *p = name;
+	const char *best_next = NULL;
+	struct prefix_cache_entry *pce, *best = NULL;
+	struct dentry *start = nd->path.dentry;
+	struct dentry *parent, *dentry;
+	struct inode *inode = NULL;
+	u64 hash = (unsigned long)start;
+	unsigned char depth = 0;
+	int i;
+
+	if (unlikely(start->d_flags & DCACHE_OP_HASH))
+		return false;
+
+	while (depth < PREFIX_CACHE_MAX_DEPTH) {
+		const char *cp = p;
+		const char *cend;
+		unsigned int clen;
+
+		while (*p && *p != '/')
+			p++;
+		clen = p - cp;
+		if (cp[0] == '.' && clen <= 2)
+			break;
+		hash = prefix_cache_mix(hash, full_name_hash(start, cp, clen));
+		depth++;
+		if (!*p)
+			break;		/* would swallow the last component */
+		cend = p;
+		do {
+			p++;
+		} while (unlikely(*p == '/'));
+		if (unlikely(!*p))
+			break;		/* trailing slashes: ditto */
+		if (depth < PREFIX_CACHE_MIN_DEPTH)
+			continue;
+		pce = rcu_dereference(prefix_cache[hash & (PREFIX_CACHE_SIZE - 1)]);
+		if (pce && pce->start == start && pce->hash == hash &&
+		    pce->depth == depth && pce->len == cend - name &&
+		    !memcmp(pce->name, name, pce->len)) {
+			best = pce;
+			best_next = p;
+		}
+	}
+	if (!best)
+		return false;
+
+	/*
+	 * Replay the chain.  An unchanged d_seq means the link has not been
+	 * renamed, unlinked or dropped since the run was walked; together
+	 * with the parent check that makes the remembered ancestry current.
+	 * Permission is rechecked per directory, as the walk would do.
+	 */
+	parent = start;
+	for (i = 0; i < best->depth; i++) {
+		dentry = best->chain[i];
+		if (raw_seqcount_begin(&dentry->d_seq) != best->seqs[i])
+			return false;
+		if (READ_ONCE(dentry->d_parent) != parent)
+			return false;
+		if (dentry->d_flags & (DCACHE_OP_REVALIDATE | DCACHE_OP_HASH |
+				       DCACHE_MANAGED_DENTRY))
+			return false;
+		if (!d_can_lookup(dentry))
+			return false;
+		inode = d_backing_inode(dentry);
+		if (!inode)
+			return false;
+		if (inode_permission(inode, MAY_EXEC | MAY_NOT_BLOCK))
+			return false;
+		parent = dentry;
+	}
+	nd->path.dentry = parent;
+	nd->inode = inode;
+	nd->seq = best->seqs[best->depth - 1];
+	nd->flags &= ~LOOKUP_JUMPED;
+	*namep = best_next;
+	return true;
+}
+
+/**
+ * prefix_cache_invalidate - drop prefix cache entries referencing a dentry
+ * @dentry: dentry being invalidated
+ *
+ * Called from d_invalidate().  Entries through @dentry would stop hitting
+ * on their own once its d_seq moves, but they pin their chain, so evict
+ * them eagerly to let the subtree be pruned.
+ */
+void prefix_cache_invalidate(struct dentry *dentry)
+{
+	struct prefix_cache_entry *pce;
+	int i, j;
+
+	spin_lock(&prefix_cache_lock);
+	for (i = 0; i < PREFIX_CACHE_SIZE; i++) {
+		pce = rcu_dereference_protected(prefix_cache[i],
+				lockdep_is_held(&prefix_cache_lock));
+		if (!pce)
+			continue;
+		if (pce->start != dentry) {
+			for (j = 0; j < pce->depth; j++)
+				if (pce->chain[j] == dentry)
+					break;
+			if (j == pce->depth)
+				continue;
+		}
+		rcu_assign_pointer(prefix_cache[i], NULL);
+		call_rcu(&pce->rcu, prefix_cache_entry_free_rcu);
+	}
+	spin_unlock(&prefix_cache_lock);
+}
+
+/*
+ * Drop every prefix cache entry pinning dentries on @sb, and wait until
+ * the references are really gone; called before the dcache is torn down
+ * on umount.
+ */
+void prefix_cache_evict_sb(struct super_block *sb)
+{
+	struct prefix_cache_entry *pce, *next;
+	struct llist_node *evicted = NULL;
+	int i;
+
+	spin_lock(&prefix_cache_lock);
+	for (i = 0; i < PREFIX_CACHE_SIZE; i++) {
+		pce = rcu_dereference_protected(prefix_cache[i],
+				lockdep_is_held(&prefix_cache_lock));
+		if (!pce || pce->chain[0]->d_sb != sb)
+			continue;
+		rcu_assign_pointer(prefix_cache[i], NULL);
+		pce->free_node.next = evicted;
+		evicted = &pce->free_node;
+	}
+	spin_unlock(&prefix_cache_lock);
+
+	/*
+	 * Wait out rcu-walks that may still see the detached entries, and
+	 * drain entries already queued for freeing that may pin dentries
+	 * on this superblock.
+	 */
+	rcu_barrier();
+	flush_work(&prefix_cache_free_work);
+
+	llist_for_each_entry_safe(pce, next, evicted, free_node)
+		prefix_cache_entry_free(pce);
+}
+
 /*
  * Name resolution.
  * This is the basic name resolution function, turning a pathname into
@@ -2031,8 +2470,11 @@ static inline u64 hash_name(const void *salt, const char *name)
  */
 static int link_path_walk(const char *name, struct nameidata *nd)
 {
+	struct prefix_run run;
 	int err;
 
+	run.depth = 0;
+
 	while (*name=='/')
 		name++;
 	if (!*name)
@@ -2043,10 +2485,18 @@ static int link_path_walk(const char *name, struct nameidata *nd)
 		u64 hash_len;
 		int type;
 
+		if (!run.depth)
+			prefix_run_start(&run, nd, name);
+
 		err = may_lookup(nd);
 		if (err)
 			return err;
 
+		if ((nd->flags & LOOKUP_RCU) && prefix_cache_lookup(nd, &name)) {
+			run.depth = 0;
+			continue;
+		}
+
 		hash_len = hash_name(nd->path.dentry, name);
 
 		type = LAST_NORM;
@@ -2060,11 +2510,14 @@ static int link_path_walk(const char *name, struct nameidata *nd)
 			case 1:
 				type = LAST_DOT;
 		}
+		if (unlikely(type != LAST_NORM))
+			prefix_run_flush(&run, nd);
 		if (likely(type == LAST_NORM)) {
 			struct dentry *parent = nd->path.dentry;
 			nd->flags &= ~LOOKUP_JUMPED;
 			if (unlikely(parent->d_flags & DCACHE_OP_HASH)) {
 				struct qstr this = { { .hash_len = hash_len }, .name = name };
+				prefix_run_flush(&run, nd);
 				err = parent->d_op->d_hash(parent, &this);
 				if (err < 0)
 					return err;
@@ -2089,6 +2542,7 @@ static int link_path_walk(const char *name, struct nameidata *nd)
 		} while (unlikely(*name == '/'));
 		if (unlikely(!*name)) {
 OK:
+			prefix_run_flush(&run, nd);
 			/* pathname body, done */
 			if (!nd->depth)
 				return 0;
@@ -2101,6 +2555,8 @@ OK:
 		} else {
 			/* not the last component */
 			err = walk_component(nd, WALK_FOLLOW | WALK_MORE);
+			if (likely(!err))
+				prefix_run_record(&run, nd);
 		}
 		if (err < 0)
 			return err;
@@ -2110,6 +2566,7 @@ OK:
 
 			if (IS_ERR(s))
 				return PTR_ERR(s);
+			prefix_run_flush(&run, nd);
 			err = 0;
 			if (unlikely(!s)) {
 				/* jumped */
@@ -3237,12 +3694,12 @@ static int do_last(struct nameidata *nd,
 		 */
 	}
 	if (open_flag & O_CREAT)
-		inode_lock(dir->d_inode);
+		inode_lock_dirent(dir->d_inode, &nd->last);
 	else
 		inode_lock_shared(dir->d_inode);
 	error = lookup_open(nd, &path, file, op, got_write, opened);
 	if (open_flag & O_CREAT)
-		inode_unlock(dir->d_inode);
+		inode_unlock_dirent(dir->d_inode, &nd->last);
 	else
 		inode_unlock_shared(dir->d_inode);
 
@@ -3557,7 +4014,7 @@ static struct dentry *filename_create(int dfd, struct filename *name,
 	 * Do the final lookup.
 	 */
 	lookup_flags |= LOOKUP_CREATE | LOOKUP_EXCL;
-	inode_lock_nested(path->dentry->d_inode, I_MUTEX_PARENT);
+	inode_lock_dirent(path->dentry->d_inode, &last);
 	dentry = __lookup_hash(&last, path->dentry, lookup_flags);
 	if (IS_ERR(dentry))
 		goto unlock;
@@ -3586,7 +4043,7 @@ fail:
 	dput(dentry);
 	dentry = ERR_PTR(error);
 unlock:
-	inode_unlock(path->dentry->d_inode);
+	inode_unlock_dirent(path->dentry->d_inode, &last);
 	if (!err2)
 		mnt_drop_write(path->mnt);
 out:
@@ -3605,8 +4062,8 @@ EXPORT_SYMBOL(kern_path_create);
 
 void done_path_create(struct path *path, struct dentry *dentry)
 {
+	inode_unlock_dirent(path->dentry->d_inode, &dentry->d_name);
 	dput(dentry);
-	inode_unlock(path->dentry->d_inode);
 	mnt_drop_write(path->mnt);
 	path_put(path);
 }
@@ -3961,7 +4418,7 @@ retry:
 	if (error)
 		goto exit1;
 retry_deleg:
-	inode_lock_nested(path.dentry->d_inode, I_MUTEX_PARENT);
+	inode_lock_dirent(path.dentry->d_inode, &last);
 	dentry = __lookup_hash(&last, path.dentry, lookup_flags);
 	error = PTR_ERR(dentry);
 	if (!IS_ERR(dentry)) {
@@ -3979,7 +4436,7 @@ retry_deleg:
 exit2:
 		dput(dentry);
 	}
-	inode_unlock(path.dentry->d_inode);
+	inode_unlock_dirent(path.dentry->d_inode, &last);
 	if (inode)
 		iput(inode);	/* truncate the inode here */
 	inode = NULL;
@@ -24,17 +24,33 @@
 #include <linux/magic.h>
 #include <linux/bootmem.h>
 #include <linux/task_work.h>
+#include <linux/vmalloc.h>
 #include "pnode.h"
 #include "internal.h"
 
 /* Maximum number of mounts in a mount namespace */
 unsigned int sysctl_mount_max __read_mostly = 100000;
 
-static unsigned int m_hash_mask __read_mostly;
-static unsigned int m_hash_shift __read_mostly;
 static unsigned int mp_hash_mask __read_mostly;
 static unsigned int mp_hash_shift __read_mostly;
 
+/*
+ * The mount hash is resized as mounts come and go, so that boxes
+ * carrying tens of thousands of container mounts keep short chains in
+ * __lookup_mnt() without boot-time tuning, while small systems stay at
+ * the boot-sized table.  The table is swapped under the mount_lock
+ * write side; lockless readers that race with a rehash are invalidated
+ * by the mount_lock seqcount and retry, exactly as they do when racing
+ * with an ordinary mount or umount.
+ */
+struct mount_hashtable {
+	unsigned int shift;
+	unsigned int mask;
+	struct hlist_head *buckets;
+};
+
+#define MOUNT_HASH_MAX_SHIFT	22
+
 static __initdata unsigned long mhash_entries;
 static int __init set_mhash_entries(char *str)
 {
@@ -62,7 +78,11 @@ static DEFINE_SPINLOCK(mnt_id_lock);
 static int mnt_id_start = 0;
 static int mnt_group_start = 1;
 
-static struct hlist_head *mount_hashtable __read_mostly;
+static struct mount_hashtable __rcu *mount_hashtable __read_mostly;
+static struct mount_hashtable mount_hash_boot __read_mostly;
+static atomic_long_t nr_mounts;
+static void mount_hash_resize_workfn(struct work_struct *work);
+static DECLARE_WORK(mount_hash_resize_work, mount_hash_resize_workfn);
 static struct hlist_head *mountpoint_hashtable __read_mostly;
 static struct kmem_cache *mnt_cache __read_mostly;
 static DECLARE_RWSEM(namespace_sem);
@@ -81,12 +101,127 @@ EXPORT_SYMBOL_GPL(fs_kobj);
  */
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(mount_lock);
 
-static inline struct hlist_head *m_hash(struct vfsmount *mnt, struct dentry *dentry)
+/*
+ * Valid under rcu_read_lock() or with mount_lock held for write; the
+ * table is only replaced by the resize worker, under mount_lock.
+ */
+static inline struct mount_hashtable *mount_hash_table(void)
+{
+	return rcu_dereference_check(mount_hashtable,
+				     lockdep_is_held(&mount_lock.lock));
+}
+
+static inline struct hlist_head *m_hash(struct mount_hashtable *table,
+					struct vfsmount *mnt,
+					struct dentry *dentry)
 {
 	unsigned long tmp = ((unsigned long)mnt / L1_CACHE_BYTES);
 	tmp += ((unsigned long)dentry / L1_CACHE_BYTES);
-	tmp = tmp + (tmp >> m_hash_shift);
-	return &mount_hashtable[tmp & m_hash_mask];
+	tmp = tmp + (tmp >> table->shift);
+	return &table->buckets[tmp & table->mask];
+}
+
+static struct mount_hashtable *mount_hashtable_alloc(unsigned int shift)
+{
+	unsigned int size = 1U << shift;
+	struct mount_hashtable *table;
+	unsigned int u;
+
+	table = kmalloc(sizeof(*table), GFP_KERNEL);
+	if (!table)
+		return NULL;
+	table->buckets = kmalloc(size * sizeof(struct hlist_head),
+				 GFP_KERNEL | __GFP_NOWARN);
+	if (!table->buckets)
+		table->buckets = vmalloc(size * sizeof(struct hlist_head));
+	if (!table->buckets) {
+		kfree(table);
+		return NULL;
+	}
+	table->shift = shift;
+	table->mask = size - 1;
+	for (u = 0; u < size; u++)
+		INIT_HLIST_HEAD(&table->buckets[u]);
+	return table;
+}
+
+/* The smallest table holding nr_mounts at an average chain length of one. */
+static unsigned int mount_hash_target_shift(void)
+{
+	long mounts = atomic_long_read(&nr_mounts);
+	unsigned int shift = mount_hash_boot.shift;
+
+	while (shift < MOUNT_HASH_MAX_SHIFT && (1L << shift) < mounts)
+		shift++;
+	return shift;
+}
+
+static void mount_hash_resize_workfn(struct work_struct *work)
+{
+	struct mount_hashtable *old, *new;
+	unsigned int shift, u;
+
+	old = rcu_dereference_protected(mount_hashtable, true);
+	shift = mount_hash_target_shift();
+	if (shift == old->shift)
+		return;
+
+	new = mount_hashtable_alloc(shift);
+	if (!new)
+		return;
+
+	/*
+	 * Moving an entry momentarily hides it from lockless walkers of
+	 * the old chains, but they revalidate against the mount_lock
+	 * seqcount (which we are bumping here) and retry, so nothing is
+	 * ever missed for good.  Chain order does not matter: since
+	 * mnt_change_mountpoint() re-parents covering mounts, no two
+	 * hashed mounts share a (parent, mountpoint) pair.
+	 */
+	write_seqlock(&mount_lock);
+	for (u = 0; u <= old->mask; u++) {
+		while (!hlist_empty(&old->buckets[u])) {
+			struct mount *p = hlist_entry(old->buckets[u].first,
+						      struct mount, mnt_hash);
+
+			hlist_del_rcu(&p->mnt_hash);
+			hlist_add_head_rcu(&p->mnt_hash,
+					   m_hash(new, &p->mnt_parent->mnt,
+						  p->mnt_mountpoint));
+		}
+	}
+	rcu_assign_pointer(mount_hashtable, new);
+	write_sequnlock(&mount_lock);
+
+	synchronize_rcu();
+	if (old != &mount_hash_boot) {
+		kvfree(old->buckets);
+		kfree(old);
+	}
+}
+
+/*
+ * Called whenever a mount is created or destroyed.  nr_mounts is only
+ * a sizing heuristic, so the racy reads are fine; the worker makes the
+ * final decision under mount_lock.  Grow at an average chain length of
+ * two, shrink when the table is less than 1/8th full, and never drop
+ * below the boot-time size.
+ */
+static void mount_hash_maybe_resize(void)
+{
+	long mounts = atomic_long_read(&nr_mounts);
+	struct mount_hashtable *table;
+	unsigned int size;
+	bool resize;
+
+	rcu_read_lock();
+	table = rcu_dereference(mount_hashtable);
+	size = table->mask + 1;
+	resize = (mounts > 2L * size && table->shift < MOUNT_HASH_MAX_SHIFT) ||
+		 (mounts < size / 8 && table->shift > mount_hash_boot.shift);
+	rcu_read_unlock();
+	if (resize)
+		schedule_work(&mount_hash_resize_work);
 }
 
 static inline struct hlist_head *mp_hash(struct dentry *dentry)
@@ -237,6 +372,9 @@ static struct mount *alloc_vfsmnt(const char *name)
 		INIT_HLIST_HEAD(&mnt->mnt_fsnotify_marks);
 #endif
 		init_fs_pin(&mnt->mnt_umount, drop_mountpoint);
+
+		atomic_long_inc(&nr_mounts);
+		mount_hash_maybe_resize();
 	}
 	return mnt;
 
@@ -576,6 +714,8 @@ int sb_prepare_remount_readonly(struct super_block *sb)
 
 static void free_vfsmnt(struct mount *mnt)
 {
+	atomic_long_dec(&nr_mounts);
+	mount_hash_maybe_resize();
 	kfree_const(mnt->mnt_devname);
 #ifdef CONFIG_SMP
 	free_percpu(mnt->mnt_pcp);
@@ -627,7 +767,7 @@ bool legitimize_mnt(struct vfsmount *bastard, unsigned seq)
  */
 struct mount *__lookup_mnt(struct vfsmount *mnt, struct dentry *dentry)
 {
-	struct hlist_head *head = m_hash(mnt, dentry);
+	struct hlist_head *head = m_hash(mount_hash_table(), mnt, dentry);
 	struct mount *p;
 
 	hlist_for_each_entry_rcu(p, head, mnt_hash)
@@ -859,7 +999,8 @@ void mnt_set_mountpoint(struct mount *mnt,
 static void __attach_mnt(struct mount *mnt, struct mount *parent)
 {
 	hlist_add_head_rcu(&mnt->mnt_hash,
-			   m_hash(&parent->mnt, mnt->mnt_mountpoint));
+			   m_hash(mount_hash_table(), &parent->mnt,
+				  mnt->mnt_mountpoint));
 	list_add_tail(&mnt->mnt_child, &parent->mnt_mounts);
 }
 
@@ -3244,24 +3385,26 @@ void __init mnt_init(void)
 	mnt_cache = kmem_cache_create("mnt_cache", sizeof(struct mount),
 			0, SLAB_HWCACHE_ALIGN | SLAB_PANIC, NULL);
 
-	mount_hashtable = alloc_large_system_hash("Mount-cache",
+	mount_hash_boot.buckets = alloc_large_system_hash("Mount-cache",
 				sizeof(struct hlist_head),
 				mhash_entries, 19,
 				0,
-				&m_hash_shift, &m_hash_mask, 0, 0);
+				&mount_hash_boot.shift,
+				&mount_hash_boot.mask, 0, 0);
 	mountpoint_hashtable = alloc_large_system_hash("Mountpoint-cache",
 				sizeof(struct hlist_head),
 				mphash_entries, 19,
 				0,
 				&mp_hash_shift, &mp_hash_mask, 0, 0);
 
-	if (!mount_hashtable || !mountpoint_hashtable)
+	if (!mount_hash_boot.buckets || !mountpoint_hashtable)
 		panic("Failed to allocate mount hash table\n");
 
-	for (u = 0; u <= m_hash_mask; u++)
-		INIT_HLIST_HEAD(&mount_hashtable[u]);
+	for (u = 0; u <= mount_hash_boot.mask; u++)
+		INIT_HLIST_HEAD(&mount_hash_boot.buckets[u]);
 	for (u = 0; u <= mp_hash_mask; u++)
 		INIT_HLIST_HEAD(&mountpoint_hashtable[u]);
+	RCU_INIT_POINTER(mount_hashtable, &mount_hash_boot);
 
 	kernfs_init();
 
@@ -92,6 +92,9 @@ int __fsnotify_parent(const struct path *path, struct dentry *dentry, __u32 mask
 	struct inode *p_inode;
 	int ret = 0;
 
+	if (!static_branch_unlikely(&fsnotify_marks_in_use))
+		return 0;
+
 	if (!dentry)
 		dentry = path->dentry;
 
@@ -198,6 +201,20 @@ int fsnotify(struct inode *to_tell, __u32 mask, const void *data, int data_is,
 	/* global tests shouldn't care about events on child only the specific event */
 	__u32 test_mask = (mask & ~FS_EVENT_ON_CHILD);
 
+	/* nothing is watched anywhere in the system */
+	if (!static_branch_unlikely(&fsnotify_marks_in_use))
+		return 0;
+
+	/*
+	 * One load filter before touching the inode or mount lines: if
+	 * nothing on this superblock has ever watched this event type,
+	 * no mark list can be interested.  Modify events still fall
+	 * through so ignored masks get cleared below.
+	 */
+	if (!(mask & FS_MODIFY) &&
+	    !(test_mask & to_tell->i_sb->s_fsnotify_mask))
+		return 0;
+
 	if (data_is == FSNOTIFY_EVENT_PATH)
 		mnt = real_mount(((const struct path *)data)->mnt);
 	else
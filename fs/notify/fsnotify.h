@@ -3,6 +3,7 @@
 
 #include <linux/list.h>
 #include <linux/fsnotify.h>
+#include <linux/jump_label.h>
 #include <linux/srcu.h>
 #include <linux/types.h>
 
@@ -17,6 +18,12 @@ extern struct srcu_struct fsnotify_mark_srcu;
 /* Calculate mask of events for a list of marks */
 extern u32 fsnotify_recalc_mask(struct hlist_head *head);
 
+/* true whenever at least one mark is attached somewhere in the system */
+extern struct static_key_false fsnotify_marks_in_use;
+
+/* Fold newly watched events into the superblock interest mask */
+extern void fsnotify_sb_add_mask(struct super_block *sb, __u32 mask);
+
 /* compare two groups for sorting of marks lists */
 extern int fsnotify_compare_groups(struct fsnotify_group *a,
 				   struct fsnotify_group *b);
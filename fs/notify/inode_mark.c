@@ -40,6 +40,8 @@ void fsnotify_recalc_inode_mask(struct inode *inode)
 	inode->i_fsnotify_mask = fsnotify_recalc_mask(&inode->i_fsnotify_marks);
 	spin_unlock(&inode->i_lock);
 
+	fsnotify_sb_add_mask(inode->i_sb, inode->i_fsnotify_mask);
+
 	__fsnotify_update_child_dentry_flags(inode);
 }
 
@@ -138,6 +140,8 @@ int fsnotify_add_inode_mark(struct fsnotify_mark *mark,
 	inode->i_fsnotify_mask = fsnotify_recalc_mask(&inode->i_fsnotify_marks);
 	spin_unlock(&inode->i_lock);
 
+	fsnotify_sb_add_mask(inode->i_sb, inode->i_fsnotify_mask);
+
 	return ret;
 }
 
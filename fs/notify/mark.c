@@ -94,6 +94,7 @@
 #define FSNOTIFY_REAPER_DELAY	(1)	/* 1 jiffy */
 
 struct srcu_struct fsnotify_mark_srcu;
+DEFINE_STATIC_KEY_FALSE(fsnotify_marks_in_use);
 static DEFINE_SPINLOCK(destroy_lock);
 static LIST_HEAD(destroy_list);
 
@@ -125,6 +126,24 @@ u32 fsnotify_recalc_mask(struct hlist_head *head)
 	return new_mask;
 }
 
+/*
+ * The superblock interest mask only ever grows; it is a cheap
+ * first-level filter for fsnotify(), not an exact aggregate, so a
+ * stale bit merely sends an event down the existing per-object checks.
+ */
+void fsnotify_sb_add_mask(struct super_block *sb, __u32 mask)
+{
+	__u32 old = READ_ONCE(sb->s_fsnotify_mask);
+
+	while ((old | mask) != old) {
+		__u32 prev = cmpxchg(&sb->s_fsnotify_mask, old, old | mask);
+
+		if (prev == old)
+			break;
+		old = prev;
+	}
+}
+
 /*
  * Remove mark from inode / vfsmount list, group list, drop inode reference
  * if we got one.
@@ -170,6 +189,8 @@ void fsnotify_detach_mark(struct fsnotify_mark *mark)
 		iput(inode);
 
 	atomic_dec(&group->num_marks);
+
+	static_branch_dec(&fsnotify_marks_in_use);
 }
 
 /*
@@ -363,6 +384,12 @@ int fsnotify_add_mark_locked(struct fsnotify_mark *mark,
 	BUG_ON(!inode && !mnt);
 	BUG_ON(!mutex_is_locked(&group->mark_mutex));
 
+	/*
+	 * Enable the fsnotify() fastpath bypass key before the mark is
+	 * visible so no event can slip past while it is being attached.
+	 */
+	static_branch_inc(&fsnotify_marks_in_use);
+
 	/*
 	 * LOCKING ORDER!!!!
 	 * group->mark_mutex
@@ -407,6 +434,8 @@ err:
 
 	spin_unlock(&mark->lock);
 
+	static_branch_dec(&fsnotify_marks_in_use);
+
 	spin_lock(&destroy_lock);
 	list_add(&mark->g_list, &destroy_list);
 	spin_unlock(&destroy_lock);
@@ -45,6 +45,8 @@ void fsnotify_recalc_vfsmount_mask(struct vfsmount *mnt)
 	spin_lock(&mnt->mnt_root->d_lock);
 	m->mnt_fsnotify_mask = fsnotify_recalc_mask(&m->mnt_fsnotify_marks);
 	spin_unlock(&mnt->mnt_root->d_lock);
+
+	fsnotify_sb_add_mask(mnt->mnt_sb, m->mnt_fsnotify_mask);
 }
 
 void fsnotify_destroy_vfsmount_mark(struct fsnotify_mark *mark)
@@ -104,5 +106,7 @@ int fsnotify_add_vfsmount_mark(struct fsnotify_mark *mark,
 	m->mnt_fsnotify_mask = fsnotify_recalc_mask(&m->mnt_fsnotify_marks);
 	spin_unlock(&mnt->mnt_root->d_lock);
 
+	fsnotify_sb_add_mask(mnt->mnt_sb, m->mnt_fsnotify_mask);
+
 	return ret;
 }
@@ -1080,6 +1080,90 @@ SYSCALL_DEFINE4(openat, int, dfd, const char __user *, filename, int, flags,
 	return do_sys_open(dfd, filename, flags, mode);
 }
 
+/*
+ * Entry for readfiles(). The kernel opens dirfd/path read-only, reads
+ * up to bufsize bytes into buf, closes the file again and stores the
+ * number of bytes read (or a negative errno) in ->size.
+ */
+struct readfile_entry {
+	__s32 dirfd;
+	__u32 reserved;		/* must be 0 */
+	__u64 path;		/* const char * */
+	__u64 buf;
+	__u64 bufsize;
+	__s64 size;		/* out: bytes read or -errno */
+};
+
+static long do_readfile(struct readfile_entry *re, const struct open_flags *op)
+{
+	struct filename *tmp;
+	struct file *f;
+	loff_t pos = 0;
+	long ret;
+
+	tmp = getname(u64_to_user_ptr(re->path));
+	if (IS_ERR(tmp))
+		return PTR_ERR(tmp);
+
+	f = do_filp_open(re->dirfd, tmp, op);
+	putname(tmp);
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+
+	fsnotify_open(f);
+	ret = vfs_read(f, u64_to_user_ptr(re->buf), re->bufsize, &pos);
+	fput(f);
+	return ret;
+}
+
+/*
+ * Perform open+read+close for an array of small files in one syscall,
+ * never installing an fd. The open intent is built once and shared by
+ * the whole batch; permission and LSM checks still run per file inside
+ * do_filp_open(). Per-file results go to ->size, and processing only
+ * stops when an entry itself cannot be read or written back. Returns
+ * the number of entries processed, or an error if the first one fails.
+ */
+SYSCALL_DEFINE3(readfiles, struct readfile_entry __user *, uentries,
+		unsigned int, nr, unsigned int, flags)
+{
+	struct open_flags op;
+	unsigned int i;
+	long err;
+
+	if (flags)
+		return -EINVAL;
+
+	if (unlikely(nr > LONG_MAX / sizeof(*uentries)))
+		nr = LONG_MAX / sizeof(*uentries);
+
+	err = build_open_flags(O_RDONLY | O_LARGEFILE, 0, &op);
+	if (err)
+		return err;
+
+	for (i = 0; i < nr; i++) {
+		struct readfile_entry re;
+
+		if (copy_from_user(&re, &uentries[i], sizeof(re))) {
+			err = -EFAULT;
+			break;
+		}
+		if (re.reserved) {
+			err = -EINVAL;
+			break;
+		}
+
+		re.size = do_readfile(&re, &op);
+		if (put_user(re.size, &uentries[i].size)) {
+			err = -EFAULT;
+			break;
+		}
+		cond_resched();
+	}
+
+	return i ? i : err;
+}
+
 #ifndef __alpha__
 
 /*
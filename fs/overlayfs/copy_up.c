@@ -20,6 +20,7 @@
 #include <linux/fdtable.h>
 #include <linux/ratelimit.h>
 #include "overlayfs.h"
+#include "ovl_entry.h"
 
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
 
@@ -230,9 +231,16 @@ int ovl_set_attr(struct dentry *upperdentry, struct kstat *stat)
 	return err;
 }
 
+/* Copying up file data is only needed if the file is opened for write */
+static bool ovl_open_need_data(int flags)
+{
+	return (OPEN_FMODE(flags) & FMODE_WRITE) || (flags & O_TRUNC);
+}
+
 static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 			      struct dentry *dentry, struct path *lowerpath,
-			      struct kstat *stat, const char *link)
+			      struct kstat *stat, const char *link,
+			      bool metacopy)
 {
 	struct inode *wdir = workdir->d_inode;
 	struct inode *udir = upperdir->d_inode;
@@ -276,7 +284,7 @@ static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 	if (err)
 		goto out2;
 
-	if (S_ISREG(stat->mode)) {
+	if (S_ISREG(stat->mode) && !metacopy) {
 		struct path upperpath;
 
 		ovl_path_upper(dentry, &upperpath);
@@ -292,6 +300,13 @@ static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 	if (err)
 		goto out_cleanup;
 
+	if (metacopy) {
+		err = ovl_do_setxattr(newdentry, OVL_XATTR_METACOPY,
+				      "y", 1, 0);
+		if (err)
+			goto out_cleanup;
+	}
+
 	inode_lock(newdentry->d_inode);
 	err = ovl_set_attr(newdentry, stat);
 	inode_unlock(newdentry->d_inode);
@@ -327,7 +342,8 @@ out_cleanup:
  * the file will have already been copied up anyway.
  */
 static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
-			   struct path *lowerpath, struct kstat *stat)
+			   struct path *lowerpath, struct kstat *stat,
+			   bool metacopy)
 {
 	DEFINE_DELAYED_CALL(done);
 	struct dentry *workdir = ovl_workdir(dentry);
@@ -368,10 +384,12 @@ static int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 	}
 
 	err = ovl_copy_up_locked(workdir, upperdir, dentry, lowerpath,
-				 stat, link);
+				 stat, link, metacopy);
 	if (!err) {
 		/* Restore timestamps on parent (best effort) */
 		ovl_set_timestamps(upperdir, &pstat);
+		if (metacopy)
+			ovl_dentry_set_metacopy(dentry, true);
 	}
 out_unlock:
 	unlock_rename(workdir, upperdir);
@@ -380,9 +398,80 @@ out_unlock:
 	return err;
 }
 
+/*
+ * Copy the data of a metadata only copied up file from the lower layer
+ * into the already present upper inode.  Uses the same workdir+upperdir
+ * lock as a regular copy up for exclusion.  The metacopy xattr is
+ * removed only after the data is in place, so a crash in the middle
+ * leaves a valid metacopy file behind.
+ */
+static int ovl_copy_up_meta_data(struct dentry *dentry, int flags)
+{
+	struct dentry *workdir = ovl_workdir(dentry);
+	struct dentry *parent = dget_parent(dentry);
+	struct dentry *upperdir;
+	struct path parentpath;
+	struct path upperpath;
+	struct path lowerpath;
+	struct kstat stat;
+	struct kstat upperstat;
+	int err;
+
+	if (WARN_ON(!workdir)) {
+		err = -EROFS;
+		goto out;
+	}
+
+	ovl_path_upper(parent, &parentpath);
+	upperdir = parentpath.dentry;
+	ovl_path_upper(dentry, &upperpath);
+	ovl_path_lower(dentry, &lowerpath);
+
+	err = vfs_getattr(&upperpath, &upperstat);
+	if (err)
+		goto out;
+
+	err = vfs_getattr(&lowerpath, &stat);
+	if (err)
+		goto out;
+	if (flags & O_TRUNC)
+		stat.size = 0;
+
+	err = -EIO;
+	if (lock_rename(workdir, upperdir) != NULL) {
+		pr_err("overlayfs: failed to lock workdir+upperdir\n");
+		goto out_unlock;
+	}
+	if (!ovl_dentry_is_metacopy(dentry)) {
+		/* Raced with another data copy up?  Nothing to do, then... */
+		err = 0;
+		goto out_unlock;
+	}
+
+	err = ovl_copy_up_data(&lowerpath, &upperpath, stat.size);
+	if (err)
+		goto out_unlock;
+
+	/* Restore timestamps, the data copy is not a modification */
+	ovl_set_timestamps(upperpath.dentry, &upperstat);
+
+	err = ovl_do_removexattr(upperpath.dentry, OVL_XATTR_METACOPY);
+	if (err)
+		goto out_unlock;
+
+	ovl_dentry_set_metacopy(dentry, false);
+out_unlock:
+	unlock_rename(workdir, upperdir);
+out:
+	dput(parent);
+
+	return err;
+}
+
 int ovl_copy_up_flags(struct dentry *dentry, int flags)
 {
 	int err = 0;
+	struct ovl_fs *ofs = dentry->d_sb->s_fs_info;
 	const struct cred *old_cred = ovl_override_creds(dentry->d_sb);
 
 	while (!err) {
@@ -392,8 +481,12 @@ int ovl_copy_up_flags(struct dentry *dentry, int flags)
 		struct kstat stat;
 		enum ovl_path_type type = ovl_path_type(dentry);
 
-		if (OVL_TYPE_UPPER(type))
+		if (OVL_TYPE_UPPER(type)) {
+			if (ovl_dentry_is_metacopy(dentry) &&
+			    ovl_open_need_data(flags))
+				err = ovl_copy_up_meta_data(dentry, flags);
 			break;
+		}
 
 		next = dget(dentry);
 		/* find the topmost dentry not yet copied up */
@@ -413,8 +506,14 @@ int ovl_copy_up_flags(struct dentry *dentry, int flags)
 		/* maybe truncate regular file. this has no effect on dirs */
 		if (flags & O_TRUNC)
 			stat.size = 0;
-		if (!err)
-			err = ovl_copy_up_one(parent, next, &lowerpath, &stat);
+		if (!err) {
+			bool metacopy = ofs->config.metacopy &&
+					S_ISREG(stat.mode) &&
+					!ovl_open_need_data(flags);
+
+			err = ovl_copy_up_one(parent, next, &lowerpath, &stat,
+					      metacopy);
+		}
 
 		dput(parent);
 		dput(next);
@@ -603,7 +603,11 @@ static int ovl_link(struct dentry *old, struct inode *newdir,
 	if (err)
 		goto out;
 
-	err = ovl_copy_up(old);
+	/*
+	 * A hardlink can be looked up under any name, so the upper inode
+	 * must carry the file data and not a metacopy marker.
+	 */
+	err = ovl_copy_up_flags(old, O_WRONLY);
 	if (err)
 		goto out_drop_write;
 
@@ -926,7 +930,12 @@ static int ovl_rename(struct inode *olddir, struct dentry *old,
 	if (err)
 		goto out;
 
-	err = ovl_copy_up(old);
+	/*
+	 * Rename changes the name the lower data is found under, so the
+	 * renamed upper inode must carry the file data and not a
+	 * metacopy marker.
+	 */
+	err = ovl_copy_up_flags(old, O_WRONLY);
 	if (err)
 		goto out_drop_write;
 
@@ -934,7 +943,7 @@ static int ovl_rename(struct inode *olddir, struct dentry *old,
 	if (err)
 		goto out_drop_write;
 	if (!overwrite) {
-		err = ovl_copy_up(new);
+		err = ovl_copy_up_flags(new, O_WRONLY);
 		if (err)
 			goto out_drop_write;
 	}
@@ -36,7 +36,16 @@ int ovl_setattr(struct dentry *dentry, struct iattr *attr)
 	if (err)
 		goto out;
 
-	err = ovl_copy_up(dentry);
+	/*
+	 * Truncate changes the file contents, so it must not result in a
+	 * metadata only copy up and it must pull in the data of an
+	 * already present metadata only copy.
+	 */
+	if (attr->ia_valid & ATTR_SIZE)
+		err = ovl_copy_up_flags(dentry, attr->ia_size ?
+					O_WRONLY : O_WRONLY | O_TRUNC);
+	else
+		err = ovl_copy_up(dentry);
 	if (!err) {
 		upperdentry = ovl_dentry_upper(dentry);
 
@@ -66,6 +75,18 @@ static int ovl_getattr(struct vfsmount *mnt, struct dentry *dentry,
 	ovl_path_real(dentry, &realpath);
 	old_cred = ovl_override_creds(dentry->d_sb);
 	err = vfs_getattr(&realpath, stat);
+	if (!err && ovl_dentry_is_metacopy(dentry)) {
+		struct path lowerpath;
+		struct kstat lowerstat;
+
+		/* The data of a metadata only copy lives in the lower layer */
+		ovl_path_lower(dentry, &lowerpath);
+		err = vfs_getattr(&lowerpath, &lowerstat);
+		if (!err) {
+			stat->size = lowerstat.size;
+			stat->blocks = lowerstat.blocks;
+		}
+	}
 	revert_creds(old_cred);
 	return err;
 }
@@ -228,10 +249,12 @@ struct posix_acl *ovl_get_acl(struct inode *inode, int type)
 	return acl;
 }
 
-static bool ovl_open_need_copy_up(int flags, enum ovl_path_type type,
+static bool ovl_open_need_copy_up(struct dentry *dentry, int flags,
+				  enum ovl_path_type type,
 				  struct dentry *realdentry)
 {
-	if (OVL_TYPE_UPPER(type))
+	/* A metadata only copy still needs its data copied up for write */
+	if (OVL_TYPE_UPPER(type) && !ovl_dentry_is_metacopy(dentry))
 		return false;
 
 	if (special_file(realdentry->d_inode->i_mode))
@@ -250,7 +273,7 @@ int ovl_open_maybe_copy_up(struct dentry *dentry, unsigned int file_flags)
 	enum ovl_path_type type;
 
 	type = ovl_path_real(dentry, &realpath);
-	if (ovl_open_need_copy_up(file_flags, type, realpath.dentry)) {
+	if (ovl_open_need_copy_up(dentry, file_flags, type, realpath.dentry)) {
 		err = ovl_want_write(dentry);
 		if (!err) {
 			err = ovl_copy_up_flags(dentry, file_flags);
@@ -20,6 +20,8 @@ struct ovl_lookup_data {
 	bool opaque;
 	bool stop;
 	bool last;
+	bool check_metacopy;
+	bool metacopy;
 	char *redirect;
 };
 
@@ -95,6 +97,18 @@ static bool ovl_is_opaquedir(struct dentry *dentry)
 	return false;
 }
 
+static bool ovl_is_metacopy(struct dentry *dentry)
+{
+	int res;
+	char val;
+
+	res = vfs_getxattr(dentry, OVL_XATTR_METACOPY, &val, 1);
+	if (res == 1 && val == 'y')
+		return true;
+
+	return false;
+}
+
 static int ovl_lookup_single(struct dentry *base, struct ovl_lookup_data *d,
 			     const char *name, unsigned int namelen,
 			     size_t prelen, const char *post,
@@ -124,9 +138,19 @@ static int ovl_lookup_single(struct dentry *base, struct ovl_lookup_data *d,
 		goto put_and_out;
 	}
 	if (!d_can_lookup(this)) {
-		d->stop = true;
-		if (d->is_dir)
+		if (d->is_dir) {
+			d->stop = true;
 			goto put_and_out;
+		}
+		/*
+		 * A metadata only copied up file does not stop the
+		 * lookup: the lower layers must still be scanned to
+		 * find the dentry holding the file data.
+		 */
+		if (d->check_metacopy && ovl_is_metacopy(this))
+			d->metacopy = true;
+		else
+			d->stop = true;
 		goto out;
 	}
 	d->is_dir = true;
@@ -234,6 +258,8 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 		.opaque = false,
 		.stop = false,
 		.last = !poe->numlower,
+		.check_metacopy = false,
+		.metacopy = false,
 		.redirect = NULL,
 	};
 
@@ -243,7 +269,10 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 	old_cred = ovl_override_creds(dentry->d_sb);
 	upperdir = ovl_upperdentry_dereference(poe);
 	if (upperdir) {
+		/* Only the upper layer may carry the metacopy marker */
+		d.check_metacopy = true;
 		err = ovl_lookup_layer(upperdir, &d, &upperdentry);
+		d.check_metacopy = false;
 		if (err)
 			goto out;
 
@@ -303,6 +332,17 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 		}
 	}
 
+	/*
+	 * A metadata only copy is useless without the lower dentry
+	 * holding its data.
+	 */
+	if (d.metacopy && (!ctr || d_is_dir(stack[0].dentry))) {
+		pr_warn_ratelimited("overlayfs: metacopy file '%pd' has no lower data\n",
+				    dentry);
+		err = -EIO;
+		goto out_put;
+	}
+
 	oe = ovl_alloc_entry(ctr);
 	err = -ENOMEM;
 	if (!oe)
@@ -331,6 +371,7 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 
 	revert_creds(old_cred);
 	oe->opaque = upperopaque;
+	oe->metacopy = d.metacopy;
 	oe->redirect = upperredirect;
 	oe->__upperdentry = upperdentry;
 	memcpy(oe->lowerstack, stack, sizeof(struct path) * ctr);
@@ -14,6 +14,7 @@ struct ovl_config {
 	char *workdir;
 	bool default_permissions;
 	bool redirect_dir;
+	bool metacopy;
 };
 
 /* private information held for overlayfs's superblock */
@@ -38,6 +39,7 @@ struct ovl_entry {
 			u64 version;
 			const char *redirect;
 			bool opaque;
+			bool metacopy;
 		};
 		struct rcu_head rcu;
 	};
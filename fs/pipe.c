@@ -45,6 +45,25 @@ unsigned int pipe_min_size = PAGE_SIZE;
 unsigned long pipe_user_pages_hard;
 unsigned long pipe_user_pages_soft = PIPE_DEF_BUFFERS * INR_OPEN_CUR;
 
+/*
+ * Readers are normally woken on every write. If this is non-zero, a
+ * write that leaves fewer queued bytes than the watermark arms a short
+ * timer instead, so streaming writers batch many small writes into a
+ * single reader wakeup. Set in /proc/sys/fs/pipe-wakeup-watermark.
+ */
+unsigned int pipe_wakeup_watermark;
+
+/* How long a wakeup held back by the watermark may be deferred */
+#define PIPE_WAKEUP_TIMEOUT	msecs_to_jiffies(1)
+
+/*
+ * Largest compound page we try to allocate for a single pipe buffer:
+ * one PMD-sized page, clamped in case the page allocator cannot go
+ * that high.
+ */
+#define PIPE_BUF_MAX_ORDER	\
+	min_t(unsigned int, PMD_SHIFT - PAGE_SHIFT, MAX_ORDER - 1)
+
 /*
  * We use a start+len construction, which provides full use of the 
  * allocated memory.
@@ -131,8 +150,9 @@ static void anon_pipe_buf_release(struct pipe_inode_info *pipe,
 	 * If nobody else uses this page, and we don't already have a
 	 * temporary page, let's keep track of it as a one-deep
 	 * allocation cache. (Otherwise just release our reference to it)
+	 * Compound buffer pages are never cached.
 	 */
-	if (page_count(page) == 1 && !pipe->tmp_page)
+	if (!PageCompound(page) && page_count(page) == 1 && !pipe->tmp_page)
 		pipe->tmp_page = page;
 	else
 		put_page(page);
@@ -143,6 +163,13 @@ static int anon_pipe_buf_steal(struct pipe_inode_info *pipe,
 {
 	struct page *page = buf->page;
 
+	/*
+	 * Compound buffers cannot be stolen; their pages won't fit a
+	 * page cache slot. Callers fall back to copying.
+	 */
+	if (pipe_buf_order(buf))
+		return 1;
+
 	if (page_count(page) == 1) {
 		if (memcg_kmem_enabled())
 			memcg_kmem_uncharge(page, 0);
@@ -246,6 +273,67 @@ static const struct pipe_buf_operations packet_pipe_buf_ops = {
 	.get = generic_pipe_buf_get,
 };
 
+/*
+ * Copy to/from a pipe buffer page one sub-page at a time, so that a
+ * compound buffer never feeds copy_page_{to,from}_iter() an offset or
+ * length that crosses a page boundary.
+ */
+static size_t pipe_copy_page_to_iter(struct page *page, size_t offset,
+				     size_t bytes, struct iov_iter *to)
+{
+	size_t copied = 0;
+
+	while (bytes) {
+		size_t chunk = min_t(size_t, bytes,
+				     PAGE_SIZE - (offset & ~PAGE_MASK));
+		size_t n;
+
+		n = copy_page_to_iter(page + (offset >> PAGE_SHIFT),
+				      offset & ~PAGE_MASK, chunk, to);
+		copied += n;
+		if (n < chunk)
+			break;
+		offset += chunk;
+		bytes -= chunk;
+	}
+	return copied;
+}
+
+static size_t pipe_copy_page_from_iter(struct page *page, size_t offset,
+				       size_t bytes, struct iov_iter *from)
+{
+	size_t copied = 0;
+
+	while (bytes) {
+		size_t chunk = min_t(size_t, bytes,
+				     PAGE_SIZE - (offset & ~PAGE_MASK));
+		size_t n;
+
+		n = copy_page_from_iter(page + (offset >> PAGE_SHIFT),
+					offset & ~PAGE_MASK, chunk, from);
+		copied += n;
+		if (n < chunk)
+			break;
+		offset += chunk;
+		bytes -= chunk;
+	}
+	return copied;
+}
+
+/* Number of bytes queued in the pipe. Caller must hold the pipe lock. */
+static unsigned int pipe_data_len(struct pipe_inode_info *pipe)
+{
+	unsigned int count = 0;
+	int buf = pipe->curbuf;
+	int nrbufs = pipe->nrbufs;
+
+	while (--nrbufs >= 0) {
+		count += pipe->bufs[buf].len;
+		buf = (buf + 1) & (pipe->buffers - 1);
+	}
+	return count;
+}
+
 static ssize_t
 pipe_read(struct kiocb *iocb, struct iov_iter *to)
 {
@@ -281,7 +369,8 @@ pipe_read(struct kiocb *iocb, struct iov_iter *to)
 				break;
 			}
 
-			written = copy_page_to_iter(buf->page, buf->offset, chars, to);
+			written = pipe_copy_page_to_iter(buf->page, buf->offset,
+							 chars, to);
 			if (unlikely(written < chars)) {
 				if (!ret)
 					ret = -EFAULT;
@@ -298,6 +387,7 @@ pipe_read(struct kiocb *iocb, struct iov_iter *to)
 			}
 
 			if (!buf->len) {
+				pipe->nrpages -= pipe_buf_pages(buf);
 				pipe_buf_release(pipe, buf);
 				curbuf = (curbuf + 1) & (pipe->buffers - 1);
 				pipe->curbuf = curbuf;
@@ -353,6 +443,25 @@ static inline int is_packetized(struct file *file)
 	return (file->f_flags & O_DIRECT) != 0;
 }
 
+/*
+ * Pick an allocation order for a fresh pipe buffer. Large writes get
+ * compound pages so that readers and splice can move data in much
+ * bigger units, as long as the pipe's page budget has room for them.
+ */
+static unsigned int pipe_write_buf_order(struct pipe_inode_info *pipe,
+					 size_t bytes)
+{
+	unsigned int budget = pipe->buffers - pipe->nrpages;
+	unsigned int order;
+
+	if (bytes <= PAGE_SIZE || budget <= 1)
+		return 0;
+
+	order = min_t(unsigned int, ilog2(bytes >> PAGE_SHIFT),
+		      ilog2(budget));
+	return min_t(unsigned int, order, PIPE_BUF_MAX_ORDER);
+}
+
 static ssize_t
 pipe_write(struct kiocb *iocb, struct iov_iter *from)
 {
@@ -360,6 +469,7 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 	struct pipe_inode_info *pipe = filp->private_data;
 	ssize_t ret = 0;
 	int do_wakeup = 0;
+	int delay_wakeup = 0;
 	size_t total_len = iov_iter_count(from);
 	ssize_t chars;
 
@@ -382,13 +492,15 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 							(pipe->buffers - 1);
 		struct pipe_buffer *buf = pipe->bufs + lastbuf;
 		int offset = buf->offset + buf->len;
+		unsigned int capacity = PAGE_SIZE << pipe_buf_order(buf);
 
-		if (buf->ops->can_merge && offset + chars <= PAGE_SIZE) {
+		if (buf->ops->can_merge && offset + chars <= capacity) {
 			ret = pipe_buf_confirm(pipe, buf);
 			if (ret)
 				goto out;
 
-			ret = copy_page_from_iter(buf->page, offset, chars, from);
+			ret = pipe_copy_page_from_iter(buf->page, offset,
+						       chars, from);
 			if (unlikely(ret < chars)) {
 				ret = -EFAULT;
 				goto out;
@@ -410,19 +522,44 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 			break;
 		}
 		bufs = pipe->nrbufs;
-		if (bufs < pipe->buffers) {
+		if (!pipe_full(pipe)) {
 			int newbuf = (pipe->curbuf + bufs) & (pipe->buffers-1);
 			struct pipe_buffer *buf = pipe->bufs + newbuf;
 			struct page *page = pipe->tmp_page;
+			unsigned int order = 0;
+			size_t space;
 			int copied;
 
 			if (!page) {
-				page = alloc_page(GFP_HIGHUSER | __GFP_ACCOUNT);
-				if (unlikely(!page)) {
-					ret = ret ? : -ENOMEM;
-					break;
+				/*
+				 * Packetized pipes keep order-0 buffers so
+				 * that packet boundaries don't change.
+				 * Compound pages are allocated from lowmem
+				 * only, so consumers may address the whole
+				 * buffer through one kernel mapping.
+				 */
+				if (!is_packetized(filp))
+					order = pipe_write_buf_order(pipe,
+							iov_iter_count(from));
+				if (order) {
+					page = alloc_pages(GFP_USER |
+							   __GFP_ACCOUNT |
+							   __GFP_COMP |
+							   __GFP_NOWARN |
+							   __GFP_NORETRY,
+							   order);
+					if (!page)
+						order = 0;
+				}
+				if (!page) {
+					page = alloc_page(GFP_HIGHUSER |
+							  __GFP_ACCOUNT);
+					if (unlikely(!page)) {
+						ret = ret ? : -ENOMEM;
+						break;
+					}
+					pipe->tmp_page = page;
 				}
-				pipe->tmp_page = page;
 			}
 			/* Always wake up, even if the copy fails. Otherwise
 			 * we lock up (O_NONBLOCK-)readers that sleep due to
@@ -430,8 +567,11 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 			 * FIXME! Is this really true?
 			 */
 			do_wakeup = 1;
-			copied = copy_page_from_iter(page, 0, PAGE_SIZE, from);
-			if (unlikely(copied < PAGE_SIZE && iov_iter_count(from))) {
+			space = PAGE_SIZE << order;
+			copied = pipe_copy_page_from_iter(page, 0, space, from);
+			if (unlikely(copied < space && iov_iter_count(from))) {
+				if (order)
+					__free_pages(page, order);
 				if (!ret)
 					ret = -EFAULT;
 				break;
@@ -443,18 +583,20 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 			buf->ops = &anon_pipe_buf_ops;
 			buf->offset = 0;
 			buf->len = copied;
-			buf->flags = 0;
+			buf->flags = order << PIPE_BUF_ORDER_SHIFT;
 			if (is_packetized(filp)) {
 				buf->ops = &packet_pipe_buf_ops;
 				buf->flags = PIPE_BUF_FLAG_PACKET;
 			}
 			pipe->nrbufs = ++bufs;
-			pipe->tmp_page = NULL;
+			pipe->nrpages += 1U << order;
+			if (!order)
+				pipe->tmp_page = NULL;
 
 			if (!iov_iter_count(from))
 				break;
 		}
-		if (bufs < pipe->buffers)
+		if (!pipe_full(pipe))
 			continue;
 		if (filp->f_flags & O_NONBLOCK) {
 			if (!ret)
@@ -476,8 +618,25 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 		pipe->waiting_writers--;
 	}
 out:
-	__pipe_unlock(pipe);
+	/*
+	 * Below the watermark, defer the wakeup to the timer so a stream
+	 * of small writes pays for one reader wakeup instead of many. A
+	 * full pipe is always reported at once - the writer is about to
+	 * stall and needs the reader running.
+	 */
 	if (do_wakeup) {
+		unsigned int watermark = READ_ONCE(pipe_wakeup_watermark);
+
+		if (watermark && !pipe_full(pipe) &&
+		    pipe_data_len(pipe) < watermark)
+			delay_wakeup = 1;
+	}
+	__pipe_unlock(pipe);
+	if (delay_wakeup) {
+		if (!timer_pending(&pipe->wakeup_timer))
+			mod_timer(&pipe->wakeup_timer,
+				  jiffies + PIPE_WAKEUP_TIMEOUT);
+	} else if (do_wakeup) {
 		wake_up_interruptible_sync_poll(&pipe->wait, POLLIN | POLLRDNORM);
 		kill_fasync(&pipe->fasync_readers, SIGIO, POLL_IN);
 	}
@@ -493,18 +652,12 @@ out:
 static long pipe_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct pipe_inode_info *pipe = filp->private_data;
-	int count, buf, nrbufs;
+	int count;
 
 	switch (cmd) {
 		case FIONREAD:
 			__pipe_lock(pipe);
-			count = 0;
-			buf = pipe->curbuf;
-			nrbufs = pipe->nrbufs;
-			while (--nrbufs >= 0) {
-				count += pipe->bufs[buf].len;
-				buf = (buf+1) & (pipe->buffers - 1);
-			}
+			count = pipe_data_len(pipe);
 			__pipe_unlock(pipe);
 
 			return put_user(count, (int __user *)arg);
@@ -533,7 +686,7 @@ pipe_poll(struct file *filp, poll_table *wait)
 	}
 
 	if (filp->f_mode & FMODE_WRITE) {
-		mask |= (nrbufs < pipe->buffers) ? POLLOUT | POLLWRNORM : 0;
+		mask |= !pipe_full(pipe) ? POLLOUT | POLLWRNORM : 0;
 		/*
 		 * Most Unices do not set POLLERR for FIFOs but on Linux they
 		 * behave exactly like pipes for poll().
@@ -617,6 +770,14 @@ static bool too_many_pipe_buffers_hard(unsigned long user_bufs)
 	return pipe_user_pages_hard && user_bufs >= pipe_user_pages_hard;
 }
 
+static void pipe_wakeup_timer_fn(unsigned long data)
+{
+	struct pipe_inode_info *pipe = (struct pipe_inode_info *)data;
+
+	wake_up_interruptible_poll(&pipe->wait, POLLIN | POLLRDNORM);
+	kill_fasync(&pipe->fasync_readers, SIGIO, POLL_IN);
+}
+
 struct pipe_inode_info *alloc_pipe_info(void)
 {
 	struct pipe_inode_info *pipe;
@@ -650,6 +811,8 @@ struct pipe_inode_info *alloc_pipe_info(void)
 		pipe->buffers = pipe_bufs;
 		pipe->user = user;
 		mutex_init(&pipe->mutex);
+		setup_timer(&pipe->wakeup_timer, pipe_wakeup_timer_fn,
+			    (unsigned long)pipe);
 		return pipe;
 	}
 
@@ -665,6 +828,7 @@ void free_pipe_info(struct pipe_inode_info *pipe)
 {
 	int i;
 
+	del_timer_sync(&pipe->wakeup_timer);
 	(void) account_pipe_buffers(pipe->user, pipe->buffers, 0);
 	free_uid(pipe->user);
 	for (i = 0; i < pipe->buffers; i++) {
@@ -1070,9 +1234,10 @@ static long pipe_set_size(struct pipe_inode_info *pipe, unsigned long arg)
 	 * We can shrink the pipe, if arg >= pipe->nrbufs. Since we don't
 	 * expect a lot of shrink+grow operations, just free and allocate
 	 * again like we would do for growing. If the pipe currently
-	 * contains more buffers than arg, then return busy.
+	 * contains more buffers - or pages backing them - than arg, then
+	 * return busy.
 	 */
-	if (nr_pages < pipe->nrbufs) {
+	if (nr_pages < pipe->nrbufs || nr_pages < pipe->nrpages) {
 		ret = -EBUSY;
 		goto out_revert_acct;
 	}
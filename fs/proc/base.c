@@ -2889,6 +2889,10 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
 	REG("smaps",      S_IRUGO, proc_pid_smaps_operations),
 	REG("pagemap",    S_IRUSR, proc_pagemap_operations),
+	REG("vma_stats",  S_IRUSR, proc_vma_stats_operations),
+#ifdef CONFIG_IDLE_PAGE_TRACKING
+	REG("page_idle_stats", S_IRUSR, proc_page_idle_stats_operations),
+#endif
 #endif
 #ifdef CONFIG_SECURITY
 	DIR("attr",       S_IRUGO|S_IXUGO, proc_attr_dir_inode_operations, proc_attr_dir_operations),
@@ -3278,6 +3282,10 @@ static const struct pid_entry tid_base_stuff[] = {
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
 	REG("smaps",     S_IRUGO, proc_tid_smaps_operations),
 	REG("pagemap",    S_IRUSR, proc_pagemap_operations),
+	REG("vma_stats",  S_IRUSR, proc_vma_stats_operations),
+#ifdef CONFIG_IDLE_PAGE_TRACKING
+	REG("page_idle_stats", S_IRUSR, proc_page_idle_stats_operations),
+#endif
 #endif
 #ifdef CONFIG_SECURITY
 	DIR("attr",      S_IRUGO|S_IXUGO, proc_attr_dir_inode_operations, proc_attr_dir_operations),
@@ -53,6 +53,7 @@ void task_mem(struct seq_file *m, struct mm_struct *mm)
 		"VmPeak:\t%8lu kB\n"
 		"VmSize:\t%8lu kB\n"
 		"VmLck:\t%8lu kB\n"
+		"VmLckPending:\t%8lu kB\n"
 		"VmPin:\t%8lu kB\n"
 		"VmHWM:\t%8lu kB\n"
 		"VmRSS:\t%8lu kB\n"
@@ -69,6 +70,7 @@ void task_mem(struct seq_file *m, struct mm_struct *mm)
 		hiwater_vm << (PAGE_SHIFT-10),
 		total_vm << (PAGE_SHIFT-10),
 		mm->locked_vm << (PAGE_SHIFT-10),
+		(unsigned long)atomic_long_read(&mm->mlock_pending) << (PAGE_SHIFT-10),
 		mm->pinned_vm << (PAGE_SHIFT-10),
 		hiwater_rss << (PAGE_SHIFT-10),
 		total_rss << (PAGE_SHIFT-10),
@@ -716,20 +718,20 @@ void __weak arch_show_smap(struct seq_file *m, struct vm_area_struct *vma)
 {
 }
 
-static int show_smap(struct seq_file *m, void *v, int is_pid)
+/* Gather the per-vma counters, caller must hold mmap_sem for read */
+static void smap_gather_stats(struct vm_area_struct *vma,
+			      struct mem_size_stats *mss)
 {
-	struct vm_area_struct *vma = v;
-	struct mem_size_stats mss;
 	struct mm_walk smaps_walk = {
 		.pmd_entry = smaps_pte_range,
 #ifdef CONFIG_HUGETLB_PAGE
 		.hugetlb_entry = smaps_hugetlb_range,
 #endif
 		.mm = vma->vm_mm,
-		.private = &mss,
+		.private = mss,
 	};
 
-	memset(&mss, 0, sizeof mss);
+	memset(mss, 0, sizeof(*mss));
 
 #ifdef CONFIG_SHMEM
 	if (vma->vm_file && shmem_mapping(vma->vm_file->f_mapping)) {
@@ -747,16 +749,24 @@ static int show_smap(struct seq_file *m, void *v, int is_pid)
 
 		if (!shmem_swapped || (vma->vm_flags & VM_SHARED) ||
 					!(vma->vm_flags & VM_WRITE)) {
-			mss.swap = shmem_swapped;
+			mss->swap = shmem_swapped;
 		} else {
-			mss.check_shmem_swap = true;
+			mss->check_shmem_swap = true;
 			smaps_walk.pte_hole = smaps_pte_hole;
 		}
 	}
 #endif
 
-	/* mmap_sem is held in m_start */
 	walk_page_vma(vma, &smaps_walk);
+}
+
+static int show_smap(struct seq_file *m, void *v, int is_pid)
+{
+	struct vm_area_struct *vma = v;
+	struct mem_size_stats mss;
+
+	/* mmap_sem is held in m_start */
+	smap_gather_stats(vma, &mss);
 
 	show_map_vma(m, vma, is_pid);
 
@@ -799,6 +809,15 @@ static int show_smap(struct seq_file *m, void *v, int is_pid)
 		   (vma->vm_flags & VM_LOCKED) ?
 			(unsigned long)(mss.pss >> (10 + PSS_SHIFT)) : 0);
 
+	/* Adaptive fault-around state, shared by all vmas of the mm */
+	seq_printf(m,
+		   "FaultAround:    %8lu kB\n"
+		   "FaultAroundHits:    %8lu\n"
+		   "FaultAroundMisses:  %8lu\n",
+		   READ_ONCE(vma->vm_mm->fault_around_bytes) >> 10,
+		   vma->vm_mm->fault_around_hits,
+		   vma->vm_mm->fault_around_misses);
+
 	arch_show_smap(m, vma);
 	show_smap_vma_flags(m, vma);
 	m_cache_vma(m, vma);
@@ -1465,6 +1484,216 @@ const struct file_operations proc_pagemap_operations = {
 	.open		= pagemap_open,
 	.release	= pagemap_release,
 };
+
+/*
+ * /proc/pid/vma_stats.  A binary alternative to /proc/pid/smaps for bulk
+ * introspection: the file is an array of fixed-size records, one per vma
+ * in address order, and each read() fills as many records as fit in the
+ * user buffer under a single mmap_sem acquisition.  The file position is
+ * the byte offset into the record array; reads and seeks must be record
+ * aligned.  All sizes are in bytes, pss and swap_pss are already scaled
+ * down from their fixed-point representation.
+ */
+struct vma_stats_entry {
+	__u64 start;		/* vma start address */
+	__u64 end;		/* vma end address */
+	__u64 flags;		/* VM_* flags */
+	__u64 resident;
+	__u64 pss;
+	__u64 anonymous;
+	__u64 swap;
+	__u64 swap_pss;
+};
+
+#define VMA_STATS_BATCH	512
+
+static ssize_t vma_stats_read(struct file *file, char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct mm_struct *mm = file->private_data;
+	struct vma_stats_entry *kbuf;
+	struct vm_area_struct *vma;
+	struct mem_size_stats mss;
+	unsigned long skip;
+	ssize_t ret = 0;
+	size_t len;
+	int nr, i = 0;
+
+	if (!mm || !atomic_inc_not_zero(&mm->mm_users))
+		goto out;
+
+	ret = -EINVAL;
+	/* file position must be aligned */
+	if ((*ppos % sizeof(*kbuf)) || (count % sizeof(*kbuf)))
+		goto out_mm;
+
+	ret = 0;
+	if (!count)
+		goto out_mm;
+
+	nr = min_t(size_t, count / sizeof(*kbuf), VMA_STATS_BATCH);
+	kbuf = kmalloc_array(nr, sizeof(*kbuf), GFP_TEMPORARY);
+	ret = -ENOMEM;
+	if (!kbuf)
+		goto out_mm;
+
+	/*
+	 * Unlike smaps, which re-acquires mmap_sem for every seq_file
+	 * chunk, the whole batch is gathered under one read hold so a
+	 * full scan perturbs the target as little as possible.  The
+	 * copy out happens after the lock is dropped.
+	 */
+	down_read(&mm->mmap_sem);
+	vma = mm->mmap;
+	for (skip = *ppos / sizeof(*kbuf); vma && skip; skip--)
+		vma = vma->vm_next;
+	for (; vma && i < nr; vma = vma->vm_next, i++) {
+		smap_gather_stats(vma, &mss);
+
+		kbuf[i].start = vma->vm_start;
+		kbuf[i].end = vma->vm_end;
+		kbuf[i].flags = vma->vm_flags;
+		kbuf[i].resident = mss.resident;
+		kbuf[i].pss = mss.pss >> PSS_SHIFT;
+		kbuf[i].anonymous = mss.anonymous;
+		kbuf[i].swap = mss.swap;
+		kbuf[i].swap_pss = mss.swap_pss >> PSS_SHIFT;
+		cond_resched();
+	}
+	up_read(&mm->mmap_sem);
+
+	len = i * sizeof(*kbuf);
+	if (len && copy_to_user(buf, kbuf, len)) {
+		ret = -EFAULT;
+	} else {
+		*ppos += len;
+		ret = len;
+	}
+	kfree(kbuf);
+out_mm:
+	mmput(mm);
+out:
+	return ret;
+}
+
+const struct file_operations proc_vma_stats_operations = {
+	.llseek		= mem_lseek, /* borrow this */
+	.read		= vma_stats_read,
+	.open		= pagemap_open,
+	.release	= pagemap_release,
+};
+
+#ifdef CONFIG_IDLE_PAGE_TRACKING
+/*
+ * Aggregated idle page statistics, one line per VMA:
+ *
+ *	<start>-<end> present <n> young <n> idle <n>
+ *
+ * A page counts as idle when it is still marked idle in the page_idle
+ * bitmap and neither the page nor the pte mapping it carries a young
+ * bit; anything else counts as young.  This gives cold-memory scanners
+ * their per-VMA totals in a single read, without streaming the pfn
+ * bitmap and pagemap through userspace, and without consuming the
+ * accessed bits that the next bitmap scan will harvest.
+ */
+struct idle_stats {
+	unsigned long present;
+	unsigned long young;
+	unsigned long idle;
+};
+
+static int idle_stats_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct idle_stats *is = walk->private;
+	struct vm_area_struct *vma = walk->vma;
+	pte_t *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+
+	ptl = pmd_trans_huge_lock(pmd, vma);
+	if (ptl) {
+		if (pmd_present(*pmd)) {
+			unsigned long nr = (end - addr) >> PAGE_SHIFT;
+
+			page = pmd_page(*pmd);
+			is->present += nr;
+			if (pmd_young(*pmd) || page_is_young(page) ||
+			    !page_is_idle(page))
+				is->young += nr;
+			else
+				is->idle += nr;
+		}
+		spin_unlock(ptl);
+		return 0;
+	}
+
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	pte = pte_offset_map_lock(pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+		is->present++;
+		page = compound_head(page);
+		if (pte_young(ptent) || page_is_young(page) ||
+		    !page_is_idle(page))
+			is->young++;
+		else
+			is->idle++;
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+	cond_resched();
+	return 0;
+}
+
+static int show_page_idle_stats(struct seq_file *m, void *v)
+{
+	struct vm_area_struct *vma = v;
+	struct idle_stats is;
+	struct mm_walk idle_stats_walk = {
+		.pmd_entry = idle_stats_pte_range,
+		.mm = vma->vm_mm,
+		.private = &is,
+	};
+
+	memset(&is, 0, sizeof is);
+
+	/* mmap_sem is held in m_start; hugetlb pages are never idle-tracked */
+	if (!is_vm_hugetlb_page(vma))
+		walk_page_vma(vma, &idle_stats_walk);
+
+	seq_printf(m, "%08lx-%08lx present %lu young %lu idle %lu\n",
+		   vma->vm_start, vma->vm_end,
+		   is.present, is.young, is.idle);
+	m_cache_vma(m, vma);
+	return 0;
+}
+
+static const struct seq_operations proc_page_idle_stats_op = {
+	.start	= m_start,
+	.next	= m_next,
+	.stop	= m_stop,
+	.show	= show_page_idle_stats
+};
+
+static int page_idle_stats_open(struct inode *inode, struct file *file)
+{
+	return do_maps_open(inode, file, &proc_page_idle_stats_op);
+}
+
+const struct file_operations proc_page_idle_stats_operations = {
+	.open		= page_idle_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= proc_map_release,
+};
+#endif /* CONFIG_IDLE_PAGE_TRACKING */
 #endif /* CONFIG_PROC_PAGE_MONITOR */
 
 #ifdef CONFIG_NUMA
@@ -1502,14 +1502,65 @@ COMPAT_SYSCALL_DEFINE4(sendfile64, int, out_fd, int, in_fd,
 }
 #endif
 
+/* Bounce buffer size for the buffered copy fallback */
+#define COPY_RANGE_BUF_SIZE	(1 << 16)
+
+/*
+ * Fallback for filesystems with neither clone nor copy offload: copy
+ * through the page cache with a kernel bounce buffer, moving 64K per
+ * cycle instead of pushing single pages through the splice machinery.
+ */
+static ssize_t copy_file_range_buffered(struct file *file_in, loff_t pos_in,
+					struct file *file_out, loff_t pos_out,
+					size_t len)
+{
+	size_t buf_len = min_t(size_t, len, COPY_RANGE_BUF_SIZE);
+	ssize_t copied = 0;
+	ssize_t ret = 0;
+	char *buf;
+
+	buf = kmalloc(buf_len, GFP_KERNEL | __GFP_NOWARN);
+	if (!buf) {
+		buf_len = PAGE_SIZE;
+		buf = kmalloc(buf_len, GFP_KERNEL);
+		if (!buf)
+			return -ENOMEM;
+	}
+
+	while (len) {
+		size_t chunk = min_t(size_t, len, buf_len);
+		ssize_t n;
+
+		n = kernel_read(file_in, pos_in, buf, chunk);
+		if (n <= 0) {
+			ret = n;
+			break;
+		}
+		n = kernel_write(file_out, buf, n, pos_out);
+		if (n <= 0) {
+			ret = n;
+			break;
+		}
+		pos_in += n;
+		pos_out += n;
+		copied += n;
+		len -= n;
+		cond_resched();
+	}
+
+	kfree(buf);
+	return copied ? copied : ret;
+}
+
 /*
  * copy_file_range() differs from regular file read and write in that it
  * specifically allows return partial success.  When it does so is up to
  * the copy_file_range method.
  */
-ssize_t vfs_copy_file_range(struct file *file_in, loff_t pos_in,
-			    struct file *file_out, loff_t pos_out,
-			    size_t len, unsigned int flags)
+static ssize_t do_copy_file_range(struct file *file_in, loff_t pos_in,
+				  struct file *file_out, loff_t pos_out,
+				  size_t len, unsigned int flags,
+				  bool buffered)
 {
 	struct inode *inode_in = file_inode(file_in);
 	struct inode *inode_out = file_inode(file_out);
@@ -1560,8 +1611,12 @@ ssize_t vfs_copy_file_range(struct file *file_in, loff_t pos_in,
 			goto done;
 	}
 
-	ret = do_splice_direct(file_in, &pos_in, file_out, &pos_out,
-			len > MAX_RW_COUNT ? MAX_RW_COUNT : len, 0);
+	if (buffered)
+		ret = copy_file_range_buffered(file_in, pos_in, file_out,
+					       pos_out, len);
+	else
+		ret = do_splice_direct(file_in, &pos_in, file_out, &pos_out,
+				len > MAX_RW_COUNT ? MAX_RW_COUNT : len, 0);
 
 done:
 	if (ret > 0) {
@@ -1578,6 +1633,14 @@ done:
 
 	return ret;
 }
+
+ssize_t vfs_copy_file_range(struct file *file_in, loff_t pos_in,
+			    struct file *file_out, loff_t pos_out,
+			    size_t len, unsigned int flags)
+{
+	return do_copy_file_range(file_in, pos_in, file_out, pos_out, len,
+				  flags, false);
+}
 EXPORT_SYMBOL(vfs_copy_file_range);
 
 SYSCALL_DEFINE6(copy_file_range, int, fd_in, loff_t __user *, off_in,
@@ -1642,6 +1705,108 @@ out2:
 	return ret;
 }
 
+/*
+ * Descriptor for copy_file_range_batch(). Offsets are always explicit;
+ * the file positions of the descriptors' fds are neither read nor
+ * updated. The kernel fills in ->copied for every descriptor it
+ * processes.
+ */
+struct copy_range_desc {
+	__s32 fd_in;
+	__s32 fd_out;
+	__u64 off_in;
+	__u64 off_out;
+	__u64 len;
+	__u64 copied;		/* out: bytes actually copied */
+	__u32 flags;		/* must be 0 */
+	__u32 reserved;		/* must be 0 */
+};
+
+/*
+ * Process an array of copy descriptors in one syscall. Each range goes
+ * through the usual offload chain - clone_file_range, then
+ * copy_file_range - but falls back to a buffered in-kernel copy rather
+ * than the page-at-a-time splice path, and consecutive descriptors
+ * naming the same fds share one fdget. Returns the number of
+ * descriptors fully processed, or an error if the first one fails.
+ * Processing stops early on an error or a short copy; userspace can
+ * pick up from the first descriptor whose ->copied is short.
+ */
+SYSCALL_DEFINE3(copy_file_range_batch, struct copy_range_desc __user *, udescs,
+		unsigned int, nr, unsigned int, flags)
+{
+	struct fd f_in = { NULL };
+	struct fd f_out = { NULL };
+	int last_fd_in = -1;
+	int last_fd_out = -1;
+	ssize_t ret = 0;
+	unsigned int i = 0;
+
+	if (flags)
+		return -EINVAL;
+
+	if (unlikely(nr > LONG_MAX / sizeof(*udescs)))
+		nr = LONG_MAX / sizeof(*udescs);
+
+	while (i < nr) {
+		struct copy_range_desc desc;
+		ssize_t copied;
+
+		if (copy_from_user(&desc, &udescs[i], sizeof(desc))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (desc.flags || desc.reserved ||
+		    desc.len != (size_t)desc.len) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (desc.fd_in != last_fd_in) {
+			if (last_fd_in >= 0)
+				fdput(f_in);
+			f_in = fdget(desc.fd_in);
+			last_fd_in = desc.fd_in;
+		}
+		if (desc.fd_out != last_fd_out) {
+			if (last_fd_out >= 0)
+				fdput(f_out);
+			f_out = fdget(desc.fd_out);
+			last_fd_out = desc.fd_out;
+		}
+		if (!f_in.file || !f_out.file) {
+			ret = -EBADF;
+			break;
+		}
+
+		copied = do_copy_file_range(f_in.file, desc.off_in,
+					    f_out.file, desc.off_out,
+					    desc.len, 0, true);
+		if (copied < 0) {
+			ret = copied;
+			break;
+		}
+
+		desc.copied = copied;
+		if (put_user(desc.copied, &udescs[i].copied)) {
+			ret = -EFAULT;
+			break;
+		}
+		i++;
+
+		if ((u64)copied < desc.len)
+			break;
+	}
+
+	if (last_fd_in >= 0)
+		fdput(f_in);
+	if (last_fd_out >= 0)
+		fdput(f_out);
+
+	return i ? i : ret;
+}
+
 static int clone_verify_area(struct file *file, loff_t pos, u64 len, bool write)
 {
 	struct inode *inode = file_inode(file);
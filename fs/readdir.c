@@ -18,6 +18,9 @@
 #include <linux/security.h>
 #include <linux/syscalls.h>
 #include <linux/unistd.h>
+#include <linux/namei.h>
+#include <linux/slab.h>
+#include <linux/cred.h>
 
 #include <linux/uaccess.h>
 
@@ -324,3 +327,228 @@ SYSCALL_DEFINE3(getdents64, unsigned int, fd,
 	fdput_pos(f);
 	return error;
 }
+
+/*
+ * getdents_plus: like getdents64, but every record also carries the
+ * attributes of the entry, gathered with a single lookup while the
+ * dentries are still hot. A metadata scan then pays one syscall and
+ * one dcache walk per directory chunk instead of one stat and one cold
+ * walk per name.
+ *
+ * Lookups cannot run under the directory's i_rwsem that iterate_dir()
+ * holds, so names are collected into a kernel buffer during iteration
+ * and the attributes are filled in immediately afterwards. dp_valid is
+ * clear when an entry went away before it could be looked up (or for
+ * "..", which is never looked up).
+ */
+
+struct linux_dirent_plus {
+	__u64		dp_ino;
+	__s64		dp_off;
+	__u16		dp_reclen;
+	__u8		dp_type;
+	__u8		dp_pad;
+	__u32		dp_valid;	/* attribute fields are valid */
+	__u32		dp_mode;
+	__u32		dp_nlink;
+	__u32		dp_uid;
+	__u32		dp_gid;
+	__u64		dp_size;
+	__u64		dp_blocks;
+	__s64		dp_atime;
+	__s64		dp_mtime;
+	__s64		dp_ctime;
+	__u32		dp_atime_nsec;
+	__u32		dp_mtime_nsec;
+	__u32		dp_ctime_nsec;
+	__u32		dp_blksize;
+	char		dp_name[0];
+};
+
+/* One collected name in the kernel-side buffer */
+struct dirent_plus_rec {
+	u64		ino;
+	s64		off;
+	unsigned short	namelen;
+	unsigned char	type;
+	char		name[];
+};
+
+struct getdents_plus_callback {
+	struct dir_context ctx;
+	char *buf;		/* collected records */
+	unsigned int used;	/* bytes of buf in use */
+	unsigned int size;	/* size of buf */
+	unsigned int ucount;	/* user buffer bytes still available */
+	struct dirent_plus_rec *prev;	/* to patch ->off, like d_off */
+	int error;
+};
+
+static unsigned int dirent_plus_ureclen(unsigned int namelen)
+{
+	return ALIGN(offsetof(struct linux_dirent_plus, dp_name) + namelen + 1,
+		     sizeof(u64));
+}
+
+static int filldir_plus(struct dir_context *ctx, const char *name, int namlen,
+			loff_t offset, u64 ino, unsigned int d_type)
+{
+	struct getdents_plus_callback *buf =
+		container_of(ctx, struct getdents_plus_callback, ctx);
+	unsigned int krec = ALIGN(sizeof(struct dirent_plus_rec) + namlen,
+				  sizeof(u64));
+	struct dirent_plus_rec *rec;
+
+	buf->error = -EINVAL;	/* only used if we fail.. */
+	/*
+	 * Stop once either buffer is exhausted; every collected name is
+	 * guaranteed to fit the user buffer, so f_pos never runs ahead
+	 * of what is returned.
+	 */
+	if (krec > buf->size - buf->used ||
+	    dirent_plus_ureclen(namlen) > buf->ucount)
+		return -EINVAL;
+	if (buf->prev && signal_pending(current))
+		return -EINTR;
+
+	rec = (struct dirent_plus_rec *)(buf->buf + buf->used);
+	rec->ino = ino;
+	rec->off = 0;
+	rec->namelen = namlen;
+	rec->type = d_type;
+	memcpy(rec->name, name, namlen);
+	if (buf->prev)
+		buf->prev->off = offset;
+	buf->prev = rec;
+	buf->used += krec;
+	buf->ucount -= dirent_plus_ureclen(namlen);
+	return 0;
+}
+
+static void dirent_plus_fill_stat(struct linux_dirent_plus *dp,
+				  struct kstat *stat)
+{
+	dp->dp_valid = 1;
+	dp->dp_mode = stat->mode;
+	dp->dp_nlink = stat->nlink;
+	dp->dp_uid = from_kuid_munged(current_user_ns(), stat->uid);
+	dp->dp_gid = from_kgid_munged(current_user_ns(), stat->gid);
+	dp->dp_size = stat->size;
+	dp->dp_blocks = stat->blocks;
+	dp->dp_atime = stat->atime.tv_sec;
+	dp->dp_mtime = stat->mtime.tv_sec;
+	dp->dp_ctime = stat->ctime.tv_sec;
+	dp->dp_atime_nsec = stat->atime.tv_nsec;
+	dp->dp_mtime_nsec = stat->mtime.tv_nsec;
+	dp->dp_ctime_nsec = stat->ctime.tv_nsec;
+	dp->dp_blksize = stat->blksize;
+}
+
+static long getdents_plus_emit(struct file *file,
+			       struct getdents_plus_callback *buf,
+			       struct linux_dirent_plus __user *udir,
+			       loff_t orig_pos)
+{
+	struct dentry *dir = file->f_path.dentry;
+	unsigned int off = 0;
+	long copied = 0;
+	loff_t resume = orig_pos;
+
+	while (off < buf->used) {
+		struct dirent_plus_rec *rec = (void *)(buf->buf + off);
+		unsigned int urec = dirent_plus_ureclen(rec->namelen);
+		struct linux_dirent_plus dp;
+		struct kstat stat;
+
+		memset(&dp, 0, sizeof(dp));
+		dp.dp_ino = rec->ino;
+		dp.dp_off = rec->off;
+		dp.dp_reclen = urec;
+		dp.dp_type = rec->type;
+
+		if (rec->namelen == 1 && rec->name[0] == '.') {
+			if (!vfs_getattr(&file->f_path, &stat))
+				dirent_plus_fill_stat(&dp, &stat);
+		} else if (rec->namelen == 2 && rec->name[0] == '.' &&
+			   rec->name[1] == '.') {
+			/* leave dp_valid clear */
+		} else {
+			struct dentry *dentry;
+
+			dentry = lookup_one_len_unlocked(rec->name, dir,
+							 rec->namelen);
+			if (!IS_ERR(dentry)) {
+				if (d_really_is_positive(dentry)) {
+					struct path path = {
+						.mnt = file->f_path.mnt,
+						.dentry = dentry,
+					};
+
+					if (!vfs_getattr(&path, &stat))
+						dirent_plus_fill_stat(&dp,
+								      &stat);
+				}
+				dput(dentry);
+			}
+		}
+
+		if (copy_to_user(udir, &dp,
+				 offsetof(struct linux_dirent_plus, dp_name)) ||
+		    copy_to_user(udir->dp_name, rec->name, rec->namelen) ||
+		    put_user(0, udir->dp_name + rec->namelen)) {
+			/* rewind to the first entry we failed to return */
+			file->f_pos = resume;
+			return copied ? copied : -EFAULT;
+		}
+
+		resume = rec->off;
+		copied += urec;
+		udir = (void __user *)udir + urec;
+		off += ALIGN(sizeof(struct dirent_plus_rec) + rec->namelen,
+			     sizeof(u64));
+	}
+	return copied;
+}
+
+SYSCALL_DEFINE3(getdents_plus, unsigned int, fd,
+		struct linux_dirent_plus __user *, dirent, unsigned int, count)
+{
+	struct fd f;
+	struct getdents_plus_callback buf = {
+		.ctx.actor = filldir_plus,
+		.ucount = count,
+	};
+	loff_t orig_pos;
+	long error;
+
+	if (!access_ok(VERIFY_WRITE, dirent, count))
+		return -EFAULT;
+
+	buf.size = min_t(unsigned int, count, 1 << 16);
+	buf.buf = kmalloc(buf.size, GFP_KERNEL | __GFP_NOWARN);
+	if (!buf.buf && buf.size > PAGE_SIZE) {
+		buf.size = PAGE_SIZE;
+		buf.buf = kmalloc(buf.size, GFP_KERNEL);
+	}
+	if (!buf.buf)
+		return -ENOMEM;
+
+	f = fdget_pos(fd);
+	if (!f.file) {
+		kfree(buf.buf);
+		return -EBADF;
+	}
+
+	orig_pos = f.file->f_pos;
+	error = iterate_dir(f.file, &buf.ctx);
+	if (buf.prev)
+		buf.prev->off = buf.ctx.pos;
+	if (buf.used)
+		error = getdents_plus_emit(f.file, &buf, dirent, orig_pos);
+	else if (error >= 0)
+		error = buf.error;
+
+	fdput_pos(f);
+	kfree(buf.buf);
+	return error;
+}
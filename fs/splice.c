@@ -195,7 +195,7 @@ ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
 		goto out;
 	}
 
-	while (pipe->nrbufs < pipe->buffers) {
+	while (!pipe_full(pipe)) {
 		int newbuf = (pipe->curbuf + pipe->nrbufs) & (pipe->buffers - 1);
 		struct pipe_buffer *buf = pipe->bufs + newbuf;
 
@@ -207,6 +207,7 @@ ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
 		buf->flags = 0;
 
 		pipe->nrbufs++;
+		pipe->nrpages += pipe_buf_pages(buf);
 		page_nr++;
 		ret += buf->len;
 
@@ -232,12 +233,13 @@ ssize_t add_to_pipe(struct pipe_inode_info *pipe, struct pipe_buffer *buf)
 	if (unlikely(!pipe->readers)) {
 		send_sig(SIGPIPE, current, 0);
 		ret = -EPIPE;
-	} else if (pipe->nrbufs == pipe->buffers) {
+	} else if (pipe_full(pipe)) {
 		ret = -EAGAIN;
 	} else {
 		int newbuf = (pipe->curbuf + pipe->nrbufs) & (pipe->buffers - 1);
 		pipe->bufs[newbuf] = *buf;
 		pipe->nrbufs++;
+		pipe->nrpages += pipe_buf_pages(buf);
 		return buf->len;
 	}
 	pipe_buf_release(pipe, buf);
@@ -395,7 +397,7 @@ static ssize_t default_file_splice_read(struct file *in, loff_t *ppos,
 	ssize_t res;
 	int i;
 
-	if (pipe->nrbufs == pipe->buffers)
+	if (pipe_full(pipe))
 		return -EAGAIN;
 
 	/*
@@ -532,6 +534,7 @@ static int splice_from_pipe_feed(struct pipe_inode_info *pipe, struct splice_des
 		sd->total_len -= ret;
 
 		if (!buf->len) {
+			pipe->nrpages -= pipe_buf_pages(buf);
 			pipe_buf_release(pipe, buf);
 			pipe->curbuf = (pipe->curbuf + 1) & (pipe->buffers - 1);
 			pipe->nrbufs--;
@@ -780,6 +783,7 @@ iter_file_splice_write(struct pipe_inode_info *pipe, struct file *out,
 			if (ret >= buf->len) {
 				ret -= buf->len;
 				buf->len = 0;
+				pipe->nrpages -= pipe_buf_pages(buf);
 				pipe_buf_release(pipe, buf);
 				pipe->curbuf = (pipe->curbuf + 1) & (pipe->buffers - 1);
 				pipe->nrbufs--;
@@ -1093,7 +1097,7 @@ static int wait_for_space(struct pipe_inode_info *pipe, unsigned flags)
 			send_sig(SIGPIPE, current, 0);
 			return -EPIPE;
 		}
-		if (pipe->nrbufs != pipe->buffers)
+		if (!pipe_full(pipe))
 			return 0;
 		if (flags & SPLICE_F_NONBLOCK)
 			return -EAGAIN;
@@ -1475,13 +1479,13 @@ static int opipe_prep(struct pipe_inode_info *pipe, unsigned int flags)
 	 * Check ->nrbufs without the inode lock first. This function
 	 * is speculative anyways, so missing one is ok.
 	 */
-	if (pipe->nrbufs < pipe->buffers)
+	if (!pipe_full(pipe))
 		return 0;
 
 	ret = 0;
 	pipe_lock(pipe);
 
-	while (pipe->nrbufs >= pipe->buffers) {
+	while (pipe_full(pipe)) {
 		if (!pipe->readers) {
 			send_sig(SIGPIPE, current, 0);
 			ret = -EPIPE;
@@ -1547,7 +1551,7 @@ retry:
 		 * Cannot make any progress, because either the input
 		 * pipe is empty or the output pipe is full.
 		 */
-		if (!ipipe->nrbufs || opipe->nrbufs >= opipe->buffers) {
+		if (!ipipe->nrbufs || pipe_full(opipe)) {
 			/* Already processed some buffers, break */
 			if (ret)
 				break;
@@ -1578,8 +1582,10 @@ retry:
 			*obuf = *ibuf;
 			ibuf->ops = NULL;
 			opipe->nrbufs++;
+			opipe->nrpages += pipe_buf_pages(obuf);
 			ipipe->curbuf = (ipipe->curbuf + 1) & (ipipe->buffers - 1);
 			ipipe->nrbufs--;
+			ipipe->nrpages -= pipe_buf_pages(obuf);
 			input_wakeup = true;
 		} else {
 			/*
@@ -1597,6 +1603,7 @@ retry:
 
 			obuf->len = len;
 			opipe->nrbufs++;
+			opipe->nrpages += pipe_buf_pages(obuf);
 			ibuf->offset += obuf->len;
 			ibuf->len -= obuf->len;
 		}
@@ -1648,7 +1655,7 @@ static int link_pipe(struct pipe_inode_info *ipipe,
 		 * If we have iterated all input buffers or ran out of
 		 * output room, break.
 		 */
-		if (i >= ipipe->nrbufs || opipe->nrbufs >= opipe->buffers)
+		if (i >= ipipe->nrbufs || pipe_full(opipe))
 			break;
 
 		ibuf = ipipe->bufs + ((ipipe->curbuf + i) & (ipipe->buffers-1));
@@ -1673,6 +1680,7 @@ static int link_pipe(struct pipe_inode_info *ipipe,
 			obuf->len = len;
 
 		opipe->nrbufs++;
+		opipe->nrpages += pipe_buf_pages(obuf);
 		ret += obuf->len;
 		len -= obuf->len;
 		i++;
@@ -46,6 +46,115 @@ static char *sb_writers_name[SB_FREEZE_LEVELS] = {
 	"sb_internal",
 };
 
+/*
+ * A scan chunk handed to one worker when a large shrink of a superblock
+ * is fanned out. Chunk size matches the historic shrinker batch, so a
+ * worker holds each per-node lru lock no longer than a scan used to.
+ */
+#define SUPER_PRUNE_BATCH	1024
+#define SUPER_PRUNE_MAX_WORKERS	4
+
+/*
+ * Pool for fanned-out prune work. WQ_MEM_RECLAIM guarantees forward
+ * progress when the fan-out happens from direct reclaim.
+ */
+static struct workqueue_struct *sb_prune_wq __read_mostly;
+
+static int __init sb_prune_init(void)
+{
+	sb_prune_wq = alloc_workqueue("sb_prune",
+				      WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	return sb_prune_wq ? 0 : -ENOMEM;
+}
+subsys_initcall(sb_prune_init);
+
+struct super_prune_work {
+	struct work_struct work;
+	struct super_block *sb;
+	struct shrink_control sc;
+	long dentries;
+	long inodes;
+	long freed;
+};
+
+static void super_prune_workfn(struct work_struct *work)
+{
+	struct super_prune_work *spw = container_of(work,
+					struct super_prune_work, work);
+	struct shrink_control *sc = &spw->sc;
+
+	sc->nr_to_scan = spw->dentries + 1;
+	spw->freed = prune_dcache_sb(spw->sb, sc);
+	sc->nr_to_scan = spw->inodes + 1;
+	spw->freed += prune_icache_sb(spw->sb, sc);
+}
+
+/*
+ * Fan a large prune out across the unbound workqueue pool. The
+ * expensive part of eviction - killing the isolated dentries and
+ * inodes - then runs on several CPUs; only the brief list_lru
+ * isolation passes serialise on the per-node lru lock. The caller
+ * holds sb->s_umount, which pins the superblock for the workers.
+ *
+ * Returns the number of objects freed, or a negative errno if the
+ * fan-out could not be set up and the caller should prune directly.
+ */
+static long super_prune_parallel(struct super_block *sb,
+				 struct shrink_control *sc,
+				 long dentries, long inodes)
+{
+	struct super_prune_work *works;
+	long freed = 0;
+	int nr_workers;
+	int i;
+
+	/*
+	 * A prune worker can re-enter direct reclaim (inode eviction
+	 * starts journal transactions which allocate) and end up here
+	 * again.  Fanning out from a worker - worst case from the
+	 * rescuer, the only context guaranteed to run under memory
+	 * exhaustion - would block flush_work() on items queued behind
+	 * itself on sb_prune_wq: a reclaim deadlock.  No workqueue
+	 * context may wait on this pool, so prune directly from all of
+	 * them.
+	 */
+	if (current->flags & PF_WQ_WORKER)
+		return -EAGAIN;
+
+	nr_workers = min_t(long, (dentries + inodes) / SUPER_PRUNE_BATCH,
+			   SUPER_PRUNE_MAX_WORKERS);
+	if (!sb_prune_wq || nr_workers < 2)
+		return -EAGAIN;
+
+	works = kcalloc(nr_workers, sizeof(*works),
+			GFP_NOWAIT | __GFP_NOWARN);
+	if (!works)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_workers; i++) {
+		struct super_prune_work *spw = works + i;
+
+		INIT_WORK(&spw->work, super_prune_workfn);
+		spw->sb = sb;
+		spw->sc = *sc;
+		spw->dentries = dentries / nr_workers;
+		spw->inodes = inodes / nr_workers;
+		if (i == nr_workers - 1) {
+			spw->dentries += dentries % nr_workers;
+			spw->inodes += inodes % nr_workers;
+		}
+		queue_work(sb_prune_wq, &spw->work);
+	}
+
+	for (i = 0; i < nr_workers; i++) {
+		flush_work(&works[i].work);
+		freed += works[i].freed;
+	}
+
+	kfree(works);
+	return freed;
+}
+
 /*
  * One thing we have to be careful of with a per-sb shrinker is that we don't
  * drop the last active reference to the superblock from within the shrinker.
@@ -96,10 +205,15 @@ static unsigned long super_cache_scan(struct shrinker *shrink,
 	 * Ensure that we always scan at least one object - memcg kmem
 	 * accounting uses this to fully empty the caches.
 	 */
-	sc->nr_to_scan = dentries + 1;
-	freed = prune_dcache_sb(sb, sc);
-	sc->nr_to_scan = inodes + 1;
-	freed += prune_icache_sb(sb, sc);
+	freed = -EAGAIN;
+	if (dentries + inodes > 2 * SUPER_PRUNE_BATCH)
+		freed = super_prune_parallel(sb, sc, dentries, inodes);
+	if (freed < 0) {
+		sc->nr_to_scan = dentries + 1;
+		freed = prune_dcache_sb(sb, sc);
+		sc->nr_to_scan = inodes + 1;
+		freed += prune_icache_sb(sb, sc);
+	}
 
 	if (fs_objects) {
 		sc->nr_to_scan = fs_objects + 1;
@@ -252,7 +366,11 @@ static struct super_block *alloc_super(struct file_system_type *type, int flags,
 	s->s_shrink.seeks = DEFAULT_SEEKS;
 	s->s_shrink.scan_objects = super_cache_scan;
 	s->s_shrink.count_objects = super_cache_count;
-	s->s_shrink.batch = 1024;
+	/*
+	 * Hand the shrinker several worker batches per call; scans large
+	 * enough are fanned out across CPUs by super_cache_scan().
+	 */
+	s->s_shrink.batch = SUPER_PRUNE_BATCH * SUPER_PRUNE_MAX_WORKERS;
 	s->s_shrink.flags = SHRINKER_NUMA_AWARE | SHRINKER_MEMCG_AWARE;
 	return s;
 
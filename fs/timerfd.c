@@ -201,7 +201,12 @@ static int timerfd_setup(struct timerfd_ctx *ctx, int flags,
 			else
 				alarm_start_relative(&ctx->t.alarm, texp);
 		} else {
-			hrtimer_start(&ctx->t.tmr, texp, htmode);
+			u64 slack = 0;
+
+			if ((flags & TFD_TIMER_SLACK) && !rt_task(current))
+				slack = current->timer_slack_ns;
+			hrtimer_start_range_ns(&ctx->t.tmr, texp, slack,
+					       htmode);
 		}
 
 		if (timerfd_canceled(ctx))
@@ -86,6 +86,14 @@ struct mmu_gather_batch {
  */
 #define MAX_GATHER_BATCH_COUNT	(10000UL/MAX_GATHER_BATCH)
 
+/*
+ * Number of exact page addresses remembered per mmu_gather. Sized so
+ * that a sparse zap can be flushed with single page invalidations on
+ * architectures that support them; once exceeded we fall back to the
+ * usual start/end range flush.
+ */
+#define MMU_GATHER_ADDRS	32
+
 /* struct mmu_gather is an opaque type used by the mm code for passing around
  * any data needed by arch specific code for tlb_remove_page.
  */
@@ -96,6 +104,9 @@ struct mmu_gather {
 #endif
 	unsigned long		start;
 	unsigned long		end;
+	/* exact addresses of the flushed ptes, valid unless overflowed */
+	unsigned int		nr_addrs;
+	unsigned long		addrs[MMU_GATHER_ADDRS];
 	/* we are in the middle of an operation to clear
 	 * a full mm and can make some optimizations */
 	unsigned int		fullmm : 1,
@@ -119,12 +130,32 @@ void tlb_finish_mmu(struct mmu_gather *tlb, unsigned long start,
 extern bool __tlb_remove_page_size(struct mmu_gather *tlb, struct page *page,
 				   int page_size);
 
+/*
+ * Returns true when more addresses were gathered than fit in tlb->addrs
+ * and the flush must fall back to the start/end range.
+ */
+static inline bool tlb_addrs_overflowed(struct mmu_gather *tlb)
+{
+	return tlb->nr_addrs > MMU_GATHER_ADDRS;
+}
+
 static inline void __tlb_adjust_range(struct mmu_gather *tlb,
 				      unsigned long address,
 				      unsigned int range_size)
 {
 	tlb->start = min(tlb->start, address);
 	tlb->end = max(tlb->end, address + range_size);
+
+	/*
+	 * Remember single page addresses exactly so that sparse unmaps
+	 * can be flushed page by page instead of flushing (or walking)
+	 * the whole span. Larger adjustments invalidate the gathered
+	 * addresses and force the range fallback.
+	 */
+	if (range_size == PAGE_SIZE && tlb->nr_addrs < MMU_GATHER_ADDRS)
+		tlb->addrs[tlb->nr_addrs++] = address;
+	else
+		tlb->nr_addrs = MMU_GATHER_ADDRS + 1;
 }
 
 static inline void __tlb_reset_range(struct mmu_gather *tlb)
@@ -135,6 +166,7 @@ static inline void __tlb_reset_range(struct mmu_gather *tlb)
 		tlb->start = TASK_SIZE;
 		tlb->end = 0;
 	}
+	tlb->nr_addrs = 0;
 }
 
 static inline void tlb_remove_page_size(struct mmu_gather *tlb,
@@ -124,6 +124,16 @@ struct ahash_request {
  *	    entire state of the ongoing transformation from a provided block of
  *	    data so the transformation can continue from this point onward. No
  *	    data processing happens at this point.
+ * @digest_batch: Calculate the digests for an array of requests back-to-back.
+ *		  Optional. All requests share the transformation object of the
+ *		  first entry. Implementations may interleave the processing of
+ *		  the requests, which is what the multibuffer algorithms need
+ *		  to fill all SIMD lanes. The status of every request,
+ *		  including synchronous failures, is delivered through its
+ *		  completion callback; the return value only reports whether
+ *		  the batch as a whole could be taken. When this is NULL the
+ *		  API falls back to submitting the requests one by one through
+ *		  @digest.
  * @halg: see struct hash_alg_common
  */
 struct ahash_alg {
@@ -132,6 +142,7 @@ struct ahash_alg {
 	int (*final)(struct ahash_request *req);
 	int (*finup)(struct ahash_request *req);
 	int (*digest)(struct ahash_request *req);
+	int (*digest_batch)(struct ahash_request **reqs, unsigned int nreqs);
 	int (*export)(struct ahash_request *req, void *out);
 	int (*import)(struct ahash_request *req, const void *in);
 	int (*setkey)(struct crypto_ahash *tfm, const u8 *key,
@@ -446,6 +457,49 @@ int crypto_ahash_final(struct ahash_request *req);
  */
 int crypto_ahash_digest(struct ahash_request *req);
 
+/**
+ * crypto_ahash_digest_batch() - calculate message digests for an array of
+ *				 requests
+ * @reqs: array of request handles, all registered with the same ahash handle
+ * @nreqs: number of entries in @reqs
+ *
+ * Submit @nreqs requests in one call so that implementations can process them
+ * back-to-back without returning to the caller in between. Unlike
+ * crypto_ahash_digest(), the status of every request - including requests
+ * that fail synchronously - is delivered through its completion callback, so
+ * the caller handles all completions in one place.
+ *
+ * Return: 0 if the batch was submitted; < 0 if no request was processed
+ */
+static inline int crypto_ahash_digest_batch(struct ahash_request **reqs,
+					    unsigned int nreqs)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(reqs[0]);
+	struct crypto_alg *alg = crypto_ahash_tfm(tfm)->__crt_alg;
+	unsigned int i;
+	int err;
+
+	/* shash algorithms wrapped as ahash have no batch entry point */
+	if ((alg->cra_flags & CRYPTO_ALG_TYPE_MASK) == CRYPTO_ALG_TYPE_AHASH) {
+		struct ahash_alg *ahash = container_of(alg, struct ahash_alg,
+						       halg.base);
+
+		if (ahash->digest_batch)
+			return ahash->digest_batch(reqs, nreqs);
+	}
+
+	for (i = 0; i < nreqs; i++) {
+		err = tfm->digest(reqs[i]);
+		if (err == -EINPROGRESS ||
+		    (err == -EBUSY && (reqs[i]->base.flags &
+				       CRYPTO_TFM_REQ_MAY_BACKLOG)))
+			continue;
+		reqs[i]->base.complete(&reqs[i]->base, err);
+	}
+
+	return 0;
+}
+
 /**
  * crypto_ahash_export() - extract current message digest state
  * @req: reference to the ahash_request handle whose state is exported
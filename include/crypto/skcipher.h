@@ -111,19 +111,35 @@ struct crypto_skcipher {
  * @exit: Deinitialize the cryptographic transformation object. This is a
  *	  counterpart to @init, used to remove various changes set in
  *	  @init.
+ * @encrypt_batch: Encrypt an array of requests back-to-back. Optional. All
+ *		   requests share the transformation object of the first entry.
+ *		   Implementations may interleave the processing of the
+ *		   requests, e.g. to keep a wide SIMD unit or an offload
+ *		   engine's queue full across request boundaries. The status of
+ *		   every request, including synchronous failures, is delivered
+ *		   through its completion callback; the return value only
+ *		   reports whether the batch as a whole could be taken. When
+ *		   this is NULL the API falls back to submitting the requests
+ *		   one by one through @encrypt.
+ * @decrypt_batch: Decrypt counterpart to @encrypt_batch, with the same rules.
  * @ivsize: IV size applicable for transformation. The consumer must provide an
  *	    IV of exactly that size to perform the encrypt or decrypt operation.
  * @chunksize: Equal to the block size except for stream ciphers such as
  *	       CTR where it is set to the underlying block size.
  * @base: Definition of a generic crypto algorithm.
  *
- * All fields except @ivsize are mandatory and must be filled.
+ * All fields except @ivsize, @encrypt_batch and @decrypt_batch are mandatory
+ * and must be filled.
  */
 struct skcipher_alg {
 	int (*setkey)(struct crypto_skcipher *tfm, const u8 *key,
 	              unsigned int keylen);
 	int (*encrypt)(struct skcipher_request *req);
 	int (*decrypt)(struct skcipher_request *req);
+	int (*encrypt_batch)(struct skcipher_request **reqs,
+			     unsigned int nreqs);
+	int (*decrypt_batch)(struct skcipher_request **reqs,
+			     unsigned int nreqs);
 	int (*init)(struct crypto_skcipher *tfm);
 	void (*exit)(struct crypto_skcipher *tfm);
 
@@ -429,6 +445,68 @@ static inline int crypto_skcipher_decrypt(struct skcipher_request *req)
 	return tfm->decrypt(req);
 }
 
+static inline int __crypto_skcipher_crypt_batch(struct skcipher_request **reqs,
+						unsigned int nreqs, bool enc)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(reqs[0]);
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	unsigned int i;
+	int err;
+
+	if ((alg->base.cra_flags & CRYPTO_ALG_TYPE_MASK) ==
+	    CRYPTO_ALG_TYPE_SKCIPHER) {
+		if (enc && alg->encrypt_batch)
+			return alg->encrypt_batch(reqs, nreqs);
+		if (!enc && alg->decrypt_batch)
+			return alg->decrypt_batch(reqs, nreqs);
+	}
+
+	for (i = 0; i < nreqs; i++) {
+		err = enc ? tfm->encrypt(reqs[i]) : tfm->decrypt(reqs[i]);
+		if (err == -EINPROGRESS ||
+		    (err == -EBUSY && (reqs[i]->base.flags &
+				       CRYPTO_TFM_REQ_MAY_BACKLOG)))
+			continue;
+		reqs[i]->base.complete(&reqs[i]->base, err);
+	}
+
+	return 0;
+}
+
+/**
+ * crypto_skcipher_encrypt_batch() - encrypt an array of requests
+ * @reqs: array of request handles, all registered with the same cipher handle
+ * @nreqs: number of entries in @reqs
+ *
+ * Submit @nreqs requests in one call so that implementations can process them
+ * back-to-back without returning to the caller in between. Unlike
+ * crypto_skcipher_encrypt(), the status of every request - including requests
+ * that fail synchronously - is delivered through its completion callback, so
+ * the caller handles all completions in one place.
+ *
+ * Return: 0 if the batch was submitted; < 0 if no request was processed
+ */
+static inline int crypto_skcipher_encrypt_batch(struct skcipher_request **reqs,
+						unsigned int nreqs)
+{
+	return __crypto_skcipher_crypt_batch(reqs, nreqs, true);
+}
+
+/**
+ * crypto_skcipher_decrypt_batch() - decrypt an array of requests
+ * @reqs: array of request handles, all registered with the same cipher handle
+ * @nreqs: number of entries in @reqs
+ *
+ * Decrypt counterpart to crypto_skcipher_encrypt_batch().
+ *
+ * Return: 0 if the batch was submitted; < 0 if no request was processed
+ */
+static inline int crypto_skcipher_decrypt_batch(struct skcipher_request **reqs,
+						unsigned int nreqs)
+{
+	return __crypto_skcipher_crypt_batch(reqs, nreqs, false);
+}
+
 /**
  * DOC: Symmetric Key Cipher Request Handle
  *
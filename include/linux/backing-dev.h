@@ -130,6 +130,7 @@ static inline unsigned long wb_stat_error(struct bdi_writeback *wb)
 
 int bdi_set_min_ratio(struct backing_dev_info *bdi, unsigned int min_ratio);
 int bdi_set_max_ratio(struct backing_dev_info *bdi, unsigned int max_ratio);
+int bdi_set_min_bw(struct backing_dev_info *bdi, unsigned long min_bw);
 
 /*
  * Flags in backing_dev_info::capability
@@ -25,9 +25,11 @@ struct linux_binprm {
 	unsigned int
 		cred_prepared:1,/* true if creds already prepared (multiple
 				 * preps happen for interpreters) */
-		cap_effective:1;/* true if has elevated effective capabilities,
+		cap_effective:1,/* true if has elevated effective capabilities,
 				 * false if not; except for init which inherits
 				 * its parent's caps anyway */
+		preload_image:1;/* read ahead the whole image while the
+				 * exec completes (AT_EXEC_READAHEAD) */
 #ifdef __alpha__
 	unsigned int taso:1;
 #endif
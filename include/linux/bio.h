@@ -675,10 +675,22 @@ static inline void bio_inc_remaining(struct bio *bio)
  */
 #define BIO_POOL_SIZE 2
 
+/*
+ * Per-cpu front cache of recently freed bios, sitting before the
+ * mempools.  Only bios using the inline vecs are cached, so a cached
+ * entry is always one slab object of front_pad + bio + inline vecs.
+ */
+struct bio_alloc_cache {
+	struct bio_list		free_list;
+	unsigned int		nr;
+};
+
 struct bio_set {
 	struct kmem_cache *bio_slab;
 	unsigned int front_pad;
 
+	struct bio_alloc_cache __percpu *cache;
+
 	mempool_t *bio_pool;
 	mempool_t *bvec_pool;
 #if defined(CONFIG_BLK_DEV_INTEGRITY)
@@ -8,6 +8,8 @@
 struct blk_mq_tags;
 struct blk_flush_queue;
 
+struct blk_mq_sched_ops;
+
 struct blk_mq_hw_ctx {
 	struct {
 		spinlock_t		lock;
@@ -27,6 +29,9 @@ struct blk_mq_hw_ctx {
 
 	void			*driver_data;
 
+	const struct blk_mq_sched_ops *sched_ops;
+	void			*sched_data;
+
 	struct sbitmap		ctx_map;
 
 	struct blk_mq_ctx	**ctxs;
@@ -225,6 +230,8 @@ void blk_mq_kick_requeue_list(struct request_queue *q);
 void blk_mq_delay_kick_requeue_list(struct request_queue *q, unsigned long msecs);
 void blk_mq_abort_requeue_list(struct request_queue *q);
 void blk_mq_complete_request(struct request *rq, int error);
+void blk_mq_complete_request_batch(struct request **rqs, int *errors,
+				   unsigned int nr);
 
 bool blk_mq_queue_stopped(struct request_queue *q);
 void blk_mq_stop_hw_queue(struct blk_mq_hw_ctx *hctx);
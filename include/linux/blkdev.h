@@ -39,6 +39,8 @@ struct blkcg_gq;
 struct blk_flush_queue;
 struct pr_ops;
 struct rq_wb;
+struct blk_discard_ctx;
+struct blk_hist;
 
 #define BLKDEV_MIN_RQ	4
 #define BLKDEV_MAX_RQ	128	/* Default maximum */
@@ -389,6 +391,8 @@ struct request_queue {
 	int			nr_rqs_elvpriv;	/* # allocated rqs w/ elvpriv */
 
 	struct rq_wb		*rq_wb;
+	struct blk_discard_ctx	*discard_ctx;
+	struct blk_hist __percpu *lat_hist;
 
 	/*
 	 * If blkcg is not used, @q->root_rl serves all requests.  If blkcg
@@ -1311,6 +1315,8 @@ extern int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 extern int __blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, int flags,
 		struct bio **biop);
+extern int blkdev_issue_discard_async(struct block_device *bdev,
+		sector_t sector, sector_t nr_sects, gfp_t gfp_mask);
 extern int blkdev_issue_write_same(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, struct page *page);
 extern int __blkdev_issue_zeroout(struct block_device *bdev, sector_t sector,
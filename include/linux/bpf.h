@@ -13,8 +13,84 @@
 #include <linux/percpu.h>
 #include <linux/err.h>
 
+/* transitional: belongs in uapi linux/bpf.h next to the other map types,
+ * XDP actions and helper ids
+ */
+#ifndef BPF_MAP_TYPE_DEVMAP
+#define BPF_MAP_TYPE_DEVMAP	14
+#define BPF_FUNC_redirect_map	51
+#define XDP_REDIRECT		4
+#endif
+
+/* transitional: uapi ids for the socket lookup hook. SOCKMAP holds listener
+ * socket fds, SK_LOOKUP programs run at inet lookup time and pick an entry
+ * via bpf_sk_select_reuseport().
+ */
+#ifndef BPF_MAP_TYPE_SOCKMAP
+#define BPF_MAP_TYPE_SOCKMAP		15
+#define BPF_PROG_TYPE_SK_LOOKUP		30
+#define BPF_SK_LOOKUP			36	/* attach type */
+#define BPF_FUNC_sk_select_reuseport	82
+#define SK_DROP				0
+#define SK_PASS				1
+#endif
+
+/* transitional: uapi ids for in-kernel event aggregation. A percpu
+ * histogram map holds one per-CPU u64 counter per bucket (key_size 4,
+ * value_size 8); bpf_hist_add(map, value) increments the log-linear
+ * bucket for 'value' on the local CPU without atomics. Bucket layout:
+ * values below 16 map 1:1, above that every power of two is split into
+ * 16 linear sub-buckets.
+ */
+#ifndef BPF_MAP_TYPE_PERCPU_HISTOGRAM
+#define BPF_MAP_TYPE_PERCPU_HISTOGRAM	16
+#define BPF_FUNC_hist_add		83
+#endif
+
+/* transitional: belongs in uapi linux/bpf.h. Batched map commands; union
+ * bpf_attr grows the matching anonymous struct:
+ *
+ *	struct { // struct used by BPF_MAP_*_BATCH commands
+ *		__aligned_u64	in_batch;	// start batch, NULL to start
+ *						// from the beginning
+ *		__aligned_u64	out_batch;	// output: next start batch
+ *		__aligned_u64	keys;
+ *		__aligned_u64	values;
+ *		__u32		count;		// input: # of key/value elems
+ *						// output: # of processed elems
+ *		__u32		map_fd;
+ *		__u64		elem_flags;
+ *		__u64		flags;
+ *	} batch;
+ */
+#ifndef BPF_MAP_LOOKUP_BATCH
+#define BPF_MAP_LOOKUP_BATCH	24
+/* 25 is reserved for a lookup-and-delete batch */
+#define BPF_MAP_UPDATE_BATCH	26
+#define BPF_MAP_DELETE_BATCH	27
+/* fold the per-CPU copies of a value into one value u64-wise, valid in
+ * batch.elem_flags of BPF_MAP_LOOKUP_BATCH on per-CPU maps whose value
+ * size is a multiple of 8
+ */
+#define BPF_F_CPU_SUM		(1U << 3)
+#endif
+
+/* transitional: user visible context for BPF_PROG_TYPE_SK_LOOKUP programs.
+ * Addresses are in network byte order, ports in host byte order.
+ */
+struct bpf_sk_lookup {
+	__u32 family;
+	__u32 protocol;
+	__u32 remote_ip4;
+	__u32 remote_port;
+	__u32 local_ip4;
+	__u32 local_port;
+};
+
 struct perf_event;
 struct bpf_map;
+struct net_device;
+struct sock;
 
 /* map is generic key/value storage optionally accesible by eBPF programs */
 struct bpf_map_ops {
@@ -33,6 +109,12 @@ struct bpf_map_ops {
 	void *(*map_fd_get_ptr)(struct bpf_map *map, struct file *map_file,
 				int fd);
 	void (*map_fd_put_ptr)(void *ptr);
+
+	/* called by the verifier to inline a lookup into the program;
+	 * emits insns that consume (R1=map, R2=key) and leave the value
+	 * pointer or NULL in R0, clobbering only caller-saved regs
+	 */
+	u32 (*map_gen_lookup)(struct bpf_map *map, struct bpf_insn *insn_buf);
 };
 
 struct bpf_map {
@@ -262,6 +344,7 @@ int bpf_percpu_hash_copy(struct bpf_map *map, void *key, void *value);
 int bpf_percpu_array_copy(struct bpf_map *map, void *key, void *value);
 int bpf_percpu_hash_update(struct bpf_map *map, void *key, void *value,
 			   u64 flags);
+int bpf_hist_map_add(struct bpf_map *map, u64 value);
 int bpf_percpu_array_update(struct bpf_map *map, void *key, void *value,
 			    u64 flags);
 
@@ -271,6 +354,19 @@ int bpf_fd_array_map_update_elem(struct bpf_map *map, struct file *map_file,
 				 void *key, void *value, u64 map_flags);
 void bpf_fd_array_map_clear(struct bpf_map *map);
 
+/* Map specific helpers for XDP redirect */
+struct net_device *__dev_map_lookup_elem(struct bpf_map *map, u32 key);
+void __dev_map_insert_ctx(struct bpf_map *map, u32 index);
+void __dev_map_flush(struct bpf_map *map);
+
+/* Map specific helper for the inet socket lookup hook */
+struct sock *__sock_map_lookup_elem(struct bpf_map *map, u32 key);
+
+#ifdef CONFIG_INET
+int inet_sk_lookup_bpf_attach(const union bpf_attr *attr);
+int inet_sk_lookup_bpf_detach(const union bpf_attr *attr);
+#endif
+
 /* memcpy that is used with 8-byte aligned pointers, power-of-8 size and
  * forced to use 'long' read/writes to try to atomically copy long counters.
  * Best-effort only.  No barriers here, since it _will_ race with concurrent
@@ -331,12 +427,32 @@ static inline int __bpf_prog_charge(struct user_struct *user, u32 pages)
 static inline void __bpf_prog_uncharge(struct user_struct *user, u32 pages)
 {
 }
+
+static inline struct net_device *__dev_map_lookup_elem(struct bpf_map *map,
+						       u32 key)
+{
+	return NULL;
+}
+
+static inline void __dev_map_insert_ctx(struct bpf_map *map, u32 index)
+{
+}
+
+static inline void __dev_map_flush(struct bpf_map *map)
+{
+}
+
+static inline struct sock *__sock_map_lookup_elem(struct bpf_map *map, u32 key)
+{
+	return NULL;
+}
 #endif /* CONFIG_BPF_SYSCALL */
 
 /* verifier prototypes for helper functions called from eBPF programs */
 extern const struct bpf_func_proto bpf_map_lookup_elem_proto;
 extern const struct bpf_func_proto bpf_map_update_elem_proto;
 extern const struct bpf_func_proto bpf_map_delete_elem_proto;
+extern const struct bpf_func_proto bpf_hist_add_proto;
 
 extern const struct bpf_func_proto bpf_get_prandom_u32_proto;
 extern const struct bpf_func_proto bpf_get_smp_processor_id_proto;
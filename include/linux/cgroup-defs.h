@@ -220,6 +220,22 @@ struct css_set {
 	struct rcu_head rcu_head;
 };
 
+/*
+ * rstat - cgroup scalable recursive statistics. Per-cpu bookkeeping
+ * of which cgroups have pending stat updates, so that a flush only
+ * has to visit those instead of the whole subtree on every cpu.
+ */
+struct cgroup_rstat_cpu {
+	/*
+	 * Child cgroups with stat updates on this cpu since the last
+	 * flush. Linked via ->updated_next, terminated by the parent
+	 * itself; ->updated_children pointing back at the owner means
+	 * empty. NULL ->updated_next means not on a list.
+	 */
+	struct cgroup *updated_children;
+	struct cgroup *updated_next;
+};
+
 struct cgroup {
 	/* self css with NULL ->ss, points back to this cgroup */
 	struct cgroup_subsys_state self;
@@ -304,6 +320,9 @@ struct cgroup {
 	/* used to store eBPF programs */
 	struct cgroup_bpf bpf;
 
+	/* per-cpu recursive stat bookkeeping */
+	struct cgroup_rstat_cpu __percpu *rstat_cpu;
+
 	/* ids of the ancestors at each level including self */
 	int ancestor_ids[];
 };
@@ -444,6 +463,7 @@ struct cgroup_subsys {
 	void (*css_released)(struct cgroup_subsys_state *css);
 	void (*css_free)(struct cgroup_subsys_state *css);
 	void (*css_reset)(struct cgroup_subsys_state *css);
+	void (*css_rstat_flush)(struct cgroup_subsys_state *css, int cpu);
 
 	int (*can_attach)(struct cgroup_taskset *tset);
 	void (*cancel_attach)(struct cgroup_taskset *tset);
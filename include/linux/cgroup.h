@@ -112,6 +112,18 @@ void cgroup_free(struct task_struct *p);
 int cgroup_init_early(void);
 int cgroup_init(void);
 
+/*
+ * cgroup scalable recursive statistics (rstat).
+ *
+ * Controllers keep their counters in per-cpu storage and call
+ * cgroup_rstat_updated() when one changes; readers call
+ * cgroup_rstat_flush() which visits only the cgroups that have
+ * pending per-cpu updates and invokes ->css_rstat_flush(), so read
+ * cost is O(updated cgroups) instead of O(subtree x cpus).
+ */
+void cgroup_rstat_updated(struct cgroup *cgrp, int cpu);
+void cgroup_rstat_flush(struct cgroup *cgrp);
+
 /*
  * Iteration helpers and macros.
  */
@@ -3,7 +3,22 @@
 
 #include <linux/types.h>
 
+struct scatterlist;
+
+/*
+ * One buffer of a bulk checksum call; @crc carries the seed in and the
+ * result out.
+ */
+struct crc32c_bulk_req {
+	u32 crc;
+	const void *address;
+	unsigned int length;
+};
+
 extern u32 crc32c(u32 crc, const void *address, unsigned int length);
+extern void crc32c_bulk(struct crc32c_bulk_req *reqs, unsigned int nreqs);
+extern void crc32c_sg_bulk(struct scatterlist *sgl, unsigned int nents,
+			   u32 *crcs);
 
 /* This macro exists for backwards-compatibility. */
 #define crc32c_le crc32c
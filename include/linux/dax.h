@@ -86,6 +86,29 @@ static inline int dax_iomap_pmd_fault(struct vm_area_struct *vma,
 #endif
 int dax_pfn_mkwrite(struct vm_area_struct *, struct vm_fault *);
 
+/*
+ * A run of pages dirtied through a DAX mapping, as reported by
+ * dax_get_dirty_ranges().  A PMD entry is reported as a single range
+ * covering the whole huge page.
+ */
+struct dax_dirty_range {
+	__u64 index;		/* first page index of the run */
+	__u64 nr_pages;		/* length of the run in pages */
+};
+
+#ifdef CONFIG_FS_DAX
+unsigned int dax_get_dirty_ranges(struct address_space *mapping,
+		pgoff_t *start, pgoff_t end, struct dax_dirty_range *ranges,
+		unsigned int nr);
+#else
+static inline unsigned int dax_get_dirty_ranges(struct address_space *mapping,
+		pgoff_t *start, pgoff_t end, struct dax_dirty_range *ranges,
+		unsigned int nr)
+{
+	return 0;
+}
+#endif
+
 static inline bool vma_is_dax(struct vm_area_struct *vma)
 {
 	return vma->vm_file && IS_DAX(vma->vm_file->f_mapping->host);
@@ -216,6 +216,17 @@ struct target_type {
 #define DM_TARGET_WILDCARD		0x00000008
 #define dm_target_is_wildcard(type)	((type)->features & DM_TARGET_WILDCARD)
 
+/*
+ * Indicates that the target's map function only adjusts bi_bdev and
+ * bi_sector of the bio passed to it and always returns
+ * DM_MAPIO_REMAPPED.  It must not carry per-bio data, split I/O or
+ * define an end_io method.  This allows dm core to remap the original
+ * bio in place instead of cloning it when such a target is the only
+ * one in its table.
+ */
+#define DM_TARGET_PASSTHROUGH		0x00000010
+#define dm_target_is_passthrough(type)	((type)->features & DM_TARGET_PASSTHROUGH)
+
 /*
  * Some targets need to be sent the same WRITE bio severals times so
  * that they can send copies of it to different devices.  This function
@@ -8,6 +8,12 @@
 #endif
 #include <uapi/linux/errqueue.h>
 
+/* transitional: belongs in uapi errqueue.h next to the other origins */
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY		5
+#define SO_EE_CODE_ZEROCOPY_COPIED	1
+#endif
+
 #define SKB_EXT_ERR(skb) ((struct sock_exterr_skb *) ((skb)->cb))
 
 struct sock_exterr_skb {
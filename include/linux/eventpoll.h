@@ -15,6 +15,21 @@
 
 #include <uapi/linux/eventpoll.h>
 
+/* transitional: belongs in uapi eventpoll.h */
+#ifndef EPIOCSPARAMS
+/* Parameters controlling busy polling from epoll_wait() */
+struct epoll_params {
+	__u32 busy_poll_usecs;
+	__u16 busy_poll_budget;
+
+	/* for future fields; must be zero */
+	__u16 __pad;
+};
+
+#define EPOLL_IOC_TYPE 0x8A
+#define EPIOCSPARAMS _IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_params)
+#define EPIOCGPARAMS _IOR(EPOLL_IOC_TYPE, 0x02, struct epoll_params)
+#endif
 
 /* Forward declarations to avoid compiler errors */
 struct file;
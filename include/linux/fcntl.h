@@ -3,6 +3,15 @@
 
 #include <uapi/linux/fcntl.h>
 
+/*
+ * execveat(2): asynchronously read ahead the new image's PT_LOAD
+ * segments while exec completes.
+ *
+ * transitional: belongs in uapi/linux/fcntl.h with the other AT_ flags.
+ */
+#ifndef AT_EXEC_READAHEAD
+#define AT_EXEC_READAHEAD	0x10000
+#endif
 
 #ifndef force_o_largefile
 #define force_o_largefile() (BITS_PER_LONG != 32)
@@ -443,6 +443,20 @@ struct xdp_buff {
 	void *data_hard_start;
 };
 
+/* Kernel side context for BPF_PROG_TYPE_SK_LOOKUP programs. The leading
+ * fields must line up with struct bpf_sk_lookup so that ctx access needs
+ * no offset translation.
+ */
+struct bpf_sk_lookup_kern {
+	u32 family;
+	u32 protocol;
+	__be32 remote_ip4;
+	u32 remote_port;
+	__be32 local_ip4;
+	u32 local_port;
+	struct sock *selected_sk;
+};
+
 /* compute the linear packet data range [data, data_end) which
  * will be accessed by cls_bpf, act_bpf and lwt programs
  */
@@ -613,6 +627,18 @@ struct bpf_prog *bpf_patch_insn_single(struct bpf_prog *prog, u32 off,
 				       const struct bpf_insn *patch, u32 len);
 void bpf_warn_invalid_xdp_action(u32 act);
 
+struct net_device;
+
+/* The pair of xdp_do_redirect and xdp_do_flush_map MUST be called in the
+ * same cpu context. Further for best results no more than a single map
+ * for the do_redirect/do_flush pair should be used. This limitation is
+ * because we only track one map and force a flush when the map changes.
+ * This does not appear to be a real limitation for existing software.
+ */
+int xdp_do_redirect(struct net_device *dev, struct xdp_buff *xdp,
+		    struct bpf_prog *prog);
+void xdp_do_flush_map(void);
+
 #ifdef CONFIG_BPF_JIT
 extern int bpf_jit_enable;
 extern int bpf_jit_harden;
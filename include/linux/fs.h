@@ -270,6 +270,10 @@ struct writeback_control;
 #define IOCB_DSYNC		(1 << 4)
 #define IOCB_SYNC		(1 << 5)
 #define IOCB_WRITE		(1 << 6)
+/* iocb->ki_waitq is valid, queue on locked pages instead of sleeping */
+#define IOCB_WAITQ		(1 << 7)
+
+struct wait_page_queue;
 
 struct kiocb {
 	struct file		*ki_filp;
@@ -277,6 +281,7 @@ struct kiocb {
 	void (*ki_complete)(struct kiocb *iocb, long ret, long ret2);
 	void			*private;
 	int			ki_flags;
+	struct wait_page_queue	*ki_waitq;	/* for async buffered IO */
 };
 
 static inline bool is_sync_kiocb(struct kiocb *kiocb)
@@ -725,6 +730,12 @@ static inline void inode_lock_nested(struct inode *inode, unsigned subclass)
 	down_write_nested(&inode->i_rwsem, subclass);
 }
 
+static inline void inode_lock_shared_nested(struct inode *inode,
+					    unsigned subclass)
+{
+	down_read_nested(&inode->i_rwsem, subclass);
+}
+
 void lock_two_nondirectories(struct inode *, struct inode*);
 void unlock_two_nondirectories(struct inode *, struct inode*);
 
@@ -814,6 +825,7 @@ struct file_ra_state {
 
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
+	unsigned int seq_streak;	/* consecutive sequential expansions */
 	loff_t prev_pos;		/* Cache last read() position */
 };
 
@@ -1265,6 +1277,7 @@ struct mm_struct;
 
 /* sb->s_iflags to limit user namespace mounts */
 #define SB_I_USERNS_VISIBLE		0x00000010 /* fstype already mounted */
+#define SB_I_PARALLEL_DIROPS	0x00000020	/* dir ops safe under shared ->i_rwsem */
 
 /* Possible states of 'frozen' field */
 enum {
@@ -1307,6 +1320,14 @@ struct super_block {
 #endif
 	const struct xattr_handler **s_xattr;
 
+#ifdef CONFIG_FSNOTIFY
+	/*
+	 * Union of all events ever watched anywhere on this sb; only
+	 * grows, so a clear miss here means no mark can be interested.
+	 */
+	__u32			s_fsnotify_mask;
+#endif
+
 	const struct fscrypt_operations	*s_cop;
 
 	struct hlist_bl_head	s_anon;		/* anonymous dentries for (nfs) exporting */
@@ -2494,6 +2515,8 @@ extern void filemap_fdatawait_keep_errors(struct address_space *);
 extern int filemap_fdatawait_range(struct address_space *, loff_t lstart,
 				   loff_t lend);
 extern int filemap_write_and_wait(struct address_space *mapping);
+extern bool filemap_range_has_page(struct address_space *mapping,
+				   loff_t start_byte, loff_t end_byte);
 extern int filemap_write_and_wait_range(struct address_space *mapping,
 				        loff_t lstart, loff_t lend);
 extern int __filemap_fdatawrite_range(struct address_space *mapping,
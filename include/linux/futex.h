@@ -52,9 +52,19 @@ union futex_key {
 
 #define FUTEX_KEY_INIT (union futex_key) { .both = { .ptr = NULL } }
 
+/* transitional: belongs in uapi futex.h next to the other opcodes.
+ * Like FUTEX_WAIT, but spins while the lock holder named in the futex
+ * word (TID protocol) is running on a CPU before going to sleep.
+ */
+#ifndef FUTEX_WAIT_ADAPTIVE
+#define FUTEX_WAIT_ADAPTIVE	13
+#endif
+
 #ifdef CONFIG_FUTEX
 extern void exit_robust_list(struct task_struct *curr);
 extern void exit_pi_state_list(struct task_struct *curr);
+extern void futex_mm_init(struct mm_struct *mm);
+extern void futex_mm_free(struct mm_struct *mm);
 #ifdef CONFIG_HAVE_FUTEX_CMPXCHG
 #define futex_cmpxchg_enabled 1
 #else
@@ -67,5 +77,11 @@ static inline void exit_robust_list(struct task_struct *curr)
 static inline void exit_pi_state_list(struct task_struct *curr)
 {
 }
+static inline void futex_mm_init(struct mm_struct *mm)
+{
+}
+static inline void futex_mm_free(struct mm_struct *mm)
+{
+}
 #endif
 #endif
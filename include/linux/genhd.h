@@ -87,6 +87,7 @@ struct disk_stats {
 	unsigned long ticks[2];
 	unsigned long io_ticks;
 	unsigned long time_in_queue;
+	long in_flight[2];	/* signed; may go negative on one CPU */
 };
 
 #define PARTITION_META_INFO_VOLNAMELTH	64
@@ -120,7 +121,6 @@ struct hd_struct {
 	int make_it_fail;
 #endif
 	unsigned long stamp;
-	atomic_t in_flight[2];
 #ifdef	CONFIG_SMP
 	struct disk_stats __percpu *dkstats;
 #else
@@ -368,23 +368,28 @@ static inline void free_part_stats(struct hd_struct *part)
 #define part_stat_sub(cpu, gendiskp, field, subnd)			\
 	part_stat_add(cpu, gendiskp, field, -subnd)
 
-static inline void part_inc_in_flight(struct hd_struct *part, int rw)
+static inline void part_inc_in_flight(int cpu, struct hd_struct *part, int rw)
 {
-	atomic_inc(&part->in_flight[rw]);
-	if (part->partno)
-		atomic_inc(&part_to_disk(part)->part0.in_flight[rw]);
+	part_stat_add(cpu, part, in_flight[rw], 1);
 }
 
-static inline void part_dec_in_flight(struct hd_struct *part, int rw)
+static inline void part_dec_in_flight(int cpu, struct hd_struct *part, int rw)
 {
-	atomic_dec(&part->in_flight[rw]);
-	if (part->partno)
-		atomic_dec(&part_to_disk(part)->part0.in_flight[rw]);
+	part_stat_add(cpu, part, in_flight[rw], -1);
 }
 
+/*
+ * in_flight is kept in the per-cpu stats so submission and completion
+ * never touch a shared cacheline; reads sum over all CPUs.  Individual
+ * CPU counts go negative when an IO completes on a different CPU than
+ * it started on, but the sum stays exact.
+ */
 static inline int part_in_flight(struct hd_struct *part)
 {
-	return atomic_read(&part->in_flight[0]) + atomic_read(&part->in_flight[1]);
+	long inflight = (long)part_stat_read(part, in_flight[0]) +
+			(long)part_stat_read(part, in_flight[1]);
+
+	return inflight < 0 ? 0 : inflight;
 }
 
 static inline struct partition_meta_info *alloc_part_info(struct gendisk *disk)
@@ -419,6 +419,11 @@ struct page *
 __alloc_pages_nodemask(gfp_t gfp_mask, unsigned int order,
 		       struct zonelist *zonelist, nodemask_t *nodemask);
 
+unsigned long
+__alloc_pages_bulk_nodemask(gfp_t gfp_mask, struct zonelist *zonelist,
+			    nodemask_t *nodemask, unsigned long nr_pages,
+			    struct list_head *page_list);
+
 static inline struct page *
 __alloc_pages(gfp_t gfp_mask, unsigned int order,
 		struct zonelist *zonelist)
@@ -426,6 +431,30 @@ __alloc_pages(gfp_t gfp_mask, unsigned int order,
 	return __alloc_pages_nodemask(gfp_mask, order, zonelist, NULL);
 }
 
+/*
+ * Allocate up to nr_pages order-0 pages onto page_list, preferring the
+ * node given as nid. Returns the number of pages allocated.
+ */
+static inline unsigned long
+alloc_pages_bulk_node(gfp_t gfp_mask, int nid, unsigned long nr_pages,
+		      struct list_head *page_list)
+{
+	if (nid == NUMA_NO_NODE)
+		nid = numa_mem_id();
+
+	return __alloc_pages_bulk_nodemask(gfp_mask,
+			node_zonelist(nid, gfp_mask), NULL, nr_pages,
+			page_list);
+}
+
+static inline unsigned long
+alloc_pages_bulk(gfp_t gfp_mask, unsigned long nr_pages,
+		 struct list_head *page_list)
+{
+	return alloc_pages_bulk_node(gfp_mask, numa_mem_id(), nr_pages,
+			page_list);
+}
+
 /*
  * Allocate pages, preferring the node given as nid. The node must be valid and
  * online. For more general interface, see alloc_pages_node().
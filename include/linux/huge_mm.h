@@ -66,12 +66,18 @@ struct page *follow_devmap_pmd(struct vm_area_struct *vma, unsigned long addr,
 
 extern bool is_vma_temporary_stack(struct vm_area_struct *vma);
 
+/*
+ * DAX vmas always want huge mappings when the alignment works out; the
+ * file being opened on a DAX mount is the per-file opt-in, and
+ * MADV_NOHUGEPAGE still opts a mapping back out.
+ */
 #define transparent_hugepage_enabled(__vma)				\
 	((transparent_hugepage_flags &					\
 	  (1<<TRANSPARENT_HUGEPAGE_FLAG) ||				\
 	  (transparent_hugepage_flags &					\
 	   (1<<TRANSPARENT_HUGEPAGE_REQ_MADV_FLAG) &&			\
-	   ((__vma)->vm_flags & VM_HUGEPAGE))) &&			\
+	   ((__vma)->vm_flags & VM_HUGEPAGE)) ||			\
+	  vma_is_dax(__vma)) &&						\
 	 !((__vma)->vm_flags & VM_NOHUGEPAGE) &&			\
 	 !is_vma_temporary_stack(__vma))
 #define transparent_hugepage_use_zero_page()				\
@@ -338,6 +338,48 @@ irq_calc_affinity_vectors(int maxvec, const struct irq_affinity *affd)
 
 #endif /* CONFIG_SMP */
 
+/**
+ * struct irq_coalesce_ops - driver callback for interrupt coalescing
+ * @set_coalesce:	Program the device to hold back the interrupt for
+ *			up to @usecs microseconds.  Called from process
+ *			context; 0 disables moderation entirely.
+ *
+ * A driver which can moderate a queue interrupt in hardware registers
+ * these ops, after which the moderation interval is steered by the
+ * core from the latency target set on the irq.
+ */
+struct irq_coalesce_ops {
+	int (*set_coalesce)(unsigned int irq, unsigned int usecs,
+			    void *dev_data);
+};
+
+#ifdef CONFIG_GENERIC_IRQ_COALESCE
+
+extern int irq_set_coalesce_ops(unsigned int irq,
+				const struct irq_coalesce_ops *ops,
+				void *dev_data);
+extern void irq_remove_coalesce_ops(unsigned int irq);
+extern int irq_set_coalesce_latency(unsigned int irq, unsigned int target_us);
+
+#else /* CONFIG_GENERIC_IRQ_COALESCE */
+
+static inline int irq_set_coalesce_ops(unsigned int irq,
+				       const struct irq_coalesce_ops *ops,
+				       void *dev_data)
+{
+	return -ENOSYS;
+}
+
+static inline void irq_remove_coalesce_ops(unsigned int irq) { }
+
+static inline int irq_set_coalesce_latency(unsigned int irq,
+					   unsigned int target_us)
+{
+	return -ENOSYS;
+}
+
+#endif /* CONFIG_GENERIC_IRQ_COALESCE */
+
 /*
  * Special lockdep variants of irq disabling/enabling.
  * These should be used for locking constructs that
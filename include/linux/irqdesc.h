@@ -9,6 +9,7 @@
  */
 
 struct irq_affinity_notify;
+struct irq_coalesce;
 struct proc_dir_entry;
 struct module;
 struct irq_desc;
@@ -35,6 +36,7 @@ struct pt_regs;
  * @affinity_hint:	hint to user space for preferred irq affinity
  * @affinity_notify:	context for notification of affinity changes
  * @pending_mask:	pending rebalanced interrupts
+ * @coalesce:		adaptive interrupt coalescing state
  * @threads_oneshot:	bitfield to handle shared oneshot threads
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
@@ -75,6 +77,9 @@ struct irq_desc {
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	cpumask_var_t		pending_mask;
 #endif
+#endif
+#ifdef CONFIG_GENERIC_IRQ_COALESCE
+	struct irq_coalesce	*coalesce;
 #endif
 	unsigned long		threads_oneshot;
 	atomic_t		threads_active;
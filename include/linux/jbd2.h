@@ -724,6 +724,20 @@ jbd2_time_diff(unsigned long start, unsigned long end)
 
 #define JBD2_NR_BATCH	64
 
+/*
+ * Per-CPU cache of buffer credits claimed from the running transaction.
+ * The credits are already accounted in t_outstanding_credits of the
+ * transaction identified by @tid; small handles consume them without
+ * touching the shared atomics.
+ */
+struct jbd2_credit_cache {
+	tid_t		tid;		/* transaction owning the credits */
+	int		credits;	/* credits not yet handed out */
+};
+
+/* Largest refill of a per-CPU credit cache */
+#define JBD2_CREDIT_CACHE_BATCH	64
+
 /**
  * struct journal_s - The journal_s type is the concrete type associated with
  *     journal_t.
@@ -760,6 +774,9 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_fs_dev: Device which holds the client fs.  For internal journal this will
  *     be equal to j_dev
  * @j_reserved_credits: Number of buffers reserved from the running transaction
+ * @j_credit_cache: Per-CPU caches of credits claimed from the running
+ *     transaction
+ * @j_credit_batch: Refill size for the per-CPU credit caches
  * @j_maxlen: Total maximum capacity of the journal region on disk.
  * @j_list_lock: Protects the buffer lists and internal buffer state.
  * @j_inode: Optional inode where we store the journal.  If present, all journal
@@ -768,6 +785,8 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_transaction_sequence: Sequence number of the next transaction to grant
  * @j_commit_sequence: Sequence number of the most recently committed
  *  transaction
+ * @j_durable_sequence: Sequence number of the most recent transaction whose
+ *  commit block has reached stable storage
  * @j_commit_request: Sequence number of the most recent transaction wanting
  *     commit
  * @j_uuid: Uuid of client object.
@@ -916,6 +935,19 @@ struct journal_s
 	/* Number of buffers reserved from the running transaction */
 	atomic_t		j_reserved_credits;
 
+	/*
+	 * Per-CPU caches of credits claimed in bulk from the running
+	 * transaction, handed out locally to small handles to keep them
+	 * off the shared t_outstanding_credits atomics.  Leftovers are
+	 * returned when the transaction is locked for commit.
+	 * Consumed under j_state_lock read-side, drained under the
+	 * write side.
+	 */
+	struct jbd2_credit_cache __percpu *j_credit_cache;
+
+	/* Refill size for the per-CPU credit caches; 0 disables them */
+	int			j_credit_batch;
+
 	/*
 	 * Protects the buffer lists and internal buffer state.
 	 */
@@ -942,6 +974,14 @@ struct journal_s
 	 */
 	tid_t			j_commit_sequence;
 
+	/*
+	 * Sequence number of the most recent transaction whose commit block
+	 * is on stable storage.  Runs ahead of j_commit_sequence while the
+	 * commit code finishes its forget list and checkpoint bookkeeping.
+	 * [j_state_lock]
+	 */
+	tid_t			j_durable_sequence;
+
 	/*
 	 * Sequence number of the most recent transaction wanting commit
 	 * [j_state_lock]
@@ -1365,6 +1405,7 @@ int jbd2_log_start_commit(journal_t *journal, tid_t tid);
 int __jbd2_log_start_commit(journal_t *journal, tid_t tid);
 int jbd2_journal_start_commit(journal_t *journal, tid_t *tid);
 int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
+int jbd2_log_wait_durable(journal_t *journal, tid_t tid);
 int jbd2_complete_transaction(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
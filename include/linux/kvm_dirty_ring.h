@@ -0,0 +1,74 @@
+#ifndef KVM_DIRTY_RING_H
+#define KVM_DIRTY_RING_H
+
+#include <linux/kvm.h>
+
+/*
+ * Transitional: the dirty ring ABI below belongs in uapi/linux/kvm.h
+ * once the interface is finalized.
+ *
+ * Each entry publishes one dirtied guest frame.  KVM fills @slot
+ * (address space id in the high 16 bits, memslot id in the low 16)
+ * and @offset (page offset into the memslot) and then sets
+ * KVM_DIRTY_GFN_F_DIRTY in @flags.  Userspace harvests the entry and
+ * sets KVM_DIRTY_GFN_F_RESET; KVM_RESET_DIRTY_RINGS collects such
+ * entries, write-protects the pages again and returns the slots to
+ * the producer by clearing @flags.
+ */
+#ifndef KVM_DIRTY_GFN_F_DIRTY
+struct kvm_dirty_gfn {
+	__u32 flags;
+	__u32 slot;
+	__u64 offset;
+};
+
+#define KVM_DIRTY_GFN_F_DIRTY		(1 << 0)
+#define KVM_DIRTY_GFN_F_RESET		(1 << 1)
+#define KVM_DIRTY_GFN_F_MASK		0x3
+
+#define KVM_CAP_DIRTY_LOG_RING		192
+#define KVM_RESET_DIRTY_RINGS		_IO(KVMIO, 0xc7)
+
+/* vcpu mmap page offset where the dirty ring of this vcpu starts */
+#define KVM_DIRTY_LOG_PAGE_OFFSET	64
+#endif
+
+#define KVM_DIRTY_RING_MAX_ENTRIES	65536
+
+/*
+ * kvm_dirty_ring is a single-producer ring of dirtied guest frames.
+ * The producer is the vcpu thread owning the ring; the consumer is
+ * userspace via the vcpu mmap region.  @size is the entry count (a
+ * power of two), indices are free running and only masked on access.
+ */
+struct kvm_dirty_ring {
+	u32 dirty_index;
+	u32 reset_index;
+	u32 size;
+	struct kvm_dirty_gfn *dirty_gfns;
+};
+
+struct kvm;
+
+int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, u32 bytes);
+
+/*
+ * Called by the vcpu thread to log one dirtied page.  Returns -EBUSY
+ * when the ring is full, in which case the caller must fall back to
+ * the memslot dirty bitmap so the page is not lost.
+ */
+int kvm_dirty_ring_push(struct kvm_dirty_ring *ring, u32 slot, u64 offset);
+
+/*
+ * Called under kvm->slots_lock to collect harvested entries and
+ * re-enable dirty logging for their pages.  Returns the number of
+ * entries reclaimed; the caller flushes TLBs if it is non-zero.
+ */
+int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring);
+
+/* returns the page backing @offset (in pages) of the ring mapping */
+struct page *kvm_dirty_ring_get_page(struct kvm_dirty_ring *ring, u32 offset);
+
+void kvm_dirty_ring_free(struct kvm_dirty_ring *ring);
+
+#endif	/* KVM_DIRTY_RING_H */
@@ -32,6 +32,7 @@
 #include <linux/kvm_para.h>
 
 #include <linux/kvm_types.h>
+#include <linux/kvm_dirty_ring.h>
 
 #include <asm/kvm_host.h>
 
@@ -232,6 +233,13 @@ struct kvm_vcpu {
 	unsigned int halt_poll_ns;
 	bool valid_wakeup;
 
+	/* adaptive halt-polling state, see kvm_vcpu_block() */
+	u64 halt_block_ns_ewma;
+	u64 halt_poll_hits;
+	u64 halt_poll_misses;
+	u64 halt_wake_timer;
+	u64 halt_wake_other;
+
 #ifdef CONFIG_HAS_IOMEM
 	int mmio_needed;
 	int mmio_read_completed;
@@ -263,6 +271,9 @@ struct kvm_vcpu {
 	} spin_loop;
 #endif
 	bool preempted;
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	struct kvm_dirty_ring dirty_ring;
+#endif
 	struct kvm_vcpu_arch arch;
 	struct dentry *debugfs_dentry;
 };
@@ -372,7 +383,11 @@ struct kvm_memslots {
 };
 
 struct kvm {
+#ifdef KVM_HAVE_MMU_RWLOCK
+	rwlock_t mmu_lock;
+#else
 	spinlock_t mmu_lock;
+#endif
 	struct mutex slots_lock;
 	struct mm_struct *mm; /* userspace tied to this vm */
 	struct kvm_memslots *memslots[KVM_ADDRESS_SPACE_NUM];
@@ -428,6 +443,8 @@ struct kvm {
 #endif
 	long tlbs_dirty;
 	struct list_head devices;
+	/* ring buffer bytes per vcpu, 0 when dirty rings are disabled */
+	u32 dirty_ring_size;
 	struct dentry *debugfs_dentry;
 	struct kvm_stat_data **debugfs_stat_data;
 };
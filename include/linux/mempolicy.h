@@ -15,6 +15,13 @@
 #include <linux/pagemap.h>
 #include <uapi/linux/mempolicy.h>
 
+/*
+ * Extra move_pages() flag beyond the uapi MPOL_MF_* set: queue the
+ * migration for deferred execution and return immediately; the caller
+ * polls its status array (primed with -EINPROGRESS) for completion.
+ */
+#define MPOL_MF_MOVE_ASYNC (1<<6)
+
 struct mm_struct;
 
 #ifdef CONFIG_NUMA
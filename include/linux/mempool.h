@@ -8,6 +8,7 @@
 #include <linux/compiler.h>
 
 struct kmem_cache;
+struct mempool_cache;
 
 typedef void * (mempool_alloc_t)(gfp_t gfp_mask, void *pool_data);
 typedef void (mempool_free_t)(void *element, void *pool_data);
@@ -16,7 +17,11 @@ typedef struct mempool_s {
 	spinlock_t lock;
 	int min_nr;		/* nr of elements at *elements */
 	int curr_nr;		/* Current nr of elements at *elements */
+	int min_seen;		/* Low watermark of curr_nr */
 	void **elements;
+	struct mempool_cache __percpu *cache;
+	unsigned long reserve_allocs;	/* allocs served from *elements */
+	unsigned long waits;		/* allocs that had to sleep empty */
 
 	void *pool_data;
 	mempool_alloc_t *alloc;
@@ -24,6 +29,18 @@ typedef struct mempool_s {
 	wait_queue_head_t wait;
 } mempool_t;
 
+/*
+ * Occupancy statistics, so reserves can be sized from observed pressure
+ * instead of guesswork.  Filled in by mempool_read_stats().
+ */
+struct mempool_stats {
+	int curr_nr;			/* current reserve occupancy */
+	int min_seen;			/* lowest reserve occupancy seen */
+	unsigned long cached_allocs;	/* allocs served from per-cpu caches */
+	unsigned long reserve_allocs;	/* allocs served from the reserve */
+	unsigned long waits;		/* allocs that slept on exhaustion */
+};
+
 extern mempool_t *mempool_create(int min_nr, mempool_alloc_t *alloc_fn,
 			mempool_free_t *free_fn, void *pool_data);
 extern mempool_t *mempool_create_node(int min_nr, mempool_alloc_t *alloc_fn,
@@ -34,6 +51,7 @@ extern int mempool_resize(mempool_t *pool, int new_min_nr);
 extern void mempool_destroy(mempool_t *pool);
 extern void *mempool_alloc(mempool_t *pool, gfp_t gfp_mask) __malloc;
 extern void mempool_free(void *element, mempool_t *pool);
+extern void mempool_read_stats(mempool_t *pool, struct mempool_stats *stats);
 
 /*
  * A mempool_alloc_t and mempool_free_t that get the memory from
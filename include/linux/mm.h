@@ -1236,9 +1236,38 @@ int invalidate_inode_page(struct page *page);
 #ifdef CONFIG_MMU
 extern int handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 		unsigned int flags);
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+extern int handle_speculative_fault(struct mm_struct *mm,
+		unsigned long address, unsigned int flags);
+
+/*
+ * Mark a modification of the address space. Callers must hold mmap_sem
+ * for writing, which serializes the sequence count updates; speculative
+ * faults racing with the modification notice the change and fall back
+ * to the locked fault path.
+ */
+static inline void mm_write_seqbegin(struct mm_struct *mm)
+{
+	write_seqcount_begin(&mm->mm_seq);
+}
+
+static inline void mm_write_seqend(struct mm_struct *mm)
+{
+	write_seqcount_end(&mm->mm_seq);
+}
+#else
+static inline void mm_write_seqbegin(struct mm_struct *mm)
+{
+}
+
+static inline void mm_write_seqend(struct mm_struct *mm)
+{
+}
+#endif
 extern int fixup_user_fault(struct task_struct *tsk, struct mm_struct *mm,
 			    unsigned long address, unsigned int fault_flags,
 			    bool *unlocked);
+extern void mm_init_fault_around(struct mm_struct *mm);
 #else
 static inline int handle_mm_fault(struct vm_area_struct *vma,
 		unsigned long address, unsigned int flags)
@@ -1255,6 +1284,9 @@ static inline int fixup_user_fault(struct task_struct *tsk,
 	BUG();
 	return -EFAULT;
 }
+static inline void mm_init_fault_around(struct mm_struct *mm)
+{
+}
 #endif
 
 extern int access_process_vm(struct task_struct *tsk, unsigned long addr, void *buf, int len,
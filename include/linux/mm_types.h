@@ -8,6 +8,7 @@
 #include <linux/spinlock.h>
 #include <linux/rbtree.h>
 #include <linux/rwsem.h>
+#include <linux/seqlock.h>
 #include <linux/completion.h>
 #include <linux/cpumask.h>
 #include <linux/uprobes.h>
@@ -392,10 +393,29 @@ struct mm_rss_stat {
 	atomic_long_t count[NR_MM_COUNTERS];
 };
 
+struct futex_hash_bucket;
 struct kioctx_table;
 struct mm_struct {
 	struct vm_area_struct *mmap;		/* list of VMAs */
 	struct rb_root mm_rb;
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	/*
+	 * Bumped under mmap_sem write whenever a vma is added, removed
+	 * or modified; speculative faults revalidate against it before
+	 * installing a pte. mm_rb_lock serializes the rbtree itself so
+	 * lookups do not need mmap_sem.
+	 */
+	seqcount_t mm_seq;
+	rwlock_t mm_rb_lock;
+#endif
+	/*
+	 * Flat fence-pointer index over the VMA list, built once an mm
+	 * grows large enough that rbtree walks dominate find_vma().
+	 * Maintained under mmap_sem held for write; see mm/mmap.c.
+	 */
+	struct vm_area_struct **vma_fences;
+	unsigned int nr_fences;
+	unsigned int fence_mods;	/* churn since the last rebuild */
 	u32 vmacache_seqnum;                   /* per-thread vmacache */
 #ifdef CONFIG_MMU
 	unsigned long (*get_unmapped_area) (struct file *filp,
@@ -429,11 +449,23 @@ struct mm_struct {
 
 	unsigned long total_vm;		/* Total pages mapped */
 	unsigned long locked_vm;	/* Pages that have PG_mlocked set */
+	atomic_long_t mlock_pending;	/* Pages queued for async mlock populate */
 	unsigned long pinned_vm;	/* Refcount permanently increased */
 	unsigned long data_vm;		/* VM_WRITE & ~VM_SHARED & ~VM_STACK */
 	unsigned long exec_vm;		/* VM_EXEC & ~VM_WRITE & ~VM_STACK */
 	unsigned long stack_vm;		/* VM_STACK */
 	unsigned long def_flags;
+
+	/*
+	 * Adaptive fault-around window, see do_fault_around().  The window
+	 * widens when fault-around resolves faults and narrows when faults
+	 * fall through to single-page ->fault(); the global fault_around_bytes
+	 * knob is the initial value and the upper bound.  Counter updates are
+	 * racy by design, like the rest of the fault accounting.
+	 */
+	unsigned long fault_around_bytes;
+	unsigned long fault_around_hits;
+	unsigned long fault_around_misses;
 	unsigned long start_code, end_code, start_data, end_data;
 	unsigned long start_brk, brk, start_stack;
 	unsigned long arg_start, arg_end, env_start, env_end;
@@ -511,6 +543,14 @@ struct mm_struct {
 	struct uprobes_state uprobes_state;
 #ifdef CONFIG_HUGETLB_PAGE
 	atomic_long_t hugetlb_usage;
+#endif
+#ifdef CONFIG_FUTEX
+	/*
+	 * Private hash for mm-local futexes, sized once at mm creation;
+	 * NULL means the global hash is used.  See hash_futex().
+	 */
+	struct futex_hash_bucket *futex_hash;
+	unsigned int futex_hash_mask;
 #endif
 	struct work_struct async_put_work;
 };
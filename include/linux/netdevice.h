@@ -326,6 +326,7 @@ struct napi_struct {
 	struct list_head	dev_list;
 	struct hlist_node	napi_hash_node;
 	unsigned int		napi_id;
+	struct task_struct	*thread;
 };
 
 enum {
@@ -336,6 +337,8 @@ enum {
 	NAPI_STATE_HASHED,	/* In NAPI hash (busy polling possible) */
 	NAPI_STATE_NO_BUSY_POLL,/* Do not add in napi_hash, no busy polling */
 	NAPI_STATE_IN_BUSY_POLL,/* sk_busy_loop() owns this NAPI */
+	NAPI_STATE_THREADED,	/* The poll is performed inside its own thread*/
+	NAPI_STATE_SCHED_THREADED,	/* Napi is currently scheduled in threaded mode */
 };
 
 enum {
@@ -346,6 +349,8 @@ enum {
 	NAPIF_STATE_HASHED	 = BIT(NAPI_STATE_HASHED),
 	NAPIF_STATE_NO_BUSY_POLL = BIT(NAPI_STATE_NO_BUSY_POLL),
 	NAPIF_STATE_IN_BUSY_POLL = BIT(NAPI_STATE_IN_BUSY_POLL),
+	NAPIF_STATE_THREADED	 = BIT(NAPI_STATE_THREADED),
+	NAPIF_STATE_SCHED_THREADED = BIT(NAPI_STATE_SCHED_THREADED),
 };
 
 enum gro_result {
@@ -503,6 +508,8 @@ static inline void napi_enable(struct napi_struct *n)
 	smp_mb__before_atomic();
 	clear_bit(NAPI_STATE_SCHED, &n->state);
 	clear_bit(NAPI_STATE_NPSVC, &n->state);
+	if (n->dev->threaded && n->thread)
+		set_bit(NAPI_STATE_THREADED, &n->state);
 }
 
 /**
@@ -683,6 +690,23 @@ struct netdev_rx_queue {
 #ifdef CONFIG_RPS
 	struct rps_map __rcu		*rps_map;
 	struct rps_dev_flow_table __rcu	*rps_flow_table;
+#endif
+#ifdef CONFIG_RFS_ACCEL
+	/*
+	 * Accelerated RFS filter accounting for this queue.  Filters are
+	 * counted when ndo_rx_flow_steer() succeeds and uncounted when
+	 * rps_may_expire_flow() tells the driver to remove one.  When
+	 * arfs_filter_quota is non-zero, no more than that many filters
+	 * are kept programmed at once; excess flows fall back to
+	 * software RPS until the driver's expiry scan evicts idle
+	 * filters.  The counters are lockless and may drift slightly
+	 * under concurrent updates; they are for observability only.
+	 */
+	atomic_t			arfs_filter_cnt;
+	unsigned int			arfs_filter_quota;
+	unsigned long			arfs_steered;
+	unsigned long			arfs_expired;
+	unsigned long			arfs_hits;
 #endif
 	struct kobject			kobj;
 	struct net_device		*dev;
@@ -813,6 +837,8 @@ enum xdp_netdev_command {
 	XDP_QUERY_PROG,
 };
 
+struct xdp_buff;
+
 struct netdev_xdp {
 	enum xdp_netdev_command command;
 	union {
@@ -1123,6 +1149,12 @@ struct netdev_xdp {
  * int (*ndo_xdp)(struct net_device *dev, struct netdev_xdp *xdp);
  *	This function is used to set or query state related to XDP on the
  *	netdevice. See definition of enum xdp_netdev_command for details.
+ * int (*ndo_xdp_xmit)(struct net_device *dev, struct xdp_buff *xdp);
+ *	This function is used to submit a XDP packet for transmit on a
+ *	netdevice.
+ * void (*ndo_xdp_flush)(struct net_device *dev);
+ *	This function is used to inform the driver to flush a particular
+ *	xpd tx queue. Must be called on same CPU as xdp_xmit.
  *
  */
 struct net_device_ops {
@@ -1314,6 +1346,9 @@ struct net_device_ops {
 						       int needed_headroom);
 	int			(*ndo_xdp)(struct net_device *dev,
 					   struct netdev_xdp *xdp);
+	int			(*ndo_xdp_xmit)(struct net_device *dev,
+						struct xdp_buff *xdp);
+	void			(*ndo_xdp_flush)(struct net_device *dev);
 };
 
 /**
@@ -1782,6 +1817,8 @@ struct net_device {
 #endif
 
 	unsigned long		gro_flush_timeout;
+	unsigned int		gro_udp_max_segs;
+	unsigned int		gro_udp_max_size;
 	rx_handler_func_t __rcu	*rx_handler;
 	void __rcu		*rx_handler_data;
 
@@ -1892,6 +1929,8 @@ struct net_device {
 	struct lock_class_key	*qdisc_tx_busylock;
 	struct lock_class_key	*qdisc_running_key;
 	bool			proto_down;
+	unsigned		threaded:1;
+	unsigned		xmit_batch:1;
 };
 #define to_net_dev(d) container_of(d, struct net_device, dev)
 
@@ -2082,6 +2121,16 @@ static inline void netif_tx_napi_add(struct net_device *dev,
  */
 void netif_napi_del(struct napi_struct *napi);
 
+/**
+ *	dev_set_threaded - set napi threaded mode
+ *	@dev: device
+ *	@threaded: whether the poll should run in a dedicated kthread
+ *
+ * Set the device's napi instances to run their poll function inside a
+ * per-napi kernel thread instead of the NET_RX softirq.
+ */
+int dev_set_threaded(struct net_device *dev, bool threaded);
+
 struct napi_gro_cb {
 	/* Virtual address of skb_shinfo(skb)->frags[0].page + offset. */
 	void	*frag0;
@@ -135,6 +135,9 @@ enum pageflags {
 
 	/* non-lru isolated movable page */
 	PG_isolated = PG_reclaim,
+
+	/* Free page already reported to the hypervisor, see mm/page_reporting.c */
+	PG_reported = PG_uptodate,
 };
 
 #ifndef __GENERATING_BOUNDS_H
@@ -276,6 +279,17 @@ __PAGEFLAG(Slab, slab, PF_NO_TAIL)
 __PAGEFLAG(SlobFree, slob_free, PF_NO_TAIL)
 PAGEFLAG(Checked, checked, PF_NO_COMPOUND)	   /* Used by some filesystems */
 
+/*
+ * PageReported() is only valid for pages on the buddy free lists; both
+ * manipulation sites hold zone->lock, so the non-atomic flavour suffices.
+ */
+#ifdef CONFIG_PAGE_REPORTING
+__PAGEFLAG(Reported, reported, PF_NO_COMPOUND)
+#else
+TESTPAGEFLAG_FALSE(Reported)
+__CLEARPAGEFLAG_NOOP(Reported)
+#endif
+
 /* Xen */
 PAGEFLAG(Pinned, pinned, PF_NO_COMPOUND)
 	TESTSCFLAG(Pinned, pinned, PF_NO_COMPOUND)
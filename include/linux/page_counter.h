@@ -39,7 +39,14 @@ void page_counter_charge(struct page_counter *counter, unsigned long nr_pages);
 bool page_counter_try_charge(struct page_counter *counter,
 			     unsigned long nr_pages,
 			     struct page_counter **fail);
+bool page_counter_try_charge_upto(struct page_counter *counter,
+				  struct page_counter *stop,
+				  unsigned long nr_pages,
+				  struct page_counter **fail);
 void page_counter_uncharge(struct page_counter *counter, unsigned long nr_pages);
+void page_counter_uncharge_upto(struct page_counter *counter,
+				struct page_counter *stop,
+				unsigned long nr_pages);
 int page_counter_limit(struct page_counter *counter, unsigned long limit);
 int page_counter_memparse(const char *buf, const char *max,
 			  unsigned long *nr_pages);
@@ -1,6 +1,8 @@
 #ifndef _LINUX_PIPE_FS_I_H
 #define _LINUX_PIPE_FS_I_H
 
+#include <linux/timer.h>
+
 #define PIPE_DEF_BUFFERS	16
 
 #define PIPE_BUF_FLAG_LRU	0x01	/* page is on the LRU */
@@ -8,6 +10,15 @@
 #define PIPE_BUF_FLAG_GIFT	0x04	/* page is a gift */
 #define PIPE_BUF_FLAG_PACKET	0x08	/* read() as a packet */
 
+/*
+ * The top bits of ->flags hold the allocation order of ->page, so that
+ * buffer capacity and page accounting don't need to poke at struct page
+ * internals.  Only anonymous buffers filled by pipe_write() ever carry
+ * an order greater than zero.
+ */
+#define PIPE_BUF_ORDER_SHIFT	24
+#define PIPE_BUF_ORDER_MASK	(0xffU << PIPE_BUF_ORDER_SHIFT)
+
 /**
  *	struct pipe_buffer - a linux kernel pipe buffer
  *	@page: the page containing the data for the pipe buffer
@@ -32,7 +43,9 @@ struct pipe_buffer {
  *	@nrbufs: the number of non-empty pipe buffers in this pipe
  *	@buffers: total number of buffers (should be a power of 2)
  *	@curbuf: the current pipe buffer entry
+ *	@nrpages: number of pages backing the occupied buffers
  *	@tmp_page: cached released page
+ *	@wakeup_timer: delivers reader wakeups held back by the watermark
  *	@readers: number of current readers of this pipe
  *	@writers: number of current writers of this pipe
  *	@files: number of struct file referring this pipe (protected by ->i_lock)
@@ -48,6 +61,7 @@ struct pipe_inode_info {
 	struct mutex mutex;
 	wait_queue_head_t wait;
 	unsigned int nrbufs, curbuf, buffers;
+	unsigned int nrpages;
 	unsigned int readers;
 	unsigned int writers;
 	unsigned int files;
@@ -55,6 +69,7 @@ struct pipe_inode_info {
 	unsigned int r_counter;
 	unsigned int w_counter;
 	struct page *tmp_page;
+	struct timer_list wakeup_timer;
 	struct fasync_struct *fasync_readers;
 	struct fasync_struct *fasync_writers;
 	struct pipe_buffer *bufs;
@@ -157,6 +172,38 @@ static inline int pipe_buf_steal(struct pipe_inode_info *pipe,
 	return buf->ops->steal(pipe, buf);
 }
 
+/**
+ * pipe_buf_order - allocation order of the page backing a pipe_buffer
+ * @buf:	the buffer to query
+ */
+static inline unsigned int pipe_buf_order(const struct pipe_buffer *buf)
+{
+	return (buf->flags & PIPE_BUF_ORDER_MASK) >> PIPE_BUF_ORDER_SHIFT;
+}
+
+/**
+ * pipe_buf_pages - number of pages backing a pipe_buffer
+ * @buf:	the buffer to query
+ */
+static inline unsigned int pipe_buf_pages(const struct pipe_buffer *buf)
+{
+	return 1U << pipe_buf_order(buf);
+}
+
+/**
+ * pipe_full - true if the pipe has no room for another buffer
+ * @pipe:	the pipe to check
+ *
+ * The pipe is full when every buffer slot is occupied, or when the
+ * occupied buffers between them already hold the pipe's page budget
+ * (a compound buffer takes one slot but several pages of it).
+ */
+static inline bool pipe_full(const struct pipe_inode_info *pipe)
+{
+	return pipe->nrbufs >= pipe->buffers ||
+	       pipe->nrpages >= pipe->buffers;
+}
+
 /* Differs from PIPE_BUF in that PIPE_SIZE is the length of the actual
    memory allocation, whereas PIPE_BUF makes atomicity guarantees.  */
 #define PIPE_SIZE		PAGE_SIZE
@@ -167,6 +214,7 @@ void pipe_unlock(struct pipe_inode_info *);
 void pipe_double_lock(struct pipe_inode_info *, struct pipe_inode_info *);
 
 extern unsigned int pipe_max_size, pipe_min_size;
+extern unsigned int pipe_wakeup_watermark;
 extern unsigned long pipe_user_pages_hard;
 extern unsigned long pipe_user_pages_soft;
 int pipe_proc_fn(struct ctl_table *, int, void __user *, size_t *, loff_t *);
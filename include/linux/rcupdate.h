@@ -72,11 +72,21 @@ static inline void rcu_expedite_gp(void)
 static inline void rcu_unexpedite_gp(void)
 {
 }
+
+static inline void rcu_expedite_current(void)
+{
+}
+
+static inline void rcu_unexpedite_current(void)
+{
+}
 #else /* #ifdef CONFIG_TINY_RCU */
 bool rcu_gp_is_normal(void);     /* Internal RCU use. */
 bool rcu_gp_is_expedited(void);  /* Internal RCU use. */
 void rcu_expedite_gp(void);
 void rcu_unexpedite_gp(void);
+void rcu_expedite_current(void);
+void rcu_unexpedite_current(void);
 #endif /* #else #ifdef CONFIG_TINY_RCU */
 
 enum rcutorture_type {
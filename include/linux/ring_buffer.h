@@ -2,6 +2,7 @@
 #define _LINUX_RING_BUFFER_H
 
 #include <linux/kmemcheck.h>
+#include <linux/ioctl.h>
 #include <linux/mm.h>
 #include <linux/seq_file.h>
 #include <linux/poll.h>
@@ -189,6 +190,36 @@ void ring_buffer_free_read_page(struct ring_buffer *buffer, void *data);
 int ring_buffer_read_page(struct ring_buffer *buffer, void **data_page,
 			  size_t len, int cpu, int full);
 
+/*
+ * Layout of the meta page exposed to user space when a per cpu
+ * buffer is mmapped. Page 0 of the mapping is this meta page, pages
+ * 1 .. @nr_subbufs are the sub-buffers. The id of each sub-buffer is
+ * fixed for the lifetime of the mapping; only @reader_id moves as
+ * the kernel hands out reader pages.
+ *
+ * transitional: this struct and the ioctl below belong in a uapi
+ * header (uapi/linux/trace_mmap.h) once the interface settles.
+ */
+struct trace_buffer_meta {
+	__u32	meta_page_size;
+	__u32	nr_subbufs;	/* number of mappable sub-buffers */
+	__u32	subbuf_size;	/* size of one sub-buffer (a page) */
+	__u32	reader_id;	/* sub-buffer the reader may consume */
+	__u64	reader_read;	/* bytes already consumed on that page */
+	__u64	reader_lost;	/* events lost before the reader page */
+	__u64	entries;	/* entries written */
+	__u64	overrun;	/* entries overwritten */
+	__u64	read;		/* entries consumed */
+};
+
+#define TRACE_MMAP_IOCTL_GET_READER	_IO('T', 0x1)
+
+int ring_buffer_map(struct ring_buffer *buffer, int cpu);
+int ring_buffer_unmap(struct ring_buffer *buffer, int cpu);
+struct page *ring_buffer_map_fault(struct ring_buffer *buffer, int cpu,
+				   unsigned long pgoff);
+int ring_buffer_map_get_reader(struct ring_buffer *buffer, int cpu);
+
 struct trace_seq;
 
 int ring_buffer_print_entry_header(struct trace_seq *s);
@@ -36,6 +36,15 @@ struct sbitmap_word {
 	 * @depth: Number of bits being used in @word.
 	 */
 	unsigned long depth;
+
+	/**
+	 * @cleared: Bits freed since the last batched fold into @word.
+	 *
+	 * Frees accumulate here so that each free is a single set_bit()
+	 * on a cacheline the allocators aren't hammering; the whole batch
+	 * is folded back into @word when an allocator finds it exhausted.
+	 */
+	unsigned long cleared ____cacheline_aligned_in_smp;
 } ____cacheline_aligned_in_smp;
 
 /**
@@ -123,6 +132,12 @@ struct sbitmap_queue {
 	 */
 	struct sbq_wait_state *ws;
 
+	/**
+	 * @ws_active: Number of currently active waiters. Allows the free
+	 * path to skip the wait queue scan entirely when nobody is waiting.
+	 */
+	atomic_t ws_active;
+
 	/**
 	 * @round_robin: Allocate bits in strict round-robin order.
 	 */
@@ -210,15 +225,18 @@ static inline void sbitmap_for_each_set(struct sbitmap *sb, sb_for_each_fn fn,
 
 	for (i = 0; i < sb->map_nr; i++) {
 		struct sbitmap_word *word = &sb->map[i];
+		unsigned long busy;
 		unsigned int off, nr;
 
-		if (!word->word)
+		/* Bits parked in @cleared are already free. */
+		busy = READ_ONCE(word->word) & ~READ_ONCE(word->cleared);
+		if (!busy)
 			continue;
 
 		nr = 0;
 		off = i << sb->shift;
 		while (1) {
-			nr = find_next_bit(&word->word, word->depth, nr);
+			nr = find_next_bit(&busy, word->depth, nr);
 			if (nr >= word->depth)
 				break;
 
@@ -370,4 +388,36 @@ static inline struct sbq_wait_state *sbq_wait_ptr(struct sbitmap_queue *sbq,
  */
 void sbitmap_queue_wake_all(struct sbitmap_queue *sbq);
 
+/**
+ * sbitmap_prepare_to_wait() - Start waiting for a free bit.
+ * @sbq: Bitmap queue to wait on.
+ * @ws: Wait queue, from sbq_wait_ptr().
+ * @wait: Wait descriptor.
+ * @state: Task state for prepare_to_wait().
+ *
+ * Pairs with sbitmap_finish_wait(). Keeping @ws_active accurate lets
+ * sbitmap_queue_clear() skip the wait queue scan when nobody is waiting.
+ */
+static inline void sbitmap_prepare_to_wait(struct sbitmap_queue *sbq,
+					   struct sbq_wait_state *ws,
+					   wait_queue_t *wait, int state)
+{
+	atomic_inc(&sbq->ws_active);
+	prepare_to_wait(&ws->wait, wait, state);
+}
+
+/**
+ * sbitmap_finish_wait() - Finish waiting for a free bit.
+ * @sbq: Bitmap queue waited on.
+ * @ws: Wait queue passed to sbitmap_prepare_to_wait().
+ * @wait: Wait descriptor.
+ */
+static inline void sbitmap_finish_wait(struct sbitmap_queue *sbq,
+				       struct sbq_wait_state *ws,
+				       wait_queue_t *wait)
+{
+	finish_wait(&ws->wait, wait);
+	atomic_dec(&sbq->ws_active);
+}
+
 #endif /* __LINUX_SCALE_BITMAP_H */
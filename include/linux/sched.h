@@ -990,6 +990,9 @@ enum cpu_idle_type {
 	CPU_MAX_IDLE_TYPES
 };
 
+/* log2(usec) buckets for the load_balance() cost histograms */
+#define LB_COST_HIST_BUCKETS	12
+
 /*
  * Integer metrics need fixed point arithmetic, e.g., sched/fair
  * has a few: load, load_avg, util_avg, freq, and capacity.
@@ -1153,6 +1156,7 @@ struct sched_domain {
 	unsigned int lb_hot_gained[CPU_MAX_IDLE_TYPES];
 	unsigned int lb_nobusyg[CPU_MAX_IDLE_TYPES];
 	unsigned int lb_nobusyq[CPU_MAX_IDLE_TYPES];
+	unsigned int lb_cost_hist[CPU_MAX_IDLE_TYPES][LB_COST_HIST_BUCKETS];
 
 	/* Active load balancing */
 	unsigned int alb_count;
@@ -1571,6 +1575,8 @@ struct task_struct {
 	struct list_head rcu_tasks_holdout_list;
 	int rcu_tasks_idle_cpu;
 #endif /* #ifdef CONFIG_TASKS_RCU */
+	/* Nesting depth of rcu_expedite_current(), see rcu_gp_is_expedited() */
+	int rcu_expedite_self;
 
 #ifdef CONFIG_SCHED_INFO
 	struct sched_info sched_info;
@@ -2455,6 +2461,7 @@ static inline void rcu_copy_process(struct task_struct *p)
 	INIT_LIST_HEAD(&p->rcu_tasks_holdout_list);
 	p->rcu_tasks_idle_cpu = -1;
 #endif /* #ifdef CONFIG_TASKS_RCU */
+	p->rcu_expedite_self = 0;
 }
 
 static inline void tsk_restore_flags(struct task_struct *task,
@@ -3583,6 +3590,26 @@ extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
 extern struct task_group root_task_group;
 #endif /* CONFIG_CGROUP_SCHED */
 
+/* Delays aggregated per cpu accounting group, see kernel/sched/cpuacct.c */
+enum cpuacct_delay_index {
+	CPUACCT_DELAY_RUNQ,	/* runnable, waiting for a cpu */
+	CPUACCT_DELAY_IOWAIT,	/* sleeping in io_schedule() */
+	CPUACCT_DELAY_RECLAIM,	/* direct reclaim */
+
+	CPUACCT_DELAY_NSTATS,
+};
+
+#ifdef CONFIG_CGROUP_CPUACCT
+extern void cpuacct_charge_delay(struct task_struct *tsk,
+				 enum cpuacct_delay_index index, u64 delta);
+#else
+static inline void cpuacct_charge_delay(struct task_struct *tsk,
+					enum cpuacct_delay_index index,
+					u64 delta)
+{
+}
+#endif
+
 extern int task_can_switch_user(struct user_struct *up,
 					struct task_struct *tsk);
 
@@ -3661,6 +3688,7 @@ static inline unsigned long rlimit_max(unsigned int limit)
 #define SCHED_CPUFREQ_RT	(1U << 0)
 #define SCHED_CPUFREQ_DL	(1U << 1)
 #define SCHED_CPUFREQ_IOWAIT	(1U << 2)
+#define SCHED_CPUFREQ_BURST	(1U << 3)
 
 #define SCHED_CPUFREQ_RT_DL	(SCHED_CPUFREQ_RT | SCHED_CPUFREQ_DL)
 
@@ -21,6 +21,12 @@ struct sem_array {
 	struct list_head	list_id;	/* undo requests on this array */
 	int			sem_nsems;	/* no. of semaphores in array */
 	int			complex_count;	/* pending complex operations */
+	unsigned long		complex_dep_mask; /* hashed semaphores referenced
+						 * by entries in pending_alter.
+						 * Superset; reset when the last
+						 * complex op leaves. */
+	unsigned long		complex_entries; /* stats: operations that took
+						 * the global lock path */
 	bool			complex_mode;	/* no parallel simple ops */
 };
 
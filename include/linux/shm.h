@@ -29,6 +29,17 @@ struct shmid_kernel /* private to the kernel */
 #define SHM_LOCKED      02000   /* segment will not be swapped */
 #define SHM_HUGETLB     04000   /* segment will use huge TLB pages */
 #define SHM_NORESERVE   010000  /* don't check for reservations */
+#define SHM_POPULATE    020000  /* preallocate the segment at shmget time */
+
+/*
+ * shmctl command returning the number of transparent huge pages that
+ * currently back the segment.
+ *
+ * transitional: belongs in uapi/linux/shm.h with the other SHM_ commands.
+ */
+#ifndef SHM_HUGE_STAT
+#define SHM_HUGE_STAT	15
+#endif
 
 /* Bits [26:31] are reserved */
 
@@ -14,6 +14,7 @@ enum stat_item {
 	FREE_FASTPATH,		/* Free to cpu slab */
 	FREE_SLOWPATH,		/* Freeing not to cpu slab */
 	FREE_FROZEN,		/* Freeing to frozen slab */
+	FREE_DEFER,		/* Free of remote object deferred to batch */
 	FREE_ADD_PARTIAL,	/* Freeing moves slab to partial list */
 	FREE_REMOVE_PARTIAL,	/* Freeing removes last object */
 	ALLOC_FROM_PARTIAL,	/* Cpu slab acquired from node partial list */
@@ -37,11 +38,21 @@ enum stat_item {
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
 	NR_SLUB_STAT_ITEMS };
 
+/*
+ * Remote frees are batched in a small per cpu array before being
+ * returned to their slabs in bulk.
+ */
+#define SLUB_REMOTE_FREE_OBJECTS 16
+
 struct kmem_cache_cpu {
 	void **freelist;	/* Pointer to next available object */
 	unsigned long tid;	/* Globally unique transaction id */
 	struct page *page;	/* The slab from which we are allocating */
 	struct page *partial;	/* Partially allocated frozen slabs */
+#ifdef CONFIG_SLUB_REMOTE_FREE_CACHE
+	unsigned int remote_nr;	/* Deferred remote frees in remote_objs */
+	void *remote_objs[SLUB_REMOTE_FREE_OBJECTS];
+#endif
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
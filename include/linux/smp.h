@@ -56,8 +56,24 @@ int smp_call_function_single_async(int cpu, struct call_single_data *csd);
 #include <linux/kernel.h>
 #include <linux/compiler.h>
 #include <linux/thread_info.h>
+#include <linux/completion.h>
 #include <asm/smp.h>
 
+/*
+ * Context for smp_call_function_many_async(): one completion fires
+ * when the function has run on every targeted cpu, instead of the
+ * caller spinning on each target's csd in turn.
+ */
+struct smp_call_many_data {
+	smp_call_func_t func;
+	void *info;
+	atomic_t pending;
+	struct completion done;
+};
+
+int smp_call_function_many_async(const struct cpumask *mask,
+				 struct smp_call_many_data *data);
+
 /*
  * main cross-CPU interfaces, handles INIT, TLB flush, STOP, etc.
  * (defined in asm header):
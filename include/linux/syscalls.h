@@ -57,6 +57,8 @@ struct timezone;
 struct tms;
 struct utimbuf;
 struct mq_attr;
+struct mq_msgv;
+struct eventfd_val;
 struct compat_stat;
 struct compat_timeval;
 struct robust_list_head;
@@ -497,6 +499,8 @@ asmlinkage long sys_ioctl(unsigned int fd, unsigned int cmd,
 				unsigned long arg);
 asmlinkage long sys_flock(unsigned int fd, unsigned int cmd);
 asmlinkage long sys_io_setup(unsigned nr_reqs, aio_context_t __user *ctx);
+asmlinkage long sys_io_setup2(unsigned nr_reqs, unsigned flags,
+				aio_context_t __user *ctx);
 asmlinkage long sys_io_destroy(aio_context_t ctx);
 asmlinkage long sys_io_getevents(aio_context_t ctx_id,
 				long min_nr,
@@ -685,6 +689,8 @@ asmlinkage long sys_mq_open(const char __user *name, int oflag, umode_t mode, st
 asmlinkage long sys_mq_unlink(const char __user *name);
 asmlinkage long sys_mq_timedsend(mqd_t mqdes, const char __user *msg_ptr, size_t msg_len, unsigned int msg_prio, const struct timespec __user *abs_timeout);
 asmlinkage long sys_mq_timedreceive(mqd_t mqdes, char __user *msg_ptr, size_t msg_len, unsigned int __user *msg_prio, const struct timespec __user *abs_timeout);
+asmlinkage long sys_mq_sendv(mqd_t mqdes, struct mq_msgv __user *msgv, unsigned int nr_msgs, const struct timespec __user *abs_timeout);
+asmlinkage long sys_mq_receivev(mqd_t mqdes, struct mq_msgv __user *msgv, unsigned int nr_msgs, const struct timespec __user *abs_timeout);
 asmlinkage long sys_mq_notify(mqd_t mqdes, const struct sigevent __user *notification);
 asmlinkage long sys_mq_getsetattr(mqd_t mqdes, const struct mq_attr __user *mqstat, struct mq_attr __user *omqstat);
 
@@ -815,6 +821,8 @@ asmlinkage long sys_timerfd_settime(int ufd, int flags,
 asmlinkage long sys_timerfd_gettime(int ufd, struct itimerspec __user *otmr);
 asmlinkage long sys_eventfd(unsigned int count);
 asmlinkage long sys_eventfd2(unsigned int count, int flags);
+asmlinkage long sys_eventfd_readv(struct eventfd_val __user *vals,
+				  unsigned int nvals);
 asmlinkage long sys_memfd_create(const char __user *uname_ptr, unsigned int flags);
 asmlinkage long sys_userfaultfd(int flags);
 asmlinkage long sys_fallocate(int fd, int mode, loff_t offset, loff_t len);
@@ -895,6 +903,16 @@ asmlinkage long sys_membarrier(int cmd, int flags);
 asmlinkage long sys_copy_file_range(int fd_in, loff_t __user *off_in,
 				    int fd_out, loff_t __user *off_out,
 				    size_t len, unsigned int flags);
+struct copy_range_desc;
+asmlinkage long sys_copy_file_range_batch(struct copy_range_desc __user *descs,
+					  unsigned int nr, unsigned int flags);
+struct readfile_entry;
+asmlinkage long sys_readfiles(struct readfile_entry __user *uentries,
+			      unsigned int nr, unsigned int flags);
+struct linux_dirent_plus;
+asmlinkage long sys_getdents_plus(unsigned int fd,
+				  struct linux_dirent_plus __user *dirent,
+				  unsigned int count);
 
 asmlinkage long sys_mlock2(unsigned long start, size_t len, int flags);
 
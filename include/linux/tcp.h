@@ -19,12 +19,43 @@
 
 
 #include <linux/skbuff.h>
+#include <linux/hrtimer.h>
 #include <linux/win_minmax.h>
 #include <net/sock.h>
 #include <net/inet_connection_sock.h>
 #include <net/inet_timewait_sock.h>
 #include <uapi/linux/tcp.h>
 
+/* transitional: belongs in uapi tcp.h next to the other socket options */
+#ifndef TCP_ZEROCOPY_RECEIVE
+#define TCP_ZEROCOPY_RECEIVE	35
+
+struct tcp_zerocopy_receive {
+	__u64 address;		/* in: address of mapping */
+	__u32 length;		/* in: number of bytes to map/copy
+				 * out: amount of bytes mapped
+				 */
+	__u32 recv_skip_hint;	/* out: amount of bytes to skip */
+};
+#endif
+
+/* transitional: belongs in uapi tcp.h next to the other socket options */
+#ifndef TCP_ULP
+#define TCP_ULP			31	/* Attach a ULP to a TCP connection */
+#endif
+
+/* transitional: belongs in uapi tcp.h next to the other socket options */
+#ifndef TCP_BATCH_OPTS
+#define TCP_BATCH_OPTS		36	/* Apply several int options at once */
+
+struct tcp_opt_val {
+	__u32	opt;		/* TCP_* option taking a plain int value */
+	__u32	val;
+};
+
+#define TCP_BATCH_OPTS_MAX	16
+#endif
+
 static inline struct tcphdr *tcp_hdr(const struct sk_buff *skb)
 {
 	return (struct tcphdr *)skb_transport_header(skb);
@@ -191,6 +222,7 @@ struct tcp_sock {
 	u32	tsoffset;	/* timestamp offset */
 
 	struct list_head tsq_node; /* anchor in tsq_tasklet.head list */
+	struct hrtimer	pacing_timer; /* internal pacing, if not done by fq */
 
 	/* Data for direct copy to user */
 	struct {
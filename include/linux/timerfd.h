@@ -10,10 +10,19 @@
 
 #include <uapi/linux/timerfd.h>
 
+/* transitional: belongs in uapi timerfd.h next to TFD_TIMER_CANCEL_ON_SET.
+ * Arm the timer with the task's timer slack (PR_SET_TIMERSLACK) as the
+ * expiry range, so neighbouring expiries coalesce into one hrtimer event.
+ */
+#ifndef TFD_TIMER_SLACK
+#define TFD_TIMER_SLACK (1 << 2)
+#endif
+
 #define TFD_SHARED_FCNTL_FLAGS (TFD_CLOEXEC | TFD_NONBLOCK)
 /* Flags for timerfd_create.  */
 #define TFD_CREATE_FLAGS TFD_SHARED_FCNTL_FLAGS
 /* Flags for timerfd_settime.  */
-#define TFD_SETTIME_FLAGS (TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET)
+#define TFD_SETTIME_FLAGS (TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET | \
+			   TFD_TIMER_SLACK)
 
 #endif /* _LINUX_TIMERFD_H */
@@ -104,6 +104,9 @@ struct work_struct {
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WQ_LATENCY_HIST
+	u64 enq_time;		/* when the item was put on a worklist */
+#endif
 };
 
 #define WORK_DATA_INIT()	ATOMIC_LONG_INIT(WORK_STRUCT_NO_POOL)
@@ -321,6 +324,16 @@ enum {
 	 */
 	WQ_POWER_EFFICIENT	= 1 << 7,
 
+	/*
+	 * An express workqueue runs its work items from a third per-cpu
+	 * worker pool whose workers are SCHED_FIFO, so they preempt the
+	 * normal and highpri pools instead of queueing behind them.
+	 * Reserved for short, latency-critical items such as IO
+	 * completions; implies per-cpu and cannot be combined with
+	 * WQ_UNBOUND.
+	 */
+	WQ_EXPRESS		= 1 << 8, /* express lane, SCHED_FIFO workers */
+
 	__WQ_DRAINING		= 1 << 16, /* internal: workqueue is draining */
 	__WQ_ORDERED		= 1 << 17, /* internal: workqueue is ordered */
 	__WQ_LEGACY		= 1 << 18, /* internal: create*_workqueue() */
@@ -278,6 +278,8 @@ int fib6_add(struct fib6_node *root, struct rt6_info *rt,
 	     struct nl_info *info, struct mx6_config *mxc);
 int fib6_del(struct rt6_info *rt, struct nl_info *info);
 
+void rt6_release(struct rt6_info *rt);
+
 void inet6_rt_notify(int event, struct rt6_info *rt, struct nl_info *info,
 		     unsigned int flags);
 
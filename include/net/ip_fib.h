@@ -227,12 +227,15 @@ int unregister_fib_notifier(struct notifier_block *nb);
 int call_fib_notifiers(struct net *net, enum fib_event_type event_type,
 		       struct fib_notifier_info *info);
 
+struct fib_replicas;
+
 struct fib_table {
 	struct hlist_node	tb_hlist;
 	u32			tb_id;
 	int			tb_num_default;
 	struct rcu_head		rcu;
 	unsigned long 		*tb_data;
+	struct fib_replicas __rcu *tb_replicas;
 	unsigned long		__data[0];
 };
 
@@ -247,6 +250,12 @@ struct fib_table *fib_trie_unmerge(struct fib_table *main_tb);
 void fib_table_flush_external(struct fib_table *table);
 void fib_free_table(struct fib_table *tb);
 
+struct ctl_table;
+
+extern int sysctl_fib_numa_replicas;
+int proc_fib_numa_replicas(struct ctl_table *table, int write,
+			   void __user *buffer, size_t *lenp, loff_t *ppos);
+
 #ifndef CONFIG_IP_MULTIPLE_TABLES
 
 #define TABLE_LOCAL_INDEX	(RT_TABLE_LOCAL & (FIB_TABLE_HASHSZ - 1))
@@ -187,6 +187,18 @@ struct neigh_hash_table {
 };
 
 
+#define NEIGH_HOT_CACHE_SIZE	4
+
+/* Per-CPU cache of recently resolved neighbours, sized for the handful
+ * of gateways that carry almost all forwarded traffic.  Slots hold a
+ * reference on the entry; they are re-validated against ->dead on every
+ * hit and dropped once the entry has left the table.
+ */
+struct neigh_hot_cache {
+	struct neighbour	*neigh[NEIGH_HOT_CACHE_SIZE];
+	unsigned int		idx;
+};
+
 struct neigh_table {
 	int			family;
 	int			entry_size;
@@ -214,8 +226,10 @@ struct neigh_table {
 	atomic_t		entries;
 	rwlock_t		lock;
 	unsigned long		last_rand;
+	u32			gc_bucket;
 	struct neigh_statistics	__percpu *stats;
 	struct neigh_hash_table __rcu *nht;
+	struct neigh_hot_cache	__percpu *hot_cache;
 	struct pneigh_entry	**phash_buckets;
 };
 
@@ -267,6 +281,10 @@ static inline bool neigh_key_eq128(const struct neighbour *n, const void *pkey)
 		(n32[2] ^ p32[2]) | (n32[3] ^ p32[3])) == 0;
 }
 
+void neigh_hot_cache_insert(struct neigh_hot_cache *hc, struct neighbour *n);
+void neigh_hot_cache_evict(struct neigh_hot_cache *hc, unsigned int i,
+			   struct neighbour *n);
+
 static inline struct neighbour *___neigh_lookup_noref(
 	struct neigh_table *tbl,
 	bool (*key_eq)(const struct neighbour *n, const void *pkey),
@@ -277,15 +295,29 @@ static inline struct neighbour *___neigh_lookup_noref(
 	struct net_device *dev)
 {
 	struct neigh_hash_table *nht = rcu_dereference_bh(tbl->nht);
+	struct neigh_hot_cache *hc = this_cpu_ptr(tbl->hot_cache);
 	struct neighbour *n;
+	unsigned int i;
 	u32 hash_val;
 
+	for (i = 0; i < NEIGH_HOT_CACHE_SIZE; i++) {
+		n = READ_ONCE(hc->neigh[i]);
+		if (!n || n->dev != dev || !key_eq(n, pkey))
+			continue;
+		if (likely(!READ_ONCE(n->dead)))
+			return n;
+		/* the entry has left the table, drop the cached ref */
+		neigh_hot_cache_evict(hc, i, n);
+	}
+
 	hash_val = hash(pkey, dev, nht->hash_rnd) >> (32 - nht->hash_shift);
 	for (n = rcu_dereference_bh(nht->hash_buckets[hash_val]);
 	     n != NULL;
 	     n = rcu_dereference_bh(n->next)) {
-		if (n->dev == dev && key_eq(n, pkey))
+		if (n->dev == dev && key_eq(n, pkey)) {
+			neigh_hot_cache_insert(hc, n);
 			return n;
+		}
 	}
 
 	return NULL;
@@ -10,6 +10,7 @@
 #include <linux/rcupdate.h>
 
 struct tcpm_hash_bucket;
+struct bpf_prog;
 struct ctl_table_header;
 struct ipv4_devconf;
 struct fib_rules_ops;
@@ -55,6 +56,7 @@ struct netns_ipv4 {
 
 	struct inet_peer_base	*peers;
 	struct sock  * __percpu	*tcp_sk;
+	struct bpf_prog __rcu	*sk_lookup_prog;
 	struct netns_frags	frags;
 #ifdef CONFIG_NETFILTER
 	struct xt_table		*iptable_filter;
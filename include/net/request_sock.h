@@ -168,8 +168,23 @@ struct request_sock_queue {
 	atomic_t		qlen;
 	atomic_t		young;
 
+	/* Producer side of the accept queue, fed from softirq context.
+	 * rskq_added is written under rskq_lock, so that
+	 * rskq_added - rskq_removed is the number of not yet accepted
+	 * children without a counter shared between both sides.
+	 */
+	u32			rskq_added;
 	struct request_sock	*rskq_accept_head;
 	struct request_sock	*rskq_accept_tail;
+
+	/* Consumer side. accept()ers are already serialized by the
+	 * listener socket lock, so the batch needs no extra locking: it
+	 * is refilled by splicing the whole producer list in one
+	 * rskq_lock section instead of taking the lock for every child.
+	 */
+	u32			rskq_removed;
+	struct request_sock	*rskq_batch_head;
+
 	struct fastopen_queue	fastopenq;  /* Check max_qlen != 0 to determine
 					     * if TFO is enabled.
 					     */
@@ -180,9 +195,19 @@ void reqsk_queue_alloc(struct request_sock_queue *queue);
 void reqsk_fastopen_remove(struct sock *sk, struct request_sock *req,
 			   bool reset);
 
+static inline int reqsk_queue_accept_len(const struct request_sock_queue *queue)
+{
+	u32 removed = READ_ONCE(queue->rskq_removed);
+
+	/* Read rskq_removed first: a stale rskq_added can only make the
+	 * queue look shorter, never report children that are not there.
+	 */
+	return (int)(READ_ONCE(queue->rskq_added) - removed);
+}
+
 static inline bool reqsk_queue_empty(const struct request_sock_queue *queue)
 {
-	return queue->rskq_accept_head == NULL;
+	return reqsk_queue_accept_len(queue) == 0;
 }
 
 static inline struct request_sock *reqsk_queue_remove(struct request_sock_queue *queue,
@@ -190,15 +215,18 @@ static inline struct request_sock *reqsk_queue_remove(struct request_sock_queue
 {
 	struct request_sock *req;
 
-	spin_lock_bh(&queue->rskq_lock);
-	req = queue->rskq_accept_head;
+	req = queue->rskq_batch_head;
+	if (!req) {
+		spin_lock_bh(&queue->rskq_lock);
+		req = queue->rskq_accept_head;
+		queue->rskq_accept_head = NULL;
+		queue->rskq_accept_tail = NULL;
+		spin_unlock_bh(&queue->rskq_lock);
+	}
 	if (req) {
-		sk_acceptq_removed(parent);
-		queue->rskq_accept_head = req->dl_next;
-		if (queue->rskq_accept_head == NULL)
-			queue->rskq_accept_tail = NULL;
+		queue->rskq_batch_head = req->dl_next;
+		WRITE_ONCE(queue->rskq_removed, queue->rskq_removed + 1);
 	}
-	spin_unlock_bh(&queue->rskq_lock);
 	return req;
 }
 
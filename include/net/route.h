@@ -304,12 +304,22 @@ static inline struct rtable *ip_route_newports(struct flowi4 *fl4, struct rtable
 	if (sport != orig_sport || dport != orig_dport) {
 		fl4->fl4_dport = dport;
 		fl4->fl4_sport = sport;
-		ip_rt_put(rt);
-		flowi4_update_output(fl4, sk->sk_bound_dev_if,
-				     RT_CONN_FLAGS(sk), fl4->daddr,
-				     fl4->saddr);
-		security_sk_classify_flow(sk, flowi4_to_flowi(fl4));
-		return ip_route_output_flow(sock_net(sk), fl4, sk);
+#ifdef CONFIG_XFRM
+		/* The second lookup only exists to catch IPSEC policies
+		 * keyed on the port information.  If neither the namespace
+		 * nor the socket has output policies, the route we already
+		 * hold is the one the full key would find.
+		 */
+		if (sock_net(sk)->xfrm.policy_count[XFRM_POLICY_OUT] ||
+		    rcu_access_pointer(sk->sk_policy[XFRM_POLICY_OUT])) {
+			ip_rt_put(rt);
+			flowi4_update_output(fl4, sk->sk_bound_dev_if,
+					     RT_CONN_FLAGS(sk), fl4->daddr,
+					     fl4->saddr);
+			security_sk_classify_flow(sk, flowi4_to_flowi(fl4));
+			return ip_route_output_flow(sock_net(sk), fl4, sk);
+		}
+#endif
 	}
 	return rt;
 }
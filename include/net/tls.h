@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016-2017, Mellanox Technologies. All rights reserved.
+ * Copyright (c) 2016-2017, Dave Watson <davejwatson@fb.com>. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * OpenIB.org BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TLS_OFFLOAD_H
+#define _TLS_OFFLOAD_H
+
+#include <linux/types.h>
+#include <linux/tls.h>
+#include <crypto/aead.h>
+#include <net/tcp.h>
+
+/* TLS 1.2 record layer framing */
+#define TLS_HEADER_SIZE		5
+#define TLS_NONCE_OFFSET	TLS_HEADER_SIZE
+#define TLS_RECORD_TYPE_DATA	0x17
+
+/* Maximum plaintext payload of a single record (RFC 5246) */
+#define TLS_MAX_PAYLOAD_SIZE	((size_t)1 << 14)
+
+/* AAD is seq_num(8) || type(1) || version(2) || length(2) */
+#define TLS_AAD_SPACE_SIZE	13
+
+/* header + explicit nonce; plaintext is staged right behind it so the
+ * whole record is contiguous once the tag lands at the end
+ */
+#define TLS_PREFIX_SIZE		(TLS_HEADER_SIZE + \
+				 TLS_CIPHER_AES_GCM_128_IV_SIZE)
+#define TLS_OVERHEAD		(TLS_PREFIX_SIZE + \
+				 TLS_CIPHER_AES_GCM_128_TAG_SIZE)
+#define TLS_REC_PAGE_ORDER	get_order(TLS_MAX_PAYLOAD_SIZE + TLS_OVERHEAD)
+
+struct tls_sw_context {
+	struct crypto_aead *aead_send;
+	struct aead_request *aead_req;
+
+	/* Record buffer: one physically contiguous allocation holding
+	 * header, explicit nonce, payload and tag, so the encrypted
+	 * record can be handed to do_tcp_sendpages() as-is.
+	 */
+	struct page *rec_page;
+	unsigned int rec_len;		/* plaintext bytes staged */
+	unsigned int push_off;		/* push progress within rec_page */
+	unsigned int push_len;		/* encrypted bytes not yet sent */
+
+	u8 aad_space[TLS_AAD_SPACE_SIZE];
+	u8 iv[TLS_CIPHER_AES_GCM_128_SALT_SIZE +
+	      TLS_CIPHER_AES_GCM_128_IV_SIZE];
+	u8 rec_seq[TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE];
+};
+
+struct tls_context {
+	union {
+		struct tls_crypto_info crypto_send;
+		struct tls12_crypto_info_aes_gcm_128 crypto_send_aes_gcm_128;
+	};
+
+	void *priv_ctx;
+
+	void (*sk_proto_close)(struct sock *sk, long timeout);
+};
+
+int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx);
+int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size);
+int tls_sw_sendpage(struct sock *sk, struct page *page,
+		    int offset, size_t size, int flags);
+void tls_sw_close(struct sock *sk);
+void tls_sw_free_resources(struct sock *sk);
+
+static inline struct tls_context *tls_get_ctx(const struct sock *sk)
+{
+	struct inet_connection_sock *icsk = inet_csk(sk);
+
+	return icsk->icsk_ulp_data;
+}
+
+static inline struct tls_sw_context *tls_sw_ctx(
+		const struct tls_context *tls_ctx)
+{
+	return (struct tls_sw_context *)tls_ctx->priv_ctx;
+}
+
+#endif /* _TLS_OFFLOAD_H */
@@ -29,6 +29,7 @@
  * Flags for mlock
  */
 #define MLOCK_ONFAULT	0x01		/* Lock pages in range after they are faulted in, do not prefault */
+#define MLOCK_ASYNC	0x02		/* Lock pages in range, prefault them from a worker after return */
 
 #define MS_ASYNC	1		/* sync memory asynchronously */
 #define MS_INVALIDATE	2		/* invalidate the caches */
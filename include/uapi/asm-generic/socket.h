@@ -94,4 +94,6 @@
 
 #define SCM_TIMESTAMPING_OPT_STATS	54
 
+#define SO_ZEROCOPY		55
+
 #endif /* __ASM_GENERIC_SOCKET_H */
@@ -1179,6 +1179,347 @@ out:
 	return ret;
 }
 
+/*
+ * Batch variants of mq_timedsend()/mq_timedreceive(): move up to
+ * MQ_MSGV_MAX messages under a single info->lock acquisition, with all
+ * wakeups gathered on one wake_q and issued in a single pass after the
+ * lock is dropped. Blocking (and the timeout) applies to the first
+ * message only; once at least one message has been transferred the call
+ * returns the count instead of sleeping, like readv() does on a pipe.
+ *
+ * The descriptor layout is transitional and belongs in
+ * uapi/linux/mqueue.h:
+ */
+struct mq_msgv {
+	__u64		msg_ptr;	/* message buffer */
+	__u64		msg_len;	/* buffer length; actual message
+					 * length on mq_receivev() return */
+	__u32		msg_prio;	/* message priority */
+	__u32		__reserved;	/* must be 0 */
+};
+
+#define MQ_MSGV_MAX	64	/* messages moved per lock acquisition */
+
+SYSCALL_DEFINE4(mq_sendv, mqd_t, mqdes, struct mq_msgv __user *, u_msgv,
+		unsigned int, nr_msgs,
+		const struct timespec __user *, u_abs_timeout)
+{
+	struct fd f;
+	struct inode *inode;
+	struct ext_wait_queue wait;
+	struct ext_wait_queue *receiver;
+	struct mqueue_inode_info *info;
+	ktime_t expires, *timeout = NULL;
+	struct timespec ts;
+	struct posix_msg_tree_node *new_leaf = NULL;
+	struct mq_msgv *msgv;
+	struct msg_msg **msgs;
+	unsigned int i, sent = 0;
+	int ret = 0;
+	DEFINE_WAKE_Q(wake_q);
+
+	if (nr_msgs == 0 || nr_msgs > MQ_MSGV_MAX)
+		return -EINVAL;
+
+	if (u_abs_timeout) {
+		int res = prepare_timeout(u_abs_timeout, &expires, &ts);
+		if (res)
+			return res;
+		timeout = &expires;
+	}
+
+	msgv = kmalloc_array(nr_msgs, sizeof(*msgv), GFP_KERNEL);
+	if (!msgv)
+		return -ENOMEM;
+	msgs = kcalloc(nr_msgs, sizeof(*msgs), GFP_KERNEL);
+	if (!msgs) {
+		kfree(msgv);
+		return -ENOMEM;
+	}
+
+	ret = -EFAULT;
+	if (copy_from_user(msgv, u_msgv, nr_msgs * sizeof(*msgv)))
+		goto out;
+
+	audit_mq_sendrecv(mqdes, msgv[0].msg_len, msgv[0].msg_prio,
+			  timeout ? &ts : NULL);
+
+	f = fdget(mqdes);
+	if (unlikely(!f.file)) {
+		ret = -EBADF;
+		goto out;
+	}
+
+	inode = file_inode(f.file);
+	if (unlikely(f.file->f_op != &mqueue_file_operations)) {
+		ret = -EBADF;
+		goto out_fput;
+	}
+	info = MQUEUE_I(inode);
+	audit_file(f.file);
+
+	if (unlikely(!(f.file->f_mode & FMODE_WRITE))) {
+		ret = -EBADF;
+		goto out_fput;
+	}
+
+	/* Load all messages up front, before touching the queue. */
+	for (i = 0; i < nr_msgs; i++) {
+		if (msgv[i].__reserved ||
+		    msgv[i].msg_prio >= (unsigned long) MQ_PRIO_MAX) {
+			ret = -EINVAL;
+			goto out_free_msgs;
+		}
+		if (msgv[i].msg_len > info->attr.mq_msgsize) {
+			ret = -EMSGSIZE;
+			goto out_free_msgs;
+		}
+		msgs[i] = load_msg(u64_to_user_ptr(msgv[i].msg_ptr),
+				   msgv[i].msg_len);
+		if (IS_ERR(msgs[i])) {
+			ret = PTR_ERR(msgs[i]);
+			msgs[i] = NULL;
+			goto out_free_msgs;
+		}
+		msgs[i]->m_ts = msgv[i].msg_len;
+		msgs[i]->m_type = msgv[i].msg_prio;
+	}
+
+	/*
+	 * msg_insert really wants us to have a valid, spare node struct so
+	 * it doesn't have to kmalloc a GFP_ATOMIC allocation, but it will
+	 * fall back to that if necessary.
+	 */
+	if (!info->node_cache)
+		new_leaf = kmalloc(sizeof(*new_leaf), GFP_KERNEL);
+
+	spin_lock(&info->lock);
+
+	if (!info->node_cache && new_leaf) {
+		/* Save our speculative allocation into the cache */
+		INIT_LIST_HEAD(&new_leaf->msg_list);
+		info->node_cache = new_leaf;
+	} else {
+		kfree(new_leaf);
+	}
+
+	while (sent < nr_msgs) {
+		if (info->attr.mq_curmsgs == info->attr.mq_maxmsg) {
+			if (sent || (f.file->f_flags & O_NONBLOCK)) {
+				if (!sent)
+					ret = -EAGAIN;
+				break;
+			}
+			wait.task = current;
+			wait.msg = (void *) msgs[0];
+			wait.state = STATE_NONE;
+			ret = wq_sleep(info, SEND, timeout, &wait);
+			/*
+			 * wq_sleep must be called with info->lock held, and
+			 * returns with the lock released
+			 */
+			if (ret)
+				goto out_free_msgs;
+			msgs[0] = NULL;
+			sent = 1;
+			spin_lock(&info->lock);
+			continue;
+		}
+		receiver = wq_get_first_waiter(info, RECV);
+		if (receiver) {
+			pipelined_send(&wake_q, info, msgs[sent], receiver);
+		} else {
+			/* adds message to the queue */
+			ret = msg_insert(msgs[sent], info);
+			if (ret)
+				break;
+			__do_notify(info);
+		}
+		msgs[sent] = NULL;
+		sent++;
+	}
+	if (sent)
+		inode->i_atime = inode->i_mtime = inode->i_ctime =
+				current_time(inode);
+	spin_unlock(&info->lock);
+	wake_up_q(&wake_q);
+
+out_free_msgs:
+	for (i = 0; i < nr_msgs; i++) {
+		if (msgs[i])
+			free_msg(msgs[i]);
+	}
+	if (sent)
+		ret = sent;
+out_fput:
+	fdput(f);
+out:
+	kfree(msgs);
+	kfree(msgv);
+	return ret;
+}
+
+SYSCALL_DEFINE4(mq_receivev, mqd_t, mqdes, struct mq_msgv __user *, u_msgv,
+		unsigned int, nr_msgs,
+		const struct timespec __user *, u_abs_timeout)
+{
+	struct fd f;
+	struct inode *inode;
+	struct ext_wait_queue wait;
+	struct mqueue_inode_info *info;
+	ktime_t expires, *timeout = NULL;
+	struct timespec ts;
+	struct posix_msg_tree_node *new_leaf = NULL;
+	struct mq_msgv *msgv;
+	struct msg_msg **msgs;
+	unsigned int i, got = 0, delivered = 0;
+	int ret = 0;
+	DEFINE_WAKE_Q(wake_q);
+
+	if (nr_msgs == 0 || nr_msgs > MQ_MSGV_MAX)
+		return -EINVAL;
+
+	if (u_abs_timeout) {
+		int res = prepare_timeout(u_abs_timeout, &expires, &ts);
+		if (res)
+			return res;
+		timeout = &expires;
+	}
+
+	msgv = kmalloc_array(nr_msgs, sizeof(*msgv), GFP_KERNEL);
+	if (!msgv)
+		return -ENOMEM;
+	msgs = kcalloc(nr_msgs, sizeof(*msgs), GFP_KERNEL);
+	if (!msgs) {
+		kfree(msgv);
+		return -ENOMEM;
+	}
+
+	ret = -EFAULT;
+	if (copy_from_user(msgv, u_msgv, nr_msgs * sizeof(*msgv)))
+		goto out;
+
+	audit_mq_sendrecv(mqdes, msgv[0].msg_len, 0, timeout ? &ts : NULL);
+
+	f = fdget(mqdes);
+	if (unlikely(!f.file)) {
+		ret = -EBADF;
+		goto out;
+	}
+
+	inode = file_inode(f.file);
+	if (unlikely(f.file->f_op != &mqueue_file_operations)) {
+		ret = -EBADF;
+		goto out_fput;
+	}
+	info = MQUEUE_I(inode);
+	audit_file(f.file);
+
+	if (unlikely(!(f.file->f_mode & FMODE_READ))) {
+		ret = -EBADF;
+		goto out_fput;
+	}
+
+	/* checks if every buffer is big enough */
+	for (i = 0; i < nr_msgs; i++) {
+		if (msgv[i].__reserved) {
+			ret = -EINVAL;
+			goto out_fput;
+		}
+		if (msgv[i].msg_len < info->attr.mq_msgsize) {
+			ret = -EMSGSIZE;
+			goto out_fput;
+		}
+	}
+
+	/*
+	 * msg_insert really wants us to have a valid, spare node struct so
+	 * it doesn't have to kmalloc a GFP_ATOMIC allocation, but it will
+	 * fall back to that if necessary.
+	 */
+	if (!info->node_cache)
+		new_leaf = kmalloc(sizeof(*new_leaf), GFP_KERNEL);
+
+	spin_lock(&info->lock);
+
+	if (!info->node_cache && new_leaf) {
+		/* Save our speculative allocation into the cache */
+		INIT_LIST_HEAD(&new_leaf->msg_list);
+		info->node_cache = new_leaf;
+	} else {
+		kfree(new_leaf);
+	}
+
+	while (got < nr_msgs) {
+		if (info->attr.mq_curmsgs == 0) {
+			if (got || (f.file->f_flags & O_NONBLOCK)) {
+				if (!got)
+					ret = -EAGAIN;
+				break;
+			}
+			wait.task = current;
+			wait.state = STATE_NONE;
+			ret = wq_sleep(info, RECV, timeout, &wait);
+			/*
+			 * wq_sleep must be called with info->lock held, and
+			 * returns with the lock released
+			 */
+			if (ret)
+				goto out_free_msgs;
+			msgs[0] = wait.msg;
+			got = 1;
+			spin_lock(&info->lock);
+			continue;
+		}
+		msgs[got++] = msg_get(info);
+
+		/* There is now free space in queue. */
+		pipelined_receive(&wake_q, info);
+	}
+	if (got)
+		inode->i_atime = inode->i_mtime = inode->i_ctime =
+				current_time(inode);
+	spin_unlock(&info->lock);
+	wake_up_q(&wake_q);
+
+	/*
+	 * Copy out what we got. As in mq_timedreceive(), a message whose
+	 * copy-out faults has already left the queue and is lost.
+	 */
+	for (i = 0; i < got; i++) {
+		msgv[i].msg_len = msgs[i]->m_ts;
+		msgv[i].msg_prio = msgs[i]->m_type;
+		if (store_msg(u64_to_user_ptr(msgv[i].msg_ptr), msgs[i],
+			      msgs[i]->m_ts)) {
+			if (!i)
+				ret = -EFAULT;
+			break;
+		}
+		free_msg(msgs[i]);
+		msgs[i] = NULL;
+		delivered++;
+	}
+	if (delivered &&
+	    copy_to_user(u_msgv, msgv, delivered * sizeof(*msgv))) {
+		delivered = 0;
+		ret = -EFAULT;
+	}
+
+out_free_msgs:
+	for (i = 0; i < nr_msgs; i++) {
+		if (msgs[i])
+			free_msg(msgs[i]);
+	}
+	if (delivered)
+		ret = delivered;
+out_fput:
+	fdput(f);
+out:
+	kfree(msgs);
+	kfree(msgv);
+	return ret;
+}
+
 /*
  * Notes: the case when user wants us to deregister (with NULL as pointer)
  * and he isn't currently owner of notification, will be silently discarded.
@@ -67,6 +67,10 @@
  *   and per-semaphore list (stored in the array). This allows to achieve FIFO
  *   ordering without always scanning all pending operations.
  *   The worst-case behavior is nevertheless O(N^2) for N wakeups.
+ * - Single-sop operations stay on the per-semaphore lists while the
+ *   sleeping complex operations do not reference their semaphore; only
+ *   overlapping operations are merged into the per-array list
+ *   (see sem_array.complex_dep_mask).
  */
 
 #include <linux/slab.h>
@@ -117,6 +121,8 @@ struct sem_queue {
 	int			nsops;	 /* number of operations */
 	bool			alter;	 /* does *sops alter the array? */
 	bool                    dupsop;	 /* sops on more than one sem_num */
+	unsigned long		dep_mask; /* hashed semaphores referenced by
+					  * *sops (see semtimedop) */
 };
 
 /* Each task has a list of undo requests. They are executed automatically
@@ -164,6 +170,8 @@ static int sysvipc_sem_proc_show(struct seq_file *s, void *it);
  *	sem_undo.id_next,
  *	sem_array.complex_count,
  *	sem_array.complex_mode
+ *	sem_array.complex_dep_mask,
+ *	sem_array.complex_entries,
  *	sem_array.pending{_alter,_const},
  *	sem_array.sem_undo
  *
@@ -204,7 +212,7 @@ void __init sem_init(void)
 {
 	sem_init_ns(&init_ipc_ns);
 	ipc_init_proc_interface("sysvipc/sem",
-				"       key      semid perms      nsems   uid   gid  cuid  cgid      otime      ctime\n",
+				"       key      semid perms      nsems   uid   gid  cuid  cgid      otime      ctime    complex\n",
 				IPC_SEM_IDS, sysvipc_sem_proc_show);
 }
 
@@ -234,24 +242,33 @@ static void unmerge_queues(struct sem_array *sma)
 		list_add_tail(&q->list, &curr->pending_alter);
 	}
 	INIT_LIST_HEAD(&sma->pending_alter);
+	sma->complex_dep_mask = 0;
 }
 
 /**
  * merge_queues - merge single semop queues into global queue
  * @sma: semaphore array
+ * @dep_mask: hashed semaphores referenced by the sleeping multi-semop
+ *            operation
  *
- * This function merges all per-semaphore queues into the global queue.
- * It is necessary to achieve FIFO ordering for the pending single-sop
- * operations when a multi-semop operation must sleep.
+ * This function merges the per-semaphore queues of the semaphores in
+ * @dep_mask into the global queue. It is necessary to achieve FIFO
+ * ordering for the pending single-sop operations when a multi-semop
+ * operation that references their semaphore must sleep. Per-semaphore
+ * queues of unreferenced semaphores are left alone, so single-sop
+ * operations that do not overlap with any sleeping multi-semop
+ * operation keep their strict per-semaphore queue.
  * Only the alter operations must be moved, the const operations can stay.
  */
-static void merge_queues(struct sem_array *sma)
+static void merge_queues(struct sem_array *sma, unsigned long dep_mask)
 {
 	int i;
 	for (i = 0; i < sma->sem_nsems; i++) {
 		struct sem *sem = sma->sem_base + i;
 
-		list_splice_init(&sem->pending_alter, &sma->pending_alter);
+		if (!(dep_mask & (1UL << (i % BITS_PER_LONG))))
+			continue;
+		list_splice_tail_init(&sem->pending_alter, &sma->pending_alter);
 	}
 }
 
@@ -336,6 +353,9 @@ static inline int sem_lock(struct sem_array *sma, struct sembuf *sops,
 		/* Complex operation - acquire a full lock */
 		ipc_lock_object(&sma->sem_perm);
 
+		/* statistics only, for /proc/sysvipc/sem */
+		sma->complex_entries++;
+
 		/* Prevent parallel simple ops */
 		complexmode_enter(sma);
 		return SEM_GLOBAL_LOCK;
@@ -970,31 +990,48 @@ static void do_smart_update(struct sem_array *sma, struct sembuf *sops, int nsop
 	otime |= do_smart_wakeup_zero(sma, sops, nsops, wake_q);
 
 	if (!list_empty(&sma->pending_alter)) {
-		/* semaphore array uses the global queue - just process it. */
-		otime |= update_queue(sma, -1, wake_q);
+		/*
+		 * Complex operations are sleeping. Every semaphore that an
+		 * entry in the global queue references is covered by
+		 * complex_dep_mask, thus a rescan is only required if one
+		 * of those semaphores was modified.
+		 */
+		unsigned long dep_mask = 0;
+
+		if (sops) {
+			for (i = 0; i < nsops; i++)
+				dep_mask |= 1UL <<
+					(sops[i].sem_num % BITS_PER_LONG);
+		}
+		if (!sops || (dep_mask & sma->complex_dep_mask))
+			otime |= update_queue(sma, -1, wake_q);
+	}
+	/*
+	 * The per-semaphore queues of the semaphores in complex_dep_mask
+	 * are empty, their entries sit in the global queue. All other
+	 * per-semaphore queues must be checked as usual.
+	 */
+	if (!sops) {
+		/*
+		 * No sops, thus the modified semaphores are not
+		 * known. Check all.
+		 */
+		for (i = 0; i < sma->sem_nsems; i++)
+			otime |= update_queue(sma, i, wake_q);
 	} else {
-		if (!sops) {
-			/*
-			 * No sops, thus the modified semaphores are not
-			 * known. Check all.
-			 */
-			for (i = 0; i < sma->sem_nsems; i++)
-				otime |= update_queue(sma, i, wake_q);
-		} else {
-			/*
-			 * Check the semaphores that were increased:
-			 * - No complex ops, thus all sleeping ops are
-			 *   decrease.
-			 * - if we decreased the value, then any sleeping
-			 *   semaphore ops wont be able to run: If the
-			 *   previous value was too small, then the new
-			 *   value will be too small, too.
-			 */
-			for (i = 0; i < nsops; i++) {
-				if (sops[i].sem_op > 0) {
-					otime |= update_queue(sma,
-							      sops[i].sem_num, wake_q);
-				}
+		/*
+		 * Check the semaphores that were increased:
+		 * - Per-semaphore queues hold single-sop operations
+		 *   only, thus all sleeping ops are decrease.
+		 * - if we decreased the value, then any sleeping
+		 *   semaphore ops wont be able to run: If the
+		 *   previous value was too small, then the new
+		 *   value will be too small, too.
+		 */
+		for (i = 0; i < nsops; i++) {
+			if (sops[i].sem_op > 0) {
+				otime |= update_queue(sma,
+						      sops[i].sem_num, wake_q);
 			}
 		}
 	}
@@ -1763,7 +1800,7 @@ SYSCALL_DEFINE4(semtimedop, int, semid, struct sembuf __user *, tsops,
 	int max, locknum;
 	bool undos = false, alter = false, dupsop = false;
 	struct sem_queue queue;
-	unsigned long dup = 0, jiffies_left = 0;
+	unsigned long dup = 0, dep_mask = 0, jiffies_left = 0;
 	struct ipc_namespace *ns;
 
 	ns = current->nsproxy->ipc_ns;
@@ -1805,6 +1842,7 @@ SYSCALL_DEFINE4(semtimedop, int, semid, struct sembuf __user *, tsops,
 			max = sop->sem_num;
 		if (sop->sem_flg & SEM_UNDO)
 			undos = true;
+		dep_mask |= mask;
 		if (dup & mask) {
 			/*
 			 * There was a previous alter access that appears
@@ -1885,6 +1923,7 @@ SYSCALL_DEFINE4(semtimedop, int, semid, struct sembuf __user *, tsops,
 	queue.pid = task_tgid_vnr(current);
 	queue.alter = alter;
 	queue.dupsop = dupsop;
+	queue.dep_mask = dep_mask;
 
 	error = perform_atomic_semop(sma, &queue);
 	if (error == 0) { /* non-blocking succesfull path */
@@ -1917,7 +1956,14 @@ SYSCALL_DEFINE4(semtimedop, int, semid, struct sembuf __user *, tsops,
 		curr = &sma->sem_base[sops->sem_num];
 
 		if (alter) {
-			if (sma->complex_count) {
+			/*
+			 * The global queue is only required if a sleeping
+			 * complex operation references our semaphore,
+			 * otherwise the strict per-semaphore queue is
+			 * sufficient for FIFO ordering.
+			 */
+			if (sma->complex_count &&
+			    (sma->complex_dep_mask & queue.dep_mask)) {
 				list_add_tail(&queue.list,
 						&sma->pending_alter);
 			} else {
@@ -1929,13 +1975,20 @@ SYSCALL_DEFINE4(semtimedop, int, semid, struct sembuf __user *, tsops,
 			list_add_tail(&queue.list, &curr->pending_const);
 		}
 	} else {
-		if (!sma->complex_count)
-			merge_queues(sma);
-
-		if (alter)
+		if (alter) {
+			/*
+			 * Pull the single-sop operations on our semaphores
+			 * into the global queue, behind the operations that
+			 * already sleep there; new single-sop sleepers on
+			 * these semaphores follow us into the global queue
+			 * as long as complex_dep_mask covers them.
+			 */
+			merge_queues(sma, queue.dep_mask);
+			sma->complex_dep_mask |= queue.dep_mask;
 			list_add_tail(&queue.list, &sma->pending_alter);
-		else
+		} else {
 			list_add_tail(&queue.list, &sma->pending_const);
+		}
 
 		sma->complex_count++;
 	}
@@ -2051,6 +2104,7 @@ int copy_semundo(unsigned long clone_flags, struct task_struct *tsk)
 void exit_sem(struct task_struct *tsk)
 {
 	struct sem_undo_list *ulp;
+	DEFINE_WAKE_Q(wake_q);
 
 	ulp = tsk->sysvsem.undo_list;
 	if (!ulp)
@@ -2064,7 +2118,6 @@ void exit_sem(struct task_struct *tsk)
 		struct sem_array *sma;
 		struct sem_undo *un;
 		int semid, i;
-		DEFINE_WAKE_Q(wake_q);
 
 		cond_resched();
 
@@ -2155,10 +2208,15 @@ void exit_sem(struct task_struct *tsk)
 		do_smart_update(sma, NULL, 0, 1, &wake_q);
 		sem_unlock(sma, -1);
 		rcu_read_unlock();
-		wake_up_q(&wake_q);
 
 		kfree_rcu(un, rcu);
 	}
+	/*
+	 * A single flush for all undo adjustments: wake_q_add() filters
+	 * out tasks that are already queued, thus tasks that sleep on
+	 * several of our arrays are woken up only once.
+	 */
+	wake_up_q(&wake_q);
 	kfree(ulp);
 }
 
@@ -2180,7 +2238,7 @@ static int sysvipc_sem_proc_show(struct seq_file *s, void *it)
 	sem_otime = get_semotime(sma);
 
 	seq_printf(s,
-		   "%10d %10d  %4o %10u %5u %5u %5u %5u %10lu %10lu\n",
+		   "%10d %10d  %4o %10u %5u %5u %5u %5u %10lu %10lu %10lu\n",
 		   sma->sem_perm.key,
 		   sma->sem_perm.id,
 		   sma->sem_perm.mode,
@@ -2190,7 +2248,8 @@ static int sysvipc_sem_proc_show(struct seq_file *s, void *it)
 		   from_kuid_munged(user_ns, sma->sem_perm.cuid),
 		   from_kgid_munged(user_ns, sma->sem_perm.cgid),
 		   sem_otime,
-		   sma->sem_ctime);
+		   sma->sem_ctime,
+		   sma->complex_entries);
 
 	complexmode_tryleave(sma);
 
@@ -27,6 +27,7 @@
 #include <linux/slab.h>
 #include <linux/mm.h>
 #include <linux/hugetlb.h>
+#include <linux/huge_mm.h>
 #include <linux/shm.h>
 #include <linux/init.h>
 #include <linux/file.h>
@@ -512,6 +513,79 @@ static const struct vm_operations_struct shm_vm_ops = {
 #endif
 };
 
+/*
+ * SHM_POPULATE: preallocate the whole segment from parallel workers, so
+ * that attaching tasks find the pages in place instead of taking
+ * first-touch faults. Each worker asks shmem for huge pages (honoured
+ * according to the shmem_enabled sysfs knob) and every index goes
+ * through the segment's mempolicy, thus an interleaved policy spreads
+ * the pages over the nodes regardless of which worker allocates them.
+ * Population is asynchronous and best effort; SHM_HUGE_STAT can be used
+ * to observe the achieved huge page coverage.
+ */
+#define SHM_POPULATE_WORKERS	4
+
+struct shm_populate_work {
+	struct work_struct	work;
+	struct file		*file;
+	pgoff_t			start;	/* first index to populate */
+	pgoff_t			end;	/* last index, exclusive */
+};
+
+static void shm_populate_workfn(struct work_struct *work)
+{
+	struct shm_populate_work *spw =
+		container_of(work, struct shm_populate_work, work);
+	struct inode *inode = file_inode(spw->file);
+	pgoff_t index = spw->start;
+	struct page *page;
+
+	while (index < spw->end) {
+		/*
+		 * Best effort: on allocation failure leave the rest of
+		 * the segment to the fault path.
+		 */
+		if (shmem_getpage(inode, index, &page, SGP_HUGE))
+			break;
+		if (PageTransCompound(page))
+			index = round_up(index + 1, HPAGE_PMD_NR);
+		else
+			index++;
+		unlock_page(page);
+		put_page(page);
+		cond_resched();
+	}
+	fput(spw->file);
+	kfree(spw);
+}
+
+static void shm_populate(struct file *file, size_t size)
+{
+	pgoff_t last = (size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	pgoff_t chunk, start;
+
+	/*
+	 * Align the chunks so that no huge page spans two workers.
+	 */
+	chunk = DIV_ROUND_UP(last, SHM_POPULATE_WORKERS);
+	if (IS_ENABLED(CONFIG_TRANSPARENT_HUGEPAGE))
+		chunk = round_up(chunk, HPAGE_PMD_NR);
+
+	for (start = 0; start < last; start += chunk) {
+		struct shm_populate_work *spw;
+
+		spw = kmalloc(sizeof(*spw), GFP_KERNEL);
+		if (!spw)
+			return;
+
+		INIT_WORK(&spw->work, shm_populate_workfn);
+		spw->file = get_file(file);
+		spw->start = start;
+		spw->end = min(start + chunk, last);
+		queue_work(system_unbound_wq, &spw->work);
+	}
+}
+
 /**
  * newseg - Create a new shared memory segment
  * @ns: namespace
@@ -615,6 +689,9 @@ static int newseg(struct ipc_namespace *ns, struct ipc_params *params)
 	ns->shm_tot += numpages;
 	error = shp->shm_perm.id;
 
+	if ((shmflg & SHM_POPULATE) && !is_file_hugepages(file))
+		shm_populate(file, size);
+
 	ipc_unlock_object(&shp->shm_perm);
 	rcu_read_unlock();
 	return error;
@@ -1005,6 +1082,69 @@ SYSCALL_DEFINE3(shmctl, int, shmid, int, cmd, struct shmid_ds __user *, buf)
 	case IPC_RMID:
 	case IPC_SET:
 		return shmctl_down(ns, shmid, cmd, buf, version);
+	case SHM_HUGE_STAT:
+	{
+		struct file *shm_file;
+		struct address_space *mapping;
+		pgoff_t index, last;
+		long huge = 0;
+
+		rcu_read_lock();
+		shp = shm_obtain_object_check(ns, shmid);
+		if (IS_ERR(shp)) {
+			err = PTR_ERR(shp);
+			goto out_unlock1;
+		}
+
+		err = -EACCES;
+		if (ipcperms(ns, &shp->shm_perm, S_IRUGO))
+			goto out_unlock1;
+
+		err = security_shm_shmctl(shp, cmd);
+		if (err)
+			goto out_unlock1;
+
+		ipc_lock_object(&shp->shm_perm);
+
+		/* check if shm_destroy() is tearing down shp */
+		if (!ipc_valid_object(&shp->shm_perm)) {
+			err = -EIDRM;
+			goto out_unlock0;
+		}
+
+		shm_file = shp->shm_file;
+
+		/* hugetlbfs segments are huge by construction */
+		err = -EINVAL;
+		if (is_file_hugepages(shm_file))
+			goto out_unlock0;
+
+		last = (shp->shm_segsz + PAGE_SIZE - 1) >> PAGE_SHIFT;
+		get_file(shm_file);
+		ipc_unlock_object(&shp->shm_perm);
+		rcu_read_unlock();
+
+		/*
+		 * Huge pages sit pmd-aligned in the page cache, thus
+		 * probing every HPAGE_PMD_NR'th index finds them all.
+		 */
+		mapping = shm_file->f_mapping;
+		if (IS_ENABLED(CONFIG_TRANSPARENT_HUGEPAGE)) {
+			for (index = 0; index < last; index += HPAGE_PMD_NR) {
+				struct page *page;
+
+				page = find_get_page(mapping, index);
+				if (page) {
+					if (PageTransCompound(page))
+						huge++;
+					put_page(page);
+				}
+				cond_resched();
+			}
+		}
+		fput(shm_file);
+		return min_t(long, huge, INT_MAX);
+	}
 	case SHM_LOCK:
 	case SHM_UNLOCK:
 	{
@@ -68,6 +68,7 @@
 #include <linux/security.h>
 #endif
 #include <linux/freezer.h>
+#include <linux/llist.h>
 #include <linux/pid_namespace.h>
 #include <net/netns/generic.h>
 
@@ -165,6 +166,16 @@ static struct sk_buff_head audit_retry_queue;
 /* queue msgs waiting for new auditd connection */
 static struct sk_buff_head audit_hold_queue;
 
+/*
+ * Per-CPU lockless staging lists in front of audit_queue.  audit_log_end()
+ * pushes finished records here with a single atomic op and kauditd moves
+ * them onto audit_queue in batches before each send pass, so the syscall
+ * exit path never contends on the queue spinlock.  The llist node lives
+ * in skb->cb, which is unused until the record reaches the send queues.
+ */
+static DEFINE_PER_CPU(struct llist_head, audit_stage_list);
+static atomic_t audit_stage_len = ATOMIC_INIT(0);
+
 /* queue servicing thread */
 static struct task_struct *kauditd_task;
 static DECLARE_WAIT_QUEUE_HEAD(kauditd_wait);
@@ -718,6 +729,50 @@ static void kauditd_send_multicast_skb(struct sk_buff *skb)
 	nlmsg_multicast(sock, copy, 0, AUDIT_NLGRP_READLOG, GFP_KERNEL);
 }
 
+static struct sk_buff *audit_stage_node_skb(struct llist_node *node)
+{
+	return (struct sk_buff *)((char *)node - offsetof(struct sk_buff, cb));
+}
+
+/* Number of records queued or staged, for the backlog limit checks. */
+static u32 audit_backlog_len(void)
+{
+	return skb_queue_len(&audit_queue) + atomic_read(&audit_stage_len);
+}
+
+/**
+ * kauditd_drain_stage - Move staged records onto the main queue
+ *
+ * Description:
+ * Batch-drain every CPU's staging list into audit_queue.  Only kauditd
+ * calls this, so audit_queue sees a single writer for staged records.
+ * Records staged on one CPU stay in submission order; ordering across
+ * CPUs follows the record serial numbers, as it already did when
+ * producers raced for the queue lock.
+ */
+static void kauditd_drain_stage(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct llist_node *node;
+
+		node = llist_del_all(per_cpu_ptr(&audit_stage_list, cpu));
+		if (!node)
+			continue;
+		/* llist hands us newest-first, the queue wants FIFO */
+		node = llist_reverse_order(node);
+		while (node) {
+			struct llist_node *next = node->next;
+
+			skb_queue_tail(&audit_queue,
+				       audit_stage_node_skb(node));
+			atomic_dec(&audit_stage_len);
+			node = next;
+		}
+	}
+}
+
 /**
  * kauditd_thread - Worker thread to send audit records to userspace
  * @dummy: unused
@@ -733,6 +788,9 @@ static int kauditd_thread(void *dummy)
 
 	set_freezable();
 	while (!kthread_should_stop()) {
+		/* pull everything the producers have staged so far */
+		kauditd_drain_stage();
+
 		/* NOTE: see the lock comments in auditd_send_unicast_skb() */
 		rcu_read_lock();
 		if (!auditd_conn.pid) {
@@ -791,7 +849,7 @@ main_queue:
 		 *       do the multicast send and rotate records from the
 		 *       main queue to the retry/hold queues */
 		wait_event_freezable(kauditd_wait,
-				     (skb_queue_len(&audit_queue) ? 1 : 0));
+				     (audit_backlog_len() ? 1 : 0));
 	}
 
 	return 0;
@@ -1108,7 +1166,7 @@ static int audit_receive_msg(struct sk_buff *skb, struct nlmsghdr *nlh)
 		s.rate_limit		= audit_rate_limit;
 		s.backlog_limit		= audit_backlog_limit;
 		s.lost			= atomic_read(&audit_lost);
-		s.backlog		= skb_queue_len(&audit_queue);
+		s.backlog		= audit_backlog_len();
 		s.feature_bitmap	= AUDIT_FEATURE_BITMAP_ALL;
 		s.backlog_wait_time	= audit_backlog_wait_time;
 		audit_send_reply(skb, seq, AUDIT_GET, 0, 0, &s, sizeof(s));
@@ -1467,6 +1525,10 @@ static int __init audit_init(void)
 	memset(&auditd_conn, 0, sizeof(auditd_conn));
 	spin_lock_init(&auditd_conn.lock);
 
+	/* the staging lists chain records through skb->cb */
+	BUILD_BUG_ON(sizeof(struct llist_node) >
+		     FIELD_SIZEOF(struct sk_buff, cb));
+
 	skb_queue_head_init(&audit_queue);
 	skb_queue_head_init(&audit_retry_queue);
 	skb_queue_head_init(&audit_hold_queue);
@@ -1662,7 +1724,7 @@ struct audit_buffer *audit_log_start(struct audit_context *ctx, gfp_t gfp_mask,
 		long stime = audit_backlog_wait_time;
 
 		while (audit_backlog_limit &&
-		       (skb_queue_len(&audit_queue) > audit_backlog_limit)) {
+		       (audit_backlog_len() > audit_backlog_limit)) {
 			/* wake kauditd to try and flush the queue */
 			wake_up_interruptible(&kauditd_wait);
 
@@ -1679,7 +1741,7 @@ struct audit_buffer *audit_log_start(struct audit_context *ctx, gfp_t gfp_mask,
 			} else {
 				if (audit_rate_check() && printk_ratelimit())
 					pr_warn("audit_backlog=%d > audit_backlog_limit=%d\n",
-						skb_queue_len(&audit_queue),
+						audit_backlog_len(),
 						audit_backlog_limit);
 				audit_log_lost("backlog limit exceeded");
 				return NULL;
@@ -2268,8 +2330,12 @@ void audit_log_end(struct audit_buffer *ab)
 		nlh = nlmsg_hdr(skb);
 		nlh->nlmsg_len = skb->len - NLMSG_HDRLEN;
 
-		/* queue the netlink packet and poke the kauditd thread */
-		skb_queue_tail(&audit_queue, skb);
+		/* stage the record locklessly, kauditd batches it onto
+		 * audit_queue before the next send pass */
+		llist_add((struct llist_node *)skb->cb,
+			  get_cpu_ptr(&audit_stage_list));
+		put_cpu_ptr(&audit_stage_list);
+		atomic_inc(&audit_stage_len);
 		wake_up_interruptible(&kauditd_wait);
 	} else
 		audit_log_lost("rate limit exceeded");
@@ -69,8 +69,32 @@ static struct list_head audit_rules_list[AUDIT_NR_FILTERS] = {
 	LIST_HEAD_INIT(audit_rules_list[5]),
 };
 
+/*
+ * Union of the syscall masks of all rules on each filter list.  Lets
+ * audit_filter_syscall() skip the rule walk entirely when no rule could
+ * match the current syscall.  Updated under audit_filter_mutex; readers
+ * are lockless and may briefly see a superset after a rule is removed,
+ * which only costs them the walk.
+ */
+u32 audit_filter_mask[AUDIT_NR_FILTERS][AUDIT_BITMASK_SIZE];
+
 DEFINE_MUTEX(audit_filter_mutex);
 
+/* Recompute the union mask of a list.  Caller holds audit_filter_mutex. */
+static void audit_update_filter_mask(int listnr)
+{
+	u32 mask[AUDIT_BITMASK_SIZE];
+	struct audit_entry *e;
+	int i;
+
+	memset(mask, 0, sizeof(mask));
+	list_for_each_entry(e, &audit_filter_list[listnr], list)
+		for (i = 0; i < AUDIT_BITMASK_SIZE; i++)
+			mask[i] |= e->rule.mask[i];
+	for (i = 0; i < AUDIT_BITMASK_SIZE; i++)
+		WRITE_ONCE(audit_filter_mask[listnr][i], mask[i]);
+}
+
 static void audit_free_lsm_field(struct audit_field *f)
 {
 	switch (f->type) {
@@ -907,6 +931,7 @@ static inline int audit_add_rule(struct audit_entry *entry)
 	struct audit_tree *tree = entry->rule.tree;
 	struct list_head *list;
 	int err = 0;
+	int i;
 #ifdef CONFIG_AUDITSYSCALL
 	int dont_count = 0;
 
@@ -957,6 +982,15 @@ static inline int audit_add_rule(struct audit_entry *entry)
 			entry->rule.prio = --prio_low;
 	}
 
+	/*
+	 * Extend the union mask before the rule becomes visible, so a
+	 * reader that takes the mask fast path never misses it.
+	 */
+	for (i = 0; i < AUDIT_BITMASK_SIZE; i++)
+		WRITE_ONCE(audit_filter_mask[entry->rule.listnr][i],
+			   audit_filter_mask[entry->rule.listnr][i] |
+			   entry->rule.mask[i]);
+
 	if (entry->rule.flags & AUDIT_FILTER_PREPEND) {
 		list_add(&entry->rule.list,
 			 &audit_rules_list[entry->rule.listnr]);
@@ -1023,6 +1057,8 @@ int audit_del_rule(struct audit_entry *entry)
 	list_del(&e->rule.list);
 	call_rcu(&e->rcu, audit_free_rule_rcu);
 
+	audit_update_filter_mask(entry->rule.listnr);
+
 out:
 	mutex_unlock(&audit_filter_mutex);
 
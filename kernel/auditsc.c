@@ -750,6 +750,23 @@ static int audit_in_mask(const struct audit_krule *rule, unsigned long val)
 	return rule->mask[word] & bit;
 }
 
+/* Check the union mask of a whole filter list, see audit_in_mask(). */
+static bool audit_in_filter_mask(int listnr, unsigned long val)
+{
+	int word, bit;
+
+	if (val > 0xffffffff)
+		return false;
+
+	word = AUDIT_WORD(val);
+	if (word >= AUDIT_BITMASK_SIZE)
+		return false;
+
+	bit = AUDIT_BIT(val);
+
+	return READ_ONCE(audit_filter_mask[listnr][word]) & bit;
+}
+
 /* At syscall entry and exit time, this filter is called if the
  * audit_state is not low enough that auditing cannot take place, but is
  * also not high enough that we already know we have to write an audit
@@ -757,14 +774,25 @@ static int audit_in_mask(const struct audit_krule *rule, unsigned long val)
  */
 static enum audit_state audit_filter_syscall(struct task_struct *tsk,
 					     struct audit_context *ctx,
-					     struct list_head *list)
+					     int listnr)
 {
+	struct list_head *list = &audit_filter_list[listnr];
 	struct audit_entry *e;
 	enum audit_state state;
 
 	if (auditd_test_task(tsk))
 		return AUDIT_DISABLED;
 
+	/*
+	 * One-comparison fast path: every rule checks audit_in_mask()
+	 * before anything else, so if no rule on this list names the
+	 * current syscall the walk cannot match and the verdict stays
+	 * AUDIT_BUILD_CONTEXT.  The union mask is maintained by
+	 * auditfilter.c and is never missing a visible rule.
+	 */
+	if (!audit_in_filter_mask(listnr, ctx->major))
+		return AUDIT_BUILD_CONTEXT;
+
 	rcu_read_lock();
 	if (!list_empty(list)) {
 		list_for_each_entry_rcu(e, list, list) {
@@ -858,7 +886,7 @@ static inline struct audit_context *audit_take_context(struct task_struct *tsk,
 		context->return_code  = return_code;
 
 	if (context->in_syscall && !context->dummy) {
-		audit_filter_syscall(tsk, context, &audit_filter_list[AUDIT_FILTER_EXIT]);
+		audit_filter_syscall(tsk, context, AUDIT_FILTER_EXIT);
 		audit_filter_inodes(tsk, context);
 	}
 
@@ -1521,7 +1549,7 @@ void __audit_syscall_entry(int major, unsigned long a1, unsigned long a2,
 	context->dummy = !audit_n_rules;
 	if (!context->dummy && state == AUDIT_BUILD_CONTEXT) {
 		context->prio = 0;
-		state = audit_filter_syscall(tsk, context, &audit_filter_list[AUDIT_FILTER_ENTRY]);
+		state = audit_filter_syscall(tsk, context, AUDIT_FILTER_ENTRY);
 	}
 	if (state == AUDIT_DISABLED)
 		return;
@@ -15,6 +15,9 @@
 #include <linux/mm.h>
 #include <linux/filter.h>
 #include <linux/perf_event.h>
+#include <linux/net.h>
+#include <net/sock.h>
+#include <net/tcp_states.h>
 
 static void bpf_array_free_percpu(struct bpf_array *array)
 {
@@ -45,7 +48,8 @@ static int bpf_array_alloc_percpu(struct bpf_array *array)
 /* Called from syscall */
 static struct bpf_map *array_map_alloc(union bpf_attr *attr)
 {
-	bool percpu = attr->map_type == BPF_MAP_TYPE_PERCPU_ARRAY;
+	bool percpu = attr->map_type == BPF_MAP_TYPE_PERCPU_ARRAY ||
+		      attr->map_type == BPF_MAP_TYPE_PERCPU_HISTOGRAM;
 	struct bpf_array *array;
 	u64 array_size;
 	u32 elem_size;
@@ -55,6 +59,11 @@ static struct bpf_map *array_map_alloc(union bpf_attr *attr)
 	    attr->value_size == 0 || attr->map_flags)
 		return ERR_PTR(-EINVAL);
 
+	/* histogram buckets are per-CPU u64 counters */
+	if (attr->map_type == BPF_MAP_TYPE_PERCPU_HISTOGRAM &&
+	    attr->value_size != 8)
+		return ERR_PTR(-EINVAL);
+
 	if (attr->value_size > KMALLOC_MAX_SIZE)
 		/* if value_size is bigger, the user space won't be able to
 		 * access the elements.
@@ -113,6 +122,30 @@ static void *array_map_lookup_elem(struct bpf_map *map, void *key)
 	return array->value + array->elem_size * index;
 }
 
+/* emit BPF instructions equivalent to C code of array_map_lookup_elem() */
+static u32 array_map_gen_lookup(struct bpf_map *map, struct bpf_insn *insn_buf)
+{
+	struct bpf_insn *insn = insn_buf;
+	u32 elem_size = round_up(map->value_size, 8);
+	const int ret = BPF_REG_0;
+	const int map_ptr = BPF_REG_1;
+	const int index = BPF_REG_2;
+
+	*insn++ = BPF_ALU64_IMM(BPF_ADD, map_ptr, offsetof(struct bpf_array, value));
+	*insn++ = BPF_LDX_MEM(BPF_W, ret, index, 0);
+	if (is_power_of_2(elem_size)) {
+		*insn++ = BPF_JMP_IMM(BPF_JGE, ret, map->max_entries, 3);
+		*insn++ = BPF_ALU64_IMM(BPF_LSH, ret, ilog2(elem_size));
+	} else {
+		*insn++ = BPF_JMP_IMM(BPF_JGE, ret, map->max_entries, 3);
+		*insn++ = BPF_ALU64_IMM(BPF_MUL, ret, elem_size);
+	}
+	*insn++ = BPF_ALU64_REG(BPF_ADD, ret, map_ptr);
+	*insn++ = BPF_JMP_IMM(BPF_JA, 0, 0, 1);
+	*insn++ = BPF_MOV64_IMM(ret, 0);
+	return insn - insn_buf;
+}
+
 /* Called from eBPF program */
 static void *percpu_array_map_lookup_elem(struct bpf_map *map, void *key)
 {
@@ -155,7 +188,7 @@ int bpf_percpu_array_copy(struct bpf_map *map, void *key, void *value)
 static int array_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 {
 	struct bpf_array *array = container_of(map, struct bpf_array, map);
-	u32 index = *(u32 *)key;
+	u32 index = key ? *(u32 *)key : U32_MAX;
 	u32 *next = (u32 *)next_key;
 
 	if (index >= array->map.max_entries) {
@@ -189,7 +222,8 @@ static int array_map_update_elem(struct bpf_map *map, void *key, void *value,
 		/* all elements already exist */
 		return -EEXIST;
 
-	if (array->map.map_type == BPF_MAP_TYPE_PERCPU_ARRAY)
+	if (array->map.map_type == BPF_MAP_TYPE_PERCPU_ARRAY ||
+	    array->map.map_type == BPF_MAP_TYPE_PERCPU_HISTOGRAM)
 		memcpy(this_cpu_ptr(array->pptrs[index]),
 		       value, map->value_size);
 	else
@@ -267,6 +301,7 @@ static const struct bpf_map_ops array_ops = {
 	.map_lookup_elem = array_map_lookup_elem,
 	.map_update_elem = array_map_update_elem,
 	.map_delete_elem = array_map_delete_elem,
+	.map_gen_lookup = array_map_gen_lookup,
 };
 
 static struct bpf_map_type_list array_type __read_mostly = {
@@ -288,10 +323,58 @@ static struct bpf_map_type_list percpu_array_type __read_mostly = {
 	.type = BPF_MAP_TYPE_PERCPU_ARRAY,
 };
 
+/* log-linear histogram bucket index: 2^HIST_LINEAR_BITS linear
+ * sub-buckets per power of two, values below that range map 1:1
+ */
+#define HIST_LINEAR_BITS 4
+
+static u32 hist_map_bucket(u64 value)
+{
+	u32 msb;
+
+	if (value < (1 << HIST_LINEAR_BITS))
+		return value;
+
+	msb = fls64(value) - 1;
+	return ((msb - HIST_LINEAR_BITS + 1) << HIST_LINEAR_BITS) +
+	       ((value >> (msb - HIST_LINEAR_BITS)) &
+		((1 << HIST_LINEAR_BITS) - 1));
+}
+
+/* Called from eBPF program on the CPU that took the sample; out of
+ * range values land in the last bucket
+ */
+int bpf_hist_map_add(struct bpf_map *map, u64 value)
+{
+	struct bpf_array *array = container_of(map, struct bpf_array, map);
+	u32 index = hist_map_bucket(value);
+
+	if (index >= array->map.max_entries)
+		index = array->map.max_entries - 1;
+
+	(*(u64 *)this_cpu_ptr(array->pptrs[index]))++;
+	return 0;
+}
+
+static const struct bpf_map_ops percpu_hist_ops = {
+	.map_alloc = array_map_alloc,
+	.map_free = array_map_free,
+	.map_get_next_key = array_map_get_next_key,
+	.map_lookup_elem = percpu_array_map_lookup_elem,
+	.map_update_elem = array_map_update_elem,
+	.map_delete_elem = array_map_delete_elem,
+};
+
+static struct bpf_map_type_list percpu_hist_type __read_mostly = {
+	.ops = &percpu_hist_ops,
+	.type = BPF_MAP_TYPE_PERCPU_HISTOGRAM,
+};
+
 static int __init register_array_map(void)
 {
 	bpf_register_map_type(&array_type);
 	bpf_register_map_type(&percpu_array_type);
+	bpf_register_map_type(&percpu_hist_type);
 	return 0;
 }
 late_initcall(register_array_map);
@@ -576,3 +659,105 @@ static int __init register_cgroup_array_map(void)
 }
 late_initcall(register_cgroup_array_map);
 #endif
+
+#ifdef CONFIG_NET
+/* A sockmap is an fd array whose entries are TCP listener sockets. Entries
+ * hold a full socket reference and are only dropped after an RCU grace
+ * period, so the lookup hook can return the socket to a caller that takes
+ * its own reference under rcu_read_lock().
+ */
+struct bpf_sock_entry {
+	struct sock *sk;
+	struct rcu_head rcu;
+};
+
+static void *sock_fd_array_get_ptr(struct bpf_map *map,
+				   struct file *map_file /* not used */,
+				   int fd)
+{
+	struct bpf_sock_entry *se;
+	struct socket *sock;
+	struct sock *sk;
+	int err;
+
+	sock = sockfd_lookup(fd, &err);
+	if (!sock)
+		return ERR_PTR(err);
+
+	sk = sock->sk;
+	if (sk->sk_family != AF_INET || sk->sk_protocol != IPPROTO_TCP ||
+	    sk->sk_state != TCP_LISTEN) {
+		sockfd_put(sock);
+		return ERR_PTR(-EOPNOTSUPP);
+	}
+
+	/* called from syscall context under rcu_read_lock() */
+	se = kmalloc(sizeof(*se), GFP_ATOMIC);
+	if (!se) {
+		sockfd_put(sock);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	sock_hold(sk);
+	se->sk = sk;
+	sockfd_put(sock);
+	return se;
+}
+
+static void __sock_entry_free(struct rcu_head *rcu)
+{
+	struct bpf_sock_entry *se;
+
+	se = container_of(rcu, struct bpf_sock_entry, rcu);
+	sock_put(se->sk);
+	kfree(se);
+}
+
+static void sock_fd_array_put_ptr(void *ptr)
+{
+	struct bpf_sock_entry *se = ptr;
+
+	call_rcu(&se->rcu, __sock_entry_free);
+}
+
+/* called from the lookup hook under rcu_read_lock() */
+struct sock *__sock_map_lookup_elem(struct bpf_map *map, u32 key)
+{
+	struct bpf_array *array = container_of(map, struct bpf_array, map);
+	struct bpf_sock_entry *se;
+
+	if (key >= array->map.max_entries)
+		return NULL;
+
+	se = READ_ONCE(array->ptrs[key]);
+	return se ? se->sk : NULL;
+}
+
+static void sock_fd_array_free(struct bpf_map *map)
+{
+	bpf_fd_array_map_clear(map);
+	fd_array_map_free(map);
+}
+
+static const struct bpf_map_ops sock_array_ops = {
+	.map_alloc = fd_array_map_alloc,
+	.map_free = sock_fd_array_free,
+	.map_get_next_key = array_map_get_next_key,
+	.map_lookup_elem = fd_array_map_lookup_elem,
+	.map_delete_elem = fd_array_map_delete_elem,
+	.map_fd_get_ptr = sock_fd_array_get_ptr,
+	.map_fd_put_ptr = sock_fd_array_put_ptr,
+};
+
+static struct bpf_map_type_list sock_array_type __read_mostly = {
+	.ops = &sock_array_ops,
+	.type = BPF_MAP_TYPE_SOCKMAP,
+};
+
+static int __init register_sock_array_map(void)
+{
+	bpf_register_map_type(&sock_array_type);
+	return 0;
+}
+late_initcall(register_sock_array_map);
+#endif
@@ -67,6 +67,19 @@ BPF_CALL_2(bpf_map_delete_elem, struct bpf_map *, map, void *, key)
 	return map->ops->map_delete_elem(map, key);
 }
 
+BPF_CALL_2(bpf_hist_add, struct bpf_map *, map, u64, value)
+{
+	return bpf_hist_map_add(map, value);
+}
+
+const struct bpf_func_proto bpf_hist_add_proto = {
+	.func		= bpf_hist_add,
+	.gpl_only	= false,
+	.ret_type	= RET_INTEGER,
+	.arg1_type	= ARG_CONST_MAP_PTR,
+	.arg2_type	= ARG_ANYTHING,
+};
+
 const struct bpf_func_proto bpf_map_delete_elem_proto = {
 	.func		= bpf_map_delete_elem,
 	.gpl_only	= false,
@@ -299,6 +299,40 @@ int __weak bpf_stackmap_copy(struct bpf_map *map, void *key, void *value)
 	return -ENOTSUPP;
 }
 
+static bool bpf_map_value_percpu(struct bpf_map *map)
+{
+	return map->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
+	       map->map_type == BPF_MAP_TYPE_LRU_PERCPU_HASH ||
+	       map->map_type == BPF_MAP_TYPE_PERCPU_ARRAY ||
+	       map->map_type == BPF_MAP_TYPE_PERCPU_HISTOGRAM;
+}
+
+static int bpf_map_copy_value(struct bpf_map *map, void *key, void *value,
+			      u32 value_size)
+{
+	void *ptr;
+	int err;
+
+	if (map->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
+	    map->map_type == BPF_MAP_TYPE_LRU_PERCPU_HASH) {
+		err = bpf_percpu_hash_copy(map, key, value);
+	} else if (map->map_type == BPF_MAP_TYPE_PERCPU_ARRAY ||
+		   map->map_type == BPF_MAP_TYPE_PERCPU_HISTOGRAM) {
+		err = bpf_percpu_array_copy(map, key, value);
+	} else if (map->map_type == BPF_MAP_TYPE_STACK_TRACE) {
+		err = bpf_stackmap_copy(map, key, value);
+	} else {
+		rcu_read_lock();
+		ptr = map->ops->map_lookup_elem(map, key);
+		if (ptr)
+			memcpy(value, ptr, value_size);
+		rcu_read_unlock();
+		err = ptr ? 0 : -ENOENT;
+	}
+
+	return err;
+}
+
 /* last field in 'union bpf_attr' used by this command */
 #define BPF_MAP_LOOKUP_ELEM_LAST_FIELD value
 
@@ -308,7 +342,7 @@ static int map_lookup_elem(union bpf_attr *attr)
 	void __user *uvalue = u64_to_user_ptr(attr->value);
 	int ufd = attr->map_fd;
 	struct bpf_map *map;
-	void *key, *value, *ptr;
+	void *key, *value;
 	u32 value_size;
 	struct fd f;
 	int err;
@@ -330,9 +364,7 @@ static int map_lookup_elem(union bpf_attr *attr)
 	if (copy_from_user(key, ukey, map->key_size) != 0)
 		goto free_key;
 
-	if (map->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
-	    map->map_type == BPF_MAP_TYPE_LRU_PERCPU_HASH ||
-	    map->map_type == BPF_MAP_TYPE_PERCPU_ARRAY)
+	if (bpf_map_value_percpu(map))
 		value_size = round_up(map->value_size, 8) * num_possible_cpus();
 	else
 		value_size = map->value_size;
@@ -342,22 +374,7 @@ static int map_lookup_elem(union bpf_attr *attr)
 	if (!value)
 		goto free_key;
 
-	if (map->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
-	    map->map_type == BPF_MAP_TYPE_LRU_PERCPU_HASH) {
-		err = bpf_percpu_hash_copy(map, key, value);
-	} else if (map->map_type == BPF_MAP_TYPE_PERCPU_ARRAY) {
-		err = bpf_percpu_array_copy(map, key, value);
-	} else if (map->map_type == BPF_MAP_TYPE_STACK_TRACE) {
-		err = bpf_stackmap_copy(map, key, value);
-	} else {
-		rcu_read_lock();
-		ptr = map->ops->map_lookup_elem(map, key);
-		if (ptr)
-			memcpy(value, ptr, value_size);
-		rcu_read_unlock();
-		err = ptr ? 0 : -ENOENT;
-	}
-
+	err = bpf_map_copy_value(map, key, value, value_size);
 	if (err)
 		goto free_value;
 
@@ -376,6 +393,41 @@ err_put:
 	return err;
 }
 
+static int bpf_map_update_value(struct bpf_map *map, struct fd f, void *key,
+				void *value, u64 flags)
+{
+	int err;
+
+	/* must increment bpf_prog_active to avoid kprobe+bpf triggering from
+	 * inside bpf map update or delete otherwise deadlocks are possible
+	 */
+	preempt_disable();
+	__this_cpu_inc(bpf_prog_active);
+	if (map->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
+	    map->map_type == BPF_MAP_TYPE_LRU_PERCPU_HASH) {
+		err = bpf_percpu_hash_update(map, key, value, flags);
+	} else if (map->map_type == BPF_MAP_TYPE_PERCPU_ARRAY ||
+		   map->map_type == BPF_MAP_TYPE_PERCPU_HISTOGRAM) {
+		err = bpf_percpu_array_update(map, key, value, flags);
+	} else if (map->map_type == BPF_MAP_TYPE_PERF_EVENT_ARRAY ||
+		   map->map_type == BPF_MAP_TYPE_PROG_ARRAY ||
+		   map->map_type == BPF_MAP_TYPE_CGROUP_ARRAY ||
+		   map->map_type == BPF_MAP_TYPE_SOCKMAP) {
+		rcu_read_lock();
+		err = bpf_fd_array_map_update_elem(map, f.file, key, value,
+						   flags);
+		rcu_read_unlock();
+	} else {
+		rcu_read_lock();
+		err = map->ops->map_update_elem(map, key, value, flags);
+		rcu_read_unlock();
+	}
+	__this_cpu_dec(bpf_prog_active);
+	preempt_enable();
+
+	return err;
+}
+
 #define BPF_MAP_UPDATE_ELEM_LAST_FIELD flags
 
 static int map_update_elem(union bpf_attr *attr)
@@ -406,9 +458,7 @@ static int map_update_elem(union bpf_attr *attr)
 	if (copy_from_user(key, ukey, map->key_size) != 0)
 		goto free_key;
 
-	if (map->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
-	    map->map_type == BPF_MAP_TYPE_LRU_PERCPU_HASH ||
-	    map->map_type == BPF_MAP_TYPE_PERCPU_ARRAY)
+	if (bpf_map_value_percpu(map))
 		value_size = round_up(map->value_size, 8) * num_possible_cpus();
 	else
 		value_size = map->value_size;
@@ -422,30 +472,7 @@ static int map_update_elem(union bpf_attr *attr)
 	if (copy_from_user(value, uvalue, value_size) != 0)
 		goto free_value;
 
-	/* must increment bpf_prog_active to avoid kprobe+bpf triggering from
-	 * inside bpf map update or delete otherwise deadlocks are possible
-	 */
-	preempt_disable();
-	__this_cpu_inc(bpf_prog_active);
-	if (map->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
-	    map->map_type == BPF_MAP_TYPE_LRU_PERCPU_HASH) {
-		err = bpf_percpu_hash_update(map, key, value, attr->flags);
-	} else if (map->map_type == BPF_MAP_TYPE_PERCPU_ARRAY) {
-		err = bpf_percpu_array_update(map, key, value, attr->flags);
-	} else if (map->map_type == BPF_MAP_TYPE_PERF_EVENT_ARRAY ||
-		   map->map_type == BPF_MAP_TYPE_PROG_ARRAY ||
-		   map->map_type == BPF_MAP_TYPE_CGROUP_ARRAY) {
-		rcu_read_lock();
-		err = bpf_fd_array_map_update_elem(map, f.file, key, value,
-						   attr->flags);
-		rcu_read_unlock();
-	} else {
-		rcu_read_lock();
-		err = map->ops->map_update_elem(map, key, value, attr->flags);
-		rcu_read_unlock();
-	}
-	__this_cpu_dec(bpf_prog_active);
-	preempt_enable();
+	err = bpf_map_update_value(map, f, key, value, attr->flags);
 
 free_value:
 	kfree(value);
@@ -555,6 +582,259 @@ err_put:
 	return err;
 }
 
+/* fold the per-CPU copies in 'value' into a single value in 'sum'.
+ * Only valid when value_size is a multiple of 8: the per-CPU areas are
+ * zero-filled beyond value_size, so summing whole u64 lanes is exact.
+ */
+static void bpf_percpu_value_sum(struct bpf_map *map, void *value, void *sum)
+{
+	u32 size = round_up(map->value_size, 8);
+	u32 lanes = map->value_size / 8;
+	int cpu, i;
+	u64 *dst = sum;
+
+	memset(sum, 0, map->value_size);
+	for (cpu = 0; cpu < num_possible_cpus(); cpu++) {
+		u64 *src = value + cpu * size;
+
+		for (i = 0; i < lanes; i++)
+			dst[i] += src[i];
+	}
+}
+
+/* last field in 'union bpf_attr' used by the BPF_MAP_*_BATCH commands */
+#define BPF_MAP_BATCH_LAST_FIELD batch.flags
+
+static int map_lookup_batch(union bpf_attr *attr, union bpf_attr __user *uattr)
+{
+	void __user *ubatch = u64_to_user_ptr(attr->batch.in_batch);
+	void __user *uobatch = u64_to_user_ptr(attr->batch.out_batch);
+	void __user *ukeys = u64_to_user_ptr(attr->batch.keys);
+	void __user *uvalues = u64_to_user_ptr(attr->batch.values);
+	u32 value_size, user_size, max_count = attr->batch.count;
+	void *key, *prev_key, *pk, *value, *sum = NULL;
+	int ufd = attr->batch.map_fd;
+	struct bpf_map *map;
+	u32 cp = 0;
+	bool fold;
+	struct fd f;
+	int err;
+
+	if (CHECK_ATTR(BPF_MAP_BATCH))
+		return -EINVAL;
+
+	if ((attr->batch.elem_flags & ~BPF_F_CPU_SUM) || attr->batch.flags)
+		return -EINVAL;
+	fold = attr->batch.elem_flags & BPF_F_CPU_SUM;
+
+	f = fdget(ufd);
+	map = __bpf_map_get(f);
+	if (IS_ERR(map))
+		return PTR_ERR(map);
+
+	err = -EINVAL;
+	if (fold && (!bpf_map_value_percpu(map) || map->value_size % 8))
+		goto err_put;
+
+	if (bpf_map_value_percpu(map))
+		value_size = round_up(map->value_size, 8) * num_possible_cpus();
+	else
+		value_size = map->value_size;
+	/* with folding the user buffer holds one value per key */
+	user_size = fold ? map->value_size : value_size;
+
+	err = -ENOMEM;
+	key = kmalloc(map->key_size, GFP_USER);
+	prev_key = kmalloc(map->key_size, GFP_USER);
+	value = kmalloc(value_size, GFP_USER | __GFP_NOWARN);
+	if (fold)
+		sum = kmalloc(map->value_size, GFP_USER | __GFP_NOWARN);
+	if (!key || !prev_key || !value || (fold && !sum))
+		goto free_buf;
+
+	pk = NULL;
+	if (ubatch) {
+		err = -EFAULT;
+		if (copy_from_user(prev_key, ubatch, map->key_size))
+			goto free_buf;
+		pk = prev_key;
+	}
+
+	err = 0;
+	while (cp < max_count) {
+		rcu_read_lock();
+		err = map->ops->map_get_next_key(map, pk, key);
+		rcu_read_unlock();
+		if (err)
+			break;
+
+		err = bpf_map_copy_value(map, key, value, value_size);
+		if (err == -ENOENT) {
+			/* the element was deleted under us, move on */
+			err = 0;
+			goto next_key;
+		}
+		if (err)
+			break;
+
+		err = -EFAULT;
+		if (fold) {
+			bpf_percpu_value_sum(map, value, sum);
+			if (copy_to_user(uvalues + (u64)cp * user_size, sum,
+					 user_size))
+				break;
+		} else {
+			if (copy_to_user(uvalues + (u64)cp * user_size, value,
+					 user_size))
+				break;
+		}
+		if (copy_to_user(ukeys + (u64)cp * map->key_size, key,
+				 map->key_size))
+			break;
+		err = 0;
+		cp++;
+next_key:
+		swap(prev_key, key);
+		pk = prev_key;
+		cond_resched();
+	}
+
+	if (err == -ENOENT)
+		err = 0;
+	if (!err && (copy_to_user(&uattr->batch.count, &cp, sizeof(cp)) ||
+		     (cp && copy_to_user(uobatch, prev_key, map->key_size))))
+		err = -EFAULT;
+
+free_buf:
+	kfree(sum);
+	kfree(value);
+	kfree(prev_key);
+	kfree(key);
+err_put:
+	fdput(f);
+	return err;
+}
+
+static int map_update_batch(union bpf_attr *attr, union bpf_attr __user *uattr)
+{
+	void __user *ukeys = u64_to_user_ptr(attr->batch.keys);
+	void __user *uvalues = u64_to_user_ptr(attr->batch.values);
+	u32 value_size, max_count = attr->batch.count;
+	int ufd = attr->batch.map_fd;
+	struct bpf_map *map;
+	void *key, *value;
+	u32 cp = 0;
+	struct fd f;
+	int err;
+
+	if (CHECK_ATTR(BPF_MAP_BATCH))
+		return -EINVAL;
+
+	if (attr->batch.elem_flags & BPF_F_CPU_SUM || attr->batch.flags ||
+	    attr->batch.in_batch || attr->batch.out_batch)
+		return -EINVAL;
+
+	f = fdget(ufd);
+	map = __bpf_map_get(f);
+	if (IS_ERR(map))
+		return PTR_ERR(map);
+
+	if (bpf_map_value_percpu(map))
+		value_size = round_up(map->value_size, 8) * num_possible_cpus();
+	else
+		value_size = map->value_size;
+
+	err = -ENOMEM;
+	key = kmalloc(map->key_size, GFP_USER);
+	value = kmalloc(value_size, GFP_USER | __GFP_NOWARN);
+	if (!key || !value)
+		goto free_buf;
+
+	err = 0;
+	while (cp < max_count) {
+		err = -EFAULT;
+		if (copy_from_user(key, ukeys + (u64)cp * map->key_size,
+				   map->key_size) ||
+		    copy_from_user(value, uvalues + (u64)cp * value_size,
+				   value_size))
+			break;
+
+		err = bpf_map_update_value(map, f, key, value,
+					   attr->batch.elem_flags);
+		if (err)
+			break;
+		cp++;
+		cond_resched();
+	}
+
+	if (copy_to_user(&uattr->batch.count, &cp, sizeof(cp)))
+		err = -EFAULT;
+
+free_buf:
+	kfree(value);
+	kfree(key);
+	fdput(f);
+	return err;
+}
+
+static int map_delete_batch(union bpf_attr *attr, union bpf_attr __user *uattr)
+{
+	void __user *ukeys = u64_to_user_ptr(attr->batch.keys);
+	u32 max_count = attr->batch.count;
+	int ufd = attr->batch.map_fd;
+	struct bpf_map *map;
+	u32 cp = 0;
+	struct fd f;
+	void *key;
+	int err;
+
+	if (CHECK_ATTR(BPF_MAP_BATCH))
+		return -EINVAL;
+
+	if (attr->batch.elem_flags || attr->batch.flags ||
+	    attr->batch.in_batch || attr->batch.out_batch ||
+	    attr->batch.values)
+		return -EINVAL;
+
+	f = fdget(ufd);
+	map = __bpf_map_get(f);
+	if (IS_ERR(map))
+		return PTR_ERR(map);
+
+	err = -ENOMEM;
+	key = kmalloc(map->key_size, GFP_USER);
+	if (!key)
+		goto err_put;
+
+	err = 0;
+	while (cp < max_count) {
+		err = -EFAULT;
+		if (copy_from_user(key, ukeys + (u64)cp * map->key_size,
+				   map->key_size))
+			break;
+
+		preempt_disable();
+		__this_cpu_inc(bpf_prog_active);
+		rcu_read_lock();
+		err = map->ops->map_delete_elem(map, key);
+		rcu_read_unlock();
+		__this_cpu_dec(bpf_prog_active);
+		preempt_enable();
+		if (err)
+			break;
+		cp++;
+		cond_resched();
+	}
+
+	if (copy_to_user(&uattr->batch.count, &cp, sizeof(cp)))
+		err = -EFAULT;
+
+	kfree(key);
+err_put:
+	fdput(f);
+	return err;
+}
+
 static LIST_HEAD(bpf_prog_types);
 
 static int find_prog_type(enum bpf_prog_type type, struct bpf_prog *prog)
@@ -577,59 +857,6 @@ void bpf_register_prog_type(struct bpf_prog_type_list *tl)
 	list_add(&tl->list_node, &bpf_prog_types);
 }
 
-/* fixup insn->imm field of bpf_call instructions:
- * if (insn->imm == BPF_FUNC_map_lookup_elem)
- *      insn->imm = bpf_map_lookup_elem - __bpf_call_base;
- * else if (insn->imm == BPF_FUNC_map_update_elem)
- *      insn->imm = bpf_map_update_elem - __bpf_call_base;
- * else ...
- *
- * this function is called after eBPF program passed verification
- */
-static void fixup_bpf_calls(struct bpf_prog *prog)
-{
-	const struct bpf_func_proto *fn;
-	int i;
-
-	for (i = 0; i < prog->len; i++) {
-		struct bpf_insn *insn = &prog->insnsi[i];
-
-		if (insn->code == (BPF_JMP | BPF_CALL)) {
-			/* we reach here when program has bpf_call instructions
-			 * and it passed bpf_check(), means that
-			 * ops->get_func_proto must have been supplied, check it
-			 */
-			BUG_ON(!prog->aux->ops->get_func_proto);
-
-			if (insn->imm == BPF_FUNC_get_route_realm)
-				prog->dst_needed = 1;
-			if (insn->imm == BPF_FUNC_get_prandom_u32)
-				bpf_user_rnd_init_once();
-			if (insn->imm == BPF_FUNC_xdp_adjust_head)
-				prog->xdp_adjust_head = 1;
-			if (insn->imm == BPF_FUNC_tail_call) {
-				/* mark bpf_tail_call as different opcode
-				 * to avoid conditional branch in
-				 * interpeter for every normal call
-				 * and to prevent accidental JITing by
-				 * JIT compiler that doesn't support
-				 * bpf_tail_call yet
-				 */
-				insn->imm = 0;
-				insn->code |= BPF_X;
-				continue;
-			}
-
-			fn = prog->aux->ops->get_func_proto(insn->imm);
-			/* all functions that have prototype and verifier allowed
-			 * programs to call them, must be real in-kernel functions
-			 */
-			BUG_ON(!fn->func);
-			insn->imm = fn->func - __bpf_call_base;
-		}
-	}
-}
-
 /* drop refcnt on maps used by eBPF program and free auxilary data */
 static void free_used_maps(struct bpf_prog_aux *aux)
 {
@@ -876,9 +1103,6 @@ static int bpf_prog_load(union bpf_attr *attr)
 	if (err < 0)
 		goto free_used_maps;
 
-	/* fixup BPF_CALL->imm field */
-	fixup_bpf_calls(prog);
-
 	/* eBPF program is ready to be JITed */
 	prog = bpf_prog_select_runtime(prog, &err);
 	if (err < 0)
@@ -918,38 +1142,18 @@ static int bpf_obj_get(const union bpf_attr *attr)
 	return bpf_obj_get_user(u64_to_user_ptr(attr->pathname));
 }
 
-#ifdef CONFIG_CGROUP_BPF
+#if defined(CONFIG_CGROUP_BPF) || defined(CONFIG_INET)
 
 #define BPF_PROG_ATTACH_LAST_FIELD attach_flags
 
-static int bpf_prog_attach(const union bpf_attr *attr)
+#ifdef CONFIG_CGROUP_BPF
+static int bpf_cgroup_prog_attach(const union bpf_attr *attr,
+				  enum bpf_prog_type ptype)
 {
-	enum bpf_prog_type ptype;
 	struct bpf_prog *prog;
 	struct cgroup *cgrp;
 	int ret;
 
-	if (!capable(CAP_NET_ADMIN))
-		return -EPERM;
-
-	if (CHECK_ATTR(BPF_PROG_ATTACH))
-		return -EINVAL;
-
-	if (attr->attach_flags & ~BPF_F_ALLOW_OVERRIDE)
-		return -EINVAL;
-
-	switch (attr->attach_type) {
-	case BPF_CGROUP_INET_INGRESS:
-	case BPF_CGROUP_INET_EGRESS:
-		ptype = BPF_PROG_TYPE_CGROUP_SKB;
-		break;
-	case BPF_CGROUP_INET_SOCK_CREATE:
-		ptype = BPF_PROG_TYPE_CGROUP_SOCK;
-		break;
-	default:
-		return -EINVAL;
-	}
-
 	prog = bpf_prog_get_type(attr->attach_bpf_fd, ptype);
 	if (IS_ERR(prog))
 		return PTR_ERR(prog);
@@ -968,13 +1172,46 @@ static int bpf_prog_attach(const union bpf_attr *attr)
 
 	return ret;
 }
+#endif /* CONFIG_CGROUP_BPF */
+
+static int bpf_prog_attach(const union bpf_attr *attr)
+{
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (CHECK_ATTR(BPF_PROG_ATTACH))
+		return -EINVAL;
+
+	if (attr->attach_flags & ~BPF_F_ALLOW_OVERRIDE)
+		return -EINVAL;
+
+	switch (attr->attach_type) {
+#ifdef CONFIG_CGROUP_BPF
+	case BPF_CGROUP_INET_INGRESS:
+	case BPF_CGROUP_INET_EGRESS:
+		return bpf_cgroup_prog_attach(attr, BPF_PROG_TYPE_CGROUP_SKB);
+	case BPF_CGROUP_INET_SOCK_CREATE:
+		return bpf_cgroup_prog_attach(attr, BPF_PROG_TYPE_CGROUP_SOCK);
+#endif
+#ifdef CONFIG_INET
+	case BPF_SK_LOOKUP:
+		if (attr->attach_flags)
+			return -EINVAL;
+		return inet_sk_lookup_bpf_attach(attr);
+#endif
+	default:
+		return -EINVAL;
+	}
+}
 
 #define BPF_PROG_DETACH_LAST_FIELD attach_type
 
 static int bpf_prog_detach(const union bpf_attr *attr)
 {
+#ifdef CONFIG_CGROUP_BPF
 	struct cgroup *cgrp;
 	int ret;
+#endif
 
 	if (!capable(CAP_NET_ADMIN))
 		return -EPERM;
@@ -983,6 +1220,7 @@ static int bpf_prog_detach(const union bpf_attr *attr)
 		return -EINVAL;
 
 	switch (attr->attach_type) {
+#ifdef CONFIG_CGROUP_BPF
 	case BPF_CGROUP_INET_INGRESS:
 	case BPF_CGROUP_INET_EGRESS:
 	case BPF_CGROUP_INET_SOCK_CREATE:
@@ -992,15 +1230,17 @@ static int bpf_prog_detach(const union bpf_attr *attr)
 
 		ret = cgroup_bpf_update(cgrp, NULL, attr->attach_type, false);
 		cgroup_put(cgrp);
-		break;
-
+		return ret;
+#endif
+#ifdef CONFIG_INET
+	case BPF_SK_LOOKUP:
+		return inet_sk_lookup_bpf_detach(attr);
+#endif
 	default:
 		return -EINVAL;
 	}
-
-	return ret;
 }
-#endif /* CONFIG_CGROUP_BPF */
+#endif /* CONFIG_CGROUP_BPF || CONFIG_INET */
 
 SYSCALL_DEFINE3(bpf, int, cmd, union bpf_attr __user *, uattr, unsigned int, size)
 {
@@ -1059,6 +1299,15 @@ SYSCALL_DEFINE3(bpf, int, cmd, union bpf_attr __user *, uattr, unsigned int, siz
 	case BPF_MAP_GET_NEXT_KEY:
 		err = map_get_next_key(&attr);
 		break;
+	case BPF_MAP_LOOKUP_BATCH:
+		err = map_lookup_batch(&attr, uattr);
+		break;
+	case BPF_MAP_UPDATE_BATCH:
+		err = map_update_batch(&attr, uattr);
+		break;
+	case BPF_MAP_DELETE_BATCH:
+		err = map_delete_batch(&attr, uattr);
+		break;
 	case BPF_PROG_LOAD:
 		err = bpf_prog_load(&attr);
 		break;
@@ -1069,7 +1318,7 @@ SYSCALL_DEFINE3(bpf, int, cmd, union bpf_attr __user *, uattr, unsigned int, siz
 		err = bpf_obj_get(&attr);
 		break;
 
-#ifdef CONFIG_CGROUP_BPF
+#if defined(CONFIG_CGROUP_BPF) || defined(CONFIG_INET)
 	case BPF_PROG_ATTACH:
 		err = bpf_prog_attach(&attr);
 		break;
@@ -1947,6 +1947,254 @@ out_unlock:
 	spin_unlock_irq(&css_set_lock);
 }
 
+/*
+ * rstat - scalable recursive statistics.
+ *
+ * Controllers call cgroup_rstat_updated() from their per-cpu update
+ * paths, which links the cgroup (and any ancestors not yet linked) on
+ * that cpu's updated tree. cgroup_rstat_flush() pops only those
+ * cgroups and hands each to ->css_rstat_flush(), making reads
+ * O(updated cgroups) instead of a full subtree walk per cpu.
+ */
+static DEFINE_SPINLOCK(cgroup_rstat_lock);
+static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
+
+static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
+{
+	return per_cpu_ptr(cgrp->rstat_cpu, cpu);
+}
+
+/**
+ * cgroup_rstat_updated - keep track of updated rstat_cpu
+ * @cgrp: target cgroup
+ * @cpu: cpu on which rstat_cpu was updated
+ *
+ * @cgrp's rstat_cpu on @cpu was updated.  Put it on the parent's
+ * matching updated list.  The caller is responsible for arranging
+ * that the actual counters are visible before this is called.
+ */
+void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
+{
+	raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu);
+	unsigned long flags;
+
+	if (!cgrp->rstat_cpu)
+		return;
+
+	/*
+	 * Speculative already-on-list test.  This may race leading to
+	 * temporary inaccuracies, which is fine.
+	 */
+	if (cgroup_rstat_cpu(cgrp, cpu)->updated_next)
+		return;
+
+	raw_spin_lock_irqsave(cpu_lock, flags);
+
+	/* put @cgrp and all ancestors on the corresponding updated lists */
+	while (true) {
+		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
+		struct cgroup *parent = cgroup_parent(cgrp);
+
+		/*
+		 * Both additions and removals are bottom-up.  If a cgroup
+		 * is already in the tree, all ancestors are.
+		 */
+		if (rstatc->updated_next)
+			break;
+
+		if (parent) {
+			struct cgroup_rstat_cpu *prstatc =
+				cgroup_rstat_cpu(parent, cpu);
+
+			rstatc->updated_next = prstatc->updated_children;
+			prstatc->updated_children = cgrp;
+		} else {
+			/* the root is terminated by itself */
+			rstatc->updated_next = cgrp;
+			break;
+		}
+
+		cgrp = parent;
+	}
+
+	raw_spin_unlock_irqrestore(cpu_lock, flags);
+}
+
+/**
+ * cgroup_rstat_cpu_pop_updated - iterate and dismantle an updated tree
+ * @pos: current position
+ * @root: root of the subtree to traverse
+ * @cpu: target cpu
+ *
+ * Walks the updated tree of @root on @cpu in post-order, unlinking
+ * each visited cgroup so a child is always flushed before its parent.
+ * Start with NULL @pos; the traversal is terminated when NULL is
+ * returned.  The root itself stays linked on its own parent's list.
+ */
+static struct cgroup *cgroup_rstat_cpu_pop_updated(struct cgroup *pos,
+						   struct cgroup *root, int cpu)
+{
+	struct cgroup_rstat_cpu *rstatc;
+
+	if (pos == root)
+		return NULL;
+
+	/*
+	 * We're gonna walk down to the first leaf and visit/remove it.  We
+	 * can pick whatever unvisited node as the starting point.
+	 */
+	if (!pos)
+		pos = root;
+	else
+		pos = cgroup_parent(pos);
+
+	/* walk down to the first leaf */
+	while (true) {
+		rstatc = cgroup_rstat_cpu(pos, cpu);
+		if (rstatc->updated_children == pos)
+			break;
+		pos = rstatc->updated_children;
+	}
+
+	/*
+	 * Unlink @pos from the parent's updated list.  The updated lists
+	 * are singly linked and short, walking to @pos is cheap.
+	 */
+	if (pos != root) {
+		struct cgroup_rstat_cpu *prstatc =
+			cgroup_rstat_cpu(cgroup_parent(pos), cpu);
+		struct cgroup **nextp = &prstatc->updated_children;
+
+		while (*nextp != pos) {
+			struct cgroup_rstat_cpu *nrstatc =
+				cgroup_rstat_cpu(*nextp, cpu);
+
+			WARN_ON_ONCE(*nextp == cgroup_parent(pos));
+			nextp = &nrstatc->updated_next;
+		}
+
+		*nextp = rstatc->updated_next;
+		rstatc->updated_next = NULL;
+	}
+
+	return pos;
+}
+
+/**
+ * cgroup_rstat_flush - flush stats in @cgrp's subtree
+ * @cgrp: target cgroup
+ *
+ * Collects all per-cpu stats in @cgrp's subtree into the global
+ * counters by calling ->css_rstat_flush() on every cgroup with
+ * pending updates and clears the updated trees.
+ */
+void cgroup_rstat_flush(struct cgroup *cgrp)
+{
+	int cpu;
+
+	if (!cgrp->rstat_cpu)
+		return;
+
+	spin_lock_irq(&cgroup_rstat_lock);
+
+	for_each_possible_cpu(cpu) {
+		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
+						       cpu);
+		struct cgroup *pos = NULL;
+
+		raw_spin_lock(cpu_lock);
+		while ((pos = cgroup_rstat_cpu_pop_updated(pos, cgrp, cpu))) {
+			struct cgroup_subsys *ss;
+			int ssid;
+
+			rcu_read_lock();
+			for_each_subsys(ss, ssid) {
+				struct cgroup_subsys_state *css;
+
+				if (!ss->css_rstat_flush)
+					continue;
+
+				css = cgroup_css(pos, ss);
+				if (css)
+					ss->css_rstat_flush(css, cpu);
+			}
+			rcu_read_unlock();
+		}
+		raw_spin_unlock(cpu_lock);
+	}
+
+	spin_unlock_irq(&cgroup_rstat_lock);
+}
+
+static int cgroup_rstat_init(struct cgroup *cgrp)
+{
+	int cpu;
+
+	cgrp->rstat_cpu = alloc_percpu(struct cgroup_rstat_cpu);
+	if (!cgrp->rstat_cpu)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
+
+		rstatc->updated_children = cgrp;
+	}
+
+	return 0;
+}
+
+static void cgroup_rstat_exit(struct cgroup *cgrp)
+{
+	int cpu;
+
+	if (!cgrp->rstat_cpu)
+		return;
+
+	cgroup_rstat_flush(cgrp);
+
+	for_each_possible_cpu(cpu) {
+		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
+						       cpu);
+		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
+		struct cgroup *parent = cgroup_parent(cgrp);
+		unsigned long flags;
+
+		raw_spin_lock_irqsave(cpu_lock, flags);
+
+		WARN_ON_ONCE(rstatc->updated_children != cgrp);
+
+		/* flushing the subtree doesn't unlink @cgrp itself */
+		if (rstatc->updated_next && parent) {
+			struct cgroup_rstat_cpu *prstatc =
+				cgroup_rstat_cpu(parent, cpu);
+			struct cgroup **nextp = &prstatc->updated_children;
+
+			while (*nextp != cgrp) {
+				struct cgroup_rstat_cpu *nrstatc =
+					cgroup_rstat_cpu(*nextp, cpu);
+
+				nextp = &nrstatc->updated_next;
+			}
+
+			*nextp = rstatc->updated_next;
+		}
+		rstatc->updated_next = NULL;
+
+		raw_spin_unlock_irqrestore(cpu_lock, flags);
+	}
+
+	free_percpu(cgrp->rstat_cpu);
+	cgrp->rstat_cpu = NULL;
+}
+
+static void __init cgroup_rstat_boot(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		raw_spin_lock_init(per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu));
+}
+
 static void init_cgroup_housekeeping(struct cgroup *cgrp)
 {
 	struct cgroup_subsys *ss;
@@ -2014,13 +2262,17 @@ static int cgroup_setup_root(struct cgroup_root *root, u16 ss_mask)
 	 * controllers on the default hierarchy and thus create new csets,
 	 * which can't be more than the existing ones.  Allocate 2x.
 	 */
-	ret = allocate_cgrp_cset_links(2 * css_set_count, &tmp_links);
+	ret = cgroup_rstat_init(root_cgrp);
 	if (ret)
 		goto cancel_ref;
 
+	ret = allocate_cgrp_cset_links(2 * css_set_count, &tmp_links);
+	if (ret)
+		goto exit_stats;
+
 	ret = cgroup_init_root_id(root);
 	if (ret)
-		goto cancel_ref;
+		goto exit_stats;
 
 	root->kf_root = kernfs_create_root(&cgroup_kf_syscall_ops,
 					   KERNFS_ROOT_CREATE_DEACTIVATED,
@@ -2073,6 +2325,8 @@ destroy_root:
 	root->kf_root = NULL;
 exit_root_id:
 	cgroup_exit_root_id(root);
+exit_stats:
+	cgroup_rstat_exit(root_cgrp);
 cancel_ref:
 	percpu_ref_exit(&root_cgrp->self.refcnt);
 out:
@@ -5010,6 +5264,7 @@ static void css_free_work_fn(struct work_struct *work)
 		atomic_dec(&cgrp->root->nr_cgrps);
 		cgroup_pidlist_destroy_all(cgrp);
 		cancel_work_sync(&cgrp->release_agent_work);
+		cgroup_rstat_exit(cgrp);
 
 		if (cgroup_parent(cgrp)) {
 			/*
@@ -5254,6 +5509,10 @@ static struct cgroup *cgroup_create(struct cgroup *parent)
 		goto out_cancel_ref;
 	}
 
+	ret = cgroup_rstat_init(cgrp);
+	if (ret)
+		goto out_idr_free;
+
 	init_cgroup_housekeeping(cgrp);
 
 	cgrp->self.parent = &parent->self;
@@ -5296,6 +5555,8 @@ static struct cgroup *cgroup_create(struct cgroup *parent)
 
 	return cgrp;
 
+out_idr_free:
+	cgroup_idr_remove(&root->cgroup_idr, cgrp->id);
 out_cancel_ref:
 	percpu_ref_exit(&cgrp->self.refcnt);
 out_free_cgrp:
@@ -5650,6 +5911,8 @@ int __init cgroup_init(void)
 	BUG_ON(cgroup_init_cftypes(NULL, cgroup_dfl_base_files));
 	BUG_ON(cgroup_init_cftypes(NULL, cgroup_legacy_base_files));
 
+	cgroup_rstat_boot();
+
 	/*
 	 * The latency of the synchronize_sched() is too high for cgroups,
 	 * avoid it at the cost of forcing all readers into the slow path.
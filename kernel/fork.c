@@ -752,6 +752,13 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 {
 	mm->mmap = NULL;
 	mm->mm_rb = RB_ROOT;
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	seqcount_init(&mm->mm_seq);
+	rwlock_init(&mm->mm_rb_lock);
+#endif
+	mm->vma_fences = NULL;
+	mm->nr_fences = 0;
+	mm->fence_mods = 0;
 	mm->vmacache_seqnum = 0;
 	atomic_set(&mm->mm_users, 1);
 	atomic_set(&mm->mm_count, 1);
@@ -762,6 +769,8 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	mm_nr_pmds_init(mm);
 	mm->map_count = 0;
 	mm->locked_vm = 0;
+	atomic_long_set(&mm->mlock_pending, 0);
+	mm_init_fault_around(mm);
 	mm->pinned_vm = 0;
 	memset(&mm->rss_stat, 0, sizeof(mm->rss_stat));
 	spin_lock_init(&mm->page_table_lock);
@@ -788,6 +797,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	if (init_new_context(p, mm))
 		goto fail_nocontext;
 
+	futex_mm_init(mm);
 	mm->user_ns = get_user_ns(user_ns);
 	return mm;
 
@@ -848,6 +858,7 @@ void __mmdrop(struct mm_struct *mm)
 	mm_free_pgd(mm);
 	destroy_context(mm);
 	mmu_notifier_mm_destroy(mm);
+	futex_mm_free(mm);
 	check_mm(mm);
 	put_user_ns(mm->user_ns);
 	free_mm(mm);
@@ -2094,7 +2105,15 @@ void __init proc_caches_init(void)
 			sizeof(struct mm_struct), ARCH_MIN_MMSTRUCT_ALIGN,
 			SLAB_HWCACHE_ALIGN|SLAB_PANIC|SLAB_NOTRACK|SLAB_ACCOUNT,
 			NULL);
-	vm_area_cachep = KMEM_CACHE(vm_area_struct, SLAB_PANIC|SLAB_ACCOUNT);
+	/*
+	 * With speculative page faults, vmas are looked up and dereferenced
+	 * under rcu, so their memory must stay vma typed for a grace period
+	 * after the last free; the sequence count recheck rejects reused
+	 * objects before any state derived from them is committed.
+	 */
+	vm_area_cachep = KMEM_CACHE(vm_area_struct, SLAB_PANIC|SLAB_ACCOUNT|
+			(IS_ENABLED(CONFIG_SPECULATIVE_PAGE_FAULT) ?
+			 SLAB_DESTROY_BY_RCU : 0));
 	mmap_init();
 	nsproxy_cache_init();
 }
@@ -190,6 +190,7 @@ int __read_mostly futex_cmpxchg_enabled;
 #endif
 #define FLAGS_CLOCKRT		0x02
 #define FLAGS_HAS_TIMEOUT	0x04
+#define FLAGS_ADAPTIVE		0x08
 
 /*
  * Priority Inheritance state:
@@ -275,6 +276,47 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * mm-local keys (process-private futexes and futexes on private
+ * mappings) can never match a key from another process, so they get a
+ * hash table of their own and unrelated processes on a shared host
+ * stop colliding on bucket locks.  Only inode-keyed futexes stay in
+ * the global hash.  The per-mm size is fixed at boot; 0 disables the
+ * private tables and everything falls back to the global hash.
+ */
+static unsigned int futex_mm_hashsize __read_mostly;
+
+void futex_mm_init(struct mm_struct *mm)
+{
+	struct futex_hash_bucket *table;
+	unsigned int i;
+
+	mm->futex_hash = NULL;
+	mm->futex_hash_mask = 0;
+
+	if (!futex_mm_hashsize)
+		return;
+
+	table = kmalloc_array(futex_mm_hashsize, sizeof(*table), GFP_KERNEL);
+	if (!table)
+		return;		/* fall back to the global hash */
+
+	for (i = 0; i < futex_mm_hashsize; i++) {
+		atomic_set(&table[i].waiters, 0);
+		plist_head_init(&table[i].chain);
+		spin_lock_init(&table[i].lock);
+	}
+
+	mm->futex_hash = table;
+	mm->futex_hash_mask = futex_mm_hashsize - 1;
+}
+
+void futex_mm_free(struct mm_struct *mm)
+{
+	kfree(mm->futex_hash);
+	mm->futex_hash = NULL;
+}
+
 
 /*
  * Fault injections for futexes.
@@ -382,17 +424,25 @@ static inline int hb_waiters_pending(struct futex_hash_bucket *hb)
 }
 
 /**
- * hash_futex - Return the hash bucket in the global hash
+ * hash_futex - Return the hash bucket for a futex key
  * @key:	Pointer to the futex key for which the hash is calculated
  *
- * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * We hash on the keys returned from get_futex_key (see below).  Keys
+ * carrying an mm reference hash into that mm's private table when it
+ * has one; inode-keyed futexes always use the global hash.
  */
 static struct futex_hash_bucket *hash_futex(union futex_key *key)
 {
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
+
+	if (!(key->both.offset & FUT_OFF_INODE)) {
+		struct mm_struct *mm = key->private.mm;
+
+		if (mm && mm->futex_hash)
+			return &mm->futex_hash[hash & mm->futex_hash_mask];
+	}
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
@@ -2399,6 +2449,52 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_SMP
+/*
+ * Adaptive spin for FUTEX_WAIT_ADAPTIVE: while the lock holder named
+ * in the futex word (TID protocol, as for PI futexes) is running on a
+ * CPU, burn cycles instead of paying a sleep/wake round trip - the
+ * same bet the kernel's own mutexes make in mutex_spin_on_owner().
+ *
+ * Return true if the futex word changed while we spun, in which case
+ * the lock was released or handed over and the waiter should retry
+ * the acquisition in userspace.
+ */
+static bool futex_spin_on_owner(u32 __user *uaddr, u32 val)
+{
+	struct task_struct *owner;
+	bool changed = false;
+	u32 uval;
+
+	if (!(val & FUTEX_TID_MASK))
+		return false;
+
+	owner = futex_find_get_task(val & FUTEX_TID_MASK);
+	if (!owner)
+		return false;
+
+	while (READ_ONCE(owner->on_cpu) &&
+	       !vcpu_is_preempted(task_cpu(owner))) {
+		if (need_resched() || signal_pending(current))
+			break;
+		if (get_user(uval, uaddr))
+			break;
+		if (uval != val) {
+			changed = true;
+			break;
+		}
+		cpu_relax();
+	}
+	put_task_struct(owner);
+	return changed;
+}
+#else
+static inline bool futex_spin_on_owner(u32 __user *uaddr, u32 val)
+{
+	return false;
+}
+#endif
+
 static int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
 		      ktime_t *abs_time, u32 bitset)
 {
@@ -2424,6 +2520,16 @@ static int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
 	}
 
 retry:
+	/*
+	 * Adaptive waiters spin while the owner is on a CPU; if the word
+	 * changed under us the lock was released or handed over, so report
+	 * -EAGAIN and let userspace retry the acquisition path.
+	 */
+	if ((flags & FLAGS_ADAPTIVE) && futex_spin_on_owner(uaddr, val)) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
 	/*
 	 * Prepare to wait on uaddr. On success, holds hb lock and increments
 	 * q.key refs.
@@ -3217,6 +3323,10 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 		val3 = FUTEX_BITSET_MATCH_ANY;
 	case FUTEX_WAIT_BITSET:
 		return futex_wait(uaddr, flags, val, timeout, val3);
+	case FUTEX_WAIT_ADAPTIVE:
+		val3 = FUTEX_BITSET_MATCH_ANY;
+		return futex_wait(uaddr, flags | FLAGS_ADAPTIVE, val, timeout,
+				  val3);
 	case FUTEX_WAKE:
 		val3 = FUTEX_BITSET_MATCH_ANY;
 	case FUTEX_WAKE_BITSET:
@@ -3255,7 +3365,8 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_ADAPTIVE)) {
 		if (unlikely(should_fail_futex(!(op & FUTEX_PRIVATE_FLAG))))
 			return -EFAULT;
 		if (copy_from_user(&ts, utime, sizeof(ts)) != 0)
@@ -3264,7 +3375,7 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 			return -EINVAL;
 
 		t = timespec_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_ADAPTIVE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -3325,6 +3436,15 @@ static int __init futex_init(void)
 		spin_lock_init(&futex_queues[i].lock);
 	}
 
+	/* mm-local tables; modest, since every process pays for one */
+#if CONFIG_BASE_SMALL
+	futex_mm_hashsize = 0;
+#else
+	futex_mm_hashsize = clamp_t(unsigned int,
+				    roundup_pow_of_two(4 * num_possible_cpus()),
+				    16, 128);
+#endif
+
 	return 0;
 }
 core_initcall(futex_init);
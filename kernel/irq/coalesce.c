@@ -0,0 +1,205 @@
+/*
+ * Adaptive interrupt coalescing with per-irq latency targets.
+ *
+ * Drivers which can moderate an interrupt in hardware register a
+ * set_coalesce callback, after which the moderation interval is steered
+ * by the core from a latency target set on the irq.  That way "complete
+ * within N microseconds" is stated once per queue instead of being
+ * retuned through driver specific ethtool knobs.
+ */
+
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/kernel_stat.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+/* Interval at which the controller samples the interrupt rate */
+#define IRQ_COALESCE_PERIOD	msecs_to_jiffies(100)
+
+/*
+ * Below this many interrupts per sampling period moderation only adds
+ * latency: the interrupts arrive further apart than any reasonable
+ * moderation interval anyway.
+ */
+#define IRQ_COALESCE_IDLE_RATE	1000
+
+struct irq_coalesce {
+	unsigned int			irq;
+	const struct irq_coalesce_ops	*ops;
+	void				*dev_data;
+	unsigned int			target_us;
+	unsigned int			cur_us;
+	unsigned int			last_count;
+	struct delayed_work		work;
+};
+
+static void irq_coalesce_work(struct work_struct *work)
+{
+	struct irq_coalesce *coal = container_of(to_delayed_work(work),
+						 struct irq_coalesce, work);
+	unsigned int count, delta, max_us, us;
+
+	if (!coal->target_us) {
+		if (coal->cur_us &&
+		    !coal->ops->set_coalesce(coal->irq, 0, coal->dev_data))
+			coal->cur_us = 0;
+		return;
+	}
+
+	count = kstat_irqs_usr(coal->irq);
+	delta = count - coal->last_count;
+	coal->last_count = count;
+
+	/*
+	 * Moderation may contribute at most half of the latency budget.
+	 * The other half is left for the handler and the completion work
+	 * it kicks off, so a met target really means completions finish
+	 * in time, not merely that the interrupt fired.
+	 */
+	max_us = coal->target_us / 2;
+
+	us = coal->cur_us;
+	if (delta >= IRQ_COALESCE_IDLE_RATE)
+		us = us ? min(us * 2, max_us) : 1;
+	else
+		us /= 2;
+
+	if (us != coal->cur_us &&
+	    !coal->ops->set_coalesce(coal->irq, us, coal->dev_data))
+		coal->cur_us = us;
+
+	schedule_delayed_work(&coal->work, IRQ_COALESCE_PERIOD);
+}
+
+/**
+ *	irq_set_coalesce_ops - install coalescing callbacks for an irq
+ *	@irq:		Interrupt to moderate
+ *	@ops:		Driver callbacks, must stay valid until removal
+ *	@dev_data:	Cookie handed back to the callbacks
+ *
+ *	Must be paired with irq_remove_coalesce_ops() before the driver
+ *	tears down the device behind @dev_data.
+ */
+int irq_set_coalesce_ops(unsigned int irq, const struct irq_coalesce_ops *ops,
+			 void *dev_data)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irq_coalesce *coal;
+	unsigned long flags;
+
+	if (!desc || !ops || !ops->set_coalesce)
+		return -EINVAL;
+
+	coal = kzalloc(sizeof(*coal), GFP_KERNEL);
+	if (!coal)
+		return -ENOMEM;
+
+	coal->irq = irq;
+	coal->ops = ops;
+	coal->dev_data = dev_data;
+	INIT_DELAYED_WORK(&coal->work, irq_coalesce_work);
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	if (desc->coalesce) {
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+		kfree(coal);
+		return -EBUSY;
+	}
+	desc->coalesce = coal;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(irq_set_coalesce_ops);
+
+/**
+ *	irq_remove_coalesce_ops - remove the coalescing callbacks of an irq
+ *	@irq:	Interrupt to stop moderating
+ *
+ *	Disables moderation in the device and waits for the controller
+ *	work to finish; on return the callbacks are no longer invoked.
+ */
+void irq_remove_coalesce_ops(unsigned int irq)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irq_coalesce *coal;
+	unsigned long flags;
+
+	if (!desc)
+		return;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	coal = desc->coalesce;
+	desc->coalesce = NULL;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	if (!coal)
+		return;
+
+	cancel_delayed_work_sync(&coal->work);
+	if (coal->cur_us)
+		coal->ops->set_coalesce(irq, 0, coal->dev_data);
+	kfree(coal);
+}
+EXPORT_SYMBOL_GPL(irq_remove_coalesce_ops);
+
+/**
+ *	irq_set_coalesce_latency - set the latency target of an irq
+ *	@irq:		Interrupt to moderate
+ *	@target_us:	Latency budget in microseconds, 0 disables moderation
+ *
+ *	The moderation interval is adapted to the interrupt rate within
+ *	the budget: it grows while the irq is busy and decays when the
+ *	rate drops, so an idle queue never waits for a timer to fire.
+ *	Fails with -ENODEV until the driver has registered coalescing ops.
+ */
+int irq_set_coalesce_latency(unsigned int irq, unsigned int target_us)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irq_coalesce *coal;
+	unsigned long flags;
+
+	if (!desc)
+		return -EINVAL;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	coal = desc->coalesce;
+	if (!coal) {
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+		return -ENODEV;
+	}
+	coal->target_us = target_us;
+	/*
+	 * Queued under desc->lock so a concurrent
+	 * irq_remove_coalesce_ops() either sees the work pending and
+	 * cancels it, or clears desc->coalesce before we get here.
+	 */
+	schedule_delayed_work(&coal->work, IRQ_COALESCE_PERIOD);
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(irq_set_coalesce_latency);
+
+/* For the procfs interface; 0 means no target or no coalescing ops */
+unsigned int irq_get_coalesce_latency(unsigned int irq)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irq_coalesce *coal;
+	unsigned long flags;
+	unsigned int target_us = 0;
+
+	if (!desc)
+		return 0;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	coal = desc->coalesce;
+	if (coal)
+		target_us = coal->target_us;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return target_us;
+}
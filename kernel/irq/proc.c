@@ -281,6 +281,42 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_GENERIC_IRQ_COALESCE
+static int irq_coalesce_proc_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%u\n", irq_get_coalesce_latency((long) m->private));
+	return 0;
+}
+
+static ssize_t irq_coalesce_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (unsigned int)(long)PDE_DATA(file_inode(file));
+	unsigned int target_us;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 10, &target_us);
+	if (err)
+		return err;
+
+	err = irq_set_coalesce_latency(irq, target_us);
+	return err ?: count;
+}
+
+static int irq_coalesce_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_coalesce_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_coalesce_proc_fops = {
+	.open		= irq_coalesce_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_coalesce_proc_write,
+};
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -366,6 +402,12 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 	proc_create_data("spurious", 0444, desc->dir,
 			 &irq_spurious_proc_fops, (void *)(long)irq);
 
+#ifdef CONFIG_GENERIC_IRQ_COALESCE
+	/* create /proc/irq/<irq>/coalesce_latency_us */
+	proc_create_data("coalesce_latency_us", 0644, desc->dir,
+			 &irq_coalesce_proc_fops, (void *)(long)irq);
+#endif
+
 out_unlock:
 	mutex_unlock(&register_lock);
 }
@@ -383,6 +425,9 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("node", desc->dir);
 #endif
 	remove_proc_entry("spurious", desc->dir);
+#ifdef CONFIG_GENERIC_IRQ_COALESCE
+	remove_proc_entry("coalesce_latency_us", desc->dir);
+#endif
 
 	sprintf(name, "%u", irq);
 	remove_proc_entry(name, root_irq_dir);
@@ -164,6 +164,74 @@ void percpu_down_write(struct percpu_rw_semaphore *sem)
 }
 EXPORT_SYMBOL_GPL(percpu_down_write);
 
+/*
+ * Killable variant for writers that may be waiting a long time for the
+ * reader side to drain, e.g. a would-be mmap_sem style writer behind a
+ * page-fault-heavy workload.  A non-blocking trylock variant is not
+ * possible: rcu_sync_enter() has to wait for a grace period before the
+ * reader fast path is disabled.
+ */
+int __sched percpu_down_write_killable(struct percpu_rw_semaphore *sem)
+{
+	rcu_sync_enter(&sem->rss);
+
+	if (down_write_killable(&sem->rw_sem))
+		goto out_sync;
+
+	/* See percpu_down_write(). */
+	WRITE_ONCE(sem->readers_block, 1);
+
+	smp_mb(); /* D matches A */
+
+	if (wait_event_killable(sem->writer, readers_active_check(sem))) {
+		/*
+		 * Undo in percpu_up_write() order; the readers we did not
+		 * wait out are blocked on ->rw_sem and get going again
+		 * once we drop it.
+		 */
+		smp_store_release(&sem->readers_block, 0);
+		up_write(&sem->rw_sem);
+		goto out_sync;
+	}
+
+	return 0;
+
+out_sync:
+	rcu_sync_exit(&sem->rss);
+	return -EINTR;
+}
+EXPORT_SYMBOL_GPL(percpu_down_write_killable);
+
+/*
+ * Downgrade a write hold to a read hold, analogous to downgrade_write().
+ *
+ * We become a reader on ->read_count before letting new writers at the
+ * lock, so a writer arriving after the up_write() below is guaranteed
+ * to find our increment in readers_active_check() and wait for our
+ * percpu_up_read().  Unlike the fast path readers we may be preempted
+ * and thus decrement on another CPU, which is fine: only the modular
+ * sum of the counters matters, and our decrement cannot make it reach
+ * zero before our critical section ends.
+ *
+ * New readers keep taking the slow path until a grace period after the
+ * rcu_sync_exit() and therefore acquire ->readers_block, which makes
+ * the preceding write-side critical section visible to them; see the
+ * comment in percpu_up_write().
+ */
+void percpu_downgrade_write(struct percpu_rw_semaphore *sem)
+{
+	preempt_disable();
+	__this_cpu_inc(*sem->read_count);
+	preempt_enable();
+
+	smp_store_release(&sem->readers_block, 0);
+	up_write(&sem->rw_sem);
+	rwsem_acquire_read(&sem->rw_sem.dep_map, 0, 1, _RET_IP_);
+
+	rcu_sync_exit(&sem->rss);
+}
+EXPORT_SYMBOL_GPL(percpu_downgrade_write);
+
 void percpu_up_write(struct percpu_rw_semaphore *sem)
 {
 	/*
@@ -75,15 +75,31 @@
 #define MAX_NODES	4
 #endif
 
+/*
+ * The queue nodes carry additional per-node state on a NUMA-aware
+ * build; see qspinlock_cna.h.
+ */
+struct qnode {
+	struct mcs_spinlock	mcs;
+#ifdef CONFIG_NUMA_AWARE_SPINLOCKS
+	int			numa_node;
+	u32			encoded_tail;
+	struct mcs_spinlock	*sec_head;
+	struct mcs_spinlock	*sec_tail;
+	u32			intra_count;
+#endif
+};
+
 /*
  * Per-CPU queue node structures; we can never have more than 4 nested
  * contexts: task, softirq, hardirq, nmi.
  *
- * Exactly fits one 64-byte cacheline on a 64-bit architecture.
+ * Exactly fits one 64-byte cacheline on a 64-bit architecture, unless
+ * the nodes carry CNA state.
  *
  * PV doubles the storage and uses the second cacheline for PV state.
  */
-static DEFINE_PER_CPU_ALIGNED(struct mcs_spinlock, mcs_nodes[MAX_NODES]);
+static DEFINE_PER_CPU_ALIGNED(struct qnode, qnodes[MAX_NODES]);
 
 /*
  * We must be able to distinguish between no-tail and the tail at 0:0,
@@ -108,7 +124,13 @@ static inline __pure struct mcs_spinlock *decode_tail(u32 tail)
 	int cpu = (tail >> _Q_TAIL_CPU_OFFSET) - 1;
 	int idx = (tail &  _Q_TAIL_IDX_MASK) >> _Q_TAIL_IDX_OFFSET;
 
-	return per_cpu_ptr(&mcs_nodes[idx], cpu);
+	return &per_cpu_ptr(&qnodes[idx], cpu)->mcs;
+}
+
+static inline __pure
+struct mcs_spinlock *grab_mcs_node(struct mcs_spinlock *base, int idx)
+{
+	return &((struct qnode *)base + idx)->mcs;
 }
 
 #define _Q_LOCKED_PENDING_MASK (_Q_LOCKED_MASK | _Q_PENDING_MASK)
@@ -241,6 +263,21 @@ static __always_inline void set_locked(struct qspinlock *lock)
 	WRITE_ONCE(l->locked, _Q_LOCKED_VAL);
 }
 
+/*
+ * Generate the NUMA-aware variants of the queue handling functions, or
+ * NOPs when CONFIG_NUMA_AWARE_SPINLOCKS is not configured.
+ */
+#ifdef CONFIG_NUMA_AWARE_SPINLOCKS
+#include "qspinlock_cna.h"
+#else
+static __always_inline void cna_init_node(struct mcs_spinlock *node) { }
+static __always_inline bool cna_try_change_tail(struct qspinlock *lock, u32 val,
+						struct mcs_spinlock *node)
+						{ return false; }
+static __always_inline struct mcs_spinlock *
+cna_pass_lock(struct mcs_spinlock *node, struct mcs_spinlock *next)
+						{ return next; }
+#endif
 
 /*
  * Generate the native code for queued_spin_unlock_slowpath(); provide NOPs for
@@ -490,14 +527,15 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	 * queuing.
 	 */
 queue:
-	node = this_cpu_ptr(&mcs_nodes[0]);
+	node = this_cpu_ptr(&qnodes[0].mcs);
 	idx = node->count++;
 	tail = encode_tail(smp_processor_id(), idx);
 
-	node += idx;
+	node = grab_mcs_node(node, idx);
 	node->locked = 0;
 	node->next = NULL;
 	pv_init_node(node);
+	cna_init_node(node);
 
 	/*
 	 * We touched a (possibly) cold cacheline in the per-cpu queue node;
@@ -592,6 +630,15 @@ locked:
 			set_locked(lock);
 			break;
 		}
+
+		/*
+		 * The main queue is empty; if CNA holds skipped waiters on
+		 * the secondary queue, promote them to main queue instead of
+		 * clearing the tail.
+		 */
+		if (cna_try_change_tail(lock, val, node))
+			goto release;
+
 		/*
 		 * The smp_cond_load_acquire() call above has provided the
 		 * necessary acquire semantics required for locking. At most
@@ -612,6 +659,7 @@ locked:
 			cpu_relax();
 	}
 
+	next = cna_pass_lock(node, next);
 	arch_mcs_spin_unlock_contended(&next->locked);
 	pv_kick_node(lock, next);
 
@@ -619,7 +667,7 @@ release:
 	/*
 	 * release the node
 	 */
-	__this_cpu_dec(mcs_nodes[0].count);
+	__this_cpu_dec(qnodes[0].mcs.count);
 }
 EXPORT_SYMBOL(queued_spin_lock_slowpath);
 
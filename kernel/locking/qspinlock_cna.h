@@ -0,0 +1,225 @@
+#ifndef _KERNEL_LOCKING_QSPINLOCK_CNA_H
+#define _KERNEL_LOCKING_QSPINLOCK_CNA_H
+
+#include <linux/topology.h>
+#include <linux/jump_label.h>
+
+/*
+ * Compact NUMA-aware (CNA) handoff for the queued spinlock slow path.
+ *
+ * Under cross-socket contention, a strictly FIFO handoff bounces the
+ * lock and the protected cacheline between sockets on every single
+ * acquisition.  CNA instead prefers handing the MCS lock to a waiter
+ * running on the lock holder's NUMA node: waiters from other nodes that
+ * sit between the holder and the chosen successor are moved onto a
+ * per-holder secondary queue, where they keep spinning on their own
+ * node->locked exactly as before.  The secondary queue is handed from
+ * holder to holder together with the lock.
+ *
+ * To preserve starvation freedom, the number of consecutive intra-node
+ * handoffs is bounded; once the bound is hit, or when the lock crosses
+ * to another node anyway, the secondary queue is spliced back in front
+ * of the main queue, restoring the original arrival order for the
+ * skipped waiters.
+ *
+ * The scheme is based on the CNA lock by Dice and Kogan (EuroSys '19,
+ * "Compact NUMA-aware Locks").
+ *
+ * The secondary queue reuses the ->next linkage of the moved nodes.
+ * Only the tail node of the secondary queue has a meaningless ->next;
+ * it is rewritten whenever another chain is appended, when the queue
+ * is spliced back, and before the secondary queue is promoted to the
+ * main queue.
+ */
+
+/*
+ * Maximum consecutive intra-node handoffs before the skipped waiters
+ * on the secondary queue are served.  Bounds the extra wait of a
+ * remote waiter to CNA_INTRA_MAX critical sections.
+ */
+#define CNA_INTRA_MAX	256
+
+static DEFINE_STATIC_KEY_FALSE(numa_spinlock_key);
+
+static int numa_spinlock __read_mostly = -1;	/* -1 auto, 0 off, 1 on */
+
+static int __init numa_spinlock_setup(char *str)
+{
+	if (!strcmp(str, "auto"))
+		numa_spinlock = -1;
+	else if (!strcmp(str, "on"))
+		numa_spinlock = 1;
+	else if (!strcmp(str, "off"))
+		numa_spinlock = 0;
+	return 1;
+}
+__setup("numa_spinlock=", numa_spinlock_setup);
+
+/*
+ * Record the NUMA node and the encoded tail of every queue node, then
+ * activate CNA.  Until the key is flipped the nodes are handed out in
+ * plain FIFO order and none of the CNA state is looked at, so locks
+ * taken during early boot are unaffected.
+ */
+static int __init cna_init_nodes(void)
+{
+	int cpu, idx;
+
+	if (numa_spinlock == 0 || (numa_spinlock < 0 && nr_node_ids <= 1))
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		for (idx = 0; idx < MAX_NODES; idx++) {
+			struct qnode *qn = per_cpu_ptr(&qnodes[idx], cpu);
+
+			qn->numa_node = cpu_to_node(cpu);
+			qn->encoded_tail = encode_tail(cpu, idx);
+		}
+	}
+	static_branch_enable(&numa_spinlock_key);
+	return 0;
+}
+early_initcall(cna_init_nodes);
+
+static inline int cna_node_id(struct mcs_spinlock *node)
+{
+	return ((struct qnode *)node)->numa_node;
+}
+
+static __always_inline void cna_init_node(struct mcs_spinlock *node)
+{
+	struct qnode *qn = (struct qnode *)node;
+
+	if (!static_branch_unlikely(&numa_spinlock_key))
+		return;
+
+	qn->sec_head = NULL;
+	qn->sec_tail = NULL;
+	qn->intra_count = 0;
+}
+
+/*
+ * Hand the lock plus the secondary queue and the intra-node handoff
+ * streak to @succ.  The stores hit @succ's node before the release
+ * store to succ->locked, and @succ only looks at them afterwards.
+ */
+static inline struct mcs_spinlock *
+cna_transfer(struct qnode *qn, struct mcs_spinlock *succ, u32 intra)
+{
+	struct qnode *sqn = (struct qnode *)succ;
+
+	sqn->sec_head = qn->sec_head;
+	sqn->sec_tail = qn->sec_tail;
+	sqn->intra_count = intra;
+	return succ;
+}
+
+/*
+ * Splice the secondary queue back in front of the main queue head
+ * @next and hand off to the first skipped waiter.  Its own CNA state
+ * is still zeroed from cna_init_node(), so the handoff streak restarts.
+ */
+static inline struct mcs_spinlock *
+cna_flush_secondary(struct qnode *qn, struct mcs_spinlock *next)
+{
+	struct mcs_spinlock *head = qn->sec_head;
+
+	WRITE_ONCE(qn->sec_tail->next, next);
+	return head;
+}
+
+/*
+ * The main queue ran empty below us.  If skipped waiters are parked on
+ * the secondary queue, promote it to main queue instead of letting the
+ * tail collapse: claim the lock and install the secondary tail as the
+ * queue tail in one cmpxchg, then release the first skipped waiter as
+ * the new queue head.  Returns true with the lock held on success.
+ */
+static bool cna_try_change_tail(struct qspinlock *lock, u32 val,
+				struct mcs_spinlock *node)
+{
+	struct qnode *qn = (struct qnode *)node;
+	struct mcs_spinlock *head;
+	u32 new;
+
+	if (!static_branch_unlikely(&numa_spinlock_key) || !qn->sec_head)
+		return false;
+
+	/*
+	 * The secondary tail becomes the real tail: anything a later
+	 * enqueuer finds behind it must be a valid ->next to link to.
+	 */
+	WRITE_ONCE(qn->sec_tail->next, NULL);
+
+	new = ((struct qnode *)qn->sec_tail)->encoded_tail | _Q_LOCKED_VAL;
+	if (atomic_cmpxchg_relaxed(&lock->val, val, new) != val)
+		return false;
+
+	head = qn->sec_head;
+	arch_mcs_spin_unlock_contended(&head->locked);
+	return true;
+}
+
+/*
+ * Pick the waiter to hand the MCS lock to, preferring waiters on our
+ * own NUMA node, and maintain the secondary queue of skipped waiters.
+ */
+static struct mcs_spinlock *cna_pass_lock(struct mcs_spinlock *node,
+					  struct mcs_spinlock *next)
+{
+	struct qnode *qn = (struct qnode *)node;
+	struct mcs_spinlock *cur, *last, *found;
+
+	if (!static_branch_unlikely(&numa_spinlock_key))
+		return next;
+
+	/*
+	 * Intra-node handoff budget used up: no further skipping, and
+	 * serve the already skipped waiters in arrival order.
+	 */
+	if (qn->intra_count >= CNA_INTRA_MAX) {
+		if (qn->sec_head)
+			return cna_flush_secondary(qn, next);
+		return next;
+	}
+
+	/* Common case: the next waiter shares our node. */
+	if (cna_node_id(next) == qn->numa_node)
+		return cna_transfer(qn, next, qn->intra_count + 1);
+
+	/*
+	 * Scan the main queue for a waiter on our node.  The scan ends
+	 * at the first node whose ->next has not been linked up yet,
+	 * which is fine - it only makes the scan conservative.
+	 */
+	found = NULL;
+	last = next;
+	for (cur = READ_ONCE(next->next); cur; cur = READ_ONCE(cur->next)) {
+		if (cna_node_id(cur) == qn->numa_node) {
+			found = cur;
+			break;
+		}
+		last = cur;
+	}
+
+	if (!found) {
+		/*
+		 * The lock leaves this node either way: serve the
+		 * skipped waiters first to restore arrival order.
+		 */
+		if (qn->sec_head)
+			return cna_flush_secondary(qn, next);
+		return next;
+	}
+
+	/* Move the skipped chain [next, last] to the secondary queue. */
+	if (qn->sec_head)
+		WRITE_ONCE(qn->sec_tail->next, next);
+	else
+		qn->sec_head = next;
+	qn->sec_tail = last;
+
+	return cna_transfer(qn, found, qn->intra_count + 1);
+}
+
+#endif /* _KERNEL_LOCKING_QSPINLOCK_CNA_H */
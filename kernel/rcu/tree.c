@@ -55,6 +55,8 @@
 #include <linux/random.h>
 #include <linux/trace_events.h>
 #include <linux/suspend.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "tree.h"
 #include "rcu.h"
@@ -399,10 +401,12 @@ EXPORT_SYMBOL_GPL(rcu_all_qs);
 static long blimit = 10;	/* Maximum callbacks per rcu_do_batch. */
 static long qhimark = 10000;	/* If this many pending, ignore blimit. */
 static long qlowmark = 100;	/* Once only this many pending, use blimit. */
+static ulong blimit_usecs;	/* Time limit per rcu_do_batch, 0 = none. */
 
-module_param(blimit, long, 0444);
-module_param(qhimark, long, 0444);
-module_param(qlowmark, long, 0444);
+module_param(blimit, long, 0644);
+module_param(qhimark, long, 0644);
+module_param(qlowmark, long, 0644);
+module_param(blimit_usecs, ulong, 0644);
 
 static ulong jiffies_till_first_fqs = ULONG_MAX;
 static ulong jiffies_till_next_fqs = ULONG_MAX;
@@ -2743,6 +2747,7 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	unsigned long flags;
 	struct rcu_head *next, *list, **tail;
 	long bl, count, count_lazy;
+	u64 tlimit = 0;
 	int i;
 
 	/* If no callbacks are ready, just return. */
@@ -2761,6 +2766,13 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	local_irq_save(flags);
 	WARN_ON_ONCE(cpu_is_offline(smp_processor_id()));
 	bl = rdp->blimit;
+	/*
+	 * Bound the time spent invoking callbacks from softirq context, so
+	 * that a callback flood cannot starve the interrupted task.  The
+	 * rcuc kthreads are preemptible and need no such limit.
+	 */
+	if (blimit_usecs && !rcu_is_callbacks_kthread() && !is_idle_task(current))
+		tlimit = local_clock() + blimit_usecs * NSEC_PER_USEC;
 	trace_rcu_batch_start(rsp->name, rdp->qlen_lazy, rdp->qlen, bl);
 	list = rdp->nxtlist;
 	rdp->nxtlist = *rdp->nxttail[RCU_DONE_TAIL];
@@ -2785,6 +2797,9 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 		    (need_resched() ||
 		     (!is_idle_task(current) && !rcu_is_callbacks_kthread())))
 			break;
+		/* Check the time limit only every 32 callbacks. */
+		if (unlikely(tlimit) && !(count & 31) && local_clock() >= tlimit)
+			break;
 	}
 
 	local_irq_save(flags);
@@ -3199,6 +3214,120 @@ void call_rcu_bh(struct rcu_head *head, rcu_callback_t func)
 }
 EXPORT_SYMBOL_GPL(call_rcu_bh);
 
+/*
+ * kfree_rcu() batching.
+ *
+ * Instead of queueing one lazy callback per object, collect the object
+ * pointers in pages and free a whole page worth of objects with a single
+ * kfree_bulk() call from workqueue context.  This keeps rcu_do_batch()
+ * from spending its softirq budget on long runs of trivial kfree
+ * callbacks, and kfree_bulk() amortizes the slab locking across the
+ * objects.  The actual freeing is bounced from the RCU callback to a
+ * workqueue, so the softirq handler only pays for a schedule_work().
+ */
+
+/* How long a batch may sit collecting objects before it is submitted. */
+#define KFREE_DRAIN_JIFFIES	(HZ / 50)
+
+struct kfree_rcu_bulk_data {
+	unsigned long nr_records;
+	struct kfree_rcu_bulk_data *next;
+	void *records[];
+};
+
+#define KFREE_BULK_MAX_ENTR \
+	((PAGE_SIZE - sizeof(struct kfree_rcu_bulk_data)) / sizeof(void *))
+
+/* A batch detached from the per-cpu collector, waiting for a grace period. */
+struct kfree_rcu_batch {
+	struct rcu_head rcu;
+	struct work_struct work;
+	struct kfree_rcu_bulk_data *head;
+};
+
+/* Per-cpu collector for not yet submitted kfree_rcu() objects. */
+struct kfree_rcu_cpu {
+	spinlock_t lock;
+	struct kfree_rcu_bulk_data *head;
+	struct delayed_work monitor_work;
+	bool monitor_todo;
+};
+
+static DEFINE_PER_CPU(struct kfree_rcu_cpu, krc);
+
+static bool kfree_rcu_batching = true;
+module_param(kfree_rcu_batching, bool, 0444);
+
+static void kfree_rcu_bulk_work(struct work_struct *work)
+{
+	struct kfree_rcu_batch *batch =
+		container_of(work, struct kfree_rcu_batch, work);
+	struct kfree_rcu_bulk_data *bnode, *next;
+
+	for (bnode = batch->head; bnode; bnode = next) {
+		next = bnode->next;
+		kfree_bulk(bnode->nr_records, bnode->records);
+		free_page((unsigned long)bnode);
+	}
+	kfree(batch);
+}
+
+static void kfree_rcu_batch_cb(struct rcu_head *rcu)
+{
+	struct kfree_rcu_batch *batch =
+		container_of(rcu, struct kfree_rcu_batch, rcu);
+
+	/* Keep the softirq handler cheap, free from process context. */
+	schedule_work(&batch->work);
+}
+
+/*
+ * Drain the per-cpu collector: detach the accumulated pages and hand
+ * them to call_rcu() as a single batch.  Runs from workqueue context,
+ * so the batch descriptor can be allocated with GFP_KERNEL.
+ */
+static void kfree_rcu_monitor(struct work_struct *work)
+{
+	struct kfree_rcu_cpu *krcp =
+		container_of(work, struct kfree_rcu_cpu, monitor_work.work);
+	struct kfree_rcu_batch *batch;
+	unsigned long flags;
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+
+	spin_lock_irqsave(&krcp->lock, flags);
+	if (!batch) {
+		/* Try again later, the objects are not going anywhere. */
+		schedule_delayed_work(&krcp->monitor_work, KFREE_DRAIN_JIFFIES);
+		spin_unlock_irqrestore(&krcp->lock, flags);
+		return;
+	}
+	batch->head = krcp->head;
+	krcp->head = NULL;
+	krcp->monitor_todo = false;
+	spin_unlock_irqrestore(&krcp->lock, flags);
+
+	if (!batch->head) {
+		kfree(batch);
+		return;
+	}
+
+	INIT_WORK(&batch->work, kfree_rcu_bulk_work);
+	__call_rcu(&batch->rcu, kfree_rcu_batch_cb, rcu_state_p, -1, 1);
+}
+
+static void __init kfree_rcu_batch_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct kfree_rcu_cpu *krcp = per_cpu_ptr(&krc, cpu);
+
+		spin_lock_init(&krcp->lock);
+		INIT_DELAYED_WORK(&krcp->monitor_work, kfree_rcu_monitor);
+	}
+}
+
 /*
  * Queue an RCU callback for lazy invocation after a grace period.
  * This will likely be later named something like "call_rcu_lazy()",
@@ -3209,7 +3338,48 @@ EXPORT_SYMBOL_GPL(call_rcu_bh);
 void kfree_call_rcu(struct rcu_head *head,
 		    rcu_callback_t func)
 {
-	__call_rcu(head, func, rcu_state_p, -1, 1);
+	unsigned long offset = (unsigned long)func;
+	struct kfree_rcu_bulk_data *bnode;
+	struct kfree_rcu_cpu *krcp;
+	unsigned long flags;
+
+	/*
+	 * Batching needs the slab allocator and workqueues; fall back to
+	 * plain lazy callbacks during early boot, for double-argument
+	 * users whose callback is a real function, and when batching is
+	 * disabled on the command line.
+	 */
+	if (!kfree_rcu_batching || !__is_kfree_rcu_offset(offset) ||
+	    rcu_scheduler_active != RCU_SCHEDULER_RUNNING) {
+		__call_rcu(head, func, rcu_state_p, -1, 1);
+		return;
+	}
+
+	local_irq_save(flags);
+	krcp = this_cpu_ptr(&krc);
+	spin_lock(&krcp->lock);
+
+	bnode = krcp->head;
+	if (!bnode || bnode->nr_records == KFREE_BULK_MAX_ENTR) {
+		bnode = (struct kfree_rcu_bulk_data *)
+			__get_free_page(GFP_NOWAIT | __GFP_NOWARN);
+		if (!bnode) {
+			/* Page shortage, queue the object the old way. */
+			spin_unlock_irqrestore(&krcp->lock, flags);
+			__call_rcu(head, func, rcu_state_p, -1, 1);
+			return;
+		}
+		bnode->nr_records = 0;
+		bnode->next = krcp->head;
+		krcp->head = bnode;
+	}
+	bnode->records[bnode->nr_records++] = (void *)head - offset;
+
+	if (!krcp->monitor_todo) {
+		krcp->monitor_todo = true;
+		schedule_delayed_work(&krcp->monitor_work, KFREE_DRAIN_JIFFIES);
+	}
+	spin_unlock_irqrestore(&krcp->lock, flags);
 }
 EXPORT_SYMBOL_GPL(kfree_call_rcu);
 
@@ -4220,6 +4390,7 @@ void __init rcu_init(void)
 
 	rcu_early_boot_tests();
 
+	kfree_rcu_batch_init();
 	rcu_bootup_announce();
 	rcu_init_geometry();
 	rcu_init_one(&rcu_bh_state);
@@ -135,6 +135,36 @@ EXPORT_SYMBOL_GPL(rcu_gp_is_normal);
 static atomic_t rcu_expedited_nesting =
 	ATOMIC_INIT(IS_ENABLED(CONFIG_RCU_EXPEDITE_BOOT) ? 1 : 0);
 
+/*
+ * Global rate limit for task-requested expedited grace periods, in
+ * expedited grace periods per second.  This bounds the IPI load that
+ * rcu_expedite_current() users can generate; requests over the budget
+ * simply fall back to normal grace periods.
+ */
+static int rcu_expedite_self_limit = 100;
+module_param(rcu_expedite_self_limit, int, 0644);
+
+/*
+ * Charge one task-requested expedited grace period against the global
+ * budget.  The budget is a simple per-second window; the races on the
+ * window rollover can give out a few extra tokens, which is harmless
+ * for a mechanism whose only job is to prevent IPI storms.
+ */
+static bool rcu_expedite_self_budget(void)
+{
+	static atomic_t used;
+	static unsigned long window;
+	unsigned long w = READ_ONCE(window);
+
+	if (rcu_expedite_self_limit <= 0)
+		return false;
+	if (time_after(jiffies, w)) {
+		WRITE_ONCE(window, jiffies + HZ);
+		atomic_set(&used, 0);
+	}
+	return atomic_inc_return(&used) <= rcu_expedite_self_limit;
+}
+
 /*
  * Should normal grace-period primitives be expedited?  Intended for
  * use within RCU.  Note that this function takes the rcu_expedited
@@ -144,8 +174,11 @@ static atomic_t rcu_expedited_nesting =
  */
 bool rcu_gp_is_expedited(void)
 {
-	return rcu_expedited || atomic_read(&rcu_expedited_nesting) ||
-	       rcu_scheduler_active == RCU_SCHEDULER_INIT;
+	if (rcu_expedited || atomic_read(&rcu_expedited_nesting) ||
+	    rcu_scheduler_active == RCU_SCHEDULER_INIT)
+		return true;
+	return READ_ONCE(current->rcu_expedite_self) &&
+	       rcu_expedite_self_budget();
 }
 EXPORT_SYMBOL_GPL(rcu_gp_is_expedited);
 
@@ -177,6 +210,33 @@ void rcu_unexpedite_gp(void)
 }
 EXPORT_SYMBOL_GPL(rcu_unexpedite_gp);
 
+/**
+ * rcu_expedite_current - Expedite future grace periods for this task
+ *
+ * Unlike rcu_expedite_gp(), this only affects synchronize_rcu() and
+ * friends invoked by the current task, and only as long as the global
+ * per-second budget (rcupdate.rcu_expedite_self_limit) is not
+ * exhausted; requests over the budget fall back to normal grace
+ * periods.  Intended for latency-sensitive management operations which
+ * perform a bounded burst of updates.  Nests, and must be paired with
+ * rcu_unexpedite_current().
+ */
+void rcu_expedite_current(void)
+{
+	current->rcu_expedite_self++;
+}
+EXPORT_SYMBOL_GPL(rcu_expedite_current);
+
+/**
+ * rcu_unexpedite_current - Cancel prior rcu_expedite_current() invocation
+ */
+void rcu_unexpedite_current(void)
+{
+	WARN_ON_ONCE(current->rcu_expedite_self <= 0);
+	current->rcu_expedite_self--;
+}
+EXPORT_SYMBOL_GPL(rcu_unexpedite_current);
+
 /*
  * Inform RCU of the end of the in-kernel boot sequence.
  */
@@ -5065,18 +5065,22 @@ long __sched io_schedule_timeout(long timeout)
 {
 	int old_iowait = current->in_iowait;
 	struct rq *rq;
+	u64 start;
 	long ret;
 
 	current->in_iowait = 1;
 	blk_schedule_flush_plug(current);
 
 	delayacct_blkio_start();
+	start = local_clock();
 	rq = raw_rq();
 	atomic_inc(&rq->nr_iowait);
 	ret = schedule_timeout(timeout);
 	current->in_iowait = old_iowait;
 	atomic_dec(&rq->nr_iowait);
 	delayacct_blkio_end();
+	cpuacct_charge_delay(current, CPUACCT_DELAY_IOWAIT,
+			     local_clock() - start);
 
 	return ret;
 }
@@ -7603,6 +7607,9 @@ void __init sched_init(void)
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
 	INIT_LIST_HEAD(&root_task_group.siblings);
+#ifdef CONFIG_NUMA_BALANCING
+	root_task_group.numa_balancing = 1;
+#endif
 	autogroup_init(&init_task);
 #endif /* CONFIG_CGROUP_SCHED */
 
@@ -7891,6 +7898,10 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!tg)
 		return ERR_PTR(-ENOMEM);
 
+#ifdef CONFIG_NUMA_BALANCING
+	tg->numa_balancing = parent->numa_balancing;
+#endif
+
 	if (!alloc_fair_sched_group(tg, parent))
 		goto err;
 
@@ -8495,6 +8506,59 @@ static u64 cpu_shares_read_u64(struct cgroup_subsys_state *css,
 	return (u64) scale_load_down(tg->shares);
 }
 
+static int cpu_latency_nice_write_s64(struct cgroup_subsys_state *css,
+				      struct cftype *cftype, s64 latency_nice)
+{
+	if (latency_nice < MIN_NICE || latency_nice > MAX_NICE)
+		return -ERANGE;
+
+	css_tg(css)->latency_nice = latency_nice;
+	return 0;
+}
+
+static s64 cpu_latency_nice_read_s64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return css_tg(css)->latency_nice;
+}
+#endif /* CONFIG_FAIR_GROUP_SCHED */
+
+#ifdef CONFIG_NUMA_BALANCING
+static int cpu_numa_balancing_write_u64(struct cgroup_subsys_state *css,
+					struct cftype *cftype, u64 enable)
+{
+	if (enable > 1)
+		return -EINVAL;
+
+	css_tg(css)->numa_balancing = enable;
+	return 0;
+}
+
+static u64 cpu_numa_balancing_read_u64(struct cgroup_subsys_state *css,
+				       struct cftype *cft)
+{
+	return css_tg(css)->numa_balancing;
+}
+#endif /* CONFIG_NUMA_BALANCING */
+
+static int cpu_util_min_write_u64(struct cgroup_subsys_state *css,
+				  struct cftype *cftype, u64 util_min)
+{
+	if (util_min > SCHED_CAPACITY_SCALE)
+		return -ERANGE;
+
+	css_tg(css)->util_min = util_min;
+	return 0;
+}
+
+static u64 cpu_util_min_read_u64(struct cgroup_subsys_state *css,
+				 struct cftype *cft)
+{
+	return css_tg(css)->util_min;
+}
+
+#ifdef CONFIG_FAIR_GROUP_SCHED
+
 #ifdef CONFIG_CFS_BANDWIDTH
 static DEFINE_MUTEX(cfs_constraints_mutex);
 
@@ -8771,7 +8835,24 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_shares_read_u64,
 		.write_u64 = cpu_shares_write_u64,
 	},
+	{
+		.name = "latency_nice",
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	{
+		.name = "numa_balancing",
+		.read_u64 = cpu_numa_balancing_read_u64,
+		.write_u64 = cpu_numa_balancing_write_u64,
+	},
 #endif
+	{
+		.name = "util_min",
+		.read_u64 = cpu_util_min_read_u64,
+		.write_u64 = cpu_util_min_write_u64,
+	},
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
 		.name = "cfs_quota_us",
@@ -30,16 +30,27 @@ static const char * const cpuacct_stat_desc[] = {
 	[CPUACCT_STAT_SYSTEM] = "system",
 };
 
+static const char * const cpuacct_delay_desc[] = {
+	[CPUACCT_DELAY_RUNQ]	= "runqueue",
+	[CPUACCT_DELAY_IOWAIT]	= "iowait",
+	[CPUACCT_DELAY_RECLAIM]	= "reclaim",
+};
+
 struct cpuacct_usage {
 	u64	usages[CPUACCT_STAT_NSTATS];
 };
 
+struct cpuacct_delays {
+	u64	delays[CPUACCT_DELAY_NSTATS];
+};
+
 /* track cpu usage of a group of tasks and its child groups */
 struct cpuacct {
 	struct cgroup_subsys_state css;
 	/* cpuusage holds pointer to a u64-type object on every cpu */
 	struct cpuacct_usage __percpu *cpuusage;
 	struct kernel_cpustat __percpu *cpustat;
+	struct cpuacct_delays __percpu *delays;
 };
 
 static inline struct cpuacct *css_ca(struct cgroup_subsys_state *css)
@@ -59,9 +70,11 @@ static inline struct cpuacct *parent_ca(struct cpuacct *ca)
 }
 
 static DEFINE_PER_CPU(struct cpuacct_usage, root_cpuacct_cpuusage);
+static DEFINE_PER_CPU(struct cpuacct_delays, root_cpuacct_delays);
 static struct cpuacct root_cpuacct = {
 	.cpustat	= &kernel_cpustat,
 	.cpuusage	= &root_cpuacct_cpuusage,
+	.delays		= &root_cpuacct_delays,
 };
 
 /* create a new cpu accounting group */
@@ -85,8 +98,14 @@ cpuacct_css_alloc(struct cgroup_subsys_state *parent_css)
 	if (!ca->cpustat)
 		goto out_free_cpuusage;
 
+	ca->delays = alloc_percpu(struct cpuacct_delays);
+	if (!ca->delays)
+		goto out_free_cpustat;
+
 	return &ca->css;
 
+out_free_cpustat:
+	free_percpu(ca->cpustat);
 out_free_cpuusage:
 	free_percpu(ca->cpuusage);
 out_free_ca:
@@ -100,6 +119,7 @@ static void cpuacct_css_free(struct cgroup_subsys_state *css)
 {
 	struct cpuacct *ca = css_ca(css);
 
+	free_percpu(ca->delays);
 	free_percpu(ca->cpustat);
 	free_percpu(ca->cpuusage);
 	kfree(ca);
@@ -303,6 +323,30 @@ static int cpuacct_stats_show(struct seq_file *sf, void *v)
 	return 0;
 }
 
+static int cpuacct_delay_stats_show(struct seq_file *sf, void *v)
+{
+	struct cpuacct *ca = css_ca(seq_css(sf));
+	u64 val[CPUACCT_DELAY_NSTATS];
+	int cpu;
+	int stat;
+
+	memset(val, 0, sizeof(val));
+	for_each_possible_cpu(cpu) {
+		struct cpuacct_delays *delays = per_cpu_ptr(ca->delays, cpu);
+
+		for (stat = 0; stat < CPUACCT_DELAY_NSTATS; stat++)
+			val[stat] += delays->delays[stat];
+	}
+
+	for (stat = 0; stat < CPUACCT_DELAY_NSTATS; stat++) {
+		seq_printf(sf, "%s %llu\n",
+			   cpuacct_delay_desc[stat],
+			   (unsigned long long)val[stat]);
+	}
+
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "usage",
@@ -337,6 +381,10 @@ static struct cftype files[] = {
 		.name = "stat",
 		.seq_show = cpuacct_stats_show,
 	},
+	{
+		.name = "delay",
+		.seq_show = cpuacct_delay_stats_show,
+	},
 	{ }	/* terminate */
 };
 
@@ -362,6 +410,25 @@ void cpuacct_charge(struct task_struct *tsk, u64 cputime)
 	rcu_read_unlock();
 }
 
+/*
+ * Charge a delay (in nanoseconds) to the accounting group of @tsk.
+ *
+ * May be called with or without the runqueue lock held; the per-cpu
+ * add keeps the hot path free of shared cachelines.
+ */
+void cpuacct_charge_delay(struct task_struct *tsk,
+			  enum cpuacct_delay_index index, u64 delta)
+{
+	struct cpuacct *ca;
+
+	rcu_read_lock();
+
+	for (ca = task_ca(tsk); ca; ca = parent_ca(ca))
+		this_cpu_add(ca->delays->delays[index], delta);
+
+	rcu_read_unlock();
+}
+
 /*
  * Add user/system time to cpuacct.
  *
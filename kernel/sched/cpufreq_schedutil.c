@@ -54,6 +54,7 @@ struct sugov_cpu {
 	unsigned int cached_raw_freq;
 	unsigned long iowait_boost;
 	unsigned long iowait_boost_max;
+	bool burst_boost;	/* boost came from SCHED_CPUFREQ_BURST */
 	u64 last_update;
 
 	/* The fields below are only needed when sharing a policy. */
@@ -151,6 +152,22 @@ static unsigned int get_next_freq(struct sugov_cpu *sg_cpu, unsigned long util,
 	return cpufreq_driver_resolve_freq(policy, freq);
 }
 
+/*
+ * Minimum utilization the running task's cgroup asks for via
+ * cpu.util_min, so a tagged latency tier starts at a high clock even
+ * when its PELT signal has decayed.
+ */
+static unsigned long sugov_min_util(struct rq *rq)
+{
+#ifdef CONFIG_CGROUP_SCHED
+	struct task_struct *curr = READ_ONCE(rq->curr);
+
+	if (curr->sched_class == &fair_sched_class)
+		return READ_ONCE(task_group(curr)->util_min);
+#endif
+	return 0;
+}
+
 static void sugov_get_util(unsigned long *util, unsigned long *max)
 {
 	struct rq *rq = this_rq();
@@ -159,14 +176,16 @@ static void sugov_get_util(unsigned long *util, unsigned long *max)
 	cfs_max = arch_scale_cpu_capacity(NULL, smp_processor_id());
 
 	*util = min(rq->cfs.avg.util_avg, cfs_max);
+	*util = max(*util, min(sugov_min_util(rq), cfs_max));
 	*max = cfs_max;
 }
 
 static void sugov_set_iowait_boost(struct sugov_cpu *sg_cpu, u64 time,
 				   unsigned int flags)
 {
-	if (flags & SCHED_CPUFREQ_IOWAIT) {
+	if (flags & (SCHED_CPUFREQ_IOWAIT | SCHED_CPUFREQ_BURST)) {
 		sg_cpu->iowait_boost = sg_cpu->iowait_boost_max;
+		sg_cpu->burst_boost = !(flags & SCHED_CPUFREQ_IOWAIT);
 	} else if (sg_cpu->iowait_boost) {
 		s64 delta_ns = time - sg_cpu->last_update;
 
@@ -189,7 +208,8 @@ static void sugov_iowait_boost(struct sugov_cpu *sg_cpu, unsigned long *util,
 		*util = boost_util;
 		*max = boost_max;
 	}
-	sg_cpu->iowait_boost >>= 1;
+	/* A burst boost decays twice as fast as an iowait one. */
+	sg_cpu->iowait_boost >>= sg_cpu->burst_boost ? 2 : 1;
 }
 
 static void sugov_update_single(struct update_util_data *hook, u64 time,
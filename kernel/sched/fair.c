@@ -2323,6 +2323,19 @@ void task_numa_free(struct task_struct *p)
 /*
  * Got a PROT_NONE fault for a page on @node.
  */
+/*
+ * Per-cgroup opt-out: tasks in a group with cpu.numa_balancing == 0
+ * neither scan their address space nor accumulate fault statistics.
+ */
+static bool task_numa_balancing_enabled(struct task_struct *p)
+{
+#ifdef CONFIG_CGROUP_SCHED
+	return READ_ONCE(task_group(p)->numa_balancing);
+#else
+	return true;
+#endif
+}
+
 void task_numa_fault(int last_cpupid, int mem_node, int pages, int flags)
 {
 	struct task_struct *p = current;
@@ -2339,6 +2352,9 @@ void task_numa_fault(int last_cpupid, int mem_node, int pages, int flags)
 	if (!p->mm)
 		return;
 
+	if (!task_numa_balancing_enabled(p))
+		return;
+
 	/* Allocate buffer to track faults on a per-node basis */
 	if (unlikely(!p->numa_faults)) {
 		int size = sizeof(*p->numa_faults) *
@@ -2568,6 +2584,9 @@ void task_tick_numa(struct rq *rq, struct task_struct *curr)
 	if (!curr->mm || (curr->flags & PF_EXITING) || work->next != work)
 		return;
 
+	if (!task_numa_balancing_enabled(curr))
+		return;
+
 	/*
 	 * Using runtime rather than walltime has the dual advantage that
 	 * we (mostly) drive the selection from busy threads and that the
@@ -3473,6 +3492,33 @@ static void check_spread(struct cfs_rq *cfs_rq, struct sched_entity *se)
 #endif
 }
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+/*
+ * Vruntime credit an entity inherits from its task group's latency nice.
+ * Each step of latency nice is worth a quarter of the wakeup granularity,
+ * so a negative latency nice turns into a positive credit: the entity is
+ * placed earlier on wakeup, preempts sooner and resists preemption longer.
+ */
+static s64 se_latency_offset(struct sched_entity *se)
+{
+	struct cfs_rq *my_q = group_cfs_rq(se);
+	int latency_nice;
+
+	if (my_q)	/* group entity: use the group's own value */
+		latency_nice = my_q->tg->latency_nice;
+	else
+		latency_nice = cfs_rq_of(se)->tg->latency_nice;
+
+	return -(s64)latency_nice *
+		(s64)(sysctl_sched_wakeup_granularity >> 2);
+}
+#else
+static s64 se_latency_offset(struct sched_entity *se)
+{
+	return 0;
+}
+#endif
+
 static void
 place_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int initial)
 {
@@ -3499,6 +3545,12 @@ place_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int initial)
 			thresh >>= 1;
 
 		vruntime -= thresh;
+
+		/*
+		 * Entities of latency-biased groups are placed ahead of
+		 * (or behind) where a plain sleeper would go.
+		 */
+		vruntime -= se_latency_offset(se);
 	}
 
 	/* ensure we never gain time by being placed backwards. */
@@ -4725,6 +4777,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 {
 	struct cfs_rq *cfs_rq;
 	struct sched_entity *se = &p->se;
+	bool burst = (flags & ENQUEUE_WAKEUP) && rq->cfs.h_nr_running;
 
 	/*
 	 * If in_iowait is set, the code below may not trigger any cpufreq
@@ -4767,6 +4820,15 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	if (!se)
 		add_nr_running(rq, 1);
 
+	/*
+	 * A wakeup landing on a CPU that already had runnable tasks means
+	 * the runnable count just jumped while the util signal still
+	 * reflects the quieter past; tell the cpufreq governor so it can
+	 * boost right away instead of waiting for PELT to catch up.
+	 */
+	if (burst)
+		cpufreq_update_this_cpu(rq, SCHED_CPUFREQ_BURST);
+
 	hrtick_update(rq);
 }
 
@@ -5748,27 +5810,43 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
 static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int target)
 {
 	struct sched_domain *this_sd;
-	u64 avg_cost, avg_idle = this_rq()->avg_idle;
+	u64 avg_cost, avg_idle;
 	u64 time, cost;
 	s64 delta;
-	int cpu, wrap;
+	int cpu, nr = INT_MAX, wrap;
 
 	this_sd = rcu_dereference(*this_cpu_ptr(&sd_llc));
 	if (!this_sd)
 		return -1;
 
-	avg_cost = this_sd->avg_scan_cost;
-
 	/*
 	 * Due to large variance we need a large fuzz factor; hackbench in
 	 * particularly is sensitive here.
 	 */
-	if ((avg_idle / 512) < avg_cost)
+	avg_idle = this_rq()->avg_idle / 512;
+	avg_cost = this_sd->avg_scan_cost + 1;
+
+	if (sched_feat(SIS_AVG_CPU) && avg_idle < avg_cost)
 		return -1;
 
+	/*
+	 * Bound the scan: the more idle time we have been seeing relative
+	 * to the cost of a full scan, the more CPUs we can afford to look
+	 * at before bailing out.
+	 */
+	if (sched_feat(SIS_PROP)) {
+		u64 span_avg = sd->span_weight * avg_idle;
+		if (span_avg > 4*avg_cost)
+			nr = div_u64(span_avg, avg_cost);
+		else
+			nr = 4;
+	}
+
 	time = local_clock();
 
 	for_each_cpu_wrap(cpu, sched_domain_span(sd), target, wrap) {
+		if (!--nr)
+			return -1;
 		if (!cpumask_test_cpu(cpu, tsk_cpus_allowed(p)))
 			continue;
 		if (idle_cpu(cpu))
@@ -6092,6 +6170,11 @@ wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
+	/* A latency-biased se preempts sooner, a latency-biased curr
+	 * holds on to the CPU longer.
+	 */
+	vdiff += se_latency_offset(se) - se_latency_offset(curr);
+
 	if (vdiff <= 0)
 		return -1;
 
@@ -8265,6 +8348,25 @@ out:
 	return ld_moved;
 }
 
+/*
+ * Histogram of how long a load_balance() attempt took, in log2(usec)
+ * buckets per idle type; printed at the end of each domain line in
+ * /proc/schedstat.
+ */
+static inline void update_lb_cost_hist(struct sched_domain *sd,
+				       enum cpu_idle_type idle, u64 cost)
+{
+#ifdef CONFIG_SCHEDSTATS
+	if (schedstat_enabled()) {
+		u64 us = cost >> 10;	/* close enough to microseconds */
+		int bucket = us ? min_t(int, fls64(us),
+					LB_COST_HIST_BUCKETS) - 1 : 0;
+
+		sd->lb_cost_hist[idle][bucket]++;
+	}
+#endif
+}
+
 static inline unsigned long
 get_sd_balance_interval(struct sched_domain *sd, int cpu_busy)
 {
@@ -8348,6 +8450,7 @@ static int idle_balance(struct rq *this_rq)
 			domain_cost = sched_clock_cpu(this_cpu) - t0;
 			if (domain_cost > sd->max_newidle_lb_cost)
 				sd->max_newidle_lb_cost = domain_cost;
+			update_lb_cost_hist(sd, CPU_NEWLY_IDLE, domain_cost);
 
 			curr_cost += domain_cost;
 		}
@@ -8665,6 +8768,9 @@ static void rebalance_domains(struct rq *rq, enum cpu_idle_type idle)
 		}
 
 		if (time_after_eq(jiffies, sd->last_balance + interval)) {
+			enum cpu_idle_type lb_idle = idle;
+			u64 t0 = schedstat_enabled() ? sched_clock_cpu(cpu) : 0;
+
 			if (load_balance(cpu, rq, sd, idle, &continue_balancing)) {
 				/*
 				 * The LBF_DST_PINNED logic could have changed
@@ -8673,6 +8779,9 @@ static void rebalance_domains(struct rq *rq, enum cpu_idle_type idle)
 				 */
 				idle = idle_cpu(cpu) ? CPU_IDLE : CPU_NOT_IDLE;
 			}
+			if (schedstat_enabled())
+				update_lb_cost_hist(sd, lb_idle,
+						    sched_clock_cpu(cpu) - t0);
 			sd->last_balance = jiffies;
 			interval = get_sd_balance_interval(sd, idle != CPU_IDLE);
 		}
@@ -262,6 +262,11 @@ struct task_group {
 	struct cfs_rq **cfs_rq;
 	unsigned long shares;
 
+	/* Wakeup latency bias for this group's entities, nice-like:
+	 * negative values preempt earlier and are preempted later.
+	 */
+	int latency_nice;
+
 #ifdef	CONFIG_SMP
 	/*
 	 * load_avg can be heavily contended at clock tick time, so put
@@ -272,6 +277,19 @@ struct task_group {
 #endif
 #endif
 
+#ifdef CONFIG_NUMA_BALANCING
+	/* Automatic NUMA balancing on/off for this group's tasks;
+	 * see cpu.numa_balancing.
+	 */
+	int numa_balancing;
+#endif
+
+	/* Minimum CPU utilization hint for schedutil while one of this
+	 * group's tasks is running, 0..SCHED_CAPACITY_SCALE; see
+	 * cpu.util_min.
+	 */
+	unsigned int util_min;
+
 #ifdef CONFIG_RT_GROUP_SCHED
 	struct sched_rt_entity **rt_se;
 	struct rt_rq **rt_rq;
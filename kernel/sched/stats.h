@@ -75,6 +75,8 @@ static inline void sched_info_dequeued(struct rq *rq, struct task_struct *t)
 			delta = now - t->sched_info.last_queued;
 	sched_info_reset_dequeued(t);
 	t->sched_info.run_delay += delta;
+	if (delta)
+		cpuacct_charge_delay(t, CPUACCT_DELAY_RUNQ, delta);
 
 	rq_sched_info_dequeued(rq, delta);
 }
@@ -94,6 +96,8 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.run_delay += delta;
 	t->sched_info.last_arrival = now;
 	t->sched_info.pcount++;
+	if (delta)
+		cpuacct_charge_delay(t, CPUACCT_DELAY_RUNQ, delta);
 
 	rq_sched_info_arrive(rq, delta);
 }
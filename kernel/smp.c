@@ -29,6 +29,7 @@ enum {
 struct call_function_data {
 	struct call_single_data	__percpu *csd;
 	cpumask_var_t		cpumask;
+	cpumask_var_t		cpumask_ipi;
 };
 
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct call_function_data, cfd_data);
@@ -44,9 +45,15 @@ int smpcfd_prepare_cpu(unsigned int cpu)
 	if (!zalloc_cpumask_var_node(&cfd->cpumask, GFP_KERNEL,
 				     cpu_to_node(cpu)))
 		return -ENOMEM;
+	if (!zalloc_cpumask_var_node(&cfd->cpumask_ipi, GFP_KERNEL,
+				     cpu_to_node(cpu))) {
+		free_cpumask_var(cfd->cpumask);
+		return -ENOMEM;
+	}
 	cfd->csd = alloc_percpu(struct call_single_data);
 	if (!cfd->csd) {
 		free_cpumask_var(cfd->cpumask);
+		free_cpumask_var(cfd->cpumask_ipi);
 		return -ENOMEM;
 	}
 
@@ -58,6 +65,7 @@ int smpcfd_dead_cpu(unsigned int cpu)
 	struct call_function_data *cfd = &per_cpu(cfd_data, cpu);
 
 	free_cpumask_var(cfd->cpumask);
+	free_cpumask_var(cfd->cpumask_ipi);
 	free_percpu(cfd->csd);
 	return 0;
 }
@@ -433,6 +441,7 @@ void smp_call_function_many(const struct cpumask *mask,
 	if (unlikely(!cpumask_weight(cfd->cpumask)))
 		return;
 
+	cpumask_clear(cfd->cpumask_ipi);
 	for_each_cpu(cpu, cfd->cpumask) {
 		struct call_single_data *csd = per_cpu_ptr(cfd->csd, cpu);
 
@@ -441,11 +450,17 @@ void smp_call_function_many(const struct cpumask *mask,
 			csd->flags |= CSD_FLAG_SYNCHRONOUS;
 		csd->func = func;
 		csd->info = info;
-		llist_add(&csd->llist, &per_cpu(call_single_queue, cpu));
+		/*
+		 * A CPU whose queue was non-empty still has an IPI (or a
+		 * queue flush) on the way; the new entry rides along with
+		 * it, so there is no need to interrupt it again.
+		 */
+		if (llist_add(&csd->llist, &per_cpu(call_single_queue, cpu)))
+			cpumask_set_cpu(cpu, cfd->cpumask_ipi);
 	}
 
 	/* Send a message to all CPUs in the map */
-	arch_send_call_function_ipi_mask(cfd->cpumask);
+	arch_send_call_function_ipi_mask(cfd->cpumask_ipi);
 
 	if (wait) {
 		for_each_cpu(cpu, cfd->cpumask) {
@@ -458,6 +473,55 @@ void smp_call_function_many(const struct cpumask *mask,
 }
 EXPORT_SYMBOL(smp_call_function_many);
 
+static void smp_call_many_trampoline(void *info)
+{
+	struct smp_call_many_data *data = info;
+
+	data->func(data->info);
+	if (atomic_dec_and_test(&data->pending))
+		complete(&data->done);
+}
+
+/**
+ * smp_call_function_many_async(): Run a function on a set of CPUs with
+ * one completion for the whole set.
+ * @mask: The set of cpus to run on (only runs on online subset,
+ *        excluding the current cpu).  Must not change until the call
+ *        has completed.
+ * @data: Carries the function and argument, and the completion that
+ *        fires once the last target cpu has run the function.
+ *
+ * Returns immediately after queueing the cross calls; the caller can
+ * overlap other work and then sleep on data->done instead of spinning
+ * on every target cpu's csd the way the wait=true variants do.
+ *
+ * Returns the number of cpus the function was queued on.
+ */
+int smp_call_function_many_async(const struct cpumask *mask,
+				 struct smp_call_many_data *data)
+{
+	unsigned int cpu, this_cpu;
+	int cpus = 0;
+
+	preempt_disable();
+	this_cpu = smp_processor_id();
+	for_each_cpu_and(cpu, mask, cpu_online_mask)
+		if (cpu != this_cpu)
+			cpus++;
+
+	init_completion(&data->done);
+	atomic_set(&data->pending, cpus);
+	if (!cpus)
+		complete(&data->done);
+	else
+		smp_call_function_many(mask, smp_call_many_trampoline,
+				       data, false);
+	preempt_enable();
+
+	return cpus;
+}
+EXPORT_SYMBOL(smp_call_function_many_async);
+
 /**
  * smp_call_function(): Run a function on all other CPUs.
  * @func: The function to run. This must be fast and non-blocking.
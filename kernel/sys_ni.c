@@ -146,6 +146,7 @@ cond_syscall(compat_sys_ipc);
 cond_syscall(compat_sys_sysctl);
 cond_syscall(sys_flock);
 cond_syscall(sys_io_setup);
+cond_syscall(sys_io_setup2);
 cond_syscall(sys_io_destroy);
 cond_syscall(sys_io_submit);
 cond_syscall(sys_io_cancel);
@@ -178,6 +179,9 @@ cond_syscall(sys_setfsgid);
 cond_syscall(sys_capget);
 cond_syscall(sys_capset);
 cond_syscall(sys_copy_file_range);
+cond_syscall(sys_copy_file_range_batch);
+cond_syscall(sys_getdents_plus);
+cond_syscall(sys_readfiles);
 
 /* arch-specific weak syscall entries */
 cond_syscall(sys_pciconfig_read);
@@ -1206,6 +1206,9 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 
 	debug_deactivate(timer);
 	cpu_base->running = timer;
+#ifdef CONFIG_HIGH_RES_TIMERS
+	cpu_base->nr_expired++;
+#endif
 
 	/*
 	 * Separate the ->running assignment from the ->state assignment.
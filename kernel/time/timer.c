@@ -973,9 +973,40 @@ __mod_timer(struct timer_list *timer, unsigned long expires, bool pending_only)
 	 * same array bucket then just return:
 	 */
 	if (timer_pending(timer)) {
+		unsigned int lvl;
+
 		if (timer->expires == expires)
 			return 1;
 
+		/*
+		 * The wheel rounds the expiry time up to the granularity of
+		 * the level a timer is queued in, so expiry times which only
+		 * differ below that granularity select the same bucket and
+		 * the same effective expiry. Retransmit style timers are
+		 * re-armed at high rates with deltas which are small
+		 * relative to the granularity of the coarser levels, so
+		 * this avoids the base lock and the requeue entirely.
+		 * timer->expires is deliberately left stale; it deviates
+		 * from the effective expiry by less than the slot
+		 * granularity, which is the accuracy the wheel provides
+		 * anyway.
+		 *
+		 * Only expiries at or before the current one may take the
+		 * shortcut: the bucket fires at the old expiry rounded up,
+		 * so keeping it for a later expiry in the same granule
+		 * would fire the timer early, and the wheel must only
+		 * ever be late.
+		 *
+		 * The unlocked reads of flags and expires are racy, but no
+		 * more so than the expires check above: a concurrent
+		 * requeue or removal simply orders this call before the
+		 * concurrent operation.
+		 */
+		lvl = timer_get_idx(timer) / LVL_SIZE;
+		if (!((timer->expires ^ expires) >> LVL_SHIFT(lvl)) &&
+		    time_before_eq(expires, timer->expires))
+			return 1;
+
 		/*
 		 * We lock timer base and calculate the bucket index right
 		 * here. If the timer ends up in the same bucket, then we
@@ -161,6 +161,7 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 	P_ns(expires_next);
 	P(hres_active);
 	P(nr_events);
+	P(nr_expired);
 	P(nr_retries);
 	P(nr_hangs);
 	P(max_hang_time);
@@ -389,6 +390,43 @@ static const struct file_operations timer_list_fops = {
 	.release	= seq_release_private,
 };
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+/*
+ * Compact per-cpu expiry statistics. Unlike timer_list this does not
+ * walk the timer queues and takes no base locks, so monitoring tools
+ * can poll it at high rates without disturbing the timer fast path.
+ * The unlocked counter reads can be stale by an update, which is
+ * irrelevant for accounting purposes.
+ */
+static int timer_expiry_stats_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	seq_puts(m, "cpu        events       expired       retries hangs max_hang_time\n");
+	for_each_online_cpu(cpu) {
+		struct hrtimer_cpu_base *cpu_base = &per_cpu(hrtimer_bases, cpu);
+
+		seq_printf(m, "%3d %13u %13u %13u %5u %13u\n", cpu,
+			   cpu_base->nr_events, cpu_base->nr_expired,
+			   cpu_base->nr_retries, cpu_base->nr_hangs,
+			   cpu_base->max_hang_time);
+	}
+	return 0;
+}
+
+static int timer_expiry_stats_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, timer_expiry_stats_show, NULL);
+}
+
+static const struct file_operations timer_expiry_stats_fops = {
+	.open		= timer_expiry_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 static int __init init_timer_list_procfs(void)
 {
 	struct proc_dir_entry *pe;
@@ -396,6 +434,12 @@ static int __init init_timer_list_procfs(void)
 	pe = proc_create("timer_list", 0444, NULL, &timer_list_fops);
 	if (!pe)
 		return -ENOMEM;
+#ifdef CONFIG_HIGH_RES_TIMERS
+	pe = proc_create("timer_expiry_stats", 0444, NULL,
+			 &timer_expiry_stats_fops);
+	if (!pe)
+		return -ENOMEM;
+#endif
 	return 0;
 }
 __initcall(init_timer_list_procfs);
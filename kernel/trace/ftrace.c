@@ -470,6 +470,10 @@ static void ftrace_update_pid_func(void)
 }
 
 #ifdef CONFIG_FUNCTION_PROFILER
+
+/* bucket 0 is below 1 us, bucket n is [2^(n-1), 2^n) us, last is open */
+#define FTRACE_PROFILE_HIST_BUCKETS	22
+
 struct ftrace_profile {
 	struct hlist_node		node;
 	unsigned long			ip;
@@ -477,6 +481,9 @@ struct ftrace_profile {
 #ifdef CONFIG_FUNCTION_GRAPH_TRACER
 	unsigned long long		time;
 	unsigned long long		time_squared;
+#ifdef CONFIG_FUNCTION_PROFILER_HISTOGRAM
+	unsigned long			hist[FTRACE_PROFILE_HIST_BUCKETS];
+#endif
 #endif
 };
 
@@ -589,6 +596,46 @@ static int function_stat_headers(struct seq_file *m)
 	return 0;
 }
 
+#ifdef CONFIG_FUNCTION_PROFILER_HISTOGRAM
+static void ftrace_profile_hist_add(struct ftrace_profile *rec,
+				    unsigned long long duration)
+{
+	int bucket = 0;
+
+	/* log2 buckets of the duration in usecs */
+	if (duration >> 10)
+		bucket = min(fls64(duration >> 10),
+			     FTRACE_PROFILE_HIST_BUCKETS - 1);
+
+	rec->hist[bucket]++;
+}
+
+static void function_stat_hist_show(struct seq_file *m,
+				    struct ftrace_profile *rec)
+{
+	int i;
+
+	for (i = 0; i < FTRACE_PROFILE_HIST_BUCKETS; i++) {
+		if (!rec->hist[i])
+			continue;
+		if (i == 0)
+			seq_printf(m, "             < 1 us: %10lu\n",
+				   rec->hist[i]);
+		else if (i == FTRACE_PROFILE_HIST_BUCKETS - 1)
+			seq_printf(m, "    >= %9lu us: %10lu\n",
+				   1UL << (i - 1), rec->hist[i]);
+		else
+			seq_printf(m, "       %9lu us: %10lu\n",
+				   1UL << (i - 1), rec->hist[i]);
+	}
+}
+#else
+static inline void ftrace_profile_hist_add(struct ftrace_profile *rec,
+					   unsigned long long duration) { }
+static inline void function_stat_hist_show(struct seq_file *m,
+					   struct ftrace_profile *rec) { }
+#endif /* CONFIG_FUNCTION_PROFILER_HISTOGRAM */
+
 static int function_stat_show(struct seq_file *m, void *v)
 {
 	struct ftrace_profile *rec = v;
@@ -647,6 +694,7 @@ static int function_stat_show(struct seq_file *m, void *v)
 	trace_print_seq(m, &s);
 #endif
 	seq_putc(m, '\n');
+	function_stat_hist_show(m, rec);
 out:
 	mutex_unlock(&ftrace_profile_lock);
 
@@ -919,6 +967,7 @@ static void profile_graph_return(struct ftrace_graph_ret *trace)
 	if (rec) {
 		rec->time += calltime;
 		rec->time_squared += calltime * calltime;
+		ftrace_profile_hist_add(rec, calltime);
 	}
 
  out:
@@ -300,6 +300,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	u32		 id;		/* index in the mmap page array */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -463,6 +464,11 @@ struct ring_buffer_per_cpu {
 	struct work_struct		update_pages_work;
 	struct completion		update_done;
 
+	/* user space mapping (see ring_buffer_map()) */
+	int				mapped;
+	struct trace_buffer_meta	*meta_page;
+	struct buffer_page		**subbuf_ids; /* id to subbuf */
+
 	struct rb_irq_work		irq_work;
 };
 
@@ -1645,6 +1651,15 @@ int ring_buffer_resize(struct ring_buffer *buffer, unsigned long size,
 	/* prevent another thread from changing buffer sizes */
 	mutex_lock(&buffer->mutex);
 
+	/* a mapped buffer has a fixed user space layout */
+	for_each_buffer_cpu(buffer, cpu) {
+		if (buffer->buffers[cpu]->mapped &&
+		    (cpu_id == RING_BUFFER_ALL_CPUS || cpu_id == cpu)) {
+			err = -EBUSY;
+			goto out_err;
+		}
+	}
+
 	if (cpu_id == RING_BUFFER_ALL_CPUS) {
 		/* calculate the pages to update */
 		for_each_buffer_cpu(buffer, cpu) {
@@ -4353,6 +4368,10 @@ int ring_buffer_swap_cpu(struct ring_buffer *buffer_a,
 	if (local_read(&cpu_buffer_b->committing))
 		goto out_dec;
 
+	/* user space is mapping the pages of one of the buffers */
+	if (cpu_buffer_a->mapped || cpu_buffer_b->mapped)
+		goto out_dec;
+
 	buffer_a->buffers[cpu] = cpu_buffer_b;
 	buffer_b->buffers[cpu] = cpu_buffer_a;
 
@@ -4485,6 +4504,16 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 
 	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
 
+	/*
+	 * We may not swap the reader data page out from under a user
+	 * space mapping; the mapped reader must be consumed through
+	 * TRACE_MMAP_IOCTL_GET_READER instead.
+	 */
+	if (cpu_buffer->mapped) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
 	reader = rb_get_reader_page(cpu_buffer);
 	if (!reader)
 		goto out_unlock;
@@ -4614,6 +4643,232 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+
+	if (!meta)
+		return;
+
+	meta->reader_id = cpu_buffer->reader_page->id;
+	meta->reader_read = cpu_buffer->reader_page->read;
+	meta->reader_lost = cpu_buffer->lost_events;
+
+	meta->entries = local_read(&cpu_buffer->entries);
+	meta->overrun = local_read(&cpu_buffer->overrun);
+	meta->read = cpu_buffer->read;
+}
+
+/**
+ * ring_buffer_map - map a per cpu buffer into user space
+ * @buffer: the buffer the cpu buffer belongs to
+ * @cpu: the cpu buffer to map
+ *
+ * Gives every sub-buffer of the cpu buffer (including the reader page)
+ * a stable id and sets up the meta page that user space reads. Page 0
+ * of the mapping is the meta page, pages 1 .. nr_subbufs are the
+ * sub-buffers in their mapping order. The ids stick to their
+ * struct buffer_page across reader page swaps, so the layout stays
+ * valid while writers keep running; only meta->reader_id moves.
+ *
+ * Must be balanced with a call to ring_buffer_unmap().
+ */
+int ring_buffer_map(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	struct buffer_page **subbuf_ids;
+	struct buffer_page *head, *bpage;
+	unsigned long flags;
+	u32 id = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&buffer->mutex);
+
+	if (cpu_buffer->mapped) {
+		cpu_buffer->mapped++;
+		mutex_unlock(&buffer->mutex);
+		return 0;
+	}
+
+	subbuf_ids = kcalloc(cpu_buffer->nr_pages + 1, sizeof(*subbuf_ids),
+			     GFP_KERNEL);
+	if (!subbuf_ids) {
+		mutex_unlock(&buffer->mutex);
+		return -ENOMEM;
+	}
+
+	meta = (struct trace_buffer_meta *)get_zeroed_page(GFP_KERNEL);
+	if (!meta) {
+		kfree(subbuf_ids);
+		mutex_unlock(&buffer->mutex);
+		return -ENOMEM;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	arch_spin_lock(&cpu_buffer->lock);
+
+	cpu_buffer->reader_page->id = id;
+	subbuf_ids[id++] = cpu_buffer->reader_page;
+
+	head = rb_set_head_page(cpu_buffer);
+	bpage = head;
+	do {
+		if (RB_WARN_ON(cpu_buffer, id > cpu_buffer->nr_pages))
+			break;
+		bpage->id = id;
+		subbuf_ids[id++] = bpage;
+		rb_inc_page(cpu_buffer, &bpage);
+	} while (bpage != head);
+
+	cpu_buffer->subbuf_ids = subbuf_ids;
+	cpu_buffer->meta_page = meta;
+	cpu_buffer->mapped = 1;
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->subbuf_size = PAGE_SIZE;
+	meta->nr_subbufs = cpu_buffer->nr_pages + 1;
+	rb_update_meta_page(cpu_buffer);
+
+	arch_spin_unlock(&cpu_buffer->lock);
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+	mutex_unlock(&buffer->mutex);
+
+	return 0;
+}
+
+/**
+ * ring_buffer_unmap - drop a user space mapping of a per cpu buffer
+ * @buffer: the buffer the cpu buffer belongs to
+ * @cpu: the cpu buffer to unmap
+ */
+int ring_buffer_unmap(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	struct buffer_page **subbuf_ids;
+	unsigned long flags;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&buffer->mutex);
+
+	if (!cpu_buffer->mapped) {
+		mutex_unlock(&buffer->mutex);
+		return -ENODEV;
+	}
+
+	if (--cpu_buffer->mapped) {
+		mutex_unlock(&buffer->mutex);
+		return 0;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	subbuf_ids = cpu_buffer->subbuf_ids;
+	meta = cpu_buffer->meta_page;
+	cpu_buffer->subbuf_ids = NULL;
+	cpu_buffer->meta_page = NULL;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	kfree(subbuf_ids);
+	free_page((unsigned long)meta);
+
+	mutex_unlock(&buffer->mutex);
+
+	return 0;
+}
+
+/**
+ * ring_buffer_map_fault - page backing a given offset of a mapping
+ * @buffer: the buffer the cpu buffer belongs to
+ * @cpu: the mapped cpu buffer
+ * @pgoff: page offset into the mapping
+ *
+ * The caller must hold a reference on the mapping (ring_buffer_map())
+ * while using the returned page.
+ */
+struct page *ring_buffer_map_fault(struct ring_buffer *buffer, int cpu,
+				   unsigned long pgoff)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return NULL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	if (!cpu_buffer->mapped)
+		return NULL;
+
+	if (!pgoff)
+		return virt_to_page(cpu_buffer->meta_page);
+
+	pgoff--;
+	if (pgoff >= cpu_buffer->nr_pages + 1)
+		return NULL;
+
+	return virt_to_page(cpu_buffer->subbuf_ids[pgoff]->page);
+}
+
+/**
+ * ring_buffer_map_get_reader - hand the next sub-buffer to user space
+ * @buffer: the buffer the cpu buffer belongs to
+ * @cpu: the mapped cpu buffer
+ *
+ * Consumes whatever is left on the current reader page and swaps the
+ * next sub-buffer in as the new reader page, without stopping the
+ * writers. The result is published in the meta page: reader_id names
+ * the sub-buffer user space may now read, reader_lost the events that
+ * were overwritten before it was pulled out of the ring.
+ */
+int ring_buffer_map_get_reader(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct buffer_page *reader;
+	unsigned long flags;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	if (!cpu_buffer->mapped) {
+		raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+		return -ENODEV;
+	}
+
+	/*
+	 * The mapped read() path is disabled, so nothing but us moves
+	 * reader_page->read: the page is either untouched or consumed
+	 * whole. Account the remainder before asking for a new page.
+	 */
+	reader = cpu_buffer->reader_page;
+	if (reader->read < rb_page_size(reader)) {
+		cpu_buffer->read += rb_page_entries(reader);
+		cpu_buffer->read_bytes += rb_page_size(reader) - reader->read;
+		reader->read = rb_page_size(reader);
+	}
+
+	rb_get_reader_page(cpu_buffer);
+
+	rb_update_meta_page(cpu_buffer);
+	/* the meta page now owns the lost event count */
+	cpu_buffer->lost_events = 0;
+
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	return 0;
+}
+
 /*
  * We only allocate new buffers, never free them if the CPU goes down.
  * If we were to free the buffer, then the user would lose any trace that was in
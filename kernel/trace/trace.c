@@ -6317,6 +6317,9 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 	trace_access_unlock(iter->cpu_file);
 
 	if (ret < 0) {
+		/* some task has the cpu buffer mmapped */
+		if (ret == -EBUSY)
+			return -EBUSY;
 		if (trace_empty(iter)) {
 			if ((filp->f_flags & O_NONBLOCK))
 				return -EAGAIN;
@@ -6487,6 +6490,9 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 		if (r < 0) {
 			ring_buffer_free_read_page(ref->buffer, ref->page);
 			kfree(ref);
+			/* some task has the cpu buffer mmapped */
+			if (r == -EBUSY)
+				ret = r;
 			break;
 		}
 
@@ -6536,12 +6542,94 @@ out:
 	return ret;
 }
 
+static void tracing_buffers_mmap_open(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	WARN_ON(ring_buffer_map(iter->trace_buffer->buffer, iter->cpu_file));
+}
+
+static void tracing_buffers_mmap_close(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	ring_buffer_unmap(iter->trace_buffer->buffer, iter->cpu_file);
+}
+
+static int tracing_buffers_mmap_fault(struct vm_area_struct *vma,
+				      struct vm_fault *vmf)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+	struct page *page;
+
+	page = ring_buffer_map_fault(iter->trace_buffer->buffer,
+				     iter->cpu_file, vmf->pgoff);
+	if (!page)
+		return VM_FAULT_SIGBUS;
+
+	get_page(page);
+	vmf->page = page;
+
+	return 0;
+}
+
+static const struct vm_operations_struct tracing_buffers_vmops = {
+	.open		= tracing_buffers_mmap_open,
+	.close		= tracing_buffers_mmap_close,
+	.fault		= tracing_buffers_mmap_fault,
+};
+
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int ret;
+
+	if (iter->cpu_file == RING_BUFFER_ALL_CPUS)
+		return -EINVAL;
+
+	/* the buffer pages are consumed through the get-reader ioctl */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	ret = ring_buffer_map(iter->trace_buffer->buffer, iter->cpu_file);
+	if (ret)
+		return ret;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_ops = &tracing_buffers_vmops;
+
+	return 0;
+}
+
+static long tracing_buffers_ioctl(struct file *filp, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	if (cmd != TRACE_MMAP_IOCTL_GET_READER)
+		return -ENOIOCTLCMD;
+
+	if (iter->cpu_file == RING_BUFFER_ALL_CPUS)
+		return -EINVAL;
+
+	return ring_buffer_map_get_reader(iter->trace_buffer->buffer,
+					  iter->cpu_file);
+}
+
 static const struct file_operations tracing_buffers_fops = {
 	.open		= tracing_buffers_open,
 	.read		= tracing_buffers_read,
 	.poll		= tracing_buffers_poll,
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
+	.unlocked_ioctl	= tracing_buffers_ioctl,
+	.mmap		= tracing_buffers_mmap,
 	.llseek		= no_llseek,
 };
 
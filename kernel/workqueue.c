@@ -81,7 +81,8 @@ enum {
 	WORKER_NOT_RUNNING	= WORKER_PREP | WORKER_CPU_INTENSIVE |
 				  WORKER_UNBOUND | WORKER_REBOUND,
 
-	NR_STD_WORKER_POOLS	= 2,		/* # standard pools per cpu */
+	NR_STD_WORKER_POOLS	= 3,		/* # standard pools per cpu:
+						   normal, highpri, express */
 
 	UNBOUND_POOL_HASH_ORDER	= 6,		/* hashed by pool->attrs */
 	BUSY_WORKER_HASH_ORDER	= 6,		/* 64 pointers */
@@ -147,6 +148,7 @@ struct worker_pool {
 	int			node;		/* I: the associated node ID */
 	int			id;		/* I: pool ID */
 	unsigned int		flags;		/* X: flags */
+	bool			express;	/* I: workers run SCHED_FIFO */
 
 	unsigned long		watchdog_ts;	/* L: watchdog timestamp */
 
@@ -236,6 +238,11 @@ struct wq_device;
  * The externally visible workqueue.  It relays the issued work items to
  * the appropriate worker_pool through its pool_workqueues.
  */
+#ifdef CONFIG_WQ_LATENCY_HIST
+/* log2(usec) buckets; the last one is open ended (~2s and beyond) */
+#define WQ_LAT_BUCKETS	22
+#endif
+
 struct workqueue_struct {
 	struct list_head	pwqs;		/* WR: all pwqs of this wq */
 	struct list_head	list;		/* PR: list of all workqueues */
@@ -262,6 +269,10 @@ struct workqueue_struct {
 #endif
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map	lockdep_map;
+#endif
+#ifdef CONFIG_WQ_LATENCY_HIST
+	atomic64_t		queue_lat_hist[WQ_LAT_BUCKETS]; /* queue-to-start */
+	atomic64_t		run_time_hist[WQ_LAT_BUCKETS];	/* start-to-end */
 #endif
 	char			name[WQ_NAME_LEN]; /* I: workqueue name */
 
@@ -1290,11 +1301,29 @@ fail:
  * CONTEXT:
  * spin_lock_irq(pool->lock).
  */
+#ifdef CONFIG_WQ_LATENCY_HIST
+/*
+ * Per-workqueue latency histograms: bucket i counts delays of
+ * [2^i, 2^(i+1)) microseconds, the last bucket is open ended.  See
+ * the queue_lat_hist and run_time_hist sysfs files.
+ */
+static void wq_lat_record(atomic64_t *hist, u64 delta_ns)
+{
+	u64 us = delta_ns >> 10;	/* close enough to microseconds */
+	int bucket = us ? min_t(int, fls64(us), WQ_LAT_BUCKETS) - 1 : 0;
+
+	atomic64_inc(&hist[bucket]);
+}
+#endif
+
 static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 			struct list_head *head, unsigned int extra_flags)
 {
 	struct worker_pool *pool = pwq->pool;
 
+#ifdef CONFIG_WQ_LATENCY_HIST
+	work->enq_time = local_clock();
+#endif
 	/* we own @work, set data and link */
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
@@ -1782,6 +1811,11 @@ static struct worker *create_worker(struct worker_pool *pool)
 		goto fail;
 
 	set_user_nice(worker->task, pool->attrs->nice);
+	if (pool->express) {
+		struct sched_param param = { .sched_priority = 1 };
+
+		sched_setscheduler_nocheck(worker->task, SCHED_FIFO, &param);
+	}
 	kthread_bind_mask(worker->task, pool->attrs->cpumask);
 
 	/* successful, attach the worker to the pool */
@@ -2025,6 +2059,9 @@ __acquires(&pool->lock)
 	bool cpu_intensive = pwq->wq->flags & WQ_CPU_INTENSIVE;
 	int work_color;
 	struct worker *collision;
+#ifdef CONFIG_WQ_LATENCY_HIST
+	u64 lat_start;
+#endif
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -2095,12 +2132,19 @@ __acquires(&pool->lock)
 	lock_map_acquire_read(&pwq->wq->lockdep_map);
 	lock_map_acquire(&lockdep_map);
 	trace_workqueue_execute_start(work);
+#ifdef CONFIG_WQ_LATENCY_HIST
+	lat_start = local_clock();
+	wq_lat_record(pwq->wq->queue_lat_hist, lat_start - work->enq_time);
+#endif
 	worker->current_func(work);
 	/*
 	 * While we must be careful to not use "work" after this, the trace
 	 * point will only record its address.
 	 */
 	trace_workqueue_execute_end(work);
+#ifdef CONFIG_WQ_LATENCY_HIST
+	wq_lat_record(pwq->wq->run_time_hist, local_clock() - lat_start);
+#endif
 	lock_map_release(&lockdep_map);
 	lock_map_release(&pwq->wq->lockdep_map);
 
@@ -3879,6 +3923,11 @@ static int alloc_and_link_pwqs(struct workqueue_struct *wq)
 	int cpu, ret;
 
 	if (!(wq->flags & WQ_UNBOUND)) {
+		int pool_idx = highpri;
+
+		if (wq->flags & WQ_EXPRESS)
+			pool_idx = NR_STD_WORKER_POOLS - 1;
+
 		wq->cpu_pwqs = alloc_percpu(struct pool_workqueue);
 		if (!wq->cpu_pwqs)
 			return -ENOMEM;
@@ -3889,7 +3938,7 @@ static int alloc_and_link_pwqs(struct workqueue_struct *wq)
 			struct worker_pool *cpu_pools =
 				per_cpu(cpu_worker_pools, cpu);
 
-			init_pwq(pwq, wq, &cpu_pools[highpri]);
+			init_pwq(pwq, wq, &cpu_pools[pool_idx]);
 
 			mutex_lock(&wq->mutex);
 			link_pwq(pwq);
@@ -3935,6 +3984,10 @@ struct workqueue_struct *__alloc_workqueue_key(const char *fmt,
 	if ((flags & WQ_POWER_EFFICIENT) && wq_power_efficient)
 		flags |= WQ_UNBOUND;
 
+	/* the express pools are per-cpu by definition */
+	if (WARN_ON_ONCE((flags & WQ_EXPRESS) && (flags & WQ_UNBOUND)))
+		flags &= ~WQ_EXPRESS;
+
 	/* allocate wq and format name */
 	if (flags & WQ_UNBOUND)
 		tbl_size = nr_node_ids * sizeof(wq->numa_pwq_tbl[0]);
@@ -4985,9 +5038,41 @@ static ssize_t max_active_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(max_active);
 
+#ifdef CONFIG_WQ_LATENCY_HIST
+static ssize_t wq_lat_hist_show(char *buf, atomic64_t *hist)
+{
+	int i, written = 0;
+
+	for (i = 0; i < WQ_LAT_BUCKETS; i++)
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "%llu%c",
+				     (unsigned long long)atomic64_read(&hist[i]),
+				     i == WQ_LAT_BUCKETS - 1 ? '\n' : ' ');
+	return written;
+}
+
+static ssize_t queue_lat_hist_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	return wq_lat_hist_show(buf, dev_to_wq(dev)->queue_lat_hist);
+}
+static DEVICE_ATTR_RO(queue_lat_hist);
+
+static ssize_t run_time_hist_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	return wq_lat_hist_show(buf, dev_to_wq(dev)->run_time_hist);
+}
+static DEVICE_ATTR_RO(run_time_hist);
+#endif /* CONFIG_WQ_LATENCY_HIST */
+
 static struct attribute *wq_sysfs_attrs[] = {
 	&dev_attr_per_cpu.attr,
 	&dev_attr_max_active.attr,
+#ifdef CONFIG_WQ_LATENCY_HIST
+	&dev_attr_queue_lat_hist.attr,
+	&dev_attr_run_time_hist.attr,
+#endif
 	NULL,
 };
 ATTRIBUTE_GROUPS(wq_sysfs);
@@ -5497,7 +5582,8 @@ static void __init wq_numa_init(void)
  */
 int __init workqueue_init_early(void)
 {
-	int std_nice[NR_STD_WORKER_POOLS] = { 0, HIGHPRI_NICE_LEVEL };
+	int std_nice[NR_STD_WORKER_POOLS] = { 0, HIGHPRI_NICE_LEVEL,
+					      HIGHPRI_NICE_LEVEL };
 	int i, cpu;
 
 	WARN_ON(__alignof__(struct pool_workqueue) < __alignof__(long long));
@@ -5517,6 +5603,7 @@ int __init workqueue_init_early(void)
 			pool->cpu = cpu;
 			cpumask_copy(pool->attrs->cpumask, cpumask_of(cpu));
 			pool->attrs->nice = std_nice[i++];
+			pool->express = (i == NR_STD_WORKER_POOLS);
 			pool->node = cpu_to_node(cpu);
 
 			/* alloc pool ID */
@@ -1,5 +1,6 @@
 #include <linux/export.h>
 #include <linux/bvec.h>
+#include <linux/moduleparam.h>
 #include <linux/uio.h>
 #include <linux/pagemap.h>
 #include <linux/slab.h>
@@ -372,7 +373,9 @@ static size_t copy_page_to_iter_pipe(struct page *page, size_t offset, size_t by
 	if (idx == pipe->curbuf && pipe->nrbufs)
 		return 0;
 	pipe->nrbufs++;
+	pipe->nrpages++;
 	buf->ops = &page_cache_pipe_buf_ops;
+	buf->flags = 0;
 	get_page(buf->page = page);
 	buf->offset = offset;
 	buf->len = bytes;
@@ -496,7 +499,9 @@ static size_t push_pipe(struct iov_iter *i, size_t size,
 		if (!page)
 			break;
 		pipe->nrbufs++;
+		pipe->nrpages++;
 		pipe->bufs[idx].ops = &default_pipe_buf_ops;
+		pipe->bufs[idx].flags = 0;
 		pipe->bufs[idx].page = page;
 		pipe->bufs[idx].offset = 0;
 		if (left <= PAGE_SIZE) {
@@ -535,11 +540,48 @@ static size_t copy_pipe_to_iter(const void *addr, size_t bytes,
 	return bytes;
 }
 
+/*
+ * copy_from_iter() switches to non-temporal stores for copies at least
+ * this large, so bulk writes do not evict the working set through the
+ * cache on the way to the page cache.  Zero disables the switch.
+ */
+static unsigned long nocache_copy_threshold __read_mostly = 4UL << 20;
+module_param(nocache_copy_threshold, ulong, 0644);
+
+/*
+ * The overwhelmingly common shape for read()/write() is a single user
+ * iovec; special case it ahead of the type dispatch and segment loop.
+ */
+static inline bool iter_is_single_iovec(const struct iov_iter *i)
+{
+	return !(i->type & (ITER_BVEC | ITER_KVEC | ITER_PIPE)) &&
+		i->nr_segs == 1;
+}
+
+static inline void iov_iter_single_advance(struct iov_iter *i, size_t n)
+{
+	i->count -= n;
+	i->iov_offset += n;
+	if (i->iov_offset == i->iov->iov_len) {
+		i->iov++;
+		i->nr_segs--;
+		i->iov_offset = 0;
+	}
+}
+
 size_t copy_to_iter(const void *addr, size_t bytes, struct iov_iter *i)
 {
 	const char *from = addr;
 	if (unlikely(i->type & ITER_PIPE))
 		return copy_pipe_to_iter(addr, bytes, i);
+	if (likely(iter_is_single_iovec(i))) {
+		size_t n = min(bytes, i->count);
+
+		n -= __copy_to_user(i->iov->iov_base + i->iov_offset,
+				    from, n);
+		iov_iter_single_advance(i, n);
+		return n;
+	}
 	iterate_and_advance(i, bytes, v,
 		__copy_to_user(v.iov_base, (from += v.iov_len) - v.iov_len,
 			       v.iov_len),
@@ -559,6 +601,16 @@ size_t copy_from_iter(void *addr, size_t bytes, struct iov_iter *i)
 		WARN_ON(1);
 		return 0;
 	}
+	if (nocache_copy_threshold && bytes >= nocache_copy_threshold)
+		return copy_from_iter_nocache(addr, bytes, i);
+	if (likely(iter_is_single_iovec(i))) {
+		size_t n = min(bytes, i->count);
+
+		n -= __copy_from_user(to, i->iov->iov_base + i->iov_offset,
+				      n);
+		iov_iter_single_advance(i, n);
+		return n;
+	}
 	iterate_and_advance(i, bytes, v,
 		__copy_from_user((to += v.iov_len) - v.iov_len, v.iov_base,
 				 v.iov_len),
@@ -743,6 +795,7 @@ static inline void pipe_truncate(struct iov_iter *i)
 			nrbufs++;
 		}
 		while (pipe->nrbufs > nrbufs) {
+			pipe->nrpages -= pipe_buf_pages(&pipe->bufs[idx]);
 			pipe_buf_release(pipe, &pipe->bufs[idx]);
 			idx = next_idx(idx, pipe);
 			pipe->nrbufs--;
@@ -990,15 +1043,10 @@ static ssize_t pipe_get_pages(struct iov_iter *i,
 	return __pipe_get_pages(i, min(maxsize, capacity), pages, idx, start);
 }
 
-ssize_t iov_iter_get_pages(struct iov_iter *i,
+static ssize_t __iov_iter_get_pages(struct iov_iter *i,
 		   struct page **pages, size_t maxsize, unsigned maxpages,
 		   size_t *start)
 {
-	if (maxsize > i->count)
-		maxsize = i->count;
-
-	if (unlikely(i->type & ITER_PIPE))
-		return pipe_get_pages(i, pages, maxsize, maxpages, start);
 	iterate_all_kinds(i, maxsize, v, ({
 		unsigned long addr = (unsigned long)v.iov_base;
 		size_t len = v.iov_len + (*start = addr & (PAGE_SIZE - 1));
@@ -1024,6 +1072,65 @@ ssize_t iov_iter_get_pages(struct iov_iter *i,
 	)
 	return 0;
 }
+
+/*
+ * Pin the pages backing the next chunk of the iterator.  One call keeps
+ * filling the array across segment boundaries as long as the result still
+ * describes a single contiguous byte stream: every segment after the first
+ * must start on a page boundary and every segment before the last must end
+ * on one.  A well-aligned multi-segment iovec - the common O_DIRECT and
+ * RDMA shape - is thus pinned with a single page table walk per segment in
+ * one call, instead of one call (and one array setup in the caller) per
+ * segment.  The iterator is not advanced.
+ */
+ssize_t iov_iter_get_pages(struct iov_iter *i,
+		   struct page **pages, size_t maxsize, unsigned maxpages,
+		   size_t *start)
+{
+	struct iov_iter tmp;
+	ssize_t total = 0;
+	unsigned got = 0;
+
+	if (maxsize > i->count)
+		maxsize = i->count;
+
+	if (unlikely(i->type & ITER_PIPE))
+		return pipe_get_pages(i, pages, maxsize, maxpages, start);
+
+	tmp = *i;
+	while (maxsize && got < maxpages) {
+		unsigned chunk;
+		size_t off;
+		ssize_t n;
+
+		n = __iov_iter_get_pages(&tmp, pages + got, maxsize,
+					 maxpages - got, &off);
+		if (n <= 0)
+			return total ? total : n;
+		chunk = DIV_ROUND_UP(off + n, PAGE_SIZE);
+		if (!got) {
+			*start = off;
+		} else if (off) {
+			/*
+			 * This segment does not start on a page boundary,
+			 * so appending it would break the contiguity of
+			 * the byte stream.  Drop its pins and finish with
+			 * what we already have.
+			 */
+			while (chunk--)
+				put_page(pages[got + chunk]);
+			break;
+		}
+		got += chunk;
+		total += n;
+		maxsize -= n;
+		iov_iter_advance(&tmp, n);
+		/* a chunk ending in mid-page must be the last one */
+		if ((off + n) & ~PAGE_MASK)
+			break;
+	}
+	return total;
+}
 EXPORT_SYMBOL(iov_iter_get_pages);
 
 static struct page **get_pages_array(size_t n)
@@ -1073,43 +1180,32 @@ ssize_t iov_iter_get_pages_alloc(struct iov_iter *i,
 		   size_t *start)
 {
 	struct page **p;
+	ssize_t n;
+	int npages;
 
 	if (maxsize > i->count)
 		maxsize = i->count;
 
 	if (unlikely(i->type & ITER_PIPE))
 		return pipe_get_pages_alloc(i, pages, maxsize, start);
-	iterate_all_kinds(i, maxsize, v, ({
-		unsigned long addr = (unsigned long)v.iov_base;
-		size_t len = v.iov_len + (*start = addr & (PAGE_SIZE - 1));
-		int n;
-		int res;
 
-		addr &= ~(PAGE_SIZE - 1);
-		n = DIV_ROUND_UP(len, PAGE_SIZE);
-		p = get_pages_array(n);
-		if (!p)
-			return -ENOMEM;
-		res = get_user_pages_fast(addr, n, (i->type & WRITE) != WRITE, p);
-		if (unlikely(res < 0)) {
-			kvfree(p);
-			return res;
-		}
+	/*
+	 * Size the array for everything iov_iter_get_pages() might batch
+	 * up, not just the first segment.
+	 */
+	npages = iov_iter_npages(i, INT_MAX);
+	npages = min_t(int, npages, DIV_ROUND_UP(maxsize, PAGE_SIZE) + 1);
+	if (!npages)
+		return 0;
+	p = get_pages_array(npages);
+	if (!p)
+		return -ENOMEM;
+	n = iov_iter_get_pages(i, p, maxsize, npages, start);
+	if (n > 0)
 		*pages = p;
-		return (res == n ? len : res * PAGE_SIZE) - *start;
-	0;}),({
-		/* can't be more than PAGE_SIZE */
-		*start = v.bv_offset;
-		*pages = p = get_pages_array(1);
-		if (!p)
-			return -ENOMEM;
-		get_page(*p = v.bv_page);
-		return v.bv_len;
-	}),({
-		return -EFAULT;
-	})
-	)
-	return 0;
+	else
+		kvfree(p);
+	return n;
 }
 EXPORT_SYMBOL(iov_iter_get_pages_alloc);
 
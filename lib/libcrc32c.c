@@ -36,6 +36,7 @@
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/scatterlist.h>
 #include <linux/crc32c.h>
 
 static struct crypto_shash *tfm;
@@ -58,6 +59,67 @@ u32 crc32c(u32 crc, const void *address, unsigned int length)
 
 EXPORT_SYMBOL(crc32c);
 
+/*
+ * Checksum an array of independent buffers with a single hash descriptor
+ * set up once, so callers computing many per-block checksums (btrfs,
+ * iSCSI) avoid the per-call descriptor setup.  The buffers are handed to
+ * the winning "crc32c" implementation back-to-back, which is what a
+ * multi-buffer backend registered at higher cra_priority needs to
+ * interleave the computations.
+ */
+void crc32c_bulk(struct crc32c_bulk_req *reqs, unsigned int nreqs)
+{
+	SHASH_DESC_ON_STACK(shash, tfm);
+	u32 *ctx = (u32 *)shash_desc_ctx(shash);
+	unsigned int i;
+	int err;
+
+	shash->tfm = tfm;
+	shash->flags = 0;
+
+	for (i = 0; i < nreqs; i++) {
+		*ctx = reqs[i].crc;
+		err = crypto_shash_update(shash, reqs[i].address,
+					  reqs[i].length);
+		BUG_ON(err);
+		reqs[i].crc = *ctx;
+	}
+}
+EXPORT_SYMBOL(crc32c_bulk);
+
+/*
+ * Scatterlist flavour of crc32c_bulk().  Each of the @nents entries of
+ * @sgl is checksummed independently; crcs[i] seeds and receives the crc
+ * of entry i.  Entries may point at highmem pages and may span several
+ * physically contiguous pages.
+ */
+void crc32c_sg_bulk(struct scatterlist *sgl, unsigned int nents, u32 *crcs)
+{
+	SHASH_DESC_ON_STACK(shash, tfm);
+	u32 *ctx = (u32 *)shash_desc_ctx(shash);
+	struct sg_mapping_iter miter;
+	struct scatterlist *sg;
+	unsigned int i;
+	int err;
+
+	shash->tfm = tfm;
+	shash->flags = 0;
+
+	for_each_sg(sgl, sg, nents, i) {
+		*ctx = crcs[i];
+		sg_miter_start(&miter, sg, 1,
+			       SG_MITER_ATOMIC | SG_MITER_FROM_SG);
+		while (sg_miter_next(&miter)) {
+			err = crypto_shash_update(shash, miter.addr,
+						  miter.length);
+			BUG_ON(err);
+		}
+		sg_miter_stop(&miter);
+		crcs[i] = *ctx;
+	}
+}
+EXPORT_SYMBOL(crc32c_sg_bulk);
+
 static int __init libcrc32c_mod_init(void)
 {
 	tfm = crypto_alloc_shash("crc32c", 0, 0);
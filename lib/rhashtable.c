@@ -121,8 +121,17 @@ static struct bucket_table *bucket_table_alloc(struct rhashtable *ht,
 	int i;
 
 	size = sizeof(*tbl) + nbuckets * sizeof(tbl->buckets[0]);
-	if (size <= (PAGE_SIZE << PAGE_ALLOC_COSTLY_ORDER) ||
-	    gfp != GFP_KERNEL)
+#ifdef CONFIG_NUMA
+	/* Like the lock array: let large bucket arrays come from vmalloc
+	 * so the pages are spread over the nodes instead of being served
+	 * from one node's slab.
+	 */
+	if (size > PAGE_SIZE && gfp == GFP_KERNEL)
+		tbl = vzalloc(size);
+#endif
+	if (tbl == NULL &&
+	    (size <= (PAGE_SIZE << PAGE_ALLOC_COSTLY_ORDER) ||
+	     gfp != GFP_KERNEL))
 		tbl = kzalloc(size, gfp | __GFP_NOWARN | __GFP_NORETRY);
 	if (tbl == NULL && gfp == GFP_KERNEL)
 		tbl = vzalloc(size);
@@ -202,19 +211,37 @@ out:
 	return err;
 }
 
+/* Maximum number of entries migrated per bucket lock hold.  Bounding
+ * the work done under the lock keeps concurrent inserts and removals
+ * on the bucket from stalling behind the migration of a long chain.
+ */
+#define RHT_REHASH_BATCH	16U
+
 static void rhashtable_rehash_chain(struct rhashtable *ht,
 				    unsigned int old_hash)
 {
 	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	spinlock_t *old_bucket_lock;
+	unsigned int budget;
+	bool done;
 
 	old_bucket_lock = rht_bucket_lock(old_tbl, old_hash);
 
-	spin_lock_bh(old_bucket_lock);
-	while (!rhashtable_rehash_one(ht, old_hash))
-		;
-	old_tbl->rehash++;
-	spin_unlock_bh(old_bucket_lock);
+	do {
+		spin_lock_bh(old_bucket_lock);
+
+		budget = RHT_REHASH_BATCH;
+		do {
+			done = rhashtable_rehash_one(ht, old_hash) != 0;
+		} while (!done && --budget);
+
+		if (done)
+			old_tbl->rehash++;
+		spin_unlock_bh(old_bucket_lock);
+
+		if (!done)
+			cond_resched();
+	} while (!done);
 }
 
 static int rhashtable_rehash_attach(struct rhashtable *ht,
@@ -251,8 +278,10 @@ static int rhashtable_rehash_table(struct rhashtable *ht)
 	if (!new_tbl)
 		return 0;
 
-	for (old_hash = 0; old_hash < old_tbl->size; old_hash++)
+	for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
 		rhashtable_rehash_chain(ht, old_hash);
+		cond_resched();
+	}
 
 	/* Publish the new table pointer. */
 	rcu_assign_pointer(ht->tbl, new_tbl);
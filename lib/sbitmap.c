@@ -36,6 +36,13 @@ int sbitmap_init_node(struct sbitmap *sb, unsigned int depth, int shift,
 			while ((4U << shift) > depth)
 				shift--;
 		}
+		/*
+		 * Deep maps (e.g. NVMe-sized tag spaces) get the opposite
+		 * treatment: halve the bits per word so that allocators on
+		 * different CPUs spread over twice as many cachelines.
+		 */
+		if (depth > 4 * BITS_PER_LONG)
+			shift--;
 	}
 	bits_per_word = 1U << shift;
 	if (bits_per_word > BITS_PER_LONG)
@@ -62,11 +69,41 @@ int sbitmap_init_node(struct sbitmap *sb, unsigned int depth, int shift,
 }
 EXPORT_SYMBOL_GPL(sbitmap_init_node);
 
+/*
+ * Fold the batch of deferred frees parked in @cleared back into @word.
+ *
+ * Returns true if any bits were folded, i.e. the caller should retry
+ * allocating from this word.
+ */
+static bool sbitmap_deferred_clear(struct sbitmap *sb, int index)
+{
+	struct sbitmap_word *map = &sb->map[index];
+	unsigned long mask, val;
+
+	if (!READ_ONCE(map->cleared))
+		return false;
+
+	/*
+	 * Grab the whole batch in one go; concurrent frees just start a new
+	 * batch.
+	 */
+	mask = xchg(&map->cleared, 0);
+
+	do {
+		val = map->word;
+	} while (cmpxchg(&map->word, val, val & ~mask) != val);
+
+	return true;
+}
+
 void sbitmap_resize(struct sbitmap *sb, unsigned int depth)
 {
 	unsigned int bits_per_word = 1U << sb->shift;
 	unsigned int i;
 
+	for (i = 0; i < sb->map_nr; i++)
+		sbitmap_deferred_clear(sb, i);
+
 	sb->depth = depth;
 	sb->map_nr = DIV_ROUND_UP(sb->depth, bits_per_word);
 
@@ -117,6 +154,7 @@ int sbitmap_get(struct sbitmap *sb, unsigned int alloc_hint, bool round_robin)
 	index = SB_NR_TO_INDEX(sb, alloc_hint);
 
 	for (i = 0; i < sb->map_nr; i++) {
+again:
 		nr = __sbitmap_get_word(&sb->map[index],
 					SB_NR_TO_BIT(sb, alloc_hint),
 					!round_robin);
@@ -125,6 +163,9 @@ int sbitmap_get(struct sbitmap *sb, unsigned int alloc_hint, bool round_robin)
 			break;
 		}
 
+		if (sbitmap_deferred_clear(sb, index))
+			goto again;
+
 		/* Jump to next index. */
 		index++;
 		alloc_hint = index << sb->shift;
@@ -144,7 +185,7 @@ bool sbitmap_any_bit_set(const struct sbitmap *sb)
 	unsigned int i;
 
 	for (i = 0; i < sb->map_nr; i++) {
-		if (sb->map[i].word)
+		if (sb->map[i].word & ~sb->map[i].cleared)
 			return true;
 	}
 	return false;
@@ -157,9 +198,12 @@ bool sbitmap_any_bit_clear(const struct sbitmap *sb)
 
 	for (i = 0; i < sb->map_nr; i++) {
 		const struct sbitmap_word *word = &sb->map[i];
+		unsigned long busy;
 		unsigned long ret;
 
-		ret = find_first_zero_bit(&word->word, word->depth);
+		/* A deferred-cleared bit is free, it just hasn't been folded. */
+		busy = word->word & ~word->cleared;
+		ret = find_first_zero_bit(&busy, word->depth);
 		if (ret < word->depth)
 			return true;
 	}
@@ -173,8 +217,9 @@ unsigned int sbitmap_weight(const struct sbitmap *sb)
 
 	for (i = 0; i < sb->map_nr; i++) {
 		const struct sbitmap_word *word = &sb->map[i];
+		unsigned long busy = word->word & ~word->cleared;
 
-		weight += bitmap_weight(&word->word, word->depth);
+		weight += bitmap_weight(&busy, word->depth);
 	}
 	return weight;
 }
@@ -219,6 +264,7 @@ int sbitmap_queue_init_node(struct sbitmap_queue *sbq, unsigned int depth,
 
 	sbq->wake_batch = sbq_calc_wake_batch(depth);
 	atomic_set(&sbq->wake_index, 0);
+	atomic_set(&sbq->ws_active, 0);
 
 	sbq->ws = kzalloc_node(SBQ_WAIT_QUEUES * sizeof(*sbq->ws), flags, node);
 	if (!sbq->ws) {
@@ -302,6 +348,13 @@ static void sbq_wake_up(struct sbitmap_queue *sbq)
 	/* Ensure that the wait list checks occur after clear_bit(). */
 	smp_mb();
 
+	/*
+	 * Common case: nobody is waiting, so don't pay for scanning the wait
+	 * queues on every free.
+	 */
+	if (!atomic_read(&sbq->ws_active))
+		return;
+
 	ws = sbq_wake_ptr(sbq);
 	if (!ws)
 		return;
@@ -319,9 +372,20 @@ static void sbq_wake_up(struct sbitmap_queue *sbq)
 void sbitmap_queue_clear(struct sbitmap_queue *sbq, unsigned int nr,
 			 unsigned int cpu)
 {
-	sbitmap_clear_bit(&sbq->sb, nr);
+	/*
+	 * Park the free in @cleared; it is folded back into the word in a
+	 * batch once an allocator exhausts the word's live bits.
+	 */
+	set_bit(SB_NR_TO_BIT(&sbq->sb, nr),
+		&sbq->sb.map[SB_NR_TO_INDEX(&sbq->sb, nr)].cleared);
 	sbq_wake_up(sbq);
-	if (likely(!sbq->round_robin && nr < sbq->sb.depth))
+	/*
+	 * Don't recycle the freed bit into the local alloc hint while others
+	 * are waiting for tags, or the freeing CPU can monopolize the tag
+	 * space by winning every bit it just gave up.
+	 */
+	if (likely(!sbq->round_robin && nr < sbq->sb.depth &&
+		   !atomic_read(&sbq->ws_active)))
 		*per_cpu_ptr(sbq->alloc_hint, cpu) = nr;
 }
 EXPORT_SYMBOL_GPL(sbitmap_queue_clear);
@@ -209,6 +209,25 @@ static ssize_t max_ratio_store(struct device *dev,
 }
 BDI_SHOW(max_ratio, bdi->max_ratio)
 
+static ssize_t min_bandwidth_kb_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	unsigned long kb;
+	ssize_t ret;
+
+	ret = kstrtoul(buf, 10, &kb);
+	if (ret < 0)
+		return ret;
+
+	ret = bdi_set_min_bw(bdi, kb >> (PAGE_SHIFT - 10));
+	if (!ret)
+		ret = count;
+
+	return ret;
+}
+BDI_SHOW(min_bandwidth_kb, K(bdi->min_bw))
+
 static ssize_t stable_pages_required_show(struct device *dev,
 					  struct device_attribute *attr,
 					  char *page)
@@ -224,6 +243,7 @@ static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_read_ahead_kb.attr,
 	&dev_attr_min_ratio.attr,
 	&dev_attr_max_ratio.attr,
+	&dev_attr_min_bandwidth_kb.attr,
 	&dev_attr_stable_pages_required.attr,
 	NULL,
 };
@@ -987,6 +987,31 @@ isolate_migratepages_range(struct compact_control *cc, unsigned long start_pfn,
 #endif /* CONFIG_COMPACTION || CONFIG_CMA */
 #ifdef CONFIG_COMPACTION
 
+/*
+ * Tunable for proactive compaction. It determines how
+ * aggressively the kernel should compact memory in the
+ * background. It takes values in the range [0, 100].
+ */
+unsigned int __read_mostly sysctl_compaction_proactiveness = 20;
+
+/*
+ * Fragmentation score check interval for proactive compaction purposes.
+ */
+#define HPAGE_FRAG_CHECK_INTERVAL_MSEC	(500)
+
+/*
+ * Page order with-respect-to which proactive compaction
+ * calculates external fragmentation, which is used as
+ * the "fragmentation score" of a node/zone.
+ */
+#if defined CONFIG_TRANSPARENT_HUGEPAGE
+#define COMPACTION_HPAGE_ORDER	HPAGE_PMD_ORDER
+#elif defined CONFIG_HUGETLBFS
+#define COMPACTION_HPAGE_ORDER	HUGETLB_PAGE_ORDER
+#else
+#define COMPACTION_HPAGE_ORDER	(PMD_SHIFT - PAGE_SHIFT)
+#endif
+
 /* Returns true if the page is within a block suitable for migration to */
 static bool suitable_migration_target(struct compact_control *cc,
 							struct page *page)
@@ -1275,6 +1300,80 @@ static inline bool is_via_compact_memory(int order)
 	return order == -1;
 }
 
+/*
+ * A zone's fragmentation score is the external fragmentation wrt to the
+ * COMPACTION_HPAGE_ORDER. It returns a value in the range [0, 100].
+ */
+static unsigned int fragmentation_score_zone(struct zone *zone)
+{
+	return extfrag_for_order(zone, COMPACTION_HPAGE_ORDER);
+}
+
+/*
+ * A weighted zone's fragmentation score is the external fragmentation
+ * wrt to the COMPACTION_HPAGE_ORDER scaled by the zone's size. It
+ * returns a value in the range [0, 100].
+ *
+ * The scaling factor ensures that proactive compaction focuses on larger
+ * zones like ZONE_NORMAL, rather than smaller, specialized zones like
+ * ZONE_DMA32. For smaller zones, the value of fragmentation score close
+ * to 100 implies that the per-node fragmentation score will hardly move,
+ * so compaction effort is better spent on the larger zones.
+ */
+static unsigned int fragmentation_score_zone_weighted(struct zone *zone)
+{
+	unsigned long score;
+
+	score = zone->present_pages * fragmentation_score_zone(zone);
+	return score / (zone->zone_pgdat->node_present_pages + 1);
+}
+
+/*
+ * The per-node proactive (background) compaction process is started
+ * by its corresponding kcompactd thread when the node's fragmentation
+ * score exceeds the high threshold. The compaction process remains
+ * active till the node's score falls below the low threshold, or one
+ * of the back-off conditions is hit.
+ */
+static unsigned int fragmentation_score_node(pg_data_t *pgdat)
+{
+	unsigned int score = 0;
+	int zoneid;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone;
+
+		zone = &pgdat->node_zones[zoneid];
+		score += fragmentation_score_zone_weighted(zone);
+	}
+
+	return score;
+}
+
+static unsigned int fragmentation_score_wmark(pg_data_t *pgdat, bool low)
+{
+	unsigned int wmark_low;
+
+	/*
+	 * Cap the low watermark to avoid excessive compaction
+	 * activity in case a user sets the proactiveness tunable
+	 * close to 100 (maximum).
+	 */
+	wmark_low = max(100U - sysctl_compaction_proactiveness, 5U);
+	return low ? wmark_low : min(wmark_low + 10, 100U);
+}
+
+static bool should_proactive_compact_node(pg_data_t *pgdat)
+{
+	int wmark_high;
+
+	if (!sysctl_compaction_proactiveness)
+		return false;
+
+	wmark_high = fragmentation_score_wmark(pgdat, false);
+	return fragmentation_score_node(pgdat) > wmark_high;
+}
+
 static enum compact_result __compact_finished(struct zone *zone, struct compact_control *cc,
 			    const int migratetype)
 {
@@ -1304,6 +1403,20 @@ static enum compact_result __compact_finished(struct zone *zone, struct compact_
 			return COMPACT_PARTIAL_SKIPPED;
 	}
 
+	if (cc->proactive_compaction) {
+		int score, wmark_low;
+		pg_data_t *pgdat;
+
+		pgdat = zone->zone_pgdat;
+		score = fragmentation_score_zone(zone);
+		wmark_low = fragmentation_score_wmark(pgdat, true);
+
+		if (score > wmark_low)
+			return COMPACT_CONTINUE;
+		else
+			return COMPACT_SUCCESS;
+	}
+
 	if (is_via_compact_memory(cc->order))
 		return COMPACT_CONTINUE;
 
@@ -1505,7 +1618,16 @@ static enum compact_result compact_zone(struct zone *zone, struct compact_contro
 	 * want to compact the whole zone), but check that it is initialised
 	 * by ensuring the values are within zone boundaries.
 	 */
-	if (cc->whole_zone) {
+	if (cc->section_end_pfn) {
+		/*
+		 * The caller confined both scanners to a section of the
+		 * zone; they will meet inside it. The cached positions
+		 * are neither used nor updated for the migration scanner,
+		 * as sections from several workers interleave.
+		 */
+		cc->migrate_pfn = cc->section_start_pfn;
+		cc->free_pfn = pageblock_start_pfn(cc->section_end_pfn - 1);
+	} else if (cc->whole_zone) {
 		cc->migrate_pfn = start_pfn;
 		cc->free_pfn = pageblock_start_pfn(end_pfn - 1);
 	} else {
@@ -1749,6 +1871,46 @@ enum compact_result try_to_compact_pages(gfp_t gfp_mask, unsigned int order,
 }
 
 
+/*
+ * Compact all zones within a node till each zone's fragmentation score
+ * reaches within proactive compaction thresholds (as determined by the
+ * proactiveness tunable).
+ *
+ * It is possible that the function returns before reaching score targets
+ * due to various back-off conditions, such as, contention on per-node or
+ * per-zone locks.
+ */
+static void proactive_compact_node(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	struct compact_control cc = {
+		.order = -1,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.whole_zone = true,
+		.gfp_mask = GFP_KERNEL,
+		.proactive_compaction = true,
+	};
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		cc.nr_freepages = 0;
+		cc.nr_migratepages = 0;
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		compact_zone(zone, &cc);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+}
+
 /* Compact all zones within a node */
 static void compact_node(int nid)
 {
@@ -1873,6 +2035,98 @@ static bool kcompactd_node_suitable(pg_data_t *pgdat)
 	return false;
 }
 
+/*
+ * Maximum number of workers compacting sections of one zone in parallel
+ * and the minimum section span worth handing to a worker of its own.
+ * Zones smaller than two sections are compacted single-threaded as
+ * before.
+ */
+#define KCOMPACTD_MAX_WORKERS		4
+#define KCOMPACTD_SECTION_MIN_PAGES	(1UL << (30 - PAGE_SHIFT))
+
+struct kcompactd_section {
+	struct work_struct work;
+	struct zone *zone;
+	int order;
+	int classzone_idx;
+	unsigned long start_pfn;
+	unsigned long end_pfn;
+	enum compact_result status;
+};
+
+static void kcompactd_section_workfn(struct work_struct *work)
+{
+	struct kcompactd_section *section =
+		container_of(work, struct kcompactd_section, work);
+	struct compact_control cc = {
+		.order = section->order,
+		.classzone_idx = section->classzone_idx,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.gfp_mask = GFP_KERNEL,
+		.zone = section->zone,
+		.section_start_pfn = section->start_pfn,
+		.section_end_pfn = section->end_pfn,
+	};
+
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+
+	section->status = compact_zone(section->zone, &cc);
+
+	VM_BUG_ON(!list_empty(&cc.freepages));
+	VM_BUG_ON(!list_empty(&cc.migratepages));
+}
+
+/*
+ * Compact a zone on behalf of kcompactd, partitioning large zones into
+ * pageblock-aligned sections migrated by parallel workers. Each worker
+ * runs a private compact_control whose scanners start and meet within
+ * its own section, so no two workers ever scan the same pageblock.
+ * Pages are still moved towards the end of each section by the usual
+ * migrate_pages() machinery.
+ */
+static enum compact_result kcompactd_compact_zone(struct zone *zone,
+					struct compact_control *cc)
+{
+	struct kcompactd_section sections[KCOMPACTD_MAX_WORKERS];
+	unsigned long start_pfn = zone->zone_start_pfn;
+	unsigned long end_pfn = zone_end_pfn(zone);
+	unsigned long section_pages;
+	enum compact_result ret;
+	int nr, i;
+
+	nr = min3((unsigned long)KCOMPACTD_MAX_WORKERS,
+		  (unsigned long)num_online_cpus(),
+		  (end_pfn - start_pfn) / KCOMPACTD_SECTION_MIN_PAGES);
+	if (nr < 2)
+		return compact_zone(zone, cc);
+
+	section_pages = ALIGN(DIV_ROUND_UP(end_pfn - start_pfn, nr),
+			      pageblock_nr_pages);
+	for (i = 0; i < nr; i++) {
+		struct kcompactd_section *section = &sections[i];
+
+		section->zone = zone;
+		section->order = cc->order;
+		section->classzone_idx = cc->classzone_idx;
+		section->start_pfn = start_pfn + i * section_pages;
+		section->end_pfn = min(section->start_pfn + section_pages,
+				       end_pfn);
+		INIT_WORK_ONSTACK(&section->work, kcompactd_section_workfn);
+		queue_work(system_unbound_wq, &section->work);
+	}
+
+	ret = COMPACT_SKIPPED;
+	for (i = 0; i < nr; i++) {
+		flush_work(&sections[i].work);
+		ret = max(sections[i].status, ret);
+		destroy_work_on_stack(&sections[i].work);
+	}
+
+	return ret;
+}
+
 static void kcompactd_do_work(pg_data_t *pgdat)
 {
 	/*
@@ -1915,7 +2169,7 @@ static void kcompactd_do_work(pg_data_t *pgdat)
 
 		if (kthread_should_stop())
 			return;
-		status = compact_zone(zone, &cc);
+		status = kcompactd_compact_zone(zone, &cc);
 
 		if (status == COMPACT_SUCCESS) {
 			compaction_defer_reset(zone, cc.order, false);
@@ -1972,6 +2226,7 @@ static int kcompactd(void *p)
 {
 	pg_data_t *pgdat = (pg_data_t*)p;
 	struct task_struct *tsk = current;
+	unsigned int proactive_defer = 0;
 
 	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
 
@@ -1985,10 +2240,28 @@ static int kcompactd(void *p)
 
 	while (!kthread_should_stop()) {
 		trace_mm_compaction_kcompactd_sleep(pgdat->node_id);
-		wait_event_freezable(pgdat->kcompactd_wait,
-				kcompactd_work_requested(pgdat));
+		if (wait_event_freezable_timeout(pgdat->kcompactd_wait,
+			kcompactd_work_requested(pgdat),
+			msecs_to_jiffies(HPAGE_FRAG_CHECK_INTERVAL_MSEC))) {
 
-		kcompactd_do_work(pgdat);
+			kcompactd_do_work(pgdat);
+			continue;
+		}
+
+		/* kcompactd wait timeout */
+		if (should_proactive_compact_node(pgdat)) {
+			if (proactive_defer) {
+				proactive_defer--;
+				continue;
+			}
+			proactive_compact_node(pgdat);
+			/*
+			 * Defer proactive compaction if the fragmentation
+			 * score did not go down, i.e. no progress made.
+			 */
+			proactive_defer = should_proactive_compact_node(pgdat) ?
+					1 << COMPACT_MAX_DEFER_SHIFT : 0;
+		}
 	}
 
 	return 0;
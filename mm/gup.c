@@ -1046,6 +1046,14 @@ long populate_vma_page_range(struct vm_area_struct *vma,
 				NULL, NULL, nonblocking);
 }
 
+/*
+ * Populate at most this many bytes per mmap_sem hold.  Faulting in a
+ * very large mlocked region in one go would otherwise keep the
+ * semaphore read-held for the whole walk, starving writers (and other
+ * fault paths on contended configs) for seconds.
+ */
+#define MM_POPULATE_CHUNK	(64UL << 20)
+
 /*
  * __mm_populate - populate and/or mlock pages within a range of address space.
  *
@@ -1087,6 +1095,8 @@ int __mm_populate(unsigned long start, unsigned long len, int ignore_errors)
 			continue;
 		if (nstart < vma->vm_start)
 			nstart = vma->vm_start;
+		if (nend - nstart > MM_POPULATE_CHUNK)
+			nend = nstart + MM_POPULATE_CHUNK;
 		/*
 		 * Now fault in a range of pages. populate_vma_page_range()
 		 * double checks the vma flags, so that it won't mlock pages
@@ -1102,6 +1112,15 @@ int __mm_populate(unsigned long start, unsigned long len, int ignore_errors)
 		}
 		nend = nstart + ret * PAGE_SIZE;
 		ret = 0;
+		/*
+		 * Let mmap_sem waiters in between chunks; the lookup is
+		 * redone from scratch on the next iteration.
+		 */
+		if (locked && nend < end) {
+			up_read(&mm->mmap_sem);
+			locked = 0;
+			cond_resched();
+		}
 	}
 	if (locked)
 		up_read(&mm->mmap_sem);
@@ -2801,7 +2801,15 @@ static int __init hugetlb_init(void)
 	hugetlb_cgroup_file_init();
 
 #ifdef CONFIG_SMP
-	num_fault_mutexes = roundup_pow_of_two(8 * num_possible_cpus());
+	/*
+	 * The table only needs to be big enough that concurrent faults on
+	 * *different* pages rarely hash to the same mutex.  With many
+	 * threads first-touching a large mapping at once, 8 mutexes per
+	 * cpu still produces noticeable birthday collisions; 64 per cpu
+	 * keeps the collision rate negligible for a few hundred kB of
+	 * mutexes on large machines.
+	 */
+	num_fault_mutexes = roundup_pow_of_two(64 * num_possible_cpus());
 #else
 	num_fault_mutexes = 1;
 #endif
@@ -606,10 +606,99 @@ out:
 	return 0;
 }
 
+/*
+ * Scratch state for the unlocked precopy phase of collapse_huge_page().
+ * khugepaged is single threaded, so static buffers are fine here and
+ * keep 8k of pte values and page pointers off the stack.
+ */
+static pte_t collapse_pte_snapshot[HPAGE_PMD_NR];
+static struct page *collapse_precopy_pages[HPAGE_PMD_NR];
+
+/*
+ * Phase one of the collapse: copy the payload of the small pages into
+ * @new_page while holding mmap_sem only for read.
+ *
+ * The ptes are write protected and the range flushed before the pages
+ * are read, so a later write must fault and change the pte. The copy
+ * phase under mmap_sem write compares each pte against the snapshot
+ * taken here and only re-copies pages that changed in between. Pages
+ * with extra references (gup users can write without faulting) are left
+ * for the locked copy; their snapshot entry stays pte_none and thus
+ * never matches a present pte.
+ *
+ * Returns the number of pages precopied.
+ */
+static int __collapse_huge_page_precopy(struct vm_area_struct *vma,
+					unsigned long address, pmd_t *pmd,
+					struct page *new_page,
+					pte_t *snapshot)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long _address;
+	spinlock_t *ptl;
+	pte_t *pte, *_pte;
+	int i, precopied = 0;
+
+	pte = pte_offset_map_lock(mm, pmd, address, &ptl);
+
+	for (_pte = pte, _address = address; _pte < pte + HPAGE_PMD_NR;
+	     _pte++, _address += PAGE_SIZE) {
+		pte_t pteval = *_pte;
+
+		if (pte_present(pteval) && pte_write(pteval))
+			ptep_set_wrprotect(mm, _address, _pte);
+	}
+
+	/*
+	 * After the flush no cpu holds a stale writable translation and
+	 * gup_fast rechecks the pte after taking its reference, so every
+	 * writer from here on either faults (changing the pte) or shows
+	 * up in the page count below.
+	 */
+	flush_tlb_range(vma, address, address + HPAGE_PMD_SIZE);
+
+	for (i = 0, _pte = pte, _address = address; i < HPAGE_PMD_NR;
+	     i++, _pte++, _address += PAGE_SIZE) {
+		pte_t pteval = *_pte;
+		struct page *src_page;
+
+		snapshot[i] = __pte(0);
+		collapse_precopy_pages[i] = NULL;
+
+		if (!pte_present(pteval) || is_zero_pfn(pte_pfn(pteval)))
+			continue;
+		src_page = vm_normal_page(vma, _address, pteval);
+		if (!src_page)
+			continue;
+		if (page_count(src_page) != 1 + !!PageSwapCache(src_page))
+			continue;
+
+		get_page(src_page);
+		collapse_precopy_pages[i] = src_page;
+		snapshot[i] = pteval;
+	}
+	pte_unmap_unlock(pte, ptl);
+
+	for (i = 0, _address = address; i < HPAGE_PMD_NR;
+	     i++, _address += PAGE_SIZE) {
+		struct page *src_page = collapse_precopy_pages[i];
+
+		if (!src_page)
+			continue;
+		copy_user_highpage(new_page + i, src_page, _address, vma);
+		put_page(src_page);
+		collapse_precopy_pages[i] = NULL;
+		precopied++;
+	}
+
+	return precopied;
+}
+
 static void __collapse_huge_page_copy(pte_t *pte, struct page *page,
 				      struct vm_area_struct *vma,
 				      unsigned long address,
-				      spinlock_t *ptl)
+				      spinlock_t *ptl,
+				      pte_t *snapshot)
 {
 	pte_t *_pte;
 	for (_pte = pte; _pte < pte+HPAGE_PMD_NR; _pte++) {
@@ -633,7 +722,15 @@ static void __collapse_huge_page_copy(pte_t *pte, struct page *page,
 			}
 		} else {
 			src_page = pte_page(pteval);
-			copy_user_highpage(page, src_page, address, vma);
+			/*
+			 * Skip pages whose pte did not change since the
+			 * unlocked precopy; their payload already sits
+			 * in the huge page.
+			 */
+			if (!snapshot ||
+			    !pte_same(pteval, snapshot[_pte - pte]))
+				copy_user_highpage(page, src_page, address,
+						   vma);
 			VM_BUG_ON_PAGE(page_mapcount(src_page) != 1, src_page);
 			release_pte_page(src_page);
 			/*
@@ -933,7 +1030,7 @@ static void collapse_huge_page(struct mm_struct *mm,
 	pgtable_t pgtable;
 	struct page *new_page;
 	spinlock_t *pmd_ptl, *pte_ptl;
-	int isolated = 0, result = 0;
+	int isolated = 0, result = 0, precopied = 0;
 	struct mem_cgroup *memcg;
 	struct vm_area_struct *vma;
 	unsigned long mmun_start;	/* For mmu_notifiers */
@@ -990,6 +1087,14 @@ static void collapse_huge_page(struct mm_struct *mm,
 		goto out_nolock;
 	}
 
+	/*
+	 * Do the bulk of the copy while other threads can still fault
+	 * and mmap. Pages written to afterwards are detected through
+	 * the pte snapshot and copied again below under mmap_sem write.
+	 */
+	precopied = __collapse_huge_page_precopy(vma, address, pmd, new_page,
+						 collapse_pte_snapshot);
+
 	up_read(&mm->mmap_sem);
 	/*
 	 * Prevent all access to pagetables with the exception of
@@ -1049,7 +1154,8 @@ static void collapse_huge_page(struct mm_struct *mm,
 	 */
 	anon_vma_unlock_write(vma->anon_vma);
 
-	__collapse_huge_page_copy(pte, new_page, vma, address, pte_ptl);
+	__collapse_huge_page_copy(pte, new_page, vma, address, pte_ptl,
+				  precopied ? collapse_pte_snapshot : NULL);
 	pte_unmap(pte);
 	__SetPageUptodate(new_page);
 	pgtable = pmd_pgtable(_pmd);
@@ -104,6 +104,12 @@ struct mm_slot {
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	/*
+	 * Number of this mm's pages handed out by the scan cursor and not
+	 * yet merged: while non-zero the mm's rmap_items and the slot
+	 * itself must not be torn down.  Protected by ksm_scan_mutex.
+	 */
+	int nr_scanning;
 };
 
 /**
@@ -154,6 +160,8 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @age: number of scan passes since the checksum last changed, capped
+ * @remaining_skips: how many more scan passes to skip this page for
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -169,6 +177,8 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned char age;
+	unsigned char remaining_skips;
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -223,6 +233,18 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Rescan pages with an unchanged checksum at longer and longer intervals */
+static unsigned int ksm_smart_scan = 1;
+
+/* The number of page scans skipped thanks to an aged checksum */
+static unsigned long ksm_pages_skipped;
+
+/* The pool of scan threads: ksmd itself plus optional helpers */
+#define KSM_MAX_SCAN_THREADS	16
+static unsigned int ksm_nr_scan_threads = 1;
+static struct task_struct *ksm_scan_tasks[KSM_MAX_SCAN_THREADS];
+static DEFINE_MUTEX(ksm_scan_threads_lock);
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -238,9 +260,20 @@ static int ksm_nr_node_ids = 1;
 #define KSM_RUN_OFFLINE	4
 static unsigned long ksm_run = KSM_RUN_STOP;
 static void wait_while_offlining(void);
+static void scan_wait_while_offlining(void);
 
 static DECLARE_WAIT_QUEUE_HEAD(ksm_thread_wait);
-static DEFINE_MUTEX(ksm_thread_mutex);
+/*
+ * Taken for read by the scan threads for the duration of a batch, and
+ * for write by everything that must exclude scanning: the run and
+ * merge_across_nodes knobs and memory offlining.
+ */
+static DECLARE_RWSEM(ksm_thread_sem);
+/*
+ * Serializes the scan cursor and all stable/unstable tree manipulation
+ * among the scan threads; only checksumming runs outside it.
+ */
+static DEFINE_MUTEX(ksm_scan_mutex);
 static DEFINE_SPINLOCK(ksm_mmlist_lock);
 
 #define KSM_KMEM_CACHE(__struct, __flags) kmem_cache_create("ksm_"#__struct,\
@@ -1407,14 +1440,16 @@ static void stable_tree_append(struct rmap_item *rmap_item,
  *
  * @page: the page that we are searching identical page to.
  * @rmap_item: the reverse mapping into the virtual address of this page
+ * @have_checksum: whether the caller precomputed the page's checksum
+ * @checksum: the precomputed checksum, if so
  */
-static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
+static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item,
+			       bool have_checksum, unsigned int checksum)
 {
 	struct rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
 	struct page *kpage;
-	unsigned int checksum;
 	int err;
 
 	stable_node = page_stable_node(page);
@@ -1461,9 +1496,12 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
+	if (!have_checksum)
+		checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
+		rmap_item->age = 0;
+		rmap_item->remaining_skips = 0;
 		return;
 	}
 
@@ -1528,7 +1566,66 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
-static struct rmap_item *scan_get_next_rmap_item(struct page **page)
+/*
+ * How many scan passes to skip, given how many passes the page has
+ * already gone through with an unchanged checksum.
+ */
+static unsigned int skip_age(unsigned char age)
+{
+	if (age <= 3)
+		return 1;
+	if (age <= 5)
+		return 2;
+	if (age <= 8)
+		return 4;
+	return 8;
+}
+
+/*
+ * With smart scanning, pages whose checksum keeps coming back the same
+ * are rescanned at longer and longer intervals instead of being
+ * re-checksummed on every pass; a checksum change resets the interval
+ * (see cmp_and_merge_page).  Called under ksm_scan_mutex.
+ */
+static bool should_skip_rmap_item(struct page *page,
+				  struct rmap_item *rmap_item)
+{
+	unsigned char age;
+
+	if (!ksm_smart_scan)
+		return false;
+
+	/*
+	 * Never skip pages that are already KSM: their rmap_items carry
+	 * no checksum age, and skipping them would delay rescuing their
+	 * stale stable tree nodes.
+	 */
+	if (PageKsm(page))
+		return false;
+
+	age = rmap_item->age;
+	if (age != U8_MAX)
+		rmap_item->age++;
+
+	/*
+	 * Scan the page on its first couple of passes: the checksum has
+	 * to settle before skipping can tell us anything.
+	 */
+	if (!age)
+		return false;
+
+	if (rmap_item->remaining_skips) {
+		rmap_item->remaining_skips--;
+		ksm_pages_skipped++;
+		return true;
+	}
+
+	rmap_item->remaining_skips = skip_age(age);
+	return false;
+}
+
+static struct rmap_item *scan_get_next_rmap_item(struct page **page,
+						 struct mm_slot **slotp)
 {
 	struct mm_struct *mm;
 	struct mm_slot *slot;
@@ -1623,6 +1720,14 @@ next_mm:
 					ksm_scan.rmap_list =
 							&rmap_item->rmap_list;
 					ksm_scan.address += PAGE_SIZE;
+					if (should_skip_rmap_item(*page,
+								  rmap_item)) {
+						put_page(*page);
+						cond_resched();
+						continue;
+					}
+					slot->nr_scanning++;
+					*slotp = slot;
 				} else
 					put_page(*page);
 				up_read(&mm->mmap_sem);
@@ -1634,7 +1739,12 @@ next_mm:
 		}
 	}
 
-	if (ksm_test_exit(mm)) {
+	/*
+	 * If another scan thread still has pages of this mm in flight,
+	 * its rmap_items must survive: defer the tidying up below to a
+	 * later visit, when the slot has quiesced.
+	 */
+	if (ksm_test_exit(mm) && !slot->nr_scanning) {
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
 	}
@@ -1642,12 +1752,13 @@ next_mm:
 	 * Nuke all the rmap_items that are above this current rmap:
 	 * because there were no VM_MERGEABLE vmas with such addresses.
 	 */
-	remove_trailing_rmap_items(slot, ksm_scan.rmap_list);
+	if (!slot->nr_scanning)
+		remove_trailing_rmap_items(slot, ksm_scan.rmap_list);
 
 	spin_lock(&ksm_mmlist_lock);
 	ksm_scan.mm_slot = list_entry(slot->mm_list.next,
 						struct mm_slot, mm_list);
-	if (ksm_scan.address == 0) {
+	if (ksm_scan.address == 0 && !slot->nr_scanning) {
 		/*
 		 * We've completed a full scan of all vmas, holding mmap_sem
 		 * throughout, and found no VM_MERGEABLE: so do the same as
@@ -1693,14 +1804,34 @@ next_mm:
 static void ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
+	struct mm_slot *uninitialized_var(slot);
 	struct page *uninitialized_var(page);
+	unsigned int checksum = 0;
+	bool have_checksum;
 
 	while (scan_npages-- && likely(!freezing(current))) {
 		cond_resched();
-		rmap_item = scan_get_next_rmap_item(&page);
+		mutex_lock(&ksm_scan_mutex);
+		rmap_item = scan_get_next_rmap_item(&page, &slot);
+		mutex_unlock(&ksm_scan_mutex);
 		if (!rmap_item)
 			return;
-		cmp_and_merge_page(page, rmap_item);
+
+		/*
+		 * Checksumming is the cpu-heavy part of the scan and needs
+		 * no KSM state: do it outside the mutex, so that multiple
+		 * scan threads can checksum concurrently.  Pages already
+		 * in the stable tree take the stable paths instead and
+		 * don't want a checksum at all.
+		 */
+		have_checksum = !PageKsm(page);
+		if (have_checksum)
+			checksum = calc_checksum(page);
+
+		mutex_lock(&ksm_scan_mutex);
+		cmp_and_merge_page(page, rmap_item, have_checksum, checksum);
+		slot->nr_scanning--;
+		mutex_unlock(&ksm_scan_mutex);
 		put_page(page);
 	}
 }
@@ -1716,11 +1847,11 @@ static int ksm_scan_thread(void *nothing)
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
-		mutex_lock(&ksm_thread_mutex);
-		wait_while_offlining();
+		down_read(&ksm_thread_sem);
+		scan_wait_while_offlining();
 		if (ksmd_should_run())
 			ksm_do_scan(ksm_thread_pages_to_scan);
-		mutex_unlock(&ksm_thread_mutex);
+		up_read(&ksm_thread_sem);
 
 		try_to_freeze();
 
@@ -1980,13 +2111,25 @@ void ksm_migrate_page(struct page *newpage, struct page *oldpage)
 #endif /* CONFIG_MIGRATION */
 
 #ifdef CONFIG_MEMORY_HOTREMOVE
+/* Caller holds ksm_thread_sem for write */
 static void wait_while_offlining(void)
 {
 	while (ksm_run & KSM_RUN_OFFLINE) {
-		mutex_unlock(&ksm_thread_mutex);
+		up_write(&ksm_thread_sem);
+		wait_on_bit(&ksm_run, ilog2(KSM_RUN_OFFLINE),
+			    TASK_UNINTERRUPTIBLE);
+		down_write(&ksm_thread_sem);
+	}
+}
+
+/* As above, but for the scan threads, which only hold it for read */
+static void scan_wait_while_offlining(void)
+{
+	while (ksm_run & KSM_RUN_OFFLINE) {
+		up_read(&ksm_thread_sem);
 		wait_on_bit(&ksm_run, ilog2(KSM_RUN_OFFLINE),
 			    TASK_UNINTERRUPTIBLE);
-		mutex_lock(&ksm_thread_mutex);
+		down_read(&ksm_thread_sem);
 	}
 }
 
@@ -2034,11 +2177,11 @@ static int ksm_memory_callback(struct notifier_block *self,
 		 * and remove_all_stable_nodes() while memory is going offline:
 		 * it is unsafe for them to touch the stable tree at this time.
 		 * But unmerge_ksm_pages(), rmap lookups and other entry points
-		 * which do not need the ksm_thread_mutex are all safe.
+		 * which do not need the ksm_thread_sem are all safe.
 		 */
-		mutex_lock(&ksm_thread_mutex);
+		down_write(&ksm_thread_sem);
 		ksm_run |= KSM_RUN_OFFLINE;
-		mutex_unlock(&ksm_thread_mutex);
+		up_write(&ksm_thread_sem);
 		break;
 
 	case MEM_OFFLINE:
@@ -2054,9 +2197,9 @@ static int ksm_memory_callback(struct notifier_block *self,
 		/* fallthrough */
 
 	case MEM_CANCEL_OFFLINE:
-		mutex_lock(&ksm_thread_mutex);
+		down_write(&ksm_thread_sem);
 		ksm_run &= ~KSM_RUN_OFFLINE;
-		mutex_unlock(&ksm_thread_mutex);
+		up_write(&ksm_thread_sem);
 
 		smp_mb();	/* wake_up_bit advises this */
 		wake_up_bit(&ksm_run, ilog2(KSM_RUN_OFFLINE));
@@ -2068,6 +2211,10 @@ static int ksm_memory_callback(struct notifier_block *self,
 static void wait_while_offlining(void)
 {
 }
+
+static void scan_wait_while_offlining(void)
+{
+}
 #endif /* CONFIG_MEMORY_HOTREMOVE */
 
 #ifdef CONFIG_SYSFS
@@ -2127,6 +2274,71 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t smart_scan_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_smart_scan);
+}
+
+static ssize_t smart_scan_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	int err;
+	unsigned long knob;
+
+	err = kstrtoul(buf, 10, &knob);
+	if (err || knob > 1)
+		return -EINVAL;
+
+	ksm_smart_scan = knob;
+
+	return count;
+}
+KSM_ATTR(smart_scan);
+
+static ssize_t scan_threads_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_nr_scan_threads);
+}
+
+static ssize_t scan_threads_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	unsigned long nthreads;
+	unsigned int i;
+	int err;
+
+	err = kstrtoul(buf, 10, &nthreads);
+	if (err || !nthreads || nthreads > KSM_MAX_SCAN_THREADS)
+		return -EINVAL;
+
+	err = 0;
+	mutex_lock(&ksm_scan_threads_lock);
+	for (i = ksm_nr_scan_threads; i < nthreads; i++) {
+		struct task_struct *task;
+
+		task = kthread_run(ksm_scan_thread, NULL, "ksmd/%u", i);
+		if (IS_ERR(task)) {
+			err = PTR_ERR(task);
+			break;
+		}
+		ksm_scan_tasks[i] = task;
+		ksm_nr_scan_threads = i + 1;
+	}
+	for (i = ksm_nr_scan_threads; i > nthreads; i--) {
+		kthread_stop(ksm_scan_tasks[i - 1]);
+		ksm_scan_tasks[i - 1] = NULL;
+		ksm_nr_scan_threads = i - 1;
+	}
+	mutex_unlock(&ksm_scan_threads_lock);
+
+	return err ? err : count;
+}
+KSM_ATTR(scan_threads);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -2152,7 +2364,7 @@ static ssize_t run_store(struct kobject *kobj, struct kobj_attribute *attr,
 	 * on the list for when ksmd may be set running again).
 	 */
 
-	mutex_lock(&ksm_thread_mutex);
+	down_write(&ksm_thread_sem);
 	wait_while_offlining();
 	if (ksm_run != flags) {
 		ksm_run = flags;
@@ -2166,7 +2378,7 @@ static ssize_t run_store(struct kobject *kobj, struct kobj_attribute *attr,
 			}
 		}
 	}
-	mutex_unlock(&ksm_thread_mutex);
+	up_write(&ksm_thread_sem);
 
 	if (flags & KSM_RUN_MERGE)
 		wake_up_interruptible(&ksm_thread_wait);
@@ -2195,7 +2407,7 @@ static ssize_t merge_across_nodes_store(struct kobject *kobj,
 	if (knob > 1)
 		return -EINVAL;
 
-	mutex_lock(&ksm_thread_mutex);
+	down_write(&ksm_thread_sem);
 	wait_while_offlining();
 	if (ksm_merge_across_nodes != knob) {
 		if (ksm_pages_shared || remove_all_stable_nodes())
@@ -2226,7 +2438,7 @@ static ssize_t merge_across_nodes_store(struct kobject *kobj,
 			ksm_nr_node_ids = knob ? 1 : nr_node_ids;
 		}
 	}
-	mutex_unlock(&ksm_thread_mutex);
+	up_write(&ksm_thread_sem);
 
 	return err ? err : count;
 }
@@ -2271,6 +2483,13 @@ static ssize_t pages_volatile_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_volatile);
 
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
 static ssize_t full_scans_show(struct kobject *kobj,
 			       struct kobj_attribute *attr, char *buf)
 {
@@ -2281,11 +2500,14 @@ KSM_ATTR_RO(full_scans);
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&smart_scan_attr.attr,
+	&scan_threads_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
+	&pages_skipped_attr.attr,
 	&full_scans_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
@@ -2314,6 +2536,7 @@ static int __init ksm_init(void)
 		err = PTR_ERR(ksm_thread);
 		goto out_free;
 	}
+	ksm_scan_tasks[0] = ksm_thread;
 
 #ifdef CONFIG_SYSFS
 	err = sysfs_create_group(mm_kobj, &ksm_attr_group);
@@ -1694,14 +1694,83 @@ struct memcg_stock_pcp {
 static DEFINE_PER_CPU(struct memcg_stock_pcp, memcg_stock);
 static DEFINE_MUTEX(percpu_charge_mutex);
 
+/*
+ * Check that the page counters of @child are linked up to those of its
+ * ancestor @parent.  The counters are only chained when use_hierarchy
+ * is set, while the css tree is always nested; never walk a partial
+ * path on unlinked counters.
+ */
+static bool stock_path_linked(struct mem_cgroup *child,
+			      struct mem_cgroup *parent)
+{
+	struct page_counter *c;
+
+	for (c = &child->memory; c; c = c->parent)
+		if (c == &parent->memory)
+			return true;
+	return false;
+}
+
+/*
+ * The stocked charge is held against stock->cached and, transitively,
+ * against all of its ancestors.  Serve a charge for another memcg on
+ * that ancestry path by fixing up only the counters between the two,
+ * which keeps the hot shared counters near the root out of the per-page
+ * picture even when tasks run several cgroup levels deep.
+ */
+static bool consume_path_stock(struct mem_cgroup *memcg,
+			       struct mem_cgroup *cached,
+			       unsigned int nr_pages)
+{
+	struct page_counter *counter;
+
+	if (mem_cgroup_is_descendant(memcg, cached)) {
+		if (!stock_path_linked(memcg, cached))
+			return false;
+		/* Charge the levels below @cached that the stock misses */
+		if (do_memsw_account()) {
+			if (!page_counter_try_charge_upto(&memcg->memsw,
+							  &cached->memsw,
+							  nr_pages, &counter))
+				return false;
+		}
+		if (!page_counter_try_charge_upto(&memcg->memory,
+						  &cached->memory,
+						  nr_pages, &counter)) {
+			if (do_memsw_account())
+				page_counter_uncharge_upto(&memcg->memsw,
+							   &cached->memsw,
+							   nr_pages);
+			return false;
+		}
+	} else if (mem_cgroup_is_descendant(cached, memcg)) {
+		if (!stock_path_linked(cached, memcg))
+			return false;
+		/* Drop the levels below @memcg that the stock covers */
+		page_counter_uncharge_upto(&cached->memory, &memcg->memory,
+					   nr_pages);
+		if (do_memsw_account())
+			page_counter_uncharge_upto(&cached->memsw,
+						   &memcg->memsw, nr_pages);
+	} else {
+		return false;
+	}
+
+	/* The page charge pins @memcg, the stock pinned @cached */
+	css_get_many(&memcg->css, nr_pages);
+	css_put_many(&cached->css, nr_pages);
+	return true;
+}
+
 /**
  * consume_stock: Try to consume stocked charge on this cpu.
  * @memcg: memcg to consume from.
  * @nr_pages: how many pages to charge.
  *
- * The charges will only happen if @memcg matches the current cpu's memcg
- * stock, and at least @nr_pages are available in that stock.  Failure to
- * service an allocation will refill the stock.
+ * The charges will only happen if @memcg shares an ancestry path with
+ * the current cpu's memcg stock, and at least @nr_pages are available
+ * in that stock.  Failure to service an allocation will refill the
+ * stock.
  *
  * returns true if successful, false otherwise.
  */
@@ -1717,9 +1786,14 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	local_irq_save(flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (memcg == stock->cached && stock->nr_pages >= nr_pages) {
-		stock->nr_pages -= nr_pages;
-		ret = true;
+	if (stock->nr_pages >= nr_pages) {
+		if (memcg == stock->cached)
+			ret = true;
+		else if (stock->cached)
+			ret = consume_path_stock(memcg, stock->cached,
+						 nr_pages);
+		if (ret)
+			stock->nr_pages -= nr_pages;
 	}
 
 	local_irq_restore(flags);
@@ -1776,6 +1850,10 @@ static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	}
 	stock->nr_pages += nr_pages;
 
+	/* Keep the lazily propagated error per cpu bounded */
+	if (stock->nr_pages > CHARGE_BATCH)
+		drain_stock(stock);
+
 	local_irq_restore(flags);
 }
 
@@ -2019,11 +2097,8 @@ static void cancel_charge(struct mem_cgroup *memcg, unsigned int nr_pages)
 	if (mem_cgroup_is_root(memcg))
 		return;
 
-	page_counter_uncharge(&memcg->memory, nr_pages);
-	if (do_memsw_account())
-		page_counter_uncharge(&memcg->memsw, nr_pages);
-
-	css_put_many(&memcg->css, nr_pages);
+	/* The stock inherits the css references held by the charge */
+	refill_stock(memcg, nr_pages);
 }
 
 static void lock_page_lru(struct page *page, int *isolated)
@@ -5157,6 +5232,45 @@ static ssize_t memory_max_write(struct kernfs_open_file *of,
 	return nbytes;
 }
 
+static ssize_t memory_reclaim(struct kernfs_open_file *of, char *buf,
+			      size_t nbytes, loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	unsigned int nr_retries = MEM_CGROUP_RECLAIM_RETRIES;
+	unsigned long nr_to_reclaim, nr_reclaimed = 0;
+	int err;
+
+	buf = strstrip(buf);
+	err = page_counter_memparse(buf, "", &nr_to_reclaim);
+	if (err)
+		return err;
+
+	while (nr_reclaimed < nr_to_reclaim) {
+		unsigned long reclaimed;
+
+		if (signal_pending(current))
+			return -EINTR;
+
+		/*
+		 * On the final attempt, drain the percpu lru caches in the
+		 * hope of turning stranded pages evictable.
+		 */
+		if (!nr_retries)
+			lru_add_drain_all();
+
+		reclaimed = try_to_free_mem_cgroup_pages(memcg,
+					nr_to_reclaim - nr_reclaimed,
+					GFP_KERNEL, true);
+
+		if (!reclaimed && !nr_retries--)
+			return -EAGAIN;
+
+		nr_reclaimed += reclaimed;
+	}
+
+	return nbytes;
+}
+
 static int memory_events_show(struct seq_file *m, void *v)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_css(seq_css(m));
@@ -5269,6 +5383,11 @@ static struct cftype memory_files[] = {
 		.flags = CFTYPE_NOT_ON_ROOT,
 		.seq_show = memory_stat_show,
 	},
+	{
+		.name = "reclaim",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.write = memory_reclaim,
+	},
 	{ }	/* terminate */
 };
 
@@ -5477,9 +5596,6 @@ static void uncharge_batch(struct mem_cgroup *memcg, unsigned long pgpgout,
 	unsigned long flags;
 
 	if (!mem_cgroup_is_root(memcg)) {
-		page_counter_uncharge(&memcg->memory, nr_pages);
-		if (do_memsw_account())
-			page_counter_uncharge(&memcg->memsw, nr_pages);
 		if (!cgroup_subsys_on_dfl(memory_cgrp_subsys) && nr_kmem)
 			page_counter_uncharge(&memcg->kmem, nr_kmem);
 		memcg_oom_recover(memcg);
@@ -5494,8 +5610,15 @@ static void uncharge_batch(struct mem_cgroup *memcg, unsigned long pgpgout,
 	memcg_check_events(memcg, dummy_page);
 	local_irq_restore(flags);
 
-	if (!mem_cgroup_is_root(memcg))
-		css_put_many(&memcg->css, nr_pages);
+	/*
+	 * Return the pages to the per-cpu stock instead of walking the
+	 * counter hierarchy; the next charge on this cpu picks them up
+	 * without any atomics on the shared counters.  The stock inherits
+	 * the css references, so this must come last - draining it may
+	 * put the final references to @memcg.
+	 */
+	if (!mem_cgroup_is_root(memcg) && nr_pages)
+		refill_stock(memcg, nr_pages);
 }
 
 static void uncharge_list(struct list_head *page_list)
@@ -5747,8 +5870,7 @@ void mem_cgroup_uncharge_skmem(struct mem_cgroup *memcg, unsigned int nr_pages)
 
 	this_cpu_sub(memcg->stat->count[MEMCG_SOCK], nr_pages);
 
-	page_counter_uncharge(&memcg->memory, nr_pages);
-	css_put_many(&memcg->css, nr_pages);
+	refill_stock(memcg, nr_pages);
 }
 
 static int __init cgroup_memory(char *s)
@@ -64,6 +64,7 @@
 #include <linux/debugfs.h>
 #include <linux/userfaultfd_k.h>
 #include <linux/dax.h>
+#include <linux/mempolicy.h>
 
 #include <asm/io.h>
 #include <asm/mmu_context.h>
@@ -847,6 +848,33 @@ out:
  * covered by this vma.
  */
 
+/*
+ * A clean pte of a private file mapping is just a read-only view of the
+ * page cache and can be refaulted at will. Skipping those at fork makes
+ * the copy proportional to the pages the parent actually wrote (which
+ * have become anon COW pages) rather than to everything mapped - the
+ * per-vma check in copy_page_range() does the same wholesale for vmas
+ * that were never written to at all.
+ */
+static inline bool
+fork_can_skip_pte(struct vm_area_struct *vma, unsigned long addr, pte_t pte)
+{
+	struct page *page;
+
+	if (!vma->vm_file || !is_cow_mapping(vma->vm_flags))
+		return false;
+
+	/* the child must observe the missing page, not a fresh fault */
+	if (userfaultfd_armed(vma))
+		return false;
+
+	if (pte_dirty(pte))
+		return false;
+
+	page = vm_normal_page(vma, addr, pte);
+	return page && !PageAnon(page);
+}
+
 static inline unsigned long
 copy_one_pte(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		pte_t *dst_pte, pte_t *src_pte, struct vm_area_struct *vma,
@@ -962,6 +990,11 @@ again:
 			progress++;
 			continue;
 		}
+		if (pte_present(*src_pte) &&
+		    fork_can_skip_pte(vma, addr, *src_pte)) {
+			progress++;
+			continue;
+		}
 		entry.val = copy_one_pte(dst_mm, src_mm, dst_pte, src_pte,
 							vma, addr, rss);
 		if (entry.val)
@@ -3156,6 +3189,43 @@ static int __init fault_around_debugfs(void)
 late_initcall(fault_around_debugfs);
 #endif
 
+/**
+ * mm_init_fault_around - seed the per-mm fault-around state
+ * @mm: new mm being set up
+ *
+ * Every mm starts with the globally configured window and adapts it from
+ * there, see fault_around_adapt().
+ */
+void mm_init_fault_around(struct mm_struct *mm)
+{
+	mm->fault_around_bytes = READ_ONCE(fault_around_bytes);
+	mm->fault_around_hits = 0;
+	mm->fault_around_misses = 0;
+}
+
+/*
+ * Multiplicative adaptation of the per-mm fault-around window: a fault that
+ * do_fault_around() resolved doubles the window, a fault that fell through
+ * to a single-page ->fault() halves it.  Mappings with good locality regrow
+ * to the configured fault_around_bytes cap, while sparsely touched or cold
+ * ones decay so they stop paying for useless pte scans.  The floor is two
+ * pages rather than one so a narrowed mm keeps probing and can widen again.
+ */
+static void fault_around_adapt(struct mm_struct *mm, bool resolved)
+{
+	unsigned long window = READ_ONCE(mm->fault_around_bytes);
+
+	if (resolved) {
+		mm->fault_around_hits++;
+		window <<= 1;
+	} else {
+		mm->fault_around_misses++;
+		window = max(window >> 1, 2UL * PAGE_SIZE);
+	}
+	window = min(window, READ_ONCE(fault_around_bytes));
+	WRITE_ONCE(mm->fault_around_bytes, window);
+}
+
 /*
  * do_fault_around() tries to map few pages around the fault address. The hope
  * is that the pages will be needed soon and this will lower the number of
@@ -3186,7 +3256,8 @@ static int do_fault_around(struct vm_fault *vmf)
 	pgoff_t end_pgoff;
 	int off, ret = 0;
 
-	nr_pages = READ_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+	nr_pages = min(READ_ONCE(vmf->vma->vm_mm->fault_around_bytes),
+		       READ_ONCE(fault_around_bytes)) >> PAGE_SHIFT;
 	mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
 
 	vmf->address = max(address & mask, vmf->vma->vm_start);
@@ -3246,6 +3317,7 @@ static int do_read_fault(struct vm_fault *vmf)
 	 */
 	if (vma->vm_ops->map_pages && fault_around_bytes >> PAGE_SHIFT > 1) {
 		ret = do_fault_around(vmf);
+		fault_around_adapt(vma->vm_mm, ret != 0);
 		if (ret)
 			return ret;
 	}
@@ -3717,6 +3789,184 @@ int handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 }
 EXPORT_SYMBOL_GPL(handle_mm_fault);
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+/*
+ * handle_speculative_fault - try to service a fault without mmap_sem
+ *
+ * Handles the common case of a first touch write fault on anonymous
+ * memory. The vma is looked up under mm_rb_lock and its parameters
+ * checked there; the new page is then installed under the pte lock only
+ * if mm->mm_seq has not moved since the lookup, which proves that no
+ * mmap, munmap, mprotect or similar ran in between.
+ *
+ * The page table walk runs with interrupts disabled, which blocks the
+ * TLB shootdown IPI that x86 requires before page table pages can be
+ * freed (the same trick gup_fast uses), and the pte lock is only
+ * trylocked because the holder of a pte lock may be waiting for our
+ * IPI acknowledgement.
+ *
+ * Returns VM_FAULT_RETRY whenever the fault could not be handled
+ * speculatively and must go through the regular path.
+ */
+int handle_speculative_fault(struct mm_struct *mm, unsigned long address,
+			     unsigned int flags)
+{
+	struct vm_area_struct *vma;
+	struct mem_cgroup *memcg;
+	struct rb_node *rb_node;
+	struct page *page;
+	spinlock_t *ptl;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd, pmdval;
+	pte_t *pte, entry;
+	unsigned int seq;
+
+	/* Only user write faults are handled speculatively */
+	if (!(flags & FAULT_FLAG_USER) || !(flags & FAULT_FLAG_WRITE) ||
+	    (flags & FAULT_FLAG_REMOTE))
+		return VM_FAULT_RETRY;
+
+#ifdef CONFIG_NUMA
+	/*
+	 * The speculative allocation below cannot honour a task or vma
+	 * mempolicy without risking a use after free on the policy.
+	 */
+	if (current->mempolicy)
+		return VM_FAULT_RETRY;
+#endif
+
+	seq = raw_read_seqcount(&mm->mm_seq);
+	if (seq & 1)
+		return VM_FAULT_RETRY;
+
+	rcu_read_lock();
+	read_lock(&mm->mm_rb_lock);
+
+	vma = NULL;
+	rb_node = mm->mm_rb.rb_node;
+	while (rb_node) {
+		struct vm_area_struct *tmp;
+
+		tmp = rb_entry(rb_node, struct vm_area_struct, vm_rb);
+		if (tmp->vm_end > address) {
+			vma = tmp;
+			if (tmp->vm_start <= address)
+				break;
+			rb_node = rb_node->rb_left;
+		} else
+			rb_node = rb_node->rb_right;
+	}
+
+	/*
+	 * Restrict ourselves to private anonymous vmas whose fault path
+	 * depends on nothing but the vma itself: no vm_ops, no stack
+	 * growth, no userfaultfd and no special mappings. Everything we
+	 * need from the vma is read while the rbtree lock pins it.
+	 */
+	if (!vma || address < vma->vm_start)
+		goto out_rb;
+	if (vma->vm_ops || vma->vm_file)
+		goto out_rb;
+	if (vma->vm_flags & (VM_SHARED | VM_GROWSDOWN | VM_GROWSUP |
+			     VM_HUGETLB | VM_PFNMAP | VM_MIXEDMAP |
+			     VM_UFFD_MISSING))
+		goto out_rb;
+	if (!(vma->vm_flags & VM_WRITE))
+		goto out_rb;
+	/* anon_vma_prepare() needs mmap_sem */
+	if (!vma->anon_vma)
+		goto out_rb;
+	if (vma_policy(vma))
+		goto out_rb;
+
+	read_unlock(&mm->mm_rb_lock);
+
+	/*
+	 * From here on the vma may be modified or freed concurrently;
+	 * the rcu read section keeps its memory vma typed and the
+	 * sequence recheck under the pte lock rejects any change before
+	 * state derived from the vma becomes visible.
+	 */
+	page = alloc_page(GFP_HIGHUSER_MOVABLE | __GFP_ZERO);
+	if (!page)
+		goto out_rcu;
+	if (mem_cgroup_try_charge(page, mm, GFP_KERNEL, &memcg, false)) {
+		put_page(page);
+		goto out_rcu;
+	}
+	__SetPageUptodate(page);
+
+	local_irq_disable();
+	if (read_seqcount_retry(&mm->mm_seq, seq))
+		goto out_uncharge_irq;
+
+	pgd = pgd_offset(mm, address);
+	if (!pgd_present(*pgd))
+		goto out_uncharge_irq;
+	pud = pud_offset(pgd, address);
+	if (!pud_present(*pud))
+		goto out_uncharge_irq;
+	pmd = pmd_offset(pud, address);
+	pmdval = READ_ONCE(*pmd);
+	/* Allocating page tables needs the slow path */
+	if (!pmd_present(pmdval) || pmd_trans_huge(pmdval) ||
+	    pmd_devmap(pmdval) || unlikely(pmd_bad(pmdval)))
+		goto out_uncharge_irq;
+
+	pte = pte_offset_map(pmd, address);
+	ptl = pte_lockptr(mm, pmd);
+	if (!spin_trylock(ptl)) {
+		pte_unmap(pte);
+		goto out_uncharge_irq;
+	}
+
+	if (read_seqcount_retry(&mm->mm_seq, seq))
+		goto out_unlock;
+	if (!pte_none(*pte))
+		goto out_unlock;
+
+	/*
+	 * The sequence count is unchanged, so the vma and its anon_vma
+	 * are exactly as they were at lookup time and cannot go away
+	 * before the pte lock is dropped.
+	 */
+	inc_mm_counter_fast(mm, MM_ANONPAGES);
+	page_add_new_anon_rmap(page, vma, address, false);
+	mem_cgroup_commit_charge(page, memcg, false, false);
+	lru_cache_add_active_or_unevictable(page, vma);
+
+	entry = mk_pte(page, vma->vm_page_prot);
+	entry = pte_mkwrite(pte_mkdirty(entry));
+	set_pte_at(mm, address, pte, entry);
+	update_mmu_cache(vma, address, pte);
+
+	spin_unlock(ptl);
+	pte_unmap(pte);
+	local_irq_enable();
+	rcu_read_unlock();
+
+	count_vm_event(SPECULATIVE_PGFAULT);
+	return 0;
+
+out_unlock:
+	spin_unlock(ptl);
+	pte_unmap(pte);
+out_uncharge_irq:
+	local_irq_enable();
+	mem_cgroup_cancel_charge(page, memcg, false);
+	put_page(page);
+out_rcu:
+	rcu_read_unlock();
+	return VM_FAULT_RETRY;
+
+out_rb:
+	read_unlock(&mm->mm_rb_lock);
+	rcu_read_unlock();
+	return VM_FAULT_RETRY;
+}
+#endif /* CONFIG_SPECULATIVE_PAGE_FAULT */
+
 #ifndef __PAGETABLE_PUD_FOLDED
 /*
  * Allocate page upper directory.
@@ -11,6 +11,7 @@
 
 #include <linux/mm.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
 #include <linux/highmem.h>
 #include <linux/kasan.h>
 #include <linux/kmemleak.h>
@@ -118,6 +119,23 @@ static void kasan_unpoison_element(mempool_t *pool, void *element, gfp_t flags)
 		kasan_alloc_pages(element, (unsigned long)pool->pool_data);
 }
 
+/*
+ * Small per-cpu cache of surplus elements.  It only ever holds elements
+ * which would otherwise have been handed back to the underlying
+ * allocator, so the min_nr guarantee of the shared reserve is never
+ * weakened: a free refills the reserve first and only surplus beyond
+ * min_nr is parked here.  Elements freed on a cpu were typically
+ * allocated node-local, so reusing them on the same cpu keeps the
+ * refill node-local as well, without a lock in the fast path.
+ */
+#define MEMPOOL_CACHE_SIZE	4
+
+struct mempool_cache {
+	void *elements[MEMPOOL_CACHE_SIZE];
+	int nr;
+	unsigned long cached_allocs;
+};
+
 static void add_element(mempool_t *pool, void *element)
 {
 	BUG_ON(pool->curr_nr >= pool->min_nr);
@@ -149,6 +167,19 @@ void mempool_destroy(mempool_t *pool)
 	if (unlikely(!pool))
 		return;
 
+	if (pool->cache) {
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			struct mempool_cache *cache =
+				per_cpu_ptr(pool->cache, cpu);
+
+			while (cache->nr)
+				pool->free(cache->elements[--cache->nr],
+					   pool->pool_data);
+		}
+		free_percpu(pool->cache);
+	}
 	while (pool->curr_nr) {
 		void *element = remove_element(pool, GFP_KERNEL);
 		pool->free(element, pool->pool_data);
@@ -194,8 +225,15 @@ mempool_t *mempool_create_node(int min_nr, mempool_alloc_t *alloc_fn,
 		kfree(pool);
 		return NULL;
 	}
+	pool->cache = alloc_percpu_gfp(struct mempool_cache, gfp_mask);
+	if (!pool->cache) {
+		kfree(pool->elements);
+		kfree(pool);
+		return NULL;
+	}
 	spin_lock_init(&pool->lock);
 	pool->min_nr = min_nr;
+	pool->min_seen = min_nr;
 	pool->pool_data = pool_data;
 	init_waitqueue_head(&pool->wait);
 	pool->alloc = alloc_fn;
@@ -310,6 +348,7 @@ EXPORT_SYMBOL(mempool_resize);
  */
 void *mempool_alloc(mempool_t *pool, gfp_t gfp_mask)
 {
+	struct mempool_cache *cache;
 	void *element;
 	unsigned long flags;
 	wait_queue_t wait;
@@ -324,6 +363,23 @@ void *mempool_alloc(mempool_t *pool, gfp_t gfp_mask)
 
 	gfp_temp = gfp_mask & ~(__GFP_DIRECT_RECLAIM|__GFP_IO);
 
+	/*
+	 * Surplus elements freed on this cpu are the cheapest and most
+	 * node-local source, and taking one does not touch pool->lock
+	 * or the shared reserve.
+	 */
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pool->cache);
+	if (cache->nr) {
+		element = cache->elements[--cache->nr];
+		cache->cached_allocs++;
+		local_irq_restore(flags);
+		kasan_unpoison_element(pool, element, gfp_temp);
+		check_element(pool, element);
+		return element;
+	}
+	local_irq_restore(flags);
+
 repeat_alloc:
 
 	element = pool->alloc(gfp_temp, pool->pool_data);
@@ -333,6 +389,9 @@ repeat_alloc:
 	spin_lock_irqsave(&pool->lock, flags);
 	if (likely(pool->curr_nr)) {
 		element = remove_element(pool, gfp_temp);
+		pool->reserve_allocs++;
+		if (pool->curr_nr < pool->min_seen)
+			pool->min_seen = pool->curr_nr;
 		spin_unlock_irqrestore(&pool->lock, flags);
 		/* paired with rmb in mempool_free(), read comment there */
 		smp_wmb();
@@ -361,6 +420,7 @@ repeat_alloc:
 	}
 
 	/* Let's wait for someone else to return an element to @pool */
+	pool->waits++;
 	init_wait(&wait);
 	prepare_to_wait(&pool->wait, &wait, TASK_UNINTERRUPTIBLE);
 
@@ -387,6 +447,7 @@ EXPORT_SYMBOL(mempool_alloc);
  */
 void mempool_free(void *element, mempool_t *pool)
 {
+	struct mempool_cache *cache;
 	unsigned long flags;
 
 	if (unlikely(element == NULL))
@@ -435,10 +496,56 @@ void mempool_free(void *element, mempool_t *pool)
 		}
 		spin_unlock_irqrestore(&pool->lock, flags);
 	}
+
+	/*
+	 * The reserve is full, so this element is surplus.  Park it in
+	 * the per-cpu cache for cheap node-local reuse instead of
+	 * returning it to the underlying allocator.
+	 */
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pool->cache);
+	if (cache->nr < MEMPOOL_CACHE_SIZE) {
+		poison_element(pool, element);
+		kasan_poison_element(pool, element);
+		cache->elements[cache->nr++] = element;
+		local_irq_restore(flags);
+		return;
+	}
+	local_irq_restore(flags);
+
 	pool->free(element, pool->pool_data);
 }
 EXPORT_SYMBOL(mempool_free);
 
+/**
+ * mempool_read_stats - read the occupancy statistics of a memory pool
+ * @pool:	pointer to the memory pool which was allocated via
+ *		mempool_create().
+ * @stats:	filled in with a consistent snapshot of the counters.
+ *
+ * The low watermark and the reserve/wait counters tell how close the
+ * pool has come to exhaustion, so min_nr can be sized from observed
+ * pressure rather than folklore.
+ */
+void mempool_read_stats(mempool_t *pool, struct mempool_stats *stats)
+{
+	unsigned long flags;
+	int cpu;
+
+	stats->cached_allocs = 0;
+	for_each_possible_cpu(cpu)
+		stats->cached_allocs +=
+			per_cpu_ptr(pool->cache, cpu)->cached_allocs;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	stats->curr_nr = pool->curr_nr;
+	stats->min_seen = pool->min_seen;
+	stats->reserve_allocs = pool->reserve_allocs;
+	stats->waits = pool->waits;
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+EXPORT_SYMBOL(mempool_read_stats);
+
 /*
  * A commonly used alloc and free fn.
  */
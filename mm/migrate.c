@@ -38,6 +38,7 @@
 #include <linux/gfp.h>
 #include <linux/balloon_compaction.h>
 #include <linux/mmu_notifier.h>
+#include <linux/mmu_context.h>
 #include <linux/page_idle.h>
 #include <linux/page_owner.h>
 
@@ -1575,6 +1576,8 @@ static int do_pages_move(struct mm_struct *mm, nodemask_t task_nodes,
 				err = -EFAULT;
 				goto out_pm;
 			}
+
+		cond_resched();
 	}
 	err = 0;
 
@@ -1656,6 +1659,91 @@ static int do_pages_stat(struct mm_struct *mm, unsigned long nr_pages,
 	return nr_pages ? -EFAULT : 0;
 }
 
+/*
+ * A move_pages(MPOL_MF_MOVE_ASYNC) request, executed from a workqueue.
+ * The caller's status array is primed with -EINPROGRESS at submit time
+ * and the worker overwrites each slot with its final value as the
+ * chunks complete, so the submitting daemon polls for completion
+ * instead of blocking on the migration itself.
+ */
+struct move_pages_work {
+	struct work_struct work;
+	struct mm_struct *mm;		/* address space being migrated */
+	struct mm_struct *caller_mm;	/* owns the pages/nodes/status arrays */
+	nodemask_t task_nodes;
+	unsigned long nr_pages;
+	const void __user * __user *pages;
+	const int __user *nodes;
+	int __user *status;
+	int flags;
+};
+
+static void move_pages_workfn(struct work_struct *work)
+{
+	struct move_pages_work *mw = container_of(work, typeof(*mw), work);
+	int err;
+
+	use_mm(mw->caller_mm);
+	err = do_pages_move(mw->mm, mw->task_nodes, mw->nr_pages, mw->pages,
+			    mw->nodes, mw->status, mw->flags);
+	if (err < 0) {
+		unsigned long i;
+		int st;
+
+		/*
+		 * Resolve the slots the aborted run never reached, so
+		 * pollers are not left waiting on -EINPROGRESS forever.
+		 */
+		for (i = 0; i < mw->nr_pages; i++) {
+			if (get_user(st, mw->status + i))
+				break;
+			if (st != -EINPROGRESS)
+				continue;
+			if (put_user(err, mw->status + i))
+				break;
+		}
+	}
+	unuse_mm(mw->caller_mm);
+
+	mmput(mw->caller_mm);
+	mmput(mw->mm);
+	kfree(mw);
+}
+
+static int move_pages_async(struct mm_struct *mm, nodemask_t task_nodes,
+			    unsigned long nr_pages,
+			    const void __user * __user *pages,
+			    const int __user *nodes,
+			    int __user *status, int flags)
+{
+	struct move_pages_work *mw;
+	unsigned long i;
+
+	/* prime the slots the caller will poll */
+	for (i = 0; i < nr_pages; i++) {
+		if (put_user(-EINPROGRESS, status + i))
+			return -EFAULT;
+	}
+
+	mw = kmalloc(sizeof(*mw), GFP_KERNEL);
+	if (!mw)
+		return -ENOMEM;
+
+	INIT_WORK(&mw->work, move_pages_workfn);
+	atomic_inc(&mm->mm_users);
+	mw->mm = mm;
+	atomic_inc(&current->mm->mm_users);
+	mw->caller_mm = current->mm;
+	mw->task_nodes = task_nodes;
+	mw->nr_pages = nr_pages;
+	mw->pages = pages;
+	mw->nodes = nodes;
+	mw->status = status;
+	mw->flags = flags & ~MPOL_MF_MOVE_ASYNC;
+	queue_work(system_unbound_wq, &mw->work);
+	return 0;
+}
+
 /*
  * Move a list of pages in the address space of the currently executing
  * process.
@@ -1672,7 +1760,11 @@ SYSCALL_DEFINE6(move_pages, pid_t, pid, unsigned long, nr_pages,
 	nodemask_t task_nodes;
 
 	/* Check flags */
-	if (flags & ~(MPOL_MF_MOVE|MPOL_MF_MOVE_ALL))
+	if (flags & ~(MPOL_MF_MOVE|MPOL_MF_MOVE_ALL|MPOL_MF_MOVE_ASYNC))
+		return -EINVAL;
+
+	/* there is no deferred form of the node lookup */
+	if ((flags & MPOL_MF_MOVE_ASYNC) && !nodes)
 		return -EINVAL;
 
 	if ((flags & MPOL_MF_MOVE_ALL) && !capable(CAP_SYS_NICE))
@@ -1714,11 +1806,14 @@ SYSCALL_DEFINE6(move_pages, pid_t, pid, unsigned long, nr_pages,
 	if (!mm)
 		return -EINVAL;
 
-	if (nodes)
+	if (!nodes)
+		err = do_pages_stat(mm, nr_pages, pages, status);
+	else if (flags & MPOL_MF_MOVE_ASYNC)
+		err = move_pages_async(mm, task_nodes, nr_pages, pages,
+				       nodes, status, flags);
+	else
 		err = do_pages_move(mm, task_nodes, nr_pages, pages,
 				    nodes, status, flags);
-	else
-		err = do_pages_stat(mm, nr_pages, pages, status);
 
 	mmput(mm);
 	return err;
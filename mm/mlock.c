@@ -21,6 +21,9 @@
 #include <linux/hugetlb.h>
 #include <linux/memcontrol.h>
 #include <linux/mm_inline.h>
+#include <linux/mmu_context.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "internal.h"
 
@@ -437,7 +440,14 @@ static unsigned long __munlock_pagevec_fill(struct pagevec *pvec,
 void munlock_vma_pages_range(struct vm_area_struct *vma,
 			     unsigned long start, unsigned long end)
 {
+	/*
+	 * Speculative faults snapshot vm_flags; without a seqcount bump
+	 * they could act on VM_LOCKED after it is cleared here and mark
+	 * freshly faulted pages mlocked on an unlocked vma.
+	 */
+	mm_write_seqbegin(vma->vm_mm);
 	vma->vm_flags &= VM_LOCKED_CLEAR_MASK;
+	mm_write_seqend(vma->vm_mm);
 
 	while (start < end) {
 		struct page *page;
@@ -563,9 +573,11 @@ success:
 	 * set VM_LOCKED, populate_vma_page_range will bring it back.
 	 */
 
-	if (lock)
+	if (lock) {
+		mm_write_seqbegin(vma->vm_mm);
 		vma->vm_flags = newflags;
-	else
+		mm_write_seqend(vma->vm_mm);
+	} else
 		munlock_vma_pages_range(vma, start, end);
 
 out:
@@ -661,7 +673,66 @@ static int count_mm_mlocked_page_nr(struct mm_struct *mm,
 	return count >> PAGE_SHIFT;
 }
 
-static __must_check int do_mlock(unsigned long start, size_t len, vm_flags_t flags)
+/*
+ * Asynchronous population for MLOCK_ASYNC.
+ *
+ * The VMAs are already marked VM_LOCKED by the time the work is queued,
+ * so the syscall can return and a worker faults the pages in behind it.
+ * populate_vma_page_range() rechecks the vma flags, so a munlock() that
+ * beats the worker just turns the remaining work into plain faulting.
+ * The number of pages still queued is exported as VmLckPending in
+ * /proc/<pid>/status, which is how userspace can tell that population
+ * has finished.
+ */
+struct mlock_populate_work {
+	struct work_struct work;
+	struct mm_struct *mm;
+	unsigned long start;
+	size_t len;
+};
+
+static void mlock_populate_workfn(struct work_struct *work)
+{
+	struct mlock_populate_work *mpw = container_of(work,
+					struct mlock_populate_work, work);
+	struct mm_struct *mm = mpw->mm;
+
+	use_mm(mm);
+	/*
+	 * Errors are dropped like for MAP_POPULATE: the caller is long
+	 * gone and the pages fault in as usual, just without prefault.
+	 */
+	__mm_populate(mpw->start, mpw->len, 1);
+	unuse_mm(mm);
+
+	atomic_long_sub(mpw->len >> PAGE_SHIFT, &mm->mlock_pending);
+	mmput(mm);
+	kfree(mpw);
+}
+
+static int mlock_populate_async(unsigned long start, size_t len)
+{
+	struct mlock_populate_work *mpw;
+
+	mpw = kmalloc(sizeof(*mpw), GFP_KERNEL);
+	if (!mpw)
+		return -ENOMEM;
+
+	INIT_WORK(&mpw->work, mlock_populate_workfn);
+	mpw->mm = current->mm;
+	mpw->start = start;
+	mpw->len = len;
+
+	/* Keep the address space alive until the worker is done */
+	atomic_inc(&current->mm->mm_users);
+	atomic_long_add(len >> PAGE_SHIFT, &current->mm->mlock_pending);
+	queue_work(system_unbound_wq, &mpw->work);
+
+	return 0;
+}
+
+static __must_check int do_mlock(unsigned long start, size_t len,
+				 vm_flags_t flags, bool async)
 {
 	unsigned long locked;
 	unsigned long lock_limit;
@@ -702,6 +773,13 @@ static __must_check int do_mlock(unsigned long start, size_t len, vm_flags_t fla
 	if (error)
 		return error;
 
+	/*
+	 * Fall back to synchronous population if the work could not be
+	 * queued; the locking itself has already succeeded either way.
+	 */
+	if (async && !mlock_populate_async(start, len))
+		return 0;
+
 	error = __mm_populate(start, len, 0);
 	if (error)
 		return __mlock_posix_error_return(error);
@@ -710,20 +788,24 @@ static __must_check int do_mlock(unsigned long start, size_t len, vm_flags_t fla
 
 SYSCALL_DEFINE2(mlock, unsigned long, start, size_t, len)
 {
-	return do_mlock(start, len, VM_LOCKED);
+	return do_mlock(start, len, VM_LOCKED, false);
 }
 
 SYSCALL_DEFINE3(mlock2, unsigned long, start, size_t, len, int, flags)
 {
 	vm_flags_t vm_flags = VM_LOCKED;
 
-	if (flags & ~MLOCK_ONFAULT)
+	if (flags & ~(MLOCK_ONFAULT | MLOCK_ASYNC))
+		return -EINVAL;
+
+	/* MLOCK_ONFAULT does not populate, there is nothing to defer */
+	if ((flags & MLOCK_ONFAULT) && (flags & MLOCK_ASYNC))
 		return -EINVAL;
 
 	if (flags & MLOCK_ONFAULT)
 		vm_flags |= VM_LOCKONFAULT;
 
-	return do_mlock(start, len, vm_flags);
+	return do_mlock(start, len, vm_flags, flags & MLOCK_ASYNC);
 }
 
 SYSCALL_DEFINE2(munlock, unsigned long, start, size_t, len)
@@ -393,23 +393,59 @@ static void vma_gap_update(struct vm_area_struct *vma)
 	vma_gap_callbacks_propagate(&vma->vm_rb, NULL);
 }
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+/*
+ * Speculative faults walk mm_rb without mmap_sem; writers serialize
+ * against them through mm_rb_lock while rebalancing the tree.
+ */
+static inline void mm_rb_write_lock(struct mm_struct *mm)
+{
+	write_lock(&mm->mm_rb_lock);
+}
+
+static inline void mm_rb_write_unlock(struct mm_struct *mm)
+{
+	write_unlock(&mm->mm_rb_lock);
+}
+#else
+static inline void mm_rb_write_lock(struct mm_struct *mm)
+{
+}
+
+static inline void mm_rb_write_unlock(struct mm_struct *mm)
+{
+}
+#endif
+
+static void vma_fences_erase(struct mm_struct *mm, struct vm_area_struct *vma);
+static void vma_fences_churn(struct mm_struct *mm);
+
 static inline void vma_rb_insert(struct vm_area_struct *vma,
 				 struct rb_root *root)
 {
 	/* All rb_subtree_gap values must be consistent prior to insertion */
 	validate_mm_rb(root, NULL);
 
+	mm_rb_write_lock(vma->vm_mm);
 	rb_insert_augmented(&vma->vm_rb, root, &vma_gap_callbacks);
+	mm_rb_write_unlock(vma->vm_mm);
 }
 
 static void __vma_rb_erase(struct vm_area_struct *vma, struct rb_root *root)
 {
+	/* The vma is still on the ordered list at this point. */
+	vma_fences_erase(vma->vm_mm, vma);
+
 	/*
 	 * Note rb_erase_augmented is a fairly large inline function,
 	 * so make sure we instantiate it only once with our desired
 	 * augmented rbtree callbacks.
 	 */
+	mm_rb_write_lock(vma->vm_mm);
 	rb_erase_augmented(&vma->vm_rb, root, &vma_gap_callbacks);
+	mm_rb_write_unlock(vma->vm_mm);
+
+	vma_fences_churn(vma->vm_mm);
 }
 
 static __always_inline void vma_rb_erase_ignore(struct vm_area_struct *vma,
@@ -438,6 +474,123 @@ static __always_inline void vma_rb_erase(struct vm_area_struct *vma,
 	__vma_rb_erase(vma, root);
 }
 
+/*
+ * Fence-pointer index over the VMA list.
+ *
+ * For address spaces with tens of thousands of mappings the pointer
+ * chasing of an rbtree walk dominates find_vma().  Once an mm grows past
+ * VMA_FENCE_MIN_VMAS we keep a small sorted array of pointers to every
+ * Nth vma ("fences"), so a lookup is a binary search over a few
+ * cachelines plus a short walk of the ordered vma list.
+ *
+ * The index is maintained under mmap_sem held for write, the same
+ * context that modifies the rbtree, so find_vma() callers (who hold
+ * mmap_sem at least for read) can use it without further locking.
+ * Inserts between two fences merely lengthen the walk; erases patch any
+ * fence pointing at the victim.  The array is rebuilt wholesale when
+ * enough churn has accumulated.
+ */
+#define VMA_FENCE_STRIDE	64
+#define VMA_FENCE_MIN_VMAS	256
+#define VMA_FENCE_MAX		1024
+
+static void vma_fences_rebuild(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	unsigned int nr, stride, i, n;
+
+	kvfree(mm->vma_fences);
+	mm->vma_fences = NULL;
+	mm->nr_fences = 0;
+	mm->fence_mods = 0;
+
+	if (mm->map_count < VMA_FENCE_MIN_VMAS)
+		return;
+
+	nr = min_t(unsigned int, VMA_FENCE_MAX,
+		   mm->map_count / VMA_FENCE_STRIDE);
+	stride = DIV_ROUND_UP(mm->map_count, nr);
+
+	/*
+	 * We may be under i_mmap_rwsem here, so don't let the allocation
+	 * recurse into reclaim; just stay on the rbtree until the next
+	 * rebuild if memory is tight.
+	 */
+	mm->vma_fences = kmalloc_array(nr, sizeof(struct vm_area_struct *),
+				       GFP_NOWAIT | __GFP_NOWARN);
+	if (!mm->vma_fences)
+		return;
+
+	i = n = 0;
+	for (vma = mm->mmap; vma && n < nr; vma = vma->vm_next) {
+		if (i++ % stride == 0)
+			mm->vma_fences[n++] = vma;
+	}
+	mm->nr_fences = n;
+}
+
+static void vma_fences_churn(struct mm_struct *mm)
+{
+	if (++mm->fence_mods > 4 * VMA_FENCE_STRIDE + mm->map_count / 64)
+		vma_fences_rebuild(mm);
+}
+
+/*
+ * Called while @vma is still linked in the ordered list; redirect any
+ * fence pointing at it before it goes away.  Duplicate fences are fine,
+ * they only make the binary search a touch less selective.
+ */
+static void vma_fences_erase(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	unsigned int lo = 0, hi = mm->nr_fences, i;
+
+	if (!hi)
+		return;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (mm->vma_fences[mid]->vm_start < vma->vm_start)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = lo; i < mm->nr_fences &&
+		     mm->vma_fences[i]->vm_start == vma->vm_start; i++) {
+		if (mm->vma_fences[i] != vma)
+			continue;
+		if (vma->vm_next)
+			mm->vma_fences[i] = vma->vm_next;
+		else if (vma->vm_prev)
+			mm->vma_fences[i] = vma->vm_prev;
+		else
+			mm->nr_fences = 0;
+	}
+}
+
+static struct vm_area_struct *vma_fences_lookup(struct mm_struct *mm,
+						unsigned long addr)
+{
+	struct vm_area_struct *vma;
+	unsigned int lo = 0, hi = mm->nr_fences;
+
+	/* Find the last fence whose vma starts at or below @addr. */
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (mm->vma_fences[mid]->vm_start <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	vma = lo ? mm->vma_fences[lo - 1] : mm->mmap;
+	while (vma && vma->vm_end <= addr)
+		vma = vma->vm_next;
+	return vma;
+}
+
 /*
  * vma has some anon_vma assigned, and is already inserted on that
  * anon_vma's interval trees.
@@ -554,6 +707,7 @@ void __vma_link_rb(struct mm_struct *mm, struct vm_area_struct *vma,
 	vma->rb_subtree_gap = 0;
 	vma_gap_update(vma);
 	vma_rb_insert(vma, &mm->mm_rb);
+	vma_fences_churn(mm);
 }
 
 static void __vma_link_file(struct vm_area_struct *vma)
@@ -595,8 +749,10 @@ static void vma_link(struct mm_struct *mm, struct vm_area_struct *vma,
 		i_mmap_lock_write(mapping);
 	}
 
+	mm_write_seqbegin(mm);
 	__vma_link(mm, vma, prev, rb_link, rb_parent);
 	__vma_link_file(vma);
+	mm_write_seqend(mm);
 
 	if (mapping)
 		i_mmap_unlock_write(mapping);
@@ -759,6 +915,8 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 				return error;
 		}
 	}
+
+	mm_write_seqbegin(mm);
 again:
 	vma_adjust_trans_huge(orig_vma, start, end, adjust_next);
 
@@ -945,6 +1103,7 @@ again:
 	if (insert && file)
 		uprobe_mmap(insert);
 
+	mm_write_seqend(mm);
 	validate_mm(mm);
 
 	return 0;
@@ -2100,6 +2259,11 @@ struct vm_area_struct *find_vma(struct mm_struct *mm, unsigned long addr)
 	if (likely(vma))
 		return vma;
 
+	if (mm->nr_fences) {
+		vma = vma_fences_lookup(mm, addr);
+		goto found;
+	}
+
 	rb_node = mm->mm_rb.rb_node;
 
 	while (rb_node) {
@@ -2116,6 +2280,7 @@ struct vm_area_struct *find_vma(struct mm_struct *mm, unsigned long addr)
 			rb_node = rb_node->rb_right;
 	}
 
+found:
 	if (vma)
 		vmacache_update(addr, vma);
 	return vma;
@@ -2476,6 +2641,7 @@ detach_vmas_to_be_unmapped(struct mm_struct *mm, struct vm_area_struct *vma,
 
 	insertion_point = (prev ? &prev->vm_next : &mm->mmap);
 	vma->vm_prev = NULL;
+	mm_write_seqbegin(mm);
 	do {
 		vma_rb_erase(vma, &mm->mm_rb);
 		mm->map_count--;
@@ -2489,6 +2655,7 @@ detach_vmas_to_be_unmapped(struct mm_struct *mm, struct vm_area_struct *vma,
 	} else
 		mm->highest_vm_end = prev ? prev->vm_end : 0;
 	tail_vma->vm_next = NULL;
+	mm_write_seqend(mm);
 
 	/* Kill the cache */
 	vmacache_invalidate(mm);
@@ -2928,6 +3095,10 @@ void exit_mmap(struct mm_struct *mm)
 
 	arch_exit_mmap(mm);
 
+	kvfree(mm->vma_fences);
+	mm->vma_fences = NULL;
+	mm->nr_fences = 0;
+
 	vma = mm->mmap;
 	if (!vma)	/* Can happen if dup_mmap() received an OOM */
 		return;
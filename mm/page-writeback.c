@@ -714,6 +714,21 @@ int bdi_set_max_ratio(struct backing_dev_info *bdi, unsigned max_ratio)
 }
 EXPORT_SYMBOL(bdi_set_max_ratio);
 
+/*
+ * Minimum writeback bandwidth, in pages per second, that each wb on the
+ * bdi is entitled to.  With cgroup writeback this puts a floor under
+ * every cgroup's share of the dirty threshold, so one cgroup's dirty
+ * flood cannot squeeze another's writeback down to nothing.
+ */
+int bdi_set_min_bw(struct backing_dev_info *bdi, unsigned long min_bw)
+{
+	spin_lock_bh(&bdi_lock);
+	bdi->min_bw = min_bw;
+	spin_unlock_bh(&bdi_lock);
+
+	return 0;
+}
+
 static unsigned long dirty_freerun_ceiling(unsigned long thresh,
 					   unsigned long bg_thresh)
 {
@@ -786,6 +801,23 @@ static unsigned long __wb_calc_thresh(struct dirty_throttle_control *dtc)
 	if (wb_thresh > (thresh * wb_max_ratio) / 100)
 		wb_thresh = thresh * wb_max_ratio / 100;
 
+	/*
+	 * The configured bandwidth floor translates into a floor on the
+	 * wb's share of the threshold, so a wb that has not been able to
+	 * build up measured bandwidth is still guaranteed its cut.
+	 */
+	if (unlikely(dtc->wb->bdi->min_bw)) {
+		unsigned long min_bw = dtc->wb->bdi->min_bw;
+		unsigned long tot_bw =
+			atomic_long_read(&dtc->wb->bdi->tot_write_bandwidth);
+		u64 floor = thresh;
+
+		if (tot_bw > min_bw)
+			floor = div64_u64((u64)thresh * min_bw, tot_bw);
+		if (wb_thresh < floor)
+			wb_thresh = floor;
+	}
+
 	return wb_thresh;
 }
 
@@ -69,6 +69,7 @@
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
 #include "internal.h"
+#include "page_reporting.h"
 
 /* prevent >1 _updater_ of zone percpu pageset ->high and ->batch fields */
 static DEFINE_MUTEX(pcp_batch_high_lock);
@@ -785,7 +786,7 @@ static inline int page_is_buddy(struct page *page, struct page *buddy,
 static inline void __free_one_page(struct page *page,
 		unsigned long pfn,
 		struct zone *zone, unsigned int order,
-		int migratetype)
+		int migratetype, bool report)
 {
 	unsigned long page_idx;
 	unsigned long combined_idx;
@@ -823,6 +824,7 @@ continue_merging:
 			list_del(&buddy->lru);
 			zone->free_area[order].nr_free--;
 			rmv_page_order(buddy);
+			__ClearPageReported(buddy);
 		}
 		combined_idx = buddy_idx & page_idx;
 		page = page + (combined_idx - page_idx);
@@ -881,6 +883,10 @@ done_merging:
 	list_add(&page->lru, &zone->free_area[order].free_list[migratetype]);
 out:
 	zone->free_area[order].nr_free++;
+
+	/* Notify page reporting subsystem of freed page */
+	if (report)
+		page_reporting_notify_free(order);
 }
 
 /*
@@ -1135,7 +1141,7 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 			if (bulkfree_pcp_prepare(page))
 				continue;
 
-			__free_one_page(page, page_to_pfn(page), zone, 0, mt);
+			__free_one_page(page, page_to_pfn(page), zone, 0, mt, true);
 			trace_mm_page_pcpu_drain(page, 0, mt);
 		} while (--count && --batch_free && !list_empty(list));
 	}
@@ -1157,7 +1163,7 @@ static void free_one_page(struct zone *zone,
 		is_migrate_isolate(migratetype))) {
 		migratetype = get_pfnblock_migratetype(page, pfn);
 	}
-	__free_one_page(page, pfn, zone, order, migratetype);
+	__free_one_page(page, pfn, zone, order, migratetype, true);
 	spin_unlock(&zone->lock);
 }
 
@@ -1802,6 +1808,7 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
 			continue;
 		list_del(&page->lru);
 		rmv_page_order(page);
+		__ClearPageReported(page);
 		area->nr_free--;
 		expand(zone, page, order, current_order, area, migratetype);
 		set_pcppage_migratetype(page, migratetype);
@@ -2166,6 +2173,7 @@ __rmqueue_fallback(struct zone *zone, unsigned int order, int start_migratetype)
 		area->nr_free--;
 		list_del(&page->lru);
 		rmv_page_order(page);
+		__ClearPageReported(page);
 
 		expand(zone, page, order, current_order, area,
 					start_migratetype);
@@ -2559,6 +2567,7 @@ int __isolate_free_page(struct page *page, unsigned int order)
 	list_del(&page->lru);
 	zone->free_area[order].nr_free--;
 	rmv_page_order(page);
+	__ClearPageReported(page);
 
 	/*
 	 * Set the pageblock if the isolated page is at least half of a
@@ -2579,6 +2588,26 @@ int __isolate_free_page(struct page *page, unsigned int order)
 	return 1UL << order;
 }
 
+/**
+ * __putback_isolated_page - Return a now-isolated page back where we got it
+ * @page: Page that was isolated
+ * @order: Order of the isolated page
+ * @mt: The page's pageblock's migratetype
+ *
+ * This function is meant to return a page pulled from the free lists via
+ * __isolate_free_page back to the free lists they were pulled from.
+ */
+void __putback_isolated_page(struct page *page, unsigned int order, int mt)
+{
+	struct zone *zone = page_zone(page);
+
+	/* zone lock should be held when this function is called */
+	lockdep_assert_held(&zone->lock);
+
+	/* Return isolated page to tail of freelist. */
+	__free_one_page(page, page_to_pfn(page), zone, order, mt, false);
+}
+
 /*
  * Update NUMA hit/miss statistics
  *
@@ -3864,6 +3893,144 @@ out:
 }
 EXPORT_SYMBOL(__alloc_pages_nodemask);
 
+/*
+ * __alloc_pages_bulk_nodemask - allocate a number of order-0 pages in bulk
+ * @gfp_mask: GFP flags for the allocation, must not contain __GFP_COMP
+ * @zonelist: the zonelist to allocate from
+ * @nodemask: set of nodes to allocate from, may be NULL
+ * @nr_pages: the number of pages wanted
+ * @page_list: list to store the allocated pages on
+ *
+ * Fills @page_list with up to @nr_pages order-0 pages, going through the
+ * per-cpu pagesets and taking the zone lock at most once per pcp refill
+ * instead of once per page. Intended for callers such as NAPI page-buffer
+ * refill that would otherwise call the page allocator in a tight loop.
+ *
+ * Only the preferred zone is tried; if it cannot satisfy the request the
+ * remainder falls back to single-page allocation so that reclaim and all
+ * the usual slowpath handling still happen.
+ *
+ * Returns the number of pages placed on @page_list, which may be fewer
+ * than requested.
+ */
+unsigned long
+__alloc_pages_bulk_nodemask(gfp_t gfp_mask, struct zonelist *zonelist,
+			    nodemask_t *nodemask, unsigned long nr_pages,
+			    struct list_head *page_list)
+{
+	struct page *page;
+	unsigned long allocated = 0;
+	unsigned long flags;
+	unsigned int alloc_flags = ALLOC_WMARK_LOW;
+	bool cold = ((gfp_mask & __GFP_COLD) != 0);
+	struct zoneref *z;
+	struct per_cpu_pages *pcp;
+	struct list_head *pcp_list;
+	struct zone *zone;
+	struct alloc_context ac = {
+		.high_zoneidx = gfp_zone(gfp_mask),
+		.zonelist = zonelist,
+		.nodemask = nodemask,
+		.migratetype = gfpflags_to_migratetype(gfp_mask),
+	};
+
+	if (WARN_ON_ONCE(gfp_mask & __GFP_COMP))
+		gfp_mask &= ~__GFP_COMP;
+
+	if (unlikely(nr_pages == 0))
+		return 0;
+
+	if (cpusets_enabled()) {
+		gfp_mask |= __GFP_HARDWALL;
+		alloc_flags |= ALLOC_CPUSET;
+		if (!ac.nodemask)
+			ac.nodemask = &cpuset_current_mems_allowed;
+	}
+
+	gfp_mask &= gfp_allowed_mask;
+
+	might_sleep_if(gfp_mask & __GFP_DIRECT_RECLAIM);
+
+	if (IS_ENABLED(CONFIG_CMA) && ac.migratetype == MIGRATE_MOVABLE)
+		alloc_flags |= ALLOC_CMA;
+
+	/*
+	 * Find a suitable preferred zone. Unlike get_page_from_freelist()
+	 * the watermark check covers the whole batch so that a successful
+	 * check guarantees the pcp refill cannot dip below the low mark.
+	 */
+	ac.preferred_zoneref = first_zones_zonelist(ac.zonelist,
+					ac.high_zoneidx, ac.nodemask);
+	for_each_zone_zonelist_nodemask(zone, z, ac.zonelist, ac.high_zoneidx,
+					ac.nodemask) {
+		unsigned long mark;
+
+		if (cpusets_enabled() && (alloc_flags & ALLOC_CPUSET) &&
+		    !__cpuset_zone_allowed(zone, gfp_mask))
+			continue;
+
+		mark = zone->watermark[alloc_flags & ALLOC_WMARK_MASK];
+		if (zone_watermark_fast(zone, 0, mark + nr_pages,
+					ac_classzone_idx(&ac), alloc_flags))
+			goto found;
+	}
+	goto failed;
+
+found:
+	local_irq_save(flags);
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	pcp_list = &pcp->lists[ac.migratetype];
+
+	while (allocated < nr_pages) {
+		if (list_empty(pcp_list)) {
+			int alloced = rmqueue_bulk(zone, 0,
+					max_t(unsigned int, pcp->batch,
+					      nr_pages - allocated),
+					pcp_list, ac.migratetype, cold);
+
+			pcp->count += alloced;
+			if (unlikely(list_empty(pcp_list)))
+				break;
+		}
+
+		if (cold)
+			page = list_last_entry(pcp_list, struct page, lru);
+		else
+			page = list_first_entry(pcp_list, struct page, lru);
+
+		list_del(&page->lru);
+		pcp->count--;
+
+		if (unlikely(check_new_pcp(page)))
+			continue;
+
+		prep_new_page(page, 0, gfp_mask, alloc_flags);
+		zone_statistics(ac.preferred_zoneref->zone, zone);
+		list_add_tail(&page->lru, page_list);
+		allocated++;
+	}
+
+	if (allocated)
+		__count_zid_vm_events(PGALLOC, zone_idx(zone), allocated);
+	local_irq_restore(flags);
+
+failed:
+	/*
+	 * Pick up any remainder a page at a time so the batch still gets
+	 * the benefit of direct reclaim and the rest of the slowpath.
+	 */
+	while (allocated < nr_pages) {
+		page = __alloc_pages_nodemask(gfp_mask, 0, zonelist, nodemask);
+		if (!page)
+			break;
+		list_add_tail(&page->lru, page_list);
+		allocated++;
+	}
+
+	return allocated;
+}
+EXPORT_SYMBOL(__alloc_pages_bulk_nodemask);
+
 /*
  * Common helper functions.
  */
@@ -51,21 +51,27 @@ void page_counter_charge(struct page_counter *counter, unsigned long nr_pages)
 }
 
 /**
- * page_counter_try_charge - try to hierarchically charge pages
+ * page_counter_try_charge_upto - try to charge part of an ancestry path
  * @counter: counter
+ * @stop: ancestor of @counter to stop before, or NULL for the whole path
  * @nr_pages: number of pages to charge
  * @fail: points first counter to hit its limit, if any
  *
- * Returns %true on success, or %false and @fail if the counter or one
- * of its ancestors has hit its configured limit.
+ * Like page_counter_try_charge(), but walks only the counters between
+ * @counter and @stop, exclusive.  The caller guarantees that @stop is
+ * an ancestor of @counter and holds charges for @stop and above.
+ *
+ * Returns %true on success, or %false and @fail if a counter on the
+ * walked part of the path has hit its configured limit.
  */
-bool page_counter_try_charge(struct page_counter *counter,
-			     unsigned long nr_pages,
-			     struct page_counter **fail)
+bool page_counter_try_charge_upto(struct page_counter *counter,
+				  struct page_counter *stop,
+				  unsigned long nr_pages,
+				  struct page_counter **fail)
 {
 	struct page_counter *c;
 
-	for (c = counter; c; c = c->parent) {
+	for (c = counter; c != stop; c = c->parent) {
 		long new;
 		/*
 		 * Charge speculatively to avoid an expensive CAS.  If
@@ -109,18 +115,50 @@ failed:
 }
 
 /**
- * page_counter_uncharge - hierarchically uncharge pages
+ * page_counter_try_charge - try to hierarchically charge pages
  * @counter: counter
+ * @nr_pages: number of pages to charge
+ * @fail: points first counter to hit its limit, if any
+ *
+ * Returns %true on success, or %false and @fail if the counter or one
+ * of its ancestors has hit its configured limit.
+ */
+bool page_counter_try_charge(struct page_counter *counter,
+			     unsigned long nr_pages,
+			     struct page_counter **fail)
+{
+	return page_counter_try_charge_upto(counter, NULL, nr_pages, fail);
+}
+
+/**
+ * page_counter_uncharge_upto - uncharge part of an ancestry path
+ * @counter: counter
+ * @stop: ancestor of @counter to stop before, or NULL for the whole path
  * @nr_pages: number of pages to uncharge
+ *
+ * The caller guarantees that @stop is an ancestor of @counter and
+ * keeps holding the charges for @stop and above.
  */
-void page_counter_uncharge(struct page_counter *counter, unsigned long nr_pages)
+void page_counter_uncharge_upto(struct page_counter *counter,
+				struct page_counter *stop,
+				unsigned long nr_pages)
 {
 	struct page_counter *c;
 
-	for (c = counter; c; c = c->parent)
+	for (c = counter; c != stop; c = c->parent)
 		page_counter_cancel(c, nr_pages);
 }
 
+/**
+ * page_counter_uncharge - hierarchically uncharge pages
+ * @counter: counter
+ * @nr_pages: number of pages to uncharge
+ */
+void page_counter_uncharge(struct page_counter *counter, unsigned long nr_pages)
+{
+	page_counter_uncharge_upto(counter, NULL, nr_pages);
+}
+
 /**
  * page_counter_limit - limit the number of pages allowed
  * @counter: counter
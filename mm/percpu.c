@@ -77,7 +77,9 @@
 #include <asm/io.h>
 
 #define PCPU_SLOT_BASE_SHIFT		5	/* 1-31 shares the same slot */
+#define PCPU_SMALL_ALLOC_SIZE		256	/* small/large chunk class split */
 #define PCPU_DFL_MAP_ALLOC		16	/* start a map with 16 ents */
+#define PCPU_BULK_FREE_BATCH		16	/* frees per pcpu_lock hold */
 #define PCPU_ATOMIC_MAP_MARGIN_LOW	32
 #define PCPU_ATOMIC_MAP_MARGIN_HIGH	64
 #define PCPU_EMPTY_POP_PAGES_LOW	2
@@ -117,6 +119,7 @@ struct pcpu_chunk {
 	void			*data;		/* chunk data */
 	int			first_free;	/* no free below this */
 	bool			immutable;	/* no [de]population allowed */
+	bool			small;		/* serves small allocations */
 	int			nr_populated;	/* # of populated pages */
 	unsigned long		populated[];	/* populated bitmap */
 };
@@ -228,6 +231,20 @@ static int pcpu_chunk_slot(const struct pcpu_chunk *chunk)
 	return pcpu_size_to_slot(chunk->free_size);
 }
 
+/*
+ * Dynamic chunks are segregated into a small and a large class so that
+ * high-churn small allocations (percpu counters and the like) don't
+ * pepper large chunks with holes.  The first chunk keeps serving both
+ * classes to use up the leftover boot area, and a fully free chunk can
+ * be adopted by either class.
+ */
+static bool pcpu_chunk_class_ok(const struct pcpu_chunk *chunk, bool is_small)
+{
+	if (chunk == pcpu_first_chunk || chunk->free_size == pcpu_unit_size)
+		return true;
+	return chunk->small == is_small;
+}
+
 /* set the pointer to a chunk in a page struct */
 static void pcpu_set_page_chunk(struct page *page, struct pcpu_chunk *pcpu)
 {
@@ -872,6 +889,7 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 	struct pcpu_chunk *chunk;
 	const char *err;
 	bool is_atomic = (gfp & GFP_KERNEL) != GFP_KERNEL;
+	bool is_small;
 	int occ_pages = 0;
 	int slot, off, new_alloc, cpu, ret;
 	unsigned long flags;
@@ -885,6 +903,7 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 		align = 2;
 
 	size = ALIGN(size, 2);
+	is_small = size <= PCPU_SMALL_ALLOC_SIZE;
 
 	if (unlikely(!size || size > PCPU_MIN_UNIT_SIZE || align > PAGE_SIZE ||
 		     !is_power_of_2(align))) {
@@ -933,6 +952,9 @@ restart:
 			if (size > chunk->contig_hint)
 				continue;
 
+			if (!pcpu_chunk_class_ok(chunk, is_small))
+				continue;
+
 			new_alloc = pcpu_need_to_extend(chunk, is_atomic);
 			if (new_alloc) {
 				if (is_atomic)
@@ -953,8 +975,12 @@ restart:
 
 			off = pcpu_alloc_area(chunk, size, align, is_atomic,
 					      &occ_pages);
-			if (off >= 0)
+			if (off >= 0) {
+				/* an empty chunk is adopted by our class */
+				if (chunk != pcpu_first_chunk)
+					chunk->small = is_small;
 				goto area_found;
+			}
 		}
 	}
 
@@ -1236,6 +1262,43 @@ retry_pop:
 	mutex_unlock(&pcpu_alloc_mutex);
 }
 
+/*
+ * Free one percpu area, pcpu_lock must be held.  Returns %true if the
+ * containing chunk became fully free.
+ */
+static bool __free_percpu(void __percpu *ptr)
+{
+	void *addr = __pcpu_ptr_to_addr(ptr);
+	struct pcpu_chunk *chunk;
+	int off, occ_pages;
+
+	chunk = pcpu_chunk_addr_search(addr);
+	off = addr - chunk->base_addr;
+
+	pcpu_free_area(chunk, off, &occ_pages);
+
+	if (chunk != pcpu_reserved_chunk)
+		pcpu_nr_empty_pop_pages += occ_pages;
+
+	return chunk->free_size == pcpu_unit_size;
+}
+
+/*
+ * If there are more than one fully free chunks, wake up grim reaper.
+ * pcpu_lock must be held.
+ */
+static void pcpu_check_reclaim(void)
+{
+	struct pcpu_chunk *pos;
+	int nr = 0;
+
+	list_for_each_entry(pos, &pcpu_slot[pcpu_nr_slots - 1], list)
+		if (++nr > 1) {
+			pcpu_schedule_balance_work();
+			break;
+		}
+}
+
 /**
  * free_percpu - free percpu area
  * @ptr: pointer to area to free
@@ -1247,42 +1310,66 @@ retry_pop:
  */
 void free_percpu(void __percpu *ptr)
 {
-	void *addr;
-	struct pcpu_chunk *chunk;
 	unsigned long flags;
-	int off, occ_pages;
 
 	if (!ptr)
 		return;
 
 	kmemleak_free_percpu(ptr);
 
-	addr = __pcpu_ptr_to_addr(ptr);
-
 	spin_lock_irqsave(&pcpu_lock, flags);
 
-	chunk = pcpu_chunk_addr_search(addr);
-	off = addr - chunk->base_addr;
+	if (__free_percpu(ptr))
+		pcpu_check_reclaim();
 
-	pcpu_free_area(chunk, off, &occ_pages);
+	spin_unlock_irqrestore(&pcpu_lock, flags);
+}
+EXPORT_SYMBOL_GPL(free_percpu);
 
-	if (chunk != pcpu_reserved_chunk)
-		pcpu_nr_empty_pop_pages += occ_pages;
+/**
+ * free_percpu_bulk - free an array of percpu areas
+ * @ptrs: areas to free, NULL entries are skipped
+ * @nr: number of entries in @ptrs
+ *
+ * Free @nr percpu areas with far fewer pcpu_lock acquisitions than
+ * calling free_percpu() on each.  Frees are batched so that interrupts
+ * are never disabled for more than %PCPU_BULK_FREE_BATCH frees at a
+ * time.  The contents of @ptrs are left untouched; the caller must not
+ * use the areas afterwards.
+ *
+ * CONTEXT:
+ * Can be called from atomic context.
+ */
+void free_percpu_bulk(void __percpu **ptrs, size_t nr)
+{
+	unsigned long flags;
+	bool empty = false;
+	size_t i, n;
 
-	/* if there are more than one fully free chunks, wake up grim reaper */
-	if (chunk->free_size == pcpu_unit_size) {
-		struct pcpu_chunk *pos;
+	while (nr) {
+		n = min_t(size_t, nr, PCPU_BULK_FREE_BATCH);
 
-		list_for_each_entry(pos, &pcpu_slot[pcpu_nr_slots - 1], list)
-			if (pos != chunk) {
-				pcpu_schedule_balance_work();
-				break;
-			}
+		for (i = 0; i < n; i++)
+			if (ptrs[i])
+				kmemleak_free_percpu(ptrs[i]);
+
+		spin_lock_irqsave(&pcpu_lock, flags);
+		for (i = 0; i < n; i++)
+			if (ptrs[i])
+				empty |= __free_percpu(ptrs[i]);
+		spin_unlock_irqrestore(&pcpu_lock, flags);
+
+		ptrs += n;
+		nr -= n;
 	}
 
-	spin_unlock_irqrestore(&pcpu_lock, flags);
+	if (empty) {
+		spin_lock_irqsave(&pcpu_lock, flags);
+		pcpu_check_reclaim();
+		spin_unlock_irqrestore(&pcpu_lock, flags);
+	}
 }
-EXPORT_SYMBOL_GPL(free_percpu);
+EXPORT_SYMBOL_GPL(free_percpu_bulk);
 
 /**
  * is_kernel_percpu_address - test whether address is from static percpu area
@@ -155,6 +155,8 @@ int __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	struct page *page;
 	unsigned long end_index;	/* The last page we want to read */
 	LIST_HEAD(page_pool);
+	LIST_HEAD(spare_pages);
+	unsigned long nr_spare = 0;
 	int page_idx;
 	int ret = 0;
 	loff_t isize = i_size_read(inode);
@@ -166,8 +168,15 @@ int __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	end_index = ((isize - 1) >> PAGE_SHIFT);
 
 	/*
-	 * Preallocate as many pages as we will need.
+	 * Preallocate as many pages as we will need.  Readahead windows are
+	 * usually entirely uncached, so grab the lot in a single trip to the
+	 * page allocator and only fall back to one-at-a-time allocation if
+	 * the bulk call comes up short.  Pages the window turns out not to
+	 * need (cached ranges, EOF) are put back below.
 	 */
+	if (nr_to_read > 1)
+		nr_spare = alloc_pages_bulk(gfp_mask, nr_to_read, &spare_pages);
+
 	for (page_idx = 0; page_idx < nr_to_read; page_idx++) {
 		pgoff_t page_offset = offset + page_idx;
 
@@ -180,9 +189,15 @@ int __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (page && !radix_tree_exceptional_entry(page))
 			continue;
 
-		page = __page_cache_alloc(gfp_mask);
-		if (!page)
-			break;
+		if (nr_spare) {
+			page = lru_to_page(&spare_pages);
+			list_del(&page->lru);
+			nr_spare--;
+		} else {
+			page = __page_cache_alloc(gfp_mask);
+			if (!page)
+				break;
+		}
 		page->index = page_offset;
 		list_add(&page->lru, &page_pool);
 		if (page_idx == nr_to_read - lookahead_size)
@@ -190,6 +205,12 @@ int __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		ret++;
 	}
 
+	while (!list_empty(&spare_pages)) {
+		page = lru_to_page(&spare_pages);
+		list_del(&page->lru);
+		put_page(page);
+	}
+
 	/*
 	 * Now start the IO.  We ignore I/O errors - if the page is not
 	 * uptodate then the caller will launch readpage again, and
@@ -401,6 +422,15 @@ ondemand_readahead(struct address_space *mapping,
 	 */
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
+		/*
+		 * A stream that keeps hitting the expected offset has
+		 * proven itself; let its window grow past the per-file
+		 * default up to the optimal hardware IO size.
+		 */
+		if (ra->seq_streak < 8)
+			ra->seq_streak++;
+		if (ra->seq_streak >= 4 && bdi->io_pages > max_pages)
+			max_pages = bdi->io_pages;
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max_pages);
 		ra->async_size = ra->size;
@@ -457,9 +487,11 @@ ondemand_readahead(struct address_space *mapping,
 	 * standalone, small random read
 	 * Read as is, and do not pollute the readahead state.
 	 */
+	ra->seq_streak = 0;
 	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
 
 initial_readahead:
+	ra->seq_streak = 0;
 	ra->start = offset;
 	ra->size = get_init_ra_size(req_size, max_pages);
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
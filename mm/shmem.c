@@ -2247,6 +2247,186 @@ shmem_write_end(struct file *file, struct address_space *mapping,
 	return copied;
 }
 
+/*
+ * Zero the parts of @head that the range [@from, @to) did not cover,
+ * before the page is published as uptodate.
+ */
+static void shmem_zero_uncovered(struct page *head, unsigned long from,
+				 unsigned long to)
+{
+	unsigned int i;
+
+	for (i = 0; i < hpage_nr_pages(head); i++) {
+		unsigned long start = (unsigned long)i << PAGE_SHIFT;
+		unsigned long s = max(from, start);
+		unsigned long e = min(to, start + PAGE_SIZE);
+
+		if (e <= s)
+			zero_user(head + i, 0, PAGE_SIZE);
+		else
+			zero_user_segments(head + i, 0, s - start,
+					   e - start, PAGE_SIZE);
+	}
+}
+
+/*
+ * Like generic_perform_write(), but sized to the compound page backing
+ * the write: on a huge-page-backed mapping an aligned 2MB extent costs
+ * one radix tree lookup, one page reference and one copy loop instead
+ * of one of each per 4K subpage.
+ */
+static ssize_t shmem_perform_write(struct file *file, struct iov_iter *i,
+				   loff_t pos)
+{
+	struct inode *inode = file_inode(file);
+	struct address_space *mapping = inode->i_mapping;
+	long status = 0;
+	ssize_t written = 0;
+	bool huge = false;
+
+	do {
+		struct page *page;
+		struct page *head;
+		struct page *copy_page;
+		pgoff_t index = pos >> PAGE_SHIFT;
+		unsigned long offset = pos & ~PAGE_MASK;
+		unsigned long head_offset;
+		unsigned long copy_offset;
+		size_t bytes, copied;
+
+		/*
+		 * Once the file has produced one compound page, expect more
+		 * and fault in the user buffer up to the next huge page
+		 * boundary, so the whole extent can be copied in one go.
+		 */
+		bytes = min_t(size_t, PAGE_SIZE - offset, iov_iter_count(i));
+		if (IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE) && huge)
+			bytes = min_t(size_t,
+				      HPAGE_PMD_SIZE -
+				      (pos & (HPAGE_PMD_SIZE - 1)),
+				      iov_iter_count(i));
+again:
+		/*
+		 * Bring in the user page(s) that we will copy from _first_.
+		 * Otherwise there's a nasty deadlock on copying from the
+		 * same page as we're writing to, without it being marked
+		 * up-to-date.
+		 */
+		if (unlikely(iov_iter_fault_in_readable(i, bytes))) {
+			status = -EFAULT;
+			break;
+		}
+
+		status = shmem_getpage(inode, index, &page, SGP_WRITE);
+		if (unlikely(status))
+			break;
+
+		head = compound_head(page);
+		head_offset = ((index - head->index) << PAGE_SHIFT) + offset;
+		huge = PageTransCompound(page) && !PageHighMem(page);
+		if (huge) {
+			/*
+			 * Copy into the whole compound page at once; it is
+			 * physically contiguous lowmem, so offsets beyond
+			 * the first subpage are fine.
+			 */
+			copy_page = head;
+			copy_offset = head_offset;
+			bytes = min_t(size_t,
+				      (PAGE_SIZE << compound_order(head)) -
+				      copy_offset, bytes);
+		} else {
+			copy_page = page;
+			copy_offset = offset;
+			bytes = min_t(size_t, PAGE_SIZE - offset, bytes);
+		}
+
+		copied = iov_iter_copy_from_user_atomic(copy_page, i,
+							copy_offset, bytes);
+		if (copied) {
+			unsigned long n;
+
+			for (n = copy_offset >> PAGE_SHIFT;
+			     n <= (copy_offset + copied - 1) >> PAGE_SHIFT; n++)
+				flush_dcache_page(copy_page + n);
+		}
+
+		if (pos + copied > inode->i_size)
+			i_size_write(inode, pos + copied);
+
+		if (!PageUptodate(head)) {
+			/*
+			 * Zero what the copy did not cover before publishing
+			 * the page; a short copy only costs re-copying the
+			 * zeroed bytes on the next iteration.
+			 */
+			shmem_zero_uncovered(head, head_offset,
+					     head_offset + copied);
+			SetPageUptodate(head);
+		}
+		set_page_dirty(page);
+		unlock_page(page);
+		put_page(page);
+
+		iov_iter_advance(i, copied);
+		if (unlikely(copied == 0)) {
+			/*
+			 * If we were unable to copy any data at all, we must
+			 * fall back to a single segment length write.
+			 */
+			bytes = min_t(size_t, PAGE_SIZE - offset,
+				      iov_iter_single_seg_count(i));
+			goto again;
+		}
+		pos += copied;
+		written += copied;
+
+		balance_dirty_pages_ratelimited(mapping);
+	} while (iov_iter_count(i));
+
+	return written ? written : status;
+}
+
+static ssize_t shmem_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct shmem_inode_info *info = SHMEM_I(inode);
+	ssize_t ret;
+
+	inode_lock(inode);
+	ret = generic_write_checks(iocb, from);
+	if (ret <= 0)
+		goto unlock;
+
+	/* i_mutex is held, which keeps the seals stable */
+	if (unlikely(info->seals)) {
+		ret = -EPERM;
+		if (info->seals & F_SEAL_WRITE)
+			goto unlock;
+		if ((info->seals & F_SEAL_GROW) &&
+		    iocb->ki_pos + iov_iter_count(from) > inode->i_size)
+			goto unlock;
+	}
+
+	ret = file_remove_privs(file);
+	if (ret)
+		goto unlock;
+
+	ret = file_update_time(file);
+	if (ret)
+		goto unlock;
+
+	ret = shmem_perform_write(file, from, iocb->ki_pos);
+	if (ret > 0)
+		iocb->ki_pos += ret;
+unlock:
+	inode_unlock(inode);
+	if (ret > 0)
+		ret = generic_write_sync(iocb, ret);
+	return ret;
+}
+
 static ssize_t shmem_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
 	struct file *file = iocb->ki_filp;
@@ -2272,9 +2452,11 @@ static ssize_t shmem_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 
 	for (;;) {
 		struct page *page = NULL;
+		struct page *copy_page;
 		pgoff_t end_index;
 		unsigned long nr, ret;
-		loff_t i_size = i_size_read(inode);
+		unsigned long copy_offset;
+		loff_t pos, i_size = i_size_read(inode);
 
 		end_index = i_size >> PAGE_SHIFT;
 		if (index > end_index)
@@ -2301,18 +2483,13 @@ static ssize_t shmem_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 		 * We must evaluate after, since reads (unlike writes)
 		 * are called without i_mutex protection against truncate
 		 */
-		nr = PAGE_SIZE;
 		i_size = i_size_read(inode);
-		end_index = i_size >> PAGE_SHIFT;
-		if (index == end_index) {
-			nr = i_size & ~PAGE_MASK;
-			if (nr <= offset) {
-				if (page)
-					put_page(page);
-				break;
-			}
+		pos = ((loff_t)index << PAGE_SHIFT) + offset;
+		if (pos >= i_size) {
+			if (page)
+				put_page(page);
+			break;
 		}
-		nr -= offset;
 
 		if (page) {
 			/*
@@ -2332,15 +2509,39 @@ static ssize_t shmem_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 			get_page(page);
 		}
 
+		copy_page = page;
+		copy_offset = offset;
+		nr = PAGE_SIZE - offset;
+		if (PageTransCompound(page) && !PageHighMem(page)) {
+			/*
+			 * Copy straight out of the compound page: one radix
+			 * tree lookup, one page reference and one copy loop
+			 * serve up to a whole huge page. The compound page
+			 * is physically contiguous lowmem, so offsets beyond
+			 * the first subpage are fine.
+			 */
+			copy_page = compound_head(page);
+			copy_offset += (index - copy_page->index) << PAGE_SHIFT;
+			nr = (PAGE_SIZE << compound_order(copy_page)) -
+				copy_offset;
+			if (mapping_writably_mapped(mapping)) {
+				int i;
+
+				for (i = 1; i < HPAGE_PMD_NR; i++)
+					flush_dcache_page(copy_page + i);
+			}
+		}
+		nr = min_t(loff_t, nr, i_size - pos);
+
 		/*
 		 * Ok, we have the page, and it's up-to-date, so
 		 * now we can copy it to user space...
 		 */
-		ret = copy_page_to_iter(page, offset, nr, to);
+		ret = copy_page_to_iter(copy_page, copy_offset, nr, to);
 		retval += ret;
-		offset += ret;
-		index += offset >> PAGE_SHIFT;
-		offset &= ~PAGE_MASK;
+		pos += ret;
+		index = pos >> PAGE_SHIFT;
+		offset = pos & ~PAGE_MASK;
 
 		put_page(page);
 		if (!iov_iter_count(to))
@@ -3710,7 +3911,7 @@ static const struct file_operations shmem_file_operations = {
 #ifdef CONFIG_TMPFS
 	.llseek		= shmem_file_llseek,
 	.read_iter	= shmem_file_read_iter,
-	.write_iter	= generic_file_write_iter,
+	.write_iter	= shmem_file_write_iter,
 	.fsync		= noop_fsync,
 	.splice_read	= generic_file_splice_read,
 	.splice_write	= iter_file_splice_write,
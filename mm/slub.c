@@ -2270,6 +2270,13 @@ static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 	c->freelist = NULL;
 }
 
+#ifdef CONFIG_SLUB_REMOTE_FREE_CACHE
+static void flush_remote_frees(struct kmem_cache *s, struct kmem_cache_cpu *c);
+#else
+static inline void flush_remote_frees(struct kmem_cache *s,
+				      struct kmem_cache_cpu *c) { }
+#endif
+
 /*
  * Flush cpu slab.
  *
@@ -2284,6 +2291,7 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 			flush_slab(s, c);
 
 		unfreeze_partials(s, c);
+		flush_remote_frees(s, c);
 	}
 }
 
@@ -2299,6 +2307,10 @@ static bool has_cpu_slab(int cpu, void *info)
 	struct kmem_cache *s = info;
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
+#ifdef CONFIG_SLUB_REMOTE_FREE_CACHE
+	if (c->remote_nr)
+		return true;
+#endif
 	return c->page || c->partial;
 }
 
@@ -2896,6 +2908,43 @@ slab_empty:
 	discard_slab(s, page);
 }
 
+#ifdef CONFIG_SLUB_REMOTE_FREE_CACHE
+/*
+ * Queue the free of an object belonging to a slab that is not the cpu
+ * slab of this processor, so that it can be returned together with other
+ * deferred frees instead of paying a cmpxchg on the remote slab freelist
+ * per object. Debug caches are never deferred so that the consistency
+ * checks still run at the point of the free.
+ *
+ * Returns false if the object could not be deferred and the caller must
+ * free it directly.
+ */
+static __always_inline bool defer_remote_free(struct kmem_cache *s,
+					      void *object, int cnt)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long flags;
+
+	if (cnt != 1 || kmem_cache_debug(s))
+		return false;
+
+	local_irq_save(flags);
+	c = this_cpu_ptr(s->cpu_slab);
+	c->remote_objs[c->remote_nr++] = object;
+	stat(s, FREE_DEFER);
+	if (c->remote_nr == SLUB_REMOTE_FREE_OBJECTS)
+		flush_remote_frees(s, c);
+	local_irq_restore(flags);
+	return true;
+}
+#else
+static inline bool defer_remote_free(struct kmem_cache *s, void *object,
+				     int cnt)
+{
+	return false;
+}
+#endif
+
 /*
  * Fastpath with forced inlining to produce a kfree and kmem_cache_free that
  * can perform fastpath freeing without additional function calls.
@@ -2946,7 +2995,7 @@ redo:
 			goto redo;
 		}
 		stat(s, FREE_FASTPATH);
-	} else
+	} else if (!defer_remote_free(s, head, cnt))
 		__slab_free(s, page, head, tail_obj, cnt, addr);
 
 }
@@ -3073,6 +3122,37 @@ int build_detached_freelist(struct kmem_cache *s, size_t size,
 	return first_skipped_index;
 }
 
+#ifdef CONFIG_SLUB_REMOTE_FREE_CACHE
+/*
+ * Return the deferred remote frees of a cpu to their slabs. The objects
+ * are grouped per slab with build_detached_freelist() so that each slab
+ * takes a single trip through __slab_free() per batch instead of one
+ * per object.
+ *
+ * Called with interrupts disabled, either on the owning cpu or for a
+ * cpu that is no longer online.
+ */
+static void flush_remote_frees(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	size_t size = c->remote_nr;
+
+	if (!size)
+		return;
+
+	c->remote_nr = 0;
+	do {
+		struct detached_freelist df;
+
+		size = build_detached_freelist(s, size, c->remote_objs, &df);
+		if (!df.page)
+			continue;
+
+		__slab_free(df.s, df.page, df.freelist, df.tail, df.cnt,
+			    _RET_IP_);
+	} while (likely(size));
+}
+#endif
+
 /* Note that interrupts must be enabled when calling this function. */
 void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
 {
@@ -5277,6 +5357,7 @@ STAT_ATTR(DEACTIVATE_FULL, deactivate_full);
 STAT_ATTR(DEACTIVATE_EMPTY, deactivate_empty);
 STAT_ATTR(DEACTIVATE_TO_HEAD, deactivate_to_head);
 STAT_ATTR(DEACTIVATE_TO_TAIL, deactivate_to_tail);
+STAT_ATTR(FREE_DEFER, free_defer);
 STAT_ATTR(DEACTIVATE_REMOTE_FREES, deactivate_remote_frees);
 STAT_ATTR(DEACTIVATE_BYPASS, deactivate_bypass);
 STAT_ATTR(ORDER_FALLBACK, order_fallback);
@@ -5344,6 +5425,7 @@ static struct attribute *slab_attrs[] = {
 	&deactivate_empty_attr.attr,
 	&deactivate_to_head_attr.attr,
 	&deactivate_to_tail_attr.attr,
+	&free_defer_attr.attr,
 	&deactivate_remote_frees_attr.attr,
 	&deactivate_bypass_attr.attr,
 	&order_fallback_attr.attr,
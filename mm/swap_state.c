@@ -468,6 +468,109 @@ static unsigned long swapin_nr_pages(unsigned long offset)
  *
  * Caller must hold down_read on the vma->vm_mm if vma is not NULL.
  */
+/* Maximum readaround window for the VMA-locality mode below */
+#define SWAP_RA_WIN_MAX	16
+
+static bool swap_vma_ra_enabled __read_mostly = true;
+
+/*
+ * VMA-locality readaround: instead of reading the physical swap slots
+ * around the faulting entry, scan the page table entries around the
+ * faulting address and read the swap entries found there.  Virtually
+ * adjacent pages are likely to be used together even when their slots
+ * ended up scattered on the swap device, which is the common case for
+ * zram and SSD swap where slot order carries no seek cost anyway.
+ *
+ * The ptes are examined without the page table lock; a racing modify
+ * just costs us a useless (but harmless) readahead attempt, the same
+ * trade the physical readaround already makes.
+ *
+ * Returns the page for the faulting entry once the surrounding reads
+ * have been queued, or NULL if the neighbourhood was not worth it and
+ * the caller should fall back to physical readaround.
+ */
+static struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+				       struct vm_area_struct *vma,
+				       unsigned long faddr)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	swp_entry_t entries[SWAP_RA_WIN_MAX];
+	unsigned long addrs[SWAP_RA_WIN_MAX];
+	unsigned long start, end, addr;
+	unsigned int win, nr = 0, i;
+	struct blk_plug plug;
+	struct page *page;
+	pte_t *pte, *orig_pte;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	win = min_t(unsigned long, swapin_nr_pages(swp_offset(fentry)),
+		    SWAP_RA_WIN_MAX);
+	if (win <= 1)
+		return NULL;
+
+	/* Window around faddr, clamped to the vma and the faulting pmd. */
+	start = faddr - ((win / 2) << PAGE_SHIFT);
+	if (start > faddr || start < vma->vm_start)
+		start = vma->vm_start;
+	if (start < (faddr & PMD_MASK))
+		start = faddr & PMD_MASK;
+	end = start + (win << PAGE_SHIFT);
+	if (end > vma->vm_end)
+		end = vma->vm_end;
+	if (end > ((faddr & PMD_MASK) + PMD_SIZE))
+		end = (faddr & PMD_MASK) + PMD_SIZE;
+
+	pgd = pgd_offset(mm, faddr);
+	if (!pgd_present(*pgd))
+		return NULL;
+	pud = pud_offset(pgd, faddr);
+	if (!pud_present(*pud))
+		return NULL;
+	pmd = pmd_offset(pud, faddr);
+	if (pmd_none(*pmd) || pmd_trans_huge(*pmd) ||
+	    pmd_devmap(*pmd) || pmd_bad(*pmd))
+		return NULL;
+
+	orig_pte = pte = pte_offset_map(pmd, start);
+	for (addr = start; addr < end; addr += PAGE_SIZE, pte++) {
+		pte_t pentry = *pte;
+		swp_entry_t entry;
+
+		if (pte_none(pentry) || pte_present(pentry))
+			continue;
+		entry = pte_to_swp_entry(pentry);
+		if (unlikely(non_swap_entry(entry)))
+			continue;
+		/* Same-type check also filters out torn/garbage reads. */
+		if (swp_type(entry) != swp_type(fentry))
+			continue;
+		entries[nr] = entry;
+		addrs[nr++] = addr;
+	}
+	pte_unmap(orig_pte);
+
+	/* Nothing but the faulting page itself, not worth a special pass. */
+	if (nr <= 1)
+		return NULL;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++) {
+		page = read_swap_cache_async(entries[i], gfp_mask, vma,
+					     addrs[i]);
+		if (!page)
+			continue;
+		if (entries[i].val != fentry.val)
+			SetPageReadahead(page);
+		put_page(page);
+	}
+	blk_finish_plug(&plug);
+
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+	return read_swap_cache_async(fentry, gfp_mask, vma, faddr);
+}
+
 struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
@@ -478,6 +581,12 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	unsigned long mask;
 	struct blk_plug plug;
 
+	if (swap_vma_ra_enabled && vma) {
+		page = swap_vma_readahead(entry, gfp_mask, vma, addr);
+		if (page)
+			return page;
+	}
+
 	mask = swapin_nr_pages(offset) - 1;
 	if (!mask)
 		goto skip;
@@ -505,3 +614,59 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 skip:
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+#ifdef CONFIG_SYSFS
+static ssize_t vma_ra_enabled_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%s\n", swap_vma_ra_enabled ? "true" : "false");
+}
+static ssize_t vma_ra_enabled_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t count)
+{
+	if (!strncmp(buf, "true", 4) || !strncmp(buf, "1", 1))
+		swap_vma_ra_enabled = true;
+	else if (!strncmp(buf, "false", 5) || !strncmp(buf, "0", 1))
+		swap_vma_ra_enabled = false;
+	else
+		return -EINVAL;
+
+	return count;
+}
+static struct kobj_attribute vma_ra_enabled_attr =
+	__ATTR(vma_ra_enabled, 0644, vma_ra_enabled_show,
+	       vma_ra_enabled_store);
+
+static struct attribute *swap_attrs[] = {
+	&vma_ra_enabled_attr.attr,
+	NULL,
+};
+
+static struct attribute_group swap_attr_group = {
+	.attrs = swap_attrs,
+};
+
+static int __init swap_init_sysfs(void)
+{
+	int err;
+	struct kobject *swap_kobj;
+
+	swap_kobj = kobject_create_and_add("swap", mm_kobj);
+	if (!swap_kobj) {
+		pr_err("failed to create swap kobject\n");
+		return -ENOMEM;
+	}
+	err = sysfs_create_group(swap_kobj, &swap_attr_group);
+	if (err) {
+		pr_err("failed to register swap group\n");
+		goto delete_obj;
+	}
+	return 0;
+
+delete_obj:
+	kobject_put(swap_kobj);
+	return err;
+}
+subsys_initcall(swap_init_sysfs);
+#endif
@@ -47,6 +47,7 @@
 #include <linux/prefetch.h>
 #include <linux/printk.h>
 #include <linux/dax.h>
+#include <linux/memory_hotplug.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -2760,8 +2761,10 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 	int initial_priority = sc->priority;
 	unsigned long total_scanned = 0;
 	unsigned long writeback_threshold;
+	u64 start;
 retry:
 	delayacct_freepages_start();
+	start = local_clock();
 
 	if (global_reclaim(sc))
 		__count_zid_vm_events(ALLOCSTALL, sc->reclaim_idx, 1);
@@ -2802,6 +2805,8 @@ retry:
 	} while (--sc->priority >= 0);
 
 	delayacct_freepages_end();
+	cpuacct_charge_delay(current, CPUACCT_DELAY_RECLAIM,
+			     local_clock() - start);
 
 	if (sc->nr_reclaimed)
 		return sc->nr_reclaimed;
@@ -3566,13 +3571,21 @@ unsigned long shrink_all_memory(unsigned long nr_to_reclaim)
 }
 #endif /* CONFIG_HIBERNATION */
 
+/*
+ * Number of reclaim threads started per node. Multiple kswapd threads
+ * run balance_pgdat() concurrently and partition the scanning work
+ * between them through the per-node LRU machinery, which cuts reclaim
+ * latency on large-memory nodes at the price of more reclaim cpu time.
+ */
+int kswapd_threads = 1;
+
 /* It's optimal to keep kswapds on the same CPUs as their memory, but
    not required for correctness.  So if the last cpu in a node goes
    away, we get changed to run anywhere: as the first one comes back,
    restore their cpu bindings. */
 static int kswapd_cpu_online(unsigned int cpu)
 {
-	int nid;
+	int nid, i;
 
 	for_each_node_state(nid, N_MEMORY) {
 		pg_data_t *pgdat = NODE_DATA(nid);
@@ -3582,7 +3595,11 @@ static int kswapd_cpu_online(unsigned int cpu)
 
 		if (cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids)
 			/* One of our CPUs online: restore mask */
-			set_cpus_allowed_ptr(pgdat->kswapd, mask);
+			for (i = 0; i < MAX_KSWAPD_THREADS; i++)
+				if (pgdat->kswapd_threads[i])
+					set_cpus_allowed_ptr(
+						pgdat->kswapd_threads[i],
+						mask);
 	}
 	return 0;
 }
@@ -3590,38 +3607,89 @@ static int kswapd_cpu_online(unsigned int cpu)
 /*
  * This kswapd start function will be called by init and node-hot-add.
  * On node-hot-add, kswapd will moved to proper cpus if cpus are hot-added.
+ *
+ * Threads that already run are left alone, so this is also used to start
+ * the additional workers when vm.kswapd_threads is raised.
  */
 int kswapd_run(int nid)
 {
 	pg_data_t *pgdat = NODE_DATA(nid);
-	int ret = 0;
+	struct task_struct *t;
+	int i, ret = 0;
 
-	if (pgdat->kswapd)
-		return 0;
+	for (i = 0; i < kswapd_threads; i++) {
+		if (pgdat->kswapd_threads[i])
+			continue;
 
-	pgdat->kswapd = kthread_run(kswapd, pgdat, "kswapd%d", nid);
-	if (IS_ERR(pgdat->kswapd)) {
-		/* failure at boot is fatal */
-		BUG_ON(system_state == SYSTEM_BOOTING);
-		pr_err("Failed to start kswapd on node %d\n", nid);
-		ret = PTR_ERR(pgdat->kswapd);
-		pgdat->kswapd = NULL;
+		if (i == 0)
+			t = kthread_run(kswapd, pgdat, "kswapd%d", nid);
+		else
+			t = kthread_run(kswapd, pgdat, "kswapd%d_%d", nid, i);
+		if (IS_ERR(t)) {
+			/* failure at boot is fatal */
+			BUG_ON(system_state == SYSTEM_BOOTING);
+			pr_err("Failed to start kswapd%d_%d on node %d\n",
+			       nid, i, nid);
+			ret = PTR_ERR(t);
+			break;
+		}
+		pgdat->kswapd_threads[i] = t;
 	}
+	pgdat->kswapd = pgdat->kswapd_threads[0];
 	return ret;
 }
 
+/*
+ * Stop the kswapd threads of a node from slot @from upwards. Callers
+ * must hold mem_hotplug_begin/end().
+ */
+static void kswapd_stop_from(int nid, int from)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int i;
+
+	for (i = from; i < MAX_KSWAPD_THREADS; i++) {
+		if (!pgdat->kswapd_threads[i])
+			continue;
+		kthread_stop(pgdat->kswapd_threads[i]);
+		pgdat->kswapd_threads[i] = NULL;
+	}
+	pgdat->kswapd = from ? pgdat->kswapd_threads[0] : NULL;
+}
+
 /*
  * Called by memory hotplug when all memory in a node is offlined.  Caller must
  * hold mem_hotplug_begin/end().
  */
 void kswapd_stop(int nid)
 {
-	struct task_struct *kswapd = NODE_DATA(nid)->kswapd;
+	kswapd_stop_from(nid, 0);
+}
+
+/*
+ * sysctl handler for vm.kswapd_threads; starts or stops per-node reclaim
+ * workers to match the new value.
+ */
+int kswapd_threads_sysctl_handler(struct ctl_table *table, int write,
+	void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int old = kswapd_threads;
+	int nid, ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write || kswapd_threads == old)
+		return ret;
 
-	if (kswapd) {
-		kthread_stop(kswapd);
-		NODE_DATA(nid)->kswapd = NULL;
+	mem_hotplug_begin();
+	for_each_node_state(nid, N_MEMORY) {
+		if (kswapd_threads > old)
+			kswapd_run(nid);
+		else
+			kswapd_stop_from(nid, kswapd_threads);
 	}
+	mem_hotplug_end();
+
+	return 0;
 }
 
 static int __init kswapd_init(void)
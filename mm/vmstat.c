@@ -886,6 +886,24 @@ static int __fragmentation_index(unsigned int order, struct contig_page_info *in
 	return 1000 - div_u64( (1000+(div_u64(info->free_pages * 1000ULL, requested))), info->free_blocks_total);
 }
 
+/*
+ * Calculates external fragmentation within a zone wrt the given order.
+ * It is defined as the percentage of pages found in blocks of size
+ * less than 1 << order. It returns values in range [0, 100].
+ */
+unsigned int extfrag_for_order(struct zone *zone, unsigned int order)
+{
+	struct contig_page_info info;
+
+	fill_contig_page_info(zone, order, &info);
+	if (info.free_pages == 0)
+		return 0;
+
+	return div_u64((info.free_pages -
+			(info.free_blocks_suitable << order)) * 100,
+			info.free_pages);
+}
+
 /* Same as __fragmentation index but allocs contig_page_info on stack */
 int fragmentation_index(struct zone *zone, unsigned int order)
 {
@@ -995,6 +1013,7 @@ const char * const vmstat_text[] = {
 
 	"pgfault",
 	"pgmajfault",
+	"pglazyfree",
 	"pglazyfreed",
 
 	"pgrefill",
@@ -1051,6 +1070,9 @@ const char * const vmstat_text[] = {
 	"unevictable_pgs_munlocked",
 	"unevictable_pgs_cleared",
 	"unevictable_pgs_stranded",
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	"speculative_pgfault",
+#endif
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	"thp_fault_alloc",
@@ -1462,25 +1484,25 @@ enum writeback_stat_item {
 	NR_VM_WRITEBACK_STAT_ITEMS,
 };
 
-static void *vmstat_start(struct seq_file *m, loff_t *pos)
-{
-	unsigned long *v;
-	int i, stat_items_size;
-
-	if (*pos >= ARRAY_SIZE(vmstat_text))
-		return NULL;
-	stat_items_size = NR_VM_ZONE_STAT_ITEMS * sizeof(unsigned long) +
-			  NR_VM_NODE_STAT_ITEMS * sizeof(unsigned long) +
-			  NR_VM_WRITEBACK_STAT_ITEMS * sizeof(unsigned long);
+/*
+ * Folded snapshot of all vmstat counters, in /proc/vmstat order, published
+ * for readers.  Folding the counters - the vm events in particular - walks
+ * a cacheline on every possible cpu, which is too expensive to repeat for
+ * every read when monitoring daemons poll /proc/vmstat once a second on
+ * large machines.  The shepherd refreshes the snapshot once per
+ * sysctl_stat_interval instead, and readers just copy it, retrying on the
+ * seqcount if they race with a fold.
+ */
+static unsigned long vmstat_snapshot[ARRAY_SIZE(vmstat_text)];
+static unsigned long vmstat_snapshot_stage[ARRAY_SIZE(vmstat_text)];
+static seqcount_t vmstat_snapshot_seq = SEQCNT_ZERO(vmstat_snapshot_seq);
+static DEFINE_MUTEX(vmstat_snapshot_lock);
+static unsigned long vmstat_snapshot_jiffies = INITIAL_JIFFIES - HZ;
 
-#ifdef CONFIG_VM_EVENT_COUNTERS
-	stat_items_size += sizeof(struct vm_event_state);
-#endif
+static void vmstat_fold_snapshot(unsigned long *v)
+{
+	int i;
 
-	v = kmalloc(stat_items_size, GFP_KERNEL);
-	m->private = v;
-	if (!v)
-		return ERR_PTR(-ENOMEM);
 	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
 		v[i] = global_page_state(i);
 	v += NR_VM_ZONE_STAT_ITEMS;
@@ -1498,7 +1520,70 @@ static void *vmstat_start(struct seq_file *m, loff_t *pos)
 	v[PGPGIN] /= 2;		/* sectors -> kbytes */
 	v[PGPGOUT] /= 2;
 #endif
-	return (unsigned long *)m->private + *pos;
+}
+
+static void vmstat_publish_snapshot(void)
+{
+	mutex_lock(&vmstat_snapshot_lock);
+	/*
+	 * Fold into the staging buffer first so that the seqcount write
+	 * section, which readers spin on, covers only the copy and not
+	 * the walk over all cpus.
+	 */
+	vmstat_fold_snapshot(vmstat_snapshot_stage);
+
+	write_seqcount_begin(&vmstat_snapshot_seq);
+	memcpy(vmstat_snapshot, vmstat_snapshot_stage,
+	       sizeof(vmstat_snapshot));
+	write_seqcount_end(&vmstat_snapshot_seq);
+
+	vmstat_snapshot_jiffies = jiffies;
+	mutex_unlock(&vmstat_snapshot_lock);
+}
+
+/*
+ * Bring the snapshot up to date if nothing has folded it for a stat
+ * interval: before the shepherd has run for the first time, or when it is
+ * not compiled in (!SMP).
+ */
+static void vmstat_refresh_snapshot(void)
+{
+	unsigned long interval = HZ;
+
+#ifdef CONFIG_SMP
+	interval = sysctl_stat_interval;
+#endif
+	if (time_before(jiffies,
+			READ_ONCE(vmstat_snapshot_jiffies) + interval))
+		return;
+	vmstat_publish_snapshot();
+}
+
+static void vmstat_read_snapshot(unsigned long *v)
+{
+	unsigned int seq;
+
+	vmstat_refresh_snapshot();
+	do {
+		seq = read_seqcount_begin(&vmstat_snapshot_seq);
+		memcpy(v, vmstat_snapshot, sizeof(vmstat_snapshot));
+	} while (read_seqcount_retry(&vmstat_snapshot_seq, seq));
+}
+
+static void *vmstat_start(struct seq_file *m, loff_t *pos)
+{
+	unsigned long *v;
+
+	if (*pos >= ARRAY_SIZE(vmstat_text))
+		return NULL;
+
+	v = kmalloc(sizeof(vmstat_snapshot), GFP_KERNEL);
+	m->private = v;
+	if (!v)
+		return ERR_PTR(-ENOMEM);
+
+	vmstat_read_snapshot(v);
+	return v + *pos;
 }
 
 static void *vmstat_next(struct seq_file *m, void *arg, loff_t *pos)
@@ -1544,6 +1629,38 @@ static const struct file_operations proc_vmstat_file_operations = {
 	.llseek		= seq_lseek,
 	.release	= seq_release,
 };
+
+/*
+ * Binary companion to /proc/vmstat: a read() returns the whole snapshot
+ * as an array of unsigned long, one element per line of /proc/vmstat in
+ * the same order.  Batch consumers resolve their indices from the text
+ * file once and then fetch every counter with a single syscall.
+ */
+static ssize_t vmstat_snapshot_read(struct file *file, char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	unsigned long *v;
+	ssize_t ret;
+
+	v = kmalloc(sizeof(vmstat_snapshot), GFP_KERNEL);
+	if (!v)
+		return -ENOMEM;
+
+	vmstat_read_snapshot(v);
+	ret = simple_read_from_buffer(buf, count, ppos, v,
+				      sizeof(vmstat_snapshot));
+	kfree(v);
+	return ret;
+}
+
+static const struct file_operations proc_vmstat_snapshot_file_operations = {
+	.read		= vmstat_snapshot_read,
+	.llseek		= default_llseek,
+};
+#else /* CONFIG_PROC_FS */
+static inline void vmstat_publish_snapshot(void)
+{
+}
 #endif /* CONFIG_PROC_FS */
 
 #ifdef CONFIG_SMP
@@ -1579,6 +1696,7 @@ int vmstat_refresh(struct ctl_table *table, int write,
 	err = schedule_on_each_cpu(refresh_vm_stats);
 	if (err)
 		return err;
+	vmstat_publish_snapshot();
 	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++) {
 		val = atomic_long_read(&vm_zone_stat[i]);
 		if (val < 0) {
@@ -1701,6 +1819,9 @@ static void vmstat_shepherd(struct work_struct *w)
 	}
 	put_online_cpus();
 
+	/* Republish the folded snapshot for /proc/vmstat readers */
+	vmstat_publish_snapshot();
+
 	schedule_delayed_work(&shepherd,
 		round_jiffies_relative(sysctl_stat_interval));
 }
@@ -1785,6 +1906,8 @@ static int __init setup_vmstat(void)
 	proc_create("buddyinfo", S_IRUGO, NULL, &fragmentation_file_operations);
 	proc_create("pagetypeinfo", S_IRUGO, NULL, &pagetypeinfo_file_ops);
 	proc_create("vmstat", S_IRUGO, NULL, &proc_vmstat_file_operations);
+	proc_create("vmstat_snapshot", S_IRUGO, NULL,
+		    &proc_vmstat_snapshot_file_operations);
 	proc_create("zoneinfo", S_IRUGO, NULL, &proc_zoneinfo_file_operations);
 #endif
 	return 0;
@@ -53,6 +53,7 @@
 #include <linux/mount.h>
 #include <linux/migrate.h>
 #include <linux/pagemap.h>
+#include <linux/nodemask.h>
 
 #define ZSPAGE_MAGIC	0x58
 
@@ -200,6 +201,8 @@ struct size_class {
 	int objs_per_zspage;
 	/* Number of PAGE_SIZE sized pages to combine to form a 'zspage' */
 	int pages_per_zspage;
+	/* NUMA node this class allocates its zspages from */
+	int node;
 
 	unsigned int index;
 	struct zs_size_stat stats;
@@ -244,6 +247,12 @@ struct link_free {
 struct zs_pool {
 	const char *name;
 
+	/*
+	 * One stripe of size classes per NUMA node; see zs_class().
+	 * Allocations are served from the stripe of the allocating
+	 * CPU's node so that concurrent writers on different sockets
+	 * do not contend on the same class locks.
+	 */
 	struct size_class **size_class;
 	struct kmem_cache *handle_cachep;
 	struct kmem_cache *zspage_cachep;
@@ -276,6 +285,11 @@ struct zs_pool {
 #define CLASS_BITS	8
 #define ISOLATED_BITS	3
 #define MAGIC_VAL_BITS	8
+#define NODE_BITS	10
+
+#if NODES_SHIFT > NODE_BITS
+#error "zspage cannot encode the node id of its size class"
+#endif
 
 struct zspage {
 	struct {
@@ -283,6 +297,8 @@ struct zspage {
 		unsigned int class:CLASS_BITS + 1;
 		unsigned int isolated:ISOLATED_BITS;
 		unsigned int magic:MAGIC_VAL_BITS;
+		/* node of the size class stripe, not of the pages */
+		unsigned int node:NODE_BITS;
 	};
 	unsigned int inuse;
 	unsigned int freeobj;
@@ -540,6 +556,23 @@ static void set_zspage_mapping(struct zspage *zspage,
 	zspage->fullness = fullness;
 }
 
+static int get_zspage_node(struct zspage *zspage)
+{
+	return zspage->node;
+}
+
+/*
+ * Look up a size class by node and class index. Every node has its own
+ * stripe of classes; a zspage belongs to the stripe it was allocated
+ * from for its whole lifetime, no matter where page migration moves
+ * its backing pages, so zspage->node must be used for the lookup.
+ */
+static struct size_class *zs_class(struct zs_pool *pool, int node,
+				unsigned int class_idx)
+{
+	return pool->size_class[node * zs_size_classes + class_idx];
+}
+
 /*
  * zsmalloc divides the pool into various size classes where each
  * class maintains a list of zspages where each zspage is divided
@@ -599,7 +632,7 @@ static unsigned long zs_can_compact(struct size_class *class);
 
 static int zs_stats_size_show(struct seq_file *s, void *v)
 {
-	int i;
+	int i, node;
 	struct zs_pool *pool = s->private;
 	struct size_class *class;
 	int objs_per_zspage;
@@ -615,18 +648,33 @@ static int zs_stats_size_show(struct seq_file *s, void *v)
 			"pages_per_zspage", "freeable");
 
 	for (i = 0; i < zs_size_classes; i++) {
-		class = pool->size_class[i];
+		/*
+		 * Class merging depends only on the size geometry, so the
+		 * merge pattern is identical on every node: check stripe 0
+		 * and sum the per-node stripes of each unmerged class.
+		 */
+		class = zs_class(pool, 0, i);
 
 		if (class->index != i)
 			continue;
 
-		spin_lock(&class->lock);
-		class_almost_full = zs_stat_get(class, CLASS_ALMOST_FULL);
-		class_almost_empty = zs_stat_get(class, CLASS_ALMOST_EMPTY);
-		obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
-		obj_used = zs_stat_get(class, OBJ_USED);
-		freeable = zs_can_compact(class);
-		spin_unlock(&class->lock);
+		class_almost_full = 0;
+		class_almost_empty = 0;
+		obj_allocated = 0;
+		obj_used = 0;
+		freeable = 0;
+
+		for (node = 0; node < nr_node_ids; node++) {
+			struct size_class *nc = zs_class(pool, node, i);
+
+			spin_lock(&nc->lock);
+			class_almost_full += zs_stat_get(nc, CLASS_ALMOST_FULL);
+			class_almost_empty += zs_stat_get(nc, CLASS_ALMOST_EMPTY);
+			obj_allocated += zs_stat_get(nc, OBJ_ALLOCATED);
+			obj_used += zs_stat_get(nc, OBJ_USED);
+			freeable += zs_can_compact(nc);
+			spin_unlock(&nc->lock);
+		}
 
 		objs_per_zspage = class->objs_per_zspage;
 		pages_used = obj_allocated / objs_per_zspage *
@@ -1122,12 +1170,18 @@ static struct zspage *alloc_zspage(struct zs_pool *pool,
 
 	memset(zspage, 0, sizeof(struct zspage));
 	zspage->magic = ZSPAGE_MAGIC;
+	zspage->node = class->node;
 	migrate_lock_init(zspage);
 
 	for (i = 0; i < class->pages_per_zspage; i++) {
 		struct page *page;
 
-		page = alloc_page(gfp);
+		/*
+		 * Prefer the class's node, but accept remote pages: the
+		 * stripe membership is recorded in the zspage, so falling
+		 * back only costs locality, not correctness.
+		 */
+		page = alloc_pages_node(class->node, gfp, 0);
 		if (!page) {
 			while (--i >= 0) {
 				dec_zone_page_state(pages[i], NR_ZSPAGES);
@@ -1380,7 +1434,7 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 	migrate_read_lock(zspage);
 
 	get_zspage_mapping(zspage, &class_idx, &fg);
-	class = pool->size_class[class_idx];
+	class = zs_class(pool, get_zspage_node(zspage), class_idx);
 	off = (class->size * obj_idx) & ~PAGE_MASK;
 
 	area = &get_cpu_var(zs_map_area);
@@ -1422,7 +1476,7 @@ void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 	obj_to_location(obj, &page, &obj_idx);
 	zspage = get_zspage(page);
 	get_zspage_mapping(zspage, &class_idx, &fg);
-	class = pool->size_class[class_idx];
+	class = zs_class(pool, get_zspage_node(zspage), class_idx);
 	off = (class->size * obj_idx) & ~PAGE_MASK;
 
 	area = this_cpu_ptr(&zs_map_area);
@@ -1512,7 +1566,7 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp)
 
 	/* extra space in chunk to keep the handle */
 	size += ZS_HANDLE_SIZE;
-	class = pool->size_class[get_size_class_index(size)];
+	class = zs_class(pool, numa_node_id(), get_size_class_index(size));
 
 	spin_lock(&class->lock);
 	zspage = find_get_zspage(class);
@@ -1599,7 +1653,7 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	migrate_read_lock(zspage);
 
 	get_zspage_mapping(zspage, &class_idx, &fullness);
-	class = pool->size_class[class_idx];
+	class = zs_class(pool, get_zspage_node(zspage), class_idx);
 
 	spin_lock(&class->lock);
 	obj_free(class, obj);
@@ -1945,7 +1999,7 @@ bool zs_page_isolate(struct page *page, isolate_mode_t mode)
 	get_zspage_mapping(zspage, &class_idx, &fullness);
 	mapping = page_mapping(page);
 	pool = mapping->private_data;
-	class = pool->size_class[class_idx];
+	class = zs_class(pool, get_zspage_node(zspage), class_idx);
 
 	spin_lock(&class->lock);
 	if (get_zspage_inuse(zspage) == 0) {
@@ -1999,7 +2053,7 @@ int zs_page_migrate(struct address_space *mapping, struct page *newpage,
 	migrate_write_lock(zspage);
 	get_zspage_mapping(zspage, &class_idx, &fullness);
 	pool = mapping->private_data;
-	class = pool->size_class[class_idx];
+	class = zs_class(pool, get_zspage_node(zspage), class_idx);
 	offset = get_first_obj_offset(page);
 
 	spin_lock(&class->lock);
@@ -2096,7 +2150,7 @@ void zs_page_putback(struct page *page)
 	get_zspage_mapping(zspage, &class_idx, &fg);
 	mapping = page_mapping(page);
 	pool = mapping->private_data;
-	class = pool->size_class[class_idx];
+	class = zs_class(pool, get_zspage_node(zspage), class_idx);
 
 	spin_lock(&class->lock);
 	dec_zspage_isolation(zspage);
@@ -2143,7 +2197,7 @@ static void zs_unregister_migration(struct zs_pool *pool)
  */
 static void async_free_zspage(struct work_struct *work)
 {
-	int i;
+	int i, node;
 	struct size_class *class;
 	unsigned int class_idx;
 	enum fullness_group fullness;
@@ -2152,26 +2206,28 @@ static void async_free_zspage(struct work_struct *work)
 	struct zs_pool *pool = container_of(work, struct zs_pool,
 					free_work);
 
-	for (i = 0; i < zs_size_classes; i++) {
-		class = pool->size_class[i];
-		if (class->index != i)
-			continue;
+	for (node = 0; node < nr_node_ids; node++) {
+		for (i = 0; i < zs_size_classes; i++) {
+			class = zs_class(pool, node, i);
+			if (class->index != i)
+				continue;
 
-		spin_lock(&class->lock);
-		list_splice_init(&class->fullness_list[ZS_EMPTY], &free_pages);
-		spin_unlock(&class->lock);
+			spin_lock(&class->lock);
+			list_splice_init(&class->fullness_list[ZS_EMPTY],
+					&free_pages);
+			spin_unlock(&class->lock);
+		}
 	}
 
-
 	list_for_each_entry_safe(zspage, tmp, &free_pages, list) {
 		list_del(&zspage->list);
 		lock_zspage(zspage);
 
 		get_zspage_mapping(zspage, &class_idx, &fullness);
 		VM_BUG_ON(fullness != ZS_EMPTY);
-		class = pool->size_class[class_idx];
+		class = zs_class(pool, get_zspage_node(zspage), class_idx);
 		spin_lock(&class->lock);
-		__free_zspage(pool, pool->size_class[class_idx], zspage);
+		__free_zspage(pool, class, zspage);
 		spin_unlock(&class->lock);
 	}
 };
@@ -2267,16 +2323,18 @@ static void __zs_compact(struct zs_pool *pool, struct size_class *class)
 
 unsigned long zs_compact(struct zs_pool *pool)
 {
-	int i;
+	int i, node;
 	struct size_class *class;
 
-	for (i = zs_size_classes - 1; i >= 0; i--) {
-		class = pool->size_class[i];
-		if (!class)
-			continue;
-		if (class->index != i)
-			continue;
-		__zs_compact(pool, class);
+	for (node = 0; node < nr_node_ids; node++) {
+		for (i = zs_size_classes - 1; i >= 0; i--) {
+			class = zs_class(pool, node, i);
+			if (!class)
+				continue;
+			if (class->index != i)
+				continue;
+			__zs_compact(pool, class);
+		}
 	}
 
 	return pool->stats.pages_compacted;
@@ -2310,20 +2368,22 @@ static unsigned long zs_shrinker_scan(struct shrinker *shrinker,
 static unsigned long zs_shrinker_count(struct shrinker *shrinker,
 		struct shrink_control *sc)
 {
-	int i;
+	int i, node;
 	struct size_class *class;
 	unsigned long pages_to_free = 0;
 	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
 			shrinker);
 
-	for (i = zs_size_classes - 1; i >= 0; i--) {
-		class = pool->size_class[i];
-		if (!class)
-			continue;
-		if (class->index != i)
-			continue;
+	for (node = 0; node < nr_node_ids; node++) {
+		for (i = zs_size_classes - 1; i >= 0; i--) {
+			class = zs_class(pool, node, i);
+			if (!class)
+				continue;
+			if (class->index != i)
+				continue;
 
-		pages_to_free += zs_can_compact(class);
+			pages_to_free += zs_can_compact(class);
+		}
 	}
 
 	return pages_to_free;
@@ -2359,17 +2419,16 @@ static int zs_register_shrinker(struct zs_pool *pool)
  */
 struct zs_pool *zs_create_pool(const char *name)
 {
-	int i;
+	int i, node;
 	struct zs_pool *pool;
-	struct size_class *prev_class = NULL;
 
 	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
 	if (!pool)
 		return NULL;
 
 	init_deferred_free(pool);
-	pool->size_class = kcalloc(zs_size_classes, sizeof(struct size_class *),
-			GFP_KERNEL);
+	pool->size_class = kcalloc(nr_node_ids * zs_size_classes,
+			sizeof(struct size_class *), GFP_KERNEL);
 	if (!pool->size_class) {
 		kfree(pool);
 		return NULL;
@@ -2383,53 +2442,60 @@ struct zs_pool *zs_create_pool(const char *name)
 		goto err;
 
 	/*
+	 * Create one stripe of size classes for every node.
+	 *
 	 * Iterate reversly, because, size of size_class that we want to use
 	 * for merging should be larger or equal to current size.
 	 */
-	for (i = zs_size_classes - 1; i >= 0; i--) {
-		int size;
-		int pages_per_zspage;
-		int objs_per_zspage;
-		struct size_class *class;
-		int fullness = 0;
-
-		size = ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA;
-		if (size > ZS_MAX_ALLOC_SIZE)
-			size = ZS_MAX_ALLOC_SIZE;
-		pages_per_zspage = get_pages_per_zspage(size);
-		objs_per_zspage = pages_per_zspage * PAGE_SIZE / size;
+	for (node = 0; node < nr_node_ids; node++) {
+		struct size_class *prev_class = NULL;
+
+		for (i = zs_size_classes - 1; i >= 0; i--) {
+			int size;
+			int pages_per_zspage;
+			int objs_per_zspage;
+			struct size_class *class;
+			int fullness = 0;
+
+			size = ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA;
+			if (size > ZS_MAX_ALLOC_SIZE)
+				size = ZS_MAX_ALLOC_SIZE;
+			pages_per_zspage = get_pages_per_zspage(size);
+			objs_per_zspage = pages_per_zspage * PAGE_SIZE / size;
 
-		/*
-		 * size_class is used for normal zsmalloc operation such
-		 * as alloc/free for that size. Although it is natural that we
-		 * have one size_class for each size, there is a chance that we
-		 * can get more memory utilization if we use one size_class for
-		 * many different sizes whose size_class have same
-		 * characteristics. So, we makes size_class point to
-		 * previous size_class if possible.
-		 */
-		if (prev_class) {
-			if (can_merge(prev_class, pages_per_zspage, objs_per_zspage)) {
-				pool->size_class[i] = prev_class;
-				continue;
+			/*
+			 * size_class is used for normal zsmalloc operation such
+			 * as alloc/free for that size. Although it is natural that we
+			 * have one size_class for each size, there is a chance that we
+			 * can get more memory utilization if we use one size_class for
+			 * many different sizes whose size_class have same
+			 * characteristics. So, we makes size_class point to
+			 * previous size_class if possible.
+			 */
+			if (prev_class) {
+				if (can_merge(prev_class, pages_per_zspage, objs_per_zspage)) {
+					pool->size_class[node * zs_size_classes + i] = prev_class;
+					continue;
+				}
 			}
-		}
 
-		class = kzalloc(sizeof(struct size_class), GFP_KERNEL);
-		if (!class)
-			goto err;
-
-		class->size = size;
-		class->index = i;
-		class->pages_per_zspage = pages_per_zspage;
-		class->objs_per_zspage = objs_per_zspage;
-		spin_lock_init(&class->lock);
-		pool->size_class[i] = class;
-		for (fullness = ZS_EMPTY; fullness < NR_ZS_FULLNESS;
-							fullness++)
-			INIT_LIST_HEAD(&class->fullness_list[fullness]);
-
-		prev_class = class;
+			class = kzalloc(sizeof(struct size_class), GFP_KERNEL);
+			if (!class)
+				goto err;
+
+			class->size = size;
+			class->index = i;
+			class->pages_per_zspage = pages_per_zspage;
+			class->objs_per_zspage = objs_per_zspage;
+			class->node = node;
+			spin_lock_init(&class->lock);
+			pool->size_class[node * zs_size_classes + i] = class;
+			for (fullness = ZS_EMPTY; fullness < NR_ZS_FULLNESS;
+								fullness++)
+				INIT_LIST_HEAD(&class->fullness_list[fullness]);
+
+			prev_class = class;
+		}
 	}
 
 	/* debug only, don't abort if it fails */
@@ -2454,29 +2520,31 @@ EXPORT_SYMBOL_GPL(zs_create_pool);
 
 void zs_destroy_pool(struct zs_pool *pool)
 {
-	int i;
+	int i, node;
 
 	zs_unregister_shrinker(pool);
 	zs_unregister_migration(pool);
 	zs_pool_stat_destroy(pool);
 
-	for (i = 0; i < zs_size_classes; i++) {
-		int fg;
-		struct size_class *class = pool->size_class[i];
+	for (node = 0; node < nr_node_ids; node++) {
+		for (i = 0; i < zs_size_classes; i++) {
+			int fg;
+			struct size_class *class = zs_class(pool, node, i);
 
-		if (!class)
-			continue;
+			if (!class)
+				continue;
 
-		if (class->index != i)
-			continue;
+			if (class->index != i)
+				continue;
 
-		for (fg = ZS_EMPTY; fg < NR_ZS_FULLNESS; fg++) {
-			if (!list_empty(&class->fullness_list[fg])) {
-				pr_info("Freeing non-empty class with size %db, fullness group %d\n",
-					class->size, fg);
+			for (fg = ZS_EMPTY; fg < NR_ZS_FULLNESS; fg++) {
+				if (!list_empty(&class->fullness_list[fg])) {
+					pr_info("Freeing non-empty class with size %db, fullness group %d\n",
+						class->size, fg);
+				}
 			}
+			kfree(class);
 		}
-		kfree(class);
 	}
 
 	destroy_cache(pool);
@@ -33,8 +33,10 @@
 #include <linux/rbtree.h>
 #include <linux/swap.h>
 #include <linux/crypto.h>
+#include <linux/scatterlist.h>
 #include <linux/mempool.h>
 #include <linux/zpool.h>
+#include <crypto/acompress.h>
 
 #include <linux/mm_types.h>
 #include <linux/page-flags.h>
@@ -71,6 +73,8 @@ static u64 zswap_reject_alloc_fail;
 static u64 zswap_reject_kmemcache_fail;
 /* Duplicate store was encountered (rare) */
 static u64 zswap_duplicate_entry;
+/* The number of same-filled pages currently stored in zswap */
+static atomic_t zswap_same_filled_pages = ATOMIC_INIT(0);
 
 /*********************************
 * tunables
@@ -114,13 +118,36 @@ module_param_cb(zpool, &zswap_zpool_param_ops, &zswap_zpool_type, 0644);
 static unsigned int zswap_max_pool_percent = 20;
 module_param_named(max_pool_percent, zswap_max_pool_percent, uint, 0644);
 
+/* Store pages filled with a single repeating value without compressing them */
+static bool zswap_same_filled_pages_enabled = true;
+module_param_named(same_filled_pages_enabled, zswap_same_filled_pages_enabled,
+		   bool, 0644);
+
 /*********************************
 * data structures
 **********************************/
 
+/*
+ * Per-cpu compression state.  The acomp interface takes scatterlists and
+ * may complete asynchronously, which lets hardware compression engines
+ * and batching SIMD implementations serve zswap; software algorithms are
+ * wrapped by the crypto layer and complete inline.  The request is
+ * serialized by the per-cpu zswap_mutex (shared with the dstmem buffer),
+ * so a store or load may sleep waiting for completion without pinning
+ * the cpu.
+ */
+struct zswap_comp_ctx {
+	struct crypto_acomp *acomp;
+	struct acomp_req *req;
+	struct completion done;
+	int err;
+	struct mutex *lock;	/* per-cpu, shared with zswap_dstmem */
+	u8 *dstmem;
+};
+
 struct zswap_pool {
 	struct zpool *zpool;
-	struct crypto_comp * __percpu *tfm;
+	struct zswap_comp_ctx __percpu *ctx;
 	struct kref kref;
 	struct list_head list;
 	struct work_struct work;
@@ -143,9 +170,11 @@ struct zswap_pool {
  *            be held while changing the refcount.  Since the lock must
  *            be held, there is no reason to also make refcount atomic.
  * length - the length in bytes of the compressed page data.  Needed during
- *          decompression
+ *          decompression.  For a same-filled page length is 0, no data is
+ *          stored in the zpool, and pool is NULL.
  * pool - the zswap_pool the entry's data is in
  * handle - zpool allocation handle that stores the compressed page data
+ * value - value of the same-filled pages which have same content
  */
 struct zswap_entry {
 	struct rb_node rbnode;
@@ -153,7 +182,10 @@ struct zswap_entry {
 	int refcount;
 	unsigned int length;
 	struct zswap_pool *pool;
-	unsigned long handle;
+	union {
+		unsigned long handle;
+		unsigned long value;
+	};
 };
 
 struct zswap_header {
@@ -315,8 +347,12 @@ static void zswap_rb_erase(struct rb_root *root, struct zswap_entry *entry)
  */
 static void zswap_free_entry(struct zswap_entry *entry)
 {
-	zpool_free(entry->pool->zpool, entry->handle);
-	zswap_pool_put(entry->pool);
+	if (!entry->length) {
+		atomic_dec(&zswap_same_filled_pages);
+	} else {
+		zpool_free(entry->pool->zpool, entry->handle);
+		zswap_pool_put(entry->pool);
+	}
 	zswap_entry_cache_free(entry);
 	atomic_dec(&zswap_stored_pages);
 	zswap_update_total_size();
@@ -360,9 +396,11 @@ static struct zswap_entry *zswap_entry_find_get(struct rb_root *root,
 * per-cpu code
 **********************************/
 static DEFINE_PER_CPU(u8 *, zswap_dstmem);
+static DEFINE_PER_CPU(struct mutex *, zswap_mutex);
 
 static int zswap_dstmem_prepare(unsigned int cpu)
 {
+	struct mutex *mutex;
 	u8 *dst;
 
 	dst = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL, cpu_to_node(cpu));
@@ -370,48 +408,103 @@ static int zswap_dstmem_prepare(unsigned int cpu)
 		pr_err("can't allocate compressor buffer\n");
 		return -ENOMEM;
 	}
+
+	mutex = kmalloc_node(sizeof(*mutex), GFP_KERNEL, cpu_to_node(cpu));
+	if (!mutex) {
+		kfree(dst);
+		return -ENOMEM;
+	}
+	mutex_init(mutex);
+
 	per_cpu(zswap_dstmem, cpu) = dst;
+	per_cpu(zswap_mutex, cpu) = mutex;
 	return 0;
 }
 
 static int zswap_dstmem_dead(unsigned int cpu)
 {
-	u8 *dst;
-
-	dst = per_cpu(zswap_dstmem, cpu);
-	kfree(dst);
+	kfree(per_cpu(zswap_mutex, cpu));
+	per_cpu(zswap_mutex, cpu) = NULL;
+	kfree(per_cpu(zswap_dstmem, cpu));
 	per_cpu(zswap_dstmem, cpu) = NULL;
 
 	return 0;
 }
 
+static void zswap_comp_done(struct crypto_async_request *req, int err)
+{
+	struct zswap_comp_ctx *ctx = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+	ctx->err = err;
+	complete(&ctx->done);
+}
+
+/*
+ * Wait for an asynchronously completing (de)compression.  Software
+ * algorithms return their result directly; hardware engines return
+ * -EINPROGRESS (or -EBUSY once backlogged) and signal the per-cpu
+ * completion from their interrupt handler.
+ */
+static int zswap_comp_op(struct zswap_comp_ctx *ctx, int ret)
+{
+	if (ret == -EINPROGRESS || ret == -EBUSY) {
+		wait_for_completion(&ctx->done);
+		reinit_completion(&ctx->done);
+		ret = ctx->err;
+	}
+	return ret;
+}
+
 static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
-	struct crypto_comp *tfm;
+	struct zswap_comp_ctx *ctx = per_cpu_ptr(pool->ctx, cpu);
+	struct crypto_acomp *acomp;
+	struct acomp_req *req;
 
-	if (WARN_ON(*per_cpu_ptr(pool->tfm, cpu)))
+	if (WARN_ON(ctx->acomp))
 		return 0;
 
-	tfm = crypto_alloc_comp(pool->tfm_name, 0, 0);
-	if (IS_ERR_OR_NULL(tfm)) {
-		pr_err("could not alloc crypto comp %s : %ld\n",
-		       pool->tfm_name, PTR_ERR(tfm));
+	acomp = crypto_alloc_acomp(pool->tfm_name, 0, 0);
+	if (IS_ERR_OR_NULL(acomp)) {
+		pr_err("could not alloc crypto acomp %s : %ld\n",
+		       pool->tfm_name, PTR_ERR(acomp));
 		return -ENOMEM;
 	}
-	*per_cpu_ptr(pool->tfm, cpu) = tfm;
+
+	req = acomp_request_alloc(acomp);
+	if (!req) {
+		pr_err("could not alloc crypto acomp_request %s\n",
+		       pool->tfm_name);
+		crypto_free_acomp(acomp);
+		return -ENOMEM;
+	}
+
+	init_completion(&ctx->done);
+	acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG |
+				   CRYPTO_TFM_REQ_MAY_SLEEP,
+				   zswap_comp_done, ctx);
+
+	ctx->acomp = acomp;
+	ctx->req = req;
+	ctx->lock = per_cpu(zswap_mutex, cpu);
+	ctx->dstmem = per_cpu(zswap_dstmem, cpu);
 	return 0;
 }
 
 static int zswap_cpu_comp_dead(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
-	struct crypto_comp *tfm;
+	struct zswap_comp_ctx *ctx = per_cpu_ptr(pool->ctx, cpu);
 
-	tfm = *per_cpu_ptr(pool->tfm, cpu);
-	if (!IS_ERR_OR_NULL(tfm))
-		crypto_free_comp(tfm);
-	*per_cpu_ptr(pool->tfm, cpu) = NULL;
+	if (!IS_ERR_OR_NULL(ctx->acomp)) {
+		acomp_request_free(ctx->req);
+		crypto_free_acomp(ctx->acomp);
+	}
+	ctx->acomp = NULL;
+	ctx->req = NULL;
 	return 0;
 }
 
@@ -512,8 +605,8 @@ static struct zswap_pool *zswap_pool_create(char *type, char *compressor)
 	pr_debug("using %s zpool\n", zpool_get_type(pool->zpool));
 
 	strlcpy(pool->tfm_name, compressor, sizeof(pool->tfm_name));
-	pool->tfm = alloc_percpu(struct crypto_comp *);
-	if (!pool->tfm) {
+	pool->ctx = alloc_percpu(struct zswap_comp_ctx);
+	if (!pool->ctx) {
 		pr_err("percpu alloc failed\n");
 		goto error;
 	}
@@ -535,7 +628,7 @@ static struct zswap_pool *zswap_pool_create(char *type, char *compressor)
 	return pool;
 
 error:
-	free_percpu(pool->tfm);
+	free_percpu(pool->ctx);
 	if (pool->zpool)
 		zpool_destroy_pool(pool->zpool);
 	kfree(pool);
@@ -544,7 +637,7 @@ error:
 
 static __init struct zswap_pool *__zswap_pool_create_fallback(void)
 {
-	if (!crypto_has_comp(zswap_compressor, 0, 0)) {
+	if (!crypto_has_acomp(zswap_compressor, 0, 0)) {
 		if (!strcmp(zswap_compressor, ZSWAP_COMPRESSOR_DEFAULT)) {
 			pr_err("default compressor %s not available\n",
 			       zswap_compressor);
@@ -575,7 +668,7 @@ static void zswap_pool_destroy(struct zswap_pool *pool)
 	zswap_pool_debug("destroying", pool);
 
 	cpuhp_state_remove_instance(CPUHP_MM_ZSWP_POOL_PREPARE, &pool->node);
-	free_percpu(pool->tfm);
+	free_percpu(pool->ctx);
 	zpool_destroy_pool(pool->zpool);
 	kfree(pool);
 }
@@ -655,7 +748,7 @@ static int __zswap_param_set(const char *val, const struct kernel_param *kp,
 		}
 		type = s;
 	} else if (!compressor) {
-		if (!crypto_has_comp(s, 0, 0)) {
+		if (!crypto_has_acomp(s, 0, 0)) {
 			pr_err("compressor %s not available\n", s);
 			return -ENOENT;
 		}
@@ -788,8 +881,9 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 	pgoff_t offset;
 	struct zswap_entry *entry;
 	struct page *page;
-	struct crypto_comp *tfm;
-	u8 *src, *dst;
+	struct zswap_comp_ctx *ctx;
+	struct scatterlist input, output;
+	u8 *src;
 	unsigned int dlen;
 	int ret;
 	struct writeback_control wbc = {
@@ -828,16 +922,28 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 
 	case ZSWAP_SWAPCACHE_NEW: /* page is locked */
 		/* decompress */
+		ctx = raw_cpu_ptr(entry->pool->ctx);
+		mutex_lock(ctx->lock);
 		dlen = PAGE_SIZE;
 		src = (u8 *)zpool_map_handle(entry->pool->zpool, entry->handle,
 				ZPOOL_MM_RO) + sizeof(struct zswap_header);
-		dst = kmap_atomic(page);
-		tfm = *get_cpu_ptr(entry->pool->tfm);
-		ret = crypto_comp_decompress(tfm, src, entry->length,
-					     dst, &dlen);
-		put_cpu_ptr(entry->pool->tfm);
-		kunmap_atomic(dst);
+		/*
+		 * The zpool mapping may be a per-cpu atomic one (zsmalloc)
+		 * that a scatterlist cannot describe and that must not be
+		 * held across a sleeping wait: stage the compressed data
+		 * in the per-cpu buffer instead.
+		 */
+		memcpy(ctx->dstmem, src, entry->length);
 		zpool_unmap_handle(entry->pool->zpool, entry->handle);
+
+		sg_init_one(&input, ctx->dstmem, entry->length);
+		sg_init_table(&output, 1);
+		sg_set_page(&output, page, PAGE_SIZE, 0);
+		acomp_request_set_params(ctx->req, &input, &output,
+					 entry->length, dlen);
+		ret = zswap_comp_op(ctx, crypto_acomp_decompress(ctx->req));
+		dlen = ctx->req->dlen;
+		mutex_unlock(ctx->lock);
 		BUG_ON(ret);
 		BUG_ON(dlen != PAGE_SIZE);
 
@@ -902,6 +1008,30 @@ static int zswap_shrink(void)
 	return ret;
 }
 
+static int zswap_is_page_same_filled(void *ptr, unsigned long *value)
+{
+	unsigned int pos;
+	unsigned long *page;
+
+	page = (unsigned long *)ptr;
+	for (pos = 1; pos < PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos] != page[0])
+			return 0;
+	}
+	*value = page[0];
+	return 1;
+}
+
+static void zswap_fill_page(void *ptr, unsigned long value)
+{
+	unsigned int pos;
+	unsigned long *page;
+
+	page = (unsigned long *)ptr;
+	for (pos = 0; pos < PAGE_SIZE / sizeof(*page); pos++)
+		page[pos] = value;
+}
+
 /*********************************
 * frontswap hooks
 **********************************/
@@ -911,10 +1041,11 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 {
 	struct zswap_tree *tree = zswap_trees[type];
 	struct zswap_entry *entry, *dupentry;
-	struct crypto_comp *tfm;
+	struct zswap_comp_ctx *ctx;
+	struct scatterlist input, output;
 	int ret;
 	unsigned int dlen = PAGE_SIZE, len;
-	unsigned long handle;
+	unsigned long handle, value;
 	char *buf;
 	u8 *src, *dst;
 	struct zswap_header *zhdr;
@@ -942,6 +1073,20 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 		goto reject;
 	}
 
+	if (zswap_same_filled_pages_enabled) {
+		src = kmap_atomic(page);
+		if (zswap_is_page_same_filled(src, &value)) {
+			kunmap_atomic(src);
+			entry->offset = offset;
+			entry->length = 0;
+			entry->value = value;
+			entry->pool = NULL;
+			atomic_inc(&zswap_same_filled_pages);
+			goto insert_entry;
+		}
+		kunmap_atomic(src);
+	}
+
 	/* if entry is successfully added, it keeps the reference */
 	entry->pool = zswap_pool_current_get();
 	if (!entry->pool) {
@@ -950,12 +1095,16 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	}
 
 	/* compress */
-	dst = get_cpu_var(zswap_dstmem);
-	tfm = *get_cpu_ptr(entry->pool->tfm);
-	src = kmap_atomic(page);
-	ret = crypto_comp_compress(tfm, src, PAGE_SIZE, dst, &dlen);
-	kunmap_atomic(src);
-	put_cpu_ptr(entry->pool->tfm);
+	ctx = raw_cpu_ptr(entry->pool->ctx);
+	mutex_lock(ctx->lock);
+
+	dst = ctx->dstmem;
+	sg_init_table(&input, 1);
+	sg_set_page(&input, page, PAGE_SIZE, 0);
+	sg_init_one(&output, dst, dlen);
+	acomp_request_set_params(ctx->req, &input, &output, PAGE_SIZE, dlen);
+	ret = zswap_comp_op(ctx, crypto_acomp_compress(ctx->req));
+	dlen = ctx->req->dlen;
 	if (ret) {
 		ret = -EINVAL;
 		goto put_dstmem;
@@ -979,13 +1128,14 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	buf = (u8 *)(zhdr + 1);
 	memcpy(buf, dst, dlen);
 	zpool_unmap_handle(entry->pool->zpool, handle);
-	put_cpu_var(zswap_dstmem);
+	mutex_unlock(ctx->lock);
 
 	/* populate entry */
 	entry->offset = offset;
 	entry->handle = handle;
 	entry->length = dlen;
 
+insert_entry:
 	/* map */
 	spin_lock(&tree->lock);
 	do {
@@ -1006,7 +1156,7 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	return 0;
 
 put_dstmem:
-	put_cpu_var(zswap_dstmem);
+	mutex_unlock(ctx->lock);
 	zswap_pool_put(entry->pool);
 freepage:
 	zswap_entry_cache_free(entry);
@@ -1023,7 +1173,8 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 {
 	struct zswap_tree *tree = zswap_trees[type];
 	struct zswap_entry *entry;
-	struct crypto_comp *tfm;
+	struct zswap_comp_ctx *ctx;
+	struct scatterlist input, output;
 	u8 *src, *dst;
 	unsigned int dlen;
 	int ret;
@@ -1038,18 +1189,33 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 	}
 	spin_unlock(&tree->lock);
 
+	if (!entry->length) {
+		dst = kmap_atomic(page);
+		zswap_fill_page(dst, entry->value);
+		kunmap_atomic(dst);
+		goto freeentry;
+	}
+
 	/* decompress */
+	ctx = raw_cpu_ptr(entry->pool->ctx);
+	mutex_lock(ctx->lock);
 	dlen = PAGE_SIZE;
 	src = (u8 *)zpool_map_handle(entry->pool->zpool, entry->handle,
 			ZPOOL_MM_RO) + sizeof(struct zswap_header);
-	dst = kmap_atomic(page);
-	tfm = *get_cpu_ptr(entry->pool->tfm);
-	ret = crypto_comp_decompress(tfm, src, entry->length, dst, &dlen);
-	put_cpu_ptr(entry->pool->tfm);
-	kunmap_atomic(dst);
+	/* stage the data as in zswap_writeback_entry() */
+	memcpy(ctx->dstmem, src, entry->length);
 	zpool_unmap_handle(entry->pool->zpool, entry->handle);
+
+	sg_init_one(&input, ctx->dstmem, entry->length);
+	sg_init_table(&output, 1);
+	sg_set_page(&output, page, PAGE_SIZE, 0);
+	acomp_request_set_params(ctx->req, &input, &output,
+				 entry->length, dlen);
+	ret = zswap_comp_op(ctx, crypto_acomp_decompress(ctx->req));
+	mutex_unlock(ctx->lock);
 	BUG_ON(ret);
 
+freeentry:
 	spin_lock(&tree->lock);
 	zswap_entry_put(tree, entry);
 	spin_unlock(&tree->lock);
@@ -1158,6 +1324,8 @@ static int __init zswap_debugfs_init(void)
 			zswap_debugfs_root, &zswap_pool_total_size);
 	debugfs_create_atomic_t("stored_pages", S_IRUGO,
 			zswap_debugfs_root, &zswap_stored_pages);
+	debugfs_create_atomic_t("same_filled_pages", S_IRUGO,
+			zswap_debugfs_root, &zswap_same_filled_pages);
 
 	return 0;
 }
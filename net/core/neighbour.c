@@ -94,11 +94,76 @@ static int neigh_blackhole(struct neighbour *neigh, struct sk_buff *skb)
 	return -ENETDOWN;
 }
 
+void neigh_hot_cache_insert(struct neigh_hot_cache *hc, struct neighbour *n)
+{
+	unsigned int i = hc->idx++ % NEIGH_HOT_CACHE_SIZE;
+	struct neighbour *prev;
+
+	neigh_hold(n);
+	prev = xchg(&hc->neigh[i], n);
+	if (prev)
+		neigh_release(prev);
+
+	/* Pairs with the barrier in neigh_hot_cache_purge(): either the
+	 * purge sees our slot, or we see ->dead and undo the insert, so
+	 * a dying entry can never stay cached and pin its device.
+	 */
+	if (unlikely(READ_ONCE(n->dead)))
+		neigh_hot_cache_evict(hc, i, n);
+}
+EXPORT_SYMBOL(neigh_hot_cache_insert);
+
+void neigh_hot_cache_evict(struct neigh_hot_cache *hc, unsigned int i,
+			   struct neighbour *n)
+{
+	if (cmpxchg(&hc->neigh[i], n, NULL) == n)
+		neigh_release(n);
+}
+EXPORT_SYMBOL(neigh_hot_cache_evict);
+
+static void neigh_hot_cache_purge(struct neigh_table *tbl, struct neighbour *n)
+{
+	unsigned int i;
+	int cpu;
+
+	/* pairs with the xchg in neigh_hot_cache_insert(); ->dead has
+	 * been set by the time we get here
+	 */
+	smp_mb();
+
+	for_each_possible_cpu(cpu) {
+		struct neigh_hot_cache *hc = per_cpu_ptr(tbl->hot_cache, cpu);
+
+		for (i = 0; i < NEIGH_HOT_CACHE_SIZE; i++) {
+			if (READ_ONCE(hc->neigh[i]) == n)
+				neigh_hot_cache_evict(hc, i, n);
+		}
+	}
+}
+
+static void neigh_hot_cache_flush(struct neigh_table *tbl)
+{
+	unsigned int i;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct neigh_hot_cache *hc = per_cpu_ptr(tbl->hot_cache, cpu);
+
+		for (i = 0; i < NEIGH_HOT_CACHE_SIZE; i++) {
+			struct neighbour *n = xchg(&hc->neigh[i], NULL);
+
+			if (n)
+				neigh_release(n);
+		}
+	}
+}
+
 static void neigh_cleanup_and_release(struct neighbour *neigh)
 {
 	if (neigh->parms->neigh_cleanup)
 		neigh->parms->neigh_cleanup(neigh);
 
+	neigh_hot_cache_purge(neigh->tbl, neigh);
 	__neigh_notify(neigh, RTM_DELNEIGH, 0);
 	call_netevent_notifiers(NETEVENT_NEIGH_UPDATE, neigh);
 	neigh_release(neigh);
@@ -738,11 +803,18 @@ static void neigh_connect(struct neighbour *neigh)
 	neigh->output = neigh->ops->connected_output;
 }
 
+/* number of hash buckets scanned per neigh_periodic_work() run; bounds
+ * how long the table lock is held at a time on large tables
+ */
+#define NEIGH_GC_BUCKETS	32
+
 static void neigh_periodic_work(struct work_struct *work)
 {
 	struct neigh_table *tbl = container_of(work, struct neigh_table, gc_work.work);
+	unsigned int buckets = NEIGH_GC_BUCKETS;
 	struct neighbour *n;
 	struct neighbour __rcu **np;
+	unsigned long interval;
 	unsigned int i;
 	struct neigh_hash_table *nht;
 
@@ -751,6 +823,7 @@ static void neigh_periodic_work(struct work_struct *work)
 	write_lock_bh(&tbl->lock);
 	nht = rcu_dereference_protected(tbl->nht,
 					lockdep_is_held(&tbl->lock));
+	interval = NEIGH_VAR(&tbl->parms, BASE_REACHABLE_TIME) >> 1;
 
 	/*
 	 *	periodically recompute ReachableTime from random function
@@ -767,7 +840,12 @@ static void neigh_periodic_work(struct work_struct *work)
 	if (atomic_read(&tbl->entries) < tbl->gc_thresh1)
 		goto out;
 
-	for (i = 0 ; i < (1 << nht->hash_shift); i++) {
+	/* resume where the previous run left off and scan a bounded batch
+	 * of buckets; large tables are aged over multiple runs instead of
+	 * stalling everything for one walk of the whole table
+	 */
+	while (buckets--) {
+		i = tbl->gc_bucket & ((1 << nht->hash_shift) - 1);
 		np = &nht->hash_buckets[i];
 
 		while ((n = rcu_dereference_protected(*np,
@@ -799,6 +877,12 @@ static void neigh_periodic_work(struct work_struct *work)
 next_elt:
 			np = &n->next;
 		}
+
+		if (++tbl->gc_bucket >= (1u << nht->hash_shift)) {
+			tbl->gc_bucket = 0;
+			break;
+		}
+
 		/*
 		 * It's fine to release lock here, even if hash table
 		 * grows while we are preempted.
@@ -809,13 +893,16 @@ next_elt:
 		nht = rcu_dereference_protected(tbl->nht,
 						lockdep_is_held(&tbl->lock));
 	}
+
+	/* spread one full cycle through the table over several runs */
+	interval /= DIV_ROUND_UP(1u << nht->hash_shift, NEIGH_GC_BUCKETS);
 out:
 	/* Cycle through all hash buckets every BASE_REACHABLE_TIME/2 ticks.
 	 * ARP entry timeouts range from 1/2 BASE_REACHABLE_TIME to 3/2
 	 * BASE_REACHABLE_TIME.
 	 */
 	queue_delayed_work(system_power_efficient_wq, &tbl->gc_work,
-			      NEIGH_VAR(&tbl->parms, BASE_REACHABLE_TIME) >> 1);
+			   max_t(unsigned long, interval, 1));
 	write_unlock_bh(&tbl->lock);
 }
 
@@ -1518,8 +1605,9 @@ void neigh_table_init(int index, struct neigh_table *tbl)
 
 	phsize = (PNEIGH_HASHMASK + 1) * sizeof(struct pneigh_entry *);
 	tbl->phash_buckets = kzalloc(phsize, GFP_KERNEL);
+	tbl->hot_cache = alloc_percpu(struct neigh_hot_cache);
 
-	if (!tbl->nht || !tbl->phash_buckets)
+	if (!tbl->nht || !tbl->phash_buckets || !tbl->hot_cache)
 		panic("cannot allocate neighbour cache hashes");
 
 	if (!tbl->entry_size)
@@ -1551,6 +1639,7 @@ int neigh_table_clear(int index, struct neigh_table *tbl)
 	del_timer_sync(&tbl->proxy_timer);
 	pneigh_queue_purge(&tbl->proxy_queue);
 	neigh_ifdown(tbl, NULL);
+	neigh_hot_cache_flush(tbl);
 	if (atomic_read(&tbl->entries))
 		pr_crit("neighbour leakage\n");
 
@@ -1563,6 +1652,9 @@ int neigh_table_clear(int index, struct neigh_table *tbl)
 
 	remove_proc_entry(tbl->id, init_net.proc_net_stat);
 
+	free_percpu(tbl->hot_cache);
+	tbl->hot_cache = NULL;
+
 	free_percpu(tbl->stats);
 	tbl->stats = NULL;
 
@@ -367,6 +367,105 @@ static ssize_t gro_flush_timeout_store(struct device *dev,
 }
 NETDEVICE_SHOW_RW(gro_flush_timeout, fmt_ulong);
 
+static int change_gro_udp_max_segs(struct net_device *dev, unsigned long val)
+{
+	if (val > USHRT_MAX)
+		return -ERANGE;
+
+	dev->gro_udp_max_segs = val;
+	return 0;
+}
+
+static ssize_t gro_udp_max_segs_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t len)
+{
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	return netdev_store(dev, attr, buf, len, change_gro_udp_max_segs);
+}
+NETDEVICE_SHOW_RW(gro_udp_max_segs, fmt_dec);
+
+static int change_gro_udp_max_size(struct net_device *dev, unsigned long val)
+{
+	if (val > USHRT_MAX)
+		return -ERANGE;
+
+	dev->gro_udp_max_size = val;
+	return 0;
+}
+
+static ssize_t gro_udp_max_size_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t len)
+{
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	return netdev_store(dev, attr, buf, len, change_gro_udp_max_size);
+}
+NETDEVICE_SHOW_RW(gro_udp_max_size, fmt_dec);
+
+static int change_xmit_batch(struct net_device *dev, unsigned long val)
+{
+	if (val > 1)
+		return -EINVAL;
+
+	dev->xmit_batch = val;
+	return 0;
+}
+
+static ssize_t xmit_batch_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t len)
+{
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	return netdev_store(dev, attr, buf, len, change_xmit_batch);
+}
+NETDEVICE_SHOW_RW(xmit_batch, fmt_dec);
+
+static ssize_t threaded_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct net_device *netdev = to_net_dev(dev);
+	ssize_t ret = -EINVAL;
+
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	if (dev_isalive(netdev))
+		ret = sprintf(buf, fmt_dec, netdev->threaded);
+
+	rtnl_unlock();
+	return ret;
+}
+
+static int modify_napi_threaded(struct net_device *dev, unsigned long val)
+{
+	int ret;
+
+	if (list_empty(&dev->napi_list))
+		return -EOPNOTSUPP;
+
+	if (val != 0 && val != 1)
+		return -EOPNOTSUPP;
+
+	ret = dev_set_threaded(dev, val);
+
+	return ret;
+}
+
+static ssize_t threaded_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t len)
+{
+	return netdev_store(dev, attr, buf, len, modify_napi_threaded);
+}
+static DEVICE_ATTR_RW(threaded);
+
 static ssize_t ifalias_store(struct device *dev, struct device_attribute *attr,
 			     const char *buf, size_t len)
 {
@@ -527,6 +626,10 @@ static struct attribute *net_class_attrs[] = {
 	&dev_attr_flags.attr,
 	&dev_attr_tx_queue_len.attr,
 	&dev_attr_gro_flush_timeout.attr,
+	&dev_attr_gro_udp_max_segs.attr,
+	&dev_attr_gro_udp_max_size.attr,
+	&dev_attr_xmit_batch.attr,
+	&dev_attr_threaded.attr,
 	&dev_attr_phys_port_id.attr,
 	&dev_attr_phys_port_name.attr,
 	&dev_attr_phys_switch_id.attr,
@@ -848,12 +951,88 @@ static struct rx_queue_attribute rps_cpus_attribute =
 static struct rx_queue_attribute rps_dev_flow_table_cnt_attribute =
 	__ATTR(rps_flow_cnt, S_IRUGO | S_IWUSR,
 	    show_rps_dev_flow_table_cnt, store_rps_dev_flow_table_cnt);
+
+#ifdef CONFIG_RFS_ACCEL
+static ssize_t show_arfs_filter_quota(struct netdev_rx_queue *queue,
+				      struct rx_queue_attribute *attr,
+				      char *buf)
+{
+	return sprintf(buf, "%u\n", queue->arfs_filter_quota);
+}
+
+static ssize_t store_arfs_filter_quota(struct netdev_rx_queue *queue,
+				       struct rx_queue_attribute *attr,
+				       const char *buf, size_t len)
+{
+	unsigned int quota;
+	int rc;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	rc = kstrtouint(buf, 0, &quota);
+	if (rc < 0)
+		return rc;
+
+	queue->arfs_filter_quota = quota;
+
+	return len;
+}
+
+static ssize_t show_arfs_filter_cnt(struct netdev_rx_queue *queue,
+				    struct rx_queue_attribute *attr,
+				    char *buf)
+{
+	return sprintf(buf, "%d\n", atomic_read(&queue->arfs_filter_cnt));
+}
+
+static ssize_t show_arfs_steered(struct netdev_rx_queue *queue,
+				 struct rx_queue_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", queue->arfs_steered);
+}
+
+static ssize_t show_arfs_expired(struct netdev_rx_queue *queue,
+				 struct rx_queue_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", queue->arfs_expired);
+}
+
+static ssize_t show_arfs_hits(struct netdev_rx_queue *queue,
+			      struct rx_queue_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", queue->arfs_hits);
+}
+
+static struct rx_queue_attribute arfs_filter_quota_attribute =
+	__ATTR(arfs_filter_quota, S_IRUGO | S_IWUSR,
+	    show_arfs_filter_quota, store_arfs_filter_quota);
+
+static struct rx_queue_attribute arfs_filter_cnt_attribute =
+	__ATTR(arfs_filter_cnt, S_IRUGO, show_arfs_filter_cnt, NULL);
+
+static struct rx_queue_attribute arfs_steered_attribute =
+	__ATTR(arfs_steered, S_IRUGO, show_arfs_steered, NULL);
+
+static struct rx_queue_attribute arfs_expired_attribute =
+	__ATTR(arfs_expired, S_IRUGO, show_arfs_expired, NULL);
+
+static struct rx_queue_attribute arfs_hits_attribute =
+	__ATTR(arfs_hits, S_IRUGO, show_arfs_hits, NULL);
+#endif /* CONFIG_RFS_ACCEL */
 #endif /* CONFIG_RPS */
 
 static struct attribute *rx_queue_default_attrs[] = {
 #ifdef CONFIG_RPS
 	&rps_cpus_attribute.attr,
 	&rps_dev_flow_table_cnt_attribute.attr,
+#ifdef CONFIG_RFS_ACCEL
+	&arfs_filter_quota_attribute.attr,
+	&arfs_filter_cnt_attribute.attr,
+	&arfs_steered_attribute.attr,
+	&arfs_expired_attribute.attr,
+	&arfs_hits_attribute.attr,
+#endif
 #endif
 	NULL
 };
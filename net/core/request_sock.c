@@ -46,7 +46,10 @@ void reqsk_queue_alloc(struct request_sock_queue *queue)
 	queue->fastopenq.rskq_rst_tail = NULL;
 	queue->fastopenq.qlen = 0;
 
+	queue->rskq_added = 0;
+	queue->rskq_removed = 0;
 	queue->rskq_accept_head = NULL;
+	queue->rskq_batch_head = NULL;
 }
 
 /*
@@ -4049,7 +4049,17 @@ static int rtnetlink_rcv_msg(struct sk_buff *skb, struct nlmsghdr *nlh)
 	if (doit == NULL)
 		return -EOPNOTSUPP;
 
-	return doit(skb, nlh);
+	/*
+	 * Config changes frequently wait for grace periods with the rtnl
+	 * mutex held, serializing the whole control plane behind them.
+	 * Expedite the waits issued by this handler, subject to the
+	 * global rcu_expedite_self_limit budget.
+	 */
+	rcu_expedite_current();
+	err = doit(skb, nlh);
+	rcu_unexpedite_current();
+
+	return err;
 }
 
 static void rtnetlink_rcv(struct sk_buff *skb)
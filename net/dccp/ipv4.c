@@ -402,7 +402,7 @@ struct sock *dccp_v4_request_recv_sock(const struct sock *sk,
 	struct inet_sock *newinet;
 	struct sock *newsk;
 
-	if (sk_acceptq_is_full(sk))
+	if (inet_csk_acceptq_is_full(sk))
 		goto exit_overflow;
 
 	newsk = dccp_create_openreq_child(sk, req, skb);
@@ -591,7 +591,7 @@ int dccp_v4_conn_request(struct sock *sk, struct sk_buff *skb)
 	if (inet_csk_reqsk_queue_is_full(sk))
 		goto drop;
 
-	if (sk_acceptq_is_full(sk))
+	if (inet_csk_acceptq_is_full(sk))
 		goto drop;
 
 	req = inet_reqsk_alloc(&dccp_request_sock_ops, sk, true);
@@ -328,7 +328,7 @@ static int dccp_v6_conn_request(struct sock *sk, struct sk_buff *skb)
 	if (inet_csk_reqsk_queue_is_full(sk))
 		goto drop;
 
-	if (sk_acceptq_is_full(sk))
+	if (inet_csk_acceptq_is_full(sk))
 		goto drop;
 
 	req = inet_reqsk_alloc(&dccp6_request_sock_ops, sk, true);
@@ -445,7 +445,7 @@ static struct sock *dccp_v6_request_recv_sock(const struct sock *sk,
 	}
 
 
-	if (sk_acceptq_is_full(sk))
+	if (inet_csk_acceptq_is_full(sk))
 		goto out_overflow;
 
 	if (!dst) {
@@ -74,6 +74,8 @@
 #include <linux/export.h>
 #include <linux/vmalloc.h>
 #include <linux/notifier.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
 #include <net/net_namespace.h>
 #include <net/ip.h>
 #include <net/protocol.h>
@@ -273,6 +275,10 @@ struct trie {
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	struct trie_use_stats __percpu *stats;
 #endif
+	/* preferred node for trie node allocations, NUMA_NO_NODE unless
+	 * this trie is a node local replica
+	 */
+	int numa_node;
 };
 
 static struct key_vector *resize(struct trie *t, struct key_vector *tn);
@@ -288,6 +294,17 @@ static const int sync_pages = 128;
 static struct kmem_cache *fn_alias_kmem __read_mostly;
 static struct kmem_cache *trie_leaf_kmem __read_mostly;
 
+/* Optional per-NUMA-node replicas of the routing tries.  Lookups run on
+ * a node local copy so that the hot top levels of the trie never have to
+ * be fetched from a remote socket; all modifications only ever see the
+ * primary trie, and the replicas are rebuilt from it when it changes.
+ */
+int sysctl_fib_numa_replicas __read_mostly;
+
+struct fib_replicas {
+	struct fib_table *tables[0];	/* nr_node_ids entries */
+};
+
 static inline struct tnode *tn_info(struct key_vector *kv)
 {
 	return container_of(kv, struct tnode, kv[0]);
@@ -422,7 +439,7 @@ static void __node_free_rcu(struct rcu_head *head)
 
 #define node_free(n) call_rcu(&tn_info(n)->rcu, __node_free_rcu)
 
-static struct tnode *tnode_alloc(int bits)
+static struct tnode *tnode_alloc(struct trie *t, int bits)
 {
 	size_t size;
 
@@ -434,9 +451,9 @@ static struct tnode *tnode_alloc(int bits)
 	size = TNODE_SIZE(1ul << bits);
 
 	if (size <= PAGE_SIZE)
-		return kzalloc(size, GFP_KERNEL);
+		return kzalloc_node(size, GFP_KERNEL, t->numa_node);
 	else
-		return vzalloc(size);
+		return vzalloc_node(size, t->numa_node);
 }
 
 static inline void empty_child_inc(struct key_vector *n)
@@ -449,12 +466,13 @@ static inline void empty_child_dec(struct key_vector *n)
 	tn_info(n)->empty_children-- ? : tn_info(n)->full_children--;
 }
 
-static struct key_vector *leaf_new(t_key key, struct fib_alias *fa)
+static struct key_vector *leaf_new(struct trie *t, t_key key,
+				   struct fib_alias *fa)
 {
 	struct key_vector *l;
 	struct tnode *kv;
 
-	kv = kmem_cache_alloc(trie_leaf_kmem, GFP_KERNEL);
+	kv = kmem_cache_alloc_node(trie_leaf_kmem, GFP_KERNEL, t->numa_node);
 	if (!kv)
 		return NULL;
 
@@ -472,7 +490,8 @@ static struct key_vector *leaf_new(t_key key, struct fib_alias *fa)
 	return l;
 }
 
-static struct key_vector *tnode_new(t_key key, int pos, int bits)
+static struct key_vector *tnode_new(struct trie *t, t_key key, int pos,
+				    int bits)
 {
 	unsigned int shift = pos + bits;
 	struct key_vector *tn;
@@ -481,7 +500,7 @@ static struct key_vector *tnode_new(t_key key, int pos, int bits)
 	/* verify bits and pos their msb bits clear and values are valid */
 	BUG_ON(!bits || (shift > KEYLENGTH));
 
-	tnode = tnode_alloc(bits);
+	tnode = tnode_alloc(t, bits);
 	if (!tnode)
 		return NULL;
 
@@ -641,7 +660,7 @@ static struct key_vector *inflate(struct trie *t,
 
 	pr_debug("In inflate\n");
 
-	tn = tnode_new(oldtnode->key, oldtnode->pos - 1, oldtnode->bits + 1);
+	tn = tnode_new(t, oldtnode->key, oldtnode->pos - 1, oldtnode->bits + 1);
 	if (!tn)
 		goto notnode;
 
@@ -692,10 +711,10 @@ static struct key_vector *inflate(struct trie *t,
 		 * node0 and node1. So... we synthesize that bit in the
 		 * two new keys.
 		 */
-		node1 = tnode_new(inode->key | m, inode->pos, inode->bits - 1);
+		node1 = tnode_new(t, inode->key | m, inode->pos, inode->bits - 1);
 		if (!node1)
 			goto nomem;
-		node0 = tnode_new(inode->key, inode->pos, inode->bits - 1);
+		node0 = tnode_new(t, inode->key, inode->pos, inode->bits - 1);
 
 		tnode_free_append(tn, node1);
 		if (!node0)
@@ -736,7 +755,7 @@ static struct key_vector *halve(struct trie *t,
 
 	pr_debug("In halve\n");
 
-	tn = tnode_new(oldtnode->key, oldtnode->pos + 1, oldtnode->bits - 1);
+	tn = tnode_new(t, oldtnode->key, oldtnode->pos + 1, oldtnode->bits - 1);
 	if (!tn)
 		goto notnode;
 
@@ -760,7 +779,7 @@ static struct key_vector *halve(struct trie *t,
 		}
 
 		/* Two nonempty children */
-		inode = tnode_new(node0->key, oldtnode->pos, 1);
+		inode = tnode_new(t, node0->key, oldtnode->pos, 1);
 		if (!inode)
 			goto nomem;
 		tnode_free_append(tn, inode);
@@ -1113,7 +1132,7 @@ static int fib_insert_node(struct trie *t, struct key_vector *tp,
 {
 	struct key_vector *n, *l;
 
-	l = leaf_new(key, new);
+	l = leaf_new(t, key, new);
 	if (!l)
 		goto noleaf;
 
@@ -1129,7 +1148,7 @@ static int fib_insert_node(struct trie *t, struct key_vector *tp,
 	if (n) {
 		struct key_vector *tn;
 
-		tn = tnode_new(key, __fls(key ^ n->key), 1);
+		tn = tnode_new(t, key, __fls(key ^ n->key), 1);
 		if (!tn)
 			goto notnode;
 
@@ -1373,11 +1392,28 @@ static inline t_key prefix_mismatch(t_key key, struct key_vector *n)
 	return (key ^ prefix) & (prefix | -prefix);
 }
 
+/* Lookups run on a node local replica of the trie when one has been
+ * built; everything else only ever sees the primary trie.
+ */
+static struct trie *fib_trie_select(struct fib_table *tb)
+{
+	struct fib_replicas *rep = rcu_dereference_rtnl(tb->tb_replicas);
+
+	if (rep) {
+		struct fib_table *ntb = rep->tables[numa_node_id()];
+
+		if (ntb)
+			return (struct trie *)ntb->tb_data;
+	}
+
+	return (struct trie *)tb->tb_data;
+}
+
 /* should be called with rcu_read_lock */
 int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 		     struct fib_result *res, int fib_flags)
 {
-	struct trie *t = (struct trie *) tb->tb_data;
+	struct trie *t = fib_trie_select(tb);
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	struct trie_use_stats __percpu *stats = t->stats;
 #endif
@@ -2060,11 +2096,215 @@ static void __trie_free_rcu(struct rcu_head *head)
 	kfree(tb);
 }
 
+static void fib_replicas_destroy(struct fib_replicas *rep);
+
 void fib_free_table(struct fib_table *tb)
 {
+	struct fib_replicas *rep;
+
+	rep = rcu_dereference_protected(tb->tb_replicas, 1);
+	if (rep) {
+		RCU_INIT_POINTER(tb->tb_replicas, NULL);
+		synchronize_rcu();
+		fib_replicas_destroy(rep);
+	}
+
 	call_rcu(&tb->rcu, __trie_free_rcu);
 }
 
+/* Populate a replica from the primary trie.  We cannot feed the replica
+ * from the notifier replay stream as that skips the merged local table
+ * aliases which the lookup path depends on, so clone every alias the
+ * way fib_trie_unmerge() does.
+ */
+static int fib_replica_fill(struct fib_table *ntb, struct fib_table *tb)
+{
+	struct trie *ot = (struct trie *)tb->tb_data;
+	struct trie *t = (struct trie *)ntb->tb_data;
+	struct key_vector *l, *tp = ot->kv;
+	t_key key = 0;
+
+	while ((l = leaf_walk_rcu(&tp, key)) != NULL) {
+		struct key_vector *nl = NULL, *ntp;
+		struct fib_alias *fa;
+
+		hlist_for_each_entry_rcu(fa, &l->leaf, fa_list) {
+			struct fib_alias *new_fa;
+
+			new_fa = kmem_cache_alloc_node(fn_alias_kmem,
+						       GFP_KERNEL,
+						       t->numa_node);
+			if (!new_fa)
+				return -ENOMEM;
+
+			memcpy(new_fa, fa, sizeof(*fa));
+
+			if (!nl)
+				nl = fib_find_node(t, &ntp, l->key);
+
+			if (fib_insert_alias(t, ntp, nl, new_fa, NULL,
+					     l->key)) {
+				kmem_cache_free(fn_alias_kmem, new_fa);
+				return -ENOMEM;
+			}
+
+			/* the clone keeps its own ref on the shared info */
+			fa->fa_info->fib_treeref++;
+		}
+
+		/* stop loop if key wrapped back to 0 */
+		key = l->key + 1;
+		if (key < l->key)
+			break;
+	}
+
+	return 0;
+}
+
+static void fib_replica_free(struct fib_table *ntb)
+{
+	struct trie *t = (struct trie *)ntb->tb_data;
+	struct key_vector *l, *tp = t->kv;
+	struct fib_alias *fa;
+	t_key key = 0;
+
+	/* drop the fib_info references held by the cloned aliases */
+	while ((l = leaf_walk_rcu(&tp, key)) != NULL) {
+		hlist_for_each_entry_rcu(fa, &l->leaf, fa_list)
+			fib_release_info(fa->fa_info);
+
+		key = l->key + 1;
+		if (key < l->key)
+			break;
+	}
+
+	fib_trie_free(ntb);
+}
+
+static struct fib_table *fib_replica_new(struct fib_table *tb, int node)
+{
+	struct fib_table *ntb;
+	struct trie *t;
+
+	ntb = fib_trie_table(tb->tb_id, NULL);
+	if (!ntb)
+		return NULL;
+
+	t = (struct trie *)ntb->tb_data;
+	t->numa_node = node;
+
+	if (fib_replica_fill(ntb, tb)) {
+		fib_replica_free(ntb);
+		return NULL;
+	}
+
+	return ntb;
+}
+
+static void fib_replicas_destroy(struct fib_replicas *rep)
+{
+	int node;
+
+	for (node = 0; node < nr_node_ids; node++) {
+		if (rep->tables[node])
+			fib_replica_free(rep->tables[node]);
+	}
+
+	kfree(rep);
+}
+
+/* Rebuild the replicas of one table from scratch.  Incrementally
+ * replaying single events would be cheaper, but route updates are rare
+ * on the setups this is meant for while a missed or reordered event
+ * would leave a replica permanently out of sync.
+ */
+static void fib_replicas_rebuild(struct fib_table *tb)
+{
+	struct fib_replicas *old, *new = NULL;
+
+	old = rtnl_dereference(tb->tb_replicas);
+
+	/* a merged local table shares the main trie; only replicate
+	 * tables which own their trie
+	 */
+	if (sysctl_fib_numa_replicas && tb->tb_data == tb->__data) {
+		int node;
+
+		new = kzalloc(sizeof(*new) +
+			      nr_node_ids * sizeof(struct fib_table *),
+			      GFP_KERNEL);
+		if (new) {
+			for_each_online_node(node) {
+				new->tables[node] = fib_replica_new(tb, node);
+				if (!new->tables[node]) {
+					fib_replicas_destroy(new);
+					new = NULL;
+					break;
+				}
+			}
+		}
+	}
+
+	/* on failure fall back to the primary trie rather than keeping a
+	 * stale replica alive; its fib_info references would pin netdevs
+	 */
+	if (!old && !new)
+		return;
+
+	rcu_assign_pointer(tb->tb_replicas, new);
+
+	if (old) {
+		synchronize_rcu();
+		fib_replicas_destroy(old);
+	}
+}
+
+static void fib_replicas_work_fn(struct work_struct *work)
+{
+	struct net *net;
+
+	rtnl_lock();
+	for_each_net(net) {
+		unsigned int h;
+
+		for (h = 0; h < FIB_TABLE_HASHSZ; h++) {
+			struct hlist_head *head = &net->ipv4.fib_table_hash[h];
+			struct fib_table *tb;
+
+			hlist_for_each_entry(tb, head, tb_hlist)
+				fib_replicas_rebuild(tb);
+		}
+	}
+	rtnl_unlock();
+}
+
+static DECLARE_WORK(fib_replicas_work, fib_replicas_work_fn);
+
+static int fib_replicas_event(struct notifier_block *nb, unsigned long event,
+			      void *ptr)
+{
+	if (sysctl_fib_numa_replicas)
+		schedule_work(&fib_replicas_work);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block fib_replicas_nb = {
+	.notifier_call = fib_replicas_event,
+};
+
+int proc_fib_numa_replicas(struct ctl_table *table, int write,
+			   void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+	if (write && !ret)
+		schedule_work(&fib_replicas_work);
+
+	return ret;
+}
+
 static int fn_trie_dump_leaf(struct key_vector *l, struct fib_table *tb,
 			     struct sk_buff *skb, struct netlink_callback *cb)
 {
@@ -2151,6 +2391,8 @@ void __init fib_trie_init(void)
 	trie_leaf_kmem = kmem_cache_create("ip_fib_trie",
 					   LEAF_SIZE,
 					   0, SLAB_PANIC, NULL);
+
+	register_fib_notifier(&fib_replicas_nb, NULL);
 }
 
 struct fib_table *fib_trie_table(u32 id, struct fib_table *alias)
@@ -2176,6 +2418,7 @@ struct fib_table *fib_trie_table(u32 id, struct fib_table *alias)
 	t = (struct trie *) tb->tb_data;
 	t->kv[0].pos = KEYLENGTH;
 	t->kv[0].slen = KEYLENGTH;
+	t->numa_node = NUMA_NO_NODE;
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	t->stats = alloc_percpu(struct trie_use_stats);
 	if (!t->stats) {
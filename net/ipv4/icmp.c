@@ -67,6 +67,7 @@
 #include <linux/module.h>
 #include <linux/types.h>
 #include <linux/jiffies.h>
+#include <linux/random.h>
 #include <linux/kernel.h>
 #include <linux/fcntl.h>
 #include <linux/socket.h>
@@ -235,50 +236,54 @@ static inline void icmp_xmit_unlock(struct sock *sk)
 int sysctl_icmp_msgs_per_sec __read_mostly = 1000;
 int sysctl_icmp_msgs_burst __read_mostly = 50;
 
-static struct {
-	spinlock_t	lock;
-	u32		credit;
-	u32		stamp;
-} icmp_global = {
-	.lock		= __SPIN_LOCK_UNLOCKED(icmp_global.lock),
+struct icmp_global_bucket {
+	u32	credit;
+	u32	stamp;
 };
 
+static DEFINE_PER_CPU(struct icmp_global_bucket, icmp_global);
+
 /**
  * icmp_global_allow - Are we allowed to send one more ICMP message ?
  *
- * Uses a token bucket to limit our ICMP messages to sysctl_icmp_msgs_per_sec.
+ * Uses per cpu token buckets to limit our ICMP messages to
+ * sysctl_icmp_msgs_per_sec overall.  Each cpu owns an equal share of
+ * the budget, with a floor of one message per second, and never reads
+ * or writes another cpu's bucket : rejected messages cost a handful of
+ * local cycles no matter how many cpus are under the storm.  The last
+ * credits are spent with a random discount so that the buckets of
+ * different cpus do not drain in lockstep.
  * Returns false if we reached the limit and can not send another packet.
  * Note: called with BH disabled
  */
 bool icmp_global_allow(void)
 {
+	struct icmp_global_bucket *bucket = this_cpu_ptr(&icmp_global);
+	u32 cpus = num_online_cpus();
 	u32 credit, delta, incr = 0, now = (u32)jiffies;
-	bool rc = false;
 
-	/* Check if token bucket is empty and cannot be refilled
-	 * without taking the spinlock.
-	 */
-	if (!icmp_global.credit) {
-		delta = min_t(u32, now - icmp_global.stamp, HZ);
-		if (delta < HZ / 50)
-			return false;
-	}
+	delta = min_t(u32, now - bucket->stamp, HZ);
+	if (!bucket->credit && delta < HZ / 50)
+		return false;
 
-	spin_lock(&icmp_global.lock);
-	delta = min_t(u32, now - icmp_global.stamp, HZ);
 	if (delta >= HZ / 50) {
-		incr = sysctl_icmp_msgs_per_sec * delta / HZ ;
+		incr = max_t(u32, sysctl_icmp_msgs_per_sec / cpus, 1) *
+		       delta / HZ;
 		if (incr)
-			icmp_global.stamp = now;
+			bucket->stamp = now;
 	}
-	credit = min_t(u32, icmp_global.credit + incr, sysctl_icmp_msgs_burst);
-	if (credit) {
-		credit--;
-		rc = true;
+	credit = min_t(u32, bucket->credit + incr,
+		       max_t(u32, sysctl_icmp_msgs_burst / cpus, 1));
+	if (!credit) {
+		bucket->credit = 0;
+		return false;
 	}
-	icmp_global.credit = credit;
-	spin_unlock(&icmp_global.lock);
-	return rc;
+
+	/* We spend one credit on average, but randomize it so that the
+	 * limiter is harder to probe from the outside.
+	 */
+	bucket->credit = max_t(int, credit - prandom_u32_max(3), 0);
+	return true;
 }
 EXPORT_SYMBOL(icmp_global_allow);
 
@@ -811,7 +811,7 @@ struct sock *inet_csk_reqsk_queue_add(struct sock *sk,
 		else
 			queue->rskq_accept_tail->dl_next = req;
 		queue->rskq_accept_tail = req;
-		sk_acceptq_added(sk);
+		WRITE_ONCE(queue->rskq_added, queue->rskq_added + 1);
 	}
 	spin_unlock(&queue->rskq_lock);
 	return child;
@@ -879,7 +879,7 @@ void inet_csk_listen_stop(struct sock *sk)
 			req = next;
 		}
 	}
-	WARN_ON_ONCE(sk->sk_ack_backlog);
+	WARN_ON_ONCE(inet_csk_acceptq_len(sk));
 }
 EXPORT_SYMBOL_GPL(inet_csk_listen_stop);
 
@@ -19,6 +19,8 @@
 #include <linux/slab.h>
 #include <linux/wait.h>
 #include <linux/vmalloc.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
 
 #include <net/addrconf.h>
 #include <net/inet_connection_sock.h>
@@ -205,6 +207,46 @@ static inline int compute_score(struct sock *sk, struct net *net,
  * wildcarded during the search since they can never be otherwise.
  */
 
+/* Run the netns sk_lookup program, if one is attached. The program can
+ * short-circuit the listener hash walk by selecting a socket out of a
+ * sockmap, or refuse the lookup altogether with SK_DROP. Returning
+ * SK_PASS without a selection falls back to the normal hash walk.
+ *
+ * Sockmap entries are only released after an RCU grace period, so the
+ * selected socket stays valid for the caller, which takes its own
+ * reference.
+ */
+static struct sock *inet_lookup_run_bpf(struct net *net,
+					const __be32 saddr, __be16 sport,
+					const __be32 daddr,
+					const unsigned short hnum,
+					bool *selected)
+{
+	struct bpf_sk_lookup_kern ctx = {
+		.family		= AF_INET,
+		.protocol	= IPPROTO_TCP,
+		.remote_ip4	= saddr,
+		.remote_port	= ntohs(sport),
+		.local_ip4	= daddr,
+		.local_port	= hnum,
+	};
+	struct bpf_prog *prog;
+	u32 act;
+
+	*selected = false;
+
+	prog = rcu_dereference(net->ipv4.sk_lookup_prog);
+	if (likely(!prog))
+		return NULL;
+
+	act = BPF_PROG_RUN(prog, &ctx);
+	if (act == SK_PASS && !ctx.selected_sk)
+		return NULL;
+
+	*selected = true;
+	return act == SK_PASS ? ctx.selected_sk : NULL;
+}
+
 /* called with rcu_read_lock() : No refcount taken on the socket */
 struct sock *__inet_lookup_listener(struct net *net,
 				    struct inet_hashinfo *hashinfo,
@@ -220,6 +262,16 @@ struct sock *__inet_lookup_listener(struct net *net,
 	struct sock *sk, *result = NULL;
 	u32 phash = 0;
 
+	if (hashinfo == &tcp_hashinfo) {
+		bool selected;
+
+		result = inet_lookup_run_bpf(net, saddr, sport, daddr, hnum,
+					     &selected);
+		if (selected)
+			return result;
+		result = NULL;
+	}
+
 	sk_for_each_rcu(sk, &ilb->head) {
 		score = compute_score(sk, net, hnum, daddr, dif, exact_dif);
 		if (score > hiscore) {
@@ -702,3 +754,77 @@ int inet_ehash_locks_alloc(struct inet_hashinfo *hashinfo)
 	return 0;
 }
 EXPORT_SYMBOL_GPL(inet_ehash_locks_alloc);
+
+#ifdef CONFIG_BPF_SYSCALL
+/* Attachment of sk_lookup programs to a netns, driven by BPF_PROG_ATTACH
+ * with attach_type BPF_SK_LOOKUP and target_fd naming the net namespace.
+ */
+static DEFINE_MUTEX(sk_lookup_prog_mutex);
+
+static int inet_sk_lookup_bpf_set(int netns_fd, struct bpf_prog *prog)
+{
+	struct bpf_prog *attached;
+	struct net *net;
+
+	net = get_net_ns_by_fd(netns_fd);
+	if (IS_ERR(net))
+		return PTR_ERR(net);
+
+	mutex_lock(&sk_lookup_prog_mutex);
+	attached = rcu_dereference_protected(net->ipv4.sk_lookup_prog,
+				lockdep_is_held(&sk_lookup_prog_mutex));
+	rcu_assign_pointer(net->ipv4.sk_lookup_prog, prog);
+	mutex_unlock(&sk_lookup_prog_mutex);
+
+	put_net(net);
+
+	if (!attached && !prog)
+		return -ENOENT;
+	if (attached)
+		bpf_prog_put(attached);
+	return 0;
+}
+
+int inet_sk_lookup_bpf_attach(const union bpf_attr *attr)
+{
+	struct bpf_prog *prog;
+	int ret;
+
+	prog = bpf_prog_get_type(attr->attach_bpf_fd,
+				 BPF_PROG_TYPE_SK_LOOKUP);
+	if (IS_ERR(prog))
+		return PTR_ERR(prog);
+
+	ret = inet_sk_lookup_bpf_set(attr->target_fd, prog);
+	if (ret)
+		bpf_prog_put(prog);
+	return ret;
+}
+
+int inet_sk_lookup_bpf_detach(const union bpf_attr *attr)
+{
+	return inet_sk_lookup_bpf_set(attr->target_fd, NULL);
+}
+
+static void __net_exit inet_sk_lookup_net_exit(struct net *net)
+{
+	struct bpf_prog *prog;
+
+	/* no lookups and no attach can race with a dying netns */
+	prog = rcu_dereference_protected(net->ipv4.sk_lookup_prog, 1);
+	if (prog) {
+		RCU_INIT_POINTER(net->ipv4.sk_lookup_prog, NULL);
+		bpf_prog_put(prog);
+	}
+}
+
+static struct pernet_operations inet_sk_lookup_net_ops = {
+	.exit = inet_sk_lookup_net_exit,
+};
+
+static int __init inet_sk_lookup_init(void)
+{
+	return register_pernet_subsys(&inet_sk_lookup_net_ops);
+}
+late_initcall(inet_sk_lookup_init);
+#endif /* CONFIG_BPF_SYSCALL */
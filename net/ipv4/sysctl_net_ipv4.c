@@ -655,6 +655,15 @@ static struct ctl_table ipv4_table[] = {
 		.proc_handler	= proc_dointvec_minmax,
 		.extra1		= &one
 	},
+	{
+		.procname	= "fib_numa_replicas",
+		.data		= &sysctl_fib_numa_replicas,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_fib_numa_replicas,
+		.extra1		= &zero,
+		.extra2		= &one
+	},
 	{ }
 };
 
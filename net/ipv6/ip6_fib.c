@@ -181,7 +181,7 @@ static void rt6_free_pcpu(struct rt6_info *non_pcpu_rt)
 	non_pcpu_rt->rt6i_pcpu = NULL;
 }
 
-static void rt6_release(struct rt6_info *rt)
+void rt6_release(struct rt6_info *rt)
 {
 	if (atomic_dec_and_test(&rt->rt6i_ref)) {
 		rt6_free_pcpu(rt);
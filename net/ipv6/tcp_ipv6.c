@@ -1082,7 +1082,7 @@ static struct sock *tcp_v6_syn_recv_sock(const struct sock *sk, struct sk_buff *
 
 	ireq = inet_rsk(req);
 
-	if (sk_acceptq_is_full(sk))
+	if (inet_csk_acceptq_is_full(sk))
 		goto out_overflow;
 
 	if (!dst) {
@@ -1770,7 +1770,7 @@ static void get_tcp6_sock(struct seq_file *seq, struct sock *sp, int i)
 
 	state = sk_state_load(sp);
 	if (state == TCP_LISTEN)
-		rx_queue = sp->sk_ack_backlog;
+		rx_queue = inet_csk_acceptq_len(sp);
 	else
 		/* Because we don't lock the socket,
 		 * we might find a transient negative value.
@@ -1909,6 +1909,7 @@ struct proto tcpv6_prot = {
 	.stream_memory_free	= tcp_stream_memory_free,
 	.sockets_allocated	= &tcp_sockets_allocated,
 	.memory_allocated	= &tcp_memory_allocated,
+	.per_cpu_fw_alloc	= &tcp_memory_per_cpu_fw_alloc,
 	.memory_pressure	= &tcp_memory_pressure,
 	.orphan_count		= &tcp_orphan_count,
 	.sysctl_mem		= sysctl_tcp_mem,
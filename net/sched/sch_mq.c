@@ -109,13 +109,34 @@ static int mq_dump(struct Qdisc *sch, struct sk_buff *skb)
 	for (ntx = 0; ntx < dev->num_tx_queues; ntx++) {
 		qdisc = netdev_get_tx_queue(dev, ntx)->qdisc_sleeping;
 		spin_lock_bh(qdisc_lock(qdisc));
-		sch->q.qlen		+= qdisc->q.qlen;
-		sch->bstats.bytes	+= qdisc->bstats.bytes;
-		sch->bstats.packets	+= qdisc->bstats.packets;
-		sch->qstats.backlog	+= qdisc->qstats.backlog;
-		sch->qstats.drops	+= qdisc->qstats.drops;
-		sch->qstats.requeues	+= qdisc->qstats.requeues;
-		sch->qstats.overlimits	+= qdisc->qstats.overlimits;
+
+		if (qdisc_is_percpu_stats(qdisc)) {
+			int i;
+
+			for_each_possible_cpu(i) {
+				struct gnet_stats_basic_cpu *bcpu;
+				struct gnet_stats_queue *qcpu;
+
+				bcpu = per_cpu_ptr(qdisc->cpu_bstats, i);
+				qcpu = per_cpu_ptr(qdisc->cpu_qstats, i);
+				sch->bstats.bytes	+= bcpu->bstats.bytes;
+				sch->bstats.packets	+= bcpu->bstats.packets;
+				sch->q.qlen		+= qcpu->qlen;
+				sch->qstats.backlog	+= qcpu->backlog;
+				sch->qstats.drops	+= qcpu->drops;
+				sch->qstats.requeues	+= qcpu->requeues;
+				sch->qstats.overlimits	+= qcpu->overlimits;
+			}
+		} else {
+			sch->q.qlen		+= qdisc->q.qlen;
+			sch->bstats.bytes	+= qdisc->bstats.bytes;
+			sch->bstats.packets	+= qdisc->bstats.packets;
+			sch->qstats.backlog	+= qdisc->qstats.backlog;
+			sch->qstats.drops	+= qdisc->qstats.drops;
+			sch->qstats.requeues	+= qdisc->qstats.requeues;
+			sch->qstats.overlimits	+= qdisc->qstats.overlimits;
+		}
+
 		spin_unlock_bh(qdisc_lock(qdisc));
 	}
 	return 0;
@@ -199,8 +220,10 @@ static int mq_dump_class_stats(struct Qdisc *sch, unsigned long cl,
 	struct netdev_queue *dev_queue = mq_queue_get(sch, cl);
 
 	sch = dev_queue->qdisc_sleeping;
-	if (gnet_stats_copy_basic(&sch->running, d, NULL, &sch->bstats) < 0 ||
-	    gnet_stats_copy_queue(d, NULL, &sch->qstats, sch->q.qlen) < 0)
+	if (gnet_stats_copy_basic(&sch->running, d, sch->cpu_bstats,
+				  &sch->bstats) < 0 ||
+	    gnet_stats_copy_queue(d, sch->cpu_qstats, &sch->qstats,
+				  qdisc_qlen_sum(sch)) < 0)
 		return -1;
 	return 0;
 }
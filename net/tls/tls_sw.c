@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2016-2017, Mellanox Technologies. All rights reserved.
+ * Copyright (c) 2016-2017, Dave Watson <davejwatson@fb.com>. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * OpenIB.org BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <crypto/aead.h>
+
+#include <net/tls.h>
+
+/* rec_seq and the explicit nonce are 64-bit big-endian counters */
+static void tls_increment_seqno(u8 *seq)
+{
+	int i;
+
+	for (i = TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE - 1; i >= 0; i--) {
+		if (++seq[i])
+			break;
+	}
+}
+
+static void tls_make_aad(char *buf, size_t size, char *record_sequence,
+			 unsigned char record_type)
+{
+	memcpy(buf, record_sequence, TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE);
+
+	buf[8] = record_type;
+	buf[9] = TLS_1_2_VERSION_MAJOR;
+	buf[10] = TLS_1_2_VERSION_MINOR;
+	buf[11] = size >> 8;
+	buf[12] = size & 0xFF;
+}
+
+static void tls_fill_prepend(struct tls_sw_context *ctx, char *buf, size_t size,
+			     unsigned char record_type)
+{
+	size_t pkt_len = size + TLS_CIPHER_AES_GCM_128_IV_SIZE +
+			 TLS_CIPHER_AES_GCM_128_TAG_SIZE;
+
+	/* we cover nonce explicit here as well, so buf should be of
+	 * size TLS_HEADER_SIZE + TLS_CIPHER_AES_GCM_128_IV_SIZE
+	 */
+	buf[0] = record_type;
+	buf[1] = TLS_1_2_VERSION_MAJOR;
+	buf[2] = TLS_1_2_VERSION_MINOR;
+	/* we can use IV for nonce explicit according to spec */
+	buf[3] = pkt_len >> 8;
+	buf[4] = pkt_len & 0xFF;
+	memcpy(buf + TLS_NONCE_OFFSET,
+	       ctx->iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE,
+	       TLS_CIPHER_AES_GCM_128_IV_SIZE);
+}
+
+/* Encrypt the staged plaintext in place.  The record buffer holds
+ * header + nonce + plaintext with TAG_SIZE bytes reserved at the end,
+ * so the ciphertext and tag land exactly where the wire format wants
+ * them.
+ */
+static int tls_do_encryption(struct tls_sw_context *ctx)
+{
+	struct scatterlist sg[2];
+	char *buf = page_address(ctx->rec_page);
+	unsigned int len = ctx->rec_len;
+	int rc;
+
+	tls_fill_prepend(ctx, buf, len, TLS_RECORD_TYPE_DATA);
+	tls_make_aad(ctx->aad_space, len, ctx->rec_seq, TLS_RECORD_TYPE_DATA);
+
+	sg_init_table(sg, 2);
+	sg_set_buf(&sg[0], ctx->aad_space, TLS_AAD_SPACE_SIZE);
+	sg_set_page(&sg[1], ctx->rec_page,
+		    len + TLS_CIPHER_AES_GCM_128_TAG_SIZE, TLS_PREFIX_SIZE);
+
+	aead_request_set_tfm(ctx->aead_req, ctx->aead_send);
+	aead_request_set_ad(ctx->aead_req, TLS_AAD_SPACE_SIZE);
+	aead_request_set_crypt(ctx->aead_req, sg, sg, len, ctx->iv);
+
+	rc = crypto_aead_encrypt(ctx->aead_req);
+	if (rc)
+		return rc;
+
+	tls_increment_seqno(ctx->rec_seq);
+	tls_increment_seqno(ctx->iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+
+	ctx->push_off = 0;
+	ctx->push_len = TLS_PREFIX_SIZE + len +
+			TLS_CIPHER_AES_GCM_128_TAG_SIZE;
+	ctx->rec_len = 0;
+	return 0;
+}
+
+/* Hand the encrypted record to TCP.  do_tcp_sendpages() blocks for
+ * write memory unless MSG_DONTWAIT is set, so a nonblocking caller can
+ * come back with the tail of the record still pending.
+ */
+static int tls_push_pending(struct sock *sk, struct tls_sw_context *ctx,
+			    int flags)
+{
+	int ret;
+
+	while (ctx->push_len) {
+		ret = do_tcp_sendpages(sk, ctx->rec_page, ctx->push_off,
+				       ctx->push_len, flags);
+		if (ret <= 0)
+			return ret ? ret : -EAGAIN;
+
+		ctx->push_off += ret;
+		ctx->push_len -= ret;
+	}
+	return 0;
+}
+
+static int tls_push_record(struct sock *sk, struct tls_sw_context *ctx,
+			   int flags)
+{
+	int rc;
+
+	rc = tls_do_encryption(ctx);
+	if (rc)
+		return rc;
+
+	return tls_push_pending(sk, ctx, flags);
+}
+
+int tls_sw_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
+{
+	struct tls_context *tls_ctx = tls_get_ctx(sk);
+	struct tls_sw_context *ctx = tls_sw_ctx(tls_ctx);
+	int flags = msg->msg_flags;
+	bool eor = !(flags & MSG_MORE);
+	size_t copied = 0;
+	int rc = 0;
+
+	if (flags & ~(MSG_MORE | MSG_DONTWAIT | MSG_NOSIGNAL))
+		return -ENOTSUPP;
+
+	lock_sock(sk);
+
+	/* A previous nonblocking call may have left ciphertext behind;
+	 * it has to hit the wire before the next record can use the
+	 * buffer.
+	 */
+	rc = tls_push_pending(sk, ctx, flags);
+	if (rc)
+		goto out;
+
+	while (msg_data_left(msg)) {
+		size_t copy = min_t(size_t, msg_data_left(msg),
+				    TLS_MAX_PAYLOAD_SIZE - ctx->rec_len);
+		char *dst = page_address(ctx->rec_page) + TLS_PREFIX_SIZE +
+			    ctx->rec_len;
+
+		if (sk->sk_err) {
+			rc = -sk->sk_err;
+			goto out;
+		}
+
+		if (copy_from_iter(dst, copy, &msg->msg_iter) != copy) {
+			rc = -EFAULT;
+			goto out;
+		}
+		ctx->rec_len += copy;
+		copied += copy;
+
+		/* Close the record on a full payload or at the end of
+		 * the request unless the caller promised more data.
+		 */
+		if (ctx->rec_len == TLS_MAX_PAYLOAD_SIZE ||
+		    (!msg_data_left(msg) && eor)) {
+			rc = tls_push_record(sk, ctx, flags);
+			if (rc)
+				goto out;
+		}
+	}
+
+out:
+	release_sock(sk);
+	return copied ? copied : rc;
+}
+
+int tls_sw_sendpage(struct sock *sk, struct page *page,
+		    int offset, size_t size, int flags)
+{
+	struct bio_vec bvec;
+	struct msghdr msg = { };
+
+	if (flags & MSG_OOB)
+		return -ENOTSUPP;
+
+	msg.msg_flags = flags & (MSG_DONTWAIT | MSG_NOSIGNAL | MSG_MORE);
+	if (flags & MSG_SENDPAGE_NOTLAST)
+		msg.msg_flags |= MSG_MORE;
+
+	/* Software crypto has to read the page anyway, so reuse the
+	 * sendmsg path with a single-segment bvec iterator.
+	 */
+	bvec.bv_page = page;
+	bvec.bv_offset = offset;
+	bvec.bv_len = size;
+	iov_iter_bvec(&msg.msg_iter, WRITE | ITER_BVEC, &bvec, 1, size);
+
+	return tls_sw_sendmsg(sk, &msg, size);
+}
+
+/* Flush whatever is still buffered; called under the socket lock from
+ * the close path, where errors only cost the peer the record tail.
+ */
+void tls_sw_close(struct sock *sk)
+{
+	struct tls_context *tls_ctx = tls_get_ctx(sk);
+	struct tls_sw_context *ctx = tls_sw_ctx(tls_ctx);
+
+	if (ctx->rec_len)
+		tls_push_record(sk, ctx, 0);
+	else
+		tls_push_pending(sk, ctx, 0);
+}
+
+void tls_sw_free_resources(struct sock *sk)
+{
+	struct tls_context *tls_ctx = tls_get_ctx(sk);
+	struct tls_sw_context *ctx = tls_sw_ctx(tls_ctx);
+
+	if (ctx->aead_req)
+		aead_request_free(ctx->aead_req);
+	if (ctx->aead_send)
+		crypto_free_aead(ctx->aead_send);
+	if (ctx->rec_page)
+		__free_pages(ctx->rec_page, TLS_REC_PAGE_ORDER);
+
+	kfree(ctx);
+	tls_ctx->priv_ctx = NULL;
+}
+
+int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx)
+{
+	struct tls12_crypto_info_aes_gcm_128 *gcm_128_info =
+		&ctx->crypto_send_aes_gcm_128;
+	struct tls_sw_context *sw_ctx;
+	int rc = 0;
+
+	if (ctx->priv_ctx)
+		return -EEXIST;
+
+	sw_ctx = kzalloc(sizeof(*sw_ctx), GFP_KERNEL);
+	if (!sw_ctx)
+		return -ENOMEM;
+
+	memcpy(sw_ctx->iv, gcm_128_info->salt,
+	       TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+	memcpy(sw_ctx->iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE,
+	       gcm_128_info->iv, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+	memcpy(sw_ctx->rec_seq, gcm_128_info->rec_seq,
+	       TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE);
+
+	sw_ctx->rec_page = alloc_pages(GFP_KERNEL | __GFP_COMP,
+				       TLS_REC_PAGE_ORDER);
+	if (!sw_ctx->rec_page) {
+		rc = -ENOMEM;
+		goto free_sw_ctx;
+	}
+
+	/* Ask for a synchronous implementation so records complete
+	 * inline under the socket lock.
+	 */
+	sw_ctx->aead_send = crypto_alloc_aead("gcm(aes)", 0,
+					      CRYPTO_ALG_ASYNC);
+	if (IS_ERR(sw_ctx->aead_send)) {
+		rc = PTR_ERR(sw_ctx->aead_send);
+		sw_ctx->aead_send = NULL;
+		goto free_rec_page;
+	}
+
+	rc = crypto_aead_setkey(sw_ctx->aead_send, gcm_128_info->key,
+				TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+	if (rc)
+		goto free_aead;
+
+	rc = crypto_aead_setauthsize(sw_ctx->aead_send,
+				     TLS_CIPHER_AES_GCM_128_TAG_SIZE);
+	if (rc)
+		goto free_aead;
+
+	sw_ctx->aead_req = aead_request_alloc(sw_ctx->aead_send, GFP_KERNEL);
+	if (!sw_ctx->aead_req) {
+		rc = -ENOMEM;
+		goto free_aead;
+	}
+
+	ctx->priv_ctx = sw_ctx;
+	return 0;
+
+free_aead:
+	crypto_free_aead(sw_ctx->aead_send);
+free_rec_page:
+	__free_pages(sw_ctx->rec_page, TLS_REC_PAGE_ORDER);
+free_sw_ctx:
+	kfree(sw_ctx);
+	return rc;
+}
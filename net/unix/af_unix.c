@@ -193,7 +193,9 @@ static inline int unix_may_send(struct sock *sk, struct sock *osk)
 
 static inline int unix_recvq_full(struct sock const *sk)
 {
-	return skb_queue_len(&sk->sk_receive_queue) > sk->sk_max_ack_backlog;
+	return skb_queue_len(&sk->sk_receive_queue) +
+	       skb_queue_len(&unix_sk(sk)->reader_queue) >
+	       sk->sk_max_ack_backlog;
 }
 
 struct sock *unix_peer_get(struct sock *s)
@@ -465,8 +467,10 @@ static void unix_write_space(struct sock *sk)
  * may receive messages only from that peer. */
 static void unix_dgram_disconnected(struct sock *sk, struct sock *other)
 {
-	if (!skb_queue_empty(&sk->sk_receive_queue)) {
+	if (!skb_queue_empty(&sk->sk_receive_queue) ||
+	    !skb_queue_empty(&unix_sk(sk)->reader_queue)) {
 		skb_queue_purge(&sk->sk_receive_queue);
+		skb_queue_purge(&unix_sk(sk)->reader_queue);
 		wake_up_interruptible_all(&unix_sk(sk)->peer_wait);
 
 		/* If one link of bidirectional dgram pipe is disconnected,
@@ -485,6 +489,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&u->reader_queue);
 
 	WARN_ON(atomic_read(&sk->sk_wmem_alloc));
 	WARN_ON(!sk_unhashed(sk));
@@ -551,6 +556,7 @@ static void unix_release_sock(struct sock *sk, int embrion)
 
 	/* Try to flush out this socket. Throw out buffers at least */
 
+	skb_queue_purge(&u->reader_queue);
 	while ((skb = skb_dequeue(&sk->sk_receive_queue)) != NULL) {
 		if (state == TCP_LISTEN)
 			unix_release_sock(skb->sk, 1);
@@ -751,6 +757,7 @@ static struct proto unix_proto = {
  * this special lock-class by reinitializing the spinlock key:
  */
 static struct lock_class_key af_unix_sk_receive_queue_lock_key;
+static struct lock_class_key af_unix_sk_reader_queue_lock_key;
 
 static struct sock *unix_create1(struct net *net, struct socket *sock, int kern)
 {
@@ -783,6 +790,9 @@ static struct sock *unix_create1(struct net *net, struct socket *sock, int kern)
 	mutex_init(&u->bindlock); /* single task binding lock */
 	init_waitqueue_head(&u->peer_wait);
 	init_waitqueue_func_entry(&u->peer_wake, unix_dgram_peer_wake_relay);
+	skb_queue_head_init(&u->reader_queue);
+	lockdep_set_class(&u->reader_queue.lock,
+				&af_unix_sk_reader_queue_lock_key);
 	unix_insert_socket(unix_sockets_unbound(sk), sk);
 out:
 	if (sk == NULL)
@@ -2097,13 +2107,57 @@ static void unix_copy_addr(struct msghdr *msg, struct sock *sk)
 	}
 }
 
+/* Dequeue a datagram, refilling the private reader queue from
+ * sk_receive_queue in one bulk splice whenever it runs dry.  Senders
+ * only ever touch the sk_receive_queue lock, so a burst of messages
+ * costs the reader a single round trip on the contended lock instead
+ * of one per message.  The reader queue itself is serialized by
+ * u->iolock; its spinlock is there for the garbage collector and the
+ * occasional SIOCINQ/purge from other contexts.
+ */
+static struct sk_buff *unix_try_recv_datagram(struct sock *sk,
+					      unsigned int flags, int *peeked,
+					      int *off, int *err)
+{
+	struct sk_buff_head *queue = &unix_sk(sk)->reader_queue;
+	struct sk_buff_head *sk_queue = &sk->sk_receive_queue;
+	struct sk_buff *skb, *last;
+	int error = sock_error(sk);
+
+	if (error)
+		goto no_packet;
+
+	*peeked = 0;
+	spin_lock(&queue->lock);
+	skb = __skb_try_recv_from_queue(sk, queue, flags, NULL, peeked, off,
+					&error, &last);
+	if (!skb && !error && !skb_queue_empty(sk_queue)) {
+		spin_lock(&sk_queue->lock);
+		skb_queue_splice_tail_init(sk_queue, queue);
+		spin_unlock(&sk_queue->lock);
+
+		skb = __skb_try_recv_from_queue(sk, queue, flags, NULL,
+						peeked, off, &error, &last);
+	}
+	spin_unlock(&queue->lock);
+	if (error)
+		goto no_packet;
+	if (skb)
+		return skb;
+
+	error = -EAGAIN;
+no_packet:
+	*err = error;
+	return NULL;
+}
+
 static int unix_dgram_recvmsg(struct socket *sock, struct msghdr *msg,
 			      size_t size, int flags)
 {
 	struct scm_cookie scm;
 	struct sock *sk = sock->sk;
 	struct unix_sock *u = unix_sk(sk);
-	struct sk_buff *skb, *last;
+	struct sk_buff *skb;
 	long timeo;
 	int err;
 	int peeked, skip;
@@ -2118,8 +2172,7 @@ static int unix_dgram_recvmsg(struct socket *sock, struct msghdr *msg,
 		mutex_lock(&u->iolock);
 
 		skip = sk_peek_offset(sk, flags);
-		skb = __skb_try_recv_datagram(sk, flags, NULL, &peeked, &skip,
-					      &err, &last);
+		skb = unix_try_recv_datagram(sk, flags, &peeked, &skip, &err);
 		if (skb)
 			break;
 
@@ -2127,8 +2180,14 @@ static int unix_dgram_recvmsg(struct socket *sock, struct msghdr *msg,
 
 		if (err != -EAGAIN)
 			break;
+
+		/* sk_receive_queue is drained into the reader queue
+		 * wholesale, so wait against the queue head itself
+		 * rather than against a "last" skb.
+		 */
 	} while (timeo &&
-		 !__skb_wait_for_more_packets(sk, &err, &timeo, last));
+		 !__skb_wait_for_more_packets(sk, &err, &timeo,
+				(struct sk_buff *)&sk->sk_receive_queue));
 
 	if (!skb) { /* implies iolock unlocked */
 		unix_state_lock(sk);
@@ -2564,23 +2623,30 @@ static int unix_shutdown(struct socket *sock, int mode)
 
 long unix_inq_len(struct sock *sk)
 {
+	struct sk_buff_head *queue = &unix_sk(sk)->reader_queue;
 	struct sk_buff *skb;
 	long amount = 0;
 
 	if (sk->sk_state == TCP_LISTEN)
 		return -EINVAL;
 
+	spin_lock(&queue->lock);
 	spin_lock(&sk->sk_receive_queue.lock);
 	if (sk->sk_type == SOCK_STREAM ||
 	    sk->sk_type == SOCK_SEQPACKET) {
+		skb_queue_walk(queue, skb)
+			amount += unix_skb_len(skb);
 		skb_queue_walk(&sk->sk_receive_queue, skb)
 			amount += unix_skb_len(skb);
 	} else {
-		skb = skb_peek(&sk->sk_receive_queue);
+		skb = skb_peek(queue);
+		if (!skb)
+			skb = skb_peek(&sk->sk_receive_queue);
 		if (skb)
 			amount = skb->len;
 	}
 	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(&queue->lock);
 
 	return amount;
 }
@@ -2672,7 +2738,8 @@ static unsigned int unix_dgram_poll(struct file *file, struct socket *sock,
 		mask |= POLLHUP;
 
 	/* readable? */
-	if (!skb_queue_empty(&sk->sk_receive_queue))
+	if (!skb_queue_empty(&sk->sk_receive_queue) ||
+	    !skb_queue_empty(&unix_sk(sk)->reader_queue))
 		mask |= POLLIN | POLLRDNORM;
 
 	/* Connection-based need to check for termination and startup */
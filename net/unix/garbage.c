@@ -157,14 +157,15 @@ void unix_notinflight(struct user_struct *user, struct file *fp)
 	spin_unlock(&unix_gc_lock);
 }
 
-static void scan_inflight(struct sock *x, void (*func)(struct unix_sock *),
-			  struct sk_buff_head *hitlist)
+static void scan_queue(struct sk_buff_head *queue,
+		       void (*func)(struct unix_sock *),
+		       struct sk_buff_head *hitlist)
 {
 	struct sk_buff *skb;
 	struct sk_buff *next;
 
-	spin_lock(&x->sk_receive_queue.lock);
-	skb_queue_walk_safe(&x->sk_receive_queue, skb, next) {
+	spin_lock(&queue->lock);
+	skb_queue_walk_safe(queue, skb, next) {
 		/* Do we have file descriptors ? */
 		if (UNIXCB(skb).fp) {
 			bool hit = false;
@@ -191,12 +192,22 @@ static void scan_inflight(struct sock *x, void (*func)(struct unix_sock *),
 				}
 			}
 			if (hit && hitlist != NULL) {
-				__skb_unlink(skb, &x->sk_receive_queue);
+				__skb_unlink(skb, queue);
 				__skb_queue_tail(hitlist, skb);
 			}
 		}
 	}
-	spin_unlock(&x->sk_receive_queue.lock);
+	spin_unlock(&queue->lock);
+}
+
+static void scan_inflight(struct sock *x, void (*func)(struct unix_sock *),
+			  struct sk_buff_head *hitlist)
+{
+	scan_queue(&x->sk_receive_queue, func, hitlist);
+	/* Datagram messages spliced out for batched receive may still
+	 * carry descriptors.
+	 */
+	scan_queue(&unix_sk(x)->reader_queue, func, hitlist);
 }
 
 static void scan_children(struct sock *x, void (*func)(struct unix_sock *),
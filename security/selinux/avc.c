@@ -101,6 +101,91 @@ static inline int avc_hash(u32 ssid, u32 tsid, u16 tclass)
 	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1);
 }
 
+/*
+ * Per-CPU front cache.
+ *
+ * A small direct-mapped array of av_decision copies sitting in front of
+ * the shared hash. Entries are only ever written by their owning CPU, so
+ * a hit touches no shared cache lines at all. Concurrent same-CPU
+ * refills from interrupt context are caught by rechecking the
+ * generation and the key after the decision has been copied.
+ * Invalidation (policy load, cache flush, node updates) is a single
+ * global generation bump: stale entries fail the generation check and
+ * are overwritten lazily, without locks, IPIs or waiting.
+ */
+#define AVC_FRONT_CACHE_SLOTS	64
+
+struct avc_front_entry {
+	u32			ssid;
+	u32			tsid;
+	u32			gen;	/* 0 or an avc_front_gen snapshot */
+	u16			tclass;
+	struct av_decision	avd;
+};
+
+struct avc_front_cache {
+	struct avc_front_entry	entries[AVC_FRONT_CACHE_SLOTS];
+};
+
+static DEFINE_PER_CPU(struct avc_front_cache, avc_front_cache);
+static atomic_t avc_front_gen = ATOMIC_INIT(1);
+
+static inline int avc_front_hash(u32 ssid, u32 tsid, u16 tclass)
+{
+	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_FRONT_CACHE_SLOTS - 1);
+}
+
+static void avc_front_invalidate(void)
+{
+	/* 0 marks empty entries, skip it on wraparound */
+	if (atomic_inc_return(&avc_front_gen) == 0)
+		atomic_inc(&avc_front_gen);
+}
+
+static bool avc_front_lookup(u32 gen, u32 ssid, u32 tsid, u16 tclass,
+			     struct av_decision *avd)
+{
+	struct avc_front_entry *entry;
+	bool hit = false;
+
+	entry = get_cpu_ptr(&avc_front_cache)->entries +
+			avc_front_hash(ssid, tsid, tclass);
+	if (READ_ONCE(entry->gen) == gen &&
+	    entry->ssid == ssid && entry->tsid == tsid &&
+	    entry->tclass == tclass) {
+		memcpy(avd, &entry->avd, sizeof(*avd));
+		/*
+		 * An interrupt may have refilled the entry under us:
+		 * recheck generation and key to reject a torn copy.
+		 */
+		barrier();
+		if (READ_ONCE(entry->gen) == gen &&
+		    entry->ssid == ssid && entry->tsid == tsid &&
+		    entry->tclass == tclass)
+			hit = true;
+	}
+	put_cpu_ptr(&avc_front_cache);
+	return hit;
+}
+
+static void avc_front_fill(u32 gen, u32 ssid, u32 tsid, u16 tclass,
+			   const struct av_decision *avd)
+{
+	struct avc_front_entry *entry;
+
+	entry = get_cpu_ptr(&avc_front_cache)->entries +
+			avc_front_hash(ssid, tsid, tclass);
+	WRITE_ONCE(entry->gen, 0);
+	barrier();
+	entry->ssid = ssid;
+	entry->tsid = tsid;
+	entry->tclass = tclass;
+	memcpy(&entry->avd, avd, sizeof(entry->avd));
+	barrier();
+	WRITE_ONCE(entry->gen, gen);
+	put_cpu_ptr(&avc_front_cache);
+}
+
 /**
  * avc_dump_av - Display an access vector in human-readable form.
  * @tclass: target security class
@@ -902,6 +987,8 @@ static int avc_update_node(u32 event, u32 perms, u8 driver, u8 xperm, u32 ssid,
 out_unlock:
 	spin_unlock_irqrestore(lock, flag);
 out:
+	if (!rc)
+		avc_front_invalidate();
 	return rc;
 }
 
@@ -916,6 +1003,12 @@ static void avc_flush(void)
 	unsigned long flag;
 	int i;
 
+	/*
+	 * Retire all per-CPU front entries in one go; they are rewritten
+	 * lazily with the new generation as decisions are looked up again.
+	 */
+	avc_front_invalidate();
+
 	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
 		head = &avc_cache.slots[i];
 		lock = &avc_cache.slots_lock[i];
@@ -1104,22 +1197,37 @@ inline int avc_has_perm_noaudit(u32 ssid, u32 tsid,
 	struct avc_xperms_node xp_node;
 	int rc = 0;
 	u32 denied;
+	u32 front_gen;
 
 	BUG_ON(!requested);
 
-	rcu_read_lock();
+	/*
+	 * Snapshot the generation before consulting any cache, so that a
+	 * flush racing with the slow path below leaves us with a front
+	 * entry that is already stale.
+	 */
+	front_gen = atomic_read(&avc_front_gen);
+	if (avc_front_lookup(front_gen, ssid, tsid, tclass, avd)) {
+		avc_cache_stats_incr(front_hits);
+	} else {
+		rcu_read_lock();
+		node = avc_lookup(ssid, tsid, tclass);
+		if (unlikely(!node))
+			node = avc_compute_av(ssid, tsid, tclass, avd, &xp_node);
+		else
+			memcpy(avd, &node->ae.avd, sizeof(*avd));
+		rcu_read_unlock();
 
-	node = avc_lookup(ssid, tsid, tclass);
-	if (unlikely(!node))
-		node = avc_compute_av(ssid, tsid, tclass, avd, &xp_node);
-	else
-		memcpy(avd, &node->ae.avd, sizeof(*avd));
+		avc_front_fill(front_gen, ssid, tsid, tclass, avd);
+	}
 
 	denied = requested & ~(avd->allowed);
-	if (unlikely(denied))
+	if (unlikely(denied)) {
+		rcu_read_lock();
 		rc = avc_denied(ssid, tsid, tclass, requested, 0, 0, flags, avd);
+		rcu_read_unlock();
+	}
 
-	rcu_read_unlock();
 	return rc;
 }
 
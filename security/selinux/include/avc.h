@@ -44,6 +44,7 @@ struct avc_cache_stats {
 	unsigned int allocations;
 	unsigned int reclaims;
 	unsigned int frees;
+	unsigned int front_hits;
 };
 
 /*
@@ -0,0 +1,74 @@
+#!/bin/sh
+# Compare IPv6 route lookup throughput against the IPv4 fib_trie baseline.
+#
+# Fills a network namespace with a number of IPv4 and IPv6 routes, then
+# times batched "ip route get" lookups for both families.  With per-cpu
+# route caching on the IPv6 side the two should be within the same order
+# of magnitude; a large gap points at contention in the v6 lookup path.
+
+ROUTES=${ROUTES:-1000}
+LOOKUPS=${LOOKUPS:-10000}
+NS=route-bench
+
+cleanup()
+{
+	ip netns del $NS 2>/dev/null
+	rm -f batch-v4.$$ batch-v6.$$
+}
+
+run_lookups()
+{
+	# print elapsed centiseconds for one batched lookup run
+	start=$(date +%s%N 2>/dev/null)
+	ip netns exec $NS ip -batch $1 >/dev/null 2>&1
+	end=$(date +%s%N 2>/dev/null)
+	echo $(( (end - start) / 10000000 ))
+}
+
+if [ "$(id -u)" != "0" ]; then
+	echo "route_bench: need root, skipping"
+	exit 0
+fi
+
+trap cleanup EXIT
+
+ip netns add $NS || exit 1
+ip netns exec $NS ip link set lo up
+ip netns exec $NS ip link add dummy0 type dummy || exit 1
+ip netns exec $NS ip link set dummy0 up
+ip netns exec $NS ip addr add 192.0.2.1/24 dev dummy0
+ip netns exec $NS ip -6 addr add 2001:db8::1/64 dev dummy0
+
+i=0
+while [ $i -lt $ROUTES ]; do
+	a=$(( i / 250 + 1 ))
+	b=$(( i % 250 + 1 ))
+	echo "route add 10.$a.$b.0/24 via 192.0.2.2" >> batch-v4.$$
+	echo "route add 2001:db8:$a:$b::/64 via 2001:db8::2" >> batch-v6.$$
+	i=$(( i + 1 ))
+done
+ip netns exec $NS ip -batch batch-v4.$$ || exit 1
+ip netns exec $NS ip -batch batch-v6.$$ || exit 1
+rm -f batch-v4.$$ batch-v6.$$
+
+i=0
+while [ $i -lt $LOOKUPS ]; do
+	a=$(( i % (ROUTES / 250) + 1 ))
+	b=$(( i % 250 + 1 ))
+	echo "route get 10.$a.$b.1" >> batch-v4.$$
+	echo "route get 2001:db8:$a:$b::1" >> batch-v6.$$
+	i=$(( i + 1 ))
+done
+
+t4=$(run_lookups batch-v4.$$)
+t6=$(run_lookups batch-v6.$$)
+
+echo "ipv4: $LOOKUPS lookups in ${t4}0 ms"
+echo "ipv6: $LOOKUPS lookups in ${t6}0 ms"
+
+if [ "$t4" -gt 0 ] && [ $(( t6 / t4 )) -ge 3 ]; then
+	echo "[FAIL] ipv6 lookups more than 3x slower than ipv4"
+	exit 1
+fi
+echo "[PASS]"
+exit 0
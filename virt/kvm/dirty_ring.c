@@ -0,0 +1,127 @@
+/*
+ * KVM dirty ring implementation
+ *
+ * Per-vcpu rings that log dirtied guest frame numbers as they are
+ * written, so that live migration can harvest dirty pages without
+ * scanning whole-memslot bitmaps, and re-protect only what was
+ * harvested.
+ */
+#include <linux/kvm_host.h>
+#include <linux/kvm.h>
+#include <linux/vmalloc.h>
+#include <linux/kvm_dirty_ring.h>
+
+#include "mmu_lock.h"
+
+int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, u32 bytes)
+{
+	ring->dirty_gfns = vzalloc(bytes);
+	if (!ring->dirty_gfns)
+		return -ENOMEM;
+
+	ring->size = bytes / sizeof(struct kvm_dirty_gfn);
+	ring->dirty_index = 0;
+	ring->reset_index = 0;
+	return 0;
+}
+
+int kvm_dirty_ring_push(struct kvm_dirty_ring *ring, u32 slot, u64 offset)
+{
+	struct kvm_dirty_gfn *entry;
+
+	if (ring->dirty_index - ring->reset_index >= ring->size)
+		return -EBUSY;
+
+	entry = &ring->dirty_gfns[ring->dirty_index & (ring->size - 1)];
+	entry->slot = slot;
+	entry->offset = offset;
+	/*
+	 * Publish slot/offset before the flag that tells userspace the
+	 * entry is valid.
+	 */
+	smp_store_release(&entry->flags, KVM_DIRTY_GFN_F_DIRTY);
+	ring->dirty_index++;
+	return 0;
+}
+
+static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset,
+				unsigned long mask)
+{
+	struct kvm_memory_slot *memslot;
+	int as_id, id;
+
+	as_id = slot >> 16;
+	id = (u16)slot;
+
+	if (as_id >= KVM_ADDRESS_SPACE_NUM || id >= KVM_USER_MEM_SLOTS)
+		return;
+
+	memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
+	if (!memslot || offset + __fls(mask) >= memslot->npages)
+		return;
+
+	KVM_MMU_LOCK(kvm);
+	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
+	KVM_MMU_UNLOCK(kvm);
+}
+
+int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
+{
+	struct kvm_dirty_gfn *entry;
+	u32 cur_slot, next_slot;
+	u64 cur_offset, next_offset;
+	unsigned long mask = 0;
+	int count = 0;
+
+	cur_slot = 0;
+	cur_offset = 0;
+
+	while (true) {
+		entry = &ring->dirty_gfns[ring->reset_index & (ring->size - 1)];
+
+		/* only reclaim entries userspace has harvested */
+		if (smp_load_acquire(&entry->flags) !=
+		    (KVM_DIRTY_GFN_F_DIRTY | KVM_DIRTY_GFN_F_RESET))
+			break;
+
+		next_slot = entry->slot;
+		next_offset = entry->offset;
+
+		/* hand the slot back to the producer */
+		WRITE_ONCE(entry->flags, 0);
+		ring->reset_index++;
+		count++;
+
+		/*
+		 * Harvested entries are typically consecutive; coalesce
+		 * runs within a BITS_PER_LONG window of the same memslot
+		 * into one arch re-protect call.
+		 */
+		if (mask && next_slot == cur_slot &&
+		    next_offset >= cur_offset &&
+		    next_offset < cur_offset + BITS_PER_LONG) {
+			mask |= 1ul << (next_offset - cur_offset);
+			continue;
+		}
+		if (mask)
+			kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+		cur_slot = next_slot;
+		cur_offset = next_offset;
+		mask = 1;
+	}
+	if (mask)
+		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+
+	return count;
+}
+
+struct page *kvm_dirty_ring_get_page(struct kvm_dirty_ring *ring, u32 offset)
+{
+	return vmalloc_to_page((void *)ring->dirty_gfns + offset * PAGE_SIZE);
+}
+
+void kvm_dirty_ring_free(struct kvm_dirty_ring *ring)
+{
+	vfree(ring->dirty_gfns);
+	ring->dirty_gfns = NULL;
+}
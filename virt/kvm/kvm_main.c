@@ -59,6 +59,7 @@
 #include "coalesced_mmio.h"
 #include "async_pf.h"
 #include "vfio.h"
+#include "mmu_lock.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/kvm.h>
@@ -84,6 +85,13 @@ unsigned int halt_poll_ns_shrink;
 module_param(halt_poll_ns_shrink, uint, S_IRUGO | S_IWUSR);
 EXPORT_SYMBOL_GPL(halt_poll_ns_shrink);
 
+/*
+ * Size each vcpu's polling window from a moving average of its recent
+ * halt durations instead of the grow/shrink steps above.
+ */
+static bool halt_poll_ns_adaptive = true;
+module_param(halt_poll_ns_adaptive, bool, S_IRUGO | S_IWUSR);
+
 /*
  * Ordering of locks:
  *
@@ -254,15 +262,28 @@ int kvm_vcpu_init(struct kvm_vcpu *vcpu, struct kvm *kvm, unsigned id)
 	}
 	vcpu->run = page_address(page);
 
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	if (kvm->dirty_ring_size) {
+		r = kvm_dirty_ring_alloc(&vcpu->dirty_ring,
+					 kvm->dirty_ring_size);
+		if (r)
+			goto fail_free_run;
+	}
+#endif
+
 	kvm_vcpu_set_in_spin_loop(vcpu, false);
 	kvm_vcpu_set_dy_eligible(vcpu, false);
 	vcpu->preempted = false;
 
 	r = kvm_arch_vcpu_init(vcpu);
 	if (r < 0)
-		goto fail_free_run;
+		goto fail_free_ring;
 	return 0;
 
+fail_free_ring:
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	kvm_dirty_ring_free(&vcpu->dirty_ring);
+#endif
 fail_free_run:
 	free_page((unsigned long)vcpu->run);
 fail:
@@ -274,6 +295,9 @@ void kvm_vcpu_uninit(struct kvm_vcpu *vcpu)
 {
 	put_pid(vcpu->pid);
 	kvm_arch_vcpu_uninit(vcpu);
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	kvm_dirty_ring_free(&vcpu->dirty_ring);
+#endif
 	free_page((unsigned long)vcpu->run);
 }
 EXPORT_SYMBOL_GPL(kvm_vcpu_uninit);
@@ -310,7 +334,7 @@ static void kvm_mmu_notifier_invalidate_page(struct mmu_notifier *mn,
 	 * is going to be freed.
 	 */
 	idx = srcu_read_lock(&kvm->srcu);
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 
 	kvm->mmu_notifier_seq++;
 	need_tlb_flush = kvm_unmap_hva(kvm, address) | kvm->tlbs_dirty;
@@ -318,7 +342,7 @@ static void kvm_mmu_notifier_invalidate_page(struct mmu_notifier *mn,
 	if (need_tlb_flush)
 		kvm_flush_remote_tlbs(kvm);
 
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 
 	kvm_arch_mmu_notifier_invalidate_page(kvm, address);
 
@@ -334,10 +358,10 @@ static void kvm_mmu_notifier_change_pte(struct mmu_notifier *mn,
 	int idx;
 
 	idx = srcu_read_lock(&kvm->srcu);
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 	kvm->mmu_notifier_seq++;
 	kvm_set_spte_hva(kvm, address, pte);
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 	srcu_read_unlock(&kvm->srcu, idx);
 }
 
@@ -350,7 +374,7 @@ static void kvm_mmu_notifier_invalidate_range_start(struct mmu_notifier *mn,
 	int need_tlb_flush = 0, idx;
 
 	idx = srcu_read_lock(&kvm->srcu);
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 	/*
 	 * The count increase must become visible at unlock time as no
 	 * spte can be established without taking the mmu_lock and
@@ -363,7 +387,7 @@ static void kvm_mmu_notifier_invalidate_range_start(struct mmu_notifier *mn,
 	if (need_tlb_flush)
 		kvm_flush_remote_tlbs(kvm);
 
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 	srcu_read_unlock(&kvm->srcu, idx);
 }
 
@@ -374,7 +398,7 @@ static void kvm_mmu_notifier_invalidate_range_end(struct mmu_notifier *mn,
 {
 	struct kvm *kvm = mmu_notifier_to_kvm(mn);
 
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 	/*
 	 * This sequence increase will notify the kvm page fault that
 	 * the page that is going to be mapped in the spte could have
@@ -388,7 +412,7 @@ static void kvm_mmu_notifier_invalidate_range_end(struct mmu_notifier *mn,
 	 * in conjunction with the smp_rmb in mmu_notifier_retry().
 	 */
 	kvm->mmu_notifier_count--;
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 
 	BUG_ON(kvm->mmu_notifier_count < 0);
 }
@@ -402,13 +426,13 @@ static int kvm_mmu_notifier_clear_flush_young(struct mmu_notifier *mn,
 	int young, idx;
 
 	idx = srcu_read_lock(&kvm->srcu);
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 
 	young = kvm_age_hva(kvm, start, end);
 	if (young)
 		kvm_flush_remote_tlbs(kvm);
 
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 	srcu_read_unlock(&kvm->srcu, idx);
 
 	return young;
@@ -423,7 +447,7 @@ static int kvm_mmu_notifier_clear_young(struct mmu_notifier *mn,
 	int young, idx;
 
 	idx = srcu_read_lock(&kvm->srcu);
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 	/*
 	 * Even though we do not flush TLB, this will still adversely
 	 * affect performance on pre-Haswell Intel EPT, where there is
@@ -438,7 +462,7 @@ static int kvm_mmu_notifier_clear_young(struct mmu_notifier *mn,
 	 * more sophisticated heuristic later.
 	 */
 	young = kvm_age_hva(kvm, start, end);
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 	srcu_read_unlock(&kvm->srcu, idx);
 
 	return young;
@@ -452,9 +476,9 @@ static int kvm_mmu_notifier_test_young(struct mmu_notifier *mn,
 	int young, idx;
 
 	idx = srcu_read_lock(&kvm->srcu);
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 	young = kvm_test_age_hva(kvm, address);
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 	srcu_read_unlock(&kvm->srcu, idx);
 
 	return young;
@@ -615,7 +639,7 @@ static struct kvm *kvm_create_vm(unsigned long type)
 	if (!kvm)
 		return ERR_PTR(-ENOMEM);
 
-	spin_lock_init(&kvm->mmu_lock);
+	KVM_MMU_LOCK_INIT(kvm);
 	atomic_inc(&current->mm->mm_count);
 	kvm->mm = current->mm;
 	kvm_eventfd_init(kvm);
@@ -1183,7 +1207,7 @@ int kvm_get_dirty_log_protect(struct kvm *kvm,
 	dirty_bitmap_buffer = dirty_bitmap + n / sizeof(long);
 	memset(dirty_bitmap_buffer, 0, n);
 
-	spin_lock(&kvm->mmu_lock);
+	KVM_MMU_LOCK(kvm);
 	*is_dirty = false;
 	for (i = 0; i < n / sizeof(long); i++) {
 		unsigned long mask;
@@ -1204,7 +1228,7 @@ int kvm_get_dirty_log_protect(struct kvm *kvm,
 		}
 	}
 
-	spin_unlock(&kvm->mmu_lock);
+	KVM_MMU_UNLOCK(kvm);
 
 	r = -EFAULT;
 	if (copy_to_user(log->dirty_bitmap, dirty_bitmap_buffer, n))
@@ -2087,6 +2111,21 @@ void kvm_vcpu_mark_page_dirty(struct kvm_vcpu *vcpu, gfn_t gfn)
 	struct kvm_memory_slot *memslot;
 
 	memslot = kvm_vcpu_gfn_to_memslot(vcpu, gfn);
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	/*
+	 * With dirty rings enabled, log the gfn in this vcpu's ring
+	 * instead of the memslot bitmap.  On ring overflow fall back to
+	 * the bitmap so no page is lost; userspace picks stragglers up
+	 * with a final KVM_GET_DIRTY_LOG pass.
+	 */
+	if (vcpu->kvm->dirty_ring_size && memslot &&
+	    (memslot->flags & KVM_MEM_LOG_DIRTY_PAGES) &&
+	    !kvm_dirty_ring_push(&vcpu->dirty_ring,
+				 (kvm_arch_vcpu_memslots_id(vcpu) << 16) |
+				 (u16)memslot->id,
+				 gfn - memslot->base_gfn))
+		return;
+#endif
 	mark_page_dirty_in_slot(memslot, gfn);
 }
 EXPORT_SYMBOL_GPL(kvm_vcpu_mark_page_dirty);
@@ -2125,6 +2164,41 @@ static void shrink_halt_poll_ns(struct kvm_vcpu *vcpu)
 	trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id, val, old);
 }
 
+/*
+ * Feed one halt duration into the vcpu's moving average and derive the
+ * next polling window from it: poll slightly longer than the typical
+ * halt so the common wakeup is caught while still polling, and stop
+ * polling entirely once typical halts are too long for polling to win.
+ * Poll hits feed the real wakeup latency back into the average, so the
+ * window tracks the workload instead of ratcheting up to the cap.
+ */
+static void adjust_halt_poll_ns(struct kvm_vcpu *vcpu, u64 block_ns)
+{
+	unsigned int old = vcpu->halt_poll_ns;
+	u64 val;
+
+	/* EWMA with a 1/8 weight for the newest sample */
+	val = vcpu->halt_block_ns_ewma;
+	val -= val >> 3;
+	val += block_ns >> 3;
+	vcpu->halt_block_ns_ewma = val;
+
+	val += val >> 2;
+	if (val > halt_poll_ns) {
+		vcpu->halt_poll_ns = 0;
+	} else {
+		/* 10us floor, as in grow_halt_poll_ns() */
+		vcpu->halt_poll_ns = max(val, 10000ull);
+	}
+
+	if (vcpu->halt_poll_ns > old)
+		trace_kvm_halt_poll_ns_grow(vcpu->vcpu_id,
+					    vcpu->halt_poll_ns, old);
+	else if (vcpu->halt_poll_ns < old)
+		trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id,
+					      vcpu->halt_poll_ns, old);
+}
+
 static int kvm_vcpu_check_block(struct kvm_vcpu *vcpu)
 {
 	if (kvm_arch_vcpu_runnable(vcpu)) {
@@ -2161,12 +2235,15 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 			 */
 			if (kvm_vcpu_check_block(vcpu) < 0) {
 				++vcpu->stat.halt_successful_poll;
+				++vcpu->halt_poll_hits;
 				if (!vcpu_valid_wakeup(vcpu))
 					++vcpu->stat.halt_poll_invalid;
 				goto out;
 			}
 			cur = ktime_get();
 		} while (single_task_running() && ktime_before(cur, stop));
+
+		++vcpu->halt_poll_misses;
 	}
 
 	kvm_arch_vcpu_blocking(vcpu);
@@ -2188,8 +2265,16 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 out:
 	block_ns = ktime_to_ns(cur) - ktime_to_ns(start);
 
+	/* rough wake-source history for userspace policy, see debugfs */
+	if (kvm_cpu_has_pending_timer(vcpu))
+		++vcpu->halt_wake_timer;
+	else
+		++vcpu->halt_wake_other;
+
 	if (!vcpu_valid_wakeup(vcpu))
 		shrink_halt_poll_ns(vcpu);
+	else if (halt_poll_ns && READ_ONCE(halt_poll_ns_adaptive))
+		adjust_halt_poll_ns(vcpu, block_ns);
 	else if (halt_poll_ns) {
 		if (block_ns <= vcpu->halt_poll_ns)
 			;
@@ -2365,6 +2450,13 @@ static int kvm_vcpu_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 #ifdef KVM_COALESCED_MMIO_PAGE_OFFSET
 	else if (vmf->pgoff == KVM_COALESCED_MMIO_PAGE_OFFSET)
 		page = virt_to_page(vcpu->kvm->coalesced_mmio_ring);
+#endif
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	else if (vmf->pgoff >= KVM_DIRTY_LOG_PAGE_OFFSET &&
+		 vmf->pgoff < KVM_DIRTY_LOG_PAGE_OFFSET +
+			      vcpu->kvm->dirty_ring_size / PAGE_SIZE)
+		page = kvm_dirty_ring_get_page(&vcpu->dirty_ring,
+				vmf->pgoff - KVM_DIRTY_LOG_PAGE_OFFSET);
 #endif
 	else
 		return kvm_arch_vcpu_fault(vcpu, vmf);
@@ -2410,10 +2502,83 @@ static int create_vcpu_fd(struct kvm_vcpu *vcpu)
 	return anon_inode_getfd("kvm-vcpu", &kvm_vcpu_fops, vcpu, O_RDWR | O_CLOEXEC);
 }
 
+static int vcpu_get_halt_poll_ns(void *data, u64 *val)
+{
+	struct kvm_vcpu *vcpu = (struct kvm_vcpu *) data;
+	*val = vcpu->halt_poll_ns;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vcpu_halt_poll_ns_fops, vcpu_get_halt_poll_ns, NULL,
+			"%llu\n");
+
+static int vcpu_get_halt_block_ns_ewma(void *data, u64 *val)
+{
+	struct kvm_vcpu *vcpu = (struct kvm_vcpu *) data;
+	*val = vcpu->halt_block_ns_ewma;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vcpu_halt_block_ns_ewma_fops,
+			vcpu_get_halt_block_ns_ewma, NULL, "%llu\n");
+
+static int vcpu_get_halt_poll_hits(void *data, u64 *val)
+{
+	struct kvm_vcpu *vcpu = (struct kvm_vcpu *) data;
+	*val = vcpu->halt_poll_hits;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vcpu_halt_poll_hits_fops, vcpu_get_halt_poll_hits,
+			NULL, "%llu\n");
+
+static int vcpu_get_halt_poll_misses(void *data, u64 *val)
+{
+	struct kvm_vcpu *vcpu = (struct kvm_vcpu *) data;
+	*val = vcpu->halt_poll_misses;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vcpu_halt_poll_misses_fops, vcpu_get_halt_poll_misses,
+			NULL, "%llu\n");
+
+static int vcpu_get_halt_wake_timer(void *data, u64 *val)
+{
+	struct kvm_vcpu *vcpu = (struct kvm_vcpu *) data;
+	*val = vcpu->halt_wake_timer;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vcpu_halt_wake_timer_fops, vcpu_get_halt_wake_timer,
+			NULL, "%llu\n");
+
+static int vcpu_get_halt_wake_other(void *data, u64 *val)
+{
+	struct kvm_vcpu *vcpu = (struct kvm_vcpu *) data;
+	*val = vcpu->halt_wake_other;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vcpu_halt_wake_other_fops, vcpu_get_halt_wake_other,
+			NULL, "%llu\n");
+
+static const struct {
+	const char *name;
+	const struct file_operations *fops;
+} vcpu_halt_debugfs_files[] = {
+	{ "halt-poll-ns", &vcpu_halt_poll_ns_fops },
+	{ "halt-block-ns-ewma", &vcpu_halt_block_ns_ewma_fops },
+	{ "halt-poll-hits", &vcpu_halt_poll_hits_fops },
+	{ "halt-poll-misses", &vcpu_halt_poll_misses_fops },
+	{ "halt-wake-timer", &vcpu_halt_wake_timer_fops },
+	{ "halt-wake-other", &vcpu_halt_wake_other_fops },
+};
+
 static int kvm_create_vcpu_debugfs(struct kvm_vcpu *vcpu)
 {
 	char dir_name[ITOA_MAX_LEN * 2];
 	int ret;
+	int i;
 
 	if (!kvm_arch_has_vcpu_debugfs())
 		return 0;
@@ -2427,13 +2592,24 @@ static int kvm_create_vcpu_debugfs(struct kvm_vcpu *vcpu)
 	if (!vcpu->debugfs_dentry)
 		return -ENOMEM;
 
-	ret = kvm_arch_create_vcpu_debugfs(vcpu);
-	if (ret < 0) {
-		debugfs_remove_recursive(vcpu->debugfs_dentry);
-		return ret;
+	for (i = 0; i < ARRAY_SIZE(vcpu_halt_debugfs_files); i++) {
+		if (!debugfs_create_file(vcpu_halt_debugfs_files[i].name,
+					 0444, vcpu->debugfs_dentry, vcpu,
+					 vcpu_halt_debugfs_files[i].fops)) {
+			ret = -ENOMEM;
+			goto out_remove;
+		}
 	}
 
+	ret = kvm_arch_create_vcpu_debugfs(vcpu);
+	if (ret < 0)
+		goto out_remove;
+
 	return 0;
+
+out_remove:
+	debugfs_remove_recursive(vcpu->debugfs_dentry);
+	return ret;
 }
 
 /*
@@ -2941,12 +3117,60 @@ static long kvm_vm_ioctl_check_extension_generic(struct kvm *kvm, long arg)
 #endif
 	case KVM_CAP_MAX_VCPU_ID:
 		return KVM_MAX_VCPU_ID;
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	case KVM_CAP_DIRTY_LOG_RING:
+		return KVM_DIRTY_RING_MAX_ENTRIES *
+		       sizeof(struct kvm_dirty_gfn);
+#endif
 	default:
 		break;
 	}
 	return kvm_vm_ioctl_check_extension(kvm, arg);
 }
 
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+static int kvm_vm_ioctl_enable_dirty_log_ring(struct kvm *kvm, u32 size)
+{
+	int r;
+
+	/* the size should be power of 2 pages */
+	if (!size || (size & (size - 1)) || (size & (PAGE_SIZE - 1)))
+		return -EINVAL;
+	if (size > KVM_DIRTY_RING_MAX_ENTRIES *
+		   sizeof(struct kvm_dirty_gfn))
+		return -E2BIG;
+
+	/* the ring must be configured before any vcpu is created */
+	mutex_lock(&kvm->lock);
+	if (kvm->created_vcpus) {
+		r = -EINVAL;
+	} else {
+		kvm->dirty_ring_size = size;
+		r = 0;
+	}
+	mutex_unlock(&kvm->lock);
+	return r;
+}
+
+static int kvm_vm_ioctl_reset_dirty_pages(struct kvm *kvm)
+{
+	struct kvm_vcpu *vcpu;
+	int i, cleared = 0;
+
+	if (!kvm->dirty_ring_size)
+		return -EINVAL;
+
+	mutex_lock(&kvm->slots_lock);
+	kvm_for_each_vcpu(i, vcpu, kvm)
+		cleared += kvm_dirty_ring_reset(kvm, &vcpu->dirty_ring);
+	mutex_unlock(&kvm->slots_lock);
+
+	if (cleared)
+		kvm_flush_remote_tlbs(kvm);
+	return cleared;
+}
+#endif
+
 static long kvm_vm_ioctl(struct file *filp,
 			   unsigned int ioctl, unsigned long arg)
 {
@@ -3106,6 +3330,25 @@ out_free_irq_routing:
 	case KVM_CHECK_EXTENSION:
 		r = kvm_vm_ioctl_check_extension_generic(kvm, arg);
 		break;
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	case KVM_ENABLE_CAP: {
+		struct kvm_enable_cap cap;
+
+		r = -EFAULT;
+		if (copy_from_user(&cap, argp, sizeof(cap)))
+			goto out;
+		if (cap.cap != KVM_CAP_DIRTY_LOG_RING || cap.flags) {
+			/* all other capabilities are handled by the arch */
+			r = kvm_arch_vm_ioctl(filp, ioctl, arg);
+			break;
+		}
+		r = kvm_vm_ioctl_enable_dirty_log_ring(kvm, cap.args[0]);
+		break;
+	}
+	case KVM_RESET_DIRTY_RINGS:
+		r = kvm_vm_ioctl_reset_dirty_pages(kvm);
+		break;
+#endif
 	default:
 		r = kvm_arch_vm_ioctl(filp, ioctl, arg);
 	}
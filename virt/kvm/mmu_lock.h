@@ -0,0 +1,20 @@
+#ifndef KVM_MMU_LOCK_H
+#define KVM_MMU_LOCK_H 1
+
+/*
+ * Architectures can choose to use an rwlock for the mmu_lock so that
+ * page faults can be handled in parallel; they define
+ * KVM_HAVE_MMU_RWLOCK in their arch kvm_host.h.  The generic code
+ * below always takes the lock exclusively.
+ */
+#ifdef KVM_HAVE_MMU_RWLOCK
+#define KVM_MMU_LOCK_INIT(kvm)	rwlock_init(&(kvm)->mmu_lock)
+#define KVM_MMU_LOCK(kvm)	write_lock(&(kvm)->mmu_lock)
+#define KVM_MMU_UNLOCK(kvm)	write_unlock(&(kvm)->mmu_lock)
+#else
+#define KVM_MMU_LOCK_INIT(kvm)	spin_lock_init(&(kvm)->mmu_lock)
+#define KVM_MMU_LOCK(kvm)	spin_lock(&(kvm)->mmu_lock)
+#define KVM_MMU_UNLOCK(kvm)	spin_unlock(&(kvm)->mmu_lock)
+#endif /* KVM_HAVE_MMU_RWLOCK */
+
+#endif